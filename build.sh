@@ -6,8 +6,15 @@ echo "Building SuperPanel Web Host Control Panel..."
 echo "Building C++ Native Library..."
 if command -v msbuild &> /dev/null; then
     msbuild src/NativeLibrary/SuperPanel.NativeLibrary.vcxproj /p:Configuration=Release /p:Platform=x64
+elif command -v g++ &> /dev/null; then
+    # Linux: the Web API project copies the shared library into its output
+    # (and so into the test project's) when it exists
+    mkdir -p src/NativeLibrary/bin/Linux
+    g++ -std=c++17 -O2 -fPIC -shared -pthread -Isrc/NativeLibrary \
+        $(ls src/NativeLibrary/*.cpp | grep -v -e dllmain.cpp -e pch.cpp) \
+        -o src/NativeLibrary/bin/Linux/libSuperPanel.NativeLibrary.so -lz -lssl -lcrypto || exit 1
 else
-    echo "MSBuild not found. Please build the Native Library manually in Visual Studio."
+    echo "Neither MSBuild nor g++ found. Please build the Native Library manually in Visual Studio."
 fi
 
 # Build Web API
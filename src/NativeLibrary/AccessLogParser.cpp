@@ -0,0 +1,394 @@
+#include "pch.h"
+#include "AccessLogParser.h"
+#include "TextScan.h"
+#include <cstring>
+
+namespace superpanel {
+
+namespace {
+
+const char* const CombinedFormat =
+    "$remote_addr - $remote_user [$time_local] \"$request\" $status $body_bytes_sent \"$http_referer\" \"$http_user_agent\"";
+const char* const CommonFormat = "$remote_addr - $remote_user [$time_local] \"$request\" $status $body_bytes_sent";
+const char* const VhostCombinedFormat = "%v:%p %h %l %u %t \"%r\" %>s %O \"%{Referer}i\" \"%{User-Agent}i\"";
+
+bool IsNameChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Parses leading decimal digits; returns false when there are none
+bool ParseDigits(const char* p, size_t length, long long& value, size_t* consumed = nullptr) {
+    size_t i = 0;
+    long long result = 0;
+    while (i < length && p[i] >= '0' && p[i] <= '9') {
+        result = result * 10 + (p[i] - '0');
+        i++;
+    }
+    if (i == 0) return false;
+    value = result;
+    if (consumed != nullptr) *consumed = i;
+    return true;
+}
+
+int FixedDigits(const char* p, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        if (p[i] < '0' || p[i] > '9') return -1;
+        value = value * 10 + (p[i] - '0');
+    }
+    return value;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+long long DaysFromCivil(int year, int month, int day) {
+    year -= month <= 2;
+    const long long era = (year >= 0 ? year : year - 399) / 400;
+    const int yearOfEra = year - static_cast<int>(era * 400);
+    const int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+int MonthFromName(const char* p) {
+    static const char names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    for (int i = 0; i < 12; i++) {
+        if (memcmp(names + i * 3, p, 3) == 0) return i + 1;
+    }
+    return -1;
+}
+
+// "10/Oct/2000:13:55:36 -0700"
+long long ParseTimeLocal(const char* p, size_t length) {
+    if (length < 26 || p[2] != '/' || p[6] != '/' || p[11] != ':') return -1;
+    int day = FixedDigits(p, 2);
+    int month = MonthFromName(p + 3);
+    int year = FixedDigits(p + 7, 4);
+    int hour = FixedDigits(p + 12, 2);
+    int minute = FixedDigits(p + 15, 2);
+    int second = FixedDigits(p + 18, 2);
+    int offsetHours = FixedDigits(p + 22, 2);
+    int offsetMinutes = FixedDigits(p + 24, 2);
+    if (day < 0 || month < 0 || year < 0 || hour < 0 || minute < 0 || second < 0 || offsetHours < 0 || offsetMinutes < 0) return -1;
+
+    long long offset = (offsetHours * 60 + offsetMinutes) * 60;
+    if (p[21] == '-') offset = -offset;
+    return DaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+}
+
+// "2000-10-10T13:55:36-07:00" or "...Z"
+long long ParseTimeIso8601(const char* p, size_t length) {
+    if (length < 20 || p[4] != '-' || p[7] != '-' || p[10] != 'T') return -1;
+    int year = FixedDigits(p, 4);
+    int month = FixedDigits(p + 5, 2);
+    int day = FixedDigits(p + 8, 2);
+    int hour = FixedDigits(p + 11, 2);
+    int minute = FixedDigits(p + 14, 2);
+    int second = FixedDigits(p + 17, 2);
+    if (year < 0 || month < 1 || day < 0 || hour < 0 || minute < 0 || second < 0) return -1;
+
+    long long offset = 0;
+    if (length >= 25 && (p[19] == '+' || p[19] == '-')) {
+        int offsetHours = FixedDigits(p + 20, 2);
+        int offsetMinutes = FixedDigits(p + 23, 2);
+        if (offsetHours < 0 || offsetMinutes < 0) return -1;
+        offset = (offsetHours * 60 + offsetMinutes) * 60;
+        if (p[19] == '-') offset = -offset;
+    }
+    return DaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+}
+
+// "0.123" -> 123000
+long long ParseSecondsToMicros(const char* p, size_t length) {
+    long long whole = 0;
+    size_t used = 0;
+    if (!ParseDigits(p, length, whole, &used)) return -1;
+    long long micros = whole * 1000000;
+    if (used < length && p[used] == '.') {
+        long long scale = 100000;
+        for (size_t i = used + 1; i < length && p[i] >= '0' && p[i] <= '9' && scale > 0; i++) {
+            micros += (p[i] - '0') * scale;
+            scale /= 10;
+        }
+    }
+    return micros;
+}
+
+std::string_view StripQuery(const char* p, size_t length) {
+    const void* query = memchr(p, '?', length);
+    if (query != nullptr) length = static_cast<size_t>(static_cast<const char*>(query) - p);
+    return std::string_view(p, length);
+}
+
+} // namespace
+
+void AccessLogParser::AddLiteral(const std::string& text) {
+    if (text.empty()) return;
+    if (!elements_.empty() && elements_.back().literal) {
+        elements_.back().text += text;
+        return;
+    }
+    Element element;
+    element.literal = true;
+    element.text = text;
+    elements_.push_back(element);
+}
+
+void AccessLogParser::AddField(FieldKind kind) {
+    Element element;
+    element.kind = kind;
+    elements_.push_back(element);
+    if (kind == FieldKind::Host) hasHost_ = true;
+}
+
+bool AccessLogParser::SetFormat(const std::string& requested) {
+    elements_.clear();
+    terminatorCount_ = 0;
+    hasHost_ = false;
+
+    std::string format = requested;
+    if (format == "combined") format = CombinedFormat;
+    else if (format == "common") format = CommonFormat;
+    else if (format == "vhost_combined") format = VhostCombinedFormat;
+
+    std::string literal;
+    auto flushLiteral = [&]() {
+        AddLiteral(literal);
+        literal.clear();
+    };
+
+    for (size_t i = 0; i < format.size();) {
+        char c = format[i];
+
+        if (c == '\\' && i + 1 < format.size()) {
+            // Apache configs escape quotes inside the format string
+            literal += format[i + 1];
+            i += 2;
+        } else if (c == '$' && i + 1 < format.size() && (IsNameChar(format[i + 1]) || format[i + 1] == '{')) {
+            // nginx variable: $name or ${name}
+            bool braced = format[i + 1] == '{';
+            size_t start = i + (braced ? 2 : 1);
+            size_t end = start;
+            while (end < format.size() && IsNameChar(format[end])) end++;
+            std::string name = format.substr(start, end - start);
+            i = braced && end < format.size() && format[end] == '}' ? end + 1 : end;
+
+            FieldKind kind = FieldKind::Skip;
+            if (name == "host" || name == "server_name") kind = FieldKind::Host;
+            else if (name == "remote_addr") kind = FieldKind::Client;
+            else if (name == "request") kind = FieldKind::Request;
+            else if (name == "request_uri" || name == "uri") kind = FieldKind::Uri;
+            else if (name == "status") kind = FieldKind::Status;
+            else if (name == "body_bytes_sent" || name == "bytes_sent") kind = FieldKind::Bytes;
+            else if (name == "request_time") kind = FieldKind::Seconds;
+            else if (name == "time_local") kind = FieldKind::TimeLocal;
+            else if (name == "time_iso8601") kind = FieldKind::TimeIso8601;
+            else if (name == "msec") kind = FieldKind::Msec;
+
+            flushLiteral();
+            AddField(kind);
+        } else if (c == '%' && i + 1 < format.size()) {
+            // Apache directive: %[<>!0-9,]*[{arg}]letter
+            size_t p = i + 1;
+            if (format[p] == '%') {
+                literal += '%';
+                i = p + 1;
+                continue;
+            }
+            while (p < format.size() && (format[p] == '<' || format[p] == '>' || format[p] == '!' || format[p] == ',' ||
+                                         (format[p] >= '0' && format[p] <= '9'))) {
+                p++;
+            }
+            std::string argument;
+            if (p < format.size() && format[p] == '{') {
+                size_t close = format.find('}', p);
+                if (close == std::string::npos) return false;
+                argument = format.substr(p + 1, close - p - 1);
+                p = close + 1;
+            }
+            if (p >= format.size()) return false;
+            char directive = format[p];
+            i = p + 1;
+
+            flushLiteral();
+            switch (directive) {
+            case 'h': case 'a': AddField(FieldKind::Client); break;
+            case 'v': case 'V': AddField(FieldKind::Host); break;
+            case 'r': AddField(FieldKind::Request); break;
+            case 'U': AddField(FieldKind::Uri); break;
+            case 's': AddField(FieldKind::Status); break;
+            case 'b': case 'B': case 'O': AddField(FieldKind::Bytes); break;
+            case 'D': AddField(FieldKind::Microseconds); break;
+            case 'T':
+                if (argument == "us") AddField(FieldKind::Microseconds);
+                else if (argument == "ms" || argument == "msec") AddField(FieldKind::Skip);
+                else AddField(FieldKind::WholeSeconds);
+                break;
+            case 't':
+                if (argument.empty()) {
+                    AddLiteral("[");
+                    AddField(FieldKind::TimeLocal);
+                    AddLiteral("]");
+                } else {
+                    AddField(FieldKind::Skip);
+                }
+                break;
+            default: AddField(FieldKind::Skip); break;
+            }
+        } else {
+            literal += c;
+            i++;
+        }
+    }
+    flushLiteral();
+    return Finish();
+}
+
+bool AccessLogParser::Finish() {
+    for (size_t i = 0; i < elements_.size(); i++) {
+        Element& element = elements_[i];
+        if (element.literal) continue;
+        if (i + 1 == elements_.size()) {
+            element.terminator = -1;
+            continue;
+        }
+        const Element& next = elements_[i + 1];
+        if (!next.literal) return false;
+
+        char terminator = next.text[0];
+        int index = -1;
+        for (int t = 0; t < terminatorCount_; t++) {
+            if (terminators_[t] == terminator) index = t;
+        }
+        if (index < 0) {
+            if (terminatorCount_ == MaxTerminators) return false;
+            index = terminatorCount_;
+            terminators_[terminatorCount_++] = terminator;
+        }
+        element.terminator = index;
+    }
+    return !elements_.empty();
+}
+
+size_t AccessLogParser::FindTerminator(const char* line, size_t length, const uint64_t* masks, int terminator, size_t from) const {
+    const char c = terminators_[terminator];
+    if (masks == nullptr) {
+        const void* hit = from < length ? memchr(line + from, c, length - from) : nullptr;
+        return hit != nullptr ? static_cast<size_t>(static_cast<const char*>(hit) - line) : SIZE_MAX;
+    }
+
+    const size_t words = (length + 63) / 64;
+    const uint64_t* row = masks + static_cast<size_t>(terminator) * words;
+    size_t word = from / 64;
+    if (word >= words) return SIZE_MAX;
+    uint64_t bits = row[word] & (~uint64_t(0) << (from % 64));
+    while (bits == 0) {
+        if (++word >= words) return SIZE_MAX;
+        bits = row[word];
+    }
+    return word * 64 + static_cast<size_t>(LowestBit(bits));
+}
+
+void AccessLogParser::StoreField(FieldKind kind, const char* value, size_t length, AccessLogRecord& record) const {
+    long long number = 0;
+    switch (kind) {
+    case FieldKind::Host:
+        record.host = std::string_view(value, length);
+        break;
+    case FieldKind::Client:
+        record.client = std::string_view(value, length);
+        break;
+    case FieldKind::Request: {
+        // METHOD SP target SP protocol
+        const char* space = static_cast<const char*>(memchr(value, ' ', length));
+        if (space == nullptr) break;
+        const char* target = space + 1;
+        size_t remaining = length - static_cast<size_t>(target - value);
+        const char* end = static_cast<const char*>(memchr(target, ' ', remaining));
+        record.path = StripQuery(target, end != nullptr ? static_cast<size_t>(end - target) : remaining);
+        break;
+    }
+    case FieldKind::Uri:
+        record.path = StripQuery(value, length);
+        break;
+    case FieldKind::Status:
+        if (ParseDigits(value, length, number)) record.status = static_cast<int>(number);
+        break;
+    case FieldKind::Bytes:
+        if (ParseDigits(value, length, number)) record.bytes = number;
+        break;
+    case FieldKind::Seconds:
+        record.latencyUs = ParseSecondsToMicros(value, length);
+        break;
+    case FieldKind::Microseconds:
+        if (ParseDigits(value, length, number)) record.latencyUs = number;
+        break;
+    case FieldKind::WholeSeconds:
+        if (ParseDigits(value, length, number)) record.latencyUs = number * 1000000;
+        break;
+    case FieldKind::TimeLocal:
+        record.timestamp = ParseTimeLocal(value, length);
+        break;
+    case FieldKind::TimeIso8601:
+        record.timestamp = ParseTimeIso8601(value, length);
+        break;
+    case FieldKind::Msec:
+        if (ParseDigits(value, length, number)) record.timestamp = number;
+        break;
+    case FieldKind::Skip:
+        break;
+    }
+}
+
+bool AccessLogParser::Parse(const char* line, size_t length, AccessLogRecord& record) const {
+    record = AccessLogRecord();
+    if (elements_.empty()) return false;
+    if (length > 0 && line[length - 1] == '\r') length--;
+
+    // Terminator bitmasks for the whole line, one row of 64-bit words per
+    // terminator character. Very long lines fall back to memchr.
+    uint64_t masks[MaxTerminators * (MaxMaskedLine / 64)];
+    const uint64_t* maskRows = nullptr;
+    if (length <= MaxMaskedLine) {
+        const size_t words = (length + 63) / 64;
+        for (size_t w = 0; w < words; w++) {
+            const char* block = line + w * 64;
+            char padded[64];
+            if (w * 64 + 64 > length) {
+                // Never read past the line: the mapping may end right after it
+                memset(padded, 0, sizeof(padded));
+                memcpy(padded, block, length - w * 64);
+                block = padded;
+            }
+            for (int t = 0; t < terminatorCount_; t++) {
+                masks[static_cast<size_t>(t) * words + w] = MatchMask64(block, terminators_[t]);
+            }
+        }
+        maskRows = masks;
+    }
+
+    size_t pos = 0;
+    for (const Element& element : elements_) {
+        if (element.literal) {
+            if (length - pos < element.text.size() || memcmp(line + pos, element.text.data(), element.text.size()) != 0) {
+                return false;
+            }
+            pos += element.text.size();
+            continue;
+        }
+
+        size_t end = length;
+        if (element.terminator >= 0) {
+            end = FindTerminator(line, length, maskRows, element.terminator, pos);
+            // Apache escapes quotes inside quoted fields as \"
+            while (end != SIZE_MAX && terminators_[element.terminator] == '"' && end > pos && line[end - 1] == '\\') {
+                end = FindTerminator(line, length, maskRows, element.terminator, end + 1);
+            }
+            if (end == SIZE_MAX) return false;
+        }
+        StoreField(element.kind, line + pos, end - pos, record);
+        pos = end;
+    }
+    return true;
+}
+
+} // namespace superpanel
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace superpanel {
+
+// One parsed access-log line. Views point into the mapped log data and are
+// only valid while the caller holds it. Fields missing from the format are
+// left empty / -1.
+struct AccessLogRecord {
+    std::string_view host;
+    std::string_view client;
+    std::string_view path;    // Request target without the query string
+    int status = -1;
+    long long bytes = 0;
+    long long latencyUs = -1;
+    long long timestamp = -1; // Unix seconds
+};
+
+// Parses lines written by an nginx log_format or an Apache LogFormat string,
+// e.g. `$remote_addr - $remote_user [$time_local] "$request" $status ...` or
+// `%h %l %u %t "%r" %>s %b`. The names "combined", "common" and
+// "vhost_combined" select the stock formats.
+//
+// A field ends at the first character of the literal that follows it. For
+// each line the parser builds a bitmask of every such terminator character in
+// 64-byte SIMD blocks, then walks the format jumping from set bit to set bit,
+// so no field is scanned byte by byte.
+class AccessLogParser {
+public:
+    // Returns false when the format cannot be parsed unambiguously (two fields
+    // with no literal between them).
+    bool SetFormat(const std::string& format);
+
+    bool HasHostField() const { return hasHost_; }
+
+    // Parses one line (without its '\n'). Returns false for lines that do not
+    // match the format.
+    bool Parse(const char* line, size_t length, AccessLogRecord& record) const;
+
+private:
+    enum class FieldKind {
+        Skip,
+        Host,
+        Client,
+        Request,      // "GET /path HTTP/1.1"
+        Uri,          // /path?query
+        Status,
+        Bytes,
+        Seconds,      // 0.123 (nginx $request_time)
+        Microseconds, // Apache %D
+        WholeSeconds, // Apache %T
+        TimeLocal,    // 10/Oct/2000:13:55:36 -0700
+        TimeIso8601,  // 2000-10-10T13:55:36-07:00
+        Msec          // 971211336.123
+    };
+
+    struct Element {
+        bool literal = false;
+        std::string text;  // Literal text
+        FieldKind kind = FieldKind::Skip;
+        int terminator = -1; // Index into terminators_, or -1 when the field runs to end of line
+    };
+
+    static const size_t MaxMaskedLine = 8192;
+    static const int MaxTerminators = 4;
+
+    void AddLiteral(const std::string& text);
+    void AddField(FieldKind kind);
+    bool Finish();
+    size_t FindTerminator(const char* line, size_t length, const uint64_t* masks, int terminator, size_t from) const;
+    void StoreField(FieldKind kind, const char* value, size_t length, AccessLogRecord& record) const;
+
+    std::vector<Element> elements_;
+    char terminators_[MaxTerminators] = {};
+    int terminatorCount_ = 0;
+    bool hasHost_ = false;
+};
+
+} // namespace superpanel
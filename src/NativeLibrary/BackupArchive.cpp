@@ -0,0 +1,581 @@
+#include "pch.h"
+#include "BackupArchive.h"
+#include "BackupFiles.h"
+#include "IoThrottle.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#ifdef _WIN32
+#pragma comment(lib, "zlib.lib")
+#endif
+
+using superpanel::OpenFile;
+using superpanel::SeekFile;
+using superpanel::SourceInfo;
+using superpanel::ThrottleBackupIo;
+using superpanel::ThreadPool;
+namespace fs = std::filesystem;
+
+namespace {
+
+const size_t BlockSize = 1024 * 1024;
+// Deflate's window: each block is primed with this much of the data before it
+const size_t DictionarySize = 32 * 1024;
+const long long DefaultMemoryBudget = 256LL * 1024 * 1024;
+// Entries this large get ZIP64 sizes up front, leaving headroom for the few
+// bytes per block deflate adds to incompressible data
+const uint64_t Zip64EntryThreshold = 0xF0000000ULL;
+const uint32_t Zip32Max = 0xFFFFFFFFu;
+
+const uint16_t MethodStored = 0;
+const uint16_t MethodDeflated = 8;
+const uint16_t FlagUtf8Names = 0x0800;
+const uint16_t VersionDefault = 20;
+const uint16_t VersionZip64 = 45;
+const uint16_t VersionMadeByUnix = (3 << 8) | VersionZip64;
+
+// Extensions whose content is already compressed; deflating them again costs
+// CPU for no gain, so they are stored
+bool IsPrecompressed(const std::string& name) {
+    static const char* const extensions[] = {
+        ".jpg", ".jpeg", ".png", ".gif", ".webp", ".avif", ".heic", ".mp3", ".mp4", ".m4a", ".m4v", ".mkv",
+        ".webm", ".ogg", ".mov", ".zip", ".gz", ".tgz", ".bz2", ".xz", ".zst", ".7z", ".rar", ".woff", ".woff2", ".br",
+    };
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos || name.size() - dot > 6) return false;
+    std::string extension = name.substr(dot);
+    for (char& c : extension) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    for (const char* candidate : extensions) {
+        if (extension == candidate) return true;
+    }
+    return false;
+}
+
+// MS-DOS date (high word) and time (low word) in local time
+uint32_t DosDateTime(time_t value) {
+    struct tm local;
+#ifdef _WIN32
+    if (localtime_s(&local, &value) != 0) return (1 << 21) | (1 << 16);
+#else
+    if (localtime_r(&value, &local) == nullptr) return (1 << 21) | (1 << 16);
+#endif
+    if (local.tm_year < 80) return (1 << 21) | (1 << 16); // 1980-01-01, the earliest DOS date
+    uint32_t date = static_cast<uint32_t>(((local.tm_year - 80) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+    uint32_t time = static_cast<uint32_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+    return (date << 16) | time;
+}
+
+void Put16(std::string& out, uint16_t value) {
+    char bytes[2] = {static_cast<char>(value), static_cast<char>(value >> 8)};
+    out.append(bytes, 2);
+}
+
+void Put32(std::string& out, uint32_t value) {
+    Put16(out, static_cast<uint16_t>(value));
+    Put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void Put64(std::string& out, uint64_t value) {
+    Put32(out, static_cast<uint32_t>(value));
+    Put32(out, static_cast<uint32_t>(value >> 32));
+}
+
+struct Entry {
+    std::string name; // Path inside the archive, '/'-separated; directories end in '/'
+    std::string sourcePath;
+    bool directory = false;
+    bool stored = false;
+    bool zip64 = false;
+    uint64_t size = 0;
+    uint32_t dosDateTime = 0;
+    uint32_t mode = 0;
+    // Filled in by the writer
+    uint64_t headerOffset = 0;
+    uint32_t crc = 0;
+    uint64_t compressedSize = 0;
+};
+
+struct Block {
+    Entry* entry = nullptr;
+    uint64_t offset = 0;
+    size_t length = 0;
+    bool first = false;
+    bool last = false;
+    std::vector<unsigned char> data; // Compressed (or stored) bytes
+    uint32_t crc = 0;
+    bool done = false;
+};
+
+// One raw-deflate stream per worker thread, reset between blocks
+class Deflater {
+public:
+    ~Deflater() {
+        if (initialised_) deflateEnd(&stream_);
+    }
+
+    z_stream* Get(int level) {
+        if (initialised_ && level_ != level) {
+            deflateEnd(&stream_);
+            initialised_ = false;
+        }
+        if (!initialised_) {
+            memset(&stream_, 0, sizeof(stream_));
+            if (deflateInit2(&stream_, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return nullptr;
+            initialised_ = true;
+            level_ = level;
+        } else {
+            deflateReset(&stream_);
+        }
+        return &stream_;
+    }
+
+private:
+    z_stream stream_;
+    bool initialised_ = false;
+    int level_ = 0;
+};
+
+struct ArchiveJob {
+    std::string archivePath;
+    std::vector<std::pair<std::string, std::string>> sources; // (path, prefix)
+    int level = Z_DEFAULT_COMPRESSION;
+    unsigned threadCount = 0;
+    size_t maxBlocksInFlight = 0;
+    FILE* output = nullptr;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> state{BACKUP_JOB_RUNNING};
+    std::atomic<long long> filesDone{0};
+    std::atomic<long long> bytesRead{0};
+    std::atomic<long long> bytesWritten{0};
+    std::atomic<long long> errors{0};
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<long long> elapsedMs{-1}; // Set once finished
+    // One reference for the worker thread, one for the caller's handle
+    std::atomic<int> refs{2};
+
+    // Entries in archive order; a deque so pointers stay valid as it grows
+    std::deque<Entry> entries;
+
+    // Blocks in archive order, from scheduling until the writer has them out
+    std::mutex queueLock;
+    std::condition_variable queueChanged;
+    std::deque<std::unique_ptr<Block>> pending;
+    bool producerDone = false;
+
+    uint64_t outputOffset = 0;
+    bool writeFailed = false;
+};
+
+void DropJobReference(ArchiveJob* job) {
+    if (job->refs.fetch_sub(1) == 1) delete job;
+}
+
+bool ReadRange(const std::string& path, uint64_t offset, unsigned char* target, size_t length) {
+    FILE* file = OpenFile(path, "rb");
+    if (file == nullptr) return false;
+    setvbuf(file, nullptr, _IONBF, 0);
+    bool ok = SeekFile(file, offset) && fread(target, 1, length, file) == length;
+    fclose(file);
+    return ok;
+}
+
+void CompressBlock(ArchiveJob& job, Block& block) {
+    static thread_local Deflater deflater;
+    Entry& entry = *block.entry;
+    ThrottleBackupIo(block.length, job.cancelled);
+
+    if (entry.stored) {
+        block.data.resize(block.length);
+        if (!ReadRange(entry.sourcePath, block.offset, block.data.data(), block.length)) {
+            // Keep the promised size; the file changed or vanished under us
+            std::fill(block.data.begin(), block.data.end(), 0);
+            job.errors++;
+        }
+        block.crc = static_cast<uint32_t>(crc32(0, block.data.data(), static_cast<uInt>(block.length)));
+    } else {
+        size_t dictionary = static_cast<size_t>(std::min<uint64_t>(block.offset, DictionarySize));
+        std::vector<unsigned char> input(dictionary + block.length);
+        if (!ReadRange(entry.sourcePath, block.offset - dictionary, input.data(), input.size())) {
+            std::fill(input.begin(), input.end(), 0);
+            job.errors++;
+        }
+        const unsigned char* data = input.data() + dictionary;
+        block.crc = static_cast<uint32_t>(crc32(0, data, static_cast<uInt>(block.length)));
+
+        z_stream* stream = deflater.Get(job.level);
+        if (stream == nullptr) {
+            job.errors++;
+            job.cancelled = true;
+            return;
+        }
+        if (dictionary > 0) deflateSetDictionary(stream, input.data(), static_cast<uInt>(dictionary));
+
+        // Non-final blocks end with a sync flush: byte-aligned, not marked last
+        block.data.resize(deflateBound(stream, static_cast<uLong>(block.length)) + 16);
+        stream->next_in = const_cast<unsigned char*>(data);
+        stream->avail_in = static_cast<uInt>(block.length);
+        stream->next_out = block.data.data();
+        stream->avail_out = static_cast<uInt>(block.data.size());
+        const int flush = block.last ? Z_FINISH : Z_SYNC_FLUSH;
+        while (true) {
+            int result = deflate(stream, flush);
+            bool finished = block.last ? result == Z_STREAM_END : stream->avail_in == 0 && stream->avail_out > 0;
+            if (finished || (result != Z_OK && result != Z_BUF_ERROR)) break;
+            size_t used = block.data.size() - stream->avail_out;
+            block.data.resize(block.data.size() * 2);
+            stream->next_out = block.data.data() + used;
+            stream->avail_out = static_cast<uInt>(block.data.size() - used);
+        }
+        block.data.resize(stream->total_out);
+    }
+
+    job.bytesRead += static_cast<long long>(block.length);
+}
+
+bool WriteOutput(ArchiveJob& job, const void* data, size_t length) {
+    if (length == 0) return true;
+    if (fwrite(data, 1, length, job.output) != length) {
+        job.writeFailed = true;
+        return false;
+    }
+    job.outputOffset += length;
+    job.bytesWritten += static_cast<long long>(length);
+    return true;
+}
+
+void WriteLocalHeader(ArchiveJob& job, Entry& entry, bool sizesKnown) {
+    entry.headerOffset = job.outputOffset;
+
+    std::string header;
+    Put32(header, 0x04034b50);
+    Put16(header, entry.zip64 ? VersionZip64 : VersionDefault);
+    Put16(header, FlagUtf8Names);
+    Put16(header, entry.stored ? MethodStored : MethodDeflated);
+    Put32(header, entry.dosDateTime);
+    Put32(header, sizesKnown ? entry.crc : 0);
+    if (entry.zip64) {
+        Put32(header, Zip32Max);
+        Put32(header, Zip32Max);
+    } else {
+        Put32(header, sizesKnown ? static_cast<uint32_t>(entry.compressedSize) : 0);
+        Put32(header, static_cast<uint32_t>(entry.size));
+    }
+    Put16(header, static_cast<uint16_t>(entry.name.size()));
+    Put16(header, entry.zip64 ? 20 : 0);
+    header += entry.name;
+    if (entry.zip64) {
+        Put16(header, 0x0001);
+        Put16(header, 16);
+        Put64(header, entry.size);
+        Put64(header, sizesKnown ? entry.compressedSize : 0);
+    }
+    WriteOutput(job, header.data(), header.size());
+}
+
+// Fills in CRC and compressed size once the last block of a streamed entry is out
+void PatchLocalHeader(ArchiveJob& job, const Entry& entry) {
+    std::string crc;
+    Put32(crc, entry.crc);
+    std::string compressed;
+    if (entry.zip64) Put64(compressed, entry.compressedSize);
+    else Put32(compressed, static_cast<uint32_t>(entry.compressedSize));
+    uint64_t compressedOffset = entry.zip64 ? entry.headerOffset + 30 + entry.name.size() + 12 : entry.headerOffset + 18;
+
+    bool ok = fflush(job.output) == 0 &&
+              SeekFile(job.output, entry.headerOffset + 14) && fwrite(crc.data(), 1, crc.size(), job.output) == crc.size() &&
+              SeekFile(job.output, compressedOffset) && fwrite(compressed.data(), 1, compressed.size(), job.output) == compressed.size() &&
+              fflush(job.output) == 0 && SeekFile(job.output, job.outputOffset);
+    if (!ok) job.writeFailed = true;
+}
+
+void WriterLoop(ArchiveJob& job) {
+    while (true) {
+        std::unique_ptr<Block> block;
+        {
+            std::unique_lock<std::mutex> guard(job.queueLock);
+            job.queueChanged.wait(guard, [&] { return (!job.pending.empty() && job.pending.front()->done) || (job.producerDone && job.pending.empty()); });
+            if (job.pending.empty()) return;
+            block = std::move(job.pending.front());
+            job.pending.pop_front();
+        }
+        // Frees a slot for the scheduler
+        job.queueChanged.notify_all();
+
+        if (job.writeFailed || job.cancelled) continue;
+
+        Entry& entry = *block->entry;
+        if (block->first) {
+            entry.crc = block->crc;
+            entry.compressedSize = block->data.size();
+            // Single-block entries (most files) get a complete header right away
+            WriteLocalHeader(job, entry, block->last);
+        } else {
+            entry.crc = static_cast<uint32_t>(crc32_combine(entry.crc, block->crc, static_cast<z_off_t>(block->length)));
+            entry.compressedSize += block->data.size();
+        }
+        WriteOutput(job, block->data.data(), block->data.size());
+
+        if (block->last) {
+            if (!block->first) PatchLocalHeader(job, entry);
+            job.filesDone++;
+        }
+    }
+}
+
+bool WriteCentralDirectory(ArchiveJob& job) {
+    const uint64_t directoryOffset = job.outputOffset;
+    std::string record;
+
+    for (const Entry& entry : job.entries) {
+        record.clear();
+        bool sizes64 = entry.zip64;
+        bool offset64 = entry.headerOffset >= Zip32Max;
+        std::string extra;
+        if (sizes64) {
+            Put64(extra, entry.size);
+            Put64(extra, entry.compressedSize);
+        }
+        if (offset64) Put64(extra, entry.headerOffset);
+        if (!extra.empty()) {
+            std::string field;
+            Put16(field, 0x0001);
+            Put16(field, static_cast<uint16_t>(extra.size()));
+            extra = field + extra;
+        }
+
+        uint32_t external = (entry.mode & 0xFFFF) << 16;
+        if (entry.directory) external |= 0x10; // MS-DOS directory attribute
+
+        Put32(record, 0x02014b50);
+        Put16(record, VersionMadeByUnix);
+        Put16(record, sizes64 || offset64 ? VersionZip64 : VersionDefault);
+        Put16(record, FlagUtf8Names);
+        Put16(record, entry.stored ? MethodStored : MethodDeflated);
+        Put32(record, entry.dosDateTime);
+        Put32(record, entry.crc);
+        Put32(record, sizes64 ? Zip32Max : static_cast<uint32_t>(entry.compressedSize));
+        Put32(record, sizes64 ? Zip32Max : static_cast<uint32_t>(entry.size));
+        Put16(record, static_cast<uint16_t>(entry.name.size()));
+        Put16(record, static_cast<uint16_t>(extra.size()));
+        Put16(record, 0); // Comment
+        Put16(record, 0); // Disk
+        Put16(record, 0); // Internal attributes
+        Put32(record, external);
+        Put32(record, offset64 ? Zip32Max : static_cast<uint32_t>(entry.headerOffset));
+        record += entry.name;
+        record += extra;
+        if (!WriteOutput(job, record.data(), record.size())) return false;
+    }
+
+    const uint64_t directorySize = job.outputOffset - directoryOffset;
+    const uint64_t count = job.entries.size();
+    record.clear();
+
+    if (count >= 0xFFFF || directoryOffset >= Zip32Max || directorySize >= Zip32Max) {
+        const uint64_t zip64RecordOffset = job.outputOffset;
+        Put32(record, 0x06064b50);
+        Put64(record, 44); // Size of the rest of this record
+        Put16(record, VersionMadeByUnix);
+        Put16(record, VersionZip64);
+        Put32(record, 0);
+        Put32(record, 0);
+        Put64(record, count);
+        Put64(record, count);
+        Put64(record, directorySize);
+        Put64(record, directoryOffset);
+
+        Put32(record, 0x07064b50); // ZIP64 end of central directory locator
+        Put32(record, 0);
+        Put64(record, zip64RecordOffset);
+        Put32(record, 1);
+    }
+
+    Put32(record, 0x06054b50);
+    Put16(record, 0);
+    Put16(record, 0);
+    Put16(record, static_cast<uint16_t>(std::min<uint64_t>(count, 0xFFFF)));
+    Put16(record, static_cast<uint16_t>(std::min<uint64_t>(count, 0xFFFF)));
+    Put32(record, static_cast<uint32_t>(std::min<uint64_t>(directorySize, Zip32Max)));
+    Put32(record, static_cast<uint32_t>(std::min<uint64_t>(directoryOffset, Zip32Max)));
+    Put16(record, 0);
+    return WriteOutput(job, record.data(), record.size());
+}
+
+void ScheduleEntry(ArchiveJob& job, ThreadPool& pool, Entry&& value) {
+    job.entries.push_back(std::move(value));
+    Entry* entry = &job.entries.back();
+
+    const uint64_t size = entry->directory ? 0 : entry->size;
+    const uint64_t blockCount = size == 0 ? 1 : (size + BlockSize - 1) / BlockSize;
+
+    for (uint64_t i = 0; i < blockCount; i++) {
+        auto block = std::make_unique<Block>();
+        block->entry = entry;
+        block->offset = i * BlockSize;
+        block->length = static_cast<size_t>(std::min<uint64_t>(BlockSize, size - block->offset));
+        block->first = i == 0;
+        block->last = i == blockCount - 1;
+        // An empty block is done as soon as it is queued, and the writer may
+        // free it before this thread looks at it again
+        const bool empty = block->length == 0;
+        block->done = empty;
+        Block* raw = block.get();
+
+        {
+            // Bounded memory: wait for the writer to retire a block first
+            std::unique_lock<std::mutex> guard(job.queueLock);
+            job.queueChanged.wait(guard, [&] { return job.pending.size() < job.maxBlocksInFlight || job.cancelled || job.writeFailed; });
+            if (job.cancelled || job.writeFailed) return;
+            job.pending.push_back(std::move(block));
+        }
+
+        if (empty) {
+            job.queueChanged.notify_all();
+            continue;
+        }
+        pool.Submit([&job, raw] {
+            CompressBlock(job, *raw);
+            {
+                std::lock_guard<std::mutex> guard(job.queueLock);
+                raw->done = true;
+            }
+            job.queueChanged.notify_all();
+        });
+    }
+}
+
+bool MakeEntry(const fs::path& path, const std::string& name, const SourceInfo& info, Entry& entry) {
+    entry.sourcePath = path.u8string();
+    entry.directory = info.directory;
+    entry.name = info.directory ? name + "/" : name;
+    entry.size = info.directory ? 0 : info.size;
+    entry.stored = info.directory || info.size == 0 || IsPrecompressed(name);
+    entry.zip64 = entry.size >= Zip64EntryThreshold;
+    entry.dosDateTime = DosDateTime(info.modified);
+    entry.mode = info.mode;
+    return entry.name.size() < 0xFFFF;
+}
+
+void AddSource(ArchiveJob& job, ThreadPool& pool, const std::string& source, const std::string& prefix) {
+    job.errors += superpanel::WalkSource(source, prefix, [&](const fs::path& path, const std::string& name, const SourceInfo& info) {
+        Entry entry;
+        if (MakeEntry(path, name, info, entry)) ScheduleEntry(job, pool, std::move(entry));
+        return !job.cancelled && !job.writeFailed;
+    });
+}
+
+void RunArchive(ArchiveJob& job) {
+    {
+        ThreadPool pool(job.threadCount);
+        std::thread writer(WriterLoop, std::ref(job));
+
+        for (const auto& source : job.sources) {
+            if (job.cancelled || job.writeFailed) break;
+            AddSource(job, pool, source.first, source.second);
+        }
+
+        pool.WaitIdle();
+        {
+            std::lock_guard<std::mutex> guard(job.queueLock);
+            job.producerDone = true;
+        }
+        job.queueChanged.notify_all();
+        writer.join();
+    }
+
+    bool ok = !job.cancelled && !job.writeFailed && WriteCentralDirectory(job);
+    ok = fclose(job.output) == 0 && ok;
+    job.output = nullptr;
+    if (!ok) {
+        std::error_code ec;
+        fs::remove(fs::u8path(job.archivePath), ec);
+    }
+
+    job.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job.started).count();
+    job.state = ok ? BACKUP_JOB_COMPLETED : (job.cancelled ? BACKUP_JOB_CANCELLED : BACKUP_JOB_FAILED);
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* WriteBackupArchiveAsync(const char* archivePath, const char* const* sources, const char* const* prefixes, int sourceCount,
+                                             int compressionLevel, int threadCount, long long memoryBudget) {
+    if (archivePath == NULL || archivePath[0] == '\0' || sources == NULL || sourceCount <= 0) return NULL;
+
+    auto* job = new ArchiveJob();
+    job->archivePath = archivePath;
+    for (int i = 0; i < sourceCount; i++) {
+        if (sources[i] == NULL || sources[i][0] == '\0') continue;
+        job->sources.emplace_back(sources[i], prefixes != NULL && prefixes[i] != NULL ? prefixes[i] : "");
+    }
+    job->level = compressionLevel > 0 ? std::min(compressionLevel, 9) : 6;
+    job->threadCount = threadCount > 0 ? static_cast<unsigned>(threadCount) : ThreadPool::DefaultThreadCount();
+
+    // Each block in flight holds its input (plus dictionary) and its output
+    long long budget = memoryBudget > 0 ? memoryBudget : DefaultMemoryBudget;
+    size_t perBlock = 2 * BlockSize + DictionarySize;
+    job->maxBlocksInFlight = std::max(static_cast<size_t>(budget) / perBlock, static_cast<size_t>(job->threadCount) + 1);
+
+    job->output = OpenFile(job->archivePath, "wb");
+    if (job->output == nullptr) {
+        delete job;
+        return NULL;
+    }
+    setvbuf(job->output, nullptr, _IOFBF, BlockSize);
+
+    std::thread([job] {
+        RunArchive(*job);
+        DropJobReference(job);
+    }).detach();
+    return job;
+}
+
+SUPERPANEL_API int GetBackupArchiveProgress(void* handle, BackupArchiveProgress* progress) {
+    if (handle == NULL) return BACKUP_JOB_FAILED;
+    auto* job = static_cast<ArchiveJob*>(handle);
+    if (progress != NULL) {
+        progress->filesDone = job->filesDone;
+        progress->bytesRead = job->bytesRead;
+        progress->bytesWritten = job->bytesWritten;
+        progress->errors = job->errors;
+        long long elapsed = job->elapsedMs;
+        progress->elapsedMs = elapsed >= 0
+            ? elapsed
+            : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job->started).count();
+    }
+    return job->state;
+}
+
+SUPERPANEL_API void CancelBackupArchive(void* handle) {
+    if (handle == NULL) return;
+    auto* job = static_cast<ArchiveJob*>(handle);
+    {
+        std::lock_guard<std::mutex> guard(job->queueLock);
+        job->cancelled = true;
+    }
+    job->queueChanged.notify_all();
+}
+
+SUPERPANEL_API void ReleaseBackupArchive(void* handle) {
+    if (handle == NULL) return;
+    DropJobReference(static_cast<ArchiveJob*>(handle));
+}
+
+} // extern "C"
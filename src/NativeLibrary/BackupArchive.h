@@ -0,0 +1,42 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Job states reported by the backup archive jobs
+#define BACKUP_JOB_RUNNING   0
+#define BACKUP_JOB_COMPLETED 1
+#define BACKUP_JOB_FAILED    2
+#define BACKUP_JOB_CANCELLED 3
+
+struct BackupArchiveProgress {
+    long long filesDone;
+    long long bytesRead;    // Uncompressed source bytes processed
+    long long bytesWritten; // Archive bytes written
+    long long elapsedMs;
+    long long errors;       // Files that could not be read (or changed size) while archiving
+};
+
+extern "C" {
+    // Streams source files and directories straight into a ZIP archive with no
+    // staging copy. Files are cut into 1 MB blocks that are read and deflated
+    // in parallel (pigz-style: each block is primed with the previous 32 KB as
+    // its dictionary and ends on a byte boundary, so the blocks concatenate
+    // into one ordinary deflate stream) while a writer thread emits them in
+    // order. Memory stays within memoryBudget bytes however large the tree;
+    // media and already-compressed files are stored. Archives larger than
+    // 4 GB or with more than 65535 entries use ZIP64, so the output opens with
+    // any zip reader, including System.IO.Compression.
+    //
+    // sources[i] (a file or directory) is stored under prefixes[i] ("" or NULL
+    // for the archive root). compressionLevel is the zlib level (1-9, <= 0 for
+    // the default 6); threadCount and memoryBudget <= 0 pick defaults. Returns
+    // a job handle, or NULL if the archive cannot be created.
+    SUPERPANEL_API void* WriteBackupArchiveAsync(const char* archivePath, const char* const* sources, const char* const* prefixes, int sourceCount,
+                                                 int compressionLevel, int threadCount, long long memoryBudget);
+    SUPERPANEL_API int GetBackupArchiveProgress(void* handle, BackupArchiveProgress* progress);
+    // A cancelled job deletes the partial archive.
+    SUPERPANEL_API void CancelBackupArchive(void* handle);
+    // Releases the caller's reference. A job that is still running keeps going
+    // and frees itself when it finishes.
+    SUPERPANEL_API void ReleaseBackupArchive(void* handle);
+}
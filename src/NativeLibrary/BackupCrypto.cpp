@@ -0,0 +1,308 @@
+#include "pch.h"
+#include "BackupCrypto.h"
+#include "BackupFiles.h"
+#include "IoThrottle.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
+
+#ifdef _WIN32
+#include <intrin.h>
+#pragma comment(lib, "libcrypto.lib")
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+using superpanel::MappedFile;
+using superpanel::OpenFile;
+using superpanel::SeekFile;
+using superpanel::ThreadPool;
+using superpanel::ThrottleBackupIo;
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t CryptoMagic = 0x45415053; // "SPAE"
+const uint16_t CryptoVersion = 1;
+const uint32_t ChunkSize = 1024 * 1024;
+const size_t TagSize = 16;
+const size_t KeySize = 32;
+// Chunks per pool task: enough to amortise opening the output, few enough
+// that the last tasks finish together
+const uint64_t ChunksPerTask = 8;
+
+struct CryptoHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t cipher;
+    uint32_t chunkSize;
+    uint32_t reserved;
+    uint64_t plaintextSize;
+    unsigned char salt[32];
+    uint64_t reserved2;
+};
+
+static_assert(sizeof(CryptoHeader) == 64, "crypto header layout");
+
+bool HasAesInstructions() {
+#if defined(_M_X64) || defined(_M_IX86)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) != 0 && (info[2] & (1 << 1)) != 0;
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    return __get_cpuid(1, &a, &b, &c, &d) != 0 && (c & bit_AES) != 0 && (c & bit_PCLMUL) != 0;
+#elif defined(__aarch64__) && defined(__linux__)
+    unsigned long caps = getauxval(AT_HWCAP);
+    return (caps & HWCAP_AES) != 0 && (caps & HWCAP_PMULL) != 0;
+#else
+    return false;
+#endif
+}
+
+const EVP_CIPHER* CipherFor(int cipher) {
+    switch (cipher) {
+        case BACKUP_CIPHER_AES_256_GCM: return EVP_aes_256_gcm();
+        case BACKUP_CIPHER_CHACHA20_POLY1305: return EVP_chacha20_poly1305();
+        default: return nullptr;
+    }
+}
+
+bool DeriveFileKey(const unsigned char* masterKey, const unsigned char* salt, size_t saltLength, unsigned char* fileKey) {
+    static const char info[] = "superpanel backup encryption v1";
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    size_t length = KeySize;
+    bool ok = ctx != nullptr && EVP_PKEY_derive_init(ctx) > 0 && EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) > 0 &&
+              EVP_PKEY_CTX_set1_hkdf_salt(ctx, salt, static_cast<int>(saltLength)) > 0 &&
+              EVP_PKEY_CTX_set1_hkdf_key(ctx, masterKey, static_cast<int>(KeySize)) > 0 &&
+              EVP_PKEY_CTX_add1_hkdf_info(ctx, reinterpret_cast<const unsigned char*>(info), static_cast<int>(sizeof(info) - 1)) > 0 &&
+              EVP_PKEY_derive(ctx, fileKey, &length) > 0 && length == KeySize;
+    EVP_PKEY_CTX_free(ctx);
+    return ok;
+}
+
+uint64_t ChunkCount(uint64_t plaintextSize) {
+    // An empty file still gets one (empty) chunk, so its header is authenticated
+    return std::max<uint64_t>((plaintextSize + ChunkSize - 1) / ChunkSize, 1);
+}
+
+uint64_t SealedSize(uint64_t plaintextSize) {
+    return sizeof(CryptoHeader) + plaintextSize + ChunkCount(plaintextSize) * TagSize;
+}
+
+struct CryptoJob {
+    bool encrypt = true;
+    std::string outputPath;
+    unsigned threadCount = 0;
+    MappedFile input;
+    CryptoHeader header;
+    unsigned char key[KeySize]; // Per-file key
+    const EVP_CIPHER* cipher = nullptr;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> failed{false};
+    std::atomic<int> state{BACKUP_JOB_RUNNING};
+    std::atomic<long long> bytesTotal{0};
+    std::atomic<long long> bytesDone{0};
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<long long> elapsedMs{-1}; // Set once finished
+    // One reference for the worker thread, one for the caller's handle
+    std::atomic<int> refs{2};
+
+    ~CryptoJob() { OPENSSL_cleanse(key, sizeof(key)); }
+};
+
+void DropJobReference(CryptoJob* job) {
+    if (job->refs.fetch_sub(1) == 1) delete job;
+}
+
+bool Stopped(const CryptoJob& job) {
+    return job.cancelled || job.failed;
+}
+
+// Seals (or opens and verifies) one chunk. The nonce is the chunk index and
+// the header is authenticated with every chunk, binding each chunk to its
+// position, the file's size and its salt.
+bool TransformChunk(CryptoJob& job, EVP_CIPHER_CTX* ctx, uint64_t index, const unsigned char* in, size_t length, unsigned char* out,
+                    unsigned char* tag) {
+    unsigned char nonce[12] = {0};
+    for (int i = 0; i < 8; i++) nonce[4 + i] = static_cast<unsigned char>(index >> (56 - 8 * i));
+    static const unsigned char empty = 0;
+    if (in == nullptr) in = &empty;
+
+    int produced = 0, last = 0;
+    const int encrypt = job.encrypt ? 1 : 0;
+    if (EVP_CipherInit_ex(ctx, job.cipher, nullptr, job.key, nonce, encrypt) <= 0 ||
+        EVP_CipherUpdate(ctx, nullptr, &produced, reinterpret_cast<const unsigned char*>(&job.header), sizeof(job.header)) <= 0 ||
+        EVP_CipherUpdate(ctx, out, &produced, in, static_cast<int>(length)) <= 0) {
+        return false;
+    }
+    if (!job.encrypt && EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_SET_TAG, static_cast<int>(TagSize), tag) <= 0) return false;
+    if (EVP_CipherFinal_ex(ctx, out + produced, &last) <= 0) return false; // Authentication failure on decrypt
+    return !job.encrypt || EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_AEAD_GET_TAG, static_cast<int>(TagSize), tag) > 0;
+}
+
+void ProcessChunks(CryptoJob& job, uint64_t first, uint64_t count) {
+    if (Stopped(job)) return;
+
+    const auto* data = reinterpret_cast<const unsigned char*>(job.input.Data());
+    const uint64_t plaintextSize = job.header.plaintextSize;
+    const uint64_t sealedChunk = ChunkSize + TagSize;
+    // Chunks are contiguous on both sides, so each task seeks once
+    uint64_t outputOffset = job.encrypt ? sizeof(CryptoHeader) + first * sealedChunk : first * ChunkSize;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    FILE* output = OpenFile(job.outputPath, "r+b");
+    bool ok = ctx != nullptr && output != nullptr && SeekFile(output, outputOffset);
+    if (ok) setvbuf(output, nullptr, _IONBF, 0);
+
+    std::vector<unsigned char> buffer(sealedChunk);
+    for (uint64_t index = first; ok && index < first + count && !Stopped(job); index++) {
+        const size_t length = static_cast<size_t>(std::min<uint64_t>(ChunkSize, plaintextSize - std::min(plaintextSize, index * ChunkSize)));
+        ThrottleBackupIo(length, job.cancelled);
+        if (job.encrypt) {
+            const unsigned char* in = data != nullptr ? data + index * ChunkSize : nullptr;
+            ok = TransformChunk(job, ctx, index, in, length, buffer.data(), buffer.data() + length) &&
+                 fwrite(buffer.data(), 1, length + TagSize, output) == length + TagSize;
+            job.bytesDone += static_cast<long long>(length);
+        } else {
+            const unsigned char* in = data + sizeof(CryptoHeader) + index * sealedChunk;
+            unsigned char tag[TagSize];
+            memcpy(tag, in + length, TagSize);
+            ok = TransformChunk(job, ctx, index, in, length, buffer.data(), tag) &&
+                 fwrite(buffer.data(), 1, length, output) == length;
+            job.bytesDone += static_cast<long long>(length + TagSize);
+        }
+    }
+
+    if (output != nullptr && fclose(output) != 0) ok = false;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) job.failed = true;
+}
+
+void RunCrypto(CryptoJob& job) {
+    const uint64_t plaintextSize = job.header.plaintextSize;
+    const uint64_t outputSize = job.encrypt ? SealedSize(plaintextSize) : plaintextSize;
+
+    // Sized up front so every task can write its chunks in place
+    FILE* output = OpenFile(job.outputPath, "wb");
+    bool ok = output != nullptr;
+    if (ok && job.encrypt) ok = fwrite(&job.header, 1, sizeof(job.header), output) == sizeof(job.header);
+    if (output != nullptr && fclose(output) != 0) ok = false;
+    std::error_code ec;
+    if (ok) fs::resize_file(fs::u8path(job.outputPath), outputSize, ec);
+    if (!ok || ec) job.failed = true;
+
+    if (!Stopped(job)) {
+        job.input.AdviseSequential();
+        ThreadPool pool(job.threadCount);
+        const uint64_t chunks = ChunkCount(plaintextSize);
+        for (uint64_t first = 0; first < chunks; first += ChunksPerTask) {
+            uint64_t count = std::min(ChunksPerTask, chunks - first);
+            pool.Submit([&job, first, count] { ProcessChunks(job, first, count); });
+        }
+        pool.WaitIdle();
+    }
+
+    job.input.Close();
+    ok = !Stopped(job);
+    // Never leave partially decrypted (unauthenticated) data behind
+    if (!ok) fs::remove(fs::u8path(job.outputPath), ec);
+
+    job.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job.started).count();
+    job.state = ok ? BACKUP_JOB_COMPLETED : (job.cancelled ? BACKUP_JOB_CANCELLED : BACKUP_JOB_FAILED);
+}
+
+CryptoJob* StartJob(bool encrypt, const char* inputPath, const char* outputPath, const unsigned char* key, int keyLength, int threadCount) {
+    if (inputPath == NULL || outputPath == NULL || outputPath[0] == '\0' || key == NULL || keyLength != static_cast<int>(KeySize)) return NULL;
+
+    auto* job = new CryptoJob();
+    job->encrypt = encrypt;
+    job->outputPath = outputPath;
+    job->threadCount = threadCount > 0 ? static_cast<unsigned>(threadCount) : ThreadPool::DefaultThreadCount();
+    memset(&job->header, 0, sizeof(job->header));
+
+    bool ok = job->input.Open(inputPath);
+    if (ok && encrypt) {
+        job->header.magic = CryptoMagic;
+        job->header.version = CryptoVersion;
+        job->header.cipher = HasAesInstructions() ? BACKUP_CIPHER_AES_256_GCM : BACKUP_CIPHER_CHACHA20_POLY1305;
+        job->header.chunkSize = ChunkSize;
+        job->header.plaintextSize = job->input.Size();
+        ok = RAND_bytes(job->header.salt, sizeof(job->header.salt)) == 1;
+    } else if (ok) {
+        const uint64_t size = job->input.Size();
+        ok = size >= sizeof(CryptoHeader);
+        if (ok) memcpy(&job->header, job->input.Data(), sizeof(job->header));
+        ok = ok && job->header.magic == CryptoMagic && job->header.version == CryptoVersion && job->header.chunkSize == ChunkSize &&
+             job->header.plaintextSize <= size && SealedSize(job->header.plaintextSize) == size;
+    }
+    job->cipher = ok ? CipherFor(job->header.cipher) : nullptr;
+    if (job->cipher == nullptr || !DeriveFileKey(key, job->header.salt, sizeof(job->header.salt), job->key)) {
+        delete job;
+        return NULL;
+    }
+    job->bytesTotal = static_cast<long long>(job->input.Size());
+
+    std::thread([job] {
+        RunCrypto(*job);
+        DropJobReference(job);
+    }).detach();
+    return job;
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* EncryptBackupFileAsync(const char* inputPath, const char* outputPath, const unsigned char* key, int keyLength,
+                                            int threadCount) {
+    return StartJob(true, inputPath, outputPath, key, keyLength, threadCount);
+}
+
+SUPERPANEL_API void* DecryptBackupFileAsync(const char* inputPath, const char* outputPath, const unsigned char* key, int keyLength,
+                                            int threadCount) {
+    return StartJob(false, inputPath, outputPath, key, keyLength, threadCount);
+}
+
+SUPERPANEL_API int GetBackupCryptoProgress(void* handle, BackupCryptoProgress* progress) {
+    if (handle == NULL) return BACKUP_JOB_FAILED;
+    auto* job = static_cast<CryptoJob*>(handle);
+    if (progress != NULL) {
+        progress->bytesTotal = job->bytesTotal;
+        progress->bytesDone = job->bytesDone;
+        progress->cipher = job->header.cipher;
+        long long elapsed = job->elapsedMs;
+        progress->elapsedMs = elapsed >= 0
+            ? elapsed
+            : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job->started).count();
+    }
+    return job->state;
+}
+
+SUPERPANEL_API void CancelBackupCrypto(void* handle) {
+    if (handle == NULL) return;
+    static_cast<CryptoJob*>(handle)->cancelled = true;
+}
+
+SUPERPANEL_API void ReleaseBackupCrypto(void* handle) {
+    if (handle == NULL) return;
+    DropJobReference(static_cast<CryptoJob*>(handle));
+}
+
+} // extern "C"
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include "BackupArchive.h" // BACKUP_JOB_* states
+
+// AEAD ciphers of the encrypted backup format
+#define BACKUP_CIPHER_AES_256_GCM       1
+#define BACKUP_CIPHER_CHACHA20_POLY1305 2
+
+struct BackupCryptoProgress {
+    long long bytesTotal; // Input size
+    long long bytesDone;  // Input bytes processed
+    long long elapsedMs;
+    long long cipher;     // BACKUP_CIPHER_* in use
+};
+
+extern "C" {
+    // Encrypts a file (normally a finished backup archive) into the SPAE
+    // format: a header with a random salt, then the data in 1 MB chunks, each
+    // sealed with its own nonce and tag. A per-file key is derived from key
+    // (32 bytes) and the salt with HKDF-SHA256, so chunk nonces are just the
+    // chunk index and never repeat under a key. Because every chunk sits at a
+    // fixed offset, chunks are encrypted and written in parallel with no
+    // reordering, and throughput scales with cores. AES-256-GCM is used where
+    // the CPU has AES instructions (AES-NI/PCLMULQDQ, ARMv8 AES/PMULL), and
+    // ChaCha20-Poly1305, which is faster in software, everywhere else.
+    //
+    // threadCount <= 0 picks the default. Returns a job handle, or NULL if the
+    // input cannot be opened. A failed or cancelled job deletes the output.
+    SUPERPANEL_API void* EncryptBackupFileAsync(const char* inputPath, const char* outputPath, const unsigned char* key, int keyLength,
+                                                int threadCount);
+    // Reverses EncryptBackupFileAsync. Every chunk is authenticated against
+    // the header (so truncation, reordering and edits are detected); on any
+    // mismatch the job fails and the partial output is deleted.
+    SUPERPANEL_API void* DecryptBackupFileAsync(const char* inputPath, const char* outputPath, const unsigned char* key, int keyLength,
+                                                int threadCount);
+    SUPERPANEL_API int GetBackupCryptoProgress(void* handle, BackupCryptoProgress* progress);
+    SUPERPANEL_API void CancelBackupCrypto(void* handle);
+    // Releases the caller's reference; a running job frees itself when done.
+    SUPERPANEL_API void ReleaseBackupCrypto(void* handle);
+}
@@ -0,0 +1,381 @@
+#include "pch.h"
+#include "BackupExtract.h"
+#include "BackupFiles.h"
+#include "IoThrottle.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "ZipDirectory.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <zlib.h>
+
+#ifdef _WIN32
+#pragma comment(lib, "zlib.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using superpanel::MappedFile;
+using superpanel::OpenFile;
+using superpanel::SafeRelativeName;
+using superpanel::ThreadPool;
+using superpanel::ThrottleBackupIo;
+using superpanel::ZipEntry;
+namespace fs = std::filesystem;
+
+namespace {
+
+const size_t BufferSize = 1024 * 1024;
+
+const uint16_t MethodStored = 0;
+const uint16_t MethodDeflated = 8;
+const uint16_t FlagEncrypted = 0x0001;
+
+// One raw-inflate stream per worker thread, reset between entries
+class Inflater {
+public:
+    ~Inflater() {
+        if (initialised_) inflateEnd(&stream_);
+    }
+
+    z_stream* Get() {
+        if (!initialised_) {
+            memset(&stream_, 0, sizeof(stream_));
+            if (inflateInit2(&stream_, -15) != Z_OK) return nullptr;
+            initialised_ = true;
+        } else {
+            inflateReset(&stream_);
+        }
+        return &stream_;
+    }
+
+private:
+    z_stream stream_;
+    bool initialised_ = false;
+};
+
+// Output file written by a single worker. On Linux it is preallocated with
+// fallocate, so large restores do not fragment, and its metadata is set
+// through the descriptor rather than by path.
+class OutputFile {
+public:
+    ~OutputFile() { Close(); }
+
+    bool Open(const fs::path& path, uint64_t size) {
+#ifdef _WIN32
+        (void)size;
+        file_ = OpenFile(path.u8string(), "wb");
+        if (file_ != nullptr) setvbuf(file_, nullptr, _IONBF, 0);
+        return file_ != nullptr;
+#else
+        fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (fd_ < 0) return false;
+        // Not posix_fallocate: where the filesystem cannot preallocate, glibc
+        // emulates it by writing zeros, doubling the I/O
+        if (size > 0) (void)fallocate(fd_, 0, 0, static_cast<off_t>(size));
+        return true;
+#endif
+    }
+
+    bool Write(const unsigned char* data, size_t length) {
+#ifdef _WIN32
+        return fwrite(data, 1, length, file_) == length;
+#else
+        while (length > 0) {
+            ssize_t written = write(fd_, data, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+        return true;
+#endif
+    }
+
+    void SetMetadata(uint32_t mode, time_t modified) {
+#ifdef _WIN32
+        (void)mode;
+        (void)modified;
+#else
+        if (mode != 0) fchmod(fd_, mode);
+        struct timespec times[2];
+        times[0].tv_sec = 0;
+        times[0].tv_nsec = UTIME_OMIT;
+        times[1].tv_sec = modified;
+        times[1].tv_nsec = 0;
+        futimens(fd_, times);
+#endif
+    }
+
+    bool Close() {
+        bool ok = true;
+#ifdef _WIN32
+        if (file_ != nullptr) ok = fclose(file_) == 0;
+        file_ = nullptr;
+#else
+        if (fd_ >= 0) ok = close(fd_) == 0;
+        fd_ = -1;
+#endif
+        return ok;
+    }
+
+private:
+#ifdef _WIN32
+    FILE* file_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+struct ExtractJob {
+    std::string targetDir;
+    unsigned threadCount = 0;
+    MappedFile archive;
+    std::vector<ZipEntry> entries;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> failed{false};
+    std::atomic<int> state{BACKUP_JOB_RUNNING};
+    std::atomic<long long> filesTotal{0};
+    std::atomic<long long> filesDone{0};
+    std::atomic<long long> bytesTotal{0};
+    std::atomic<long long> bytesWritten{0};
+    std::atomic<long long> errors{0};
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<long long> elapsedMs{-1}; // Set once finished
+    // One reference for the worker thread, one for the caller's handle
+    std::atomic<int> refs{2};
+};
+
+void DropJobReference(ExtractJob* job) {
+    if (job->refs.fetch_sub(1) == 1) delete job;
+}
+
+bool Stopped(const ExtractJob& job) {
+    return job.cancelled || job.failed;
+}
+
+// Streams one entry's data through crc32 into the file
+bool ExtractData(ExtractJob& job, const ZipEntry& entry, const unsigned char* data, OutputFile& output) {
+    static thread_local std::vector<unsigned char> buffer(BufferSize);
+    uint32_t crc = static_cast<uint32_t>(crc32(0, Z_NULL, 0));
+    uint64_t written = 0;
+
+    if (entry.method == MethodStored) {
+        if (entry.compressedSize != entry.size) return false;
+        while (written < entry.size) {
+            if (Stopped(job)) return false;
+            size_t length = static_cast<size_t>(std::min<uint64_t>(entry.size - written, BufferSize));
+            crc = static_cast<uint32_t>(crc32(crc, data + written, static_cast<uInt>(length)));
+            ThrottleBackupIo(length, job.cancelled);
+            if (!output.Write(data + written, length)) return false;
+            written += length;
+            job.bytesWritten += static_cast<long long>(length);
+        }
+        return crc == entry.crc;
+    }
+
+    if (entry.compressedSize == 0) return entry.size == 0 && entry.crc == 0;
+    static thread_local Inflater inflater;
+    z_stream* stream = inflater.Get();
+    if (stream == nullptr) return false;
+    uint64_t inputLeft = entry.compressedSize;
+    int result = Z_OK;
+    while (result != Z_STREAM_END) {
+        if (Stopped(job)) return false;
+        if (stream->avail_in == 0 && inputLeft > 0) {
+            // avail_in is 32-bit; feed archives' large entries in pieces
+            uInt length = static_cast<uInt>(std::min<uint64_t>(inputLeft, 1u << 30));
+            stream->next_in = const_cast<Bytef*>(data + (entry.compressedSize - inputLeft));
+            stream->avail_in = length;
+            inputLeft -= length;
+        }
+        stream->next_out = buffer.data();
+        stream->avail_out = static_cast<uInt>(buffer.size());
+        result = inflate(stream, Z_NO_FLUSH);
+        size_t produced = buffer.size() - stream->avail_out;
+        // No output with the feed used up is only truncation once every
+        // feed is in; otherwise the stream just ended on a feed boundary
+        if (result != Z_OK && result != Z_STREAM_END) return false;
+        if (produced == 0 && result != Z_STREAM_END && stream->avail_in == 0 && inputLeft == 0) return false;
+        if (written + produced > entry.size) return false;
+        crc = static_cast<uint32_t>(crc32(crc, buffer.data(), static_cast<uInt>(produced)));
+        ThrottleBackupIo(produced, job.cancelled);
+        if (!output.Write(buffer.data(), produced)) return false;
+        written += produced;
+        job.bytesWritten += static_cast<long long>(produced);
+    }
+    return written == entry.size && crc == entry.crc;
+}
+
+void ExtractFile(ExtractJob& job, const ZipEntry& entry, const fs::path& path) {
+    if (Stopped(job)) return;
+
+    const auto* base = reinterpret_cast<const unsigned char*>(job.archive.Data());
+    const uint64_t dataOffset = superpanel::ZipDataOffset(base, job.archive.Size(), entry);
+    bool ok = dataOffset != UINT64_MAX && (entry.method == MethodStored || entry.method == MethodDeflated) && (entry.flags & FlagEncrypted) == 0;
+
+    OutputFile output;
+    if (ok) ok = output.Open(path, entry.size);
+    if (ok) {
+        ok = ExtractData(job, entry, base + dataOffset, output);
+        if (ok) output.SetMetadata(entry.mode, entry.modified);
+    }
+    ok = output.Close() && ok;
+
+    if (ok) {
+        job.filesDone++;
+    } else if (!job.cancelled) {
+        job.errors++;
+        job.failed = true;
+    }
+}
+
+void ApplyDirectoryMetadata(const fs::path& path, const ZipEntry& entry) {
+#ifdef _WIN32
+    (void)path;
+    (void)entry;
+#else
+    std::string native = path.u8string();
+    if (entry.mode != 0) chmod(native.c_str(), entry.mode);
+    struct timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = entry.modified;
+    times[1].tv_nsec = 0;
+    utimensat(AT_FDCWD, native.c_str(), times, 0);
+#endif
+}
+
+void RunExtract(ExtractJob& job) {
+    const fs::path target = fs::u8path(job.targetDir);
+    std::error_code ec;
+    fs::create_directories(target, ec);
+
+    // Plan: skip unsafe names and duplicates, then create every directory
+    // before any worker starts, so the workers only ever open files
+    std::vector<const ZipEntry*> files, directories;
+    std::unordered_set<std::string> names;
+    std::vector<std::string> parents;
+    for (const ZipEntry& entry : job.entries) {
+        if (!SafeRelativeName(entry.name) || !names.insert(entry.name).second) {
+            job.errors++;
+            if (!entry.directory) {
+                job.filesTotal--;
+                job.bytesTotal -= static_cast<long long>(entry.size);
+            }
+            continue;
+        }
+        (entry.directory ? directories : files).push_back(&entry);
+        size_t slash = entry.directory ? entry.name.size() : entry.name.rfind('/');
+        if (slash != std::string::npos && slash > 0) parents.push_back(entry.name.substr(0, slash));
+    }
+    std::sort(parents.begin(), parents.end());
+    parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+    for (const std::string& parent : parents) {
+        if (!fs::create_directories(target / fs::u8path(parent), ec) && ec) {
+            job.errors++;
+            job.failed = true;
+            break;
+        }
+    }
+
+    if (!Stopped(job)) {
+        // Largest first: a big file started last would run alone at the end
+        std::sort(files.begin(), files.end(), [](const ZipEntry* a, const ZipEntry* b) { return a->compressedSize > b->compressedSize; });
+        job.archive.AdviseSequential();
+        ThreadPool pool(job.threadCount);
+        for (const ZipEntry* entry : files) {
+            pool.Submit([&job, entry, path = target / fs::u8path(entry->name)] { ExtractFile(job, *entry, path); });
+        }
+        pool.WaitIdle();
+    }
+
+    bool ok = !Stopped(job);
+    if (ok) {
+        // Deepest first, so setting a directory's time is not undone by
+        // touching its parent's children
+        std::sort(directories.begin(), directories.end(), [](const ZipEntry* a, const ZipEntry* b) { return a->name > b->name; });
+        for (const ZipEntry* entry : directories) ApplyDirectoryMetadata(target / fs::u8path(entry->name), *entry);
+    }
+
+    job.archive.Close();
+    job.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job.started).count();
+    job.state = ok ? BACKUP_JOB_COMPLETED : (job.cancelled ? BACKUP_JOB_CANCELLED : BACKUP_JOB_FAILED);
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* ExtractBackupArchiveAsync(const char* archivePath, const char* targetDir, int threadCount) {
+    if (archivePath == NULL || archivePath[0] == '\0' || targetDir == NULL || targetDir[0] == '\0') return NULL;
+
+    auto* job = new ExtractJob();
+    job->targetDir = targetDir;
+    job->threadCount = threadCount > 0 ? static_cast<unsigned>(threadCount) : ThreadPool::DefaultThreadCount();
+    // The central directory is read up front, so totals are known right away
+    if (!job->archive.Open(archivePath) || job->archive.Data() == nullptr ||
+        !superpanel::ReadZipDirectory(reinterpret_cast<const unsigned char*>(job->archive.Data()), job->archive.Size(), job->entries)) {
+        delete job;
+        return NULL;
+    }
+    long long files = 0, bytes = 0;
+    for (const ZipEntry& entry : job->entries) {
+        if (entry.directory) continue;
+        files++;
+        bytes += static_cast<long long>(entry.size);
+    }
+    job->filesTotal = files;
+    job->bytesTotal = bytes;
+
+    std::thread([job] {
+        RunExtract(*job);
+        DropJobReference(job);
+    }).detach();
+    return job;
+}
+
+SUPERPANEL_API int GetBackupExtractProgress(void* handle, BackupExtractProgress* progress) {
+    if (handle == NULL) return BACKUP_JOB_FAILED;
+    auto* job = static_cast<ExtractJob*>(handle);
+    if (progress != NULL) {
+        progress->filesTotal = job->filesTotal;
+        progress->filesDone = job->filesDone;
+        progress->bytesTotal = job->bytesTotal;
+        progress->bytesWritten = job->bytesWritten;
+        progress->errors = job->errors;
+        long long elapsed = job->elapsedMs;
+        progress->elapsedMs = elapsed >= 0
+            ? elapsed
+            : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job->started).count();
+    }
+    return job->state;
+}
+
+SUPERPANEL_API void CancelBackupExtract(void* handle) {
+    if (handle == NULL) return;
+    static_cast<ExtractJob*>(handle)->cancelled = true;
+}
+
+SUPERPANEL_API void ReleaseBackupExtract(void* handle) {
+    if (handle == NULL) return;
+    DropJobReference(static_cast<ExtractJob*>(handle));
+}
+
+} // extern "C"
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include "BackupArchive.h" // BACKUP_JOB_* states
+
+struct BackupExtractProgress {
+    long long filesTotal;
+    long long filesDone;
+    long long bytesTotal;   // Uncompressed size of every file in the archive
+    long long bytesWritten; // Uncompressed bytes extracted so far
+    long long elapsedMs;
+    long long errors;       // Entries skipped (unsafe names, duplicates) or that failed
+};
+
+extern "C" {
+    // Extracts a ZIP archive (including ZIP64) into targetDir. The archive is
+    // memory-mapped and its entries are inflated in parallel, largest first so
+    // one big file does not finish last on its own; each output file is
+    // preallocated to its final size before it is written. Directories are
+    // created up front and file modes and times are set through the open
+    // handle, so the workers never contend on the same paths; directory times
+    // are applied in one pass at the end. CRCs are checked as entries are
+    // written, and a mismatch fails the job.
+    //
+    // The totals are filled in before this returns, so bytesWritten /
+    // bytesTotal gives an ETA from the first poll. threadCount <= 0 picks the
+    // default. Returns a job handle, or NULL if the file is not a readable
+    // archive. A failed or cancelled job leaves partial output behind.
+    SUPERPANEL_API void* ExtractBackupArchiveAsync(const char* archivePath, const char* targetDir, int threadCount);
+    SUPERPANEL_API int GetBackupExtractProgress(void* handle, BackupExtractProgress* progress);
+    SUPERPANEL_API void CancelBackupExtract(void* handle);
+    // Releases the caller's reference; a running job frees itself when done.
+    SUPERPANEL_API void ReleaseBackupExtract(void* handle);
+}
@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "BackupFiles.h"
+#include "ThreadPool.h"
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace superpanel {
+
+FILE* OpenFile(const std::string& path, const char* mode) {
+#ifdef _WIN32
+    std::wstring widePath = fs::u8path(path).wstring();
+    std::wstring wideMode(mode, mode + strlen(mode));
+    return _wfopen(widePath.c_str(), wideMode.c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+bool SeekFile(FILE* file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<long long>(offset), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+bool SyncFile(FILE* file) {
+    if (fflush(file) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool ReadWholeFile(const std::string& path, std::string& contents) {
+    FILE* file = OpenFile(path, "rb");
+    if (file == nullptr) return false;
+    contents.clear();
+    char buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) contents.append(buffer, read);
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+bool ReplaceFile(const std::string& path, const std::string& contents) {
+    std::string temp = path + ".tmp";
+    FILE* file = OpenFile(temp, "wb");
+    if (file == nullptr) return false;
+    bool ok = fwrite(contents.data(), 1, contents.size(), file) == contents.size() && SyncFile(file);
+    ok = fclose(file) == 0 && ok;
+    std::error_code ec;
+    if (ok) fs::rename(fs::u8path(temp), fs::u8path(path), ec);
+    if (!ok || ec) {
+        fs::remove(fs::u8path(temp), ec);
+        return false;
+    }
+    return true;
+}
+
+bool SafeRelativeName(const std::string& name) {
+    if (name.empty() || name[0] == '/' || name[0] == '\\' || name.find(':') != std::string::npos) return false;
+    for (const auto& part : fs::u8path(name)) {
+        if (part == "..") return false;
+    }
+    return true;
+}
+
+#ifdef _WIN32
+bool StatSource(const fs::path& path, SourceInfo& info, bool followLinks) {
+    (void)followLinks;
+    struct _stat64 st;
+    if (_wstat64(path.c_str(), &st) != 0) return false;
+    info.directory = (st.st_mode & _S_IFDIR) != 0;
+    info.regular = (st.st_mode & _S_IFREG) != 0;
+    info.mode = info.directory ? 040755 : 0100644;
+    info.size = static_cast<uint64_t>(st.st_size);
+    info.modified = st.st_mtime;
+    info.modifiedNs = static_cast<int64_t>(st.st_mtime) * 1000000000;
+    info.changedNs = static_cast<int64_t>(st.st_ctime) * 1000000000;
+    return true;
+}
+#else
+static void FillSourceInfo(const struct stat& st, SourceInfo& info) {
+    info.directory = S_ISDIR(st.st_mode);
+    info.regular = S_ISREG(st.st_mode);
+    info.mode = static_cast<uint32_t>(st.st_mode);
+    info.size = static_cast<uint64_t>(st.st_size);
+    info.modified = st.st_mtime;
+    info.modifiedNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    info.changedNs = static_cast<int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+    info.inode = static_cast<uint64_t>(st.st_ino);
+    info.device = static_cast<uint64_t>(st.st_dev);
+}
+
+bool StatSource(const fs::path& path, SourceInfo& info, bool followLinks) {
+    struct stat st;
+    if ((followLinks ? stat(path.c_str(), &st) : lstat(path.c_str(), &st)) != 0) return false;
+    FillSourceInfo(st, info);
+    return true;
+}
+#endif
+
+long long WalkSource(const std::string& source, const std::string& prefix, const SourceVisitor& visit) {
+    const fs::path root = fs::u8path(source);
+    SourceInfo info;
+    // The source itself may be a symlink (a webroot pointing at a release directory)
+    if (!StatSource(root, info, true)) return 1;
+
+    std::string base = prefix;
+    while (!base.empty() && base.back() == '/') base.pop_back();
+
+    if (!info.directory) {
+        if (!info.regular) return 0;
+        std::string name = root.filename().u8string();
+        visit(root, base.empty() ? name : base + "/" + name, info);
+        return 0;
+    }
+
+    if (!base.empty() && !visit(root, base, info)) return 0;
+
+    long long errors = 0;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    if (ec) return 1;
+    for (; it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        const fs::path& path = it->path();
+        SourceInfo entryInfo;
+        if (!StatSource(path, entryInfo, false)) {
+            errors++;
+            continue;
+        }
+        if (!entryInfo.directory && !entryInfo.regular) continue;
+
+        std::string relative = path.lexically_relative(root).generic_u8string();
+        if (!visit(path, base.empty() ? relative : base + "/" + relative, entryInfo)) return errors;
+    }
+    if (ec) errors++;
+    return errors;
+}
+
+#ifdef _WIN32
+void ParallelWalkSource(const std::string& source, const std::string& prefix, ThreadPool& pool, const SourceVisitor& visit,
+                        std::atomic<long long>& errors) {
+    (void)pool;
+    errors += WalkSource(source, prefix, visit);
+}
+#else
+namespace {
+
+struct ParallelWalk {
+    SourceVisitor visit;
+    std::atomic<long long>* errors = nullptr;
+    std::atomic<bool> stopped{false};
+    ThreadPool* pool = nullptr;
+};
+
+void WalkDirectory(const std::shared_ptr<ParallelWalk>& walk, const std::string& path, const std::string& name) {
+    if (walk->stopped) return;
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR* dir = fd >= 0 ? fdopendir(fd) : nullptr;
+    if (dir == nullptr) {
+        if (fd >= 0) close(fd);
+        (*walk->errors)++;
+        return;
+    }
+
+    while (struct dirent* entry = readdir(dir)) {
+        if (walk->stopped) break;
+        const char* child = entry->d_name;
+        if (child[0] == '.' && (child[1] == '\0' || (child[1] == '.' && child[2] == '\0'))) continue;
+
+        struct stat st;
+        if (fstatat(fd, child, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            (*walk->errors)++;
+            continue;
+        }
+        SourceInfo info;
+        FillSourceInfo(st, info);
+        if (!info.directory && !info.regular) continue;
+
+        std::string childPath = path + "/" + child;
+        std::string childName = name.empty() ? child : name + "/" + child;
+        if (!walk->visit(fs::path(childPath), childName, info)) {
+            walk->stopped = true;
+            break;
+        }
+        if (info.directory) {
+            walk->pool->Submit([walk, childPath, childName] { WalkDirectory(walk, childPath, childName); });
+        }
+    }
+    closedir(dir);
+}
+
+} // namespace
+
+void ParallelWalkSource(const std::string& source, const std::string& prefix, ThreadPool& pool, const SourceVisitor& visit,
+                        std::atomic<long long>& errors) {
+    const fs::path root = fs::u8path(source);
+    SourceInfo info;
+    if (!StatSource(root, info, true)) {
+        errors++;
+        return;
+    }
+
+    std::string base = prefix;
+    while (!base.empty() && base.back() == '/') base.pop_back();
+
+    if (!info.directory) {
+        if (!info.regular) return;
+        std::string name = root.filename().u8string();
+        visit(root, base.empty() ? name : base + "/" + name, info);
+        return;
+    }
+    if (!base.empty() && !visit(root, base, info)) return;
+
+    auto walk = std::make_shared<ParallelWalk>();
+    walk->visit = visit;
+    walk->errors = &errors;
+    walk->pool = &pool;
+    std::string rootPath = source;
+    while (rootPath.size() > 1 && rootPath.back() == '/') rootPath.pop_back();
+    pool.Submit([walk, rootPath, base] { WalkDirectory(walk, rootPath, base); });
+}
+#endif
+
+} // namespace superpanel
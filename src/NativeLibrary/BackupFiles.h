@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace superpanel {
+
+class ThreadPool;
+
+// File access shared by the backup writers and readers. Paths are UTF-8 on
+// every platform.
+FILE* OpenFile(const std::string& path, const char* mode);
+bool SeekFile(FILE* file, uint64_t offset);
+// Flushes stdio buffers and the OS cache to disk
+bool SyncFile(FILE* file);
+bool ReadWholeFile(const std::string& path, std::string& contents);
+// Write-to-temp-then-rename, so readers never see a partial file
+bool ReplaceFile(const std::string& path, const std::string& contents);
+// Rejects absolute names and '..', so a name read from a backup cannot be
+// restored outside the target directory
+bool SafeRelativeName(const std::string& name);
+
+struct SourceInfo {
+    bool directory = false;
+    bool regular = false;
+    uint64_t size = 0;
+    time_t modified = 0;
+    uint32_t mode = 0; // POSIX st_mode (synthesised on Windows)
+    // Change detection; inode and device are 0 on Windows
+    int64_t modifiedNs = 0;
+    int64_t changedNs = 0;
+    uint64_t inode = 0;
+    uint64_t device = 0;
+};
+
+bool StatSource(const std::filesystem::path& path, SourceInfo& info, bool followLinks);
+
+// Called for each file and directory of a backup source with its name inside
+// the backup ('/'-separated, no trailing slash). Returning false stops the walk.
+using SourceVisitor = std::function<bool(const std::filesystem::path& path, const std::string& name, const SourceInfo& info)>;
+
+// Visits source (a file or directory, which may itself be a symlink) and
+// everything below it. A directory's contents are named relative to prefix,
+// so an empty prefix puts them at the root; the directory itself is only
+// visited when prefix is set. Symlinks and special files below the root are
+// skipped: following links could leave the tree, and the backup formats have
+// no portable way to store them. Returns the number of paths that could not
+// be read.
+long long WalkSource(const std::string& source, const std::string& prefix, const SourceVisitor& visit);
+
+// Same walk with each directory listed and stat'ed as its own task on pool,
+// which pays off for large trees on SSDs and network filesystems. visit is
+// called concurrently from the pool's workers. Returns once the walk is
+// queued: the caller must WaitIdle on the pool before reading errors.
+void ParallelWalkSource(const std::string& source, const std::string& prefix, ThreadPool& pool, const SourceVisitor& visit,
+                        std::atomic<long long>& errors);
+
+} // namespace superpanel
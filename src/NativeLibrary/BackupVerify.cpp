@@ -0,0 +1,408 @@
+#include "pch.h"
+#include "BackupVerify.h"
+#include "BackupFiles.h"
+#include "Hash.h"
+#include "IoThrottle.h"
+#include "MappedFile.h"
+#include "Sketches.h"
+#include "ThreadPool.h"
+#include "ZipDirectory.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <openssl/evp.h>
+
+#ifdef _WIN32
+#pragma comment(lib, "libcrypto.lib")
+#endif
+
+using superpanel::ByteReader;
+using superpanel::ByteWriter;
+using superpanel::MappedFile;
+using superpanel::ThreadPool;
+using superpanel::TokenBucket;
+using superpanel::XXH64;
+using superpanel::ZipEntry;
+
+namespace {
+
+const uint32_t VerifyMagic = 0x4D565053; // "SPVM"
+const uint32_t VerifyVersion = 1;
+const uint32_t FlagSha256 = 1;
+
+// Large regions are hashed in pieces of this size; pool tasks take about
+// this much data each, batching small regions together
+const uint64_t PieceSize = 4 * 1024 * 1024;
+const size_t MaxPiecesPerTask = 256;
+
+const char* const DirectoryRegion = "(central directory)";
+const char* const FileRegion = "(file)";
+const char* const SizeChangedRegion = "(size changed)";
+
+struct Sha256 {
+    unsigned char bytes[32];
+};
+
+struct Region {
+    std::string name;
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    uint64_t xxh = 0;
+    Sha256 sha;
+};
+
+struct Piece {
+    size_t region;
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct VerifyJob {
+    bool verify = false;
+    std::string manifestPath;
+    unsigned threadCount = 0;
+    MappedFile file;
+    uint64_t fileSize = 0;
+    bool sha256 = false;
+    std::vector<Region> regions;
+    TokenBucket limiter;
+
+    // Verify: what the manifest recorded
+    uint64_t expectedSize = 0;
+    std::vector<Region> expected;
+    std::vector<std::string> damaged;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> failed{false};
+    std::atomic<int> state{BACKUP_JOB_RUNNING};
+    std::atomic<long long> bytesTotal{0};
+    std::atomic<long long> bytesDone{0};
+    std::atomic<long long> regionsDamaged{0};
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<long long> elapsedMs{-1}; // Set once finished
+    // One reference for the worker thread, one for the caller's handle
+    std::atomic<int> refs{2};
+
+    explicit VerifyJob(long long bytesPerSecond) : limiter(bytesPerSecond) {}
+};
+
+void DropJobReference(VerifyJob* job) {
+    if (job->refs.fetch_sub(1) == 1) delete job;
+}
+
+Sha256 Sha256Of(const void* data, size_t length) {
+    static const unsigned char empty = 0;
+    Sha256 digest;
+    EVP_Digest(data != nullptr ? data : &empty, length, digest.bytes, nullptr, EVP_sha256(), nullptr);
+    return digest;
+}
+
+// One region per archive entry, covering its local header and data up to
+// the next entry, then the central directory. Falls back to one region for
+// the whole file if it is not a ZIP archive.
+void SplitRegions(const unsigned char* data, uint64_t size, std::vector<Region>& regions) {
+    regions.clear();
+    std::vector<ZipEntry> entries;
+    if (data != nullptr && superpanel::ReadZipDirectory(data, size, entries) && !entries.empty()) {
+        std::sort(entries.begin(), entries.end(), [](const ZipEntry& a, const ZipEntry& b) { return a.headerOffset < b.headerOffset; });
+        uint64_t position = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            const ZipEntry& entry = entries[i];
+            uint64_t dataOffset = superpanel::ZipDataOffset(data, size, entry);
+            if (dataOffset == UINT64_MAX || entry.headerOffset < position) {
+                regions.clear();
+                break;
+            }
+            uint64_t end = i + 1 < entries.size() ? entries[i + 1].headerOffset : dataOffset + entry.compressedSize;
+            if (end < dataOffset + entry.compressedSize) {
+                regions.clear();
+                break;
+            }
+            Region region;
+            region.name = entry.directory ? entry.name + "/" : entry.name;
+            region.offset = entry.headerOffset;
+            region.length = end - entry.headerOffset;
+            regions.push_back(std::move(region));
+            position = end;
+        }
+        if (!regions.empty() && regions.front().offset == 0) {
+            Region directory;
+            directory.name = DirectoryRegion;
+            directory.offset = position;
+            directory.length = size - position;
+            regions.push_back(std::move(directory));
+            return;
+        }
+        regions.clear();
+    }
+    Region whole;
+    whole.name = FileRegion;
+    whole.length = size;
+    regions.push_back(std::move(whole));
+}
+
+void HashPieces(VerifyJob& job, const Piece* pieces, size_t count, uint64_t* xxh, Sha256* sha) {
+    static const unsigned char empty = 0;
+    const auto* base = reinterpret_cast<const unsigned char*>(job.file.Data());
+    for (size_t i = 0; i < count && !job.cancelled; i++) {
+        const Piece& piece = pieces[i];
+        // A verification's own limit applies on top of the shared backup one
+        job.limiter.Acquire(piece.length, job.cancelled);
+        superpanel::ThrottleBackupIo(piece.length, job.cancelled);
+        const unsigned char* data = base != nullptr ? base + piece.offset : &empty;
+        xxh[i] = XXH64(data, static_cast<size_t>(piece.length));
+        if (sha != nullptr) sha[i] = Sha256Of(data, static_cast<size_t>(piece.length));
+        job.bytesDone += static_cast<long long>(piece.length);
+    }
+}
+
+// Hashes every region in place. Regions past the end of the file (a
+// truncated backup) are left unhashed and reported by the caller.
+void HashRegions(VerifyJob& job) {
+    std::vector<Piece> pieces;
+    for (size_t r = 0; r < job.regions.size(); r++) {
+        const Region& region = job.regions[r];
+        if (region.offset > job.fileSize || region.length > job.fileSize - region.offset) continue;
+        uint64_t offset = region.offset, end = region.offset + region.length;
+        do {
+            uint64_t length = std::min(PieceSize, end - offset);
+            pieces.push_back(Piece{r, offset, length});
+            offset += length;
+        } while (offset < end);
+    }
+
+    std::vector<uint64_t> xxh(pieces.size());
+    std::vector<Sha256> sha(job.sha256 ? pieces.size() : 0);
+    {
+        job.file.AdviseSequential();
+        ThreadPool pool(job.threadCount);
+        for (size_t first = 0; first < pieces.size();) {
+            size_t last = first;
+            uint64_t bytes = 0;
+            while (last < pieces.size() && last - first < MaxPiecesPerTask && (bytes == 0 || bytes + pieces[last].length <= PieceSize)) {
+                bytes += pieces[last++].length;
+            }
+            Sha256* shaOut = job.sha256 ? &sha[first] : nullptr;
+            pool.Submit([&job, &pieces, &xxh, first, count = last - first, shaOut] {
+                HashPieces(job, &pieces[first], count, &xxh[first], shaOut);
+            });
+            first = last;
+        }
+        pool.WaitIdle();
+    }
+
+    // A region's hash is its single piece's, or the hash of its piece list
+    for (size_t p = 0; p < pieces.size();) {
+        size_t last = p;
+        while (last < pieces.size() && pieces[last].region == pieces[p].region) last++;
+        Region& region = job.regions[pieces[p].region];
+        if (last - p == 1) {
+            region.xxh = xxh[p];
+            if (job.sha256) region.sha = sha[p];
+        } else {
+            region.xxh = XXH64(&xxh[p], (last - p) * sizeof(uint64_t));
+            if (job.sha256) region.sha = Sha256Of(&sha[p], (last - p) * sizeof(Sha256));
+        }
+        p = last;
+    }
+}
+
+void WholeDigest(const std::vector<Region>& regions, bool sha256, uint64_t& xxh, Sha256& sha) {
+    std::vector<uint64_t> hashes;
+    std::vector<Sha256> shas;
+    for (const Region& region : regions) {
+        hashes.push_back(region.xxh);
+        if (sha256) shas.push_back(region.sha);
+    }
+    xxh = XXH64(hashes.data(), hashes.size() * sizeof(uint64_t));
+    if (sha256) sha = Sha256Of(shas.data(), shas.size() * sizeof(Sha256));
+}
+
+bool WriteVerifyManifest(const VerifyJob& job) {
+    uint64_t wholeXxh = 0;
+    Sha256 wholeSha;
+    WholeDigest(job.regions, job.sha256, wholeXxh, wholeSha);
+
+    std::string contents;
+    ByteWriter writer(contents);
+    writer.Write(VerifyMagic);
+    writer.Write(VerifyVersion);
+    writer.Write(job.sha256 ? FlagSha256 : 0u);
+    writer.Write(job.fileSize);
+    writer.Write(wholeXxh);
+    if (job.sha256) writer.WriteBytes(wholeSha.bytes, sizeof(wholeSha.bytes));
+    writer.Write(static_cast<uint64_t>(job.regions.size()));
+    for (const Region& region : job.regions) {
+        writer.Write(static_cast<uint32_t>(region.name.size()));
+        writer.WriteBytes(region.name.data(), region.name.size());
+        writer.Write(region.offset);
+        writer.Write(region.length);
+        writer.Write(region.xxh);
+        if (job.sha256) writer.WriteBytes(region.sha.bytes, sizeof(region.sha.bytes));
+    }
+    return superpanel::ReplaceFile(job.manifestPath, contents);
+}
+
+bool ReadVerifyManifest(VerifyJob& job) {
+    std::string contents;
+    if (!superpanel::ReadWholeFile(job.manifestPath, contents)) return false;
+    ByteReader reader(contents.data(), contents.size());
+
+    uint32_t magic = 0, version = 0, flags = 0;
+    uint64_t wholeXxh = 0, count = 0;
+    Sha256 wholeSha;
+    if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(flags) || magic != VerifyMagic || version != VerifyVersion ||
+        !reader.Read(job.expectedSize) || !reader.Read(wholeXxh)) {
+        return false;
+    }
+    job.sha256 = (flags & FlagSha256) != 0;
+    if ((job.sha256 && !reader.ReadBytes(wholeSha.bytes, sizeof(wholeSha.bytes))) || !reader.Read(count) || count > reader.Remaining() / 28) return false;
+
+    job.expected.clear();
+    for (uint64_t i = 0; i < count; i++) {
+        Region region;
+        uint32_t nameLength = 0;
+        if (!reader.Read(nameLength) || nameLength > reader.Remaining()) return false;
+        region.name.resize(nameLength);
+        if (!reader.ReadBytes(&region.name[0], nameLength) || !reader.Read(region.offset) || !reader.Read(region.length) || !reader.Read(region.xxh) ||
+            (job.sha256 && !reader.ReadBytes(region.sha.bytes, sizeof(region.sha.bytes)))) {
+            return false;
+        }
+        job.expected.push_back(std::move(region));
+    }
+
+    // The manifest must be internally consistent, or a damaged manifest
+    // could report a damaged backup as sound
+    uint64_t xxh = 0;
+    Sha256 sha;
+    WholeDigest(job.expected, job.sha256, xxh, sha);
+    return xxh == wholeXxh && (!job.sha256 || memcmp(sha.bytes, wholeSha.bytes, sizeof(sha.bytes)) == 0);
+}
+
+void RunVerify(VerifyJob& job) {
+    if (job.verify) {
+        // Re-hash exactly the recorded regions, so damage to the archive's
+        // own directory cannot hide entries from the check
+        job.regions = job.expected;
+    } else {
+        SplitRegions(reinterpret_cast<const unsigned char*>(job.file.Data()), job.fileSize, job.regions);
+    }
+    HashRegions(job);
+
+    bool ok = !job.cancelled;
+    if (ok && job.verify) {
+        if (job.fileSize != job.expectedSize) job.damaged.push_back(SizeChangedRegion);
+        for (size_t r = 0; r < job.regions.size(); r++) {
+            const Region& actual = job.regions[r];
+            const Region& expected = job.expected[r];
+            bool inFile = actual.offset <= job.fileSize && actual.length <= job.fileSize - actual.offset;
+            if (!inFile || actual.xxh != expected.xxh ||
+                (job.sha256 && memcmp(actual.sha.bytes, expected.sha.bytes, sizeof(actual.sha.bytes)) != 0)) {
+                job.damaged.push_back(actual.name);
+            }
+        }
+        job.regionsDamaged = static_cast<long long>(job.damaged.size());
+    } else if (ok) {
+        ok = WriteVerifyManifest(job);
+    }
+
+    job.file.Close();
+    job.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job.started).count();
+    job.state = ok ? BACKUP_JOB_COMPLETED : (job.cancelled ? BACKUP_JOB_CANCELLED : BACKUP_JOB_FAILED);
+}
+
+VerifyJob* StartJob(VerifyJob* job, const char* filePath) {
+    if (!job->file.Open(filePath)) {
+        delete job;
+        return NULL;
+    }
+    job->fileSize = job->file.Size();
+    job->bytesTotal = static_cast<long long>(job->fileSize);
+    std::thread([job] {
+        RunVerify(*job);
+        DropJobReference(job);
+    }).detach();
+    return job;
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* HashBackupFileAsync(const char* filePath, const char* manifestPath, int includeSha256, int threadCount) {
+    if (filePath == NULL || manifestPath == NULL || manifestPath[0] == '\0') return NULL;
+
+    auto* job = new VerifyJob(0);
+    job->manifestPath = manifestPath;
+    job->sha256 = includeSha256 != 0;
+    job->threadCount = threadCount > 0 ? static_cast<unsigned>(threadCount) : ThreadPool::DefaultThreadCount();
+    return StartJob(job, filePath);
+}
+
+SUPERPANEL_API void* VerifyBackupFileAsync(const char* filePath, const char* manifestPath, int threadCount, long long bytesPerSecond) {
+    if (filePath == NULL || manifestPath == NULL) return NULL;
+
+    auto* job = new VerifyJob(bytesPerSecond);
+    job->verify = true;
+    job->manifestPath = manifestPath;
+    job->threadCount = threadCount > 0 ? static_cast<unsigned>(threadCount) : ThreadPool::DefaultThreadCount();
+    if (!ReadVerifyManifest(*job)) {
+        delete job;
+        return NULL;
+    }
+    return StartJob(job, filePath);
+}
+
+SUPERPANEL_API int GetBackupVerifyProgress(void* handle, BackupVerifyProgress* progress) {
+    if (handle == NULL) return BACKUP_JOB_FAILED;
+    auto* job = static_cast<VerifyJob*>(handle);
+    int state = job->state;
+    if (progress != NULL) {
+        progress->bytesTotal = job->bytesTotal;
+        progress->bytesDone = job->bytesDone;
+        // A new manifest's region list is only settled once hashing has finished
+        if (job->verify) {
+            progress->regionsTotal = static_cast<long long>(job->expected.size());
+        } else {
+            progress->regionsTotal = state != BACKUP_JOB_RUNNING ? static_cast<long long>(job->regions.size()) : 0;
+        }
+        progress->regionsDamaged = job->regionsDamaged;
+        long long elapsed = job->elapsedMs;
+        progress->elapsedMs = elapsed >= 0
+            ? elapsed
+            : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job->started).count();
+    }
+    return state;
+}
+
+SUPERPANEL_API int GetBackupVerifyDamage(void* handle, char* buffer, int bufferSize) {
+    if (handle == NULL || buffer == NULL || bufferSize < 0) return -1;
+    auto* job = static_cast<VerifyJob*>(handle);
+    if (job->state == BACKUP_JOB_RUNNING) return -1;
+
+    int used = 0, copied = 0;
+    for (const std::string& name : job->damaged) {
+        if (name.size() + 1 > static_cast<size_t>(bufferSize - used)) break;
+        memcpy(buffer + used, name.data(), name.size());
+        used += static_cast<int>(name.size());
+        buffer[used++] = '\n';
+        copied++;
+    }
+    return copied;
+}
+
+SUPERPANEL_API void CancelBackupVerify(void* handle) {
+    if (handle == NULL) return;
+    static_cast<VerifyJob*>(handle)->cancelled = true;
+}
+
+SUPERPANEL_API void ReleaseBackupVerify(void* handle) {
+    if (handle == NULL) return;
+    DropJobReference(static_cast<VerifyJob*>(handle));
+}
+
+} // extern "C"
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include "BackupArchive.h" // BACKUP_JOB_* states
+
+struct BackupVerifyProgress {
+    long long bytesTotal;
+    long long bytesDone;
+    long long regionsTotal;   // Archive entries (plus the directory) or 1 for other files
+    long long regionsDamaged; // Verify: regions whose checksum no longer matches
+    long long elapsedMs;
+};
+
+extern "C" {
+    // Writes an integrity manifest for a stored backup file. ZIP archives are
+    // split into one region per entry (its local header and data) plus the
+    // central directory, so damage can be traced to the files it affects;
+    // anything else (encrypted backups, chunk-store manifests) is one region.
+    // Regions are hashed in parallel from a memory mapping, large ones in
+    // 4 MB pieces combined as a hash list, and the whole-file digest is the
+    // hash of the region hashes. XXH64 is always computed; includeSha256 adds
+    // a SHA-256 of each region (and of the file, built the same way) for
+    // tamper evidence rather than just bit-rot detection.
+    //
+    // threadCount <= 0 picks the default. Returns a job handle, or NULL if the
+    // file cannot be opened.
+    SUPERPANEL_API void* HashBackupFileAsync(const char* filePath, const char* manifestPath, int includeSha256, int threadCount);
+    // Re-hashes a backup file against its manifest, reading at most
+    // bytesPerSecond (<= 0 for no limit) so it can run in the background
+    // without starving the server's I/O. The job completes even if damage is
+    // found; regionsDamaged and GetBackupVerifyDamage report it. Returns NULL
+    // if either file cannot be opened or the manifest is invalid.
+    SUPERPANEL_API void* VerifyBackupFileAsync(const char* filePath, const char* manifestPath, int threadCount, long long bytesPerSecond);
+
+    SUPERPANEL_API int GetBackupVerifyProgress(void* handle, BackupVerifyProgress* progress);
+    // Copies the names of damaged regions into buffer, each terminated by
+    // '\n' (archive entries by path, "(central directory)", "(file)" for
+    // non-archives, "(size changed)" if the file was truncated or extended).
+    // Returns the number of names copied, or -1 while the job is running.
+    SUPERPANEL_API int GetBackupVerifyDamage(void* handle, char* buffer, int bufferSize);
+    SUPERPANEL_API void CancelBackupVerify(void* handle);
+    // Releases the caller's reference; a running job frees itself when done.
+    SUPERPANEL_API void ReleaseBackupVerify(void* handle);
+}
@@ -0,0 +1,693 @@
+#include "pch.h"
+#include "CertificateScan.h"
+#include "DnsResolver.h"
+#include "EventLoop.h"
+#include "ThreadPool.h"
+#include "TlsClient.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "libssl.lib")
+#pragma comment(lib, "libcrypto.lib")
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+using superpanel::AsyncResolver;
+using superpanel::EventLoop;
+using superpanel::InvalidSocket;
+using superpanel::SocketAddress;
+using superpanel::SocketHandle;
+using superpanel::ThreadPool;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const long long MaxCertificateFileBytes = 1024 * 1024;
+const int DefaultPort = 443;
+const int DefaultTimeoutMs = 5000;
+// Handshakes in flight at once, as in CheckPorts
+const size_t MaxInFlight = 512;
+
+long long MicrosecondsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+void CopyText(char* target, size_t size, const std::string& text) {
+    snprintf(target, size, "%s", text.c_str());
+}
+
+long long UnixTime(const ASN1_TIME* time) {
+    static ASN1_TIME* epoch = ASN1_TIME_set(NULL, 0);
+    int days = 0, seconds = 0;
+    if (time == NULL || epoch == NULL || ASN1_TIME_diff(&days, &seconds, epoch, time) != 1) return 0;
+    return static_cast<long long>(days) * 86400 + seconds;
+}
+
+std::string NameText(const X509_NAME* name) {
+    BIO* bio = BIO_new(BIO_s_mem());
+    if (bio == NULL) return std::string();
+    X509_NAME_print_ex(bio, name, 0, XN_FLAG_RFC2253 & ~ASN1_STRFLGS_ESC_MSB);
+    char* data = nullptr;
+    const long length = BIO_get_mem_data(bio, &data);
+    std::string text(data != nullptr ? data : "", length > 0 ? static_cast<size_t>(length) : 0);
+    BIO_free(bio);
+    return text;
+}
+
+// DNS names and IP addresses from the subject alternative names, as many as
+// fit in names; returns how many there are
+long long ListNames(X509* certificate, char* names, size_t size) {
+    names[0] = '\0';
+    GENERAL_NAMES* alternatives = static_cast<GENERAL_NAMES*>(X509_get_ext_d2i(certificate, NID_subject_alt_name, NULL, NULL));
+    if (alternatives == NULL) return 0;
+    long long count = 0;
+    size_t used = 0;
+    bool full = false;
+    for (int i = 0; i < sk_GENERAL_NAME_num(alternatives); i++) {
+        const GENERAL_NAME* entry = sk_GENERAL_NAME_value(alternatives, i);
+        std::string name;
+        if (entry->type == GEN_DNS) {
+            name.assign(reinterpret_cast<const char*>(ASN1_STRING_get0_data(entry->d.dNSName)), static_cast<size_t>(ASN1_STRING_length(entry->d.dNSName)));
+        } else if (entry->type == GEN_IPADD) {
+            char text[64] = "";
+            const int length = ASN1_STRING_length(entry->d.iPAddress);
+            const unsigned char* address = ASN1_STRING_get0_data(entry->d.iPAddress);
+            if (length == 4) inet_ntop(AF_INET, address, text, sizeof(text));
+            else if (length == 16) inet_ntop(AF_INET6, address, text, sizeof(text));
+            name = text;
+        }
+        if (name.empty()) continue;
+        count++;
+        const size_t needed = name.size() + (used > 0 ? 1 : 0);
+        if (full || used + needed >= size) {
+            full = true;
+            continue;
+        }
+        if (used > 0) names[used++] = ',';
+        memcpy(names + used, name.data(), name.size());
+        used += name.size();
+        names[used] = '\0';
+    }
+    GENERAL_NAMES_free(alternatives);
+    return count;
+}
+
+bool WeakSignature(const X509* certificate) {
+    int digest = NID_undef;
+    if (OBJ_find_sigid_algs(X509_get_signature_nid(certificate), &digest, NULL) != 1) return false;
+    return digest == NID_md5 || digest == NID_sha1;
+}
+
+bool Expired(const X509* certificate) {
+    return X509_cmp_current_time(X509_get0_notAfter(certificate)) < 0;
+}
+
+// Fills everything but the source, status and verification results from
+// chain, leaf first
+void Describe(STACK_OF(X509)* chain, CertificateInfo& info) {
+    X509* leaf = sk_X509_value(chain, 0);
+    const int count = sk_X509_num(chain);
+    CopyText(info.subject, sizeof(info.subject), NameText(X509_get_subject_name(leaf)));
+    CopyText(info.issuer, sizeof(info.issuer), NameText(X509_get_issuer_name(leaf)));
+    info.nameCount = ListNames(leaf, info.names, sizeof(info.names));
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    if (X509_digest(leaf, EVP_sha256(), digest, &digestLength) == 1) {
+        for (unsigned int i = 0; i < digestLength && i * 2 + 2 < sizeof(info.fingerprint); i++) snprintf(info.fingerprint + i * 2, 3, "%02x", digest[i]);
+    }
+    info.notBefore = UnixTime(X509_get0_notBefore(leaf));
+    info.notAfter = UnixTime(X509_get0_notAfter(leaf));
+    info.chainLength = count;
+    info.ca = X509_check_ca(leaf) != 0 ? 1 : 0;
+
+    const uint32_t flags = X509_get_extension_flags(leaf);
+    if (Expired(leaf)) info.issues |= CERT_ISSUE_EXPIRED;
+    if (X509_cmp_current_time(X509_get0_notBefore(leaf)) > 0) info.issues |= CERT_ISSUE_NOT_YET_VALID;
+    if ((flags & EXFLAG_SS) != 0) info.issues |= CERT_ISSUE_SELF_SIGNED;
+    if (EVP_PKEY* key = X509_get0_pubkey(leaf)) {
+        info.keyBits = EVP_PKEY_bits(key);
+        const int type = EVP_PKEY_base_id(key);
+        if ((type == EVP_PKEY_RSA || type == EVP_PKEY_DSA) && info.keyBits < 2048) info.issues |= CERT_ISSUE_WEAK_KEY;
+    }
+    for (int i = 0; i < count; i++) {
+        X509* certificate = sk_X509_value(chain, i);
+        if (i > 0 && Expired(certificate)) info.issues |= CERT_ISSUE_CHAIN_EXPIRED;
+        if (i + 1 < count && X509_check_issued(sk_X509_value(chain, i + 1), certificate) != X509_V_OK) info.issues |= CERT_ISSUE_CHAIN_ORDER;
+        // A root's signature on itself is never checked
+        if ((X509_get_extension_flags(certificate) & EXFLAG_SS) == 0 && WeakSignature(certificate)) info.issues |= CERT_ISSUE_WEAK_SIGNATURE;
+    }
+}
+
+bool IssuerMissing(int error) {
+    return error == X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT || error == X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY;
+}
+
+long long VerifyIssues(int error) {
+    if (error == X509_V_OK) return 0;
+    return IssuerMissing(error) ? CERT_ISSUE_UNTRUSTED | CERT_ISSUE_INCOMPLETE_CHAIN : CERT_ISSUE_UNTRUSTED;
+}
+
+// Chain verification against the system roots, ignoring validity dates
+// (reported separately) so an expired certificate still says whether it
+// chains up
+int VerifyChain(X509* leaf, STACK_OF(X509)* untrusted) {
+    SSL_CTX* tls = superpanel::TlsClientContext();
+    X509_STORE_CTX* context = X509_STORE_CTX_new();
+    if (tls == NULL || context == NULL || X509_STORE_CTX_init(context, SSL_CTX_get_cert_store(tls), leaf, untrusted) != 1) {
+        X509_STORE_CTX_free(context);
+        return X509_V_ERR_OUT_OF_MEM;
+    }
+    X509_STORE_CTX_set_flags(context, X509_V_FLAG_NO_CHECK_TIME);
+    const int error = X509_verify_cert(context) == 1 ? X509_V_OK : X509_STORE_CTX_get_error(context);
+    X509_STORE_CTX_free(context);
+    ERR_clear_error();
+    return error;
+}
+
+struct CertificateFile {
+    std::string path;
+    std::string directory;
+    STACK_OF(X509)* chain = nullptr; // NULL if unreadable
+    int error = 0;
+};
+
+bool IsCertificateFile(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    for (char& c : extension) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return extension == ".pem" || extension == ".crt" || extension == ".cer" || extension == ".der" || extension == ".cert";
+}
+
+bool ReadFile(const std::string& path, std::string& data, int& error) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        error = errno;
+        return false;
+    }
+    char buffer[16384];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0 && static_cast<long long>(data.size()) <= MaxCertificateFileBytes) data.append(buffer, length);
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    if (failed || static_cast<long long>(data.size()) > MaxCertificateFileBytes) {
+        error = failed ? EIO : EFBIG;
+        return false;
+    }
+    return true;
+}
+
+// Walks the directories and parses the files on the pool, then analyses
+// each file once every directory's certificates are known. The same
+// certificate usually turns up in many files (the shared intermediate in
+// every fullchain.pem, a leaf in both cert.pem and fullchain.pem), and
+// decoding is the expensive part on OpenSSL 3, so each distinct PEM block
+// or DER file is decoded once per scan.
+class FileScanner {
+public:
+    explicit FileScanner(unsigned threadCount) : pool_(threadCount) {}
+
+    ~FileScanner() {
+        for (CertificateFile& file : files_) {
+            if (file.chain != nullptr) sk_X509_pop_free(file.chain, X509_free);
+        }
+        for (auto& entry : decoded_) X509_free(entry.second);
+    }
+
+    std::vector<CertificateInfo> Run(const std::vector<std::string>& directories) {
+        for (const std::string& directory : directories) pool_.Submit([this, directory] { Walk(directory); });
+        pool_.WaitIdle();
+
+        // Every certificate found in each directory, for completing chains
+        std::unordered_map<std::string, STACK_OF(X509)*> siblings;
+        for (const CertificateFile& file : files_) {
+            if (file.chain == nullptr) continue;
+            STACK_OF(X509)*& certificates = siblings[file.directory];
+            if (certificates == nullptr) certificates = sk_X509_new_null();
+            for (int i = 0; certificates != nullptr && i < sk_X509_num(file.chain); i++) sk_X509_push(certificates, sk_X509_value(file.chain, i));
+        }
+
+        std::vector<CertificateInfo> results(files_.size());
+        for (size_t i = 0; i < files_.size(); i++) {
+            auto found = siblings.find(files_[i].directory);
+            STACK_OF(X509)* directoryCertificates = found != siblings.end() ? found->second : nullptr;
+            pool_.Submit([this, i, &results, directoryCertificates] { Analyse(files_[i], directoryCertificates, results[i]); });
+        }
+        pool_.WaitIdle();
+        for (auto& entry : siblings) sk_X509_free(entry.second); // Borrowed certificates
+
+        std::sort(results.begin(), results.end(), [](const CertificateInfo& a, const CertificateInfo& b) { return strcmp(a.source, b.source) < 0; });
+        return results;
+    }
+
+private:
+    void Walk(const std::string& directory) {
+        std::error_code error;
+        for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+            const std::filesystem::directory_entry& entry = *it;
+            std::error_code statusError;
+            // Directory symlinks are not followed, so links can't loop the walk
+            if (entry.is_directory(statusError) && !entry.is_symlink(statusError)) {
+                const std::string subdirectory = entry.path().string();
+                pool_.Submit([this, subdirectory] { Walk(subdirectory); });
+            } else if (entry.is_regular_file(statusError) && IsCertificateFile(entry.path())) {
+                CertificateFile file;
+                file.path = entry.path().string();
+                file.directory = directory;
+                pool_.Submit([this, file]() mutable {
+                    if (!Parse(file)) return;
+                    std::lock_guard<std::mutex> guard(lock_);
+                    files_.push_back(file);
+                });
+            }
+        }
+    }
+
+    // False for a file with no certificate of its own (a key); file.error
+    // is set if it could not be read or parsed
+    bool Parse(CertificateFile& file) {
+        std::string data;
+        if (!ReadFile(file.path, data, file.error)) return true;
+        file.chain = sk_X509_new_null();
+        if (file.chain == NULL) {
+            file.error = ENOMEM;
+            return true;
+        }
+        bool pem = false, pemCertificate = false;
+        for (size_t at = 0; (at = data.find("-----BEGIN ", at)) != std::string::npos;) {
+            pem = true;
+            const size_t labelStart = at + 11;
+            const size_t labelEnd = data.find("-----", labelStart);
+            if (labelEnd == std::string::npos) break;
+            const std::string label = data.substr(labelStart, labelEnd - labelStart);
+            const std::string endLine = "-----END " + label + "-----";
+            size_t end = data.find(endLine, labelEnd);
+            if (end == std::string::npos) break;
+            end += endLine.size();
+            // Keys and parameters bundled with the certificates are skipped
+            if (label == "CERTIFICATE" || label == "X509 CERTIFICATE" || label == "TRUSTED CERTIFICATE") {
+                pemCertificate = true;
+                if (X509* certificate = Decode(data.substr(at, end - at), true)) sk_X509_push(file.chain, certificate);
+            }
+            at = end;
+        }
+        if (!pem) {
+            if (X509* certificate = Decode(data, false)) sk_X509_push(file.chain, certificate);
+        }
+        if (sk_X509_num(file.chain) > 0) return true;
+        sk_X509_free(file.chain);
+        file.chain = nullptr;
+        if (pem && !pemCertificate) return false;
+        file.error = EINVAL;
+        return true;
+    }
+
+    // A reference to the certificate encoded in data, decoded on first sight
+    X509* Decode(const std::string& data, bool pem) {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            auto found = decoded_.find(data);
+            if (found != decoded_.end()) {
+                X509_up_ref(found->second);
+                return found->second;
+            }
+        }
+        X509* certificate = NULL;
+        if (pem) {
+            BIO* bio = BIO_new_mem_buf(data.data(), static_cast<int>(data.size()));
+            if (bio != NULL) certificate = PEM_read_bio_X509_AUX(bio, NULL, NULL, NULL);
+            BIO_free(bio);
+        } else {
+            const unsigned char* der = reinterpret_cast<const unsigned char*>(data.data());
+            certificate = d2i_X509(NULL, &der, static_cast<long>(data.size()));
+        }
+        ERR_clear_error();
+        if (certificate == NULL) return NULL;
+        std::lock_guard<std::mutex> guard(lock_);
+        auto inserted = decoded_.emplace(data, certificate);
+        if (!inserted.second) {
+            X509_free(certificate); // Another thread decoded it meanwhile
+            certificate = inserted.first->second;
+        }
+        X509_up_ref(certificate);
+        return certificate;
+    }
+
+    static void Analyse(const CertificateFile& file, STACK_OF(X509)* siblings, CertificateInfo& info) {
+        memset(&info, 0, sizeof(info));
+        info.connectUs = info.handshakeUs = -1;
+        CopyText(info.source, sizeof(info.source), file.path);
+        if (file.chain == nullptr) {
+            info.status = CERT_SCAN_UNREADABLE;
+            info.error = file.error;
+            return;
+        }
+        Describe(file.chain, info);
+
+        X509* leaf = sk_X509_value(file.chain, 0);
+        int error = VerifyChain(leaf, file.chain);
+        if (IssuerMissing(error) && siblings != nullptr && sk_X509_num(siblings) > sk_X509_num(file.chain)) {
+            // Incomplete as a server certificate file, but maybe not untrusted
+            info.issues |= CERT_ISSUE_INCOMPLETE_CHAIN;
+            error = VerifyChain(leaf, siblings);
+            if (error != X509_V_OK) info.issues |= CERT_ISSUE_UNTRUSTED;
+        } else {
+            info.issues |= VerifyIssues(error);
+        }
+        info.verifyError = error;
+    }
+
+    ThreadPool pool_;
+    std::mutex lock_; // Guards files_ and decoded_
+    std::vector<CertificateFile> files_;
+    std::unordered_map<std::string, X509*> decoded_;
+};
+
+struct CertificateScan {
+    std::vector<CertificateInfo> results;
+};
+
+enum class Phase { Waiting, Resolving, Connecting, Handshaking, Done };
+
+struct Handshake {
+    std::string serverName;
+    bool literal = false; // serverName is an IP address: no SNI, checked as an address
+    Phase phase = Phase::Waiting;
+    Clock::time_point deadline;
+    Clock::time_point phaseStarted;
+    std::vector<SocketAddress> addresses;
+    size_t nextAddress = 0;
+    int lastError = 0;
+    SocketHandle socket = InvalidSocket;
+    SSL* ssl = nullptr;
+};
+
+struct Expiry {
+    Clock::time_point deadline;
+    size_t handshake;
+    bool operator>(const Expiry& other) const { return deadline > other.deadline; }
+};
+
+class EndpointScanner {
+public:
+    EndpointScanner(const char* const* serverNames, const char* const* addresses, const int* ports, const int* timeoutsMs, CertificateInfo* results)
+        : serverNames_(serverNames), addresses_(addresses), ports_(ports), timeoutsMs_(timeoutsMs), results_(results), resolver_(loop_) {}
+
+    ~EndpointScanner() {
+        for (Handshake& handshake : handshakes_) Close(handshake, true);
+    }
+
+    bool Run(int count) {
+        if (!loop_.IsValid()) return false;
+        handshakes_.resize(static_cast<size_t>(count));
+        size_t next = 0;
+        std::vector<EventLoop::Event> events;
+        while (true) {
+            while (next < handshakes_.size() && active_ < MaxInFlight) Start(next++);
+            const int resolverWaitMs = resolver_.Tick();
+            if (active_ == 0) {
+                if (next < handshakes_.size()) continue;
+                break;
+            }
+
+            const auto now = Clock::now();
+            int waitMs = resolverWaitMs;
+            if (!expiries_.empty()) {
+                int expiryMs = expiries_.top().deadline > now
+                    ? static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(expiries_.top().deadline - now).count()) + 1
+                    : 0;
+                waitMs = waitMs < 0 ? expiryMs : std::min(waitMs, expiryMs);
+            }
+            if (!loop_.Wait(waitMs, events)) return false;
+            for (const EventLoop::Event& event : events) {
+                if (AsyncResolver::OwnsToken(event.token)) resolver_.OnEvent(event);
+                else OnEvent(static_cast<size_t>(event.token));
+            }
+            ExpireOverdue();
+        }
+        return true;
+    }
+
+private:
+    void Start(size_t index) {
+        Handshake& handshake = handshakes_[index];
+        CertificateInfo& result = results_[index];
+        memset(&result, 0, sizeof(result));
+        result.connectUs = result.handshakeUs = -1;
+        const char* name = serverNames_[index];
+        const char* address = addresses_ != NULL && addresses_[index] != NULL && addresses_[index][0] != '\0' ? addresses_[index] : name;
+        const int port = ports_ != NULL ? ports_[index] : DefaultPort;
+        if (name == NULL || name[0] == '\0' || port <= 0 || port > 65535) {
+            if (name != NULL) CopyText(result.source, sizeof(result.source), name);
+            result.status = CERT_SCAN_UNRESOLVED;
+            result.error = EINVAL;
+            handshake.phase = Phase::Done;
+            return;
+        }
+        CopyText(result.source, sizeof(result.source), name);
+        handshake.serverName = name;
+        SocketAddress parsed;
+        handshake.literal = superpanel::ParseAddressLiteral(name, 0, parsed);
+        const int timeoutMs = timeoutsMs_ != NULL && timeoutsMs_[index] > 0 ? timeoutsMs_[index] : DefaultTimeoutMs;
+        handshake.deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        expiries_.push(Expiry{handshake.deadline, index});
+        active_++;
+
+        handshake.phase = Phase::Resolving;
+        // May call back before returning (literals, cached names)
+        resolver_.Resolve(address, port, handshake.deadline,
+                          [this, index](int error, const std::vector<SocketAddress>& addresses) { OnResolved(index, error, addresses); });
+    }
+
+    void OnResolved(size_t index, int error, const std::vector<SocketAddress>& addresses) {
+        Handshake& handshake = handshakes_[index];
+        if (handshake.phase != Phase::Resolving) return; // Timed out meanwhile
+        if (error != 0) {
+            Fail(index, CERT_SCAN_UNRESOLVED, error);
+            return;
+        }
+        handshake.addresses = addresses;
+        handshake.nextAddress = 0;
+        ConnectNext(index);
+    }
+
+    void ConnectNext(size_t index) {
+        Handshake& handshake = handshakes_[index];
+        while (handshake.nextAddress < handshake.addresses.size() && Clock::now() < handshake.deadline) {
+            const SocketAddress& address = handshake.addresses[handshake.nextAddress++];
+            SocketHandle socket = superpanel::OpenNonBlockingSocket(address.Family(), SOCK_STREAM, IPPROTO_TCP);
+            if (socket == InvalidSocket) {
+                handshake.lastError = address.Family() == AF_INET6 ? EAFNOSUPPORT : EMFILE;
+                continue;
+            }
+            handshake.phaseStarted = Clock::now();
+            int error = superpanel::StartConnect(socket, address.Get(), address.length);
+            if (error != 0 && error != EINPROGRESS) {
+                superpanel::AbortSocket(socket);
+                handshake.lastError = error;
+                continue;
+            }
+            handshake.socket = socket;
+            handshake.phase = Phase::Connecting;
+            if (!loop_.Add(socket, EventLoop::Writable, index)) {
+                Fail(index, CERT_SCAN_CONNECT_FAILED, errno != 0 ? errno : EMFILE);
+            }
+            return;
+        }
+        if (Clock::now() >= handshake.deadline) Fail(index, CERT_SCAN_TIMEOUT, ETIMEDOUT);
+        else Fail(index, CERT_SCAN_CONNECT_FAILED, handshake.lastError != 0 ? handshake.lastError : EHOSTUNREACH);
+    }
+
+    void OnEvent(size_t index) {
+        Handshake& handshake = handshakes_[index];
+        if (handshake.phase == Phase::Connecting) {
+            int error = superpanel::PendingSocketError(handshake.socket);
+            if (error != 0) {
+                loop_.Remove(handshake.socket);
+                Close(handshake, true);
+                handshake.lastError = error;
+                ConnectNext(index);
+                return;
+            }
+            results_[index].connectUs = MicrosecondsSince(handshake.phaseStarted);
+            StartTls(index);
+        } else if (handshake.phase == Phase::Handshaking) {
+            Continue(index);
+        }
+    }
+
+    void StartTls(size_t index) {
+        Handshake& handshake = handshakes_[index];
+        SSL_CTX* context = superpanel::TlsClientContext();
+        SSL* ssl = context != NULL ? SSL_new(context) : NULL;
+        if (ssl == NULL || SSL_set_fd(ssl, static_cast<int>(handshake.socket)) != 1) {
+            if (ssl != NULL) SSL_free(ssl);
+            Fail(index, CERT_SCAN_TLS_FAILED, ENOMEM);
+            return;
+        }
+        handshake.ssl = ssl;
+        // Finish the handshake whatever the certificate, key size or
+        // protocol, so weak setups are reported rather than unreachable. The
+        // verification result is still recorded, with the dates left to
+        // Describe.
+        SSL_set_verify(ssl, SSL_VERIFY_NONE, NULL);
+        SSL_set_security_level(ssl, 0);
+        SSL_set_min_proto_version(ssl, TLS1_VERSION);
+        X509_VERIFY_PARAM_set_flags(SSL_get0_param(ssl), X509_V_FLAG_NO_CHECK_TIME);
+        if (!handshake.literal) SSL_set_tlsext_host_name(ssl, handshake.serverName.c_str());
+        SSL_set_connect_state(ssl);
+        handshake.phase = Phase::Handshaking;
+        handshake.phaseStarted = Clock::now();
+        Continue(index);
+    }
+
+    void Continue(size_t index) {
+        Handshake& handshake = handshakes_[index];
+        ERR_clear_error();
+        int done = SSL_do_handshake(handshake.ssl);
+        if (done == 1) {
+            Complete(index);
+            return;
+        }
+        switch (SSL_get_error(handshake.ssl, done)) {
+        case SSL_ERROR_WANT_READ: loop_.Modify(handshake.socket, EventLoop::Readable, index); return;
+        case SSL_ERROR_WANT_WRITE: loop_.Modify(handshake.socket, EventLoop::Writable, index); return;
+        default: Fail(index, CERT_SCAN_TLS_FAILED, EPROTO); return;
+        }
+    }
+
+    void Complete(size_t index) {
+        Handshake& handshake = handshakes_[index];
+        CertificateInfo& result = results_[index];
+        result.handshakeUs = MicrosecondsSince(handshake.phaseStarted);
+        CopyText(result.protocol, sizeof(result.protocol), SSL_get_version(handshake.ssl));
+        STACK_OF(X509)* chain = SSL_get_peer_cert_chain(handshake.ssl); // The client's view starts with the leaf
+        if (chain == NULL || sk_X509_num(chain) == 0) {
+            Fail(index, CERT_SCAN_TLS_FAILED, EPROTO);
+            return;
+        }
+        Describe(chain, result);
+        const long error = SSL_get_verify_result(handshake.ssl);
+        result.verifyError = error;
+        result.issues |= VerifyIssues(static_cast<int>(error));
+        X509* leaf = sk_X509_value(chain, 0);
+        const int matched = handshake.literal ? X509_check_ip_asc(leaf, handshake.serverName.c_str(), 0)
+                                              : X509_check_host(leaf, handshake.serverName.c_str(), handshake.serverName.size(), 0, NULL);
+        if (matched != 1) result.issues |= CERT_ISSUE_NAME_MISMATCH;
+        result.status = CERT_SCAN_OK;
+
+        SSL_shutdown(handshake.ssl); // One close_notify; the reply is not awaited
+        loop_.Remove(handshake.socket);
+        Close(handshake, false);
+        handshake.phase = Phase::Done;
+        active_--;
+    }
+
+    void Fail(size_t index, long long status, int error) {
+        Handshake& handshake = handshakes_[index];
+        if (handshake.phase == Phase::Done) return;
+        results_[index].status = status;
+        results_[index].error = error;
+        if (handshake.socket != InvalidSocket) {
+            loop_.Remove(handshake.socket);
+            Close(handshake, true);
+        }
+        handshake.phase = Phase::Done;
+        active_--;
+    }
+
+    static void Close(Handshake& handshake, bool abort) {
+        if (handshake.ssl != nullptr) SSL_free(handshake.ssl);
+        handshake.ssl = nullptr;
+        if (handshake.socket == InvalidSocket) return;
+        if (abort) superpanel::AbortSocket(handshake.socket);
+        else superpanel::CloseSocket(handshake.socket);
+        handshake.socket = InvalidSocket;
+    }
+
+    void ExpireOverdue() {
+        const auto now = Clock::now();
+        while (!expiries_.empty() && expiries_.top().deadline <= now) {
+            const size_t index = expiries_.top().handshake;
+            expiries_.pop();
+            Fail(index, CERT_SCAN_TIMEOUT, ETIMEDOUT);
+        }
+    }
+
+    const char* const* serverNames_;
+    const char* const* addresses_;
+    const int* ports_;
+    const int* timeoutsMs_;
+    CertificateInfo* results_;
+
+    EventLoop loop_;
+    AsyncResolver resolver_;
+    std::vector<Handshake> handshakes_;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiries_;
+    size_t active_ = 0;
+};
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* ScanCertificateFiles(const char* const* directories, int directoryCount, int threadCount) {
+    if (directories == NULL || directoryCount <= 0) return NULL;
+    std::vector<std::string> roots;
+    for (int i = 0; i < directoryCount; i++) {
+        if (directories[i] != NULL && directories[i][0] != '\0') roots.push_back(directories[i]);
+    }
+    auto* scan = new CertificateScan();
+    FileScanner scanner(threadCount > 0 ? static_cast<unsigned>(threadCount) : 0);
+    scan->results = scanner.Run(roots);
+    return scan;
+}
+
+SUPERPANEL_API int GetCertificateScanResults(void* scan, int first, int maxCount, CertificateInfo* results) {
+    if (scan == NULL) return 0;
+    const std::vector<CertificateInfo>& all = static_cast<CertificateScan*>(scan)->results;
+    if (results != NULL && first >= 0 && maxCount > 0 && static_cast<size_t>(first) < all.size()) {
+        const size_t count = std::min(all.size() - static_cast<size_t>(first), static_cast<size_t>(maxCount));
+        memcpy(results, all.data() + first, count * sizeof(CertificateInfo));
+    }
+    return static_cast<int>(all.size());
+}
+
+SUPERPANEL_API void ReleaseCertificateScan(void* scan) {
+    delete static_cast<CertificateScan*>(scan);
+}
+
+SUPERPANEL_API int ScanTlsEndpoints(const char* const* serverNames, const char* const* addresses, const int* ports,
+                                    const int* timeoutsMs, int count, CertificateInfo* results) {
+    if (count <= 0) return 0;
+    if (serverNames == NULL || results == NULL || !superpanel::InitializeSockets()) return -1;
+
+    EndpointScanner scanner(serverNames, addresses, ports, timeoutsMs, results);
+    if (!scanner.Run(count)) return -1;
+    int completed = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].status == CERT_SCAN_OK) completed++;
+    }
+    return completed;
+}
+
+} // extern "C"
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Outcome of scanning one file or endpoint
+#define CERT_SCAN_OK             0
+#define CERT_SCAN_UNREADABLE     1 // A certificate file that could not be read or parsed
+#define CERT_SCAN_UNRESOLVED     2
+#define CERT_SCAN_CONNECT_FAILED 3
+#define CERT_SCAN_TLS_FAILED     4 // Handshake failed before a certificate was seen
+#define CERT_SCAN_TIMEOUT        5
+
+// Problems found with a certificate or its chain
+#define CERT_ISSUE_EXPIRED          0x001
+#define CERT_ISSUE_NOT_YET_VALID    0x002
+#define CERT_ISSUE_SELF_SIGNED      0x004
+#define CERT_ISSUE_UNTRUSTED        0x008 // No path to a system root; verifyError says why
+#define CERT_ISSUE_INCOMPLETE_CHAIN 0x010 // The file or server omits an intermediate
+#define CERT_ISSUE_CHAIN_ORDER      0x020 // A certificate is not followed by its issuer
+#define CERT_ISSUE_CHAIN_EXPIRED    0x040 // An intermediate has expired
+#define CERT_ISSUE_NAME_MISMATCH    0x080 // Endpoints: the server name is not covered
+#define CERT_ISSUE_WEAK_KEY         0x100 // RSA or DSA under 2048 bits
+#define CERT_ISSUE_WEAK_SIGNATURE   0x200 // MD5 or SHA-1 signature below the root
+
+struct CertificateInfo {
+    long long status;      // CERT_SCAN_*
+    long long issues;      // CERT_ISSUE_* bits
+    long long verifyError; // X509_V_ERR_* that stopped chain verification, else 0
+    long long notBefore;   // Unix seconds
+    long long notAfter;
+    long long nameCount;   // Subject alternative names, listed or not
+    long long chainLength; // Certificates in the file, or presented by the server
+    long long keyBits;
+    long long ca;          // 1 if the first certificate is a CA (a chain or root file)
+    long long connectUs;   // Endpoints only, else -1
+    long long handshakeUs;
+    long long error;       // errno-style code of the failure, 0 otherwise
+    char source[512];      // File path, or the server name of an endpoint
+    char subject[256];     // RFC 2253
+    char issuer[256];
+    char names[1024];      // DNS names and IP addresses, comma-separated, cut at a name
+    char fingerprint[65];  // SHA-256 of the certificate, hex
+    char protocol[16];     // Negotiated TLS version, endpoints only
+};
+
+extern "C" {
+    // Parses every certificate file (.pem, .crt, .cer, .der, .cert) under
+    // the directories on a thread pool, following file symlinks but not
+    // directory ones. Each file yields one entry describing its first
+    // certificate; the rest of the file is its chain. A file without a
+    // certificate of its own (a private key) is skipped. A chain that stops
+    // short is completed from the other certificates in the same directory
+    // (Let's Encrypt's cert.pem and chain.pem) before the file is called
+    // untrusted, though it is still flagged incomplete. Entries are sorted
+    // by path. threadCount <= 0 uses one thread per core. Returns a handle
+    // for GetCertificateScanResults, or NULL on bad arguments.
+    SUPERPANEL_API void* ScanCertificateFiles(const char* const* directories, int directoryCount, int threadCount);
+    // Copies up to maxCount entries starting at first. Returns the total
+    // number of entries, so maxCount 0 asks for the size.
+    SUPERPANEL_API int GetCertificateScanResults(void* scan, int first, int maxCount, CertificateInfo* results);
+    SUPERPANEL_API void ReleaseCertificateScan(void* scan);
+
+    // Handshakes with count TLS endpoints at once on one event loop, like
+    // CheckHttp, and reports the certificate each one serves. serverNames
+    // are sent as SNI and checked against the certificate. addresses (may
+    // be NULL, as may any entry) says where to connect instead of resolving
+    // the name, so "127.0.0.1" for every name checks what the local web
+    // server presents for each virtual host. ports may be NULL for 443 and
+    // timeoutsMs NULL for 5 s each. The handshake completes whatever the
+    // certificate; trust problems are reported as issues. Returns the
+    // number of handshakes completed, or -1 if the event loop cannot be
+    // created.
+    SUPERPANEL_API int ScanTlsEndpoints(const char* const* serverNames, const char* const* addresses, const int* ports,
+                                        const int* timeoutsMs, int count, CertificateInfo* results);
+}
@@ -0,0 +1,1197 @@
+#include "pch.h"
+#include "ChunkStore.h"
+#include "BackupFiles.h"
+#include "FileJournal.h"
+#include "Hash.h"
+#include "IoThrottle.h"
+#include "Sketches.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <openssl/evp.h>
+#include <zlib.h>
+
+#ifdef _WIN32
+#pragma comment(lib, "zlib.lib")
+#pragma comment(lib, "libcrypto.lib")
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using superpanel::ByteReader;
+using superpanel::ByteWriter;
+using superpanel::FileJournal;
+using superpanel::FileState;
+using superpanel::OpenFile;
+using superpanel::ReadWholeFile;
+using superpanel::ReplaceFile;
+using superpanel::SafeRelativeName;
+using superpanel::SeekFile;
+using superpanel::SourceInfo;
+using superpanel::SyncFile;
+using superpanel::ThreadPool;
+using superpanel::ThrottleBackupIo;
+namespace fs = std::filesystem;
+
+namespace {
+
+// FastCDC parameters. Changing any of them (or the gear table) changes every
+// cut point, so existing chunks would stop deduplicating against new backups.
+const size_t MinChunkSize = 16 * 1024;
+const size_t AverageChunkSize = 64 * 1024;
+const size_t MaxChunkSize = 256 * 1024;
+// Normalised chunking: a stricter mask before the average size and a looser
+// one after it pull chunk sizes towards the average. The gear hash shifts
+// left, so its top bits depend on the most bytes.
+const uint64_t MaskSmall = ~0ULL << (64 - 18);
+const uint64_t MaskLarge = ~0ULL << (64 - 14);
+
+// Files are read and cut in segments of this size; each segment is then
+// hashed and compressed as one task
+const size_t SegmentSize = 8 * 1024 * 1024;
+const long long DefaultMemoryBudget = 256LL * 1024 * 1024;
+const uint64_t PackSizeLimit = 256ULL * 1024 * 1024;
+
+const uint8_t ChunkStored = 0;
+const uint8_t ChunkDeflated = 1;
+// Pack record header: id, method, raw length, stored length
+const size_t RecordHeaderSize = 32 + 1 + 4 + 4;
+
+const uint32_t IndexMagic = 0x49435053;    // "SPCI"
+const uint32_t ManifestMagic = 0x464D5053; // "SPMF"
+const uint32_t FormatVersion = 1;
+
+const uint32_t PendingPack = UINT32_MAX;
+
+const std::array<uint64_t, 256>& GearTable() {
+    static const std::array<uint64_t, 256> table = [] {
+        std::array<uint64_t, 256> values{};
+        uint64_t state = 0x5350434443484E4BULL; // Fixed seed: the table must never change
+        for (uint64_t& value : values) {
+            // splitmix64
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table;
+}
+
+// Length of the next chunk at the start of data
+size_t FindCut(const unsigned char* data, size_t length) {
+    if (length <= MinChunkSize) return length;
+    const std::array<uint64_t, 256>& gear = GearTable();
+    size_t limit = std::min(length, MaxChunkSize);
+    size_t normal = std::min(limit, AverageChunkSize);
+    uint64_t hash = 0;
+    size_t i = MinChunkSize;
+    for (; i < normal; i++) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & MaskSmall) == 0) return i + 1;
+    }
+    for (; i < limit; i++) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((hash & MaskLarge) == 0) return i + 1;
+    }
+    return limit;
+}
+
+struct ChunkId {
+    unsigned char bytes[32];
+    bool operator==(const ChunkId& other) const { return memcmp(bytes, other.bytes, sizeof(bytes)) == 0; }
+};
+
+struct ChunkIdHash {
+    size_t operator()(const ChunkId& id) const {
+        size_t value;
+        memcpy(&value, id.bytes, sizeof(value)); // Already uniformly distributed
+        return value;
+    }
+};
+
+using ChunkSet = std::unordered_set<ChunkId, ChunkIdHash>;
+
+// OpenSSL picks the SHA-NI / AVX2 implementation for the running CPU
+void HashChunk(const unsigned char* data, size_t length, ChunkId& id) {
+    EVP_Digest(data, length, id.bytes, nullptr, EVP_sha256(), nullptr);
+}
+
+struct ChunkLocation {
+    uint32_t pack = PendingPack;
+    uint64_t offset = 0; // Of the record header
+    uint32_t storedLength = 0;
+    uint32_t rawLength = 0;
+    uint8_t method = ChunkStored;
+};
+
+// Open pack files for one reader, closed together
+class PackReader {
+public:
+    explicit PackReader(const std::string& root) : root_(root) {}
+    ~PackReader() {
+        for (auto& pack : files_) fclose(pack.second);
+    }
+
+    PackReader(const PackReader&) = delete;
+    PackReader& operator=(const PackReader&) = delete;
+
+    FILE* Get(uint32_t pack);
+
+private:
+    std::string root_;
+    std::unordered_map<uint32_t, FILE*> files_;
+};
+
+std::string PackPath(const std::string& root, uint32_t pack) {
+    char name[32];
+    snprintf(name, sizeof(name), "pack-%08u.dat", pack);
+    return (fs::u8path(root) / "packs" / name).u8string();
+}
+
+FILE* PackReader::Get(uint32_t pack) {
+    auto it = files_.find(pack);
+    if (it != files_.end()) return it->second;
+    FILE* file = OpenFile(PackPath(root_, pack), "rb");
+    if (file != nullptr) files_[pack] = file;
+    return file;
+}
+
+class Store {
+public:
+    ~Store() { Close(); }
+
+    bool Open(const std::string& root);
+    void Close();
+
+    // True if the chunk is new and the caller must Append it (or Abandon the
+    // reservation); concurrent callers with the same chunk see it as present.
+    bool Reserve(const ChunkId& id);
+    void Abandon(const ChunkId& id);
+    bool Append(const ChunkId& id, uint8_t method, uint32_t rawLength, const unsigned char* data, uint32_t storedLength);
+    bool Lookup(const ChunkId& id, ChunkLocation& location);
+
+    // Makes appended chunks durable and records them in the index. Must
+    // happen before any manifest that references them is written.
+    bool Commit();
+
+    bool ReadChunk(const ChunkId& id, PackReader& reader, std::vector<unsigned char>& raw, std::vector<unsigned char>& scratch);
+    long long Prune(const ChunkSet& live);
+
+    const std::string& Root() const { return root_; }
+
+    // Held by running jobs and prunes, which must not overlap
+    std::mutex jobLock;
+    // One reference per open handle and per running job
+    std::atomic<int> refs{1};
+
+private:
+    bool LoadIndex();
+    bool SaveIndex();
+    uint64_t ScanPack(uint32_t pack, uint64_t from);
+    // After a failed write or sync: drops what the active pack holds past
+    // its last sync, so no index entry points at torn or lost bytes, and
+    // leaves the next Append to start a new pack
+    void AbandonActivePack();
+
+    std::string root_;
+    std::mutex lock_;
+    std::unordered_map<ChunkId, ChunkLocation, ChunkIdHash> index_;
+    std::vector<uint64_t> packLengths_; // Bytes of each pack covered by the index
+    FILE* activePack_ = nullptr;
+    uint32_t activePackId_ = PendingPack;
+    uint64_t syncedLength_ = 0; // Bytes of the active pack known to be on disk
+#ifndef _WIN32
+    int lockFd_ = -1;
+#endif
+};
+
+void DropStoreReference(Store* store) {
+    if (store->refs.fetch_sub(1) == 1) delete store;
+}
+
+bool Store::Open(const std::string& root) {
+    root_ = root;
+    std::error_code ec;
+    fs::create_directories(fs::u8path(root) / "packs", ec);
+    if (ec) return false;
+
+#ifndef _WIN32
+    std::string lockPath = (fs::u8path(root) / "lock").u8string();
+    lockFd_ = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lockFd_ < 0 || flock(lockFd_, LOCK_EX | LOCK_NB) != 0) return false;
+#endif
+
+    if (!LoadIndex()) {
+        // Rebuilt from the packs below
+        index_.clear();
+        packLengths_.clear();
+    }
+
+    // Chunks appended after the last index save (e.g. a crash mid-backup) are
+    // recovered from the self-describing pack records
+    for (fs::directory_iterator it(fs::u8path(root) / "packs", ec), end; !ec && it != end; it.increment(ec)) {
+        unsigned pack;
+        char tail;
+        if (sscanf(it->path().filename().u8string().c_str(), "pack-%08u.da%c", &pack, &tail) != 2 || tail != 't') continue;
+        if (pack >= packLengths_.size()) packLengths_.resize(pack + 1, 0);
+        std::error_code sizeError;
+        uint64_t size = fs::file_size(it->path(), sizeError);
+        if (!sizeError && size > packLengths_[pack]) packLengths_[pack] = ScanPack(pack, packLengths_[pack]);
+    }
+    return true;
+}
+
+void Store::Close() {
+    Commit();
+    std::lock_guard<std::mutex> guard(lock_);
+    if (activePack_ != nullptr) fclose(activePack_);
+    activePack_ = nullptr;
+#ifndef _WIN32
+    if (lockFd_ >= 0) close(lockFd_);
+    lockFd_ = -1;
+#endif
+}
+
+bool Store::LoadIndex() {
+    std::string contents;
+    if (!ReadWholeFile((fs::u8path(root_) / "index.bin").u8string(), contents)) return false;
+    ByteReader reader(contents.data(), contents.size());
+
+    uint32_t magic = 0, version = 0, packCount = 0;
+    if (!reader.Read(magic) || !reader.Read(version) || magic != IndexMagic || version != FormatVersion) return false;
+    if (!reader.Read(packCount) || packCount > reader.Remaining() / sizeof(uint64_t)) return false;
+    packLengths_.resize(packCount);
+    for (uint64_t& length : packLengths_) {
+        if (!reader.Read(length)) return false;
+    }
+
+    uint64_t count = 0;
+    if (!reader.Read(count)) return false;
+    index_.reserve(static_cast<size_t>(std::min<uint64_t>(count, reader.Remaining() / 53)));
+    for (uint64_t i = 0; i < count; i++) {
+        ChunkId id;
+        ChunkLocation location;
+        if (!reader.ReadBytes(id.bytes, sizeof(id.bytes)) || !reader.Read(location.pack) || !reader.Read(location.offset) ||
+            !reader.Read(location.storedLength) || !reader.Read(location.rawLength) || !reader.Read(location.method)) {
+            return false;
+        }
+        index_[id] = location;
+    }
+    return true;
+}
+
+bool Store::SaveIndex() {
+    std::string contents;
+    contents.reserve(16 + packLengths_.size() * 8 + index_.size() * 53);
+    ByteWriter writer(contents);
+    writer.Write(IndexMagic);
+    writer.Write(FormatVersion);
+    writer.Write(static_cast<uint32_t>(packLengths_.size()));
+    for (uint64_t length : packLengths_) writer.Write(length);
+
+    uint64_t count = 0;
+    for (const auto& entry : index_) {
+        if (entry.second.pack != PendingPack) count++;
+    }
+    writer.Write(count);
+    for (const auto& entry : index_) {
+        const ChunkLocation& location = entry.second;
+        if (location.pack == PendingPack) continue;
+        writer.WriteBytes(entry.first.bytes, sizeof(entry.first.bytes));
+        writer.Write(location.pack);
+        writer.Write(location.offset);
+        writer.Write(location.storedLength);
+        writer.Write(location.rawLength);
+        writer.Write(location.method);
+    }
+    return ReplaceFile((fs::u8path(root_) / "index.bin").u8string(), contents);
+}
+
+uint64_t Store::ScanPack(uint32_t pack, uint64_t from) {
+    FILE* file = OpenFile(PackPath(root_, pack), "rb");
+    if (file == nullptr || !SeekFile(file, from)) {
+        if (file != nullptr) fclose(file);
+        return from;
+    }
+
+    uint64_t offset = from;
+    unsigned char header[RecordHeaderSize];
+    std::vector<unsigned char> data;
+    while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        ChunkId id;
+        ChunkLocation location;
+        ByteReader reader(reinterpret_cast<const char*>(header), sizeof(header));
+        reader.ReadBytes(id.bytes, sizeof(id.bytes));
+        reader.Read(location.method);
+        reader.Read(location.rawLength);
+        reader.Read(location.storedLength);
+        if (location.rawLength > MaxChunkSize || location.storedLength > compressBound(MaxChunkSize)) break;
+        // A torn final record (crash mid-append) ends the scan
+        data.resize(location.storedLength);
+        if (fread(data.data(), 1, data.size(), file) != data.size()) break;
+        location.pack = pack;
+        location.offset = offset;
+        index_[id] = location;
+        offset += RecordHeaderSize + location.storedLength;
+    }
+    fclose(file);
+    return offset;
+}
+
+bool Store::Reserve(const ChunkId& id) {
+    std::lock_guard<std::mutex> guard(lock_);
+    return index_.emplace(id, ChunkLocation()).second;
+}
+
+void Store::Abandon(const ChunkId& id) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = index_.find(id);
+    if (it != index_.end() && it->second.pack == PendingPack) index_.erase(it);
+}
+
+bool Store::Append(const ChunkId& id, uint8_t method, uint32_t rawLength, const unsigned char* data, uint32_t storedLength) {
+    std::string header;
+    ByteWriter writer(header);
+    writer.WriteBytes(id.bytes, sizeof(id.bytes));
+    writer.Write(method);
+    writer.Write(rawLength);
+    writer.Write(storedLength);
+
+    std::lock_guard<std::mutex> guard(lock_);
+    uint64_t recordSize = RecordHeaderSize + storedLength;
+    if (activePack_ == nullptr || packLengths_[activePackId_] + recordSize > PackSizeLimit) {
+        // A new pack per session: a pack left torn by a crash is never appended to
+        if (activePack_ != nullptr) {
+            if (!SyncFile(activePack_)) {
+                AbandonActivePack();
+                return false;
+            }
+            fclose(activePack_);
+            activePack_ = nullptr;
+        }
+        activePackId_ = static_cast<uint32_t>(packLengths_.size());
+        activePack_ = OpenFile(PackPath(root_, activePackId_), "wb");
+        if (activePack_ == nullptr) return false;
+        setvbuf(activePack_, nullptr, _IOFBF, 1024 * 1024);
+        packLengths_.push_back(0);
+        syncedLength_ = 0;
+    }
+
+    if (fwrite(header.data(), 1, header.size(), activePack_) != header.size() ||
+        fwrite(data, 1, storedLength, activePack_) != storedLength) {
+        AbandonActivePack();
+        return false;
+    }
+    ChunkLocation& location = index_[id];
+    location.pack = activePackId_;
+    location.offset = packLengths_[activePackId_];
+    location.storedLength = storedLength;
+    location.rawLength = rawLength;
+    location.method = method;
+    packLengths_[activePackId_] += recordSize;
+    return true;
+}
+
+bool Store::Lookup(const ChunkId& id, ChunkLocation& location) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = index_.find(id);
+    if (it == index_.end() || it->second.pack == PendingPack) return false;
+    location = it->second;
+    return true;
+}
+
+bool Store::Commit() {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (root_.empty()) return false;
+    if (activePack_ != nullptr) {
+        if (!SyncFile(activePack_)) {
+            AbandonActivePack();
+            return false;
+        }
+        syncedLength_ = packLengths_[activePackId_];
+    }
+    return SaveIndex();
+}
+
+void Store::AbandonActivePack() {
+    fclose(activePack_);
+    activePack_ = nullptr;
+    std::error_code ec;
+    fs::resize_file(fs::u8path(PackPath(root_, activePackId_)), syncedLength_, ec);
+    for (auto it = index_.begin(); it != index_.end();) {
+        if (it->second.pack == activePackId_ && it->second.offset >= syncedLength_) {
+            it = index_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    packLengths_[activePackId_] = syncedLength_;
+}
+
+bool Store::ReadChunk(const ChunkId& id, PackReader& reader, std::vector<unsigned char>& raw, std::vector<unsigned char>& scratch) {
+    ChunkLocation location;
+    if (!Lookup(id, location)) return false;
+    FILE* pack = reader.Get(location.pack);
+    if (pack == nullptr || !SeekFile(pack, location.offset + RecordHeaderSize)) return false;
+
+    scratch.resize(location.storedLength);
+    if (fread(scratch.data(), 1, scratch.size(), pack) != scratch.size()) return false;
+
+    raw.resize(location.rawLength);
+    if (location.method == ChunkDeflated) {
+        uLongf length = static_cast<uLongf>(raw.size());
+        if (uncompress(raw.data(), &length, scratch.data(), static_cast<uLong>(scratch.size())) != Z_OK || length != raw.size()) return false;
+    } else if (location.method == ChunkStored && scratch.size() == raw.size()) {
+        raw.swap(scratch);
+    } else {
+        return false;
+    }
+
+    ChunkId actual;
+    HashChunk(raw.data(), raw.size(), actual);
+    return actual == id;
+}
+
+long long Store::Prune(const ChunkSet& live) {
+    std::vector<uint64_t> liveBytes;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        liveBytes.assign(packLengths_.size(), 0);
+        for (const auto& entry : index_) {
+            if (entry.second.pack != PendingPack && live.count(entry.first) > 0) {
+                liveBytes[entry.second.pack] += RecordHeaderSize + entry.second.storedLength;
+            }
+        }
+    }
+
+    // Packs under half live are rewritten; the rest keep their dead chunks,
+    // which stay indexed and can be referenced again by later backups
+    std::vector<uint32_t> rewrite;
+    uint64_t oldBytes = 0;
+    for (uint32_t pack = 0; pack < liveBytes.size(); pack++) {
+        if (pack == activePackId_ || packLengths_[pack] == 0 || liveBytes[pack] * 2 >= packLengths_[pack]) continue;
+        rewrite.push_back(pack);
+        oldBytes += packLengths_[pack];
+    }
+    if (rewrite.empty()) return 0;
+
+    std::unordered_set<uint32_t> rewritten(rewrite.begin(), rewrite.end());
+    std::vector<std::pair<ChunkId, ChunkLocation>> moving;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (auto it = index_.begin(); it != index_.end();) {
+            if (it->second.pack != PendingPack && rewritten.count(it->second.pack) > 0) {
+                if (live.count(it->first) > 0) moving.emplace_back(it->first, it->second);
+                it = index_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    uint64_t movedBytes = 0;
+    PackReader reader(root_);
+    std::vector<unsigned char> data;
+    for (const auto& chunk : moving) {
+        const ChunkLocation& location = chunk.second;
+        FILE* pack = reader.Get(location.pack);
+        data.resize(location.storedLength);
+        if (pack == nullptr || !SeekFile(pack, location.offset + RecordHeaderSize) || fread(data.data(), 1, data.size(), pack) != data.size() ||
+            !Append(chunk.first, location.method, location.rawLength, data.data(), location.storedLength)) {
+            // Leave the old packs in place; the index is rebuilt from them on the next open
+            return -1;
+        }
+        movedBytes += RecordHeaderSize + location.storedLength;
+    }
+
+    // The index must point at the new copies before the old packs go away
+    if (!Commit()) return -1;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (uint32_t pack : rewrite) {
+            std::error_code ec;
+            fs::remove(fs::u8path(PackPath(root_, pack)), ec);
+            packLengths_[pack] = 0;
+        }
+    }
+    Commit();
+    return static_cast<long long>(oldBytes - std::min(oldBytes, movedBytes));
+}
+
+struct ManifestEntry {
+    std::string name;
+    bool directory = false;
+    uint32_t mode = 0;
+    int64_t modified = 0;
+    uint64_t size = 0;
+    std::vector<ChunkId> chunks;
+};
+
+bool WriteManifest(const std::string& path, const std::deque<ManifestEntry>& entries) {
+    std::string contents;
+    ByteWriter writer(contents);
+    writer.Write(ManifestMagic);
+    writer.Write(FormatVersion);
+    writer.Write(static_cast<uint64_t>(entries.size()));
+    for (const ManifestEntry& entry : entries) {
+        writer.Write(static_cast<uint8_t>(entry.directory ? 1 : 0));
+        writer.Write(entry.mode);
+        writer.Write(entry.modified);
+        writer.Write(entry.size);
+        writer.Write(static_cast<uint32_t>(entry.name.size()));
+        writer.WriteBytes(entry.name.data(), entry.name.size());
+        writer.Write(static_cast<uint32_t>(entry.chunks.size()));
+        for (const ChunkId& id : entry.chunks) writer.WriteBytes(id.bytes, sizeof(id.bytes));
+    }
+    return ReplaceFile(path, contents);
+}
+
+bool ReadManifest(const std::string& path, std::vector<ManifestEntry>& entries) {
+    std::string contents;
+    if (!ReadWholeFile(path, contents)) return false;
+    ByteReader reader(contents.data(), contents.size());
+
+    uint32_t magic = 0, version = 0;
+    uint64_t count = 0;
+    if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(count) || magic != ManifestMagic || version != FormatVersion) return false;
+    entries.clear();
+    for (uint64_t i = 0; i < count; i++) {
+        ManifestEntry entry;
+        uint8_t directory = 0;
+        uint32_t nameLength = 0, chunkCount = 0;
+        if (!reader.Read(directory) || !reader.Read(entry.mode) || !reader.Read(entry.modified) || !reader.Read(entry.size) ||
+            !reader.Read(nameLength) || nameLength > reader.Remaining()) {
+            return false;
+        }
+        entry.directory = directory != 0;
+        entry.name.resize(nameLength);
+        if (!reader.ReadBytes(&entry.name[0], nameLength) || !reader.Read(chunkCount) || chunkCount > reader.Remaining() / sizeof(ChunkId)) return false;
+        entry.chunks.resize(chunkCount);
+        for (ChunkId& id : entry.chunks) reader.ReadBytes(id.bytes, sizeof(id.bytes));
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
+
+struct Segment {
+    std::vector<unsigned char> data;
+    std::vector<uint32_t> cuts; // End offset of each chunk in data
+    std::vector<ChunkId> ids;
+};
+
+struct FileWork {
+    ManifestEntry* entry = nullptr;
+    std::string path;
+    std::vector<std::shared_ptr<Segment>> segments;
+};
+
+struct StoreJob {
+    Store* store = nullptr;
+    std::string manifestPath;
+    std::string parentManifestPath; // Incremental backups
+    std::string journalPath;
+    std::vector<std::pair<std::string, std::string>> sources; // (path, prefix); backups
+    std::string targetDir;                                     // restores
+    int level = 6;
+    unsigned threadCount = 0;
+    long long maxSegmentsInFlight = 0;
+    std::atomic<long long> segmentsInFlight{0};
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> failed{false};
+    std::atomic<int> state{BACKUP_JOB_RUNNING};
+    std::atomic<long long> filesDone{0};
+    std::atomic<long long> bytesTotal{0};
+    std::atomic<long long> bytesRead{0};
+    std::atomic<long long> bytesNew{0};
+    std::atomic<long long> bytesStored{0};
+    std::atomic<long long> chunksTotal{0};
+    std::atomic<long long> chunksNew{0};
+    std::atomic<long long> errors{0};
+    std::atomic<long long> filesUnchanged{0};
+    std::atomic<long long> filesChanged{0};
+    std::atomic<long long> filesDeleted{0};
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::atomic<long long> elapsedMs{-1};
+    // One reference for the worker thread, one for the caller's handle
+    std::atomic<int> refs{2};
+
+    // Deques so pointers handed to tasks stay valid as they grow. The walk
+    // runs on several threads, so adding to them takes walkLock.
+    std::mutex walkLock;
+    std::deque<ManifestEntry> entries;
+    std::deque<FileWork> files;
+    std::deque<std::pair<ManifestEntry*, FileState>> journalled;
+};
+
+void DropJobReference(StoreJob* job) {
+    if (job->refs.fetch_sub(1) == 1) {
+        DropStoreReference(job->store);
+        delete job;
+    }
+}
+
+bool Stopped(const StoreJob& job) {
+    return job.cancelled || job.failed;
+}
+
+void ProcessSegment(StoreJob& job, Segment& segment) {
+    std::vector<unsigned char> compressed;
+    segment.ids.resize(segment.cuts.size());
+    uint32_t start = 0;
+    for (size_t i = 0; i < segment.cuts.size() && !Stopped(job); i++) {
+        const unsigned char* chunk = segment.data.data() + start;
+        uint32_t length = segment.cuts[i] - start;
+        ChunkId& id = segment.ids[i];
+        HashChunk(chunk, length, id);
+        job.chunksTotal++;
+
+        if (job.store->Reserve(id)) {
+            compressed.resize(compressBound(length));
+            uLongf compressedLength = static_cast<uLongf>(compressed.size());
+            bool deflated = compress2(compressed.data(), &compressedLength, chunk, length, job.level) == Z_OK && compressedLength < length;
+            const unsigned char* stored = deflated ? compressed.data() : chunk;
+            uint32_t storedLength = deflated ? static_cast<uint32_t>(compressedLength) : length;
+            if (!job.store->Append(id, deflated ? ChunkDeflated : ChunkStored, length, stored, storedLength)) {
+                job.store->Abandon(id);
+                job.failed = true;
+                break;
+            }
+            job.chunksNew++;
+            job.bytesNew += length;
+            job.bytesStored += static_cast<long long>(RecordHeaderSize + storedLength);
+        }
+        start = segment.cuts[i];
+    }
+    job.bytesRead += start;
+    std::vector<unsigned char>().swap(segment.data);
+}
+
+void ChunkFile(StoreJob& job, ThreadPool& pool, FileWork& work) {
+    FILE* file = OpenFile(work.path, "rb");
+    if (file == nullptr) {
+        job.errors++;
+        work.entry->size = 0;
+        return;
+    }
+    setvbuf(file, nullptr, _IONBF, 0);
+
+    uint64_t total = 0;
+    std::vector<unsigned char> carry;
+    bool done = false;
+    while (!done && !Stopped(job)) {
+        // Sized from the listed size so small files do not touch a whole
+        // segment; one byte extra tells whether the file has grown
+        uint64_t expected = work.entry->size > total ? work.entry->size - total : 0;
+        size_t request = static_cast<size_t>(std::min<uint64_t>(SegmentSize, expected + 1));
+        auto segment = std::make_shared<Segment>();
+        segment->data.swap(carry);
+        size_t carried = segment->data.size();
+        segment->data.resize(carried + request);
+        ThrottleBackupIo(request, job.cancelled);
+        size_t read = fread(segment->data.data() + carried, 1, request, file);
+        if (read < request) {
+            if (ferror(file)) job.errors++;
+            done = true;
+        }
+        segment->data.resize(carried + read);
+        total += read;
+
+        // Chunks that could still grow with the next read are carried over
+        size_t position = 0;
+        const size_t size = segment->data.size();
+        while (position < size && (done || size - position >= MaxChunkSize)) {
+            position += FindCut(segment->data.data() + position, size - position);
+            segment->cuts.push_back(static_cast<uint32_t>(position));
+        }
+        carry.assign(segment->data.begin() + position, segment->data.end());
+        segment->data.resize(position);
+        if (segment->cuts.empty()) continue;
+
+        work.segments.push_back(segment);
+        // Hash and compress on another worker while this one reads on; once
+        // the memory budget is used up, do it inline instead of waiting
+        if (job.segmentsInFlight.fetch_add(1) < job.maxSegmentsInFlight) {
+            pool.Submit([&job, segment] {
+                ProcessSegment(job, *segment);
+                job.segmentsInFlight--;
+            });
+        } else {
+            job.segmentsInFlight--;
+            ProcessSegment(job, *segment);
+        }
+    }
+    fclose(file);
+
+    // The size actually read, in case the file changed since it was listed
+    work.entry->size = total;
+    job.filesDone++;
+}
+
+void FinishJob(StoreJob& job, bool ok) {
+    job.elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job.started).count();
+    job.state = ok ? BACKUP_JOB_COMPLETED : (job.cancelled ? BACKUP_JOB_CANCELLED : BACKUP_JOB_FAILED);
+}
+
+uint64_t ChunkListHash(const std::vector<ChunkId>& chunks) {
+    return superpanel::XXH64(chunks.data(), chunks.size() * sizeof(ChunkId));
+}
+
+// Chunk list of an unchanged file from the parent manifest, or null if the
+// file has to be read. The journal's content hash ties its metadata to that
+// exact chunk list, so a journal and manifest that do not belong together
+// never lead to reusing the wrong data.
+const ManifestEntry* FindUnchanged(StoreJob& job, FileJournal& journal, const std::unordered_map<std::string, const ManifestEntry*>& parent,
+                                   const std::string& name, const FileState& current) {
+    FileState previous;
+    if (!journal.Lookup(name, previous) || !previous.SameMetadata(current)) return nullptr;
+    auto it = parent.find(name);
+    if (it == parent.end() || it->second->size != current.size || ChunkListHash(it->second->chunks) != previous.contentHash) return nullptr;
+    // A prune could only have dropped these chunks if the parent was deleted
+    ChunkLocation location;
+    for (const ChunkId& id : it->second->chunks) {
+        if (!job.store->Lookup(id, location)) return nullptr;
+    }
+    return it->second;
+}
+
+void RunBackup(StoreJob& job) {
+    std::lock_guard<std::mutex> storeGuard(job.store->jobLock);
+
+    std::vector<ManifestEntry> parentEntries;
+    std::unordered_map<std::string, const ManifestEntry*> parent;
+    if (!job.parentManifestPath.empty() && ReadManifest(job.parentManifestPath, parentEntries)) {
+        for (const ManifestEntry& entry : parentEntries) {
+            if (!entry.directory) parent[entry.name] = &entry;
+        }
+    }
+    FileJournal journal;
+    bool haveJournal = !job.journalPath.empty() && journal.Open(job.journalPath);
+
+    {
+        ThreadPool pool(job.threadCount);
+        std::atomic<long long> walkErrors{0};
+        auto visit = [&](const fs::path& path, const std::string& name, const SourceInfo& info) {
+            FileState current;
+            const ManifestEntry* unchanged = nullptr;
+            if (!info.directory) {
+                current.inode = info.inode;
+                current.device = info.device;
+                current.size = info.size;
+                current.modifiedNs = info.modifiedNs;
+                current.changedNs = info.changedNs;
+                if (haveJournal) unchanged = FindUnchanged(job, journal, parent, name, current);
+            }
+
+            std::lock_guard<std::mutex> guard(job.walkLock);
+            job.entries.emplace_back();
+            ManifestEntry& entry = job.entries.back();
+            entry.name = name;
+            entry.directory = info.directory;
+            entry.mode = info.mode;
+            entry.modified = static_cast<int64_t>(info.modified);
+            entry.size = info.directory ? 0 : info.size;
+            if (entry.directory) return !Stopped(job);
+            job.journalled.emplace_back(&entry, current);
+
+            if (unchanged != nullptr) {
+                entry.chunks = unchanged->chunks;
+                job.filesUnchanged++;
+                job.filesDone++;
+                return !Stopped(job);
+            }
+            job.filesChanged++;
+            if (entry.size == 0) {
+                job.filesDone++;
+                return !Stopped(job);
+            }
+
+            job.files.emplace_back();
+            FileWork& work = job.files.back();
+            work.entry = &entry;
+            work.path = path.u8string();
+            FileWork* pending = &work;
+            pool.Submit([&job, &pool, pending] {
+                if (!Stopped(job)) ChunkFile(job, pool, *pending);
+            });
+            return !Stopped(job);
+        };
+        for (const auto& source : job.sources) {
+            superpanel::ParallelWalkSource(source.first, source.second, pool, visit, walkErrors);
+        }
+        pool.WaitIdle();
+        job.errors += walkErrors;
+    }
+
+    bool ok = !Stopped(job);
+    if (ok) {
+        for (FileWork& work : job.files) {
+            for (const auto& segment : work.segments) {
+                work.entry->chunks.insert(work.entry->chunks.end(), segment->ids.begin(), segment->ids.end());
+            }
+            work.segments.clear();
+        }
+
+        std::vector<std::pair<std::string, FileState>> states;
+        states.reserve(job.journalled.size());
+        for (auto& file : job.journalled) {
+            // Files that grew or shrank while being read are not trusted next time
+            if (file.first->size != file.second.size) continue;
+            file.second.contentHash = ChunkListHash(file.first->chunks);
+            states.emplace_back(file.first->name, file.second);
+        }
+        if (haveJournal) job.filesDeleted = static_cast<long long>(journal.Unseen().size());
+        journal.Close();
+
+        // The parallel walk lists entries in no particular order
+        std::sort(job.entries.begin(), job.entries.end(), [](const ManifestEntry& a, const ManifestEntry& b) { return a.name < b.name; });
+        long long total = 0;
+        for (const ManifestEntry& entry : job.entries) total += static_cast<long long>(entry.size);
+        job.bytesTotal = total;
+        // Chunks first: a manifest must never reference chunks that could be lost
+        ok = job.store->Commit() && WriteManifest(job.manifestPath, job.entries);
+        if (ok && !job.journalPath.empty() && !FileJournal::Write(job.journalPath, states)) job.errors++;
+    }
+    // A failed job commits nothing: what it stored is saved by the next
+    // commit, or recovered from the packs when the store is reopened
+    FinishJob(job, ok);
+}
+
+void RestoreRange(StoreJob& job, const std::string& path, uint64_t offset, const ChunkId* ids, size_t count,
+                  std::shared_ptr<std::atomic<int>> remainingRanges) {
+    FILE* file = OpenFile(path, "r+b");
+    if (file == nullptr || !SeekFile(file, offset)) {
+        job.failed = true;
+        job.errors++;
+    } else {
+        setvbuf(file, nullptr, _IOFBF, 1024 * 1024);
+        PackReader reader(job.store->Root());
+        std::vector<unsigned char> raw, scratch;
+        for (size_t i = 0; i < count && !Stopped(job); i++) {
+            if (!job.store->ReadChunk(ids[i], reader, raw, scratch)) {
+                job.failed = true;
+                job.errors++;
+                break;
+            }
+            ThrottleBackupIo(raw.size(), job.cancelled);
+            if (fwrite(raw.data(), 1, raw.size(), file) != raw.size()) {
+                job.failed = true;
+                break;
+            }
+            job.bytesRead += static_cast<long long>(raw.size());
+        }
+    }
+    if (file != nullptr && fclose(file) != 0) job.failed = true;
+    if (remainingRanges->fetch_sub(1) == 1) job.filesDone++;
+}
+
+void ApplyMetadata(const fs::path& path, const ManifestEntry& entry) {
+#ifdef _WIN32
+    (void)path;
+    (void)entry;
+#else
+    std::string native = path.u8string();
+    chmod(native.c_str(), entry.mode & 07777);
+    struct timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_OMIT;
+    times[1].tv_sec = static_cast<time_t>(entry.modified);
+    times[1].tv_nsec = 0;
+    utimensat(AT_FDCWD, native.c_str(), times, 0);
+#endif
+}
+
+void RunRestore(StoreJob& job) {
+    std::lock_guard<std::mutex> storeGuard(job.store->jobLock);
+    std::vector<ManifestEntry> entries;
+    const fs::path target = fs::u8path(job.targetDir);
+    std::error_code ec;
+    if (!ReadManifest(job.manifestPath, entries) || (fs::create_directories(target, ec), ec)) {
+        FinishJob(job, false);
+        return;
+    }
+
+    long long total = 0;
+    for (const ManifestEntry& entry : entries) total += static_cast<long long>(entry.size);
+    job.bytesTotal = total;
+
+    {
+        ThreadPool pool(job.threadCount);
+        for (const ManifestEntry& entry : entries) {
+            if (Stopped(job)) break;
+            if (!SafeRelativeName(entry.name)) {
+                job.errors++;
+                continue;
+            }
+            fs::path path = target / fs::u8path(entry.name);
+            if (entry.directory) {
+                fs::create_directories(path, ec);
+                continue;
+            }
+
+            fs::create_directories(path.parent_path(), ec);
+            FILE* file = OpenFile(path.u8string(), "wb");
+            if (file == nullptr || fclose(file) != 0) {
+                job.errors++;
+                job.failed = true;
+                break;
+            }
+            if (entry.chunks.empty()) {
+                job.filesDone++;
+                continue;
+            }
+            fs::resize_file(path, entry.size, ec);
+
+            // Large files are restored as several ranges in parallel
+            std::vector<std::pair<size_t, uint64_t>> ranges; // (first chunk, file offset)
+            uint64_t offset = 0, rangeBytes = 0;
+            for (size_t i = 0; i < entry.chunks.size(); i++) {
+                ChunkLocation location;
+                if (!job.store->Lookup(entry.chunks[i], location)) {
+                    job.errors++;
+                    job.failed = true;
+                    break;
+                }
+                if (i == 0 || rangeBytes >= SegmentSize) {
+                    ranges.emplace_back(i, offset);
+                    rangeBytes = 0;
+                }
+                offset += location.rawLength;
+                rangeBytes += location.rawLength;
+            }
+            if (Stopped(job)) break;
+
+            auto remaining = std::make_shared<std::atomic<int>>(static_cast<int>(ranges.size()));
+            std::string native = path.u8string();
+            for (size_t r = 0; r < ranges.size(); r++) {
+                size_t first = ranges[r].first;
+                size_t last = r + 1 < ranges.size() ? ranges[r + 1].first : entry.chunks.size();
+                const ChunkId* ids = entry.chunks.data() + first;
+                uint64_t rangeOffset = ranges[r].second;
+                pool.Submit([&job, native, rangeOffset, ids, count = last - first, remaining] {
+                    RestoreRange(job, native, rangeOffset, ids, count, remaining);
+                });
+            }
+        }
+        pool.WaitIdle();
+    }
+
+    bool ok = !Stopped(job);
+    if (ok) {
+        // Directories last and deepest first, so restoring their contents
+        // does not bump their modification times again
+        for (const ManifestEntry& entry : entries) {
+            if (!entry.directory && SafeRelativeName(entry.name)) ApplyMetadata(target / fs::u8path(entry.name), entry);
+        }
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            if (it->directory && SafeRelativeName(it->name)) ApplyMetadata(target / fs::u8path(it->name), *it);
+        }
+    }
+    FinishJob(job, ok);
+}
+
+// Reads every distinct chunk a manifest references, checking each against
+// its SHA-256. Bad chunks are counted rather than ending the job, so the
+// result says how much of the backup is damaged.
+void RunVerify(StoreJob& job) {
+    std::lock_guard<std::mutex> storeGuard(job.store->jobLock);
+    std::vector<ManifestEntry> entries;
+    if (!ReadManifest(job.manifestPath, entries)) {
+        FinishJob(job, false);
+        return;
+    }
+
+    ChunkSet seen;
+    std::vector<ChunkId> ids;
+    long long total = 0;
+    for (const ManifestEntry& entry : entries) {
+        for (const ChunkId& id : entry.chunks) {
+            if (!seen.insert(id).second) continue;
+            ChunkLocation location;
+            if (!job.store->Lookup(id, location)) {
+                job.errors++;
+                continue;
+            }
+            ids.push_back(id);
+            total += location.rawLength;
+        }
+    }
+    job.bytesTotal = total;
+    job.chunksTotal = static_cast<long long>(ids.size());
+
+    {
+        ThreadPool pool(job.threadCount);
+        const size_t batchSize = 64;
+        for (size_t first = 0; first < ids.size(); first += batchSize) {
+            const ChunkId* batch = ids.data() + first;
+            size_t count = std::min(batchSize, ids.size() - first);
+            pool.Submit([&job, batch, count] {
+                PackReader reader(job.store->Root());
+                std::vector<unsigned char> raw, scratch;
+                for (size_t i = 0; i < count && !Stopped(job); i++) {
+                    if (!job.store->ReadChunk(batch[i], reader, raw, scratch)) {
+                        job.errors++;
+                        continue;
+                    }
+                    ThrottleBackupIo(raw.size(), job.cancelled);
+                    job.bytesRead += static_cast<long long>(raw.size());
+                }
+            });
+        }
+        pool.WaitIdle();
+    }
+    FinishJob(job, !Stopped(job) && job.errors == 0);
+}
+
+StoreJob* StartJob(Store* store, int threadCount) {
+    auto* job = new StoreJob();
+    store->refs++;
+    job->store = store;
+    job->threadCount = threadCount > 0 ? static_cast<unsigned>(threadCount) : ThreadPool::DefaultThreadCount();
+    return job;
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* OpenChunkStore(const char* rootDir) {
+    if (rootDir == NULL || rootDir[0] == '\0') return NULL;
+    auto* store = new Store();
+    if (!store->Open(rootDir)) {
+        delete store;
+        return NULL;
+    }
+    return store;
+}
+
+SUPERPANEL_API void CloseChunkStore(void* store) {
+    if (store == NULL) return;
+    DropStoreReference(static_cast<Store*>(store));
+}
+
+SUPERPANEL_API void* BackupToChunkStoreAsync(void* store, const char* manifestPath, const char* const* sources, const char* const* prefixes,
+                                             int sourceCount, int compressionLevel, int threadCount, long long memoryBudget) {
+    return IncrementalBackupToChunkStoreAsync(store, manifestPath, NULL, NULL, sources, prefixes, sourceCount, compressionLevel, threadCount, memoryBudget);
+}
+
+SUPERPANEL_API void* IncrementalBackupToChunkStoreAsync(void* store, const char* manifestPath, const char* parentManifestPath, const char* journalPath,
+                                                        const char* const* sources, const char* const* prefixes, int sourceCount,
+                                                        int compressionLevel, int threadCount, long long memoryBudget) {
+    if (store == NULL || manifestPath == NULL || manifestPath[0] == '\0' || sources == NULL || sourceCount <= 0) return NULL;
+
+    StoreJob* job = StartJob(static_cast<Store*>(store), threadCount);
+    job->manifestPath = manifestPath;
+    if (parentManifestPath != NULL) job->parentManifestPath = parentManifestPath;
+    if (journalPath != NULL) job->journalPath = journalPath;
+    for (int i = 0; i < sourceCount; i++) {
+        if (sources[i] == NULL || sources[i][0] == '\0') continue;
+        job->sources.emplace_back(sources[i], prefixes != NULL && prefixes[i] != NULL ? prefixes[i] : "");
+    }
+    job->level = compressionLevel > 0 ? std::min(compressionLevel, 9) : 6;
+    // Each segment in flight holds its data plus one chunk being compressed
+    long long budget = memoryBudget > 0 ? memoryBudget : DefaultMemoryBudget;
+    job->maxSegmentsInFlight = std::max(budget / static_cast<long long>(SegmentSize + MaxChunkSize), static_cast<long long>(job->threadCount));
+
+    std::thread([job] {
+        RunBackup(*job);
+        DropJobReference(job);
+    }).detach();
+    return job;
+}
+
+SUPERPANEL_API void* RestoreFromChunkStoreAsync(void* store, const char* manifestPath, const char* targetDir, int threadCount) {
+    if (store == NULL || manifestPath == NULL || targetDir == NULL || targetDir[0] == '\0') return NULL;
+
+    StoreJob* job = StartJob(static_cast<Store*>(store), threadCount);
+    job->manifestPath = manifestPath;
+    job->targetDir = targetDir;
+
+    std::thread([job] {
+        RunRestore(*job);
+        DropJobReference(job);
+    }).detach();
+    return job;
+}
+
+SUPERPANEL_API void* VerifyChunkStoreBackupAsync(void* store, const char* manifestPath, int threadCount) {
+    if (store == NULL || manifestPath == NULL || manifestPath[0] == '\0') return NULL;
+
+    StoreJob* job = StartJob(static_cast<Store*>(store), threadCount);
+    job->manifestPath = manifestPath;
+
+    std::thread([job] {
+        RunVerify(*job);
+        DropJobReference(job);
+    }).detach();
+    return job;
+}
+
+SUPERPANEL_API int GetChunkStoreProgress(void* handle, ChunkStoreProgress* progress) {
+    if (handle == NULL) return BACKUP_JOB_FAILED;
+    auto* job = static_cast<StoreJob*>(handle);
+    if (progress != NULL) {
+        progress->filesDone = job->filesDone;
+        progress->bytesTotal = job->bytesTotal;
+        progress->bytesRead = job->bytesRead;
+        progress->bytesNew = job->bytesNew;
+        progress->bytesStored = job->bytesStored;
+        progress->chunksTotal = job->chunksTotal;
+        progress->chunksNew = job->chunksNew;
+        progress->errors = job->errors;
+        progress->filesUnchanged = job->filesUnchanged;
+        progress->filesChanged = job->filesChanged;
+        progress->filesDeleted = job->filesDeleted;
+        long long elapsed = job->elapsedMs;
+        progress->elapsedMs = elapsed >= 0
+            ? elapsed
+            : std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job->started).count();
+    }
+    return job->state;
+}
+
+SUPERPANEL_API void CancelChunkStoreJob(void* handle) {
+    if (handle == NULL) return;
+    static_cast<StoreJob*>(handle)->cancelled = true;
+}
+
+SUPERPANEL_API void ReleaseChunkStoreJob(void* handle) {
+    if (handle == NULL) return;
+    DropJobReference(static_cast<StoreJob*>(handle));
+}
+
+SUPERPANEL_API long long PruneChunkStore(void* handle, const char* const* manifestPaths, int manifestCount) {
+    if (handle == NULL || (manifestCount > 0 && manifestPaths == NULL)) return -1;
+    auto* store = static_cast<Store*>(handle);
+
+    ChunkSet live;
+    std::vector<ManifestEntry> entries;
+    for (int i = 0; i < manifestCount; i++) {
+        if (manifestPaths[i] == NULL || !ReadManifest(manifestPaths[i], entries)) return -1;
+        for (const ManifestEntry& entry : entries) live.insert(entry.chunks.begin(), entry.chunks.end());
+    }
+
+    std::lock_guard<std::mutex> guard(store->jobLock);
+    return store->Prune(live);
+}
+
+} // extern "C"
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include "BackupArchive.h" // BACKUP_JOB_* states
+
+struct ChunkStoreProgress {
+    long long filesDone;
+    long long bytesTotal;   // Total file bytes in the manifest (backups: set once it is written; verify: chunk bytes)
+    long long bytesRead;    // Backup: source bytes chunked; restore: bytes restored; verify: chunk bytes checked
+    long long bytesNew;     // Backup: raw bytes of chunks not already in the store
+    long long bytesStored;  // Backup: bytes appended to packfiles (after compression)
+    long long chunksTotal;
+    long long chunksNew;
+    long long elapsedMs;
+    long long errors;       // Unreadable source files, or missing/corrupt chunks on restore and verify
+    // Backup change detection: files taken unchanged from the parent manifest
+    // without reading them, files read (new or modified), and files in the
+    // journal that no longer exist
+    long long filesUnchanged;
+    long long filesChanged;
+    long long filesDeleted;
+};
+
+extern "C" {
+    // Deduplicating backup store rooted at a directory. Files are split into
+    // content-defined chunks (FastCDC gear hash, 16-256 KB, ~64 KB average) so
+    // an edit only changes the chunks around it; each chunk is named by its
+    // SHA-256 and stored once, deflated, in append-only packfiles. A backup is
+    // a manifest file listing each path's metadata and chunk IDs.
+    //
+    // The store is locked against other processes while open (NULL if it is in
+    // use). The handle is reference counted: closing it while jobs run is safe.
+    SUPERPANEL_API void* OpenChunkStore(const char* rootDir);
+    SUPERPANEL_API void CloseChunkStore(void* store);
+
+    // Chunks sources into the store and writes the manifest to manifestPath.
+    // sources/prefixes/compressionLevel/threadCount/memoryBudget are as for
+    // WriteBackupArchiveAsync. Returns a job handle, or NULL on bad arguments.
+    SUPERPANEL_API void* BackupToChunkStoreAsync(void* store, const char* manifestPath, const char* const* sources, const char* const* prefixes,
+                                                 int sourceCount, int compressionLevel, int threadCount, long long memoryBudget);
+    // Incremental variant. journalPath holds the file states (inode, size,
+    // mtime, ctime, content hash) recorded by the previous backup of the same
+    // tree; files whose state is unchanged take their chunk list from
+    // parentManifestPath without being read, so only new and modified files
+    // cost I/O. The tree is stat-walked in parallel. The result is still a
+    // complete manifest, restorable on its own. On success the journal is
+    // replaced with the new states. Either path may be NULL (full backup).
+    SUPERPANEL_API void* IncrementalBackupToChunkStoreAsync(void* store, const char* manifestPath, const char* parentManifestPath, const char* journalPath,
+                                                            const char* const* sources, const char* const* prefixes, int sourceCount,
+                                                            int compressionLevel, int threadCount, long long memoryBudget);
+    // Recreates a manifest's tree under targetDir. Chunks are verified against
+    // their SHA-256 as they are read.
+    SUPERPANEL_API void* RestoreFromChunkStoreAsync(void* store, const char* manifestPath, const char* targetDir, int threadCount);
+
+    // Reads every chunk a manifest references through the I/O limiter and
+    // checks it against its SHA-256. The job fails if any chunk is missing or
+    // corrupt; errors counts them.
+    SUPERPANEL_API void* VerifyChunkStoreBackupAsync(void* store, const char* manifestPath, int threadCount);
+
+    SUPERPANEL_API int GetChunkStoreProgress(void* job, ChunkStoreProgress* progress);
+    SUPERPANEL_API void CancelChunkStoreJob(void* job);
+    // Releases the caller's reference; a running job frees itself when done.
+    SUPERPANEL_API void ReleaseChunkStoreJob(void* job);
+
+    // Reclaims space from chunks no longer referenced by any of the given
+    // manifests (which must be every manifest still in use). Packfiles that
+    // are mostly garbage are rewritten; the rest keep their dead chunks until
+    // they cross that threshold. Returns the bytes freed, or -1 if a manifest
+    // could not be read (nothing is deleted then).
+    SUPERPANEL_API long long PruneChunkStore(void* store, const char* const* manifestPaths, int manifestCount);
+}
@@ -0,0 +1,919 @@
+#include "pch.h"
+#include "DnsResolver.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace superpanel {
+
+int SocketAddress::Family() const {
+    return length > 0 ? reinterpret_cast<const sockaddr*>(bytes)->sa_family : AF_UNSPEC;
+}
+
+void SocketAddress::SetPort(int port) {
+    const auto value = htons(static_cast<unsigned short>(port));
+    if (Family() == AF_INET) reinterpret_cast<sockaddr_in*>(bytes)->sin_port = value;
+    else if (Family() == AF_INET6) reinterpret_cast<sockaddr_in6*>(bytes)->sin6_port = value;
+}
+
+bool ParseAddressLiteral(const char* host, int port, SocketAddress& address) {
+    if (host == NULL) return false;
+    std::string text(host);
+    if (text.size() > 2 && text.front() == '[' && text.back() == ']') text = text.substr(1, text.size() - 2);
+
+    memset(address.bytes, 0, sizeof(address.bytes));
+    auto* ipv4 = reinterpret_cast<sockaddr_in*>(address.bytes);
+    if (inet_pton(AF_INET, text.c_str(), &ipv4->sin_addr) == 1) {
+        ipv4->sin_family = AF_INET;
+        address.length = sizeof(sockaddr_in);
+        address.SetPort(port);
+        return true;
+    }
+
+    std::string scope;
+    size_t percent = text.find('%');
+    if (percent != std::string::npos) {
+        scope = text.substr(percent + 1);
+        text.resize(percent);
+    }
+    auto* ipv6 = reinterpret_cast<sockaddr_in6*>(address.bytes);
+    if (inet_pton(AF_INET6, text.c_str(), &ipv6->sin6_addr) != 1) {
+        address.length = 0;
+        return false;
+    }
+    ipv6->sin6_family = AF_INET6;
+    if (!scope.empty()) {
+        char* end = nullptr;
+        unsigned long index = strtoul(scope.c_str(), &end, 10);
+#ifndef _WIN32
+        if (end == scope.c_str() || *end != '\0') index = if_nametoindex(scope.c_str());
+#endif
+        ipv6->sin6_scope_id = static_cast<uint32_t>(index);
+    }
+    address.length = sizeof(sockaddr_in6);
+    address.SetPort(port);
+    return true;
+}
+
+} // namespace superpanel
+
+using superpanel::EventLoop;
+using superpanel::InvalidSocket;
+using superpanel::SocketAddress;
+using superpanel::SocketHandle;
+
+namespace {
+
+const uint16_t TypeA = 1;
+const uint16_t TypeCname = 5;
+const uint16_t TypeSoa = 6;
+const uint16_t TypeAaaa = 28;
+const uint16_t TypeOpt = 41;
+const int RcodeNameError = 3;
+const size_t MaxCacheEntries = 4096;
+// Hosts and resolv.conf are re-read when they change, checked this often
+const auto FileCheckInterval = std::chrono::seconds(1);
+// How often a pending getaddrinfo fallback is polled
+const int FallbackPollMs = 10;
+
+std::string Lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return text;
+}
+
+// A file that is re-parsed when its modification time changes
+struct WatchedFile {
+    fs::path path;
+    fs::file_time_type modified{};
+    Clock::time_point checked{};
+    bool loaded = false;
+
+    // True if the file should be (re)parsed now
+    bool Changed() {
+        auto now = Clock::now();
+        if (loaded && now - checked < FileCheckInterval) return false;
+        checked = now;
+        std::error_code error;
+        auto time = fs::last_write_time(path, error);
+        if (error) time = fs::file_time_type{};
+        if (loaded && time == modified) return false;
+        modified = time;
+        loaded = true;
+        return true;
+    }
+};
+
+fs::path SystemFile(const char* unixPath, const char* windowsName) {
+#ifdef _WIN32
+    (void)unixPath;
+    char directory[MAX_PATH];
+    UINT length = GetSystemDirectoryA(directory, MAX_PATH);
+    return fs::path(std::string(directory, length)) / "drivers" / "etc" / windowsName;
+#else
+    (void)windowsName;
+    return fs::path(unixPath);
+#endif
+}
+
+struct ResolverConfig {
+    std::vector<SocketAddress> servers;
+    std::vector<std::string> search;
+    int ndots = 1;
+    int attempts = 2;
+    int timeoutMs = 1000;
+    uint32_t minTtl = 5;
+    uint32_t maxTtl = 3600;
+    uint32_t negativeTtl = 30;
+};
+
+struct CacheEntry {
+    int error = 0;
+    std::vector<SocketAddress> addresses;
+    Clock::time_point expires;
+};
+
+// Process-wide resolver state: configuration, the hosts file and the cache
+class ResolverState {
+public:
+    ResolverConfig Config() {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (resolvConf_.Changed()) LoadResolvConf();
+        ResolverConfig config = system_;
+        if (!overrideServers_.empty()) config.servers = overrideServers_;
+        config.timeoutMs = timeoutMs_;
+        config.minTtl = minTtl_;
+        config.maxTtl = maxTtl_;
+        config.negativeTtl = negativeTtl_;
+        return config;
+    }
+
+    void Configure(const char* nameservers, int timeoutMs, int minTtl, int maxTtl, int negativeTtl) {
+        std::lock_guard<std::mutex> guard(lock_);
+        overrideServers_.clear();
+        if (nameservers != NULL) {
+            std::stringstream list(nameservers);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                SocketAddress server;
+                if (ParseServer(item, server)) overrideServers_.push_back(server);
+            }
+        }
+        timeoutMs_ = timeoutMs > 0 ? timeoutMs : 1000;
+        minTtl_ = minTtl > 0 ? static_cast<uint32_t>(minTtl) : 5;
+        maxTtl_ = std::max(minTtl_, maxTtl > 0 ? static_cast<uint32_t>(maxTtl) : 3600u);
+        negativeTtl_ = negativeTtl > 0 ? static_cast<uint32_t>(negativeTtl) : 30;
+        cache_.clear();
+    }
+
+    bool LookupHostsFile(const std::string& name, std::vector<SocketAddress>& addresses) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (hostsFile_.Changed()) LoadHostsFile();
+        auto found = hosts_.find(name);
+        if (found == hosts_.end()) return false;
+        addresses = found->second;
+        return true;
+    }
+
+    bool LookupCache(const std::string& name, CacheEntry& entry) {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto found = cache_.find(name);
+        if (found == cache_.end()) return false;
+        if (found->second.expires <= Clock::now()) {
+            cache_.erase(found);
+            return false;
+        }
+        entry = found->second;
+        return true;
+    }
+
+    void Store(const std::string& name, int error, const std::vector<SocketAddress>& addresses, uint32_t ttl) {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto now = Clock::now();
+        if (cache_.size() >= MaxCacheEntries) {
+            for (auto it = cache_.begin(); it != cache_.end();) it = it->second.expires <= now ? cache_.erase(it) : std::next(it);
+            if (cache_.size() >= MaxCacheEntries) cache_.clear();
+        }
+        CacheEntry& entry = cache_[name];
+        entry.error = error;
+        entry.addresses = addresses;
+        entry.expires = now + std::chrono::seconds(ttl);
+    }
+
+    void Flush() {
+        std::lock_guard<std::mutex> guard(lock_);
+        cache_.clear();
+    }
+
+    void SetHostsFile(const char* path) {
+        std::lock_guard<std::mutex> guard(lock_);
+        hostsFile_ = WatchedFile{path != NULL && path[0] != '\0' ? fs::u8path(path) : SystemFile("/etc/hosts", "hosts")};
+        hosts_.clear();
+        cache_.clear();
+    }
+
+private:
+    static bool ParseServer(std::string text, SocketAddress& server) {
+        text.erase(0, text.find_first_not_of(" \t"));
+        text.erase(text.find_last_not_of(" \t\r\n") + 1);
+        int port = 53;
+        // "host:port" and "[v6]:port"; a bare IPv6 address has several colons
+        size_t colon = text.rfind(':');
+        if (colon != std::string::npos && (text[0] == '[' || text.find(':') == colon)) {
+            port = atoi(text.c_str() + colon + 1);
+            text.resize(colon);
+        }
+        return port > 0 && port <= 65535 && superpanel::ParseAddressLiteral(text.c_str(), port, server);
+    }
+
+    void LoadResolvConf() {
+        system_ = ResolverConfig();
+        FILE* file = fopen(resolvConf_.path.string().c_str(), "r");
+        if (file == NULL) return;
+        char line[512];
+        while (fgets(line, sizeof(line), file)) {
+            std::stringstream words(line);
+            std::string keyword, value;
+            words >> keyword;
+            if (keyword == "nameserver" && words >> value) {
+                SocketAddress server;
+                if (superpanel::ParseAddressLiteral(value.c_str(), 53, server)) system_.servers.push_back(server);
+            } else if (keyword == "search" || keyword == "domain") {
+                system_.search.clear();
+                while (words >> value) system_.search.push_back(Lowercase(value));
+            } else if (keyword == "options") {
+                while (words >> value) {
+                    if (value.compare(0, 6, "ndots:") == 0) system_.ndots = std::min(15, atoi(value.c_str() + 6));
+                    else if (value.compare(0, 9, "attempts:") == 0) system_.attempts = std::max(1, std::min(5, atoi(value.c_str() + 9)));
+                }
+            }
+        }
+        fclose(file);
+    }
+
+    void LoadHostsFile() {
+        hosts_.clear();
+        FILE* file = fopen(hostsFile_.path.string().c_str(), "r");
+        if (file == NULL) return;
+        char line[1024];
+        while (fgets(line, sizeof(line), file)) {
+            if (char* comment = strchr(line, '#')) *comment = '\0';
+            std::stringstream words(line);
+            std::string text, name;
+            SocketAddress address;
+            if (!(words >> text) || !superpanel::ParseAddressLiteral(text.c_str(), 0, address)) continue;
+            while (words >> name) hosts_[Lowercase(name)].push_back(address);
+        }
+        fclose(file);
+    }
+
+    std::mutex lock_;
+    WatchedFile resolvConf_{SystemFile("/etc/resolv.conf", "resolv.conf")};
+    WatchedFile hostsFile_{SystemFile("/etc/hosts", "hosts")};
+    ResolverConfig system_;
+    std::vector<SocketAddress> overrideServers_;
+    int timeoutMs_ = 1000;
+    uint32_t minTtl_ = 5;
+    uint32_t maxTtl_ = 3600;
+    uint32_t negativeTtl_ = 30;
+    std::unordered_map<std::string, std::vector<SocketAddress>> hosts_;
+    std::unordered_map<std::string, CacheEntry> cache_;
+};
+
+ResolverState& State() {
+    static ResolverState state;
+    return state;
+}
+
+// IPv4 first: most targets answer there, and a host without IPv6 routing
+// fails an IPv6 connect only after trying it
+std::vector<SocketAddress> OrderAddresses(std::vector<SocketAddress> addresses, int port) {
+    std::stable_sort(addresses.begin(), addresses.end(),
+                     [](const SocketAddress& a, const SocketAddress& b) { return a.Family() == AF_INET && b.Family() != AF_INET; });
+    for (SocketAddress& address : addresses) address.SetPort(port);
+    return addresses;
+}
+
+bool ValidHostName(const std::string& name) {
+    if (name.empty() || name.size() > 253) return false;
+    size_t label = 0;
+    for (char c : name) {
+        if (c == '.') {
+            if (label == 0) return false;
+            label = 0;
+        } else if (++label > 63 || static_cast<unsigned char>(c) <= ' ') {
+            return false;
+        }
+    }
+    return label > 0;
+}
+
+// Names to query in order, following resolv(5): names with at least ndots
+// dots are tried as given first, others after the search domains
+std::vector<std::string> Candidates(const std::string& name, const ResolverConfig& config) {
+    std::vector<std::string> candidates;
+    if (name.back() == '.') {
+        candidates.push_back(name.substr(0, name.size() - 1));
+        return candidates;
+    }
+    const int dots = static_cast<int>(std::count(name.begin(), name.end(), '.'));
+    if (dots >= config.ndots) candidates.push_back(name);
+    for (const std::string& domain : config.search) {
+        if (ValidHostName(name + "." + domain)) candidates.push_back(name + "." + domain);
+    }
+    if (dots < config.ndots) candidates.push_back(name);
+    return candidates;
+}
+
+void Put16(std::vector<unsigned char>& out, uint16_t value) {
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+std::vector<unsigned char> BuildQuery(const std::string& name, uint16_t id, uint16_t type) {
+    std::vector<unsigned char> query;
+    Put16(query, id);
+    Put16(query, 0x0100); // Recursion desired
+    Put16(query, 1);      // One question
+    Put16(query, 0);
+    Put16(query, 0);
+    Put16(query, 1); // EDNS0, so answers up to 1232 bytes are not truncated
+    size_t start = 0;
+    while (start < name.size()) {
+        size_t dot = name.find('.', start);
+        if (dot == std::string::npos) dot = name.size();
+        query.push_back(static_cast<unsigned char>(dot - start));
+        query.insert(query.end(), name.begin() + static_cast<std::ptrdiff_t>(start), name.begin() + static_cast<std::ptrdiff_t>(dot));
+        start = dot + 1;
+    }
+    query.push_back(0);
+    Put16(query, type);
+    Put16(query, 1); // IN
+    query.push_back(0);
+    Put16(query, TypeOpt);
+    Put16(query, 1232);
+    Put16(query, 0);
+    Put16(query, 0);
+    Put16(query, 0);
+    return query;
+}
+
+uint16_t Get16(const unsigned char* data) {
+    return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+uint32_t Get32(const unsigned char* data) {
+    return static_cast<uint32_t>(data[0]) << 24 | static_cast<uint32_t>(data[1]) << 16 | static_cast<uint32_t>(data[2]) << 8 | data[3];
+}
+
+bool SkipName(const unsigned char* data, size_t length, size_t& position) {
+    while (position < length) {
+        unsigned char label = data[position];
+        if (label == 0) {
+            position++;
+            return true;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            position += 2; // A compression pointer ends the name
+            return position <= length;
+        }
+        position += 1 + label;
+    }
+    return false;
+}
+
+struct Response {
+    uint16_t id = 0;
+    int rcode = 0;
+    bool truncated = false; // TC: the answer did not fit the datagram
+    std::vector<SocketAddress> addresses;
+    uint32_t ttl = UINT32_MAX;         // Lowest TTL along the answer chain
+    uint32_t negativeTtl = UINT32_MAX; // From the SOA when there is no answer
+};
+
+// Every A/AAAA in the answer section belongs to the queried name or its
+// CNAME chain, since the server answered a single question
+bool ParseResponse(const unsigned char* data, size_t length, Response& response) {
+    if (length < 12 || (data[2] & 0x80) == 0) return false;
+    response.id = Get16(data);
+    response.rcode = data[3] & 0x0F;
+    response.truncated = (data[2] & 0x02) != 0;
+    const unsigned questions = Get16(data + 4), answers = Get16(data + 6), authority = Get16(data + 8);
+    size_t position = 12;
+    for (unsigned i = 0; i < questions; i++) {
+        if (!SkipName(data, length, position) || (position += 4) > length) return false;
+    }
+    for (unsigned i = 0; i < answers + authority; i++) {
+        if (!SkipName(data, length, position) || position + 10 > length) return false;
+        const uint16_t type = Get16(data + position);
+        const uint32_t ttl = Get32(data + position + 4);
+        const size_t rdlength = Get16(data + position + 8);
+        position += 10;
+        if (position + rdlength > length) return false;
+        const unsigned char* rdata = data + position;
+
+        if (i < answers) {
+            SocketAddress address;
+            memset(address.bytes, 0, sizeof(address.bytes));
+            if (type == TypeA && rdlength == 4) {
+                auto* ipv4 = reinterpret_cast<sockaddr_in*>(address.bytes);
+                ipv4->sin_family = AF_INET;
+                memcpy(&ipv4->sin_addr, rdata, 4);
+                address.length = sizeof(sockaddr_in);
+            } else if (type == TypeAaaa && rdlength == 16) {
+                auto* ipv6 = reinterpret_cast<sockaddr_in6*>(address.bytes);
+                ipv6->sin6_family = AF_INET6;
+                memcpy(&ipv6->sin6_addr, rdata, 16);
+                address.length = sizeof(sockaddr_in6);
+            }
+            if (address.length > 0) response.addresses.push_back(address);
+            if (address.length > 0 || type == TypeCname) response.ttl = std::min(response.ttl, ttl);
+        } else if (type == TypeSoa) {
+            // RFC 2308: the lower of the SOA's TTL and its MINIMUM field
+            size_t field = position;
+            if (SkipName(data, length, field) && SkipName(data, length, field) && field + 20 <= position + rdlength) {
+                response.negativeTtl = std::min(ttl, Get32(data + field + 16));
+            }
+        }
+        position += rdlength;
+    }
+    return true;
+}
+
+bool SendDatagram(SocketHandle socket, const std::vector<unsigned char>& data) {
+#ifdef _WIN32
+    return send(static_cast<SOCKET>(socket), reinterpret_cast<const char*>(data.data()), static_cast<int>(data.size()), 0) >= 0;
+#else
+    return send(socket, data.data(), data.size(), MSG_NOSIGNAL) >= 0;
+#endif
+}
+
+int ReceiveDatagram(SocketHandle socket, unsigned char* buffer, size_t size) {
+#ifdef _WIN32
+    return recv(static_cast<SOCKET>(socket), reinterpret_cast<char*>(buffer), static_cast<int>(size), 0);
+#else
+    return static_cast<int>(recv(socket, buffer, size, 0));
+#endif
+}
+
+uint16_t RandomId() {
+    static thread_local std::mt19937 random{std::random_device{}()};
+    return static_cast<uint16_t>(random());
+}
+
+uint32_t ClampTtl(uint32_t ttl, const ResolverConfig& config) {
+    return std::max(config.minTtl, std::min(config.maxTtl, ttl));
+}
+
+struct FallbackResult {
+    std::atomic<bool> done{false};
+    int error = 0;
+    std::vector<SocketAddress> addresses;
+};
+
+void RunFallback(std::shared_ptr<FallbackResult> result, std::string name) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* list = nullptr;
+    int status = getaddrinfo(name.c_str(), NULL, &hints, &list);
+    if (status == 0) {
+        for (addrinfo* entry = list; entry != nullptr; entry = entry->ai_next) {
+            if ((entry->ai_family != AF_INET && entry->ai_family != AF_INET6) || entry->ai_addrlen > sizeof(SocketAddress::bytes)) continue;
+            SocketAddress address;
+            memset(address.bytes, 0, sizeof(address.bytes));
+            memcpy(address.bytes, entry->ai_addr, entry->ai_addrlen);
+            address.length = static_cast<int>(entry->ai_addrlen);
+            result->addresses.push_back(address);
+        }
+        freeaddrinfo(list);
+    }
+    result->error = status == 0 ? 0 : (status == EAI_NONAME ? ENOENT : ETIMEDOUT);
+    result->done = true;
+}
+
+} // namespace
+
+namespace superpanel {
+
+struct AsyncResolver::Lookup {
+    struct Waiter {
+        int port;
+        Clock::time_point deadline;
+        Callback callback;
+    };
+
+    uint64_t id = 0;
+    std::string name;
+    ResolverConfig config;
+    std::vector<std::string> candidates;
+    size_t candidate = 0;
+    int attempt = 0; // Cycles through the servers
+    std::vector<Waiter> waiters;
+
+    SocketHandle socket = InvalidSocket;
+    uint16_t queryIds[2] = {0, 0}; // A, AAAA
+    bool answered[2] = {false, false};
+    bool truncated[2] = {false, false};
+    std::vector<SocketAddress> addresses;
+    uint32_t ttl = UINT32_MAX;
+    uint32_t negativeTtl = UINT32_MAX;
+    Clock::time_point attemptDeadline;
+    // Addresses from an earlier attempt where only one type was answered;
+    // returned if every attempt times out
+    std::vector<SocketAddress> partial;
+
+    // Truncated types are asked again over TCP, length-prefixed (RFC 7766)
+    bool tcp = false;
+    std::vector<unsigned char> tcpOut;
+    size_t tcpSent = 0;
+    std::vector<unsigned char> tcpIn;
+
+    std::shared_ptr<FallbackResult> fallback;
+
+    const std::vector<SocketAddress>& Partial() const { return addresses.empty() ? partial : addresses; }
+
+    // Records an answer to one of the queries; false if the server refused
+    // it and the attempt is over
+    bool Accept(const Response& response) {
+        int index = response.id == queryIds[0] ? 0 : response.id == queryIds[1] ? 1 : -1;
+        if (index < 0 || answered[index]) return true;
+
+        if (response.rcode == RcodeNameError) {
+            // The name does not exist for any type
+            answered[0] = answered[1] = true;
+            truncated[0] = truncated[1] = false;
+            negativeTtl = std::min(negativeTtl, response.negativeTtl);
+        } else if (response.rcode != 0) {
+            // SERVFAIL, REFUSED: give the next server a go right away
+            attemptDeadline = Clock::now();
+            return false;
+        } else if (response.truncated && !tcp) {
+            // Possibly missing records, and an empty truncated answer says
+            // nothing about whether the name has any
+            answered[index] = truncated[index] = true;
+        } else {
+            answered[index] = true;
+            addresses.insert(addresses.end(), response.addresses.begin(), response.addresses.end());
+            if (!response.addresses.empty()) ttl = std::min(ttl, response.ttl);
+            else negativeTtl = std::min(negativeTtl, response.negativeTtl);
+        }
+        return true;
+    }
+};
+
+AsyncResolver::AsyncResolver(EventLoop& loop) : loop_(loop) {}
+
+AsyncResolver::~AsyncResolver() {
+    for (auto& entry : lookups_) CloseQuery(*entry.second);
+}
+
+void AsyncResolver::Resolve(const std::string& host, int port, Clock::time_point deadline, Callback callback) {
+    SocketAddress literal;
+    if (ParseAddressLiteral(host.c_str(), port, literal)) {
+        callback(0, std::vector<SocketAddress>{literal});
+        return;
+    }
+    std::string name = Lowercase(host);
+    if (!ValidHostName(name.back() == '.' ? name.substr(0, name.size() - 1) : name)) {
+        callback(EINVAL, std::vector<SocketAddress>());
+        return;
+    }
+
+    std::vector<SocketAddress> addresses;
+    CacheEntry cached;
+    if (State().LookupHostsFile(name, addresses)) {
+        callback(0, OrderAddresses(std::move(addresses), port));
+        return;
+    }
+    if (State().LookupCache(name, cached)) {
+        callback(cached.error, OrderAddresses(std::move(cached.addresses), port));
+        return;
+    }
+
+    auto pending = byName_.find(name);
+    if (pending != byName_.end()) {
+        lookups_[pending->second]->waiters.push_back(Lookup::Waiter{port, deadline, std::move(callback)});
+        return;
+    }
+    auto lookup = std::make_unique<Lookup>();
+    lookup->id = nextId_++;
+    lookup->name = name;
+    lookup->config = State().Config();
+    lookup->candidates = Candidates(name, lookup->config);
+    lookup->waiters.push_back(Lookup::Waiter{port, deadline, std::move(callback)});
+    Lookup& started = *lookup;
+    byName_[name] = lookup->id;
+    lookups_[lookup->id] = std::move(lookup);
+
+    if (started.config.servers.empty()) {
+        started.fallback = std::make_shared<FallbackResult>();
+        std::thread(RunFallback, started.fallback, name).detach();
+    } else {
+        StartAttempt(started);
+    }
+}
+
+void AsyncResolver::StartAttempt(Lookup& lookup) {
+    CloseQuery(lookup);
+    lookup.answered[0] = lookup.answered[1] = false;
+    lookup.truncated[0] = lookup.truncated[1] = false;
+    lookup.tcp = false;
+    if (!lookup.addresses.empty()) lookup.partial = std::move(lookup.addresses);
+    lookup.addresses.clear();
+    lookup.ttl = lookup.negativeTtl = UINT32_MAX;
+    // A failed send just waits out the attempt and moves to the next server
+    lookup.attemptDeadline = Clock::now() + std::chrono::milliseconds(lookup.config.timeoutMs);
+
+    const SocketAddress& server = lookup.config.servers[static_cast<size_t>(lookup.attempt) % lookup.config.servers.size()];
+    lookup.socket = OpenNonBlockingSocket(server.Family(), SOCK_DGRAM, IPPROTO_UDP);
+    if (lookup.socket == InvalidSocket) return;
+    // Connected, so the kernel drops datagrams from anyone but the server
+    if (StartConnect(lookup.socket, server.Get(), server.length) != 0 || !loop_.Add(lookup.socket, EventLoop::Readable, lookup.id | 1ULL << 63)) {
+        CloseSocket(lookup.socket);
+        lookup.socket = InvalidSocket;
+        return;
+    }
+    const uint16_t types[2] = {TypeA, TypeAaaa};
+    for (int i = 0; i < 2; i++) {
+        lookup.queryIds[i] = RandomId();
+        // Loopback reports a closed port on the next send; skip to the next server
+        if (!SendDatagram(lookup.socket, BuildQuery(lookup.candidates[lookup.candidate], lookup.queryIds[i], types[i]))) {
+            lookup.attemptDeadline = Clock::now();
+        }
+    }
+}
+
+void AsyncResolver::StartTcp(Lookup& lookup) {
+    CloseQuery(lookup);
+    lookup.tcp = true;
+    lookup.tcpOut.clear();
+    lookup.tcpSent = 0;
+    lookup.tcpIn.clear();
+    lookup.attemptDeadline = Clock::now() + std::chrono::milliseconds(lookup.config.timeoutMs);
+
+    // Same server as the datagrams, both truncated types on one connection
+    const uint16_t types[2] = {TypeA, TypeAaaa};
+    for (int i = 0; i < 2; i++) {
+        if (!lookup.truncated[i]) continue;
+        lookup.truncated[i] = lookup.answered[i] = false;
+        lookup.queryIds[i] = RandomId();
+        std::vector<unsigned char> query = BuildQuery(lookup.candidates[lookup.candidate], lookup.queryIds[i], types[i]);
+        Put16(lookup.tcpOut, static_cast<uint16_t>(query.size()));
+        lookup.tcpOut.insert(lookup.tcpOut.end(), query.begin(), query.end());
+    }
+
+    const SocketAddress& server = lookup.config.servers[static_cast<size_t>(lookup.attempt) % lookup.config.servers.size()];
+    lookup.socket = OpenNonBlockingSocket(server.Family(), SOCK_STREAM, IPPROTO_TCP);
+    if (lookup.socket == InvalidSocket) return;
+    const int status = StartConnect(lookup.socket, server.Get(), server.length);
+    if ((status != 0 && status != EINPROGRESS) || !loop_.Add(lookup.socket, EventLoop::Readable | EventLoop::Writable, lookup.id | 1ULL << 63)) {
+        CloseSocket(lookup.socket);
+        lookup.socket = InvalidSocket;
+        lookup.attemptDeadline = Clock::now();
+    }
+}
+
+void AsyncResolver::OnEvent(const EventLoop::Event& event) {
+    auto found = lookups_.find(event.token & ~(1ULL << 63));
+    if (found == lookups_.end() || found->second->socket == InvalidSocket) return;
+    Lookup& lookup = *found->second;
+    if (lookup.tcp) {
+        OnTcpEvent(lookup, event.events);
+        return;
+    }
+
+    unsigned char buffer[1500];
+    while (true) {
+        int received = ReceiveDatagram(lookup.socket, buffer, sizeof(buffer));
+        if (received <= 0) break;
+        Response response;
+        if (!ParseResponse(buffer, static_cast<size_t>(received), response)) continue;
+        if (!lookup.Accept(response)) return;
+        if (lookup.answered[0] && lookup.answered[1]) {
+            if (lookup.truncated[0] || lookup.truncated[1]) StartTcp(lookup);
+            else FinishCandidate(lookup);
+            return;
+        }
+    }
+    // An ICMP port unreachable: nothing listens there, try the next server
+    if (event.events & EventLoop::Failed) lookup.attemptDeadline = Clock::now();
+}
+
+void AsyncResolver::OnTcpEvent(Lookup& lookup, uint32_t events) {
+    const uint64_t token = lookup.id | 1ULL << 63;
+    while (!lookup.tcpOut.empty()) {
+        int sent = SendSome(lookup.socket, lookup.tcpOut.data() + lookup.tcpSent, lookup.tcpOut.size() - lookup.tcpSent);
+        if (sent == -EAGAIN) break;
+        if (sent <= 0) {
+            lookup.attemptDeadline = Clock::now();
+            return;
+        }
+        lookup.tcpSent += static_cast<size_t>(sent);
+        if (lookup.tcpSent == lookup.tcpOut.size()) {
+            lookup.tcpOut.clear();
+            loop_.Modify(lookup.socket, EventLoop::Readable, token);
+        }
+    }
+
+    unsigned char buffer[4096];
+    while (true) {
+        int received = ReceiveSome(lookup.socket, buffer, sizeof(buffer));
+        if (received == -EAGAIN) break;
+        if (received <= 0) {
+            // Closed or reset before both answers arrived
+            lookup.attemptDeadline = Clock::now();
+            return;
+        }
+        lookup.tcpIn.insert(lookup.tcpIn.end(), buffer, buffer + received);
+        while (lookup.tcpIn.size() >= 2) {
+            const size_t length = Get16(lookup.tcpIn.data());
+            if (lookup.tcpIn.size() < 2 + length) break;
+            Response response;
+            const bool parsed = ParseResponse(lookup.tcpIn.data() + 2, length, response);
+            lookup.tcpIn.erase(lookup.tcpIn.begin(), lookup.tcpIn.begin() + static_cast<std::ptrdiff_t>(2 + length));
+            if (!parsed) continue;
+            if (!lookup.Accept(response)) return;
+            if (lookup.answered[0] && lookup.answered[1]) {
+                FinishCandidate(lookup);
+                return;
+            }
+        }
+    }
+    if (events & EventLoop::Failed) lookup.attemptDeadline = Clock::now();
+}
+
+void AsyncResolver::FinishCandidate(Lookup& lookup) {
+    if (!lookup.addresses.empty()) {
+        uint32_t ttl = ClampTtl(lookup.ttl, lookup.config);
+        Complete(lookup.id, 0, std::move(lookup.addresses), ttl);
+        return;
+    }
+    if (++lookup.candidate < lookup.candidates.size()) {
+        lookup.attempt = 0;
+        lookup.partial.clear();
+        StartAttempt(lookup);
+        return;
+    }
+    uint32_t ttl = std::min(lookup.config.negativeTtl, lookup.negativeTtl);
+    Complete(lookup.id, ENOENT, std::vector<SocketAddress>(), ClampTtl(ttl, lookup.config));
+}
+
+int AsyncResolver::Tick() {
+    const auto now = Clock::now();
+    std::vector<uint64_t> ids;
+    for (const auto& entry : lookups_) ids.push_back(entry.first);
+
+    for (uint64_t id : ids) {
+        auto found = lookups_.find(id);
+        if (found == lookups_.end()) continue;
+        Lookup& lookup = *found->second;
+
+        // Waiters past their own deadline give up, with whichever of A and
+        // AAAA has been answered; the query goes on for the others, and is
+        // dropped once nobody is waiting
+        const std::vector<SocketAddress> partial = lookup.Partial();
+        std::vector<Lookup::Waiter> expired;
+        for (auto it = lookup.waiters.begin(); it != lookup.waiters.end();) {
+            if (it->deadline <= now) {
+                expired.push_back(std::move(*it));
+                it = lookup.waiters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        const bool abandoned = lookup.waiters.empty();
+        if (abandoned) {
+            CloseQuery(lookup);
+            byName_.erase(lookup.name);
+            lookups_.erase(found);
+        }
+        for (Lookup::Waiter& waiter : expired) waiter.callback(partial.empty() ? ETIMEDOUT : 0, OrderAddresses(partial, waiter.port));
+        if (abandoned) continue;
+
+        if (lookup.fallback) {
+            if (lookup.fallback->done) {
+                Complete(id, lookup.fallback->error, lookup.fallback->addresses, lookup.config.minTtl);
+            }
+        } else if (lookup.attemptDeadline <= now) {
+            const int attempts = lookup.config.attempts * static_cast<int>(lookup.config.servers.size());
+            if (++lookup.attempt < attempts) StartAttempt(lookup);
+            // A partial answer is returned but not cached (TTL 0)
+            else Complete(id, partial.empty() ? ETIMEDOUT : 0, partial, 0);
+        }
+    }
+
+    if (lookups_.empty()) return -1;
+    auto next = Clock::time_point::max();
+    for (const auto& entry : lookups_) {
+        const Lookup& lookup = *entry.second;
+        next = std::min(next, lookup.fallback ? now + std::chrono::milliseconds(FallbackPollMs) : lookup.attemptDeadline);
+        for (const Lookup::Waiter& waiter : lookup.waiters) next = std::min(next, waiter.deadline);
+    }
+    // Round up, or the owner spins through the last millisecond
+    return next <= now ? 0 : static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count()) + 1;
+}
+
+void AsyncResolver::Complete(uint64_t id, int error, std::vector<SocketAddress> addresses, uint32_t ttl) {
+    auto found = lookups_.find(id);
+    if (found == lookups_.end()) return;
+    std::unique_ptr<Lookup> lookup = std::move(found->second);
+    lookups_.erase(found);
+    byName_.erase(lookup->name);
+    CloseQuery(*lookup);
+
+    // Timeouts are not cached, so the next check asks again
+    if (error != ETIMEDOUT && ttl > 0) State().Store(lookup->name, error, addresses, ttl);
+    for (Lookup::Waiter& waiter : lookup->waiters) waiter.callback(error, OrderAddresses(addresses, waiter.port));
+}
+
+void AsyncResolver::CloseQuery(Lookup& lookup) {
+    if (lookup.socket == InvalidSocket) return;
+    loop_.Remove(lookup.socket);
+    CloseSocket(lookup.socket);
+    lookup.socket = InvalidSocket;
+}
+
+} // namespace superpanel
+
+extern "C" {
+
+SUPERPANEL_API void ConfigureDnsResolver(const char* nameservers, int timeoutMs, int minTtlSeconds, int maxTtlSeconds, int negativeTtlSeconds) {
+    State().Configure(nameservers, timeoutMs, minTtlSeconds, maxTtlSeconds, negativeTtlSeconds);
+}
+
+SUPERPANEL_API int ResolveHost(const char* host, int timeoutMs, char* buffer, int bufferSize, int* ttlSeconds) {
+    if (ttlSeconds != NULL) *ttlSeconds = 0;
+    if (host == NULL || buffer == NULL || bufferSize <= 0 || !superpanel::InitializeSockets()) return -1;
+
+    EventLoop loop;
+    if (!loop.IsValid()) return -1;
+    superpanel::AsyncResolver resolver(loop);
+    bool done = false;
+    int error = 0;
+    std::vector<SocketAddress> addresses;
+    resolver.Resolve(host, 0, Clock::now() + std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 5000),
+                     [&](int result, const std::vector<SocketAddress>& found) {
+                         done = true;
+                         error = result;
+                         addresses = found;
+                     });
+    std::vector<EventLoop::Event> events;
+    while (true) {
+        // Tick may finish the lookup (a retry running out, say)
+        const int waitMs = resolver.Tick();
+        if (done) break;
+        if (!loop.Wait(waitMs, events)) return -1;
+        for (const EventLoop::Event& event : events) resolver.OnEvent(event);
+    }
+
+    CacheEntry cached;
+    if (ttlSeconds != NULL && (error == 0 || error == ENOENT) && State().LookupCache(Lowercase(host), cached)) {
+        *ttlSeconds = static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(cached.expires - Clock::now()).count());
+    }
+    if (error != 0) return error == ENOENT ? 0 : -1;
+    int used = 0, copied = 0;
+    for (const SocketAddress& address : addresses) {
+        char text[INET6_ADDRSTRLEN];
+        const void* raw = address.Family() == AF_INET ? static_cast<const void*>(&reinterpret_cast<const sockaddr_in*>(address.bytes)->sin_addr)
+                                                      : static_cast<const void*>(&reinterpret_cast<const sockaddr_in6*>(address.bytes)->sin6_addr);
+        if (inet_ntop(address.Family(), raw, text, sizeof(text)) == NULL) continue;
+        size_t length = strlen(text);
+        if (length + 1 > static_cast<size_t>(bufferSize - used)) break;
+        memcpy(buffer + used, text, length);
+        used += static_cast<int>(length);
+        buffer[used++] = '\n';
+        copied++;
+    }
+    return copied;
+}
+
+SUPERPANEL_API void FlushDnsCache() {
+    State().Flush();
+}
+
+SUPERPANEL_API void SetDnsHostsFile(const char* path) {
+    State().SetHostsFile(path);
+}
+
+} // extern "C"
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include "EventLoop.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+    // Points the resolver at specific nameservers, comma-separated with
+    // optional ports ("127.0.0.1:5353,[::1]:53"), instead of the system's
+    // /etc/resolv.conf; NULL or "" goes back to the system configuration.
+    // Answers are cached for their record TTL clamped to [minTtlSeconds,
+    // maxTtlSeconds], and names that do not exist for the SOA's negative TTL
+    // capped at negativeTtlSeconds. timeoutMs applies to each query attempt.
+    // Values <= 0 keep the defaults (1000 ms, 5 s, 1 h, 30 s). Flushes the cache.
+    SUPERPANEL_API void ConfigureDnsResolver(const char* nameservers, int timeoutMs, int minTtlSeconds, int maxTtlSeconds, int negativeTtlSeconds);
+    // Resolves host to IPv4 and IPv6 addresses, '\n'-terminated in buffer,
+    // IPv4 first. Literals and hosts-file names resolve immediately, then the
+    // cache is tried, then DNS. ttlSeconds (may be NULL) receives how long the
+    // answer stays cached. Returns the number of addresses copied, 0 if the
+    // name does not exist, or -1 if it could not be resolved (timeout, no
+    // nameserver, invalid name).
+    SUPERPANEL_API int ResolveHost(const char* host, int timeoutMs, char* buffer, int bufferSize, int* ttlSeconds);
+    SUPERPANEL_API void FlushDnsCache();
+    // Reads names from path instead of the system hosts file; NULL or "" goes
+    // back to the system file. Flushes the cache.
+    SUPERPANEL_API void SetDnsHostsFile(const char* path);
+}
+
+namespace superpanel {
+
+// An IPv4 or IPv6 socket address, sized and aligned like sockaddr_storage
+struct SocketAddress {
+    alignas(8) unsigned char bytes[128];
+    int length = 0;
+
+    int Family() const;
+    const struct sockaddr* Get() const { return reinterpret_cast<const struct sockaddr*>(bytes); }
+    void SetPort(int port);
+};
+
+// Parses an IPv4 or IPv6 literal (with an optional %scope), or returns false
+bool ParseAddressLiteral(const char* host, int port, SocketAddress& address);
+
+// Non-blocking name resolution driven by the owner's EventLoop. Queries go
+// out as UDP A and AAAA pairs to the configured nameservers, so their TTLs
+// can be honoured, and are repeated over TCP when an answer comes back
+// truncated; answers land in a process-wide cache shared by every
+// resolver. Where no nameserver is configured (Windows), lookups fall back
+// to getaddrinfo on a helper thread and are cached for the minimum TTL.
+class AsyncResolver {
+public:
+    // error is 0, ENOENT if the name does not exist, ETIMEDOUT, or EINVAL.
+    // Addresses come IPv4 first, with the requested port filled in. A lookup
+    // that times out with only one of A and AAAA answered succeeds with those
+    // addresses, uncached.
+    using Callback = std::function<void(int error, const std::vector<SocketAddress>& addresses)>;
+
+    explicit AsyncResolver(EventLoop& loop);
+    ~AsyncResolver();
+
+    AsyncResolver(const AsyncResolver&) = delete;
+    AsyncResolver& operator=(const AsyncResolver&) = delete;
+
+    // Calls back before returning for literals, hosts-file names and cached
+    // answers, and otherwise from OnEvent or Tick, by the deadline at the
+    // latest. Concurrent lookups of one name share a query.
+    void Resolve(const std::string& host, int port, std::chrono::steady_clock::time_point deadline, Callback callback);
+
+    // Event loop tokens with the top bit set belong to the resolver
+    static bool OwnsToken(uint64_t token) { return (token >> 63) != 0; }
+    void OnEvent(const EventLoop::Event& event);
+    // Retries and expires queries and collects fallback results. Returns the
+    // longest the owner may wait before calling again, or -1 when idle.
+    int Tick();
+    bool Idle() const { return lookups_.empty(); }
+
+private:
+    struct Lookup;
+
+    void StartAttempt(Lookup& lookup);
+    void StartTcp(Lookup& lookup);
+    void OnTcpEvent(Lookup& lookup, uint32_t events);
+    void FinishCandidate(Lookup& lookup);
+    void Complete(uint64_t id, int error, std::vector<SocketAddress> addresses, uint32_t ttl);
+    void CloseQuery(Lookup& lookup);
+
+    EventLoop& loop_;
+    uint64_t nextId_ = 1;
+    std::unordered_map<uint64_t, std::unique_ptr<Lookup>> lookups_;
+    std::unordered_map<std::string, uint64_t> byName_;
+};
+
+} // namespace superpanel
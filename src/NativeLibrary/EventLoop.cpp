@@ -0,0 +1,287 @@
+#include "pch.h"
+#include "EventLoop.h"
+#include <cerrno>
+#include <mutex>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace superpanel {
+
+namespace {
+
+#ifdef _WIN32
+// Winsock reports its own codes; callers compare against the POSIX names
+int NormalizeSocketError(int error) {
+    switch (error) {
+    case WSAEWOULDBLOCK:
+    case WSAEINPROGRESS: return EINPROGRESS;
+    case WSAECONNREFUSED: return ECONNREFUSED;
+    case WSAECONNRESET: return ECONNRESET;
+    case WSAEHOSTUNREACH: return EHOSTUNREACH;
+    case WSAENETUNREACH: return ENETUNREACH;
+    case WSAETIMEDOUT: return ETIMEDOUT;
+    case WSAEADDRNOTAVAIL: return EADDRNOTAVAIL;
+    case WSAEAFNOSUPPORT: return EAFNOSUPPORT;
+    case WSAEMFILE: return EMFILE;
+    default: return error;
+    }
+}
+#endif
+
+} // namespace
+
+bool InitializeSockets() {
+#ifdef _WIN32
+    static std::once_flag once;
+    static bool started = false;
+    std::call_once(once, [] {
+        WSADATA data;
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    });
+    return started;
+#else
+    return true;
+#endif
+}
+
+SocketHandle OpenNonBlockingSocket(int family, int type, int protocol) {
+#ifdef _WIN32
+    SOCKET handle = WSASocketW(family, type, protocol, NULL, 0, WSA_FLAG_NO_HANDLE_INHERIT);
+    if (handle == INVALID_SOCKET) return InvalidSocket;
+    u_long nonBlocking = 1;
+    if (ioctlsocket(handle, FIONBIO, &nonBlocking) != 0) {
+        closesocket(handle);
+        return InvalidSocket;
+    }
+    return static_cast<SocketHandle>(handle);
+#else
+    int handle = socket(family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+    return handle >= 0 ? handle : InvalidSocket;
+#endif
+}
+
+void AbortSocket(SocketHandle socket) {
+    if (socket == InvalidSocket) return;
+    struct linger abort = {};
+    abort.l_onoff = 1;
+    abort.l_linger = 0;
+    setsockopt(socket, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&abort), sizeof(abort));
+    CloseSocket(socket);
+}
+
+void CloseSocket(SocketHandle socket) {
+    if (socket == InvalidSocket) return;
+#ifdef _WIN32
+    closesocket(static_cast<SOCKET>(socket));
+#else
+    close(socket);
+#endif
+}
+
+int StartConnect(SocketHandle socket, const sockaddr* address, int addressLength) {
+#ifdef _WIN32
+    if (connect(static_cast<SOCKET>(socket), address, addressLength) == 0) return 0;
+    return NormalizeSocketError(WSAGetLastError());
+#else
+    while (connect(socket, address, static_cast<socklen_t>(addressLength)) != 0) {
+        if (errno != EINTR) return errno;
+    }
+    return 0;
+#endif
+}
+
+int PendingSocketError(SocketHandle socket) {
+    int error = 0;
+#ifdef _WIN32
+    int length = sizeof(error);
+    if (getsockopt(static_cast<SOCKET>(socket), SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) != 0) {
+        return NormalizeSocketError(WSAGetLastError());
+    }
+    return NormalizeSocketError(error);
+#else
+    socklen_t length = sizeof(error);
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0) return errno;
+    return error;
+#endif
+}
+
+int SendSome(SocketHandle socket, const void* data, size_t size) {
+#ifdef _WIN32
+    int sent = send(static_cast<SOCKET>(socket), static_cast<const char*>(data), static_cast<int>(size), 0);
+    if (sent >= 0) return sent;
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK ? -EAGAIN : -NormalizeSocketError(error);
+#else
+    while (true) {
+        ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+        if (sent >= 0) return static_cast<int>(sent);
+        if (errno != EINTR) return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+    }
+#endif
+}
+
+int ReceiveSome(SocketHandle socket, void* buffer, size_t size, bool peek) {
+#ifdef _WIN32
+    int received = recv(static_cast<SOCKET>(socket), static_cast<char*>(buffer), static_cast<int>(size), peek ? MSG_PEEK : 0);
+    if (received >= 0) return received;
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK ? -EAGAIN : -NormalizeSocketError(error);
+#else
+    while (true) {
+        ssize_t received = recv(socket, buffer, size, peek ? MSG_PEEK : 0);
+        if (received >= 0) return static_cast<int>(received);
+        if (errno != EINTR) return errno == EWOULDBLOCK ? -EAGAIN : -errno;
+    }
+#endif
+}
+
+#ifdef _WIN32
+
+struct EventLoop::PollSet {
+    std::vector<WSAPOLLFD> fds;
+    std::vector<uint64_t> tokens;
+};
+
+namespace {
+
+SHORT PollEvents(uint32_t interest) {
+    SHORT events = 0;
+    if (interest & EventLoop::Readable) events |= POLLRDNORM;
+    if (interest & EventLoop::Writable) events |= POLLWRNORM;
+    return events;
+}
+
+} // namespace
+
+EventLoop::EventLoop() : pollSet_(new PollSet) {
+    InitializeSockets();
+}
+
+EventLoop::~EventLoop() = default;
+
+bool EventLoop::IsValid() const {
+    return InitializeSockets();
+}
+
+bool EventLoop::Add(SocketHandle socket, uint32_t interest, uint64_t token) {
+    WSAPOLLFD fd = {};
+    fd.fd = static_cast<SOCKET>(socket);
+    fd.events = PollEvents(interest);
+    pollSet_->fds.push_back(fd);
+    pollSet_->tokens.push_back(token);
+    return true;
+}
+
+bool EventLoop::Modify(SocketHandle socket, uint32_t interest, uint64_t token) {
+    for (size_t i = 0; i < pollSet_->fds.size(); i++) {
+        if (pollSet_->fds[i].fd != static_cast<SOCKET>(socket)) continue;
+        pollSet_->fds[i].events = PollEvents(interest);
+        pollSet_->tokens[i] = token;
+        return true;
+    }
+    return false;
+}
+
+void EventLoop::Remove(SocketHandle socket) {
+    for (size_t i = 0; i < pollSet_->fds.size(); i++) {
+        if (pollSet_->fds[i].fd != static_cast<SOCKET>(socket)) continue;
+        pollSet_->fds[i] = pollSet_->fds.back();
+        pollSet_->tokens[i] = pollSet_->tokens.back();
+        pollSet_->fds.pop_back();
+        pollSet_->tokens.pop_back();
+        return;
+    }
+}
+
+bool EventLoop::Wait(int timeoutMs, std::vector<Event>& events) {
+    events.clear();
+    if (pollSet_->fds.empty()) {
+        // WSAPoll rejects an empty set
+        if (timeoutMs > 0) Sleep(static_cast<DWORD>(timeoutMs));
+        return true;
+    }
+    int ready = WSAPoll(pollSet_->fds.data(), static_cast<ULONG>(pollSet_->fds.size()), timeoutMs);
+    if (ready < 0) return false;
+    for (size_t i = 0; i < pollSet_->fds.size() && ready > 0; i++) {
+        SHORT revents = pollSet_->fds[i].revents;
+        if (revents == 0) continue;
+        ready--;
+        Event event = {pollSet_->tokens[i], 0};
+        if (revents & POLLRDNORM) event.events |= Readable;
+        if (revents & POLLWRNORM) event.events |= Writable;
+        if (revents & (POLLERR | POLLHUP | POLLNVAL)) event.events |= Failed;
+        events.push_back(event);
+    }
+    return true;
+}
+
+#else
+
+namespace {
+
+uint32_t EpollEvents(uint32_t interest) {
+    uint32_t events = 0;
+    if (interest & EventLoop::Readable) events |= EPOLLIN;
+    if (interest & EventLoop::Writable) events |= EPOLLOUT;
+    return events;
+}
+
+const size_t MaxEventsPerWait = 256;
+
+} // namespace
+
+EventLoop::EventLoop() : epoll_(epoll_create1(EPOLL_CLOEXEC)), buffer_(MaxEventsPerWait * sizeof(epoll_event)) {}
+
+EventLoop::~EventLoop() {
+    if (epoll_ >= 0) close(epoll_);
+}
+
+bool EventLoop::IsValid() const {
+    return epoll_ >= 0;
+}
+
+bool EventLoop::Add(SocketHandle socket, uint32_t interest, uint64_t token) {
+    epoll_event event = {};
+    event.events = EpollEvents(interest);
+    event.data.u64 = token;
+    return epoll_ctl(epoll_, EPOLL_CTL_ADD, socket, &event) == 0;
+}
+
+bool EventLoop::Modify(SocketHandle socket, uint32_t interest, uint64_t token) {
+    epoll_event event = {};
+    event.events = EpollEvents(interest);
+    event.data.u64 = token;
+    return epoll_ctl(epoll_, EPOLL_CTL_MOD, socket, &event) == 0;
+}
+
+void EventLoop::Remove(SocketHandle socket) {
+    epoll_ctl(epoll_, EPOLL_CTL_DEL, socket, nullptr);
+}
+
+bool EventLoop::Wait(int timeoutMs, std::vector<Event>& events) {
+    events.clear();
+    auto* buffer = reinterpret_cast<epoll_event*>(buffer_.data());
+    int ready = epoll_wait(epoll_, buffer, static_cast<int>(MaxEventsPerWait), timeoutMs);
+    if (ready < 0) return errno == EINTR;
+    for (int i = 0; i < ready; i++) {
+        Event event = {buffer[i].data.u64, 0};
+        if (buffer[i].events & EPOLLIN) event.events |= Readable;
+        if (buffer[i].events & EPOLLOUT) event.events |= Writable;
+        if (buffer[i].events & (EPOLLERR | EPOLLHUP)) event.events |= Failed;
+        events.push_back(event);
+    }
+    return true;
+}
+
+#endif
+
+} // namespace superpanel
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct sockaddr;
+
+namespace superpanel {
+
+#ifdef _WIN32
+typedef uintptr_t SocketHandle;
+const SocketHandle InvalidSocket = ~static_cast<SocketHandle>(0);
+#else
+typedef int SocketHandle;
+const SocketHandle InvalidSocket = -1;
+#endif
+
+// Starts Winsock once per process (and never tears it down); a no-op
+// elsewhere. Returns false if sockets are unusable.
+bool InitializeSockets();
+
+// Creates a non-blocking, close-on-exec socket in one call where the
+// platform allows it.
+SocketHandle OpenNonBlockingSocket(int family, int type, int protocol);
+
+// Closes with an RST instead of a FIN: probes never leave TIME_WAIT entries
+// behind, which matters when hundreds of endpoints are checked every few
+// seconds.
+void AbortSocket(SocketHandle socket);
+void CloseSocket(SocketHandle socket);
+
+// Starts a non-blocking connect. Returns 0 if connected already, EINPROGRESS
+// if pending, or the error.
+int StartConnect(SocketHandle socket, const sockaddr* address, int addressLength);
+// The outcome of a connect once the socket reports writable or failed
+int PendingSocketError(SocketHandle socket);
+
+// Non-blocking stream I/O. Return the number of bytes moved, 0 at end of
+// stream, or minus an errno-style code (-EAGAIN when the call would block).
+// Sends never raise SIGPIPE where the platform allows it.
+int SendSome(SocketHandle socket, const void* data, size_t size);
+int ReceiveSome(SocketHandle socket, void* buffer, size_t size, bool peek = false);
+
+// Readiness notification for many sockets on one thread: epoll on Linux,
+// WSAPoll on Windows. Sockets are identified in events by a caller-chosen
+// token.
+class EventLoop {
+public:
+    enum : uint32_t {
+        Readable = 1,
+        Writable = 2,
+        Failed = 4, // Error or hang-up; the socket's error says which
+    };
+
+    struct Event {
+        uint64_t token;
+        uint32_t events;
+    };
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool IsValid() const;
+
+    bool Add(SocketHandle socket, uint32_t interest, uint64_t token);
+    bool Modify(SocketHandle socket, uint32_t interest, uint64_t token);
+    // Must be called before the socket is closed
+    void Remove(SocketHandle socket);
+
+    // Waits up to timeoutMs (-1 for no limit) and replaces events with what
+    // became ready. Returns false on a wait error other than an interruption.
+    bool Wait(int timeoutMs, std::vector<Event>& events);
+
+private:
+#ifdef _WIN32
+    struct PollSet;
+    std::unique_ptr<PollSet> pollSet_;
+#else
+    int epoll_ = -1;
+    std::vector<unsigned char> buffer_; // epoll_event array
+#endif
+};
+
+} // namespace superpanel
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "FileJournal.h"
+#include "BackupFiles.h"
+#include "Hash.h"
+#include <cstring>
+
+namespace superpanel {
+
+namespace {
+
+const uint32_t JournalMagic = 0x4A465053; // "SPFJ"
+const uint32_t JournalVersion = 1;
+
+uint64_t NameHash(const std::string& name) {
+    uint64_t hash = XXH64(name.data(), name.size());
+    return hash == 0 ? 1 : hash; // 0 marks an empty slot
+}
+
+struct JournalHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity; // Power of two
+    uint64_t count;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint64_t reserved[3];
+};
+
+struct JournalRecord {
+    uint64_t nameHash;
+    uint64_t inode;
+    uint64_t device;
+    uint64_t size;
+    int64_t modifiedNs;
+    int64_t changedNs;
+    uint64_t contentHash;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+
+static_assert(sizeof(JournalHeader) == 64, "journal header layout");
+static_assert(sizeof(JournalRecord) == 64, "journal record layout");
+
+} // namespace
+
+bool FileJournal::Open(const std::string& path) {
+    Close();
+    if (!file_.Open(path.c_str())) return false;
+
+    const char* data = file_.Data();
+    uint64_t size = file_.Size();
+    if (data == nullptr || size < sizeof(JournalHeader)) return false;
+    JournalHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != JournalMagic || header.version != JournalVersion) return false;
+    if (header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0 ||
+        header.capacity > (size - sizeof(JournalHeader)) / sizeof(JournalRecord) ||
+        header.namesOffset < sizeof(JournalHeader) + header.capacity * sizeof(JournalRecord) ||
+        header.namesOffset > size || header.namesSize > size - header.namesOffset) {
+        return false;
+    }
+
+    capacity_ = header.capacity;
+    namesSize_ = header.namesSize;
+    records_ = data + sizeof(JournalHeader);
+    names_ = data + header.namesOffset;
+    size_t words = static_cast<size_t>((capacity_ + 63) / 64);
+    seen_.reset(new std::atomic<uint64_t>[words]);
+    for (size_t i = 0; i < words; i++) seen_[i] = 0;
+    return true;
+}
+
+void FileJournal::Close() {
+    file_.Close();
+    records_ = nullptr;
+    names_ = nullptr;
+    capacity_ = 0;
+    namesSize_ = 0;
+}
+
+bool FileJournal::Lookup(const std::string& name, FileState& state) {
+    if (records_ == nullptr) return false;
+    const uint64_t hash = NameHash(name);
+    const uint64_t mask = capacity_ - 1;
+    const JournalRecord* records = reinterpret_cast<const JournalRecord*>(records_);
+    for (uint64_t slot = hash & mask, probes = 0; probes < capacity_; slot = (slot + 1) & mask, probes++) {
+        const JournalRecord& record = records[slot];
+        if (record.nameHash == 0) return false;
+        if (record.nameHash != hash || record.nameLength != name.size() ||
+            static_cast<uint64_t>(record.nameOffset) + record.nameLength > namesSize_ ||
+            memcmp(names_ + record.nameOffset, name.data(), name.size()) != 0) {
+            continue;
+        }
+        state.inode = record.inode;
+        state.device = record.device;
+        state.size = record.size;
+        state.modifiedNs = record.modifiedNs;
+        state.changedNs = record.changedNs;
+        state.contentHash = record.contentHash;
+        seen_[slot / 64].fetch_or(1ULL << (slot % 64), std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::string> FileJournal::Unseen() const {
+    std::vector<std::string> names;
+    if (records_ == nullptr) return names;
+    const JournalRecord* records = reinterpret_cast<const JournalRecord*>(records_);
+    for (uint64_t slot = 0; slot < capacity_; slot++) {
+        const JournalRecord& record = records[slot];
+        if (record.nameHash == 0 || (seen_[slot / 64].load(std::memory_order_relaxed) & (1ULL << (slot % 64))) != 0) continue;
+        if (static_cast<uint64_t>(record.nameOffset) + record.nameLength > namesSize_) continue;
+        names.emplace_back(names_ + record.nameOffset, record.nameLength);
+    }
+    return names;
+}
+
+bool FileJournal::Write(const std::string& path, const std::vector<std::pair<std::string, FileState>>& files) {
+    // Load factor at most one half keeps probe sequences short
+    uint64_t capacity = 16;
+    while (capacity < files.size() * 2) capacity <<= 1;
+
+    std::vector<JournalRecord> records(static_cast<size_t>(capacity));
+    memset(records.data(), 0, records.size() * sizeof(JournalRecord));
+    std::string names;
+    for (const auto& file : files) {
+        if (names.size() + file.first.size() > UINT32_MAX) return false;
+        const uint64_t hash = NameHash(file.first);
+        uint64_t slot = hash & (capacity - 1);
+        while (records[slot].nameHash != 0) slot = (slot + 1) & (capacity - 1);
+
+        JournalRecord& record = records[slot];
+        record.nameHash = hash;
+        record.inode = file.second.inode;
+        record.device = file.second.device;
+        record.size = file.second.size;
+        record.modifiedNs = file.second.modifiedNs;
+        record.changedNs = file.second.changedNs;
+        record.contentHash = file.second.contentHash;
+        record.nameOffset = static_cast<uint32_t>(names.size());
+        record.nameLength = static_cast<uint32_t>(file.first.size());
+        names += file.first;
+    }
+
+    JournalHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = JournalMagic;
+    header.version = JournalVersion;
+    header.capacity = capacity;
+    header.count = files.size();
+    header.namesOffset = sizeof(JournalHeader) + capacity * sizeof(JournalRecord);
+    header.namesSize = names.size();
+
+    std::string contents;
+    contents.reserve(static_cast<size_t>(header.namesOffset + names.size()));
+    contents.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(JournalRecord));
+    contents += names;
+    return ReplaceFile(path, contents);
+}
+
+} // namespace superpanel
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace superpanel {
+
+// What a backup last saw of one file. A file whose inode, size, mtime and
+// ctime all match is taken as unchanged without reading it (ctime catches
+// writes that restore the old mtime).
+struct FileState {
+    uint64_t inode = 0;
+    uint64_t device = 0;
+    uint64_t size = 0;
+    int64_t modifiedNs = 0;
+    int64_t changedNs = 0;
+    uint64_t contentHash = 0;
+
+    bool SameMetadata(const FileState& other) const {
+        return inode == other.inode && device == other.device && size == other.size &&
+               modifiedNs == other.modifiedNs && changedNs == other.changedNs;
+    }
+};
+
+// Per-tree record of file states from the previous backup, kept as an
+// open-addressed hash table in a file and read through a memory mapping, so
+// opening a journal for millions of files costs nothing up front and
+// lookups from many threads need no locking. Journals are never updated in
+// place: Write replaces the file with the new state once a backup succeeds.
+class FileJournal {
+public:
+    // False if the journal is missing or unreadable; it then behaves as empty
+    bool Open(const std::string& path);
+    // Must be closed before Write replaces the same path (Windows cannot
+    // replace a mapped file)
+    void Close();
+
+    // Thread-safe. Marks the name as seen in this run.
+    bool Lookup(const std::string& name, FileState& state);
+
+    // Names recorded last time but not looked up in this run (deleted files)
+    std::vector<std::string> Unseen() const;
+
+    static bool Write(const std::string& path, const std::vector<std::pair<std::string, FileState>>& files);
+
+private:
+    const char* records_ = nullptr;
+    const char* names_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t namesSize_ = 0;
+    MappedFile file_;
+    std::unique_ptr<std::atomic<uint64_t>[]> seen_;
+};
+
+} // namespace superpanel
@@ -0,0 +1,381 @@
+#include "pch.h"
+#include "FileOperations.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using superpanel::ThreadPool;
+
+namespace {
+
+struct RemoveTreeJob {
+    std::string rootPath;
+    std::atomic<bool> cancelled{false};
+    std::atomic<long long> removed{0};
+    std::atomic<long long> errors{0};
+    std::atomic<int> state{REMOVE_TREE_RUNNING};
+    // One reference for the worker thread, one for the caller's handle
+    std::atomic<int> refs{2};
+};
+
+void DropJobReference(RemoveTreeJob* job) {
+    if (job->refs.fetch_sub(1) == 1) delete job;
+}
+
+unsigned RemoveThreadCount(int requested) {
+    if (requested > 0) return static_cast<unsigned>(requested);
+    // unlink/rmdir spend most of their time blocked in the filesystem, so
+    // oversubscribe the cores a little.
+    unsigned threads = ThreadPool::DefaultThreadCount() * 2;
+    return threads > 32 ? 32 : threads;
+}
+
+#ifndef _WIN32
+
+// Directory fds held open across all removals. Each pending directory keeps its
+// fd until its children are done, so wide trees are processed inline (depth
+// first) once this budget is used up instead of exhausting the fd table.
+std::atomic<long> openDirectoryFds{0};
+
+long DirectoryFdBudget() {
+    static const long budget = [] {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY) return 1024L;
+        long quarter = static_cast<long>(limit.rlim_cur / 4);
+        return quarter < 16 ? 16L : quarter;
+    }();
+    return budget;
+}
+
+struct DirNode {
+    DirNode* parent = nullptr;
+    std::string name;               // Relative to parent; full path for the root
+    int fd = -1;
+    std::atomic<bool> failed{false}; // Something inside could not be removed
+    std::atomic<long> pending{1};   // Children in flight + 1 for our own scan
+};
+
+class TreeRemover {
+public:
+    TreeRemover(RemoveTreeJob& job, ThreadPool& pool) : job_(job), pool_(pool) {}
+
+    void Start(const std::string& path) {
+        auto* root = new DirNode();
+        root->name = path;
+        Scan(root);
+    }
+
+private:
+    void Scan(DirNode* node) {
+        pool_.Submit([this, node] {
+            try {
+                ScanDirectory(node);
+            } catch (...) {
+                // Out of memory mid-scan: the subtree stays behind, the job fails
+                job_.errors++;
+            }
+        });
+    }
+
+    void ScanDirectory(DirNode* node) {
+        int parentFd = node->parent ? node->parent->fd : AT_FDCWD;
+        node->fd = openat(parentFd, node->name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (node->fd < 0) {
+            job_.errors++;
+            node->failed = true;
+            Complete(node);
+            return;
+        }
+        openDirectoryFds++;
+
+        DIR* dir = nullptr;
+        int iterFd = dup(node->fd);
+        if (iterFd >= 0) dir = fdopendir(iterFd);
+        if (dir == nullptr) {
+            if (iterFd >= 0) close(iterFd);
+            job_.errors++;
+            node->failed = true;
+            Complete(node);
+            return;
+        }
+
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (job_.cancelled.load(std::memory_order_relaxed)) break;
+
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+            bool isDirectory = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN) {
+                struct stat st;
+                if (fstatat(node->fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                    isDirectory = S_ISDIR(st.st_mode);
+                }
+            }
+
+            if (!isDirectory) {
+                if (unlinkat(node->fd, name, 0) == 0) {
+                    job_.removed.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                if (errno == ENOENT) continue;
+                if (errno != EISDIR) {
+                    job_.errors++;
+                    node->failed = true;
+                    continue;
+                }
+                // d_type lied (some network filesystems); fall through as a directory
+            }
+
+            auto* child = new DirNode();
+            child->parent = node;
+            child->name = name;
+            node->pending.fetch_add(1, std::memory_order_relaxed);
+
+            if (openDirectoryFds.load(std::memory_order_relaxed) < DirectoryFdBudget()) {
+                Scan(child);
+            } else {
+                ScanDirectory(child);
+            }
+        }
+        closedir(dir);
+
+        Complete(node);
+    }
+
+    // Drops one pending reference; the last one out removes the (now empty)
+    // directory and propagates completion up the tree.
+    void Complete(DirNode* node) {
+        while (node != nullptr) {
+            if (node->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+            if (node->fd >= 0) {
+                close(node->fd);
+                openDirectoryFds--;
+            }
+
+            DirNode* parent = node->parent;
+            bool cancelled = job_.cancelled.load(std::memory_order_relaxed);
+            if (!node->failed && !cancelled) {
+                int parentFd = parent ? parent->fd : AT_FDCWD;
+                if (unlinkat(parentFd, node->name.c_str(), AT_REMOVEDIR) == 0) {
+                    job_.removed.fetch_add(1, std::memory_order_relaxed);
+                } else if (errno != ENOENT) {
+                    job_.errors++;
+                    if (parent) parent->failed = true;
+                }
+            } else if (parent) {
+                parent->failed = true;
+            }
+
+            delete node;
+            node = parent;
+        }
+    }
+
+    RemoveTreeJob& job_;
+    ThreadPool& pool_;
+};
+
+#endif
+
+void RunRemoval(RemoveTreeJob& job, ThreadPool& pool) {
+    if (job.cancelled) {
+        job.state = REMOVE_TREE_CANCELLED;
+        return;
+    }
+#ifdef _WIN32
+    (void)pool;
+    std::error_code ec;
+    std::uintmax_t count = std::filesystem::remove_all(std::filesystem::u8path(job.rootPath), ec);
+    if (count != static_cast<std::uintmax_t>(-1)) job.removed += static_cast<long long>(count);
+    if (ec) job.errors++;
+#else
+    struct stat st;
+    if (lstat(job.rootPath.c_str(), &st) != 0) {
+        if (errno != ENOENT) job.errors++;
+    } else if (!S_ISDIR(st.st_mode)) {
+        // A symlink to a directory is removed, never followed
+        if (unlink(job.rootPath.c_str()) == 0) job.removed++;
+        else job.errors++;
+    } else {
+        TreeRemover remover(job, pool);
+        remover.Start(job.rootPath);
+        pool.WaitIdle();
+    }
+#endif
+
+    if (job.cancelled) job.state = REMOVE_TREE_CANCELLED;
+    else job.state = job.errors > 0 ? REMOVE_TREE_FAILED : REMOVE_TREE_COMPLETED;
+}
+
+// Moves the tree to a unique name inside trashDir. Returns the new path, or an
+// empty string if the tree has to be deleted where it is.
+std::string MoveToTrash(const std::string& path, const std::string& trashDir) {
+    static std::atomic<unsigned> sequence{0};
+
+    std::error_code ec;
+    std::filesystem::path source = std::filesystem::u8path(path);
+    std::filesystem::path trash = std::filesystem::u8path(trashDir);
+    std::filesystem::create_directories(trash, ec);
+
+    std::string leaf = source.filename().u8string();
+    if (leaf.empty()) leaf = source.parent_path().filename().u8string();
+    auto stamp = std::chrono::system_clock::now().time_since_epoch().count();
+    std::filesystem::path target = trash / std::filesystem::u8path(
+        leaf + "." + std::to_string(stamp) + "." + std::to_string(sequence.fetch_add(1)));
+
+    std::filesystem::rename(source, target, ec);
+    return ec ? std::string() : target.u8string();
+}
+
+// Background removals run one after another on a single dispatcher thread
+// that owns one process-wide pool, so purging many trash entries (or many
+// concurrent deletes) never multiplies the thread count.
+class RemovalQueue {
+public:
+    bool Enqueue(RemoveTreeJob* job) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (!started_) {
+            try {
+                std::thread([this] { Run(); }).detach();
+            } catch (const std::system_error&) {
+                return false;
+            }
+            started_ = true;
+        }
+        jobs_.push_back(job);
+        ready_.notify_one();
+        return true;
+    }
+
+private:
+    void Run() {
+        ThreadPool pool(RemoveThreadCount(0));
+        while (true) {
+            RemoveTreeJob* job;
+            {
+                std::unique_lock<std::mutex> guard(lock_);
+                ready_.wait(guard, [this] { return !jobs_.empty(); });
+                job = jobs_.front();
+                jobs_.pop_front();
+            }
+            RunRemoval(*job, pool);
+            DropJobReference(job);
+        }
+    }
+
+    std::mutex lock_;
+    std::condition_variable ready_;
+    std::deque<RemoveTreeJob*> jobs_;
+    bool started_ = false;
+};
+
+RemovalQueue& Removals() {
+    // Never destroyed: the dispatcher thread outlives static destruction
+    static RemovalQueue* queue = new RemovalQueue();
+    return *queue;
+}
+
+RemoveTreeJob* StartRemoval(const std::string& path) {
+    auto* job = new RemoveTreeJob();
+    job->rootPath = path;
+    if (!Removals().Enqueue(job)) {
+        delete job;
+        return nullptr;
+    }
+    return job;
+}
+
+// Removes the tree on the calling thread and returns an already finished job,
+// so the caller still gets a handle to read the outcome from.
+RemoveTreeJob* RemoveInPlace(const std::string& path, int threadCount) {
+    auto* job = new RemoveTreeJob();
+    job->rootPath = path;
+    job->refs = 1;
+    ThreadPool pool(RemoveThreadCount(threadCount));
+    RunRemoval(*job, pool);
+    return job;
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API int RemoveTree(const char* path, int threadCount, long long* entriesRemoved) {
+    if (path == NULL || path[0] == '\0') return 0;
+
+    RemoveTreeJob job;
+    job.rootPath = path;
+    ThreadPool pool(RemoveThreadCount(threadCount));
+    RunRemoval(job, pool);
+
+    if (entriesRemoved != NULL) *entriesRemoved = job.removed;
+    return job.state == REMOVE_TREE_COMPLETED ? 1 : 0;
+}
+
+SUPERPANEL_API void* RemoveTreeAsync(const char* path, const char* trashDir, int threadCount) {
+    if (path == NULL || path[0] == '\0') return NULL;
+
+    // Deleting in place in the background would race with a directory
+    // recreated under the same name, so without a rename it is done now.
+    std::string trashed = trashDir == NULL || trashDir[0] == '\0' ? std::string() : MoveToTrash(path, trashDir);
+    if (trashed.empty()) return RemoveInPlace(path, threadCount);
+    return StartRemoval(trashed);
+}
+
+SUPERPANEL_API int GetRemoveTreeProgress(void* handle, long long* entriesRemoved, long long* errorCount) {
+    if (handle == NULL) return REMOVE_TREE_FAILED;
+    auto* job = static_cast<RemoveTreeJob*>(handle);
+    if (entriesRemoved != NULL) *entriesRemoved = job->removed;
+    if (errorCount != NULL) *errorCount = job->errors;
+    return job->state;
+}
+
+SUPERPANEL_API void CancelRemoveTree(void* handle) {
+    if (handle == NULL) return;
+    static_cast<RemoveTreeJob*>(handle)->cancelled = true;
+}
+
+SUPERPANEL_API void ReleaseRemoveTree(void* handle) {
+    if (handle == NULL) return;
+    DropJobReference(static_cast<RemoveTreeJob*>(handle));
+}
+
+SUPERPANEL_API int PurgeTrashDirectory(const char* trashDir) {
+    if (trashDir == NULL || trashDir[0] == '\0') return 0;
+
+    std::error_code ec;
+    std::filesystem::directory_iterator it(std::filesystem::u8path(trashDir), ec);
+    if (ec) return 0;
+
+    int queued = 0;
+    for (const auto& entry : it) {
+        RemoveTreeJob* job = StartRemoval(entry.path().u8string());
+        if (job == NULL) continue;
+        DropJobReference(job);
+        queued++;
+    }
+    return queued;
+}
+
+} // extern "C"
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Job states reported by GetRemoveTreeProgress
+#define REMOVE_TREE_RUNNING   0
+#define REMOVE_TREE_COMPLETED 1
+#define REMOVE_TREE_FAILED    2
+#define REMOVE_TREE_CANCELLED 3
+
+extern "C" {
+    // Recursive directory removal. Directories are walked in parallel on a
+    // work-stealing pool and entries are unlinked relative to their parent's
+    // directory fd, so no path is ever resolved twice. threadCount <= 0 picks a
+    // default suited to I/O-bound work.
+    SUPERPANEL_API int RemoveTree(const char* path, int threadCount, long long* entriesRemoved);
+
+    // Starts a background removal and returns a job handle (NULL on failure).
+    // Background jobs are queued and run one at a time on a single shared
+    // pool. When trashDir is set the tree is first renamed into it, so the
+    // caller's path is gone by the time this returns; if the rename is not
+    // possible (e.g. different filesystem), or no trashDir is given, the tree
+    // is deleted in place before returning, with threadCount workers, and the
+    // handle is already finished.
+    SUPERPANEL_API void* RemoveTreeAsync(const char* path, const char* trashDir, int threadCount);
+    SUPERPANEL_API int GetRemoveTreeProgress(void* handle, long long* entriesRemoved, long long* errorCount);
+    SUPERPANEL_API void CancelRemoveTree(void* handle);
+    // Releases the caller's reference. A job that is still running keeps going
+    // and frees itself when it finishes.
+    SUPERPANEL_API void ReleaseRemoveTree(void* handle);
+
+    // Starts background removal of everything left in a trash directory (e.g.
+    // after a restart interrupted earlier deletions). Returns the number of
+    // entries queued on the shared background removal queue.
+    SUPERPANEL_API int PurgeTrashDirectory(const char* trashDir);
+}
@@ -0,0 +1,252 @@
+#include "pch.h"
+#include "FileStreaming.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct MappedRange {
+    void* base = nullptr;
+    size_t length = 0;
+    std::atomic<bool> truncated{false};
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+};
+
+#ifndef _WIN32
+
+// Largest single sendfile/splice request; the kernel caps transfers just below
+// 2 GB anyway.
+const size_t MaxTransferChunk = 1 << 30;
+
+bool WaitWritable(int fd) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    while (true) {
+        int ready = poll(&pfd, 1, -1);
+        if (ready > 0) return (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) == 0;
+        if (ready < 0 && errno != EINTR) return false;
+    }
+}
+
+// splice needs a pipe on one side. When the destination is not a pipe, bytes
+// go file -> intermediate pipe -> destination, still without a userspace copy.
+long long SpliceRange(int inFd, int outFd, off_t offset, long long remaining) {
+    struct stat st;
+    bool outIsPipe = fstat(outFd, &st) == 0 && S_ISFIFO(st.st_mode);
+
+    int pipeFds[2] = {-1, -1};
+    if (!outIsPipe && pipe2(pipeFds, O_CLOEXEC) != 0) return -1;
+
+    long long total = 0;
+    while (remaining > 0) {
+        size_t chunk = remaining > static_cast<long long>(MaxTransferChunk) ? MaxTransferChunk : static_cast<size_t>(remaining);
+        int target = outIsPipe ? outFd : pipeFds[1];
+
+        ssize_t moved = splice(inFd, &offset, target, NULL, chunk, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (moved == 0) break;
+        if (moved < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN && WaitWritable(target)) continue;
+            break;
+        }
+
+        if (!outIsPipe) {
+            // Drain what we just filled into the real destination
+            ssize_t pending = moved;
+            while (pending > 0) {
+                ssize_t sent = splice(pipeFds[0], NULL, outFd, NULL, static_cast<size_t>(pending), SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (sent > 0) {
+                    pending -= sent;
+                    total += sent;
+                    continue;
+                }
+                if (sent < 0 && errno == EINTR) continue;
+                if (sent < 0 && errno == EAGAIN && WaitWritable(outFd)) continue;
+                close(pipeFds[0]);
+                close(pipeFds[1]);
+                return total > 0 ? total : -1;
+            }
+        } else {
+            total += moved;
+        }
+        remaining -= moved;
+    }
+
+    if (!outIsPipe) {
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+    }
+    return total;
+}
+
+#endif
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API long long SendFileRange(const char* path, int outFd, long long offset, long long length) {
+#ifdef _WIN32
+    // Sockets are not fds on Windows; callers fall back to stream copies
+    return -1;
+#else
+    if (path == NULL || outFd < 0 || offset < 0) return -1;
+
+    int inFd = open(path, O_RDONLY | O_CLOEXEC);
+    if (inFd < 0) return -1;
+
+    struct stat st;
+    if (fstat(inFd, &st) != 0 || offset > st.st_size) {
+        close(inFd);
+        return -1;
+    }
+    long long available = st.st_size - offset;
+    long long remaining = (length <= 0 || length > available) ? available : length;
+
+    posix_fadvise(inFd, offset, remaining, POSIX_FADV_SEQUENTIAL);
+
+    off_t position = offset;
+    long long total = 0;
+    while (remaining > 0) {
+        size_t chunk = remaining > static_cast<long long>(MaxTransferChunk) ? MaxTransferChunk : static_cast<size_t>(remaining);
+        ssize_t sent = sendfile(outFd, inFd, &position, chunk);
+        if (sent > 0) {
+            total += sent;
+            remaining -= sent;
+            continue;
+        }
+        if (sent == 0) break; // File shrank underneath us
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN && WaitWritable(outFd)) continue;
+        if ((errno == EINVAL || errno == ENOSYS) && total == 0) {
+            long long spliced = SpliceRange(inFd, outFd, position, remaining);
+            close(inFd);
+            return spliced;
+        }
+        break;
+    }
+
+    close(inFd);
+    return (total == 0 && remaining > 0) ? -1 : total;
+#endif
+}
+
+SUPERPANEL_API void* MapFileRange(const char* path, long long offset, long long length, const void** data, long long* dataLength) {
+    if (path == NULL || data == NULL || dataLength == NULL || offset < 0) return NULL;
+    *data = NULL;
+    *dataLength = 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || offset > size.QuadPart) {
+        CloseHandle(file);
+        return NULL;
+    }
+    long long available = size.QuadPart - offset;
+    long long span = (length <= 0 || length > available) ? available : length;
+
+    auto* range = new MappedRange();
+    range->file = file;
+    if (span == 0) return range;
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long long aligned = offset - (offset % info.dwAllocationGranularity);
+    size_t viewLength = static_cast<size_t>(span + (offset - aligned));
+
+    range->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (range->mapping != NULL) {
+        range->base = MapViewOfFile(range->mapping, FILE_MAP_READ,
+                                    static_cast<DWORD>(aligned >> 32), static_cast<DWORD>(aligned & 0xFFFFFFFF), viewLength);
+    }
+    if (range->base == NULL) {
+        UnmapFileRange(range);
+        return NULL;
+    }
+    range->length = viewLength;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || offset > st.st_size) {
+        close(fd);
+        return NULL;
+    }
+    long long available = st.st_size - offset;
+    long long span = (length <= 0 || length > available) ? available : length;
+
+    auto* range = new MappedRange();
+    if (span == 0) {
+        close(fd);
+        return range;
+    }
+
+    long long pageSize = sysconf(_SC_PAGESIZE);
+    long long aligned = offset - (offset % pageSize);
+    size_t viewLength = static_cast<size_t>(span + (offset - aligned));
+
+    void* base = mmap(NULL, viewLength, PROT_READ, MAP_SHARED, fd, aligned);
+    close(fd); // The mapping keeps its own reference to the file
+    if (base == MAP_FAILED) {
+        delete range;
+        return NULL;
+    }
+    madvise(base, viewLength, MADV_SEQUENTIAL);
+
+    range->base = base;
+    range->length = viewLength;
+    // The caller reads the pages directly, so a truncation by another
+    // process must not fault the whole process
+    if (!superpanel::GuardMapping(base, viewLength, &range->truncated)) {
+        UnmapFileRange(range);
+        return NULL;
+    }
+#endif
+
+    *data = static_cast<const char*>(range->base) + (offset - aligned);
+    *dataLength = span;
+    return range;
+}
+
+SUPERPANEL_API void UnmapFileRange(void* handle) {
+    if (handle == NULL) return;
+    auto* range = static_cast<MappedRange*>(handle);
+#ifdef _WIN32
+    if (range->base != NULL) UnmapViewOfFile(range->base);
+    if (range->mapping != NULL) CloseHandle(range->mapping);
+    if (range->file != INVALID_HANDLE_VALUE) CloseHandle(range->file);
+#else
+    if (range->base != nullptr) {
+        superpanel::UnguardMapping(range->base);
+        munmap(range->base, range->length);
+    }
+#endif
+    delete range;
+}
+
+SUPERPANEL_API int MappedRangeTruncated(void* handle) {
+    return handle != NULL && static_cast<MappedRange*>(handle)->truncated.load() ? 1 : 0;
+}
+
+} // extern "C"
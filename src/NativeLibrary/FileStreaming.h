@@ -0,0 +1,23 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+extern "C" {
+    // Zero-copy transfer of a file range to an open socket or pipe fd using
+    // sendfile, falling back to splice through a pipe where sendfile cannot be
+    // used. Non-blocking destinations are waited on with poll. length <= 0
+    // sends to end of file. Returns bytes sent, or -1 if nothing could be sent.
+    SUPERPANEL_API long long SendFileRange(const char* path, int outFd, long long offset, long long length);
+
+    // Read-only memory mapping of a file range. *data points at the first
+    // requested byte and *dataLength is clamped to the file size; length <= 0
+    // maps to end of file. Returns a handle for UnmapFileRange, or NULL on
+    // failure. Empty ranges succeed with *data == NULL.
+    SUPERPANEL_API void* MapFileRange(const char* path, long long offset, long long length, const void** data, long long* dataLength);
+    SUPERPANEL_API void UnmapFileRange(void* handle);
+
+    // 1 once a read of the range found the file truncated under it. Such
+    // reads see zeros instead of faulting, so whatever they returned must be
+    // discarded.
+    SUPERPANEL_API int MappedRangeTruncated(void* handle);
+}
@@ -0,0 +1,207 @@
+#include "pch.h"
+#include "FileViewer.h"
+#include "MappedFile.h"
+#include "TextScan.h"
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using superpanel::MappedFile;
+
+namespace {
+
+// Lines between index checkpoints. Bounds the scan for any lookup to this many
+// lines while keeping the index at 8 bytes per 1024 lines.
+const uint64_t CheckpointStride = 1024;
+
+// Most bytes a line count request scans past the current index. Counting
+// catches up over successive requests instead of reading a huge file at once.
+const uint64_t CountScanBudget = 64ull << 20;
+
+// Bytes just before indexedOffset kept to notice a file that was truncated and
+// rewritten past the indexed point between two requests.
+const size_t FingerprintBytes = 256;
+
+struct FileView {
+    std::mutex lock;
+    MappedFile file;
+    std::vector<uint64_t> checkpoints{0}; // checkpoints[i] = offset where line i * stride starts
+    uint64_t indexedOffset = 0;           // Bytes scanned so far
+    uint64_t indexedNewlines = 0;         // Newlines in [0, indexedOffset)
+    std::string fingerprint;              // Bytes ending at indexedOffset
+};
+
+void ResetIndex(FileView& view) {
+    view.checkpoints.assign(1, 0);
+    view.indexedOffset = 0;
+    view.indexedNewlines = 0;
+    view.fingerprint.clear();
+}
+
+// Picks up size changes: growth just exposes more bytes to index, truncation
+// invalidates the index. A file truncated and regrown in between is caught by
+// the indexed tail no longer matching.
+bool SyncWithFile(FileView& view) {
+    if (!view.file.Refresh()) return false;
+    if (view.file.Size() < view.indexedOffset) {
+        ResetIndex(view);
+    } else if (!view.fingerprint.empty() &&
+               memcmp(view.file.Data() + view.indexedOffset - view.fingerprint.size(),
+                      view.fingerprint.data(), view.fingerprint.size()) != 0) {
+        ResetIndex(view);
+    }
+    return true;
+}
+
+// Scans forward until checkpoint `wanted` exists, `limit` bytes have been
+// indexed or the mapped data runs out.
+void ExtendIndex(FileView& view, uint64_t wanted, uint64_t limit = UINT64_MAX) {
+    const char* data = view.file.Data();
+    const uint64_t size = limit < view.file.Size() ? limit : view.file.Size();
+    uint64_t pos = view.indexedOffset;
+    uint64_t newlines = view.indexedNewlines;
+    uint64_t nextCheckpointLine = view.checkpoints.size() * CheckpointStride;
+    if (pos >= size) return;
+
+    while (view.checkpoints.size() <= wanted && pos + 64 <= size) {
+        uint64_t mask = superpanel::MatchMask64(data + pos, '\n');
+        uint64_t hits = static_cast<uint64_t>(superpanel::PopCount(mask));
+        // Line k starts right after the k-th newline
+        while (newlines + hits >= nextCheckpointLine) {
+            int bit = superpanel::NthSetBit(mask, static_cast<int>(nextCheckpointLine - 1 - newlines));
+            view.checkpoints.push_back(pos + bit + 1);
+            nextCheckpointLine += CheckpointStride;
+        }
+        newlines += hits;
+        pos += 64;
+    }
+
+    // Tail shorter than a block; a later call picks up where this stops
+    while (view.checkpoints.size() <= wanted && pos < size) {
+        if (data[pos] == '\n') {
+            newlines++;
+            if (newlines == nextCheckpointLine) {
+                view.checkpoints.push_back(pos + 1);
+                nextCheckpointLine += CheckpointStride;
+            }
+        }
+        pos++;
+    }
+
+    view.indexedOffset = pos;
+    view.indexedNewlines = newlines;
+    size_t sample = pos < FingerprintBytes ? static_cast<size_t>(pos) : FingerprintBytes;
+    view.fingerprint.assign(data + pos - sample, sample);
+}
+
+// Byte offset where `line` starts, or UINT64_MAX past the end of the file
+uint64_t LineStart(FileView& view, uint64_t line) {
+    uint64_t checkpoint = line / CheckpointStride;
+    ExtendIndex(view, checkpoint);
+    if (checkpoint >= view.checkpoints.size()) return UINT64_MAX;
+
+    uint64_t start = view.checkpoints[checkpoint];
+    uint64_t skip = line % CheckpointStride;
+    const uint64_t size = view.file.Size();
+    if (skip == 0) return start < size ? start : UINT64_MAX;
+
+    size_t offset = superpanel::FindNthByte(view.file.Data() + start, static_cast<size_t>(size - start), '\n',
+                                            static_cast<size_t>(skip - 1));
+    if (offset == SIZE_MAX) return UINT64_MAX;
+    uint64_t lineStart = start + offset + 1;
+    return lineStart < size ? lineStart : UINT64_MAX;
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* OpenFileView(const char* path) {
+    auto* view = new FileView();
+    if (!view->file.Open(path)) {
+        delete view;
+        return NULL;
+    }
+    return view;
+}
+
+SUPERPANEL_API void CloseFileView(void* handle) {
+    delete static_cast<FileView*>(handle);
+}
+
+SUPERPANEL_API long long GetFileViewLineCount(void* handle, int* exact) {
+    if (exact != NULL) *exact = 0;
+    if (handle == NULL) return -1;
+    auto* view = static_cast<FileView*>(handle);
+    std::lock_guard<std::mutex> guard(view->lock);
+
+    // A file that shrank during the request was partly read as zeros, which
+    // the index must not keep: start over once on the new size
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!SyncWithFile(*view)) return -1;
+        ExtendIndex(*view, UINT64_MAX, view->indexedOffset + CountScanBudget);
+
+        uint64_t size = view->file.Size();
+        bool indexed = view->indexedOffset >= size;
+        bool partialLastLine = indexed && size > 0 && view->file.Data()[size - 1] != '\n';
+        if (view->file.Truncated()) {
+            ResetIndex(*view);
+            continue;
+        }
+
+        if (!indexed) return static_cast<long long>(view->indexedNewlines);
+        if (exact != NULL) *exact = 1;
+        return static_cast<long long>(view->indexedNewlines + (partialLastLine ? 1 : 0));
+    }
+    return -1;
+}
+
+SUPERPANEL_API int ReadFileViewLines(void* handle, long long firstLine, int maxLines, char* buffer, int bufferSize, int* bytesWritten) {
+    if (bytesWritten != NULL) *bytesWritten = 0;
+    if (handle == NULL || buffer == NULL || firstLine < 0 || maxLines < 0 || bufferSize < 0) return -1;
+    auto* view = static_cast<FileView*>(handle);
+    std::lock_guard<std::mutex> guard(view->lock);
+
+    // As for the line count: zeros read from a file that shrank meanwhile
+    // are never returned, the lines are looked up again once
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!SyncWithFile(*view)) return -1;
+        uint64_t pos = LineStart(*view, static_cast<uint64_t>(firstLine));
+        if (view->file.Truncated()) {
+            ResetIndex(*view);
+            continue;
+        }
+        if (pos == UINT64_MAX) return 0;
+
+        const char* data = view->file.Data();
+        const uint64_t size = view->file.Size();
+        int used = 0;
+        int lines = 0;
+
+        while (lines < maxLines && pos < size && bufferSize - used >= 2) {
+            const void* newline = memchr(data + pos, '\n', static_cast<size_t>(size - pos));
+            uint64_t end = newline != NULL ? static_cast<uint64_t>(static_cast<const char*>(newline) - data) : size;
+
+            uint64_t length = end - pos;
+            uint64_t room = static_cast<uint64_t>(bufferSize - used - 1);
+            if (length > room) length = room;
+
+            memcpy(buffer + used, data + pos, static_cast<size_t>(length));
+            used += static_cast<int>(length);
+            buffer[used++] = '\n';
+            lines++;
+            pos = end + 1;
+        }
+        if (view->file.Truncated()) {
+            ResetIndex(*view);
+            continue;
+        }
+
+        if (bytesWritten != NULL) *bytesWritten = used;
+        return lines;
+    }
+    return -1;
+}
+
+} // extern "C"
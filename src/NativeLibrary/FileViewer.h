@@ -0,0 +1,27 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+extern "C" {
+    // Large-file viewing. A view maps the file and builds a sparse line index
+    // (the byte offset of every 1024th line) lazily, only as far as requests
+    // need it, and extends it incrementally when the file grows. Once a line's
+    // checkpoint is indexed, reading it costs at most one checkpoint interval of
+    // scanning regardless of file size. Views are safe to share between threads.
+    // A file truncated under a view (logrotate's copytruncate) never faults
+    // the process: a request that read past the new end starts over.
+    SUPERPANEL_API void* OpenFileView(const char* path);
+    SUPERPANEL_API void CloseFileView(void* handle);
+
+    // Extends the index by at most 64 MB towards the current end of file and
+    // returns the number of lines indexed so far, or -1 on failure. *exact is
+    // set once the whole file is indexed; until then the count is a lower
+    // bound that later calls keep raising.
+    SUPERPANEL_API long long GetFileViewLineCount(void* handle, int* exact);
+
+    // Copies lines [firstLine, firstLine + maxLines) into buffer, each
+    // terminated by '\n'. A line longer than the remaining space is truncated.
+    // Returns the number of lines copied (0 past end of file, -1 on failure)
+    // and the bytes used in *bytesWritten.
+    SUPERPANEL_API int ReadFileViewLines(void* handle, long long firstLine, int maxLines, char* buffer, int bufferSize, int* bytesWritten);
+}
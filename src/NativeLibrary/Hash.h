@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace superpanel {
+
+// XXH64 (https://github.com/Cyan4973/xxHash), reimplemented here so the
+// library has no third-party dependency. Output matches the reference
+// XXH64(data, length, seed) on little-endian targets.
+namespace xxh64 {
+
+const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t RotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t Read64(const unsigned char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t Read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t Round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * Prime2;
+    accumulator = RotateLeft(accumulator, 31);
+    return accumulator * Prime1;
+}
+
+inline uint64_t MergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= Round(0, value);
+    return accumulator * Prime1 + Prime4;
+}
+
+inline uint64_t Avalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Consumes the final < 32 bytes
+inline uint64_t Finalize(uint64_t hash, const unsigned char* p, size_t length) {
+    while (length >= 8) {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+        p += 8;
+        length -= 8;
+    }
+    if (length >= 4) {
+        hash ^= static_cast<uint64_t>(Read32(p)) * Prime1;
+        hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+        p += 4;
+        length -= 4;
+    }
+    while (length > 0) {
+        hash ^= (*p) * Prime5;
+        hash = RotateLeft(hash, 11) * Prime1;
+        p++;
+        length--;
+    }
+    return Avalanche(hash);
+}
+
+} // namespace xxh64
+
+inline uint64_t XXH64(const void* data, size_t length, uint64_t seed = 0) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const size_t total = length;
+    uint64_t hash;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + xxh64::Prime1 + xxh64::Prime2;
+        uint64_t v2 = seed + xxh64::Prime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - xxh64::Prime1;
+        do {
+            v1 = xxh64::Round(v1, xxh64::Read64(p));
+            v2 = xxh64::Round(v2, xxh64::Read64(p + 8));
+            v3 = xxh64::Round(v3, xxh64::Read64(p + 16));
+            v4 = xxh64::Round(v4, xxh64::Read64(p + 24));
+            p += 32;
+            length -= 32;
+        } while (length >= 32);
+
+        hash = xxh64::RotateLeft(v1, 1) + xxh64::RotateLeft(v2, 7) + xxh64::RotateLeft(v3, 12) + xxh64::RotateLeft(v4, 18);
+        hash = xxh64::MergeRound(hash, v1);
+        hash = xxh64::MergeRound(hash, v2);
+        hash = xxh64::MergeRound(hash, v3);
+        hash = xxh64::MergeRound(hash, v4);
+    } else {
+        hash = seed + xxh64::Prime5;
+    }
+
+    hash += static_cast<uint64_t>(total);
+    return xxh64::Finalize(hash, p, length);
+}
+
+} // namespace superpanel
@@ -0,0 +1,873 @@
+#include "pch.h"
+#include "HttpProbe.h"
+#include "DnsResolver.h"
+#include "EventLoop.h"
+#include "TlsClient.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "libssl.lib")
+#pragma comment(lib, "libcrypto.lib")
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+using superpanel::AsyncResolver;
+using superpanel::EventLoop;
+using superpanel::InvalidSocket;
+using superpanel::SocketAddress;
+using superpanel::SocketHandle;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int DefaultTimeoutMs = 10000;
+// Checks in flight at once, as in CheckPorts
+const size_t MaxInFlight = 512;
+const size_t MaxHeaderBytes = 64 * 1024;
+const size_t MaxLineBytes = 4096; // Chunk sizes and trailers
+const long long MaxBodyBytes = 1024 * 1024;
+const size_t MaxIdlePerTarget = 4;
+const size_t MaxIdle = 1024;
+// Servers close idle connections after 5 s (Apache) to 75 s (nginx); a
+// closed one is noticed when taken, so this only bounds what is kept
+const auto IdleTimeout = std::chrono::seconds(30);
+const size_t MaxHistogramHosts = 10000;
+const long long BoundsMs[HTTP_LATENCY_BUCKETS - 1] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000, 60000};
+
+long long MicrosecondsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+bool HasPrefix(const char* text, const char* prefix) {
+    for (; *prefix != '\0'; text++, prefix++) {
+        if (tolower(static_cast<unsigned char>(*text)) != *prefix) return false;
+    }
+    return true;
+}
+
+std::string Lower(std::string text) {
+    for (char& c : text) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return text;
+}
+
+struct Url {
+    bool tls = false;
+    std::string host; // Lower case; IPv6 without brackets
+    int port = 0;
+    std::string path; // With the query, without the fragment
+    std::string authority; // For the Host header
+};
+
+bool ParseUrl(const char* text, Url& url) {
+    if (text == NULL) return false;
+    const char* p = text;
+    if (HasPrefix(p, "https://")) {
+        url.tls = true;
+        p += 8;
+    } else if (HasPrefix(p, "http://")) {
+        p += 7;
+    } else {
+        return false;
+    }
+
+    const char* authorityEnd = p + strcspn(p, "/?#");
+    const std::string authority(p, authorityEnd);
+    if (authority.empty() || authority.find('@') != std::string::npos) return false;
+    std::string port;
+    if (authority[0] == '[') {
+        const size_t close = authority.find(']');
+        if (close == std::string::npos) return false;
+        url.host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size()) {
+            if (authority[close + 1] != ':') return false;
+            port = authority.substr(close + 2);
+        }
+    } else {
+        const size_t colon = authority.find(':');
+        url.host = authority.substr(0, colon);
+        if (colon != std::string::npos) port = authority.substr(colon + 1);
+    }
+    if (url.host.empty()) return false;
+    url.host = Lower(url.host);
+    url.port = url.tls ? 443 : 80;
+    if (!port.empty()) {
+        if (port.size() > 5 || port.find_first_not_of("0123456789") != std::string::npos) return false;
+        url.port = atoi(port.c_str());
+        if (url.port <= 0 || url.port > 65535) return false;
+    }
+
+    url.path.assign(authorityEnd, authorityEnd + strcspn(authorityEnd, "#"));
+    if (url.path.empty() || url.path[0] != '/') url.path.insert(0, "/");
+    for (char c : url.path) {
+        if (static_cast<unsigned char>(c) <= ' ' || c == 0x7F) return false;
+    }
+
+    url.authority = url.host.find(':') != std::string::npos ? "[" + url.host + "]" : url.host;
+    if (url.port != (url.tls ? 443 : 80)) url.authority += ":" + std::to_string(url.port);
+    return true;
+}
+
+// Incremental HTTP/1.1 response reader. Counts the body rather than keeping
+// it, and stops reading at MaxBodyBytes.
+class ResponseParser {
+public:
+    enum Result { NeedMore, Complete, Invalid };
+
+    Result Feed(const char* data, size_t size) {
+        const char* end = data + size;
+        while (data < end) {
+            switch (state_) {
+            case Head: {
+                const size_t scanFrom = head_.size() >= 3 ? head_.size() - 3 : 0;
+                head_.append(data, end);
+                data = end;
+                const size_t headEnd = head_.find("\r\n\r\n", scanFrom);
+                if (headEnd == std::string::npos) return head_.size() > MaxHeaderBytes ? Invalid : NeedMore;
+                const std::string rest = head_.substr(headEnd + 4);
+                head_.resize(headEnd + 2);
+                if (!ParseHead()) return Invalid;
+                head_.clear();
+                if (state_ == Done) {
+                    if (!rest.empty()) keepAlive_ = false;
+                    return Complete;
+                }
+                return rest.empty() ? NeedMore : Feed(rest.data(), rest.size());
+            }
+            case Body: {
+                const size_t available = static_cast<size_t>(end - data);
+                const size_t take = closeDelimited_ ? available : static_cast<size_t>(std::min<long long>(remaining_, static_cast<long long>(available)));
+                bodyBytes_ += static_cast<long long>(take);
+                data += take;
+                if (!closeDelimited_ && (remaining_ -= static_cast<long long>(take)) == 0) state_ = Done;
+                break;
+            }
+            case ChunkSize:
+                if (!TakeLine(data, end)) break;
+                if (!ParseChunkSize()) return Invalid;
+                state_ = remaining_ == 0 ? Trailer : ChunkData;
+                break;
+            case ChunkData: {
+                const size_t take = static_cast<size_t>(std::min<long long>(remaining_, end - data));
+                bodyBytes_ += static_cast<long long>(take);
+                data += take;
+                if ((remaining_ -= static_cast<long long>(take)) == 0) state_ = ChunkEnd;
+                break;
+            }
+            case ChunkEnd:
+                if (!TakeLine(data, end)) break;
+                if (line_ != "\r\n" && line_ != "\n") return Invalid;
+                line_.clear();
+                state_ = ChunkSize;
+                break;
+            case Trailer:
+                if (!TakeLine(data, end)) break;
+                if (line_ == "\r\n" || line_ == "\n") state_ = Done;
+                line_.clear();
+                break;
+            case Done:
+                break;
+            }
+            if (line_.size() > MaxLineBytes) return Invalid;
+            if (bodyBytes_ > MaxBodyBytes) {
+                keepAlive_ = false; // The rest is not worth reading
+                return Complete;
+            }
+            if (state_ == Done) {
+                if (data < end) keepAlive_ = false; // Bytes we never asked for
+                return Complete;
+            }
+        }
+        return state_ == Done ? Complete : NeedMore;
+    }
+
+    // At end of stream: only a body delimited by the close is complete
+    Result Finish() {
+        keepAlive_ = false;
+        if (state_ == Body && closeDelimited_) {
+            state_ = Done;
+            return Complete;
+        }
+        return Invalid;
+    }
+
+    int Status() const { return status_; }
+    long long BodyBytes() const { return bodyBytes_; }
+    bool KeepAlive() const { return keepAlive_; }
+
+private:
+    enum State { Head, Body, ChunkSize, ChunkData, ChunkEnd, Trailer, Done };
+
+    bool ParseHead() {
+        if (head_.size() < 12 || head_.compare(0, 7, "HTTP/1.") != 0 || head_[8] != ' ') return false;
+        int status = 0;
+        for (size_t i = 9; i < 12; i++) {
+            if (!isdigit(static_cast<unsigned char>(head_[i]))) return false;
+            status = status * 10 + (head_[i] - '0');
+        }
+        status_ = status;
+        keepAlive_ = head_[7] != '0';
+        bool chunked = false;
+        long long length = -1;
+        for (size_t line = head_.find("\r\n") + 2; line < head_.size();) {
+            const size_t lineEnd = head_.find("\r\n", line);
+            const size_t colon = head_.find(':', line);
+            if (colon != std::string::npos && colon < lineEnd) {
+                const std::string name = Lower(head_.substr(line, colon - line));
+                size_t valueStart = head_.find_first_not_of(" \t", colon + 1);
+                if (valueStart == std::string::npos || valueStart > lineEnd) valueStart = lineEnd;
+                const std::string value = Lower(head_.substr(valueStart, lineEnd - valueStart));
+                if (name == "content-length") {
+                    if (value.empty() || value.size() > 18) return false;
+                    length = 0;
+                    for (char c : value) {
+                        if (c == ' ' || c == '\t') break;
+                        if (!isdigit(static_cast<unsigned char>(c))) return false;
+                        length = length * 10 + (c - '0');
+                    }
+                } else if (name == "transfer-encoding") {
+                    chunked = value.find("chunked") != std::string::npos;
+                } else if (name == "connection") {
+                    if (value.find("close") != std::string::npos) keepAlive_ = false;
+                    else if (value.find("keep-alive") != std::string::npos) keepAlive_ = true;
+                }
+            }
+            line = lineEnd + 2;
+        }
+
+        if (status_ >= 100 && status_ < 200) {
+            // 100 Continue and friends precede the real response; we never ask to switch protocols
+            if (status_ == 101) return false;
+            state_ = Head;
+        } else if (status_ == 204 || status_ == 304) {
+            state_ = Done;
+        } else if (chunked) {
+            state_ = ChunkSize;
+        } else if (length >= 0) {
+            remaining_ = length;
+            state_ = length == 0 ? Done : Body;
+        } else {
+            closeDelimited_ = true;
+            keepAlive_ = false;
+            state_ = Body;
+        }
+        return true;
+    }
+
+    // Appends through the next '\n' to line_; true once the line is whole
+    bool TakeLine(const char*& data, const char* end) {
+        const char* newline = static_cast<const char*>(memchr(data, '\n', static_cast<size_t>(end - data)));
+        const char* stop = newline != nullptr ? newline + 1 : end;
+        line_.append(data, stop);
+        data = stop;
+        return newline != nullptr;
+    }
+
+    bool ParseChunkSize() {
+        long long size = 0;
+        size_t digits = 0;
+        for (char c : line_) {
+            int value = isdigit(static_cast<unsigned char>(c)) ? c - '0' : isxdigit(static_cast<unsigned char>(c)) ? tolower(c) - 'a' + 10 : -1;
+            if (value < 0) break; // Extensions after ';', or the CRLF
+            if (++digits > 15) return false;
+            size = size * 16 + value;
+        }
+        line_.clear();
+        remaining_ = size;
+        return digits > 0;
+    }
+
+    State state_ = Head;
+    std::string head_;
+    std::string line_;
+    int status_ = 0;
+    bool keepAlive_ = false;
+    bool closeDelimited_ = false;
+    long long remaining_ = 0;
+    long long bodyBytes_ = 0;
+};
+
+struct Connection {
+    SocketHandle socket = InvalidSocket;
+    SSL* ssl = nullptr;
+    Clock::time_point idleSince;
+};
+
+void CloseConnection(Connection& connection, bool abort) {
+    if (connection.ssl != nullptr) SSL_free(connection.ssl);
+    if (abort) superpanel::AbortSocket(connection.socket);
+    else superpanel::CloseSocket(connection.socket);
+    connection = Connection();
+}
+
+// Moves bytes over plain TCP or TLS. Returns the count, 0 at end of stream,
+// -EAGAIN with waitFor set to the readiness to wait for, or minus an error.
+int Transfer(Connection& connection, char* data, size_t size, bool write, uint32_t& waitFor) {
+    if (connection.ssl == nullptr) {
+        int moved = write ? superpanel::SendSome(connection.socket, data, size) : superpanel::ReceiveSome(connection.socket, data, size);
+        if (moved == -EAGAIN) waitFor = write ? EventLoop::Writable : EventLoop::Readable;
+        return moved;
+    }
+    ERR_clear_error();
+    const int length = static_cast<int>(std::min<size_t>(size, 1 << 30));
+    int moved = write ? SSL_write(connection.ssl, data, length) : SSL_read(connection.ssl, data, length);
+    if (moved > 0) return moved;
+    switch (SSL_get_error(connection.ssl, moved)) {
+    case SSL_ERROR_WANT_READ:
+        waitFor = EventLoop::Readable;
+        return -EAGAIN;
+    case SSL_ERROR_WANT_WRITE:
+        waitFor = EventLoop::Writable;
+        return -EAGAIN;
+    case SSL_ERROR_ZERO_RETURN:
+        return 0;
+    default:
+        return -ECONNRESET;
+    }
+}
+
+// Idle connections kept alive between batches, most recently used first
+class ConnectionPool {
+public:
+    // An idle connection to key that the server has not closed, or false
+    bool Take(const std::string& key, Connection& connection) {
+        std::vector<Connection> stale;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            auto entry = idle_.find(key);
+            if (entry == idle_.end()) return false;
+            const auto now = Clock::now();
+            while (!entry->second.empty() && !found) {
+                Connection candidate = entry->second.back();
+                entry->second.pop_back();
+                count_--;
+                if (now - candidate.idleSince < IdleTimeout && StillOpen(candidate)) {
+                    connection = candidate;
+                    found = true;
+                } else {
+                    stale.push_back(candidate);
+                }
+            }
+            if (entry->second.empty()) idle_.erase(entry);
+        }
+        for (Connection& connection : stale) CloseConnection(connection, false);
+        return found;
+    }
+
+    void Put(const std::string& key, Connection connection) {
+        connection.idleSince = Clock::now();
+        std::vector<Connection> closing;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (count_ >= MaxIdle) SweepExpired(closing);
+            std::vector<Connection>& list = idle_[key];
+            if (list.size() < MaxIdlePerTarget && count_ < MaxIdle) {
+                list.push_back(connection);
+                count_++;
+            } else {
+                closing.push_back(connection);
+                if (list.empty()) idle_.erase(key);
+            }
+        }
+        for (Connection& stale : closing) CloseConnection(stale, false);
+    }
+
+private:
+    // An idle connection has nothing to say; data or end of stream means the
+    // server closed it (or sent a TLS alert or close_notify)
+    static bool StillOpen(const Connection& connection) {
+        char byte;
+        return superpanel::ReceiveSome(connection.socket, &byte, 1, true) == -EAGAIN;
+    }
+
+    void SweepExpired(std::vector<Connection>& closing) {
+        const auto now = Clock::now();
+        for (auto entry = idle_.begin(); entry != idle_.end();) {
+            auto& list = entry->second;
+            for (auto it = list.begin(); it != list.end();) {
+                if (now - it->idleSince < IdleTimeout) {
+                    ++it;
+                    continue;
+                }
+                closing.push_back(*it);
+                it = list.erase(it);
+                count_--;
+            }
+            entry = list.empty() ? idle_.erase(entry) : std::next(entry);
+        }
+    }
+
+    std::mutex lock_;
+    std::unordered_map<std::string, std::vector<Connection>> idle_;
+    size_t count_ = 0;
+};
+
+// Never destroyed: pooled SSL objects must not be freed after OpenSSL's own
+// exit-time cleanup
+ConnectionPool& Pool() {
+    static ConnectionPool* pool = new ConnectionPool();
+    return *pool;
+}
+
+std::mutex histogramLock;
+std::unordered_map<std::string, HttpLatencyHistogram> histograms;
+
+void Record(const std::string& host, const HttpCheckResult& result) {
+    std::lock_guard<std::mutex> guard(histogramLock);
+    auto found = histograms.find(host);
+    if (found == histograms.end()) {
+        if (histograms.size() >= MaxHistogramHosts) return;
+        found = histograms.emplace(host, HttpLatencyHistogram()).first;
+    }
+    HttpLatencyHistogram& histogram = found->second;
+    histogram.checks++;
+    if (result.status != HTTP_CHECK_OK) {
+        histogram.failures++;
+        return;
+    }
+    int bucket = 0;
+    while (bucket < HTTP_LATENCY_BUCKETS - 1 && result.totalUs > BoundsMs[bucket] * 1000) bucket++;
+    histogram.buckets[bucket]++;
+    histogram.dnsUsSum += result.dnsUs;
+    histogram.connectUsSum += result.connectUs;
+    histogram.tlsUsSum += result.tlsUs;
+    histogram.ttfbUsSum += result.ttfbUs;
+    histogram.totalUsSum += result.totalUs;
+}
+
+enum class Phase { Waiting, Resolving, Connecting, Handshaking, Sending, Receiving, Done };
+
+struct Check {
+    Url url;
+    std::string key; // Pool key: scheme, host and port
+    std::string request;
+    Phase phase = Phase::Waiting;
+    Clock::time_point started;
+    Clock::time_point deadline;
+    Clock::time_point phaseStarted;
+    std::vector<SocketAddress> addresses;
+    size_t nextAddress = 0;
+    int lastError = 0;
+    Connection connection;
+    uint32_t interest = 0;
+    bool reused = false;
+    bool retried = false; // A reused connection was found closed and replaced
+    bool gotFirstByte = false;
+    size_t sent = 0;
+    ResponseParser response;
+};
+
+struct Expiry {
+    Clock::time_point deadline;
+    size_t check;
+    bool operator>(const Expiry& other) const { return deadline > other.deadline; }
+};
+
+class HttpChecker {
+public:
+    HttpChecker(const char* const* urls, const int* timeoutsMs, HttpCheckResult* results)
+        : urls_(urls), timeoutsMs_(timeoutsMs), results_(results), resolver_(loop_) {}
+
+    ~HttpChecker() {
+        for (Check& check : checks_) {
+            if (check.connection.socket != InvalidSocket) CloseConnection(check.connection, true);
+        }
+    }
+
+    bool Run(int count) {
+        if (!loop_.IsValid()) return false;
+        checks_.resize(static_cast<size_t>(count));
+        size_t next = 0;
+        std::vector<EventLoop::Event> events;
+        while (true) {
+            while (next < checks_.size() && active_ < MaxInFlight) Start(next++);
+            const int resolverWaitMs = resolver_.Tick();
+            if (active_ == 0) {
+                if (next < checks_.size()) continue;
+                break;
+            }
+
+            const auto now = Clock::now();
+            int waitMs = resolverWaitMs;
+            if (!expiries_.empty()) {
+                int expiryMs = expiries_.top().deadline > now
+                    ? static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(expiries_.top().deadline - now).count()) + 1
+                    : 0;
+                waitMs = waitMs < 0 ? expiryMs : std::min(waitMs, expiryMs);
+            }
+            if (!loop_.Wait(waitMs, events)) return false;
+            for (const EventLoop::Event& event : events) {
+                if (AsyncResolver::OwnsToken(event.token)) resolver_.OnEvent(event);
+                else OnEvent(static_cast<size_t>(event.token));
+            }
+            ExpireOverdue();
+        }
+        return true;
+    }
+
+    // Host of a check whose URL parsed, else NULL
+    const std::string* Host(size_t index) const {
+        return results_[index].status == HTTP_CHECK_INVALID_URL ? nullptr : &checks_[index].url.host;
+    }
+
+private:
+    void Start(size_t index) {
+        Check& check = checks_[index];
+        HttpCheckResult& result = results_[index];
+        memset(&result, 0, sizeof(result));
+        result.dnsUs = result.connectUs = result.tlsUs = result.ttfbUs = -1;
+        if (!ParseUrl(urls_[index], check.url)) {
+            result.status = HTTP_CHECK_INVALID_URL;
+            result.error = EINVAL;
+            check.phase = Phase::Done;
+            return;
+        }
+        const Url& url = check.url;
+        check.key = (url.tls ? "https://" : "http://") + url.host + "|" + std::to_string(url.port);
+        check.request = "GET " + url.path + " HTTP/1.1\r\nHost: " + url.authority +
+                        "\r\nUser-Agent: SuperPanel-HealthCheck/1.0\r\nAccept: */*\r\nConnection: keep-alive\r\n\r\n";
+        const int timeoutMs = timeoutsMs_ != NULL && timeoutsMs_[index] > 0 ? timeoutsMs_[index] : DefaultTimeoutMs;
+        check.started = Clock::now();
+        check.deadline = check.started + std::chrono::milliseconds(timeoutMs);
+        expiries_.push(Expiry{check.deadline, index});
+        active_++;
+
+        Connection pooled;
+        if (Pool().Take(check.key, pooled)) {
+            check.connection = pooled;
+            check.reused = true;
+            result.reused = 1;
+            result.dnsUs = result.connectUs = result.tlsUs = 0;
+            if (!Watch(index, EventLoop::Writable)) return;
+            StartSending(index);
+            return;
+        }
+        Resolve(index);
+    }
+
+    void Resolve(size_t index) {
+        Check& check = checks_[index];
+        check.phase = Phase::Resolving;
+        check.phaseStarted = Clock::now();
+        // May call back before returning (literals, cached names)
+        resolver_.Resolve(check.url.host, check.url.port, check.deadline,
+                          [this, index](int error, const std::vector<SocketAddress>& addresses) { OnResolved(index, error, addresses); });
+    }
+
+    void OnResolved(size_t index, int error, const std::vector<SocketAddress>& addresses) {
+        Check& check = checks_[index];
+        if (check.phase != Phase::Resolving) return; // Timed out meanwhile
+        results_[index].dnsUs = MicrosecondsSince(check.phaseStarted);
+        if (error != 0) {
+            Fail(index, error == EINVAL ? HTTP_CHECK_INVALID_URL : HTTP_CHECK_UNRESOLVED, error);
+            return;
+        }
+        check.addresses = addresses;
+        check.nextAddress = 0;
+        ConnectNext(index);
+    }
+
+    // Tries the addresses in turn until one accepts the connection
+    void ConnectNext(size_t index) {
+        Check& check = checks_[index];
+        while (check.nextAddress < check.addresses.size() && Clock::now() < check.deadline) {
+            const SocketAddress& address = check.addresses[check.nextAddress++];
+            SocketHandle socket = superpanel::OpenNonBlockingSocket(address.Family(), SOCK_STREAM, IPPROTO_TCP);
+            if (socket == InvalidSocket) {
+                check.lastError = address.Family() == AF_INET6 ? EAFNOSUPPORT : EMFILE;
+                continue;
+            }
+            // The request goes out in one write; don't let Nagle hold back a tail
+            int noDelay = 1;
+            setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+            check.phaseStarted = Clock::now();
+            int error = superpanel::StartConnect(socket, address.Get(), address.length);
+            if (error != 0 && error != EINPROGRESS) {
+                superpanel::AbortSocket(socket);
+                check.lastError = error;
+                continue;
+            }
+            check.connection.socket = socket;
+            check.phase = Phase::Connecting;
+            Watch(index, EventLoop::Writable);
+            return;
+        }
+        if (Clock::now() >= check.deadline) Fail(index, HTTP_CHECK_TIMEOUT, ETIMEDOUT);
+        else Fail(index, HTTP_CHECK_CONNECT_FAILED, check.lastError != 0 ? check.lastError : EHOSTUNREACH);
+    }
+
+    // Registers the check's socket; fails the check if that is impossible
+    bool Watch(size_t index, uint32_t interest) {
+        Check& check = checks_[index];
+        if (!loop_.Add(check.connection.socket, interest, index)) {
+            Fail(index, HTTP_CHECK_CONNECT_FAILED, errno != 0 ? errno : EMFILE);
+            return false;
+        }
+        check.interest = interest;
+        return true;
+    }
+
+    void SetInterest(size_t index, uint32_t interest) {
+        Check& check = checks_[index];
+        if (check.interest == interest) return;
+        loop_.Modify(check.connection.socket, interest, index);
+        check.interest = interest;
+    }
+
+    void OnEvent(size_t index) {
+        Check& check = checks_[index];
+        switch (check.phase) {
+        case Phase::Connecting: {
+            int error = superpanel::PendingSocketError(check.connection.socket);
+            if (error != 0) {
+                loop_.Remove(check.connection.socket);
+                CloseConnection(check.connection, true);
+                check.lastError = error;
+                ConnectNext(index);
+                return;
+            }
+            results_[index].connectUs = MicrosecondsSince(check.phaseStarted);
+            if (check.url.tls) StartTls(index);
+            else {
+                results_[index].tlsUs = 0;
+                StartSending(index);
+            }
+            return;
+        }
+        case Phase::Handshaking: Handshake(index); return;
+        case Phase::Sending: Send(index); return;
+        case Phase::Receiving: Receive(index); return;
+        default: return;
+        }
+    }
+
+    void StartTls(size_t index) {
+        Check& check = checks_[index];
+        SSL_CTX* context = superpanel::TlsClientContext();
+        SSL* ssl = context != NULL ? SSL_new(context) : NULL;
+        if (ssl == NULL || SSL_set_fd(ssl, static_cast<int>(check.connection.socket)) != 1) {
+            if (ssl != NULL) SSL_free(ssl);
+            Fail(index, HTTP_CHECK_TLS_FAILED, ENOMEM);
+            return;
+        }
+        check.connection.ssl = ssl;
+        SocketAddress literal;
+        if (superpanel::ParseAddressLiteral(check.url.host.c_str(), 0, literal)) {
+            X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), check.url.host.c_str());
+        } else {
+            SSL_set_tlsext_host_name(ssl, check.url.host.c_str());
+            SSL_set1_host(ssl, check.url.host.c_str());
+        }
+        SSL_set_connect_state(ssl);
+        check.phase = Phase::Handshaking;
+        check.phaseStarted = Clock::now();
+        Handshake(index);
+    }
+
+    void Handshake(size_t index) {
+        Check& check = checks_[index];
+        ERR_clear_error();
+        int done = SSL_do_handshake(check.connection.ssl);
+        if (done == 1) {
+            results_[index].tlsUs = MicrosecondsSince(check.phaseStarted);
+            StartSending(index);
+            return;
+        }
+        switch (SSL_get_error(check.connection.ssl, done)) {
+        case SSL_ERROR_WANT_READ: SetInterest(index, EventLoop::Readable); return;
+        case SSL_ERROR_WANT_WRITE: SetInterest(index, EventLoop::Writable); return;
+        default: {
+            const long verify = SSL_get_verify_result(check.connection.ssl);
+            results_[index].certificateError = verify != X509_V_OK ? verify : 0;
+            Fail(index, HTTP_CHECK_TLS_FAILED, EPROTO);
+            return;
+        }
+        }
+    }
+
+    void StartSending(size_t index) {
+        Check& check = checks_[index];
+        check.phase = Phase::Sending;
+        check.phaseStarted = Clock::now();
+        check.sent = 0;
+        Send(index);
+    }
+
+    void Send(size_t index) {
+        Check& check = checks_[index];
+        while (check.sent < check.request.size()) {
+            uint32_t waitFor = 0;
+            int sent = Transfer(check.connection, &check.request[check.sent], check.request.size() - check.sent, true, waitFor);
+            if (sent == -EAGAIN) {
+                SetInterest(index, waitFor);
+                return;
+            }
+            if (sent <= 0) {
+                ConnectionLost(index, sent < 0 ? -sent : EPIPE);
+                return;
+            }
+            check.sent += static_cast<size_t>(sent);
+        }
+        check.phase = Phase::Receiving;
+        SetInterest(index, EventLoop::Readable);
+        Receive(index); // A TLS record may already be buffered
+    }
+
+    void Receive(size_t index) {
+        Check& check = checks_[index];
+        char buffer[16384];
+        while (true) {
+            uint32_t waitFor = 0;
+            int received = Transfer(check.connection, buffer, sizeof(buffer), false, waitFor);
+            if (received == -EAGAIN) {
+                SetInterest(index, waitFor);
+                return;
+            }
+            if (received < 0) {
+                ConnectionLost(index, -received);
+                return;
+            }
+            if (received == 0) {
+                if (!check.gotFirstByte) ConnectionLost(index, ECONNRESET);
+                else if (check.response.Finish() == ResponseParser::Complete) Complete(index);
+                else Fail(index, HTTP_CHECK_BAD_RESPONSE, ECONNRESET);
+                return;
+            }
+            if (!check.gotFirstByte) {
+                check.gotFirstByte = true;
+                results_[index].ttfbUs = MicrosecondsSince(check.phaseStarted);
+            }
+            switch (check.response.Feed(buffer, static_cast<size_t>(received))) {
+            case ResponseParser::Complete: Complete(index); return;
+            case ResponseParser::Invalid: Fail(index, HTTP_CHECK_BAD_RESPONSE, EPROTO); return;
+            default: break;
+            }
+        }
+    }
+
+    // A kept-alive connection the server closed just as we reused it is
+    // retried once on a fresh connection; anything else fails the check
+    void ConnectionLost(size_t index, int error) {
+        Check& check = checks_[index];
+        if (check.reused && !check.retried && !check.gotFirstByte && Clock::now() < check.deadline) {
+            loop_.Remove(check.connection.socket);
+            CloseConnection(check.connection, true);
+            check.reused = false;
+            check.retried = true;
+            check.response = ResponseParser();
+            HttpCheckResult& result = results_[index];
+            result.reused = 0;
+            result.dnsUs = result.connectUs = result.tlsUs = result.ttfbUs = -1;
+            Resolve(index);
+            return;
+        }
+        Fail(index, HTTP_CHECK_BAD_RESPONSE, error);
+    }
+
+    void Complete(size_t index) {
+        Check& check = checks_[index];
+        HttpCheckResult& result = results_[index];
+        result.status = HTTP_CHECK_OK;
+        result.httpStatus = check.response.Status();
+        result.bodyBytes = check.response.BodyBytes();
+        result.totalUs = MicrosecondsSince(check.started);
+        loop_.Remove(check.connection.socket);
+        if (check.response.KeepAlive()) {
+            Pool().Put(check.key, check.connection);
+            check.connection = Connection();
+        } else {
+            CloseConnection(check.connection, false);
+        }
+        check.phase = Phase::Done;
+        active_--;
+    }
+
+    void Fail(size_t index, long long status, int error) {
+        Check& check = checks_[index];
+        if (check.phase == Phase::Done) return;
+        HttpCheckResult& result = results_[index];
+        result.status = status;
+        result.error = error;
+        result.totalUs = MicrosecondsSince(check.started);
+        if (check.connection.socket != InvalidSocket) {
+            loop_.Remove(check.connection.socket);
+            CloseConnection(check.connection, true);
+        }
+        check.phase = Phase::Done;
+        active_--;
+    }
+
+    void ExpireOverdue() {
+        const auto now = Clock::now();
+        while (!expiries_.empty() && expiries_.top().deadline <= now) {
+            const size_t index = expiries_.top().check;
+            expiries_.pop();
+            Fail(index, HTTP_CHECK_TIMEOUT, ETIMEDOUT);
+        }
+    }
+
+    const char* const* urls_;
+    const int* timeoutsMs_;
+    HttpCheckResult* results_;
+
+    EventLoop loop_;
+    AsyncResolver resolver_;
+    std::vector<Check> checks_;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiries_;
+    size_t active_ = 0;
+};
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API int CheckHttp(const char* const* urls, const int* timeoutsMs, int count, HttpCheckResult* results) {
+    if (count <= 0) return 0;
+    if (urls == NULL || results == NULL || !superpanel::InitializeSockets()) return -1;
+
+    int answered = 0;
+    {
+        HttpChecker checker(urls, timeoutsMs, results);
+        if (!checker.Run(count)) return -1;
+        for (int i = 0; i < count; i++) {
+            if (results[i].status == HTTP_CHECK_OK) answered++;
+            if (const std::string* host = checker.Host(static_cast<size_t>(i))) Record(*host, results[i]);
+        }
+    }
+    return answered;
+}
+
+SUPERPANEL_API int GetHttpLatencyHistogram(const char* host, HttpLatencyHistogram* histogram, long long* boundsMs) {
+    if (boundsMs != NULL) memcpy(boundsMs, BoundsMs, sizeof(BoundsMs));
+    if (host == NULL || histogram == NULL) return 0;
+    std::lock_guard<std::mutex> guard(histogramLock);
+    auto found = histograms.find(Lower(host));
+    if (found == histograms.end()) return 0;
+    *histogram = found->second;
+    return 1;
+}
+
+SUPERPANEL_API void ResetHttpLatencyHistograms() {
+    std::lock_guard<std::mutex> guard(histogramLock);
+    histograms.clear();
+}
+
+} // extern "C"
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Outcome of an HTTP check
+#define HTTP_CHECK_OK             0 // A complete response arrived; httpStatus says which
+#define HTTP_CHECK_INVALID_URL    1 // Not http:// or https://, no host, or a bad port
+#define HTTP_CHECK_UNRESOLVED     2 // Name does not exist (ENOENT) or DNS timed out
+#define HTTP_CHECK_CONNECT_FAILED 3 // Refused or unreachable on every address
+#define HTTP_CHECK_TLS_FAILED     4 // Handshake failed or the certificate was rejected
+#define HTTP_CHECK_TIMEOUT        5
+#define HTTP_CHECK_BAD_RESPONSE   6 // Not HTTP/1.x, or the connection closed mid-response
+
+#define HTTP_LATENCY_BUCKETS 16
+
+struct HttpCheckResult {
+    long long status;     // HTTP_CHECK_*
+    long long httpStatus; // 0 without a response
+    // Phase durations, -1 for phases not reached. A reused connection skips
+    // DNS, connect and TLS (0), as plain HTTP skips TLS.
+    long long dnsUs;
+    long long connectUs;
+    long long tlsUs;
+    long long ttfbUs;  // Request written to first response byte
+    long long totalUs; // The whole check, body included
+    long long bodyBytes;
+    long long reused;           // 1 if a kept-alive connection served the check
+    long long error;            // errno-style code of the failure, 0 otherwise
+    long long certificateError; // X509_V_ERR_* when the certificate was rejected, else 0
+};
+
+struct HttpLatencyHistogram {
+    long long checks;   // Since the first check of the host or the last reset
+    long long failures; // Checks without a complete response
+    long long buckets[HTTP_LATENCY_BUCKETS]; // Successful checks by total time
+    // Over successful checks, for per-phase averages
+    long long dnsUsSum, connectUsSum, tlsUsSum, ttfbUsSum, totalUsSum;
+};
+
+extern "C" {
+    // Runs count HTTP/1.1 GET checks at once on one event loop, like
+    // CheckPorts. urls are http:// or https:// URLs; each check has its own
+    // timeout (timeoutsMs may be NULL for 10 s each) covering every phase.
+    // Names go through the DnsResolver cache. HTTPS verifies the certificate
+    // against the system roots and the host name. Bodies are read (up to
+    // 1 MB) so connections the server keeps alive can go back to a
+    // process-wide idle pool, keyed by scheme, host and port, for the next
+    // check of the same target; a pooled connection the server has closed is
+    // replaced transparently. Blocks until every check has finished; returns
+    // the number that got a response, or -1 if the event loop cannot be
+    // created.
+    SUPERPANEL_API int CheckHttp(const char* const* urls, const int* timeoutsMs, int count, HttpCheckResult* results);
+
+    // Latency of the checks of host so far. Bucket i counts totals up to
+    // boundsMs[i] - 1, 2, 5, 10, 20, 50, 100, 200, 500 ms, 1, 2, 5, 10, 30,
+    // 60 s - and the last bucket everything slower. boundsMs (may be NULL)
+    // receives the HTTP_LATENCY_BUCKETS - 1 bounds. Returns 1, or 0 if host
+    // has not been checked.
+    SUPERPANEL_API int GetHttpLatencyHistogram(const char* host, HttpLatencyHistogram* histogram, long long* boundsMs);
+    SUPERPANEL_API void ResetHttpLatencyHistograms();
+}
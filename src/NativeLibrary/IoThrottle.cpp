@@ -0,0 +1,320 @@
+#include "pch.h"
+#include "IoThrottle.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace std::chrono;
+
+namespace superpanel {
+
+nanoseconds TokenBucket::Acquire(uint64_t bytes, const std::atomic<bool>& cancelled) {
+    const long long rate = bytesPerSecond_;
+    if (rate <= 0 || bytes == 0) return nanoseconds(0);
+    const auto cost = nanoseconds(static_cast<long long>(static_cast<double>(bytes) * 1e9 / static_cast<double>(rate)));
+    steady_clock::time_point slot;
+    const auto now = steady_clock::now();
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        next_ = std::max(next_, now - milliseconds(250));
+        slot = next_;
+        next_ += cost;
+    }
+    // Short sleeps, so a cancelled job is not held up by a long reservation
+    while (!cancelled && steady_clock::now() < slot) {
+        std::this_thread::sleep_for(std::min<steady_clock::duration>(slot - steady_clock::now(), milliseconds(100)));
+    }
+    return slot > now ? duration_cast<nanoseconds>(steady_clock::now() - now) : nanoseconds(0);
+}
+
+} // namespace superpanel
+
+namespace {
+
+const auto SampleInterval = milliseconds(500);
+
+// Other processes' disk traffic below this (bytes/s) leaves the backup as the
+// only significant I/O source; journald and log appends stay well under it
+const double ForeignIoFloor = 512.0 * 1024;
+
+// Weight of the newest sample in the smoothed throughputs
+const double RateSmoothing = 0.25;
+
+struct DiskCounters {
+    unsigned long long requests = 0;
+    unsigned long long busyMs = 0;  // Time spent on reads and writes
+    unsigned long long sectors = 0; // 512-byte sectors read and written
+};
+
+class AdaptiveThrottle {
+public:
+    void Configure(long long maxRate, long long minRate, int pressurePercent, int latencyMs) {
+        std::lock_guard<std::mutex> guard(sampleLock_);
+        maxRate = std::max(maxRate, 0LL);
+        minRate = std::min(std::max(minRate, 1LL), std::max(maxRate, 1LL));
+        if (maxRate != maxRate_) bucket_.SetRate(maxRate);
+        else bucket_.SetRate(std::min(std::max(bucket_.Rate(), minRate), maxRate));
+        maxRate_ = maxRate;
+        minRate_ = minRate;
+        pressureThreshold_ = pressurePercent > 0 ? pressurePercent * 100LL : 0;
+        latencyThresholdUs_ = latencyMs > 0 ? latencyMs * 1000LL : 0;
+    }
+
+    void Throttle(uint64_t bytes, const std::atomic<bool>& cancelled) {
+        if (maxRate_ <= 0) return;
+        MaybeSample();
+        nanoseconds waited = bucket_.Acquire(bytes, cancelled);
+        bytesGranted_ += static_cast<long long>(bytes);
+        waitedNs_ += waited.count();
+    }
+
+    void GetState(BackupThrottleState& state) {
+        std::lock_guard<std::mutex> guard(sampleLock_);
+        state.maxBytesPerSecond = maxRate_;
+        state.minBytesPerSecond = minRate_;
+        state.bytesPerSecond = maxRate_ > 0 ? bucket_.Rate() : 0;
+        state.ioPressure = pressure_;
+        state.diskLatencyUs = latencyUs_;
+        state.backoffs = backoffs_;
+        state.bytesGranted = bytesGranted_;
+        state.throttledMs = waitedNs_ / 1000000;
+    }
+
+private:
+    // Whichever caller finds the last sample stale takes the next one; the
+    // others carry on at the current rate rather than wait for it
+    void MaybeSample() {
+        const auto now = steady_clock::now();
+        if (now - lastSample_.load() < SampleInterval) return;
+        std::unique_lock<std::mutex> guard(sampleLock_, std::try_to_lock);
+        if (!guard.owns_lock() || now - lastSample_.load() < SampleInterval) return;
+
+        const double elapsedUs = static_cast<double>(duration_cast<microseconds>(now - lastSample_.load()).count());
+        if (now - lastSample_.load() > SampleInterval * 4) {
+            // Backups were idle; counters averaged over that gap say nothing
+            // about the disks now, so start a fresh baseline
+            pressureTotal_ = 0;
+            disks_.clear();
+            ownIoTotal_ = -1;
+            diskRate_ = -1;
+        }
+        lastSample_ = now;
+        pressure_ = SamplePressure(elapsedUs);
+        long long diskBytes = -1;
+        latencyUs_ = SampleLatency(diskBytes);
+        const long long ownBytes = SampleOwnIo();
+
+        // Pressure and latency include the backup's own I/O, so they only
+        // count as contention while something else is using the disks too
+        const bool alone = OnlyIoSource(diskBytes, ownBytes, elapsedUs);
+        const bool congested = !alone && ((pressureThreshold_ > 0 && pressure_ >= pressureThreshold_) ||
+                                          (latencyThresholdUs_ > 0 && latencyUs_ >= latencyThresholdUs_));
+        const long long rate = bucket_.Rate();
+        if (congested) {
+            if (rate > minRate_) backoffs_++;
+            bucket_.SetRate(std::max(minRate_, rate / 2));
+        } else {
+            const long long maxRate = maxRate_;
+            bucket_.SetRate(std::min(maxRate, rate + std::max(maxRate / 16, 1LL)));
+        }
+    }
+
+    // "some" stall time since the previous sample, as a share of the interval
+    long long SamplePressure(double elapsedUs) {
+#ifdef _WIN32
+        (void)elapsedUs;
+        return -1;
+#else
+        FILE* file = fopen("/proc/pressure/io", "r");
+        if (file == NULL) return -1;
+        char line[256];
+        unsigned long long total = 0;
+        bool found = false;
+        while (fgets(line, sizeof(line), file)) {
+            const char* field = strstr(line, "total=");
+            if (strncmp(line, "some ", 5) == 0 && field != NULL && sscanf(field, "total=%llu", &total) == 1) {
+                found = true;
+                break;
+            }
+        }
+        fclose(file);
+        if (!found) return -1;
+
+        long long result = -1;
+        if (pressureTotal_ > 0 && total >= pressureTotal_ && elapsedUs > 0) {
+            result = std::min(10000LL, static_cast<long long>(static_cast<double>(total - pressureTotal_) * 10000.0 / elapsedUs));
+        }
+        pressureTotal_ = total;
+        return result;
+#endif
+    }
+
+    // Whether the disks moved little beyond this process's own reads and
+    // writes. Both throughputs are smoothed over a few samples, since
+    // writeback reaches the disks a while after /proc/self/io counts it.
+    // Unknown counters never count as alone.
+    bool OnlyIoSource(long long diskBytes, long long ownBytes, double elapsedUs) {
+        if (diskBytes < 0 || ownBytes < 0 || elapsedUs <= 0) return false;
+        const double diskRate = static_cast<double>(diskBytes) * 1e6 / elapsedUs;
+        const double ownRate = static_cast<double>(ownBytes) * 1e6 / elapsedUs;
+        if (diskRate_ < 0) {
+            diskRate_ = diskRate;
+            ownRate_ = ownRate;
+        } else {
+            diskRate_ += (diskRate - diskRate_) * RateSmoothing;
+            ownRate_ += (ownRate - ownRate_) * RateSmoothing;
+        }
+        return diskRate_ - ownRate_ < ForeignIoFloor;
+    }
+
+    // Bytes this process made the storage layer read or write since the
+    // previous sample (backups and anything else it runs), -1 if unknown
+    long long SampleOwnIo() {
+#ifdef _WIN32
+        return -1;
+#else
+        FILE* file = fopen("/proc/self/io", "r");
+        if (file == NULL) return -1;
+        char line[128];
+        unsigned long long value = 0;
+        long long total = 0;
+        int found = 0;
+        while (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "read_bytes: %llu", &value) == 1 || sscanf(line, "write_bytes: %llu", &value) == 1) {
+                total += static_cast<long long>(value);
+                found++;
+            } else if (sscanf(line, "cancelled_write_bytes: %llu", &value) == 1) {
+                // Dirty pages truncated before writeback never reach a disk
+                total -= static_cast<long long>(value);
+            }
+        }
+        fclose(file);
+        if (found != 2) return -1;
+
+        long long result = ownIoTotal_ >= 0 ? std::max(0LL, total - ownIoTotal_) : -1;
+        ownIoTotal_ = total;
+        return result;
+#endif
+    }
+
+    // Average time per completed request on the busiest whole disk since the
+    // previous sample. Partitions are skipped (they double-count their disk),
+    // as are loop and RAM devices, which are never the bottleneck.
+    // diskBytes receives the bytes moved by disks that sit directly on
+    // hardware; device-mapper and md volumes are left out of it because
+    // their I/O shows up again on the disks beneath them.
+    long long SampleLatency(long long& diskBytes) {
+        diskBytes = -1;
+#ifdef _WIN32
+        return -1;
+#else
+        FILE* file = fopen("/proc/diskstats", "r");
+        if (file == NULL) return -1;
+        char line[512];
+        long long worst = -1;
+        std::unordered_map<std::string, DiskCounters> current;
+        while (fgets(line, sizeof(line), file)) {
+            char name[64];
+            unsigned long long reads, readSectors, readMs, writes, writeSectors, writeMs;
+            if (sscanf(line, "%*u %*u %63s %llu %*u %llu %llu %llu %*u %llu %llu", name, &reads, &readSectors, &readMs,
+                       &writes, &writeSectors, &writeMs) != 7) continue;
+            if (strncmp(name, "loop", 4) == 0 || strncmp(name, "ram", 3) == 0 || strncmp(name, "zram", 4) == 0) continue;
+            std::string device(name);
+            if (access(("/sys/block/" + device).c_str(), F_OK) != 0) continue;
+
+            DiskCounters counters;
+            counters.requests = reads + writes;
+            counters.busyMs = readMs + writeMs;
+            counters.sectors = readSectors + writeSectors;
+            auto previous = disks_.find(device);
+            if (previous != disks_.end() && counters.requests > previous->second.requests && counters.busyMs >= previous->second.busyMs) {
+                long long latency = static_cast<long long>((counters.busyMs - previous->second.busyMs) * 1000 /
+                                                           (counters.requests - previous->second.requests));
+                worst = std::max(worst, latency);
+            }
+            if (previous != disks_.end() && counters.sectors >= previous->second.sectors && !IsStackedDevice(device)) {
+                diskBytes = std::max(diskBytes, 0LL) + static_cast<long long>((counters.sectors - previous->second.sectors) * 512);
+            }
+            current.emplace(std::move(device), counters);
+        }
+        fclose(file);
+        // A disk with no completed requests this interval counts as idle
+        if (worst < 0 && !disks_.empty()) worst = 0;
+        disks_.swap(current);
+        return worst;
+#endif
+    }
+
+#ifndef _WIN32
+    // Device-mapper and md volumes list the devices they are built on
+    static bool IsStackedDevice(const std::string& device) {
+        DIR* slaves = opendir(("/sys/block/" + device + "/slaves").c_str());
+        if (slaves == NULL) return false;
+        bool stacked = false;
+        while (struct dirent* entry = readdir(slaves)) {
+            if (entry->d_name[0] != '.') {
+                stacked = true;
+                break;
+            }
+        }
+        closedir(slaves);
+        return stacked;
+    }
+#endif
+
+    superpanel::TokenBucket bucket_;
+    std::atomic<long long> maxRate_{0};
+    long long minRate_ = 1;
+    long long pressureThreshold_ = 0;  // 1/100 %
+    long long latencyThresholdUs_ = 0;
+
+    std::mutex sampleLock_;
+    std::atomic<steady_clock::time_point> lastSample_{steady_clock::now()};
+    long long pressure_ = -1;
+    long long latencyUs_ = -1;
+    long long backoffs_ = 0;
+    unsigned long long pressureTotal_ = 0;
+    std::unordered_map<std::string, DiskCounters> disks_;
+    long long ownIoTotal_ = -1;
+    double diskRate_ = -1; // Smoothed bytes/s, -1 until the first sample
+    double ownRate_ = 0;
+
+    std::atomic<long long> bytesGranted_{0};
+    std::atomic<long long> waitedNs_{0};
+};
+
+AdaptiveThrottle& SharedThrottle() {
+    static AdaptiveThrottle throttle;
+    return throttle;
+}
+
+} // namespace
+
+namespace superpanel {
+
+void ThrottleBackupIo(uint64_t bytes, const std::atomic<bool>& cancelled) {
+    SharedThrottle().Throttle(bytes, cancelled);
+}
+
+} // namespace superpanel
+
+extern "C" {
+
+SUPERPANEL_API void ConfigureBackupThrottle(long long maxBytesPerSecond, long long minBytesPerSecond, int pressurePercent, int latencyMs) {
+    SharedThrottle().Configure(maxBytesPerSecond, minBytesPerSecond, pressurePercent, latencyMs);
+}
+
+SUPERPANEL_API void GetBackupThrottleState(BackupThrottleState* state) {
+    if (state == NULL) return;
+    SharedThrottle().GetState(*state);
+}
+
+} // extern "C"
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+struct BackupThrottleState {
+    long long maxBytesPerSecond; // Configured ceiling, 0 if backup I/O is not throttled
+    long long minBytesPerSecond; // Floor the rate never backs off below
+    long long bytesPerSecond;    // Current rate
+    long long ioPressure;        // Share of the last sample in which some task stalled on I/O, in 1/100 % (-1 if unavailable)
+    long long diskLatencyUs;     // Worst disk's average time per request in the last sample (-1 if unavailable)
+    long long backoffs;          // Times the rate was cut
+    long long bytesGranted;      // Backup I/O let through since startup
+    long long throttledMs;       // Time backup I/O has spent waiting, summed over threads
+};
+
+extern "C" {
+    // Sets the shared limit for backup, restore and verification I/O. The
+    // rate starts at maxBytesPerSecond and adapts every half second: when
+    // I/O pressure (/proc/pressure/io) reaches pressurePercent or the
+    // busiest disk's latency (/proc/diskstats) reaches latencyMs, the rate is
+    // halved down to minBytesPerSecond; otherwise it climbs back by a
+    // sixteenth of the ceiling per sample. Both signals include the backup's
+    // own I/O, so they are ignored while other processes move less than
+    // half a megabyte a second (diskstats throughput less /proc/self/io).
+    // A threshold <= 0 ignores that signal, and where neither is available
+    // the rate stays at the ceiling.
+    // maxBytesPerSecond <= 0 turns throttling off.
+    SUPERPANEL_API void ConfigureBackupThrottle(long long maxBytesPerSecond, long long minBytesPerSecond, int pressurePercent, int latencyMs);
+    SUPERPANEL_API void GetBackupThrottleState(BackupThrottleState* state);
+}
+
+namespace superpanel {
+
+// Token bucket on a virtual clock: each request reserves its share of time
+// and sleeps until its slot comes up, so concurrent callers are spaced out
+// without a refill thread. An idle bucket banks at most a quarter second.
+class TokenBucket {
+public:
+    explicit TokenBucket(long long bytesPerSecond = 0) : bytesPerSecond_(bytesPerSecond) {}
+
+    void SetRate(long long bytesPerSecond) { bytesPerSecond_ = bytesPerSecond; }
+    long long Rate() const { return bytesPerSecond_; }
+
+    // Returns the time spent waiting. Gives up early once cancelled is set.
+    std::chrono::nanoseconds Acquire(uint64_t bytes, const std::atomic<bool>& cancelled);
+
+private:
+    std::atomic<long long> bytesPerSecond_;
+    std::mutex lock_;
+    std::chrono::steady_clock::time_point next_ = std::chrono::steady_clock::now();
+};
+
+// Blocks until backup I/O of this many bytes may proceed under the limit
+// set by ConfigureBackupThrottle. Free when throttling is off.
+void ThrottleBackupIo(uint64_t bytes, const std::atomic<bool>& cancelled);
+
+} // namespace superpanel
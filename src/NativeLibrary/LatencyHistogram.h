@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace superpanel {
+
+// HDR-style histogram of microsecond latencies (after HdrHistogram, two
+// significant digits). Values under 128 us get a counter each; above that
+// every power of two is split into 64 equal buckets, so a reported value is
+// within 1/64 of what was recorded. Values are clamped to MaxValue (about
+// 134 s). Recording is a few shifts and an increment, and the counters take
+// under 6 KB, so a histogram per target per window is cheap enough to keep
+// running permanently.
+class LatencyHistogram {
+public:
+    static const uint64_t MaxValue = (1ULL << 27) - 1;
+
+    void Record(uint64_t value) {
+        if (value > MaxValue) value = MaxValue;
+        counts_[BucketFor(value)]++;
+        count_++;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // Corrects for coordinated omission: a probe that overran the interval
+    // it is sent at hid the probes that would have gone out meanwhile, which
+    // would have waited progressively less. Records those too, as
+    // HdrHistogram's recordValueWithExpectedInterval does.
+    void RecordCorrected(uint64_t value, uint64_t expectedInterval) {
+        Record(value);
+        if (expectedInterval == 0) return;
+        for (uint64_t missed = value; missed > expectedInterval;) {
+            missed -= expectedInterval;
+            Record(missed);
+        }
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BucketCount; i++) counts_[i] += other.counts_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void Reset() { *this = LatencyHistogram(); }
+
+    uint64_t Count() const { return count_; }
+    uint64_t Min() const { return count_ == 0 ? 0 : min_; }
+    uint64_t Max() const { return max_; }
+    uint64_t Mean() const { return count_ == 0 ? 0 : sum_ / count_; }
+
+    // The smallest recorded value that percentile (0-100) of the samples do
+    // not exceed, reported as the top of its bucket like HdrHistogram does
+    uint64_t ValueAtPercentile(double percentile) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+        rank = std::max<uint64_t>(1, std::min(rank, count_));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BucketCount; i++) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(HighestInBucket(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    static const int LinearBits = 7; // Values below 128 are exact
+    static const uint64_t HalfBuckets = 1ULL << (LinearBits - 1);
+    static const int TopBit = 26;    // Of MaxValue
+    static const size_t BucketCount = (1 << LinearBits) + (TopBit - LinearBits + 1) * HalfBuckets;
+
+    static size_t BucketFor(uint64_t value) {
+        if (value < (1ULL << LinearBits)) return static_cast<size_t>(value);
+        int msb = TopBit;
+        while ((value >> msb) == 0) msb--;
+        const int shift = msb - (LinearBits - 1);
+        return static_cast<size_t>((1ULL << LinearBits) + static_cast<uint64_t>(msb - LinearBits) * HalfBuckets + ((value >> shift) - HalfBuckets));
+    }
+
+    static uint64_t HighestInBucket(size_t bucket) {
+        if (bucket < (1ULL << LinearBits)) return bucket;
+        const uint64_t offset = bucket - (1ULL << LinearBits);
+        const int shift = static_cast<int>(offset / HalfBuckets) + 1;
+        const uint64_t top = HalfBuckets + offset % HalfBuckets;
+        return ((top + 1) << shift) - 1;
+    }
+
+    // 32-bit counters: a target probed every 10 ms takes over a year to
+    // overflow one
+    std::array<uint32_t, BucketCount> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+};
+
+} // namespace superpanel
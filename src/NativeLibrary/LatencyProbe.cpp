@@ -0,0 +1,564 @@
+#include "pch.h"
+#include "LatencyProbe.h"
+#include "DnsResolver.h"
+#include "EventLoop.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+using superpanel::AsyncResolver;
+using superpanel::EventLoop;
+using superpanel::InvalidSocket;
+using superpanel::LatencyHistogram;
+using superpanel::SocketAddress;
+using superpanel::SocketHandle;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int DefaultWindowMs = 60000;
+const int DefaultWindowsKept = 60;
+const int MaxWindowsKept = 1440;
+const int DefaultIntervalMs = 1000;
+const int MinIntervalMs = 10;
+const int DefaultTimeoutMs = 3000;
+const int MaxTimeoutMs = 60000;
+const int MaxPayloadBytes = 4096;
+const size_t MaxTargets = 4096;
+// Longest the loop sleeps, so new targets, removals, window ends and
+// shutdown are noticed within it
+const int TickMs = 100;
+
+long long UnixMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+long long MicrosecondsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+// What queries read; guarded by the prober's lock. Held by the probing side
+// too, so a target removed mid-probe can still be recorded into.
+struct TargetStats {
+    struct Window {
+        long long startMs = 0;
+        long long probes = 0;
+        long long failures = 0;
+        long long timeouts = 0;
+        long long lastError = 0;
+        LatencyHistogram connect;
+        LatencyHistogram exchange;
+    };
+
+    Window current;
+    Window totals;
+    std::deque<LatencyWindow> closed; // Newest first
+};
+
+void Summarise(const LatencyHistogram& histogram, LatencySummary& summary) {
+    summary.count = static_cast<long long>(histogram.Count());
+    if (summary.count == 0) {
+        summary.minUs = summary.maxUs = summary.meanUs = -1;
+        summary.p50Us = summary.p90Us = summary.p99Us = summary.p999Us = -1;
+        return;
+    }
+    summary.minUs = static_cast<long long>(histogram.Min());
+    summary.maxUs = static_cast<long long>(histogram.Max());
+    summary.meanUs = static_cast<long long>(histogram.Mean());
+    summary.p50Us = static_cast<long long>(histogram.ValueAtPercentile(50));
+    summary.p90Us = static_cast<long long>(histogram.ValueAtPercentile(90));
+    summary.p99Us = static_cast<long long>(histogram.ValueAtPercentile(99));
+    summary.p999Us = static_cast<long long>(histogram.ValueAtPercentile(99.9));
+}
+
+void Summarise(const TargetStats::Window& window, long long durationMs, LatencyWindow& out) {
+    out.startMs = window.startMs;
+    out.durationMs = durationMs;
+    out.probes = window.probes;
+    out.failures = window.failures;
+    out.timeouts = window.timeouts;
+    out.lastError = window.lastError;
+    Summarise(window.connect, out.connect);
+    Summarise(window.exchange, out.exchange);
+}
+
+enum class Phase { Idle, Resolving, Connecting, Sending, Receiving };
+
+struct Target {
+    int id = 0;
+    std::string host;
+    int port = 0;
+    long long intervalUs = 0;
+    int timeoutMs = 0;
+    std::string request;
+    std::string expect;
+    std::shared_ptr<TargetStats> stats;
+    Clock::time_point due;
+
+    // The probe in flight, if any
+    Phase phase = Phase::Idle;
+    uint64_t generation = 0; // Tells a stale expiry or lookup from the current probe
+    Clock::time_point deadline;
+    Clock::time_point phaseStarted;
+    long long connectUs = 0;
+    std::vector<SocketAddress> addresses;
+    size_t nextAddress = 0;
+    int lastError = 0;
+    SocketHandle socket = InvalidSocket;
+    uint32_t interest = 0;
+    size_t sent = 0;
+    std::string received;
+};
+
+struct Scheduled {
+    Clock::time_point when;
+    int target;
+    uint64_t generation; // Expiries only
+    bool operator>(const Scheduled& other) const { return when > other.when; }
+};
+
+using ScheduleQueue = std::priority_queue<Scheduled, std::vector<Scheduled>, std::greater<Scheduled>>;
+
+class LatencyProber {
+public:
+    LatencyProber(int windowMs, size_t windowsKept) : windowMs_(windowMs), windowsKept_(windowsKept), resolver_(loop_) {}
+
+    ~LatencyProber() {
+        stopping_ = true;
+        if (thread_.joinable()) thread_.join();
+        for (auto& entry : targets_) Close(entry.second);
+    }
+
+    bool Start() {
+        if (!loop_.IsValid()) return false;
+        windowStartMs_ = UnixMs() / windowMs_ * windowMs_;
+        thread_ = std::thread(&LatencyProber::Run, this);
+        return true;
+    }
+
+    int Add(const char* host, int port, int intervalMs, int timeoutMs, const char* request, int requestLength,
+            const char* expect, int expectLength) {
+        Target target;
+        target.host = host;
+        target.port = port;
+        target.intervalUs = static_cast<long long>(intervalMs > 0 ? std::max(intervalMs, MinIntervalMs) : DefaultIntervalMs) * 1000;
+        target.timeoutMs = timeoutMs > 0 ? std::min(timeoutMs, MaxTimeoutMs) : DefaultTimeoutMs;
+        if (request != NULL && requestLength > 0) target.request.assign(request, static_cast<size_t>(requestLength));
+        if (expect != NULL && expectLength > 0) target.expect.assign(expect, static_cast<size_t>(expectLength));
+        target.stats = std::make_shared<TargetStats>();
+
+        std::lock_guard<std::mutex> guard(lock_);
+        if (stats_.size() >= MaxTargets) return -1;
+        target.id = nextId_++;
+        target.stats->current.startMs = windowStartMs_;
+        target.stats->totals.startMs = UnixMs();
+        stats_[target.id] = target.stats;
+        const int id = target.id;
+        added_.push_back(std::move(target));
+        return id;
+    }
+
+    bool Remove(int id) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (stats_.erase(id) == 0) return false;
+        removed_.push_back(id);
+        return true;
+    }
+
+    int Windows(int id, LatencyWindow* windows, int maxCount) {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto it = stats_.find(id);
+        if (it == stats_.end()) return -1;
+        const TargetStats& stats = *it->second;
+        if (maxCount <= 0) return 0;
+        Summarise(stats.current, std::max(0LL, UnixMs() - stats.current.startMs), windows[0]);
+        int copied = 1;
+        for (const LatencyWindow& window : stats.closed) {
+            if (copied == maxCount) break;
+            windows[copied++] = window;
+        }
+        return copied;
+    }
+
+    bool Totals(int id, LatencyWindow& totals) {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto it = stats_.find(id);
+        if (it == stats_.end()) return false;
+        Summarise(it->second->totals, std::max(0LL, UnixMs() - it->second->totals.startMs), totals);
+        return true;
+    }
+
+private:
+    void Run() {
+        std::vector<EventLoop::Event> events;
+        while (!stopping_) {
+            TakeChanges();
+            CloseWindow();
+            StartDue();
+
+            int waitMs = resolver_.Tick();
+            waitMs = waitMs < 0 ? TickMs : std::min(waitMs, TickMs);
+            const auto now = Clock::now();
+            for (const ScheduleQueue* queue : {&due_, &expiries_}) {
+                if (queue->empty()) continue;
+                // Round up, or the loop spins through the last millisecond
+                const int untilMs = queue->top().when > now
+                    ? static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(queue->top().when - now).count()) + 1
+                    : 0;
+                waitMs = std::min(waitMs, untilMs);
+            }
+            if (!loop_.Wait(waitMs, events)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(TickMs));
+                continue;
+            }
+            for (const EventLoop::Event& event : events) {
+                if (AsyncResolver::OwnsToken(event.token)) {
+                    resolver_.OnEvent(event);
+                    continue;
+                }
+                auto it = targets_.find(static_cast<int>(event.token));
+                if (it != targets_.end()) OnEvent(it->second);
+            }
+            ExpireOverdue();
+        }
+    }
+
+    // Applies Add and Remove calls made since the last pass
+    void TakeChanges() {
+        std::vector<Target> added;
+        std::vector<int> removed;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            added.swap(added_);
+            removed.swap(removed_);
+        }
+        const auto now = Clock::now();
+        for (Target& target : added) {
+            // Spread the first probes over an interval so targets added
+            // together don't stay in lockstep
+            const long long offsetUs = static_cast<long long>((static_cast<uint64_t>(target.id) * 2654435761u) % static_cast<uint64_t>(target.intervalUs));
+            target.due = now + std::chrono::microseconds(offsetUs);
+            due_.push(Scheduled{target.due, target.id, 0});
+            const int id = target.id;
+            targets_.emplace(id, std::move(target));
+        }
+        for (int id : removed) {
+            auto it = targets_.find(id);
+            if (it == targets_.end()) continue;
+            Close(it->second);
+            targets_.erase(it);
+        }
+    }
+
+    // Windows end together for every target, on wall-clock multiples of the
+    // window length
+    void CloseWindow() {
+        const long long nowMs = UnixMs();
+        std::lock_guard<std::mutex> guard(lock_);
+        if (nowMs < windowStartMs_ + windowMs_) return;
+        const long long nextStartMs = nowMs / windowMs_ * windowMs_;
+        for (auto& entry : stats_) {
+            TargetStats& stats = *entry.second;
+            LatencyWindow window;
+            Summarise(stats.current, std::max(0LL, windowStartMs_ + windowMs_ - stats.current.startMs), window);
+            stats.closed.push_front(window);
+            if (stats.closed.size() > windowsKept_) stats.closed.pop_back();
+            stats.current = TargetStats::Window();
+            stats.current.startMs = nextStartMs;
+        }
+        windowStartMs_ = nextStartMs;
+    }
+
+    // Probes run at a fixed rate; one still in flight when the next is due
+    // makes that one skip, and the histograms make up for it
+    void StartDue() {
+        const auto now = Clock::now();
+        while (!due_.empty() && due_.top().when <= now) {
+            const Scheduled scheduled = due_.top();
+            due_.pop();
+            auto it = targets_.find(scheduled.target);
+            if (it == targets_.end()) continue;
+            Target& target = it->second;
+            if (target.phase == Phase::Idle) StartProbe(target);
+            target.due += std::chrono::microseconds(target.intervalUs);
+            if (target.due <= now) target.due = now + std::chrono::microseconds(target.intervalUs); // Fell behind (suspend)
+            due_.push(Scheduled{target.due, target.id, 0});
+        }
+    }
+
+    void StartProbe(Target& target) {
+        target.generation++;
+        target.phase = Phase::Resolving;
+        target.deadline = Clock::now() + std::chrono::milliseconds(target.timeoutMs);
+        target.nextAddress = 0;
+        target.lastError = 0;
+        target.sent = 0;
+        target.received.clear();
+        expiries_.push(Scheduled{target.deadline, target.id, target.generation});
+        const int id = target.id;
+        const uint64_t generation = target.generation;
+        resolver_.Resolve(target.host, target.port, target.deadline,
+                          [this, id, generation](int error, const std::vector<SocketAddress>& addresses) { OnResolved(id, generation, error, addresses); });
+    }
+
+    void OnResolved(int id, uint64_t generation, int error, const std::vector<SocketAddress>& addresses) {
+        auto it = targets_.find(id);
+        if (it == targets_.end()) return;
+        Target& target = it->second;
+        if (target.generation != generation || target.phase != Phase::Resolving) return;
+        if (error != 0) {
+            Fail(target, error);
+            return;
+        }
+        target.addresses = addresses;
+        ConnectNext(target);
+    }
+
+    // Tries the addresses in turn until one accepts the connection
+    void ConnectNext(Target& target) {
+        while (target.nextAddress < target.addresses.size() && Clock::now() < target.deadline) {
+            const SocketAddress& address = target.addresses[target.nextAddress++];
+            SocketHandle socket = superpanel::OpenNonBlockingSocket(address.Family(), SOCK_STREAM, IPPROTO_TCP);
+            if (socket == InvalidSocket) {
+                target.lastError = address.Family() == AF_INET6 ? EAFNOSUPPORT : EMFILE;
+                continue;
+            }
+            if (!target.request.empty()) {
+                // The request goes out in one write; don't let Nagle hold it back
+                int noDelay = 1;
+                setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+            }
+            target.phaseStarted = Clock::now();
+            int error = superpanel::StartConnect(socket, address.Get(), address.length);
+            if (error != 0 && error != EINPROGRESS) {
+                superpanel::AbortSocket(socket);
+                target.lastError = error;
+                continue;
+            }
+            target.socket = socket;
+            target.phase = Phase::Connecting;
+            if (!loop_.Add(socket, EventLoop::Writable, static_cast<uint64_t>(target.id))) {
+                Fail(target, errno != 0 ? errno : EMFILE);
+                return;
+            }
+            target.interest = EventLoop::Writable;
+            return;
+        }
+        Fail(target, Clock::now() >= target.deadline ? ETIMEDOUT : (target.lastError != 0 ? target.lastError : EHOSTUNREACH));
+    }
+
+    void SetInterest(Target& target, uint32_t interest) {
+        if (target.interest == interest) return;
+        loop_.Modify(target.socket, interest, static_cast<uint64_t>(target.id));
+        target.interest = interest;
+    }
+
+    void OnEvent(Target& target) {
+        switch (target.phase) {
+        case Phase::Connecting: {
+            int error = superpanel::PendingSocketError(target.socket);
+            if (error != 0) {
+                loop_.Remove(target.socket);
+                superpanel::AbortSocket(target.socket);
+                target.socket = InvalidSocket;
+                target.lastError = error;
+                ConnectNext(target);
+                return;
+            }
+            target.connectUs = MicrosecondsSince(target.phaseStarted);
+            if (target.request.empty() && target.expect.empty()) {
+                Complete(target);
+                return;
+            }
+            target.phaseStarted = Clock::now();
+            target.phase = target.request.empty() ? Phase::Receiving : Phase::Sending;
+            if (target.phase == Phase::Sending) Send(target);
+            else SetInterest(target, EventLoop::Readable);
+            return;
+        }
+        case Phase::Sending: Send(target); return;
+        case Phase::Receiving: Receive(target); return;
+        default: return;
+        }
+    }
+
+    void Send(Target& target) {
+        while (target.sent < target.request.size()) {
+            int sent = superpanel::SendSome(target.socket, target.request.data() + target.sent, target.request.size() - target.sent);
+            if (sent == -EAGAIN) {
+                SetInterest(target, EventLoop::Writable);
+                return;
+            }
+            if (sent <= 0) {
+                Fail(target, sent < 0 ? -sent : EPIPE);
+                return;
+            }
+            target.sent += static_cast<size_t>(sent);
+        }
+        target.phase = Phase::Receiving;
+        SetInterest(target, EventLoop::Readable);
+    }
+
+    // Reads the expected response, or any first byte when none is given
+    void Receive(Target& target) {
+        const size_t wanted = target.expect.empty() ? 1 : target.expect.size();
+        char buffer[MaxPayloadBytes];
+        while (target.received.size() < wanted) {
+            int received = superpanel::ReceiveSome(target.socket, buffer, wanted - target.received.size());
+            if (received == -EAGAIN) return;
+            if (received <= 0) {
+                Fail(target, received < 0 ? -received : ECONNRESET);
+                return;
+            }
+            target.received.append(buffer, static_cast<size_t>(received));
+        }
+        if (!target.expect.empty() && target.received != target.expect) Fail(target, EPROTO);
+        else Complete(target);
+    }
+
+    void Close(Target& target) {
+        if (target.socket != InvalidSocket) {
+            loop_.Remove(target.socket);
+            superpanel::AbortSocket(target.socket);
+            target.socket = InvalidSocket;
+        }
+        target.interest = 0;
+        target.phase = Phase::Idle;
+    }
+
+    void Complete(Target& target) {
+        const long long exchangeUs = target.phase == Phase::Receiving ? MicrosecondsSince(target.phaseStarted) : -1;
+        Close(target);
+        const uint64_t interval = static_cast<uint64_t>(target.intervalUs);
+        std::lock_guard<std::mutex> guard(lock_);
+        for (TargetStats::Window* window : {&target.stats->current, &target.stats->totals}) {
+            window->probes++;
+            window->connect.RecordCorrected(static_cast<uint64_t>(target.connectUs), interval);
+            if (exchangeUs >= 0) window->exchange.RecordCorrected(static_cast<uint64_t>(exchangeUs), interval);
+        }
+    }
+
+    // A timed-out probe took at least the whole timeout, so it goes into the
+    // histogram of the phase it was stuck in as exactly that; leaving it out
+    // would make the percentiles look best when the backend is worst. Fast
+    // failures (refused, reset, bad response) say nothing about latency.
+    void Fail(Target& target, int error) {
+        const Phase phase = target.phase;
+        Close(target);
+        const uint64_t interval = static_cast<uint64_t>(target.intervalUs);
+        const long long timeoutUs = static_cast<long long>(target.timeoutMs) * 1000;
+        const bool connected = phase == Phase::Sending || phase == Phase::Receiving;
+        std::lock_guard<std::mutex> guard(lock_);
+        for (TargetStats::Window* window : {&target.stats->current, &target.stats->totals}) {
+            window->probes++;
+            window->failures++;
+            window->lastError = error;
+            if (error != ETIMEDOUT) continue;
+            window->timeouts++;
+            if (connected) {
+                window->connect.RecordCorrected(static_cast<uint64_t>(target.connectUs), interval);
+                window->exchange.RecordCorrected(static_cast<uint64_t>(std::max(0LL, timeoutUs - target.connectUs)), interval);
+            } else {
+                window->connect.RecordCorrected(static_cast<uint64_t>(timeoutUs), interval);
+            }
+        }
+    }
+
+    // Entries for probes that already finished are skipped as they surface
+    void ExpireOverdue() {
+        const auto now = Clock::now();
+        while (!expiries_.empty() && expiries_.top().when <= now) {
+            const Scheduled expiry = expiries_.top();
+            expiries_.pop();
+            auto it = targets_.find(expiry.target);
+            if (it == targets_.end()) continue;
+            Target& target = it->second;
+            if (target.generation == expiry.generation && target.phase != Phase::Idle) Fail(target, ETIMEDOUT);
+        }
+    }
+
+    const long long windowMs_;
+    const size_t windowsKept_;
+
+    // Shared with API calls
+    std::mutex lock_;
+    std::unordered_map<int, std::shared_ptr<TargetStats>> stats_;
+    std::vector<Target> added_;
+    std::vector<int> removed_;
+    long long windowStartMs_ = 0;
+    int nextId_ = 1;
+
+    // The probing thread's own
+    EventLoop loop_;
+    AsyncResolver resolver_;
+    std::unordered_map<int, Target> targets_;
+    ScheduleQueue due_;
+    ScheduleQueue expiries_;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+};
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* CreateLatencyProber(int windowMs, int windowsKept) {
+    if (!superpanel::InitializeSockets()) return NULL;
+    auto* prober = new LatencyProber(windowMs > 0 ? windowMs : DefaultWindowMs,
+                                     static_cast<size_t>(windowsKept > 0 ? std::min(windowsKept, MaxWindowsKept) : DefaultWindowsKept));
+    if (!prober->Start()) {
+        delete prober;
+        return NULL;
+    }
+    return prober;
+}
+
+SUPERPANEL_API void DestroyLatencyProber(void* prober) {
+    delete static_cast<LatencyProber*>(prober);
+}
+
+SUPERPANEL_API int AddLatencyTarget(void* prober, const char* host, int port, int intervalMs, int timeoutMs,
+                                    const char* request, int requestLength, const char* expect, int expectLength) {
+    if (prober == NULL || host == NULL || host[0] == '\0' || port <= 0 || port > 65535) return -1;
+    if (requestLength > MaxPayloadBytes || expectLength > MaxPayloadBytes) return -1;
+    return static_cast<LatencyProber*>(prober)->Add(host, port, intervalMs, timeoutMs, request, requestLength, expect, expectLength);
+}
+
+SUPERPANEL_API int RemoveLatencyTarget(void* prober, int targetId) {
+    if (prober == NULL) return 0;
+    return static_cast<LatencyProber*>(prober)->Remove(targetId) ? 1 : 0;
+}
+
+SUPERPANEL_API int GetLatencyWindows(void* prober, int targetId, LatencyWindow* windows, int maxCount) {
+    if (prober == NULL) return -1;
+    if (windows == NULL) maxCount = 0;
+    return static_cast<LatencyProber*>(prober)->Windows(targetId, windows, maxCount);
+}
+
+SUPERPANEL_API int GetLatencyTotals(void* prober, int targetId, LatencyWindow* totals) {
+    if (prober == NULL || totals == NULL) return 0;
+    return static_cast<LatencyProber*>(prober)->Totals(targetId, *totals) ? 1 : 0;
+}
+
+} // extern "C"
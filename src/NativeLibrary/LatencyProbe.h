@@ -0,0 +1,62 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Latency distribution of one kind of measurement over a window. Values are
+// -1 when count is 0.
+struct LatencySummary {
+    long long count; // Samples, including those added for coordinated omission
+    long long minUs;
+    long long maxUs;
+    long long meanUs;
+    long long p50Us;
+    long long p90Us;
+    long long p99Us;
+    long long p999Us;
+};
+
+struct LatencyWindow {
+    long long startMs;    // Unix time the window opened
+    long long durationMs; // So far, for the window still open
+    long long probes;     // Finished in the window, failures included
+    long long failures;   // Unresolved, refused, unreachable, timed out or a bad response
+    long long timeouts;
+    long long lastError;  // errno-style code of the latest failure, 0 if none
+    // Timed-out probes count as taking the full timeout in the phase they
+    // were in; other failures are left out of the distributions
+    LatencySummary connect;  // Connect call to the SYN-ACK
+    LatencySummary exchange; // Request sent to the expected response; empty without one
+};
+
+extern "C" {
+    // Continuous TCP latency probing of backends (databases, caches) on one
+    // background thread and event loop, as in CheckPorts. Each target is
+    // connected to every intervalMs at a fixed rate and the connection is
+    // reset right after, leaving no TIME_WAIT behind. Samples go into
+    // HDR-style histograms that are summarised and restarted every windowMs
+    // (aligned to wall-clock multiples, so 60000 gives per-minute windows);
+    // the last windowsKept summaries are kept per target. <= 0 keeps the
+    // defaults (60 s, 60). Returns NULL if the event loop cannot be created.
+    SUPERPANEL_API void* CreateLatencyProber(int windowMs, int windowsKept);
+    SUPERPANEL_API void DestroyLatencyProber(void* prober);
+
+    // Starts probing host:port. host is a literal or a name looked up
+    // through the DnsResolver cache. intervalMs <= 0 means 1 s (10 ms at
+    // least); timeoutMs <= 0 means 3 s, and a probe still running when the
+    // next is due makes that one skip. With a request, it is sent once
+    // connected; with an expected response, the probe waits for that many
+    // bytes and fails unless they match (PING\r\n and +PONG for Redis). An
+    // expected response without a request suits servers that speak first,
+    // such as MySQL's greeting. Returns a target id, or -1.
+    SUPERPANEL_API int AddLatencyTarget(void* prober, const char* host, int port, int intervalMs, int timeoutMs,
+                                        const char* request, int requestLength, const char* expect, int expectLength);
+    SUPERPANEL_API int RemoveLatencyTarget(void* prober, int targetId);
+
+    // Copies up to maxCount windows of the target, newest first; the first
+    // is the window still open. Returns the number copied, or -1 for an
+    // unknown target.
+    SUPERPANEL_API int GetLatencyWindows(void* prober, int targetId, LatencyWindow* windows, int maxCount);
+    // Everything since the target was added, as one window. Returns 1, or 0
+    // for an unknown target.
+    SUPERPANEL_API int GetLatencyTotals(void* prober, int targetId, LatencyWindow* totals);
+}
@@ -0,0 +1,288 @@
+#include "pch.h"
+#include "ListeningPorts.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using superpanel::InetSocketEntry;
+
+namespace {
+
+const unsigned char MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+
+struct Listener {
+    InetSocketEntry entry;
+    int protocol;
+};
+
+// False if neither socket table could be read
+bool CollectListeners(std::vector<Listener>& listeners) {
+    int tcp = superpanel::ForEachInetSocket(SOCKET_PROTOCOL_TCP, 1u << TCP_STATE_LISTEN,
+                                            [&](const InetSocketEntry& entry) { listeners.push_back(Listener{entry, SOCKET_PROTOCOL_TCP}); });
+    int udp = superpanel::ForEachInetSocket(SOCKET_PROTOCOL_UDP, 1u << TCP_STATE_CLOSE, [&](const InetSocketEntry& entry) {
+        if (entry.localPort != 0) listeners.push_back(Listener{entry, SOCKET_PROTOCOL_UDP});
+    });
+    return tcp != 0 || udp != 0;
+}
+
+void FormatAddress(const unsigned char* address, char* text, size_t size) {
+    if (memcmp(address, MappedPrefix, sizeof(MappedPrefix)) == 0) inet_ntop(AF_INET, address + 12, text, static_cast<socklen_t>(size));
+    else inet_ntop(AF_INET6, address, text, static_cast<socklen_t>(size));
+}
+
+struct Owner {
+    int pid = -1;
+    int processes = 0;
+    int lastPid = -1; // Counts each process once however many descriptors it holds
+    std::string name;
+};
+
+#ifdef _WIN32
+
+std::string ProcessName(DWORD pid) {
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (process == NULL) return pid == 4 ? "System" : std::string();
+    char path[MAX_PATH];
+    DWORD length = MAX_PATH;
+    std::string name;
+    if (QueryFullProcessImageNameA(process, 0, path, &length)) {
+        name.assign(path, length);
+        size_t slash = name.find_last_of("\\/");
+        if (slash != std::string::npos) name.erase(0, slash + 1);
+    }
+    CloseHandle(process);
+    return name;
+}
+
+// The IP Helper tables name each socket's owner directly
+void ResolveOwners(const std::vector<Listener>& listeners, std::vector<Owner>& owners) {
+    std::unordered_map<DWORD, std::string> names;
+    for (const Listener& listener : listeners) {
+        Owner owner;
+        owner.pid = static_cast<int>(listener.entry.ownerPid);
+        owner.processes = 1;
+        auto found = names.find(listener.entry.ownerPid);
+        if (found == names.end()) found = names.emplace(listener.entry.ownerPid, ProcessName(listener.entry.ownerPid)).first;
+        owner.name = found->second;
+        owners.push_back(owner);
+    }
+}
+
+#else
+
+std::string ReadComm(int pid) {
+    char path[64], name[64] = "";
+    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+    int file = open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0) return std::string();
+    ssize_t length = read(file, name, sizeof(name) - 1);
+    close(file);
+    if (length <= 0) return std::string();
+    if (name[length - 1] == '\n') length--;
+    return std::string(name, static_cast<size_t>(length));
+}
+
+// Fork, exec and exit notifications from the kernel's proc connector. Subscribing
+// needs CAP_NET_ADMIN; without it Active() is false and callers poll instead.
+class ProcEvents {
+public:
+    ProcEvents() {
+        socket_ = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+        if (socket_ < 0) return;
+        sockaddr_nl address = {};
+        address.nl_family = AF_NETLINK;
+        address.nl_groups = CN_IDX_PROC;
+        if (bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || !Subscribe(PROC_CN_MCAST_LISTEN)) {
+            close(socket_);
+            socket_ = -1;
+        }
+    }
+
+    ~ProcEvents() {
+        if (socket_ < 0) return;
+        Subscribe(PROC_CN_MCAST_IGNORE);
+        close(socket_);
+    }
+
+    bool Active() const { return socket_ >= 0; }
+
+    // Calls changed(pid) for every process that forked, exec'd or exited
+    // since the last drain. Returns false if events were dropped (receive overflow).
+    template <typename Changed>
+    bool Drain(Changed changed) {
+        alignas(nlmsghdr) char buffer[8192];
+        while (true) {
+            ssize_t received = recv(socket_, buffer, sizeof(buffer), 0);
+            if (received < 0) return errno == EAGAIN || errno == EINTR;
+            int remaining = static_cast<int>(received);
+            for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer); NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+                if (header->nlmsg_len < NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_event))) continue;
+                const auto* message = static_cast<const cn_msg*>(NLMSG_DATA(header));
+                proc_event event;
+                memcpy(&event, message->data, sizeof(event));
+                if (event.what == proc_event::PROC_EVENT_FORK) {
+                    changed(event.event_data.fork.parent_tgid); // The child shares the parent's sockets
+                } else if (event.what == proc_event::PROC_EVENT_EXEC) {
+                    changed(event.event_data.exec.process_tgid);
+                } else if (event.what == proc_event::PROC_EVENT_EXIT && event.event_data.exit.process_pid == event.event_data.exit.process_tgid) {
+                    changed(event.event_data.exit.process_tgid); // The process, not just one of its threads
+                }
+            }
+        }
+    }
+
+private:
+    bool Subscribe(proc_cn_mcast_op operation) {
+        alignas(nlmsghdr) char buffer[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = {};
+        auto* header = reinterpret_cast<nlmsghdr*>(buffer);
+        header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+        header->nlmsg_type = NLMSG_DONE;
+        auto* message = static_cast<cn_msg*>(NLMSG_DATA(header));
+        message->id.idx = CN_IDX_PROC;
+        message->id.val = CN_VAL_PROC;
+        message->len = sizeof(proc_cn_mcast_op);
+        memcpy(message->data, &operation, sizeof(operation));
+        return send(socket_, buffer, header->nlmsg_len, 0) >= 0;
+    }
+
+    int socket_ = -1;
+};
+
+// Socket inode -> owning processes, from the last /proc walk
+class OwnerCache {
+public:
+    void Resolve(const std::vector<Listener>& listeners, std::vector<Owner>& owners) {
+        std::lock_guard<std::mutex> guard(lock_);
+        bool stale = !Validate();
+        for (const Listener& listener : listeners) stale |= owners_.count(listener.entry.inode) == 0;
+        if (stale) Rebuild(listeners);
+        for (const Listener& listener : listeners) owners.push_back(owners_[listener.entry.inode]);
+    }
+
+private:
+    // False if any process holding a cached socket may have forked, exec'd
+    // or exited
+    bool Validate() {
+        if (owners_.empty()) return true;
+        if (events_.Active()) {
+            bool changed = false;
+            bool complete = events_.Drain([&](int pid) { changed |= ownerPids_.count(pid) != 0; });
+            return complete && !changed;
+        }
+        for (const auto& owner : owners_) {
+            if (owner.second.pid > 0 && ReadComm(owner.second.pid) != owner.second.name) return false;
+        }
+        return true;
+    }
+
+    // One pass over every process's descriptors, looking only for the
+    // inodes wanted. Inodes nobody visible holds are cached as unowned.
+    void Rebuild(const std::vector<Listener>& listeners) {
+        owners_.clear();
+        ownerPids_.clear();
+        for (const Listener& listener : listeners) owners_[listener.entry.inode] = Owner();
+
+        DIR* proc = opendir("/proc");
+        if (proc == NULL) return;
+        while (const dirent* process = readdir(proc)) {
+            char* end = nullptr;
+            long pid = strtol(process->d_name, &end, 10);
+            if (pid <= 0 || *end != '\0') continue;
+            char path[64];
+            snprintf(path, sizeof(path), "/proc/%ld/fd", pid);
+            DIR* descriptors = opendir(path);
+            if (descriptors == NULL) continue; // Gone, or not ours to read
+            while (const dirent* descriptor = readdir(descriptors)) {
+                if (descriptor->d_name[0] == '.') continue;
+                char target[64];
+                ssize_t length = readlinkat(dirfd(descriptors), descriptor->d_name, target, sizeof(target) - 1);
+                if (length < 10 || memcmp(target, "socket:[", 8) != 0) continue;
+                target[length] = '\0';
+                auto found = owners_.find(strtoull(target + 8, nullptr, 10));
+                if (found == owners_.end() || found->second.lastPid == pid) continue;
+                Owner& owner = found->second;
+                owner.lastPid = static_cast<int>(pid);
+                owner.processes++;
+                ownerPids_.insert(static_cast<int>(pid));
+                if (owner.pid < 0 || pid < owner.pid) owner.pid = static_cast<int>(pid);
+            }
+            closedir(descriptors);
+        }
+        closedir(proc);
+
+        for (auto& entry : owners_) {
+            if (entry.second.pid > 0) entry.second.name = ReadComm(entry.second.pid);
+        }
+        // Events that arrived during the walk are already reflected in it
+        if (events_.Active()) events_.Drain([](int) {});
+    }
+
+    std::mutex lock_;
+    ProcEvents events_;
+    std::unordered_map<uint64_t, Owner> owners_;
+    std::unordered_set<int> ownerPids_;
+};
+
+void ResolveOwners(const std::vector<Listener>& listeners, std::vector<Owner>& owners) {
+    static OwnerCache cache;
+    cache.Resolve(listeners, owners);
+}
+
+#endif
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API int GetListeningSockets(ListeningSocket* sockets, int maxCount) {
+    std::vector<Listener> listeners;
+    if (!CollectListeners(listeners)) return -1;
+    std::sort(listeners.begin(), listeners.end(), [](const Listener& a, const Listener& b) {
+        if (a.protocol != b.protocol) return a.protocol < b.protocol;
+        if (a.entry.localPort != b.entry.localPort) return a.entry.localPort < b.entry.localPort;
+        return memcmp(a.entry.localAddress, b.entry.localAddress, 16) < 0;
+    });
+
+    std::vector<Owner> owners;
+    ResolveOwners(listeners, owners);
+    size_t count = sockets != NULL && maxCount > 0 ? std::min(listeners.size(), static_cast<size_t>(maxCount)) : 0;
+    for (size_t i = 0; i < count; i++) {
+        const InetSocketEntry& entry = listeners[i].entry;
+        ListeningSocket& socket = sockets[i];
+        memset(&socket, 0, sizeof(socket));
+        FormatAddress(entry.localAddress, socket.address, sizeof(socket.address));
+        socket.port = entry.localPort;
+        socket.protocol = listeners[i].protocol;
+        socket.pid = owners[i].pid;
+        socket.processes = owners[i].processes;
+        snprintf(socket.process, sizeof(socket.process), "%s", owners[i].name.c_str());
+        socket.uid = entry.uid;
+        if (listeners[i].protocol == SOCKET_PROTOCOL_TCP) {
+            socket.acceptQueue = entry.receiveQueue;
+            socket.backlog = entry.sendQueue;
+        }
+    }
+    return static_cast<int>(listeners.size());
+}
+
+} // extern "C"
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include "SocketDiag.h"
+
+struct ListeningSocket {
+    char address[48];      // Local address; 0.0.0.0 or :: for every interface
+    long long port;
+    long long protocol;    // SOCKET_PROTOCOL_*
+    long long pid;         // Lowest PID holding the socket, -1 if unknown (no access, kernel socket)
+    long long processes;   // Processes holding it; prefork workers share their parent's listener
+    char process[64];      // Command name of pid
+    long long uid;
+    long long acceptQueue; // TCP: connections waiting for accept()
+    long long backlog;     // TCP: the listen() backlog, 0 where unknown
+};
+
+extern "C" {
+    // Lists listening TCP sockets and bound, unconnected UDP sockets with
+    // their owning processes, ordered by protocol and port. Sockets come from
+    // sock_diag; owners from one pass over /proc/*/fd that maps socket inodes
+    // to PIDs. That pass is cached and only repeated when a listener appears
+    // that it has not seen, or an owner forks, execs or exits (watched
+    // through the proc connector where the process may subscribe, else by
+    // re-reading the owners' names), so repeated calls cost little more than the dump.
+    // Returns the number of sockets, which may exceed maxCount, or -1.
+    SUPERPANEL_API int GetListeningSockets(ListeningSocket* sockets, int maxCount);
+}
@@ -0,0 +1,769 @@
+#include "pch.h"
+#include "LogAnalytics.h"
+#include "AccessLogParser.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "Sketches.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+
+using superpanel::AccessLogParser;
+using superpanel::AccessLogRecord;
+using superpanel::ByteReader;
+using superpanel::HyperLogLog;
+using superpanel::MappedFile;
+using superpanel::SpaceSaving;
+using superpanel::ThreadPool;
+
+namespace {
+
+// Log-linear latency buckets over microseconds: values below 8 get their own
+// bucket, above that every power of two is split into 8 sub-buckets (at most
+// 12.5% relative error). 64 octaves cover any 64-bit value.
+const int SubBuckets = 8;
+const int HistogramBuckets = 64 * SubBuckets;
+
+int BucketFor(unsigned long long value) {
+    if (value < SubBuckets) return static_cast<int>(value);
+    int msb = 63;
+    while ((value >> msb) == 0) msb--;
+    int sub = static_cast<int>((value >> (msb - 3)) & (SubBuckets - 1));
+    return (msb - 2) * SubBuckets + sub;
+}
+
+// Midpoint of the values that land in bucket
+double BucketValue(int bucket) {
+    if (bucket < SubBuckets) return bucket;
+    int msb = bucket / SubBuckets + 2;
+    int sub = bucket % SubBuckets;
+    double lower = static_cast<double>((static_cast<unsigned long long>(SubBuckets + sub)) << (msb - 3));
+    double width = static_cast<double>(1ULL << (msb - 3));
+    return lower + width / 2;
+}
+
+// Chunks smaller than this are not worth a task of their own
+const size_t MinChunkSize = 8 * 1024 * 1024;
+const size_t MaxDomainLength = sizeof(AccessLogDomainStats::domain) - 1;
+
+struct DomainStats {
+    long long requests = 0;
+    long long statusClasses[5] = {};
+    long long bytesSent = 0;
+    long long firstTimestamp = -1;
+    long long lastTimestamp = -1;
+    long long latencySamples = 0;
+    std::array<unsigned long long, HistogramBuckets> latency{};
+
+    // Counts only; lifetime totals leave the latency histogram empty so
+    // percentiles always describe recent traffic
+    void AddTotals(const AccessLogRecord& record) {
+        requests++;
+        if (record.status >= 100 && record.status < 600) statusClasses[record.status / 100 - 1]++;
+        bytesSent += record.bytes;
+        if (record.timestamp >= 0) {
+            if (firstTimestamp < 0 || record.timestamp < firstTimestamp) firstTimestamp = record.timestamp;
+            if (record.timestamp > lastTimestamp) lastTimestamp = record.timestamp;
+        }
+    }
+
+    void Add(const AccessLogRecord& record) {
+        AddTotals(record);
+        if (record.latencyUs >= 0) {
+            latencySamples++;
+            latency[BucketFor(static_cast<unsigned long long>(record.latencyUs))]++;
+        }
+    }
+
+    void Merge(const DomainStats& other) {
+        requests += other.requests;
+        for (int i = 0; i < 5; i++) statusClasses[i] += other.statusClasses[i];
+        bytesSent += other.bytesSent;
+        if (other.firstTimestamp >= 0 && (firstTimestamp < 0 || other.firstTimestamp < firstTimestamp)) firstTimestamp = other.firstTimestamp;
+        if (other.lastTimestamp > lastTimestamp) lastTimestamp = other.lastTimestamp;
+        latencySamples += other.latencySamples;
+        for (int i = 0; i < HistogramBuckets; i++) latency[i] += other.latency[i];
+    }
+
+    double LatencyPercentileMs(double percentile) const {
+        if (latencySamples == 0) return 0;
+        unsigned long long rank = static_cast<unsigned long long>(percentile * static_cast<double>(latencySamples - 1));
+        unsigned long long seen = 0;
+        for (int i = 0; i < HistogramBuckets; i++) {
+            seen += latency[i];
+            if (seen > rank) return BucketValue(i) / 1000.0;
+        }
+        return BucketValue(HistogramBuckets - 1) / 1000.0;
+    }
+};
+
+using DomainMap = std::unordered_map<std::string, DomainStats>;
+
+// Wall-clock minutes of per-domain counters kept for the request rate and
+// latency percentiles. Older minutes are dropped, so those figures describe
+// current traffic rather than everything ever parsed.
+const long long RecentMinutes = 15;
+
+// Minute number since the epoch -> domain -> counters for that minute
+using RecentBuckets = std::map<long long, DomainMap>;
+
+// Heavy hitters and distinct visitors for one domain over one time bucket.
+// Everything in it merges, so a window is the merge of its buckets.
+struct TrafficSketch {
+    static constexpr size_t TrackedKeys = 64;
+    static constexpr size_t MaxKeyLength = sizeof(TrafficTopEntry::key) - 1;
+
+    HyperLogLog visitors;
+    SpaceSaving clients{TrackedKeys};
+    SpaceSaving paths{TrackedKeys};
+
+    void Add(const AccessLogRecord& record) {
+        if (!record.client.empty()) {
+            visitors.AddHash(superpanel::XXH64(record.client.data(), record.client.size()));
+            clients.Add(record.client.substr(0, MaxKeyLength));
+        }
+        if (!record.path.empty()) paths.Add(record.path.substr(0, MaxKeyLength));
+    }
+
+    void Merge(const TrafficSketch& other) {
+        visitors.Merge(other.visitors);
+        clients.Merge(other.clients);
+        paths.Merge(other.paths);
+    }
+
+    void Serialize(std::string& out) const {
+        visitors.Serialize(out);
+        clients.Serialize(out);
+        paths.Serialize(out);
+    }
+
+    // Version 3 and older state has no Count-Min sketches in the summaries
+    bool Deserialize(ByteReader& reader, unsigned int version) {
+        const bool withCountMin = version >= 4;
+        return visitors.Deserialize(reader) && clients.Deserialize(reader, withCountMin) && paths.Deserialize(reader, withCountMin);
+    }
+};
+
+// Time bucket (minute or hour number since the epoch) -> domain -> sketch
+using SketchBuckets = std::map<long long, std::unordered_map<std::string, TrafficSketch>>;
+
+// Minute buckets cover the last hour; older minutes are folded into hour
+// buckets, which are kept for a day.
+const long long MinuteBucketsKept = 60;
+const long long HourBucketsKept = 24;
+
+// Clock skew allowed in a record's timestamp. Buckets age relative to the
+// newest minute, so a later timestamp (bad clock, garbage parse) is taken as
+// the time of parsing instead of pushing every real bucket out.
+const long long FutureToleranceSeconds = 5 * 60;
+
+void MergeBuckets(SketchBuckets& target, SketchBuckets& source) {
+    for (auto& bucket : source) {
+        auto& domains = target[bucket.first];
+        for (auto& entry : bucket.second) {
+            auto existing = domains.find(entry.first);
+            if (existing == domains.end()) domains.emplace(entry.first, std::move(entry.second));
+            else existing->second.Merge(entry.second);
+        }
+    }
+}
+
+struct ChunkResult {
+    DomainMap domains;
+    RecentBuckets recent;
+    SketchBuckets minutes;
+    long long lines = 0;
+    long long malformed = 0;
+};
+
+struct FileState {
+    unsigned long long identity = 0;
+    unsigned long long offset = 0;
+};
+
+void ParseChunk(const AccessLogParser& parser, const char* data, size_t length, const std::string& defaultDomain, long long now, ChunkResult& result) {
+    std::string key;
+    AccessLogRecord record;
+    const char* end = data + length;
+    const long long recentCutoff = now / 60 - RecentMinutes + 1;
+    const long long latestTimestamp = now + FutureToleranceSeconds;
+    // Consecutive lines nearly always share a minute
+    long long currentMinute = -1;
+    std::unordered_map<std::string, TrafficSketch>* minuteSketches = nullptr;
+    DomainMap* recentDomains = nullptr;
+
+    for (const char* line = data; line < end;) {
+        const char* newline = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+        const char* lineEnd = newline != nullptr ? newline : end;
+        size_t lineLength = static_cast<size_t>(lineEnd - line);
+
+        if (lineLength > 0) {
+            result.lines++;
+            if (!parser.Parse(line, lineLength, record)) {
+                result.malformed++;
+            } else {
+                if (record.timestamp > latestTimestamp) record.timestamp = now;
+                // Reusing key's capacity keeps the hot path allocation-free
+                if (record.host.empty() || record.host == "-") {
+                    key.assign(defaultDomain);
+                } else {
+                    key.assign(record.host.data(), std::min(record.host.size(), MaxDomainLength));
+                    for (char& c : key) {
+                        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+                    }
+                }
+                result.domains[key].AddTotals(record);
+
+                long long minute = (record.timestamp >= 0 ? record.timestamp : now) / 60;
+                if (minute != currentMinute) {
+                    currentMinute = minute;
+                    minuteSketches = &result.minutes[minute];
+                    recentDomains = minute >= recentCutoff ? &result.recent[minute] : nullptr;
+                }
+                (*minuteSketches)[key].Add(record);
+                if (recentDomains != nullptr) (*recentDomains)[key].Add(record);
+            }
+        }
+        line = lineEnd + 1;
+    }
+}
+
+unsigned long long FileIdentity(const char* path) {
+#ifdef _WIN32
+    // No stable inode through the CRT; truncation is still detected by size
+    (void)path;
+    return 0;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    return (static_cast<unsigned long long>(st.st_dev) << 40) ^ static_cast<unsigned long long>(st.st_ino);
+#endif
+}
+
+// After a rename-style rotation the file we were reading lives on next to the
+// path under a new name (access.log.1, access.log-20260101, ...). Returns that
+// name, or an empty string once it has been compressed or removed.
+std::string FindRotatedFile(const std::string& path, unsigned long long identity) {
+    if (identity == 0) return std::string();
+    std::error_code ec;
+    std::filesystem::path current = std::filesystem::u8path(path);
+    std::string prefix = current.filename().u8string();
+    std::filesystem::path directory = current.parent_path();
+    if (directory.empty()) directory = ".";
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::string name = entry.path().filename().u8string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+        std::string candidate = entry.path().u8string();
+        if (FileIdentity(candidate.c_str()) == identity) return candidate;
+    }
+    return std::string();
+}
+
+template <typename T>
+void WriteValue(FILE* file, const T& value) {
+    fwrite(&value, sizeof(value), 1, file);
+}
+
+void WriteString(FILE* file, const std::string& value) {
+    WriteValue(file, static_cast<unsigned int>(value.size()));
+    fwrite(value.data(), 1, value.size(), file);
+}
+
+template <typename T>
+bool ReadValue(FILE* file, T& value) {
+    return fread(&value, sizeof(value), 1, file) == 1;
+}
+
+bool ReadString(FILE* file, std::string& value, unsigned int maxLength = 65536) {
+    unsigned int length;
+    if (!ReadValue(file, length) || length > maxLength) return false;
+    value.resize(length);
+    return fread(&value[0], 1, length, file) == length;
+}
+
+void WriteDomainStats(FILE* file, const DomainStats& domain) {
+    WriteValue(file, domain.requests);
+    for (long long count : domain.statusClasses) WriteValue(file, count);
+    WriteValue(file, domain.bytesSent);
+    WriteValue(file, domain.firstTimestamp);
+    WriteValue(file, domain.lastTimestamp);
+    WriteValue(file, domain.latencySamples);
+    // Histograms are sparse; store only occupied buckets
+    unsigned short used = 0;
+    for (unsigned long long count : domain.latency) used += count != 0;
+    WriteValue(file, used);
+    for (int i = 0; i < HistogramBuckets; i++) {
+        if (domain.latency[i] == 0) continue;
+        WriteValue(file, static_cast<unsigned short>(i));
+        WriteValue(file, domain.latency[i]);
+    }
+}
+
+bool ReadDomainStats(FILE* file, DomainStats& domain) {
+    if (!ReadValue(file, domain.requests)) return false;
+    for (long long& value : domain.statusClasses) {
+        if (!ReadValue(file, value)) return false;
+    }
+    unsigned short used;
+    if (!ReadValue(file, domain.bytesSent) || !ReadValue(file, domain.firstTimestamp) || !ReadValue(file, domain.lastTimestamp) ||
+        !ReadValue(file, domain.latencySamples) || !ReadValue(file, used)) {
+        return false;
+    }
+    for (unsigned short b = 0; b < used; b++) {
+        unsigned short bucket;
+        unsigned long long value;
+        if (!ReadValue(file, bucket) || !ReadValue(file, value) || bucket >= HistogramBuckets) return false;
+        domain.latency[bucket] = value;
+    }
+    return true;
+}
+
+void WriteRecent(FILE* file, const RecentBuckets& recent) {
+    WriteValue(file, static_cast<unsigned int>(recent.size()));
+    for (const auto& minute : recent) {
+        WriteValue(file, minute.first);
+        WriteValue(file, static_cast<unsigned int>(minute.second.size()));
+        for (const auto& entry : minute.second) {
+            WriteString(file, entry.first);
+            WriteDomainStats(file, entry.second);
+        }
+    }
+}
+
+bool ReadRecent(FILE* file, RecentBuckets& recent) {
+    unsigned int minuteCount;
+    if (!ReadValue(file, minuteCount)) return false;
+    std::string name;
+    for (unsigned int i = 0; i < minuteCount; i++) {
+        long long minute;
+        unsigned int domainCount;
+        if (!ReadValue(file, minute) || !ReadValue(file, domainCount)) return false;
+        auto& domains = recent[minute];
+        for (unsigned int d = 0; d < domainCount; d++) {
+            if (!ReadString(file, name) || !ReadDomainStats(file, domains[name])) return false;
+        }
+    }
+    return true;
+}
+
+void WriteBuckets(FILE* file, const SketchBuckets& buckets) {
+    std::string blob;
+    WriteValue(file, static_cast<unsigned int>(buckets.size()));
+    for (const auto& bucket : buckets) {
+        WriteValue(file, bucket.first);
+        WriteValue(file, static_cast<unsigned int>(bucket.second.size()));
+        for (const auto& entry : bucket.second) {
+            WriteString(file, entry.first);
+            blob.clear();
+            entry.second.Serialize(blob);
+            WriteString(file, blob);
+        }
+    }
+}
+
+bool ReadBuckets(FILE* file, SketchBuckets& buckets, unsigned int version) {
+    unsigned int bucketCount;
+    if (!ReadValue(file, bucketCount)) return false;
+    std::string name, blob;
+    for (unsigned int i = 0; i < bucketCount; i++) {
+        long long bucket;
+        unsigned int domainCount;
+        if (!ReadValue(file, bucket) || !ReadValue(file, domainCount)) return false;
+        auto& domains = buckets[bucket];
+        for (unsigned int d = 0; d < domainCount; d++) {
+            if (!ReadString(file, name) || !ReadString(file, blob, 16 * 1024 * 1024)) return false;
+            ByteReader reader(blob.data(), blob.size());
+            if (!domains[name].Deserialize(reader, version)) return false;
+        }
+    }
+    return true;
+}
+
+const unsigned int StateMagic = 0x414C5053; // "SPLA"
+// Version 2 appends the sketch buckets, version 3 the recent counters and
+// version 4 the heavy hitters' Count-Min sketches; older state still loads
+const unsigned int StateVersion = 4;
+
+class LogAnalytics {
+public:
+    bool SetFormat(const char* format) { return parser_.SetFormat(format); }
+
+    long long Analyze(const char* path, const std::string& defaultDomain, int threadCount) {
+        std::lock_guard<std::mutex> guard(lock_);
+
+        MappedFile file;
+        if (!file.Open(path)) return -1;
+
+        long long lines = 0;
+        FileState& state = files_[path];
+        unsigned long long identity = FileIdentity(path);
+        if (identity != state.identity) {
+            // Rotated: lines written to the old file after the previous run
+            // are still unread, so finish it before starting on the new one
+            std::string rotated = FindRotatedFile(path, state.identity);
+            MappedFile previous;
+            if (!rotated.empty() && previous.Open(rotated.c_str()) && previous.Size() > state.offset) {
+                lines += ParseRange(previous, static_cast<size_t>(state.offset), static_cast<size_t>(previous.Size()),
+                                    defaultDomain, threadCount);
+            }
+            state.identity = identity;
+            state.offset = 0;
+        } else if (file.Size() < state.offset) {
+            // Truncated in place: the offset belongs to older content
+            state.offset = 0;
+        }
+
+        const char* data = file.Data();
+        const size_t start = static_cast<size_t>(state.offset);
+        size_t end = static_cast<size_t>(file.Size());
+        while (end > start && data[end - 1] != '\n') end--;
+        if (end <= start) return lines;
+
+        lines += ParseRange(file, start, end, defaultDomain, threadCount);
+        state.offset = end;
+        return lines;
+    }
+
+    long long GetWindow(const char* domain, int windowMinutes, TrafficTopEntry* topClients, int* clientCount,
+                        TrafficTopEntry* topPaths, int* pathCount) {
+        std::lock_guard<std::mutex> guard(lock_);
+
+        TrafficSketch window;
+        if (!minutes_.empty()) {
+            // Windows end at the newest minute seen in the logs, not the wall clock
+            const long long newest = minutes_.rbegin()->first;
+            const long long first = newest - windowMinutes + 1;
+            auto mergeDomains = [&](const std::unordered_map<std::string, TrafficSketch>& domains) {
+                if (domain == nullptr || domain[0] == '\0') {
+                    for (const auto& entry : domains) window.Merge(entry.second);
+                    return;
+                }
+                auto match = domains.find(domain);
+                if (match != domains.end()) window.Merge(match->second);
+            };
+
+            for (auto it = minutes_.lower_bound(first); it != minutes_.end(); ++it) mergeDomains(it->second);
+            // Past the minute buckets, add the hours that overlap the window;
+            // the oldest may contribute up to 59 minutes more than asked for
+            if (first <= newest - MinuteBucketsKept) {
+                for (auto it = hours_.lower_bound(first / 60); it != hours_.end(); ++it) mergeDomains(it->second);
+            }
+        }
+
+        CopyTop(window.clients, topClients, clientCount);
+        CopyTop(window.paths, topPaths, pathCount);
+        return static_cast<long long>(window.visitors.Estimate());
+    }
+
+    int GetStats(AccessLogDomainStats* stats, int maxCount) {
+        std::lock_guard<std::mutex> guard(lock_);
+        DropOldRecent(static_cast<long long>(time(nullptr)));
+
+        std::vector<const std::pair<const std::string, DomainStats>*> ordered;
+        ordered.reserve(domains_.size());
+        for (const auto& entry : domains_) ordered.push_back(&entry);
+        std::sort(ordered.begin(), ordered.end(), [](const auto* a, const auto* b) {
+            return a->second.requests > b->second.requests;
+        });
+
+        int count = std::min(maxCount, static_cast<int>(ordered.size()));
+        for (int i = 0; i < count && stats != nullptr; i++) {
+            const std::string& name = ordered[i]->first;
+            const DomainStats& domain = ordered[i]->second;
+            AccessLogDomainStats& out = stats[i];
+            memset(&out, 0, sizeof(out));
+            memcpy(out.domain, name.data(), std::min(name.size(), MaxDomainLength));
+            out.requests = domain.requests;
+            out.status1xx = domain.statusClasses[0];
+            out.status2xx = domain.statusClasses[1];
+            out.status3xx = domain.statusClasses[2];
+            out.status4xx = domain.statusClasses[3];
+            out.status5xx = domain.statusClasses[4];
+            out.bytesSent = domain.bytesSent;
+            out.firstTimestamp = domain.firstTimestamp;
+            out.lastTimestamp = domain.lastTimestamp;
+
+            DomainStats recent;
+            for (const auto& minute : recent_) {
+                auto match = minute.second.find(name);
+                if (match != minute.second.end()) recent.Merge(match->second);
+            }
+            out.latencySamples = recent.latencySamples;
+            out.latencyP50Ms = recent.LatencyPercentileMs(0.50);
+            out.latencyP95Ms = recent.LatencyPercentileMs(0.95);
+            out.latencyP99Ms = recent.LatencyPercentileMs(0.99);
+            out.recentRequests = recent.requests;
+            out.recentMinutes = RecentMinutes;
+        }
+        return static_cast<int>(ordered.size());
+    }
+
+    long long Malformed() {
+        std::lock_guard<std::mutex> guard(lock_);
+        return malformed_;
+    }
+
+    bool Save(const char* path) {
+        std::lock_guard<std::mutex> guard(lock_);
+
+        // Write-then-rename so a crash never leaves a half-written state
+        std::string temporary = std::string(path) + ".tmp";
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (file == nullptr) return false;
+
+        WriteValue(file, StateMagic);
+        WriteValue(file, StateVersion);
+        WriteValue(file, malformed_);
+        WriteValue(file, static_cast<unsigned int>(files_.size()));
+        for (const auto& entry : files_) {
+            WriteString(file, entry.first);
+            WriteValue(file, entry.second.identity);
+            WriteValue(file, entry.second.offset);
+        }
+        WriteValue(file, static_cast<unsigned int>(domains_.size()));
+        for (const auto& entry : domains_) {
+            WriteString(file, entry.first);
+            WriteDomainStats(file, entry.second);
+        }
+        WriteBuckets(file, minutes_);
+        WriteBuckets(file, hours_);
+        WriteRecent(file, recent_);
+
+        bool ok = ferror(file) == 0;
+        ok = fclose(file) == 0 && ok;
+        if (ok) {
+#ifdef _WIN32
+            std::remove(path); // rename does not replace on Windows
+#endif
+            ok = std::rename(temporary.c_str(), path) == 0;
+        }
+        if (!ok) std::remove(temporary.c_str());
+        return ok;
+    }
+
+    bool Load(const char* path) {
+        FILE* file = fopen(path, "rb");
+        if (file == nullptr) return false;
+
+        std::unordered_map<std::string, FileState> files;
+        DomainMap domains;
+        SketchBuckets minutes, hours;
+        RecentBuckets recent;
+        long long malformed = 0;
+        unsigned int version = 0;
+        bool ok = ReadState(file, files, domains, malformed, version);
+        if (ok && version >= 2) ok = ReadBuckets(file, minutes, version) && ReadBuckets(file, hours, version);
+        if (ok && version >= 3) ok = ReadRecent(file, recent);
+        fclose(file);
+        if (!ok) return false;
+
+        std::lock_guard<std::mutex> guard(lock_);
+        files_.swap(files);
+        domains_.swap(domains);
+        minutes_.swap(minutes);
+        hours_.swap(hours);
+        recent_.swap(recent);
+        malformed_ = malformed;
+        return true;
+    }
+
+private:
+    // Parses [start, end) of a mapped log in parallel and folds the results in.
+    // Caller holds lock_.
+    long long ParseRange(MappedFile& file, size_t start, size_t end, const std::string& defaultDomain, int threadCount) {
+        const char* data = file.Data();
+        file.AdviseSequential();
+
+        unsigned threads = threadCount > 0 ? static_cast<unsigned>(threadCount) : ThreadPool::DefaultThreadCount();
+        size_t chunkSize = std::max(MinChunkSize, (end - start) / (static_cast<size_t>(threads) * 4) + 1);
+
+        // Chunk boundaries always fall just after a newline
+        std::vector<std::pair<size_t, size_t>> chunks;
+        for (size_t pos = start; pos < end;) {
+            size_t next = std::min(pos + chunkSize, end);
+            if (next < end) {
+                const void* newline = memchr(data + next, '\n', end - next);
+                next = newline != nullptr ? static_cast<size_t>(static_cast<const char*>(newline) - data) + 1 : end;
+            }
+            chunks.emplace_back(pos, next);
+            pos = next;
+        }
+
+        const long long now = static_cast<long long>(time(nullptr));
+        std::vector<ChunkResult> results(chunks.size());
+        if (chunks.size() == 1 || threads == 1) {
+            for (size_t i = 0; i < chunks.size(); i++) {
+                ParseChunk(parser_, data + chunks[i].first, chunks[i].second - chunks[i].first, defaultDomain, now, results[i]);
+            }
+        } else {
+            ThreadPool pool(std::min(threads, static_cast<unsigned>(chunks.size())));
+            for (size_t i = 0; i < chunks.size(); i++) {
+                pool.Submit([&, i] {
+                    ParseChunk(parser_, data + chunks[i].first, chunks[i].second - chunks[i].first, defaultDomain, now, results[i]);
+                });
+            }
+            pool.WaitIdle();
+        }
+
+        long long lines = 0;
+        for (ChunkResult& result : results) {
+            lines += result.lines;
+            malformed_ += result.malformed;
+            for (auto& entry : result.domains) domains_[entry.first].Merge(entry.second);
+            for (auto& minute : result.recent) {
+                DomainMap& domains = recent_[minute.first];
+                for (auto& entry : minute.second) domains[entry.first].Merge(entry.second);
+            }
+            MergeBuckets(minutes_, result.minutes);
+        }
+        AgeBuckets(now);
+        DropOldRecent(now);
+        return lines;
+    }
+
+    // Caller holds lock_
+    void DropOldRecent(long long now) {
+        const long long cutoff = now / 60 - RecentMinutes + 1;
+        while (!recent_.empty() && recent_.begin()->first < cutoff) recent_.erase(recent_.begin());
+    }
+
+    static void CopyTop(const SpaceSaving& summary, TrafficTopEntry* entries, int* count) {
+        if (count == nullptr) return;
+        if (entries == nullptr || *count <= 0) {
+            *count = 0;
+            return;
+        }
+        auto top = summary.Top(static_cast<size_t>(*count));
+        for (size_t i = 0; i < top.size(); i++) {
+            TrafficTopEntry& out = entries[i];
+            memset(out.key, 0, sizeof(out.key));
+            memcpy(out.key, top[i].key.data(), std::min(top[i].key.size(), TrafficSketch::MaxKeyLength));
+            out.count = static_cast<long long>(top[i].count);
+            out.error = static_cast<long long>(top[i].error);
+        }
+        *count = static_cast<int>(top.size());
+    }
+
+    // Caller holds lock_
+    void AgeBuckets(long long now) {
+        // Future buckets can only come from state saved before timestamps
+        // were clamped
+        const long long latestMinute = (now + FutureToleranceSeconds) / 60;
+        while (!minutes_.empty() && minutes_.rbegin()->first > latestMinute) minutes_.erase(std::prev(minutes_.end()));
+        while (!hours_.empty() && hours_.rbegin()->first > latestMinute / 60) hours_.erase(std::prev(hours_.end()));
+        if (minutes_.empty()) return;
+        const long long newestMinute = minutes_.rbegin()->first;
+
+        while (!minutes_.empty() && minutes_.begin()->first <= newestMinute - MinuteBucketsKept) {
+            auto oldest = minutes_.begin();
+            SketchBuckets folded;
+            folded[oldest->first / 60].swap(oldest->second);
+            MergeBuckets(hours_, folded);
+            minutes_.erase(oldest);
+        }
+
+        const long long oldestHour = newestMinute / 60 - HourBucketsKept;
+        while (!hours_.empty() && hours_.begin()->first <= oldestHour) hours_.erase(hours_.begin());
+    }
+
+    static bool ReadState(FILE* file, std::unordered_map<std::string, FileState>& files, DomainMap& domains, long long& malformed,
+                          unsigned int& version) {
+        unsigned int magic, count;
+        if (!ReadValue(file, magic) || magic != StateMagic) return false;
+        if (!ReadValue(file, version) || version < 1 || version > StateVersion) return false;
+        if (!ReadValue(file, malformed) || !ReadValue(file, count)) return false;
+
+        for (unsigned int i = 0; i < count; i++) {
+            std::string name;
+            FileState state;
+            if (!ReadString(file, name) || !ReadValue(file, state.identity) || !ReadValue(file, state.offset)) return false;
+            files[name] = state;
+        }
+
+        if (!ReadValue(file, count)) return false;
+        for (unsigned int i = 0; i < count; i++) {
+            std::string name;
+            DomainStats domain;
+            if (!ReadString(file, name) || !ReadDomainStats(file, domain)) return false;
+            // Version 2 and older kept lifetime histograms; percentiles now
+            // come from the recent counters only
+            domain.latencySamples = 0;
+            domain.latency.fill(0);
+            domains[name] = domain;
+        }
+        return true;
+    }
+
+    std::mutex lock_;
+    AccessLogParser parser_;
+    std::unordered_map<std::string, FileState> files_;
+    DomainMap domains_;
+    SketchBuckets minutes_;
+    SketchBuckets hours_;
+    RecentBuckets recent_;
+    long long malformed_ = 0;
+};
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* CreateLogAnalytics(const char* format) {
+    if (format == NULL) return NULL;
+    auto* analytics = new LogAnalytics();
+    if (!analytics->SetFormat(format)) {
+        delete analytics;
+        return NULL;
+    }
+    return analytics;
+}
+
+SUPERPANEL_API void DestroyLogAnalytics(void* analytics) {
+    delete static_cast<LogAnalytics*>(analytics);
+}
+
+SUPERPANEL_API long long AnalyzeAccessLog(void* analytics, const char* path, const char* defaultDomain, int threadCount) {
+    if (analytics == NULL || path == NULL) return -1;
+    std::string domain = defaultDomain != NULL && defaultDomain[0] != '\0' ? defaultDomain : "-";
+    return static_cast<LogAnalytics*>(analytics)->Analyze(path, domain, threadCount);
+}
+
+SUPERPANEL_API int GetAccessLogStats(void* analytics, AccessLogDomainStats* stats, int maxCount) {
+    if (analytics == NULL || maxCount < 0) return -1;
+    return static_cast<LogAnalytics*>(analytics)->GetStats(stats, maxCount);
+}
+
+SUPERPANEL_API long long GetTrafficWindow(void* analytics, const char* domain, int windowMinutes, TrafficTopEntry* topClients, int* clientCount,
+                                          TrafficTopEntry* topPaths, int* pathCount) {
+    if (analytics == NULL || windowMinutes <= 0) return -1;
+    return static_cast<LogAnalytics*>(analytics)->GetWindow(domain, windowMinutes, topClients, clientCount, topPaths, pathCount);
+}
+
+SUPERPANEL_API long long GetMalformedLogLines(void* analytics) {
+    if (analytics == NULL) return -1;
+    return static_cast<LogAnalytics*>(analytics)->Malformed();
+}
+
+SUPERPANEL_API int SaveLogAnalyticsState(void* analytics, const char* path) {
+    if (analytics == NULL || path == NULL) return 0;
+    return static_cast<LogAnalytics*>(analytics)->Save(path) ? 1 : 0;
+}
+
+SUPERPANEL_API int LoadLogAnalyticsState(void* analytics, const char* path) {
+    if (analytics == NULL || path == NULL) return 0;
+    return static_cast<LogAnalytics*>(analytics)->Load(path) ? 1 : 0;
+}
+
+} // extern "C"
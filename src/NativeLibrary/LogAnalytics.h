@@ -0,0 +1,69 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Per-domain traffic totals accumulated from access logs
+struct AccessLogDomainStats {
+    char domain[128];
+    long long requests;
+    long long status1xx;
+    long long status2xx;
+    long long status3xx;
+    long long status4xx;
+    long long status5xx;
+    long long bytesSent;
+    long long firstTimestamp; // Unix seconds of the oldest request seen, -1 if the format has no time
+    long long lastTimestamp;
+    // The rest covers only the last recentMinutes of wall-clock time
+    long long latencySamples; // Requests that carried a request time
+    double latencyP50Ms;
+    double latencyP95Ms;
+    double latencyP99Ms;
+    long long recentRequests;
+    long long recentMinutes;
+};
+
+// A heavy hitter (client address or request path) and its estimated count;
+// the true count lies in [count - error, count]
+struct TrafficTopEntry {
+    char key[128];
+    long long count;
+    long long error;
+};
+
+extern "C" {
+    // Access-log analytics. An analytics object parses nginx/Apache access logs
+    // in the given log_format / LogFormat syntax (or "combined", "common",
+    // "vhost_combined") and accumulates per-domain request counts, status
+    // classes, bytes and latency histograms. Returns NULL for an unusable format.
+    SUPERPANEL_API void* CreateLogAnalytics(const char* format);
+    SUPERPANEL_API void DestroyLogAnalytics(void* analytics);
+
+    // Parses the complete lines appended to path since the previous call for
+    // that path (a partial last line is left for the next run) in parallel over
+    // the mapped file. A replaced or truncated file is read from the start.
+    // Lines without a host field are counted under defaultDomain. Returns the
+    // number of lines parsed, or -1 if the file cannot be read. When the path
+    // now names a different file, the unread tail of the previous one is
+    // parsed first if it can still be found next to it under a rotated name.
+    SUPERPANEL_API long long AnalyzeAccessLog(void* analytics, const char* path, const char* defaultDomain, int threadCount);
+
+    // Copies up to maxCount domains, busiest first, and returns the total
+    // number of domains.
+    SUPERPANEL_API int GetAccessLogStats(void* analytics, AccessLogDomainStats* stats, int maxCount);
+    SUPERPANEL_API long long GetMalformedLogLines(void* analytics);
+
+    // Rolling-window view built by merging per-minute sketches (per-hour past
+    // the last hour, up to a day): returns the estimated number of distinct
+    // clients over the last windowMinutes of log time for domain (NULL or ""
+    // for all domains), and fills the busiest clients and paths. *clientCount
+    // and *pathCount give the array sizes on input and the entries written on
+    // output. Returns -1 on bad arguments.
+    SUPERPANEL_API long long GetTrafficWindow(void* analytics, const char* domain, int windowMinutes, TrafficTopEntry* topClients, int* clientCount,
+                                              TrafficTopEntry* topPaths, int* pathCount);
+
+    // Persists / restores the per-file read offsets together with the
+    // accumulated totals so the next run resumes where the last one stopped.
+    SUPERPANEL_API int SaveLogAnalyticsState(void* analytics, const char* path);
+    SUPERPANEL_API int LoadLogAnalyticsState(void* analytics, const char* path);
+}
@@ -0,0 +1,453 @@
+#include "pch.h"
+#include "LogFollower.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+
+const size_t ReadChunkSize = 64 * 1024;
+// A "line" with no newline in sight is flushed once it gets this long
+const size_t MaxPartialLine = 1024 * 1024;
+// Safety-net rescan interval for events inotify cannot see (NFS, overflow)
+const int RescanIntervalMs = 1000;
+const uint32_t DirectoryEvents = IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CLOSE_WRITE | IN_ATTRIB;
+
+struct FollowedFile {
+    int id = 0;
+    std::string path;
+    std::string directory;
+    std::string name;
+    int fd = -1;
+    dev_t device = 0;
+    ino_t inode = 0;
+    off_t offset = 0;
+    std::string partial;
+    bool watched = false;
+};
+
+struct WatchedDirectory {
+    std::string path;
+    int refs = 0;
+};
+
+using Batch = std::pair<int, std::string>;
+
+// Fixed-size byte ring of [fileId][length][bytes] records. When a new record
+// does not fit, whole records are dropped from the head.
+class BatchRing {
+public:
+    explicit BatchRing(size_t capacity) : data_(capacity) {}
+
+    void Push(int fileId, const std::string& lines) {
+        std::lock_guard<std::mutex> guard(lock_);
+        size_t recordSize = HeaderSize + lines.size();
+        if (recordSize > data_.size()) {
+            dropped_++;
+            return;
+        }
+        while (data_.size() - used_ < recordSize) DropOldest();
+
+        int32_t header[2] = {fileId, static_cast<int32_t>(lines.size())};
+        Write(header, HeaderSize);
+        Write(lines.data(), lines.size());
+    }
+
+    int Read(char* buffer, int bufferSize, long long* dropped) {
+        std::lock_guard<std::mutex> guard(lock_);
+        size_t copied = 0;
+        while (used_ >= HeaderSize) {
+            int32_t header[2];
+            Peek(header, HeaderSize);
+            size_t recordSize = HeaderSize + static_cast<size_t>(header[1]);
+            if (copied + recordSize > static_cast<size_t>(bufferSize)) break;
+            Consume(buffer + copied, recordSize);
+            copied += recordSize;
+        }
+        if (dropped != nullptr) *dropped = dropped_;
+        dropped_ = 0;
+        return static_cast<int>(copied);
+    }
+
+private:
+    static const size_t HeaderSize = 2 * sizeof(int32_t);
+
+    void Write(const void* source, size_t length) {
+        const char* bytes = static_cast<const char*>(source);
+        size_t first = std::min(length, data_.size() - tail_);
+        memcpy(data_.data() + tail_, bytes, first);
+        memcpy(data_.data(), bytes + first, length - first);
+        tail_ = (tail_ + length) % data_.size();
+        used_ += length;
+    }
+
+    void Peek(void* target, size_t length) const {
+        char* bytes = static_cast<char*>(target);
+        size_t first = std::min(length, data_.size() - head_);
+        memcpy(bytes, data_.data() + head_, first);
+        memcpy(bytes + first, data_.data(), length - first);
+    }
+
+    void Consume(void* target, size_t length) {
+        if (target != nullptr) Peek(target, length);
+        head_ = (head_ + length) % data_.size();
+        used_ -= length;
+    }
+
+    void DropOldest() {
+        int32_t header[2];
+        Peek(header, HeaderSize);
+        Consume(nullptr, HeaderSize + static_cast<size_t>(header[1]));
+        dropped_++;
+    }
+
+    std::mutex lock_;
+    std::vector<char> data_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+    size_t used_ = 0;
+    long long dropped_ = 0;
+};
+
+class LogFollower {
+public:
+    LogFollower(LogLinesCallback callback, void* context, size_t ringBytes)
+        : callback_(callback), context_(context) {
+        if (callback_ == nullptr) ring_.reset(new BatchRing(ringBytes));
+    }
+
+    ~LogFollower() {
+        stopping_ = true;
+        Wake();
+        if (thread_.joinable()) thread_.join();
+        for (auto& entry : files_) {
+            if (entry.second.fd >= 0) close(entry.second.fd);
+        }
+        if (inotifyFd_ >= 0) close(inotifyFd_);
+        if (wakeFd_ >= 0) close(wakeFd_);
+    }
+
+    bool Start() {
+        inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd_ < 0) return false;
+        // Without inotify the periodic rescan still follows every file
+        thread_ = std::thread(&LogFollower::Run, this);
+        return true;
+    }
+
+    int Add(const char* path, bool fromEnd) {
+        FollowedFile file;
+        file.path = path;
+        size_t slash = file.path.find_last_of('/');
+        file.directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : file.path.substr(0, slash));
+        file.name = slash == std::string::npos ? file.path : file.path.substr(slash + 1);
+
+        std::lock_guard<std::mutex> guard(lock_);
+        file.id = nextId_++;
+        if (OpenCurrent(file) && fromEnd) {
+            struct stat st;
+            if (fstat(file.fd, &st) == 0) file.offset = st.st_size;
+        }
+        file.watched = WatchDirectory(file.directory);
+        int id = file.id;
+        files_.emplace(id, std::move(file));
+        Wake();
+        return id;
+    }
+
+    bool Remove(int id) {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto it = files_.find(id);
+        if (it == files_.end()) return false;
+        if (it->second.fd >= 0) close(it->second.fd);
+        if (it->second.watched) UnwatchDirectory(it->second.directory);
+        files_.erase(it);
+        return true;
+    }
+
+    int ReadBatches(char* buffer, int bufferSize, long long* dropped) {
+        if (!ring_) return 0;
+        return ring_->Read(buffer, bufferSize, dropped);
+    }
+
+private:
+    void Wake() {
+        if (wakeFd_ < 0) return;
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd_, &one, sizeof(one));
+        (void)ignored;
+    }
+
+    bool WatchDirectory(const std::string& directory) {
+        auto it = wdByDirectory_.find(directory);
+        if (it != wdByDirectory_.end()) {
+            directories_[it->second].refs++;
+            return true;
+        }
+        if (inotifyFd_ < 0) return false;
+        int wd = inotify_add_watch(inotifyFd_, directory.c_str(), DirectoryEvents);
+        if (wd < 0) return false; // Directory may appear later; rescans cover it until then
+        wdByDirectory_[directory] = wd;
+        directories_[wd] = WatchedDirectory{directory, 1};
+        return true;
+    }
+
+    void UnwatchDirectory(const std::string& directory) {
+        auto it = wdByDirectory_.find(directory);
+        if (it == wdByDirectory_.end()) return;
+        int wd = it->second;
+        if (--directories_[wd].refs > 0) return;
+        inotify_rm_watch(inotifyFd_, wd);
+        directories_.erase(wd);
+        wdByDirectory_.erase(it);
+    }
+
+    bool OpenCurrent(FollowedFile& file) {
+        int fd = open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        file.fd = fd;
+        file.device = st.st_dev;
+        file.inode = st.st_ino;
+        file.offset = 0;
+        file.partial.clear();
+        return true;
+    }
+
+    void EmitLines(FollowedFile& file, const char* data, size_t length, std::vector<Batch>& out) {
+        const char* end = data + length;
+        const char* lastNewline = nullptr;
+        for (const char* p = end; p > data; p--) {
+            if (p[-1] == '\n') {
+                lastNewline = p - 1;
+                break;
+            }
+        }
+
+        if (lastNewline == nullptr) {
+            file.partial.append(data, length);
+        } else {
+            std::string lines;
+            lines.reserve(file.partial.size() + static_cast<size_t>(lastNewline + 1 - data));
+            lines.swap(file.partial);
+            lines.append(data, static_cast<size_t>(lastNewline + 1 - data));
+            file.partial.assign(lastNewline + 1, end);
+            out.emplace_back(file.id, std::move(lines));
+        }
+
+        if (file.partial.size() >= MaxPartialLine) FlushPartial(file, out);
+    }
+
+    void FlushPartial(FollowedFile& file, std::vector<Batch>& out) {
+        if (file.partial.empty()) return;
+        file.partial.push_back('\n');
+        out.emplace_back(file.id, std::move(file.partial));
+        file.partial.clear();
+    }
+
+    // Reads everything appended since the last call
+    void ReadAppended(FollowedFile& file, std::vector<Batch>& out) {
+        struct stat st;
+        if (fstat(file.fd, &st) != 0) return;
+        if (st.st_size < file.offset) {
+            // Truncated in place (copytruncate rotation)
+            file.offset = 0;
+            file.partial.clear();
+        }
+
+        char buffer[ReadChunkSize];
+        while (file.offset < st.st_size) {
+            ssize_t n = pread(file.fd, buffer, sizeof(buffer), file.offset);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            file.offset += n;
+            EmitLines(file, buffer, static_cast<size_t>(n), out);
+        }
+    }
+
+    void PollFile(FollowedFile& file, std::vector<Batch>& out) {
+        if (!file.watched) file.watched = WatchDirectory(file.directory);
+        if (file.fd < 0 && !OpenCurrent(file)) return;
+
+        ReadAppended(file, out);
+
+        // Rotation by rename/create: the path now names a different inode.
+        // The old file has just been drained, so switch over.
+        struct stat st;
+        if (stat(file.path.c_str(), &st) == 0 && (st.st_ino != file.inode || st.st_dev != file.device)) {
+            FlushPartial(file, out);
+            close(file.fd);
+            file.fd = -1;
+            if (OpenCurrent(file)) ReadAppended(file, out);
+        }
+    }
+
+    void Dispatch(std::vector<Batch>& batches) {
+        for (auto& batch : batches) {
+            if (callback_ != nullptr) {
+                callback_(batch.first, batch.second.data(), static_cast<int>(batch.second.size()), context_);
+            } else {
+                ring_->Push(batch.first, batch.second);
+            }
+        }
+        batches.clear();
+    }
+
+    void Run() {
+        std::vector<Batch> batches;
+        std::vector<int> dirty;
+        alignas(struct inotify_event) char events[16 * 1024];
+
+        while (!stopping_) {
+            struct pollfd fds[2];
+            int count = 0;
+            fds[count++] = {wakeFd_, POLLIN, 0};
+            if (inotifyFd_ >= 0) fds[count++] = {inotifyFd_, POLLIN, 0};
+
+            int ready = poll(fds, count, RescanIntervalMs);
+            if (stopping_) break;
+            if (ready < 0 && errno != EINTR) break;
+
+            bool rescanAll = ready == 0;
+            dirty.clear();
+
+            if (ready > 0 && (fds[0].revents & POLLIN)) {
+                uint64_t value;
+                ssize_t ignored = read(wakeFd_, &value, sizeof(value));
+                (void)ignored;
+                rescanAll = true;
+            }
+
+            std::unique_lock<std::mutex> guard(lock_);
+            if (ready > 0 && count > 1 && (fds[1].revents & POLLIN)) {
+                ssize_t length;
+                while ((length = read(inotifyFd_, events, sizeof(events))) > 0) {
+                    for (char* p = events; p < events + length;) {
+                        auto* event = reinterpret_cast<struct inotify_event*>(p);
+                        p += sizeof(struct inotify_event) + event->len;
+                        if (event->mask & IN_Q_OVERFLOW) {
+                            rescanAll = true;
+                            continue;
+                        }
+                        auto dir = directories_.find(event->wd);
+                        if (dir == directories_.end() || event->len == 0) continue;
+                        for (auto& entry : files_) {
+                            if (entry.second.directory == dir->second.path && entry.second.name == event->name) {
+                                dirty.push_back(entry.first);
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (rescanAll) {
+                for (auto& entry : files_) PollFile(entry.second, batches);
+            } else {
+                for (int id : dirty) {
+                    auto it = files_.find(id);
+                    if (it != files_.end()) PollFile(it->second, batches);
+                }
+            }
+            guard.unlock();
+
+            Dispatch(batches);
+        }
+    }
+
+    LogLinesCallback callback_;
+    void* context_;
+    std::unique_ptr<BatchRing> ring_;
+
+    std::mutex lock_;
+    std::unordered_map<int, FollowedFile> files_;
+    std::unordered_map<int, WatchedDirectory> directories_;
+    std::unordered_map<std::string, int> wdByDirectory_;
+    int nextId_ = 1;
+
+    int inotifyFd_ = -1;
+    int wakeFd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+};
+
+#endif
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* CreateLogFollower(LogLinesCallback callback, void* context, int ringBufferBytes) {
+#ifdef _WIN32
+    // No inotify; the panel tails logs on its Linux hosts
+    return NULL;
+#else
+    size_t ringBytes = ringBufferBytes > 0 ? static_cast<size_t>(ringBufferBytes) : 4 * 1024 * 1024;
+    auto* follower = new LogFollower(callback, context, ringBytes);
+    if (!follower->Start()) {
+        delete follower;
+        return NULL;
+    }
+    return follower;
+#endif
+}
+
+SUPERPANEL_API void DestroyLogFollower(void* follower) {
+#ifndef _WIN32
+    delete static_cast<LogFollower*>(follower);
+#endif
+}
+
+SUPERPANEL_API int AddFollowedFile(void* follower, const char* path, int fromEnd) {
+#ifdef _WIN32
+    return -1;
+#else
+    if (follower == NULL || path == NULL || path[0] == '\0') return -1;
+    return static_cast<LogFollower*>(follower)->Add(path, fromEnd != 0);
+#endif
+}
+
+SUPERPANEL_API int RemoveFollowedFile(void* follower, int fileId) {
+#ifdef _WIN32
+    return 0;
+#else
+    if (follower == NULL) return 0;
+    return static_cast<LogFollower*>(follower)->Remove(fileId) ? 1 : 0;
+#endif
+}
+
+SUPERPANEL_API int ReadLogBatches(void* follower, char* buffer, int bufferSize, long long* droppedBatches) {
+    if (droppedBatches != NULL) *droppedBatches = 0;
+#ifdef _WIN32
+    return 0;
+#else
+    if (follower == NULL || buffer == NULL || bufferSize <= 0) return 0;
+    return static_cast<LogFollower*>(follower)->ReadBatches(buffer, bufferSize, droppedBatches);
+#endif
+}
+
+} // extern "C"
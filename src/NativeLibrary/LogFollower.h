@@ -0,0 +1,33 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Receives one or more complete lines (each '\n'-terminated) appended to the
+// file registered under fileId. Called on the follower thread.
+typedef void (*LogLinesCallback)(int fileId, const char* lines, int length, void* context);
+
+extern "C" {
+    // Log tailing. One follower thread watches any number of files through
+    // inotify (one watch per parent directory), reads only appended bytes with
+    // pread, and follows rotation: when the path starts pointing at a new inode
+    // the old file is drained and the new one is read from the start; in-place
+    // truncation (copytruncate) restarts from offset 0.
+    //
+    // Lines go to `callback` when it is set; otherwise they are queued in a ring
+    // buffer of ringBufferBytes (oldest batches are dropped when it is full) and
+    // collected with ReadLogBatches.
+    SUPERPANEL_API void* CreateLogFollower(LogLinesCallback callback, void* context, int ringBufferBytes);
+    SUPERPANEL_API void DestroyLogFollower(void* follower);
+
+    // Starts following a file; fromEnd != 0 skips existing content (tail -f).
+    // The file does not have to exist yet. Returns a file id, or -1.
+    SUPERPANEL_API int AddFollowedFile(void* follower, const char* path, int fromEnd);
+    SUPERPANEL_API int RemoveFollowedFile(void* follower, int fileId);
+
+    // Copies whole queued batches into buffer as records of
+    // [int32 fileId][int32 length][length bytes of lines]. Returns bytes copied;
+    // *droppedBatches receives the number of batches lost to overflow since the
+    // previous call. A batch is at most about 1.1 MB, so a 2 MB buffer always
+    // has room for the next one.
+    SUPERPANEL_API int ReadLogBatches(void* follower, char* buffer, int bufferSize, long long* droppedBatches);
+}
@@ -0,0 +1,239 @@
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace superpanel {
+
+#ifndef _WIN32
+
+namespace {
+
+// Read lock-free by the signal handler. A slot is published by storing its
+// base last and retired by clearing it first.
+struct GuardSlot {
+    std::atomic<uintptr_t> base{0};
+    std::atomic<uint64_t> length{0};
+    std::atomic<std::atomic<bool>*> truncated{nullptr};
+};
+
+const size_t GuardSlotCount = 4096;
+GuardSlot guardSlots[GuardSlotCount];
+std::mutex guardLock; // Serializes claiming and retiring slots
+struct sigaction previousBusAction;
+uintptr_t guardPageSize;
+
+void OnBusError(int signal, siginfo_t* info, void* context) {
+    const uintptr_t address = reinterpret_cast<uintptr_t>(info->si_addr);
+    for (GuardSlot& slot : guardSlots) {
+        const uintptr_t base = slot.base.load(std::memory_order_acquire);
+        if (base == 0 || address < base || address - base >= slot.length.load(std::memory_order_relaxed)) continue;
+        // Zeros in place of the page the file lost; the faulting read resumes
+        void* page = reinterpret_cast<void*>(address & ~(guardPageSize - 1));
+        if (mmap(page, guardPageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) break;
+        slot.truncated.load(std::memory_order_relaxed)->store(true, std::memory_order_relaxed);
+        return;
+    }
+
+    // Not ours: whoever handled SIGBUS before (the .NET runtime) decides
+    if ((previousBusAction.sa_flags & SA_SIGINFO) != 0) {
+        previousBusAction.sa_sigaction(signal, info, context);
+    } else if (previousBusAction.sa_handler != SIG_DFL && previousBusAction.sa_handler != SIG_IGN) {
+        previousBusAction.sa_handler(signal);
+    } else {
+        // The faulting access repeats on return and takes the default action
+        struct sigaction defaultAction = {};
+        defaultAction.sa_handler = SIG_DFL;
+        sigaction(SIGBUS, &defaultAction, nullptr);
+    }
+}
+
+void InstallBusHandler() {
+    guardPageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    struct sigaction action = {};
+    action.sa_sigaction = OnBusError;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, &previousBusAction);
+}
+
+} // namespace
+
+bool GuardMapping(const void* base, uint64_t length, std::atomic<bool>* truncated) {
+    static std::once_flag installed;
+    std::call_once(installed, InstallBusHandler);
+    std::lock_guard<std::mutex> guard(guardLock);
+    for (GuardSlot& slot : guardSlots) {
+        if (slot.base.load(std::memory_order_relaxed) != 0) continue;
+        slot.length.store(length, std::memory_order_relaxed);
+        slot.truncated.store(truncated, std::memory_order_relaxed);
+        slot.base.store(reinterpret_cast<uintptr_t>(base), std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+void UnguardMapping(const void* base) {
+    std::lock_guard<std::mutex> guard(guardLock);
+    for (GuardSlot& slot : guardSlots) {
+        if (slot.base.load(std::memory_order_relaxed) == reinterpret_cast<uintptr_t>(base)) {
+            slot.base.store(0, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+#else
+
+bool GuardMapping(const void*, uint64_t, std::atomic<bool>*) {
+    return true;
+}
+
+void UnguardMapping(const void*) {}
+
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const char* path) {
+    Close();
+    if (path == nullptr) return false;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    file_ = file;
+#else
+    fd_ = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) return false;
+#endif
+
+    open_ = true;
+    if (!MapCurrentSize()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+    Unmap();
+#ifdef _WIN32
+    if (file_ != nullptr) CloseHandle(static_cast<HANDLE>(file_));
+    file_ = nullptr;
+#else
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+#endif
+    open_ = false;
+}
+
+bool MappedFile::Refresh() {
+    if (!open_) return false;
+
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(static_cast<HANDLE>(file_), &size)) return false;
+    uint64_t current = static_cast<uint64_t>(size.QuadPart);
+#else
+    struct stat st;
+    if (fstat(fd_, &st) != 0) return false;
+    uint64_t current = static_cast<uint64_t>(st.st_size);
+#endif
+
+    if (current == size_ && !Truncated()) return true;
+
+#if defined(__linux__)
+    // Grow or shrink in place where the kernel allows it. A truncated mapping
+    // has zero pages patched in, so it is mapped afresh instead.
+    if (data_ != nullptr && current > 0 && !Truncated()) {
+        UnguardMapping(data_);
+        void* moved = mremap(const_cast<char*>(data_), size_, current, MREMAP_MAYMOVE);
+        if (moved != MAP_FAILED) {
+            data_ = static_cast<const char*>(moved);
+            size_ = current;
+        }
+        if (moved != MAP_FAILED && GuardMapping(data_, size_, &truncated_)) return true;
+    }
+#endif
+
+    Unmap();
+    return MapCurrentSize();
+}
+
+bool MappedFile::MapCurrentSize() {
+    truncated_ = false;
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(static_cast<HANDLE>(file_), &size)) return false;
+    size_ = static_cast<uint64_t>(size.QuadPart);
+    if (size_ == 0) return true;
+
+    HANDLE mapping = CreateFileMappingA(static_cast<HANDLE>(file_), NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) return false;
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = static_cast<const char*>(view);
+#else
+    struct stat st;
+    if (fstat(fd_, &st) != 0) return false;
+    size_ = static_cast<uint64_t>(st.st_size);
+    if (size_ == 0) return true;
+
+    void* view = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        size_ = 0;
+        return false;
+    }
+    if (!GuardMapping(view, size_, &truncated_)) {
+        munmap(view, size_);
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const char*>(view);
+#endif
+    return true;
+}
+
+void MappedFile::Unmap() {
+#ifdef _WIN32
+    if (data_ != nullptr) UnmapViewOfFile(data_);
+    if (mapping_ != nullptr) CloseHandle(static_cast<HANDLE>(mapping_));
+    mapping_ = nullptr;
+#else
+    if (data_ != nullptr) {
+        UnguardMapping(data_);
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void MappedFile::AdviseSequential() const {
+#ifndef _WIN32
+    if (data_ != nullptr) madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::AdviseRandom() const {
+#ifndef _WIN32
+    if (data_ != nullptr) madvise(const_cast<char*>(data_), size_, MADV_RANDOM);
+#endif
+}
+
+} // namespace superpanel
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace superpanel {
+
+// Reading a mapped page that the file no longer covers, because another
+// process truncated it (logrotate's copytruncate), raises SIGBUS. A fault in
+// a guarded range gets a zero-filled page instead and sets *truncated, so the
+// reader can tell its data is stale and fail or remap. Returns false when
+// every guard slot is taken. No-ops on Windows, which refuses to truncate a
+// mapped file.
+bool GuardMapping(const void* base, uint64_t length, std::atomic<bool>* truncated);
+void UnguardMapping(const void* base);
+
+// Read-only mapping of a whole file that can be re-synced as the file grows
+// (logs) or shrinks (truncation). Keeps the file open, so a rename or rotation
+// of the path does not affect an open mapping. The mapping is guarded: if the
+// file shrinks under it, reads past the new end see zeros and Truncated()
+// turns true until the next Refresh.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+
+    // Re-reads the file size and remaps if it changed or the mapping was
+    // truncated. Returns false if the file can no longer be mapped.
+    bool Refresh();
+
+    // A read since the last (re)mapping went past the end of a file that
+    // shrank, and saw zeros; what it read must be discarded
+    bool Truncated() const { return truncated_.load(std::memory_order_relaxed); }
+
+    const char* Data() const { return data_; }
+    uint64_t Size() const { return size_; }
+    bool IsOpen() const { return open_; }
+
+    // Access pattern hints for the whole mapping
+    void AdviseSequential() const;
+    void AdviseRandom() const;
+
+private:
+    bool MapCurrentSize();
+    void Unmap();
+
+    bool open_ = false;
+    const char* data_ = nullptr;
+    uint64_t size_ = 0;
+    std::atomic<bool> truncated_{false};
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace superpanel
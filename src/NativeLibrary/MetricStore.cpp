@@ -0,0 +1,993 @@
+#include "pch.h"
+#include "MetricStore.h"
+#include "BackupFiles.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using superpanel::OpenFile;
+using superpanel::ReadWholeFile;
+using superpanel::ReplaceFile;
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint32_t StoreMagic = 0x53545053; // "SPTS"
+const uint32_t StoreVersion = 1;
+
+// Block 0 holds the file header; the rest each hold one series' samples in
+// time order. A block is in use while its count is non-zero.
+const uint32_t BlockSize = 4096;
+
+struct StoreHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t blockSize;
+    uint32_t reserved[13];
+};
+
+struct BlockHeader {
+    uint32_t seriesId;
+    uint32_t count;
+    uint32_t bitLength;
+    uint32_t tier;     // METRIC_TIER_*
+    int64_t firstTs;
+    int64_t lastTs;
+    uint64_t reserved[4];
+};
+
+static_assert(sizeof(StoreHeader) == 64, "store header layout");
+static_assert(sizeof(BlockHeader) == 64, "block header layout");
+
+const uint32_t PayloadBytes = BlockSize - sizeof(BlockHeader);
+// The bit writer and reader move whole 64-bit words: the slack keeps them
+// inside the payload. Records never start later than MaxRecordBits before
+// the end, and the decoder stops at a damaged one that does, so it never
+// reads further than the writer writes.
+const uint32_t PayloadBits = (PayloadBytes - 24) * 8;
+// Rollup records hold min, max, sum, count and last
+const int RollupFields = 5;
+// Raw blocks hold the most records: 128 bits for the first, 2 for the rest
+const size_t MaxBlockSamples = (PayloadBits - 128) / 2 + 1;
+
+// '1111' + 32-bit delta-of-delta, then per field '11' + 5 + 6 bits of
+// window + 64 bits
+uint32_t MaxRecordBits(int fields) {
+    return 36 + static_cast<uint32_t>(fields) * (13 + 64);
+}
+
+uint64_t ByteSwap(uint64_t value) {
+#ifdef _MSC_VER
+    return _byteswap_uint64(value);
+#else
+    return __builtin_bswap64(value);
+#endif
+}
+
+int LeadingZeros(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<uint32_t>(value >> 32))) return 31 - static_cast<int>(index);
+    _BitScanReverse(&index, static_cast<uint32_t>(value));
+    return 63 - static_cast<int>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<int>(index);
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+int TrailingZeros(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<uint32_t>(value))) return static_cast<int>(index);
+    _BitScanForward(&index, static_cast<uint32_t>(value >> 32));
+    return static_cast<int>(index) + 32;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+// The bit stream is most significant bit first, so a big-endian load of the
+// word at a position's byte puts the next bits at the top
+uint64_t PeekBits(const uint8_t* payload, uint32_t position) {
+    uint64_t word;
+    memcpy(&word, payload + (position >> 3), sizeof(word));
+    return ByteSwap(word) << (position & 7); // At least 57 valid bits
+}
+
+uint64_t TakeBits(const uint8_t* payload, uint32_t& position, int bits) {
+    if (bits > 56) {
+        uint64_t high = TakeBits(payload, position, bits - 32);
+        return (high << 32) | TakeBits(payload, position, 32);
+    }
+    uint64_t value = PeekBits(payload, position) >> (64 - bits);
+    position += bits;
+    return value;
+}
+
+// The payload past position must be zero
+void PutBits(uint8_t* payload, uint32_t& position, uint64_t value, int bits) {
+    if (bits > 56) {
+        PutBits(payload, position, value >> 32, bits - 32);
+        value &= 0xFFFFFFFFULL;
+        bits = 32;
+    }
+    uint8_t* target = payload + (position >> 3);
+    uint64_t word;
+    memcpy(&word, target, sizeof(word));
+    word = ByteSwap(ByteSwap(word) | ((value << (64 - bits)) >> (position & 7)));
+    memcpy(target, &word, sizeof(word));
+    position += bits;
+}
+
+// One XOR-coded column. leading and trailing are the zero runs around the
+// last XOR written with its own window; 64 means none yet.
+struct FieldState {
+    uint64_t bits = 0;
+    int leading = 64;
+    int trailing = 64;
+};
+
+// Where the previous record left a block's encoder or decoder. Raw blocks
+// have one field (the value); rollup blocks have RollupFields.
+struct GorillaState {
+    int64_t timestamp = 0;
+    int64_t delta = 0;
+    FieldState fields[RollupFields];
+};
+
+// Delta-of-delta widths after a prefix of 0-4 one bits. Values are
+// zigzag-encoded so small negative jitter stays small.
+const int DeltaWidths[5] = {0, 7, 9, 12, 32};
+
+void StartBlock(uint8_t* payload, uint32_t& position, GorillaState& state, int64_t timestamp, const uint64_t* fields, int fieldCount) {
+    state = GorillaState();
+    PutBits(payload, position, static_cast<uint64_t>(timestamp), 64);
+    state.timestamp = timestamp;
+    for (int i = 0; i < fieldCount; i++) {
+        PutBits(payload, position, fields[i], 64);
+        state.fields[i].bits = fields[i];
+    }
+}
+
+bool FitsBlock(const GorillaState& state, int64_t timestamp) {
+    const int64_t deltaOfDelta = (timestamp - state.timestamp) - state.delta;
+    return deltaOfDelta >= INT32_MIN && deltaOfDelta <= INT32_MAX;
+}
+
+void EncodeValue(uint8_t* payload, uint32_t& position, FieldState& field, uint64_t bits) {
+    const uint64_t xored = bits ^ field.bits;
+    field.bits = bits;
+    if (xored == 0) {
+        PutBits(payload, position, 0, 1);
+        return;
+    }
+    const int leading = std::min(LeadingZeros(xored), 31);
+    const int trailing = TrailingZeros(xored);
+    if (leading >= field.leading && trailing >= field.trailing) {
+        // Fits the previous window: its meaningful bits only
+        PutBits(payload, position, 0x2, 2);
+        PutBits(payload, position, xored >> field.trailing, 64 - field.leading - field.trailing);
+        return;
+    }
+    const int length = 64 - leading - trailing;
+    PutBits(payload, position, (0x3ULL << 11) | (static_cast<uint64_t>(leading) << 6) | static_cast<uint64_t>(length & 63), 13);
+    PutBits(payload, position, xored >> trailing, length);
+    field.leading = leading;
+    field.trailing = trailing;
+}
+
+void EncodeRecord(uint8_t* payload, uint32_t& position, GorillaState& state, int64_t timestamp, const uint64_t* fields, int fieldCount) {
+    const int64_t delta = timestamp - state.timestamp;
+    const int64_t deltaOfDelta = delta - state.delta;
+    const uint64_t zigzag = (static_cast<uint64_t>(deltaOfDelta) << 1) ^ static_cast<uint64_t>(deltaOfDelta >> 63);
+    if (zigzag == 0) {
+        PutBits(payload, position, 0, 1);
+    } else if (zigzag < (1ULL << 7)) {
+        PutBits(payload, position, (0x2ULL << 7) | zigzag, 9);
+    } else if (zigzag < (1ULL << 9)) {
+        PutBits(payload, position, (0x6ULL << 9) | zigzag, 12);
+    } else if (zigzag < (1ULL << 12)) {
+        PutBits(payload, position, (0xEULL << 12) | zigzag, 16);
+    } else {
+        PutBits(payload, position, (0xFULL << 32) | zigzag, 36);
+    }
+    state.timestamp = timestamp;
+    state.delta = delta;
+    for (int i = 0; i < fieldCount; i++) EncodeValue(payload, position, state.fields[i], fields[i]);
+}
+
+// False for a damaged stream (a window reused before one was set, or one
+// wider than 64 bits)
+bool DecodeValue(const uint8_t* payload, uint32_t& position, FieldState& field) {
+    const uint64_t word = PeekBits(payload, position);
+    if ((word >> 63) == 0) {
+        position++;
+        return true;
+    }
+    if ((word >> 62) & 1) {
+        field.leading = static_cast<int>((word >> 57) & 31);
+        int length = static_cast<int>((word >> 51) & 63);
+        if (length == 0) length = 64;
+        field.trailing = 64 - field.leading - length;
+        position += 13;
+    } else {
+        position += 2;
+    }
+    if (field.trailing < 0 || field.leading + field.trailing >= 64) return false;
+    field.bits ^= TakeBits(payload, position, 64 - field.leading - field.trailing) << field.trailing;
+    return true;
+}
+
+// Decodes a whole block into timestamps and Fields value columns, leaving
+// state at its last record. The loop has no per-field branches for
+// timestamps (the prefix length is a leading-ones count and a table
+// lookup) and only the three-way control branch for values; Fields is a
+// template argument so the raw one-column case is unrolled. Returns the
+// records decoded, which is less than the header's count only for a
+// damaged block.
+template <int Fields>
+size_t DecodeBlock(const BlockHeader& header, const uint8_t* payload, int64_t* timestamps, double* const* columns, GorillaState& state) {
+    if (header.count == 0 || header.bitLength < 64 * (1 + Fields) || header.bitLength > PayloadBits) return 0;
+    uint32_t position = 0;
+    GorillaState current;
+    current.timestamp = static_cast<int64_t>(TakeBits(payload, position, 64));
+    timestamps[0] = current.timestamp;
+    for (int i = 0; i < Fields; i++) {
+        current.fields[i].bits = TakeBits(payload, position, 64);
+        memcpy(&columns[i][0], &current.fields[i].bits, sizeof(uint64_t));
+    }
+
+    const uint32_t end = header.bitLength;
+    const uint32_t lastStart = PayloadBits - MaxRecordBits(Fields);
+    size_t decoded = 1;
+    for (; decoded < header.count && position < end && position <= lastStart; decoded++) {
+        const uint64_t word = PeekBits(payload, position);
+        const int ones = LeadingZeros(~word | (1ULL << 59)); // At most 4
+        const int prefix = ones + (ones < 4 ? 1 : 0);
+        const int width = DeltaWidths[ones];
+        const uint64_t zigzag = ((word << prefix) >> 1) >> (63 - width);
+        position += prefix + width;
+        current.delta += static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        current.timestamp += current.delta;
+
+        bool intact = true;
+        for (int i = 0; i < Fields; i++) intact = intact && DecodeValue(payload, position, current.fields[i]);
+        if (!intact || position > end) break;
+        timestamps[decoded] = current.timestamp;
+        for (int i = 0; i < Fields; i++) memcpy(&columns[i][decoded], &current.fields[i].bits, sizeof(uint64_t));
+    }
+
+    // A damaged record may have advanced the state past the last one kept
+    state = current;
+    state.timestamp = timestamps[decoded - 1];
+    state.delta = decoded > 1 ? state.timestamp - timestamps[decoded - 2] : 0;
+    for (int i = 0; i < Fields; i++) memcpy(&state.fields[i].bits, &columns[i][decoded - 1], sizeof(uint64_t));
+    return decoded;
+}
+
+// Read-write mapping of the block file, grown in whole blocks. The file is
+// locked for the life of the mapping.
+class BlockFile {
+public:
+    BlockFile() = default;
+    ~BlockFile() { Close(); }
+
+    BlockFile(const BlockFile&) = delete;
+    BlockFile& operator=(const BlockFile&) = delete;
+
+    bool Open(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileW(fs::u8path(path).wstring().c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                                  OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        file_ = file;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) return false;
+        return Map(static_cast<uint64_t>(size.QuadPart));
+#else
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ < 0 || flock(fd_, LOCK_EX | LOCK_NB) != 0) return false;
+        struct stat st;
+        if (fstat(fd_, &st) != 0) return false;
+        return Map(static_cast<uint64_t>(st.st_size));
+#endif
+    }
+
+    void Close() {
+        Unmap();
+#ifdef _WIN32
+        if (file_ != nullptr) CloseHandle(static_cast<HANDLE>(file_));
+        file_ = nullptr;
+#else
+        if (fd_ >= 0) close(fd_);
+        fd_ = -1;
+#endif
+    }
+
+    // Pointers into the mapping are invalid afterwards
+    bool Resize(uint64_t size) {
+#ifdef _WIN32
+        Unmap();
+        LARGE_INTEGER target;
+        target.QuadPart = static_cast<LONGLONG>(size);
+        const bool resized = SetFilePointerEx(static_cast<HANDLE>(file_), target, NULL, FILE_BEGIN) &&
+                             SetEndOfFile(static_cast<HANDLE>(file_));
+        // Remapped at whatever size the file has, so a failed grow keeps the old blocks
+        LARGE_INTEGER current;
+        if (!GetFileSizeEx(static_cast<HANDLE>(file_), &current)) return false;
+        return Map(static_cast<uint64_t>(current.QuadPart)) && resized;
+#else
+        if (ftruncate(fd_, static_cast<off_t>(size)) != 0) return false;
+#if defined(__linux__)
+        if (data_ != nullptr) {
+            void* moved = mremap(data_, size_, size, MREMAP_MAYMOVE);
+            if (moved != MAP_FAILED) {
+                data_ = static_cast<char*>(moved);
+                size_ = size;
+                return true;
+            }
+        }
+#endif
+        Unmap();
+        return Map(size);
+#endif
+    }
+
+    bool Flush() {
+        if (data_ == nullptr) return true;
+#ifdef _WIN32
+        return FlushViewOfFile(data_, 0) && FlushFileBuffers(static_cast<HANDLE>(file_));
+#else
+        return msync(data_, size_, MS_SYNC) == 0;
+#endif
+    }
+
+    char* Data() const { return data_; }
+    uint64_t Size() const { return size_; }
+
+private:
+    bool Map(uint64_t size) {
+        size_ = size;
+        if (size == 0) return true;
+#ifdef _WIN32
+        HANDLE mapping = CreateFileMappingW(static_cast<HANDLE>(file_), NULL, PAGE_READWRITE, 0, 0, NULL);
+        if (mapping == NULL) return false;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+        if (view == NULL) {
+            CloseHandle(mapping);
+            return false;
+        }
+        mapping_ = mapping;
+#else
+        void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (view == MAP_FAILED) {
+            size_ = 0;
+            return false;
+        }
+#endif
+        data_ = static_cast<char*>(view);
+        return true;
+    }
+
+    void Unmap() {
+#ifdef _WIN32
+        if (data_ != nullptr) UnmapViewOfFile(data_);
+        if (mapping_ != nullptr) CloseHandle(static_cast<HANDLE>(mapping_));
+        mapping_ = nullptr;
+#else
+        if (data_ != nullptr) munmap(data_, size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    char* data_ = nullptr;
+    uint64_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+const int64_t TierWidths[METRIC_TIER_COUNT] = {0, 60 * 1000, 5 * 60 * 1000, 60 * 60 * 1000};
+
+int FieldsOf(uint32_t tier) {
+    return tier == METRIC_TIER_RAW ? 1 : RollupFields;
+}
+
+int64_t FloorTo(int64_t value, int64_t step) {
+    int64_t quotient = value / step;
+    if (value % step != 0 && value < 0) quotient--;
+    return quotient * step;
+}
+
+// A rollup tier's open bucket, or a step being assembled by a query
+struct Bucket {
+    int64_t start = 0;
+    uint64_t count = 0; // 0 while empty
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    double last = 0;
+
+    void Add(double addedMin, double addedMax, double addedSum, uint64_t addedCount, double addedLast) {
+        if (count == 0) {
+            min = addedMin;
+            max = addedMax;
+        } else {
+            min = std::min(min, addedMin);
+            max = std::max(max, addedMax);
+        }
+        sum += addedSum;
+        count += addedCount;
+        last = addedLast;
+    }
+};
+
+struct Tier {
+    std::vector<uint32_t> blocks; // Oldest first; the last is appended to
+    GorillaState state;
+    Bucket open; // Rollup tiers only
+};
+
+struct Series {
+    std::string name;
+    Tier tiers[METRIC_TIER_COUNT];
+};
+
+class Store {
+public:
+    ~Store() { Close(); }
+
+    bool Open(const std::string& directory, const int64_t* retentionMs);
+    void Close();
+    bool Flush();
+
+    int SeriesId(const std::string& name, bool create);
+    int Append(int seriesId, const long long* timestamps, const double* values, int count);
+    int Query(int seriesId, int64_t fromMs, int64_t toMs, long long* timestamps, double* values, int maxCount);
+    int QueryRollups(int seriesId, int64_t fromMs, int64_t toMs, int64_t stepMs, MetricRollup* rollups, int maxCount, int* tierUsed);
+    void Stats(MetricStoreStats& stats);
+
+private:
+    uint64_t BlockCount() const { return file_.Size() / BlockSize - 1; }
+    BlockHeader* HeaderOf(uint32_t block) { return reinterpret_cast<BlockHeader*>(file_.Data() + (static_cast<uint64_t>(block) + 1) * BlockSize); }
+    uint8_t* PayloadOf(uint32_t block) { return reinterpret_cast<uint8_t*>(HeaderOf(block)) + sizeof(BlockHeader); }
+
+    // Into the scratch buffers
+    size_t DecodeScratch(uint32_t tier, uint32_t block, GorillaState& state);
+    // Calls visit(start, min, max, sum, count, last) for each record (each
+    // non-NaN sample of the raw tier) with fromMs <= start < toMs, in order,
+    // until it returns false
+    template <typename Visitor>
+    void VisitTier(const Tier& tier, uint32_t tierIndex, int64_t fromMs, int64_t toMs, Visitor visit);
+
+    bool LoadSeries();
+    bool LoadBlocks();
+    void RebuildOpenBuckets(Series& series);
+    bool AllocateBlock(uint32_t& block);
+    void Expire();
+    bool AppendRecord(Series& series, uint32_t tierIndex, int64_t timestamp, const uint64_t* fields);
+    bool Roll(Series& series, int64_t timestamp, double value);
+
+    std::mutex lock_;
+    std::string directory_;
+    int64_t retentionMs_[METRIC_TIER_COUNT] = {};
+    int64_t newest_ = INT64_MIN;
+    BlockFile file_;
+    FILE* catalog_ = nullptr;
+    std::vector<Series> series_;
+    std::unordered_map<std::string, int> ids_;
+    std::vector<uint32_t> free_; // Popped from the back, lowest first
+    // A block decoded whole when a query only wants part of it
+    std::vector<int64_t> scratchTimestamps_;
+    std::vector<double> scratchColumns_[RollupFields];
+};
+
+bool Store::Open(const std::string& directory, const int64_t* retentionMs) {
+    directory_ = directory;
+    for (int i = 0; i < METRIC_TIER_COUNT; i++) retentionMs_[i] = std::max<int64_t>(retentionMs[i], 0);
+    std::error_code ec;
+    fs::create_directories(fs::u8path(directory), ec);
+    if (ec) return false;
+
+    if (!file_.Open((fs::u8path(directory) / "samples.dat").u8string())) return false;
+    if (file_.Size() == 0) {
+        if (!file_.Resize(BlockSize)) return false;
+        StoreHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = StoreMagic;
+        header.version = StoreVersion;
+        header.blockSize = BlockSize;
+        memcpy(file_.Data(), &header, sizeof(header));
+    }
+    StoreHeader header;
+    if (file_.Size() < BlockSize || file_.Size() % BlockSize != 0) return false;
+    memcpy(&header, file_.Data(), sizeof(header));
+    if (header.magic != StoreMagic || header.version != StoreVersion || header.blockSize != BlockSize) return false;
+
+    scratchTimestamps_.resize(MaxBlockSamples);
+    for (std::vector<double>& column : scratchColumns_) column.resize(MaxBlockSamples);
+    return LoadSeries() && LoadBlocks();
+}
+
+void Store::Close() {
+    std::lock_guard<std::mutex> guard(lock_);
+    file_.Flush();
+    file_.Close();
+    if (catalog_ != nullptr) fclose(catalog_);
+    catalog_ = nullptr;
+}
+
+bool Store::Flush() {
+    std::lock_guard<std::mutex> guard(lock_);
+    return file_.Flush();
+}
+
+size_t Store::DecodeScratch(uint32_t tier, uint32_t block, GorillaState& state) {
+    double* columns[RollupFields];
+    for (int i = 0; i < RollupFields; i++) columns[i] = scratchColumns_[i].data();
+    const BlockHeader& header = *HeaderOf(block);
+    if (tier == METRIC_TIER_RAW) return DecodeBlock<1>(header, PayloadOf(block), scratchTimestamps_.data(), columns, state);
+    return DecodeBlock<RollupFields>(header, PayloadOf(block), scratchTimestamps_.data(), columns, state);
+}
+
+template <typename Visitor>
+void Store::VisitTier(const Tier& tier, uint32_t tierIndex, int64_t fromMs, int64_t toMs, Visitor visit) {
+    // Blocks are in time order, so the first one reaching fromMs is found
+    // by bisection and the scan stops at the first starting at toMs
+    auto it = std::partition_point(tier.blocks.begin(), tier.blocks.end(), [&](uint32_t block) { return HeaderOf(block)->lastTs < fromMs; });
+    GorillaState state;
+    for (; it != tier.blocks.end() && HeaderOf(*it)->firstTs < toMs; ++it) {
+        const size_t decoded = DecodeScratch(tierIndex, *it, state);
+        const int64_t* timestamps = scratchTimestamps_.data();
+        const size_t first = std::lower_bound(timestamps, timestamps + decoded, fromMs) - timestamps;
+        const size_t last = std::lower_bound(timestamps, timestamps + decoded, toMs) - timestamps;
+        if (tierIndex == METRIC_TIER_RAW) {
+            const double* values = scratchColumns_[0].data();
+            for (size_t i = first; i < last; i++) {
+                if (values[i] != values[i]) continue; // NaN
+                if (!visit(timestamps[i], values[i], values[i], values[i], 1, values[i])) return;
+            }
+            continue;
+        }
+        const double* mins = scratchColumns_[0].data();
+        const double* maxes = scratchColumns_[1].data();
+        const double* sums = scratchColumns_[2].data();
+        const double* counts = scratchColumns_[3].data();
+        const double* lasts = scratchColumns_[4].data();
+        for (size_t i = first; i < last; i++) {
+            if (!visit(timestamps[i], mins[i], maxes[i], sums[i], static_cast<uint64_t>(counts[i]), lasts[i])) return;
+        }
+    }
+}
+
+bool Store::LoadSeries() {
+    // One name per line; the line number is the id
+    const std::string path = (fs::u8path(directory_) / "series").u8string();
+    std::string contents;
+    if (ReadWholeFile(path, contents)) {
+        size_t start = 0;
+        for (size_t end; (end = contents.find('\n', start)) != std::string::npos; start = end + 1) {
+            Series series;
+            series.name = contents.substr(start, end - start);
+            ids_.emplace(series.name, static_cast<int>(series_.size()));
+            series_.push_back(std::move(series));
+        }
+        // A name cut short by a crash was never used by a block
+        if (start != contents.size() && !ReplaceFile(path, contents.substr(0, start))) return false;
+    }
+    catalog_ = OpenFile(path, "ab");
+    return catalog_ != nullptr;
+}
+
+bool Store::LoadBlocks() {
+    const uint64_t blockCount = BlockCount();
+    if (blockCount > UINT32_MAX) return false;
+    for (uint32_t block = static_cast<uint32_t>(blockCount); block-- > 0;) {
+        BlockHeader* header = HeaderOf(block);
+        if (header->count == 0 || header->seriesId >= series_.size() || header->tier >= METRIC_TIER_COUNT ||
+            header->bitLength < 64u * (1 + FieldsOf(header->tier)) || header->bitLength > PayloadBits) {
+            memset(header, 0, BlockSize);
+            free_.push_back(block);
+            continue;
+        }
+        series_[header->seriesId].tiers[header->tier].blocks.push_back(block);
+    }
+
+    for (Series& series : series_) {
+        for (uint32_t tierIndex = 0; tierIndex < METRIC_TIER_COUNT; tierIndex++) {
+            Tier& tier = series.tiers[tierIndex];
+            if (tier.blocks.empty()) continue;
+            std::sort(tier.blocks.begin(), tier.blocks.end(), [this](uint32_t a, uint32_t b) {
+                const BlockHeader* first = HeaderOf(a);
+                const BlockHeader* second = HeaderOf(b);
+                return first->firstTs != second->firstTs ? first->firstTs < second->firstTs : a < b;
+            });
+
+            // Resume the encoder where the last block ends. Anything a crash
+            // left past its recorded length is cleared, as appends OR bits in.
+            const uint32_t last = tier.blocks.back();
+            BlockHeader* header = HeaderOf(last);
+            uint8_t* payload = PayloadOf(last);
+            const size_t decoded = DecodeScratch(tierIndex, last, tier.state);
+            if (decoded == 0) {
+                memset(header, 0, BlockSize);
+                free_.push_back(last);
+                tier.blocks.pop_back();
+                tier.state = GorillaState();
+                continue;
+            }
+            if (decoded < header->count) {
+                // Damaged tail: keep what decoded and re-encode from there
+                const int fieldCount = FieldsOf(tierIndex);
+                header->count = static_cast<uint32_t>(decoded);
+                header->lastTs = scratchTimestamps_[decoded - 1];
+                memset(payload, 0, PayloadBytes);
+                uint32_t position = 0;
+                uint64_t fields[RollupFields];
+                for (size_t i = 0; i < decoded; i++) {
+                    for (int f = 0; f < fieldCount; f++) memcpy(&fields[f], &scratchColumns_[f][i], sizeof(uint64_t));
+                    if (i == 0) {
+                        StartBlock(payload, position, tier.state, scratchTimestamps_[i], fields, fieldCount);
+                    } else {
+                        EncodeRecord(payload, position, tier.state, scratchTimestamps_[i], fields, fieldCount);
+                    }
+                }
+                header->bitLength = position;
+            }
+            const uint32_t length = header->bitLength;
+            if (length % 8 != 0) payload[length / 8] &= static_cast<uint8_t>(0xFF00 >> (length % 8));
+            memset(payload + (length + 7) / 8, 0, PayloadBytes - (length + 7) / 8);
+            if (tierIndex == METRIC_TIER_RAW) newest_ = std::max(newest_, header->lastTs);
+        }
+        RebuildOpenBuckets(series);
+    }
+    std::sort(free_.begin(), free_.end(), std::greater<uint32_t>());
+    return true;
+}
+
+void Store::RebuildOpenBuckets(Series& series) {
+    const Tier& raw = series.tiers[METRIC_TIER_RAW];
+    if (raw.blocks.empty()) return;
+    const int64_t latest = raw.state.timestamp;
+
+    // Finest first, so each tier's open bucket is there for the next
+    for (uint32_t tierIndex = METRIC_TIER_1M; tierIndex < METRIC_TIER_COUNT; tierIndex++) {
+        Tier& tier = series.tiers[tierIndex];
+        Bucket bucket;
+        bucket.start = FloorTo(latest, TierWidths[tierIndex]);
+        tier.open = Bucket();
+        // Already closed: a crash came between closing it and appending the
+        // raw sample that did
+        if (!tier.blocks.empty() && tier.state.timestamp >= bucket.start) continue;
+
+        const Tier& finer = series.tiers[tierIndex - 1];
+        VisitTier(finer, tierIndex - 1, bucket.start, INT64_MAX, [&](int64_t, double min, double max, double sum, uint64_t count, double last) {
+            bucket.Add(min, max, sum, count, last);
+            return true;
+        });
+        if (tierIndex - 1 != METRIC_TIER_RAW && finer.open.count != 0 && finer.open.start >= bucket.start) {
+            bucket.Add(finer.open.min, finer.open.max, finer.open.sum, finer.open.count, finer.open.last);
+        }
+        if (bucket.count != 0) tier.open = bucket;
+    }
+}
+
+int Store::SeriesId(const std::string& name, bool create) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto found = ids_.find(name);
+    if (found != ids_.end()) return found->second;
+    if (!create || name.empty() || name.find('\n') != std::string::npos || series_.size() >= INT32_MAX) return -1;
+
+    const std::string line = name + '\n';
+    if (fwrite(line.data(), 1, line.size(), catalog_) != line.size() || fflush(catalog_) != 0) return -1;
+    const int id = static_cast<int>(series_.size());
+    Series series;
+    series.name = name;
+    series_.push_back(std::move(series));
+    ids_.emplace(name, id);
+    return id;
+}
+
+bool Store::AllocateBlock(uint32_t& block) {
+    if (free_.empty()) Expire();
+    if (free_.empty()) {
+        // Double the file, by at most 16 MB at a time
+        const uint64_t blockCount = BlockCount();
+        const uint64_t added = std::max<uint64_t>(64, std::min<uint64_t>(blockCount, 4096));
+        if (blockCount + added > UINT32_MAX) return false;
+        if (!file_.Resize((blockCount + added + 1) * BlockSize)) return false;
+        for (uint64_t next = blockCount + added; next-- > blockCount;) free_.push_back(static_cast<uint32_t>(next));
+    }
+    block = free_.back();
+    free_.pop_back();
+    return true;
+}
+
+void Store::Expire() {
+    for (Series& series : series_) {
+        const Tier& raw = series.tiers[METRIC_TIER_RAW];
+        for (uint32_t tierIndex = 0; tierIndex < METRIC_TIER_COUNT; tierIndex++) {
+            if (retentionMs_[tierIndex] == 0) continue;
+            int64_t cutoff = newest_ - retentionMs_[tierIndex];
+            // What the next tier needs to rebuild its open bucket stays
+            if (tierIndex + 1 < METRIC_TIER_COUNT && !raw.blocks.empty()) {
+                cutoff = std::min(cutoff, FloorTo(raw.state.timestamp, TierWidths[tierIndex + 1]));
+            }
+
+            // The block being appended to is kept, however old
+            std::vector<uint32_t>& blocks = series.tiers[tierIndex].blocks;
+            size_t expired = 0;
+            while (expired + 1 < blocks.size() && HeaderOf(blocks[expired])->lastTs < cutoff) {
+                memset(HeaderOf(blocks[expired]), 0, BlockSize);
+                free_.push_back(blocks[expired]);
+                expired++;
+            }
+            blocks.erase(blocks.begin(), blocks.begin() + expired);
+        }
+    }
+    std::sort(free_.begin(), free_.end(), std::greater<uint32_t>());
+}
+
+bool Store::AppendRecord(Series& series, uint32_t tierIndex, int64_t timestamp, const uint64_t* fields) {
+    Tier& tier = series.tiers[tierIndex];
+    const int fieldCount = FieldsOf(tierIndex);
+    if (!tier.blocks.empty()) {
+        const uint32_t block = tier.blocks.back();
+        BlockHeader* header = HeaderOf(block);
+        if (header->bitLength + MaxRecordBits(fieldCount) <= PayloadBits && FitsBlock(tier.state, timestamp)) {
+            uint32_t position = header->bitLength;
+            EncodeRecord(PayloadOf(block), position, tier.state, timestamp, fields, fieldCount);
+            // Length and count last, so a crash mid-record leaves the block as it was
+            header->bitLength = position;
+            header->lastTs = timestamp;
+            header->count++;
+            return true;
+        }
+    }
+
+    uint32_t block;
+    if (!AllocateBlock(block)) return false;
+    BlockHeader* header = HeaderOf(block);
+    uint32_t position = 0;
+    StartBlock(PayloadOf(block), position, tier.state, timestamp, fields, fieldCount);
+    header->seriesId = static_cast<uint32_t>(&series - series_.data());
+    header->tier = tierIndex;
+    header->firstTs = timestamp;
+    header->lastTs = timestamp;
+    header->bitLength = position;
+    header->count = 1;
+    tier.blocks.push_back(block);
+    return true;
+}
+
+bool Store::Roll(Series& series, int64_t timestamp, double value) {
+    for (uint32_t tierIndex = METRIC_TIER_1M; tierIndex < METRIC_TIER_COUNT; tierIndex++) {
+        Bucket& open = series.tiers[tierIndex].open;
+        const int64_t width = TierWidths[tierIndex];
+        if (open.count != 0 && timestamp >= open.start + width) {
+            const double closed[RollupFields] = {open.min, open.max, open.sum, static_cast<double>(open.count), open.last};
+            uint64_t fields[RollupFields];
+            memcpy(fields, closed, sizeof(fields));
+            if (!AppendRecord(series, tierIndex, open.start, fields)) return false;
+            open = Bucket();
+        }
+        if (value != value) continue; // NaN: stored raw, left out of rollups
+        if (open.count == 0) open.start = FloorTo(timestamp, width);
+        open.Add(value, value, value, 1, value);
+    }
+    return true;
+}
+
+int Store::Append(int seriesId, const long long* timestamps, const double* values, int count) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (seriesId < 0 || static_cast<size_t>(seriesId) >= series_.size()) return -1;
+    Series& series = series_[seriesId];
+    const Tier& raw = series.tiers[METRIC_TIER_RAW];
+    int appended = 0;
+    for (int i = 0; i < count; i++) {
+        if (!raw.blocks.empty() && timestamps[i] < raw.state.timestamp) continue;
+        newest_ = std::max<int64_t>(newest_, timestamps[i]);
+        // Rollups first: a crash between the two leaves a bucket closed
+        // without the sample that closed it, which reopening handles
+        if (!Roll(series, timestamps[i], values[i])) break;
+        uint64_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        if (!AppendRecord(series, METRIC_TIER_RAW, timestamps[i], &bits)) break;
+        appended++;
+    }
+    return appended;
+}
+
+int Store::Query(int seriesId, int64_t fromMs, int64_t toMs, long long* timestamps, double* values, int maxCount) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (seriesId < 0 || static_cast<size_t>(seriesId) >= series_.size()) return -1;
+    const std::vector<uint32_t>& blocks = series_[seriesId].tiers[METRIC_TIER_RAW].blocks;
+
+    auto it = std::partition_point(blocks.begin(), blocks.end(), [&](uint32_t block) { return HeaderOf(block)->lastTs < fromMs; });
+    size_t copied = 0;
+    const size_t limit = static_cast<size_t>(std::max(maxCount, 0));
+    GorillaState state;
+    for (; it != blocks.end() && copied < limit; ++it) {
+        const BlockHeader& header = *HeaderOf(*it);
+        if (header.firstTs >= toMs) break;
+        if (header.firstTs >= fromMs && header.lastTs < toMs && header.count <= limit - copied) {
+            // Wholly inside: straight into the caller's buffers
+            static_assert(sizeof(long long) == sizeof(int64_t), "timestamp layout");
+            double* columns[1] = {values + copied};
+            copied += DecodeBlock<1>(header, PayloadOf(*it), reinterpret_cast<int64_t*>(timestamps + copied), columns, state);
+            continue;
+        }
+        const size_t decoded = DecodeScratch(METRIC_TIER_RAW, *it, state);
+        const int64_t* begin = scratchTimestamps_.data();
+        const size_t first = std::lower_bound(begin, begin + decoded, fromMs) - begin;
+        const size_t last = std::lower_bound(begin, begin + decoded, toMs) - begin;
+        const size_t take = std::min(last - first, limit - copied);
+        memcpy(timestamps + copied, begin + first, take * sizeof(int64_t));
+        memcpy(values + copied, scratchColumns_[0].data() + first, take * sizeof(double));
+        copied += take;
+    }
+    return static_cast<int>(copied);
+}
+
+int Store::QueryRollups(int seriesId, int64_t fromMs, int64_t toMs, int64_t stepMs, MetricRollup* rollups, int maxCount, int* tierUsed) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (seriesId < 0 || static_cast<size_t>(seriesId) >= series_.size() || stepMs <= 0) return -1;
+
+    // Rollups are assigned to steps whole, so a tier only fits if its
+    // buckets never straddle a step boundary: its width must divide stepMs
+    uint32_t tierIndex = METRIC_TIER_RAW;
+    for (uint32_t candidate = METRIC_TIER_COUNT - 1; candidate > METRIC_TIER_RAW; candidate--) {
+        if (stepMs % TierWidths[candidate] == 0) {
+            tierIndex = candidate;
+            break;
+        }
+    }
+    if (tierUsed != nullptr) *tierUsed = static_cast<int>(tierIndex);
+
+    const size_t limit = static_cast<size_t>(std::max(maxCount, 0));
+    size_t copied = 0;
+    Bucket step;
+    auto emit = [&]() {
+        MetricRollup& rollup = rollups[copied++];
+        rollup.startMs = step.start;
+        rollup.count = static_cast<long long>(step.count);
+        rollup.min = step.min;
+        rollup.max = step.max;
+        rollup.avg = step.sum / static_cast<double>(step.count);
+        rollup.last = step.last;
+        step = Bucket();
+    };
+    auto add = [&](int64_t start, double min, double max, double sum, uint64_t count, double last) {
+        const int64_t stepStart = FloorTo(start, stepMs);
+        if (step.count != 0 && stepStart != step.start) {
+            emit();
+            if (copied == limit) return false;
+        }
+        if (step.count == 0) step.start = stepStart;
+        step.Add(min, max, sum, count, last);
+        return true;
+    };
+
+    if (limit == 0) return 0;
+    // Whole steps only: from the start of the one holding fromMs
+    fromMs = FloorTo(std::max<int64_t>(fromMs, -(1LL << 62)), stepMs);
+    const Tier& tier = series_[seriesId].tiers[tierIndex];
+    bool more = true;
+    VisitTier(tier, tierIndex, fromMs, toMs, [&](int64_t start, double min, double max, double sum, uint64_t count, double last) {
+        more = add(start, min, max, sum, count, last);
+        return more;
+    });
+    const Bucket& open = tier.open;
+    if (more && tierIndex != METRIC_TIER_RAW && open.count != 0 && open.start >= fromMs && open.start < toMs) {
+        more = add(open.start, open.min, open.max, open.sum, open.count, open.last);
+    }
+    if (more && step.count != 0) emit();
+    return static_cast<int>(copied);
+}
+
+void Store::Stats(MetricStoreStats& stats) {
+    std::lock_guard<std::mutex> guard(lock_);
+    memset(&stats, 0, sizeof(stats));
+    stats.series = static_cast<long long>(series_.size());
+    for (const Series& series : series_) {
+        for (uint32_t tierIndex = 0; tierIndex < METRIC_TIER_COUNT; tierIndex++) {
+            for (uint32_t block : series.tiers[tierIndex].blocks) {
+                const BlockHeader* header = HeaderOf(block);
+                (tierIndex == METRIC_TIER_RAW ? stats.samples : stats.rollups) += header->count;
+                stats.encodedBytes += (header->bitLength + 7) / 8;
+            }
+            stats.blocksUsed += static_cast<long long>(series.tiers[tierIndex].blocks.size());
+        }
+    }
+    stats.blocksFree = static_cast<long long>(free_.size());
+    stats.fileBytes = static_cast<long long>(file_.Size());
+}
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API void* OpenMetricStore(const char* directory, const long long* retentionMs) {
+    if (directory == nullptr || *directory == '\0') return nullptr;
+    int64_t retention[METRIC_TIER_COUNT] = {};
+    if (retentionMs != nullptr) {
+        for (int i = 0; i < METRIC_TIER_COUNT; i++) retention[i] = retentionMs[i];
+    }
+    Store* store = new Store();
+    if (!store->Open(directory, retention)) {
+        delete store;
+        return nullptr;
+    }
+    return store;
+}
+
+SUPERPANEL_API void CloseMetricStore(void* store) {
+    delete static_cast<Store*>(store);
+}
+
+SUPERPANEL_API int FlushMetricStore(void* store) {
+    if (store == nullptr) return 0;
+    return static_cast<Store*>(store)->Flush() ? 1 : 0;
+}
+
+SUPERPANEL_API int GetMetricSeriesId(void* store, const char* name, int create) {
+    if (store == nullptr || name == nullptr) return -1;
+    return static_cast<Store*>(store)->SeriesId(name, create != 0);
+}
+
+SUPERPANEL_API int AppendMetricSamples(void* store, int seriesId, const long long* timestamps, const double* values, int count) {
+    if (store == nullptr || (count > 0 && (timestamps == nullptr || values == nullptr))) return -1;
+    return static_cast<Store*>(store)->Append(seriesId, timestamps, values, std::max(count, 0));
+}
+
+SUPERPANEL_API int QueryMetricRange(void* store, int seriesId, long long fromMs, long long toMs,
+                                    long long* timestamps, double* values, int maxCount) {
+    if (store == nullptr || (maxCount > 0 && (timestamps == nullptr || values == nullptr))) return -1;
+    return static_cast<Store*>(store)->Query(seriesId, fromMs, toMs, timestamps, values, maxCount);
+}
+
+SUPERPANEL_API int QueryMetricRollups(void* store, int seriesId, long long fromMs, long long toMs, long long stepMs,
+                                      MetricRollup* rollups, int maxCount, int* tier) {
+    if (store == nullptr || (maxCount > 0 && rollups == nullptr)) return -1;
+    return static_cast<Store*>(store)->QueryRollups(seriesId, fromMs, toMs, stepMs, rollups, maxCount, tier);
+}
+
+SUPERPANEL_API int GetMetricStoreStats(void* store, MetricStoreStats* stats) {
+    if (store == nullptr || stats == nullptr) return 0;
+    static_cast<Store*>(store)->Stats(*stats);
+    return 1;
+}
+
+} // extern "C"
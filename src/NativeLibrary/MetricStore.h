@@ -0,0 +1,90 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Tiers of a series: the raw samples and rollups over 1 minute, 5 minutes
+// and 1 hour, each aligned to wall-clock multiples of its width
+#define METRIC_TIER_RAW 0
+#define METRIC_TIER_1M 1
+#define METRIC_TIER_5M 2
+#define METRIC_TIER_1H 3
+#define METRIC_TIER_COUNT 4
+
+// Aggregate of the samples in [startMs, startMs + step). NaN samples are
+// left out, and steps without samples are skipped.
+struct MetricRollup {
+    long long startMs;
+    long long count;
+    double min;
+    double max;
+    double avg;
+    double last;
+};
+
+struct MetricStoreStats {
+    long long series;
+    long long samples;      // Raw samples
+    long long rollups;      // Closed rollup buckets, all tiers
+    long long blocksUsed;
+    long long blocksFree;   // Expired blocks waiting to be reused
+    long long encodedBytes; // Compressed samples, block headers excluded
+    long long fileBytes;
+};
+
+extern "C" {
+    // Embedded time-series store for metric history, kept in a directory.
+    // Each series is compressed as in Facebook's Gorilla: timestamps as
+    // delta-of-deltas (one bit for a sample on its usual interval) and
+    // values XORed with the previous one (one bit for an unchanged value,
+    // a dozen or so for a slowly moving gauge). Samples are appended to 4 KB
+    // blocks of a memory-mapped file, so a crash of the process loses
+    // nothing already appended.
+    //
+    // Every sample also updates the series' 1m, 5m and 1h rollups
+    // (min/max/sum/count/last). A rollup bucket is compressed into its
+    // tier's blocks the same way once a sample lands past its end; until
+    // then it is kept in memory, and rebuilt from the next finer tier when
+    // the store is reopened.
+    //
+    // retentionMs has METRIC_TIER_COUNT entries: blocks of a tier whose
+    // data is all older than that (relative to the newest sample appended)
+    // are reused. NULL or an entry <= 0 keeps that tier forever. Data a
+    // coarser tier's open bucket still needs is kept regardless.
+    //
+    // The directory is locked against other processes (NULL if in use or
+    // unreadable). Thread-safe.
+    SUPERPANEL_API void* OpenMetricStore(const char* directory, const long long* retentionMs);
+    SUPERPANEL_API void CloseMetricStore(void* store);
+    // Writes dirty pages of the mapping to disk
+    SUPERPANEL_API int FlushMetricStore(void* store);
+
+    // Id of the series with that name, created if create is non-zero. Ids
+    // are stable across reopening. Returns -1 for an unknown name or a name
+    // containing a newline.
+    SUPERPANEL_API int GetMetricSeriesId(void* store, const char* name, int create);
+
+    // Appends samples in time order (Unix ms). A sample older than the last
+    // one of its series is dropped; equal timestamps are kept. Returns the
+    // number appended, or -1 for an unknown series.
+    SUPERPANEL_API int AppendMetricSamples(void* store, int seriesId, const long long* timestamps, const double* values, int count);
+
+    // Copies samples with fromMs <= timestamp < toMs, oldest first, up to
+    // maxCount. Returns the number copied (continue from the last timestamp
+    // + 1 when it equals maxCount), or -1 for an unknown series.
+    SUPERPANEL_API int QueryMetricRange(void* store, int seriesId, long long fromMs, long long toMs,
+                                        long long* timestamps, double* values, int maxCount);
+
+    // Aggregates the series over buckets of stepMs aligned to multiples of
+    // it, from the bucket holding fromMs up to toMs (exclusive), oldest
+    // first. Reads the coarsest tier whose width divides stepMs, so a month
+    // at 1-hour steps decodes about 720 rollups instead of every sample;
+    // rollups are assigned to a step by their start. Steps that are not a
+    // multiple of a minute read the raw samples. The bucket still open
+    // is included. The tier used goes to *tier when it is non-NULL. Returns
+    // the buckets copied (continue from the last startMs + stepMs when it
+    // equals maxCount), or -1 for an unknown series or stepMs <= 0.
+    SUPERPANEL_API int QueryMetricRollups(void* store, int seriesId, long long fromMs, long long toMs, long long stepMs,
+                                          MetricRollup* rollups, int maxCount, int* tier);
+
+    SUPERPANEL_API int GetMetricStoreStats(void* store, MetricStoreStats* stats);
+}
@@ -0,0 +1,366 @@
+#include "pch.h"
+#include "NetStack.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
+#include "SocketDiag.h"
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Cumulative counters first, in NetStackStats order, then current values
+enum Counter {
+    TcpActiveOpens, TcpPassiveOpens, TcpAttemptFails, TcpEstabResets,
+    TcpInSegs, TcpOutSegs, TcpRetransSegs, TcpInErrs, TcpOutRsts,
+    ListenOverflows, ListenDrops, TcpTimeouts, TcpSynRetrans,
+    TcpAbortOnTimeout, TcpAbortOnMemory, TcpBacklogDrop, SyncookiesSent, TcpReqQFullDrop,
+    UdpInDatagrams, UdpOutDatagrams, UdpNoPorts, UdpInErrors, UdpRcvbufErrors, UdpSndbufErrors,
+    CumulativeCount,
+    TcpCurrEstab = CumulativeCount, TcpInUse, TcpInUse6, TcpOrphans, TcpTimeWait, TcpMemoryPages,
+    UdpInUse, UdpInUse6, SocketsUsed,
+    CounterCount
+};
+
+// The counters NetStackStats carries a rate for, in its order
+const Counter RateCounters[] = {
+    TcpInSegs, TcpOutSegs, TcpRetransSegs,
+    TcpAttemptFails, TcpEstabResets, TcpInErrs, TcpOutRsts,
+    ListenOverflows, ListenDrops, TcpTimeouts, TcpSynRetrans,
+    UdpInErrors, UdpRcvbufErrors,
+};
+const int RateCount = sizeof(RateCounters) / sizeof(RateCounters[0]);
+
+static_assert(offsetof(NetStackStats, udpSndbufErrors) == offsetof(NetStackStats, tcpActiveOpens) + (CumulativeCount - 1) * sizeof(long long),
+              "NetStackStats cumulative fields must follow Counter order");
+static_assert(offsetof(NetStackStats, udpRcvbufErrorsPerSecond) == offsetof(NetStackStats, tcpInSegsPerSecond) + (RateCount - 1) * sizeof(double),
+              "NetStackStats rates must follow RateCounters order");
+
+const auto MinRateInterval = std::chrono::milliseconds(250);
+
+// Counters are 32 bits wide on 32-bit kernels and in the Windows tables; a
+// drop from below 2^32 is a wrap, a drop from higher up a reset.
+uint64_t CounterDelta(uint64_t previous, uint64_t current) {
+    if (current >= previous) return current - previous;
+    if (previous <= UINT32_MAX) return current + (1ULL << 32) - previous;
+    return current;
+}
+
+#ifndef _WIN32
+
+struct Field {
+    const char* section; // Line prefix before the colon
+    const char* name;    // Column header (snmp, netstat) or key (sockstat)
+    Counter counter;
+};
+
+const Field Fields[] = {
+    {"Tcp", "ActiveOpens", TcpActiveOpens},
+    {"Tcp", "PassiveOpens", TcpPassiveOpens},
+    {"Tcp", "AttemptFails", TcpAttemptFails},
+    {"Tcp", "EstabResets", TcpEstabResets},
+    {"Tcp", "CurrEstab", TcpCurrEstab},
+    {"Tcp", "InSegs", TcpInSegs},
+    {"Tcp", "OutSegs", TcpOutSegs},
+    {"Tcp", "RetransSegs", TcpRetransSegs},
+    {"Tcp", "InErrs", TcpInErrs},
+    {"Tcp", "OutRsts", TcpOutRsts},
+    {"Udp", "InDatagrams", UdpInDatagrams},
+    {"Udp", "NoPorts", UdpNoPorts},
+    {"Udp", "InErrors", UdpInErrors},
+    {"Udp", "OutDatagrams", UdpOutDatagrams},
+    {"Udp", "RcvbufErrors", UdpRcvbufErrors},
+    {"Udp", "SndbufErrors", UdpSndbufErrors},
+    {"TcpExt", "ListenOverflows", ListenOverflows},
+    {"TcpExt", "ListenDrops", ListenDrops},
+    {"TcpExt", "TCPTimeouts", TcpTimeouts},
+    {"TcpExt", "TCPSynRetrans", TcpSynRetrans},
+    {"TcpExt", "TCPAbortOnTimeout", TcpAbortOnTimeout},
+    {"TcpExt", "TCPAbortOnMemory", TcpAbortOnMemory},
+    {"TcpExt", "TCPBacklogDrop", TcpBacklogDrop},
+    {"TcpExt", "SyncookiesSent", SyncookiesSent},
+    {"TcpExt", "TCPReqQFullDrop", TcpReqQFullDrop},
+    {"sockets", "used", SocketsUsed},
+    {"TCP", "inuse", TcpInUse},
+    {"TCP", "orphan", TcpOrphans},
+    {"TCP", "tw", TcpTimeWait},
+    {"TCP", "mem", TcpMemoryPages},
+    {"UDP", "inuse", UdpInUse},
+    {"TCP6", "inuse", TcpInUse6},
+    {"UDP6", "inuse", UdpInUse6},
+};
+
+int FindField(const char* section, size_t sectionLength, const char* name, size_t nameLength) {
+    for (const Field& field : Fields) {
+        if (strlen(field.section) == sectionLength && memcmp(field.section, section, sectionLength) == 0 &&
+            strlen(field.name) == nameLength && memcmp(field.name, name, nameLength) == 0) {
+            return field.counter;
+        }
+    }
+    return -1;
+}
+
+bool ReadWhole(const char* path, std::string& buffer) {
+    int file = open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0) return false;
+    buffer.clear();
+    char chunk[8192];
+    ssize_t length;
+    while ((length = read(file, chunk, sizeof(chunk))) > 0) buffer.append(chunk, static_cast<size_t>(length));
+    close(file);
+    return length == 0 && !buffer.empty();
+}
+
+const char* SkipSpaces(const char* p, const char* end) {
+    while (p < end && *p == ' ') p++;
+    return p;
+}
+
+const char* SkipToken(const char* p, const char* end) {
+    while (p < end && *p != ' ') p++;
+    return p;
+}
+
+// A /proc/net/snmp-style file: "Section: Name Name ..." header lines, each
+// followed by a "Section: value value ..." line. The headers are indexed
+// into per-column counters once; a sample then compares each header with
+// the indexed copy (a memcmp) and parses only up to its last wanted column.
+class CounterFile {
+public:
+    explicit CounterFile(const char* path) : path_(path) {}
+
+    bool Sample(long long* values) {
+        if (!ReadWhole(path_, buffer_)) return false;
+        const char* p = buffer_.data();
+        const char* end = p + buffer_.size();
+        size_t section = 0;
+        while (p < end) {
+            const char* header = p;
+            const char* headerEnd = static_cast<const char*>(memchr(header, '\n', end - header));
+            if (headerEnd == nullptr) break;
+            const char* line = headerEnd + 1;
+            const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+            if (lineEnd == nullptr) lineEnd = end;
+            p = lineEnd + 1;
+
+            const size_t headerLength = static_cast<size_t>(headerEnd - header);
+            if (section >= sections_.size()) sections_.resize(section + 1);
+            Section& indexed = sections_[section++];
+            if (indexed.header.size() != headerLength || memcmp(indexed.header.data(), header, headerLength) != 0) Index(indexed, header, headerEnd);
+            if (indexed.used == 0) continue;
+
+            const char* value = static_cast<const char*>(memchr(line, ':', lineEnd - line));
+            if (value == nullptr) continue;
+            value++;
+            for (size_t column = 0; column < indexed.used; column++) {
+                value = SkipSpaces(value, lineEnd);
+                if (value == lineEnd) break;
+                if (indexed.columns[column] < 0) {
+                    value = SkipToken(value, lineEnd);
+                    continue;
+                }
+                long long number = 0;
+                if (*value == '-') {
+                    number = -1; // Only ever -1 (Tcp MaxConn), for "no limit"
+                    value = SkipToken(value, lineEnd);
+                } else {
+                    while (value < lineEnd && *value >= '0' && *value <= '9') number = number * 10 + (*value++ - '0');
+                }
+                values[indexed.columns[column]] = number;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Section {
+        std::string header;       // The header line as indexed
+        std::vector<int> columns; // Counter for each column, or -1
+        size_t used = 0;          // Columns up to and including the last wanted one
+    };
+
+    static void Index(Section& section, const char* header, const char* headerEnd) {
+        section.header.assign(header, headerEnd);
+        section.columns.clear();
+        section.used = 0;
+        const char* colon = static_cast<const char*>(memchr(header, ':', headerEnd - header));
+        if (colon == nullptr) return;
+        const char* name = colon + 1;
+        while ((name = SkipSpaces(name, headerEnd)) < headerEnd) {
+            const char* nameEnd = SkipToken(name, headerEnd);
+            int counter = FindField(header, colon - header, name, nameEnd - name);
+            section.columns.push_back(counter);
+            if (counter >= 0) section.used = section.columns.size();
+            name = nameEnd;
+        }
+    }
+
+    const char* path_;
+    std::string buffer_;
+    std::vector<Section> sections_;
+};
+
+// /proc/net/sockstat{,6}: "Section: key value key value ..." per line. A few
+// short lines, so the keys are simply looked up as they come.
+bool SampleSockstat(const char* path, std::string& buffer, long long* values) {
+    if (!ReadWhole(path, buffer)) return false;
+    const char* p = buffer.data();
+    const char* end = p + buffer.size();
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (lineEnd == nullptr) lineEnd = end;
+        const char* colon = static_cast<const char*>(memchr(p, ':', lineEnd - p));
+        if (colon != nullptr) {
+            const char* key = colon + 1;
+            while ((key = SkipSpaces(key, lineEnd)) < lineEnd) {
+                const char* keyEnd = SkipToken(key, lineEnd);
+                const char* value = SkipSpaces(keyEnd, lineEnd);
+                long long number = 0;
+                while (value < lineEnd && *value >= '0' && *value <= '9') number = number * 10 + (*value++ - '0');
+                int counter = FindField(p, colon - p, key, keyEnd - key);
+                if (counter >= 0) values[counter] = number;
+                key = SkipToken(value, lineEnd);
+            }
+        }
+        p = lineEnd + 1;
+    }
+    return true;
+}
+
+CounterFile snmp("/proc/net/snmp");
+CounterFile netstat("/proc/net/netstat");
+std::string sockstatBuffer;
+
+bool ReadCounters(long long* values) {
+    if (!snmp.Sample(values)) return false;
+    netstat.Sample(values); // Some sandboxes hide it; the TcpExt counters then stay -1
+    SampleSockstat("/proc/net/sockstat", sockstatBuffer, values);
+    if (SampleSockstat("/proc/net/sockstat6", sockstatBuffer, values)) {
+        if (values[TcpInUse] >= 0 && values[TcpInUse6] >= 0) values[TcpInUse] += values[TcpInUse6];
+        if (values[UdpInUse] >= 0 && values[UdpInUse6] >= 0) values[UdpInUse] += values[UdpInUse6];
+    }
+    return true;
+}
+
+#else
+
+bool ReadCounters(long long* values) {
+    bool any = false;
+    for (ULONG family : {AF_INET, AF_INET6}) {
+        MIB_TCPSTATS tcp;
+        if (GetTcpStatisticsEx(&tcp, family) == NO_ERROR) {
+            const DWORD counters[][2] = {
+                {TcpActiveOpens, tcp.dwActiveOpens}, {TcpPassiveOpens, tcp.dwPassiveOpens},
+                {TcpAttemptFails, tcp.dwAttemptFails}, {TcpEstabResets, tcp.dwEstabResets},
+                {TcpCurrEstab, tcp.dwCurrEstab}, {TcpInSegs, tcp.dwInSegs}, {TcpOutSegs, tcp.dwOutSegs},
+                {TcpRetransSegs, tcp.dwRetransSegs}, {TcpInErrs, tcp.dwInErrs}, {TcpOutRsts, tcp.dwOutRsts},
+            };
+            for (const auto& counter : counters) values[counter[0]] = (values[counter[0]] < 0 ? 0 : values[counter[0]]) + counter[1];
+            any = true;
+        }
+        MIB_UDPSTATS udp;
+        if (GetUdpStatisticsEx(&udp, family) == NO_ERROR) {
+            const DWORD counters[][2] = {
+                {UdpInDatagrams, udp.dwInDatagrams}, {UdpOutDatagrams, udp.dwOutDatagrams},
+                {UdpNoPorts, udp.dwNoPorts}, {UdpInErrors, udp.dwInErrors},
+            };
+            for (const auto& counter : counters) values[counter[0]] = (values[counter[0]] < 0 ? 0 : values[counter[0]]) + counter[1];
+        }
+    }
+    if (!any) return false;
+
+    // No sockstat; count TIME_WAIT and in-use sockets from the TCP tables
+    long long inUse = 0, timeWait = 0;
+    if (superpanel::ForEachInetSocket(SOCKET_PROTOCOL_TCP, 0xFFFFFFFFu, [&](const superpanel::InetSocketEntry& entry) {
+            inUse++;
+            if (entry.state == TCP_STATE_TIME_WAIT) timeWait++;
+        }) != 0) {
+        values[TcpInUse] = inUse - timeWait; // sockstat's inuse excludes TIME_WAIT too
+        values[TcpTimeWait] = timeWait;
+    }
+    return true;
+}
+
+#endif
+
+struct History {
+    bool primed = false;
+    uint64_t last[CumulativeCount] = {};  // Raw counters at the previous sample
+    uint64_t total[CumulativeCount] = {}; // Wrap-corrected running totals
+    uint64_t rateBase[CumulativeCount] = {};
+    Clock::time_point rateTime;
+    double rates[CumulativeCount] = {};
+    double retransmitPercent = 0;
+};
+
+std::mutex sampleLock; // Guards the indexed files and history
+History history;
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API int GetNetStackStats(NetStackStats* stats) {
+    if (stats == NULL) return 0;
+    long long values[CounterCount];
+    for (long long& value : values) value = -1;
+
+    std::lock_guard<std::mutex> guard(sampleLock);
+    if (!ReadCounters(values)) return 0;
+
+    const auto now = Clock::now();
+    if (!history.primed) {
+        for (int i = 0; i < CumulativeCount; i++) {
+            const uint64_t value = values[i] < 0 ? 0 : static_cast<uint64_t>(values[i]);
+            history.last[i] = history.total[i] = history.rateBase[i] = value;
+        }
+        history.rateTime = now;
+        history.primed = true;
+    }
+    for (int i = 0; i < CumulativeCount; i++) {
+        if (values[i] < 0) continue;
+        history.total[i] += CounterDelta(history.last[i], static_cast<uint64_t>(values[i]));
+        history.last[i] = static_cast<uint64_t>(values[i]);
+    }
+    if (now - history.rateTime >= MinRateInterval) {
+        const double elapsed = std::chrono::duration<double>(now - history.rateTime).count();
+        for (int i = 0; i < CumulativeCount; i++) history.rates[i] = static_cast<double>(history.total[i] - history.rateBase[i]) / elapsed;
+        const uint64_t sent = history.total[TcpOutSegs] - history.rateBase[TcpOutSegs];
+        const uint64_t retransmitted = history.total[TcpRetransSegs] - history.rateBase[TcpRetransSegs];
+        history.retransmitPercent = sent > 0 ? 100.0 * static_cast<double>(retransmitted) / static_cast<double>(sent) : 0;
+        memcpy(history.rateBase, history.total, sizeof(history.rateBase));
+        history.rateTime = now;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    // The cumulative fields are laid out in Counter order
+    long long* cumulative = &stats->tcpActiveOpens;
+    for (int i = 0; i < CumulativeCount; i++) cumulative[i] = values[i] < 0 ? -1 : static_cast<long long>(history.total[i]);
+    stats->tcpCurrEstab = values[TcpCurrEstab];
+    stats->tcpInUse = values[TcpInUse];
+    stats->tcpOrphans = values[TcpOrphans];
+    stats->tcpTimeWait = values[TcpTimeWait];
+    stats->tcpMemoryPages = values[TcpMemoryPages];
+    stats->udpInUse = values[UdpInUse];
+    stats->socketsUsed = values[SocketsUsed];
+    double* rates = &stats->tcpInSegsPerSecond;
+    for (int i = 0; i < RateCount; i++) rates[i] = history.rates[RateCounters[i]];
+    stats->retransmitPercent = history.retransmitPercent;
+    return 1;
+}
+
+} // extern "C"
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Kernel TCP/IP health counters. Fields the platform does not report are -1
+// (Windows has no listen-queue or timeout counters, for instance).
+struct NetStackStats {
+    // Cumulative since boot (per network namespace on Linux)
+    long long tcpActiveOpens, tcpPassiveOpens, tcpAttemptFails, tcpEstabResets;
+    long long tcpInSegs, tcpOutSegs, tcpRetransSegs, tcpInErrs, tcpOutRsts;
+    long long listenOverflows;  // SYNs or handshakes dropped because the accept queue was full
+    long long listenDrops;      // Every SYN dropped by a listener, overflows included
+    long long tcpTimeouts;      // Retransmission timer expiries
+    long long tcpSynRetrans;
+    long long tcpAbortOnTimeout, tcpAbortOnMemory, tcpBacklogDrop;
+    long long syncookiesSent, tcpReqQFullDrop;
+    long long udpInDatagrams, udpOutDatagrams, udpNoPorts, udpInErrors, udpRcvbufErrors, udpSndbufErrors;
+    // Current values
+    long long tcpCurrEstab;  // ESTABLISHED and CLOSE_WAIT
+    long long tcpInUse;      // IPv4 and IPv6 TCP sockets
+    long long tcpOrphans;    // Closed by the application, still shutting down
+    long long tcpTimeWait;
+    long long tcpMemoryPages;
+    long long udpInUse;
+    long long socketsUsed;
+    // Per second since the previous sample, 0 on the first one
+    double tcpInSegsPerSecond, tcpOutSegsPerSecond, tcpRetransSegsPerSecond;
+    double tcpAttemptFailsPerSecond, tcpEstabResetsPerSecond, tcpInErrsPerSecond, tcpOutRstsPerSecond;
+    double listenOverflowsPerSecond, listenDropsPerSecond, tcpTimeoutsPerSecond, tcpSynRetransPerSecond;
+    double udpInErrorsPerSecond, udpRcvbufErrorsPerSecond;
+    double retransmitPercent; // Retransmitted share of segments sent over the same interval
+};
+
+extern "C" {
+    // Samples /proc/net/snmp, /proc/net/netstat and /proc/net/sockstat{,6}
+    // (GetTcpStatisticsEx and GetUdpStatisticsEx on Windows). The header
+    // lines are indexed on the first read, so later samples only parse the
+    // columns wanted. Rates follow GetInterfaceStats: they cover the time
+    // since the previous sample by any caller, and samples less than 250 ms
+    // apart keep the previous rates. Returns 1 on success, 0 on failure.
+    SUPERPANEL_API int GetNetStackStats(NetStackStats* stats);
+}
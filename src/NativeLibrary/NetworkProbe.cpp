@@ -0,0 +1,666 @@
+#include "pch.h"
+#include "NetworkProbe.h"
+#include "DnsResolver.h"
+#include "EventLoop.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+using superpanel::AsyncResolver;
+using superpanel::EventLoop;
+using superpanel::InvalidSocket;
+using superpanel::SocketAddress;
+using superpanel::SocketHandle;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const int DefaultTimeoutMs = 3000;
+// Connects and lookups in flight at once; the rest of a batch waits for free slots so a
+// large batch cannot exhaust the descriptor limit
+const size_t MaxInFlight = 512;
+
+struct Connect {
+    SocketHandle socket = InvalidSocket;
+    int target = -1; // -1 when the slot is free
+    Clock::time_point started;
+};
+
+struct Target {
+    std::vector<SocketAddress> addresses;
+    size_t next = 0; // Next address to try when one is unreachable
+    Clock::time_point deadline;
+};
+
+struct Expiry {
+    Clock::time_point deadline;
+    size_t slot;
+    int target;
+    bool operator>(const Expiry& other) const { return deadline > other.deadline; }
+};
+
+long long StatusForError(int error) {
+    switch (error) {
+    case 0: return PORT_STATUS_OPEN;
+    case ECONNREFUSED: return PORT_STATUS_CLOSED;
+    case ETIMEDOUT: return PORT_STATUS_TIMEOUT;
+    case EHOSTUNREACH:
+    case ENETUNREACH:
+    case ENETDOWN:
+#ifdef EHOSTDOWN
+    case EHOSTDOWN:
+#endif
+        return PORT_STATUS_UNREACHABLE;
+    default: return PORT_STATUS_ERROR;
+    }
+}
+
+class PortChecker {
+public:
+    PortChecker(const char* const* hosts, const int* ports, const int* timeoutsMs, PortCheckResult* results)
+        : hosts_(hosts), ports_(ports), timeoutsMs_(timeoutsMs), results_(results), resolver_(loop_) {}
+
+    ~PortChecker() {
+        for (Connect& connect : slots_) {
+            if (connect.target >= 0) superpanel::AbortSocket(connect.socket);
+        }
+    }
+
+    bool Run(int count) {
+        if (!loop_.IsValid()) return false;
+        targets_.resize(static_cast<size_t>(count));
+        int next = 0;
+        std::vector<EventLoop::Event> events;
+        while (true) {
+            while (next < count && active_ < MaxInFlight) Start(next++);
+            const int resolverWaitMs = resolver_.Tick();
+            if (active_ == 0) {
+                if (next < count) continue;
+                break;
+            }
+
+            const auto now = Clock::now();
+            int waitMs = resolverWaitMs;
+            if (!expiries_.empty()) {
+                // Round up, or the loop spins through the last millisecond
+                int expiryMs = expiries_.top().deadline > now
+                    ? static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(expiries_.top().deadline - now).count()) + 1
+                    : 0;
+                waitMs = waitMs < 0 ? expiryMs : std::min(waitMs, expiryMs);
+            }
+            if (!loop_.Wait(waitMs, events)) return false;
+            for (const EventLoop::Event& event : events) {
+                if (AsyncResolver::OwnsToken(event.token)) {
+                    resolver_.OnEvent(event);
+                    continue;
+                }
+                Connect& connect = slots_[static_cast<size_t>(event.token)];
+                if (connect.target >= 0) Finish(static_cast<size_t>(event.token), superpanel::PendingSocketError(connect.socket));
+            }
+            ExpireOverdue();
+        }
+        return true;
+    }
+
+private:
+    // The deadline covers the lookup and every connect attempt together
+    void Start(int target) {
+        PortCheckResult& result = results_[target];
+        result.rttUs = -1;
+        const int port = ports_[target];
+        if (hosts_[target] == NULL || port <= 0 || port > 65535) {
+            result.status = PORT_STATUS_ERROR;
+            result.error = EINVAL;
+            return;
+        }
+        const int timeoutMs = timeoutsMs_ != NULL && timeoutsMs_[target] > 0 ? timeoutsMs_[target] : DefaultTimeoutMs;
+        targets_[target].deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        active_++;
+        resolver_.Resolve(hosts_[target], port, targets_[target].deadline,
+                          [this, target](int error, const std::vector<SocketAddress>& addresses) { OnResolved(target, error, addresses); });
+    }
+
+    void OnResolved(int target, int error, const std::vector<SocketAddress>& addresses) {
+        active_--;
+        PortCheckResult& result = results_[target];
+        if (error != 0 || addresses.empty()) {
+            result.status = error == EINVAL ? PORT_STATUS_ERROR : PORT_STATUS_UNRESOLVED;
+            result.error = error != 0 ? error : ENOENT;
+            return;
+        }
+        targets_[target].addresses = addresses;
+        ConnectNext(target);
+    }
+
+    // Tries the target's addresses in turn until one answers either way
+    void ConnectNext(int target) {
+        Target& state = targets_[target];
+        PortCheckResult& result = results_[target];
+        while (state.next < state.addresses.size()) {
+            const SocketAddress& address = state.addresses[state.next++];
+            SocketHandle socket = superpanel::OpenNonBlockingSocket(address.Family(), SOCK_STREAM, IPPROTO_TCP);
+            if (socket == InvalidSocket) {
+                result.status = PORT_STATUS_ERROR;
+                result.error = address.Family() == AF_INET6 ? EAFNOSUPPORT : EMFILE;
+                continue;
+            }
+
+            const auto started = Clock::now();
+            int error = superpanel::StartConnect(socket, address.Get(), address.length);
+            if (error != EINPROGRESS) {
+                // Loopback connects can complete (or be refused) immediately
+                result.status = StatusForError(error);
+                result.error = error;
+                if (result.status == PORT_STATUS_OPEN || result.status == PORT_STATUS_CLOSED) {
+                    result.rttUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+                }
+                superpanel::AbortSocket(socket);
+                if (!Retryable(result.status)) return;
+                continue;
+            }
+
+            size_t slot;
+            if (!freeSlots_.empty()) {
+                slot = freeSlots_.back();
+                freeSlots_.pop_back();
+            } else {
+                slot = slots_.size();
+                slots_.emplace_back();
+            }
+            if (!loop_.Add(socket, EventLoop::Writable, slot)) {
+                freeSlots_.push_back(slot);
+                superpanel::AbortSocket(socket);
+                result.status = PORT_STATUS_ERROR;
+                result.error = errno;
+                return;
+            }
+            Connect& connect = slots_[slot];
+            connect.socket = socket;
+            connect.target = target;
+            connect.started = started;
+            expiries_.push(Expiry{state.deadline, slot, target});
+            active_++;
+            return;
+        }
+    }
+
+    static bool Retryable(long long status) {
+        return status == PORT_STATUS_UNREACHABLE || status == PORT_STATUS_ERROR;
+    }
+
+    void Finish(size_t slot, int error) {
+        Connect& connect = slots_[slot];
+        const int target = connect.target;
+        PortCheckResult& result = results_[target];
+        result.status = StatusForError(error);
+        result.error = error;
+        if (result.status == PORT_STATUS_OPEN || result.status == PORT_STATUS_CLOSED) {
+            result.rttUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - connect.started).count();
+        }
+        loop_.Remove(connect.socket);
+        superpanel::AbortSocket(connect.socket);
+        connect.socket = InvalidSocket;
+        connect.target = -1;
+        freeSlots_.push_back(slot);
+        active_--;
+        if (Retryable(result.status) && Clock::now() < targets_[target].deadline) ConnectNext(target);
+    }
+
+    // Entries for checks that already finished are skipped as they surface
+    void ExpireOverdue() {
+        const auto now = Clock::now();
+        while (!expiries_.empty() && expiries_.top().deadline <= now) {
+            Expiry expiry = expiries_.top();
+            expiries_.pop();
+            if (slots_[expiry.slot].target == expiry.target) Finish(expiry.slot, ETIMEDOUT);
+        }
+    }
+
+    const char* const* hosts_;
+    const int* ports_;
+    const int* timeoutsMs_;
+    PortCheckResult* results_;
+
+    EventLoop loop_;
+    AsyncResolver resolver_;
+    std::vector<Target> targets_;
+    std::vector<Connect> slots_;
+    std::vector<size_t> freeSlots_;
+    std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> expiries_;
+    size_t active_ = 0;
+};
+
+const int DefaultPacketCount = 4;
+const int MaxPacketCount = 100;
+const int DefaultPacketIntervalMs = 200;
+const int DefaultReplyTimeoutMs = 1000;
+
+// What a check sends, and so how its replies are told apart
+enum class Payload { Icmp, Raw, Dns, Ntp };
+
+bool ParsePayload(const char* name, int port, Payload& payload) {
+    if (name == NULL || name[0] == '\0') payload = port == 53 ? Payload::Dns : (port == 123 ? Payload::Ntp : Payload::Raw);
+    else if (strcmp(name, "dns") == 0) payload = Payload::Dns;
+    else if (strcmp(name, "ntp") == 0) payload = Payload::Ntp;
+    else return false;
+    return true;
+}
+
+void PutBigEndian16(unsigned char* p, uint16_t value) {
+    p[0] = static_cast<unsigned char>(value >> 8);
+    p[1] = static_cast<unsigned char>(value);
+}
+
+uint16_t GetBigEndian16(const unsigned char* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+// The Internet checksum, for ICMPv4 (the kernel fills in ICMPv6's)
+uint16_t Checksum(const unsigned char* data, size_t length) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i + 1 < length; i += 2) sum += GetBigEndian16(data + i);
+    if (length % 2 != 0) sum += static_cast<uint32_t>(data[length - 1]) << 8;
+    while ((sum >> 16) != 0) sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(~sum);
+}
+
+struct Reachability {
+    Payload payload = Payload::Raw;
+    std::string raw;
+    int family = AF_INET;
+    uint16_t idBase = 0; // DNS ids and NTP stamps are idBase + packet
+    SocketHandle socket = InvalidSocket;
+    bool active = false;
+    int sent = 0;
+    int outstanding = 0;
+    std::vector<Clock::time_point> sentAt;
+    std::vector<char> pending; // Per packet: still waiting for its reply
+    bool refused = false;
+    int lastError = 0;
+    long long sumUs = 0;
+    double sumSquaresUs = 0;
+};
+
+struct PacketTimer {
+    Clock::time_point when;
+    int target;
+    int packet; // -1 to send the next packet, else the packet whose reply is due
+    bool operator>(const PacketTimer& other) const { return when > other.when; }
+};
+
+long long ReachStatusForError(int error) {
+    switch (error) {
+    case EHOSTUNREACH:
+    case ENETUNREACH:
+    case ENETDOWN:
+#ifdef EHOSTDOWN
+    case EHOSTDOWN:
+#endif
+        return REACH_STATUS_UNREACHABLE;
+    default: return REACH_STATUS_ERROR;
+    }
+}
+
+// ICMP echo and UDP request/response checks, with the shape of PortChecker:
+// one socket per target, packets sent on timers, replies read as the loop
+// reports them readable and matched back to the packet they answer
+class DatagramChecker {
+public:
+    DatagramChecker(bool icmp, const char* const* hosts, const int* ports, const char* const* payloads, const int* payloadLengths,
+                    int packetCount, int intervalMs, int timeoutMs, ReachabilityResult* results)
+        : icmp_(icmp), hosts_(hosts), ports_(ports), payloads_(payloads), payloadLengths_(payloadLengths),
+          packetCount_(packetCount > 0 ? std::min(packetCount, MaxPacketCount) : DefaultPacketCount),
+          interval_(std::chrono::milliseconds(intervalMs > 0 ? intervalMs : DefaultPacketIntervalMs)),
+          timeout_(std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : DefaultReplyTimeoutMs)),
+          results_(results), resolver_(loop_) {}
+
+    ~DatagramChecker() {
+        for (Reachability& target : targets_) {
+            if (target.socket != InvalidSocket) superpanel::CloseSocket(target.socket);
+        }
+    }
+
+    bool Run(int count) {
+        if (!loop_.IsValid()) return false;
+        targets_.resize(static_cast<size_t>(count));
+        int next = 0;
+        std::vector<EventLoop::Event> events;
+        while (true) {
+            while (next < count && active_ < MaxInFlight) Start(next++);
+            const int resolverWaitMs = resolver_.Tick();
+            if (active_ == 0) {
+                if (next < count) continue;
+                break;
+            }
+
+            const auto now = Clock::now();
+            int waitMs = resolverWaitMs;
+            if (!timers_.empty()) {
+                // Round up, or the loop spins through the last millisecond
+                int timerMs = timers_.top().when > now
+                    ? static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(timers_.top().when - now).count()) + 1
+                    : 0;
+                waitMs = waitMs < 0 ? timerMs : std::min(waitMs, timerMs);
+            }
+            if (!loop_.Wait(waitMs, events)) return false;
+            for (const EventLoop::Event& event : events) {
+                if (AsyncResolver::OwnsToken(event.token)) {
+                    resolver_.OnEvent(event);
+                    continue;
+                }
+                const int target = static_cast<int>(event.token);
+                if (targets_[target].active) Receive(target);
+            }
+            RunTimers();
+        }
+        return true;
+    }
+
+private:
+    void Start(int target) {
+        ReachabilityResult& result = results_[target];
+        memset(&result, 0, sizeof(result));
+        result.minUs = result.avgUs = result.maxUs = result.mdevUs = -1;
+        Reachability& state = targets_[target];
+        const int port = icmp_ ? 0 : ports_[target];
+        bool valid = hosts_[target] != NULL && (icmp_ || (port > 0 && port <= 65535));
+        if (valid && icmp_) {
+            state.payload = Payload::Icmp;
+        } else if (valid) {
+            const char* payload = payloads_ != NULL ? payloads_[target] : NULL;
+            if (payloadLengths_ != NULL && payloadLengths_[target] >= 0) {
+                valid = payloadLengths_[target] <= static_cast<int>(MaxDatagramBytes) && (payload != NULL || payloadLengths_[target] == 0);
+                if (valid) state.raw.assign(payload != NULL ? payload : "", static_cast<size_t>(payloadLengths_[target]));
+                state.payload = Payload::Raw;
+            } else {
+                valid = ParsePayload(payload, port, state.payload);
+            }
+        }
+        if (!valid) {
+            result.status = REACH_STATUS_ERROR;
+            result.error = EINVAL;
+            return;
+        }
+        state.idBase = static_cast<uint16_t>(Clock::now().time_since_epoch().count() ^ (target * 0x9E37));
+        state.sentAt.resize(static_cast<size_t>(packetCount_));
+        state.pending.assign(static_cast<size_t>(packetCount_), 0);
+        state.active = true;
+        active_++;
+        resolver_.Resolve(hosts_[target], port, Clock::now() + timeout_,
+                          [this, target](int error, const std::vector<SocketAddress>& addresses) { OnResolved(target, error, addresses); });
+    }
+
+    // Checks the first address, IPv4 where the name has one
+    void OnResolved(int target, int error, const std::vector<SocketAddress>& addresses) {
+        Reachability& state = targets_[target];
+        if (error != 0 || addresses.empty()) {
+            Finish(target, error == EINVAL ? REACH_STATUS_ERROR : REACH_STATUS_UNRESOLVED, error != 0 ? error : ENOENT);
+            return;
+        }
+        const SocketAddress& address = addresses[0];
+        state.family = address.Family();
+        const int protocol = !icmp_ ? IPPROTO_UDP : (state.family == AF_INET6 ? static_cast<int>(IPPROTO_ICMPV6) : static_cast<int>(IPPROTO_ICMP));
+        errno = 0;
+        state.socket = superpanel::OpenNonBlockingSocket(state.family, SOCK_DGRAM, protocol);
+        if (state.socket == InvalidSocket) {
+            // EACCES where ping_group_range excludes us; Windows has no ICMP datagram sockets
+            Finish(target, REACH_STATUS_ERROR, errno != 0 ? errno : EPROTONOSUPPORT);
+            return;
+        }
+        // Connected, so only the peer's datagrams and ICMP errors arrive
+        error = superpanel::StartConnect(state.socket, address.Get(), address.length);
+        if (error != 0) {
+            Finish(target, ReachStatusForError(error), error);
+            return;
+        }
+        if (!loop_.Add(state.socket, EventLoop::Readable, static_cast<uint64_t>(target))) {
+            Finish(target, REACH_STATUS_ERROR, errno != 0 ? errno : EMFILE);
+            return;
+        }
+        Send(target);
+    }
+
+    size_t Build(const Reachability& state, int packet, unsigned char* buffer) const {
+        const uint16_t id = static_cast<uint16_t>(state.idBase + packet);
+        switch (state.payload) {
+        case Payload::Icmp: {
+            // Echo request; the kernel sets the identifier to the socket's
+            memset(buffer, 0, 32);
+            buffer[0] = state.family == AF_INET6 ? 128 : 8;
+            PutBigEndian16(buffer + 6, static_cast<uint16_t>(packet));
+            for (int i = 8; i < 32; i++) buffer[i] = static_cast<unsigned char>(i);
+            if (state.family != AF_INET6) PutBigEndian16(buffer + 2, Checksum(buffer, 32));
+            return 32;
+        }
+        case Payload::Dns: {
+            // ". IN NS" with recursion desired
+            static const unsigned char Query[] = {0, 0, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 1};
+            memcpy(buffer, Query, sizeof(Query));
+            PutBigEndian16(buffer, id);
+            return sizeof(Query);
+        }
+        case Payload::Ntp: {
+            // A version 4 client request; servers echo the transmit timestamp
+            // back as the originate timestamp
+            memset(buffer, 0, 48);
+            buffer[0] = 0x23;
+            PutBigEndian16(buffer + 44, state.idBase);
+            PutBigEndian16(buffer + 46, id);
+            return 48;
+        }
+        default:
+            memcpy(buffer, state.raw.data(), state.raw.size());
+            return state.raw.size();
+        }
+    }
+
+    // The packet a reply answers, or -1 if it answers none
+    int Match(const Reachability& state, const unsigned char* reply, size_t length) const {
+        int packet = -1;
+        switch (state.payload) {
+        case Payload::Icmp:
+            if (length >= 8 && reply[0] == (state.family == AF_INET6 ? 129 : 0)) packet = GetBigEndian16(reply + 6);
+            break;
+        case Payload::Dns:
+            if (length >= 12 && (reply[2] & 0x80) != 0) packet = static_cast<uint16_t>(GetBigEndian16(reply) - state.idBase);
+            break;
+        case Payload::Ntp:
+            if (length >= 48 && (reply[0] & 7) == 4 && GetBigEndian16(reply + 28) == state.idBase) {
+                packet = static_cast<uint16_t>(GetBigEndian16(reply + 30) - state.idBase);
+            }
+            break;
+        default:
+            // Raw payloads carry no id. Replies normally come well within the
+            // interval, so the latest request still waiting gets it; an older
+            // one still waiting was most likely lost.
+            for (int i = state.sent - 1; i >= 0; i--) {
+                if (state.pending[i]) return i;
+            }
+            return -1;
+        }
+        return packet < state.sent ? packet : -1;
+    }
+
+    void Send(int target) {
+        Reachability& state = targets_[target];
+        const int packet = state.sent++;
+        unsigned char buffer[MaxDatagramBytes];
+        const size_t length = Build(state, packet, buffer);
+        const auto now = Clock::now();
+        const int sent = superpanel::SendSome(state.socket, buffer, length);
+        if (sent >= 0 || sent == -EAGAIN) {
+            // A full send buffer drops the packet like the network would
+            state.sentAt[packet] = now;
+            state.pending[packet] = 1;
+            state.outstanding++;
+            timers_.push(PacketTimer{now + timeout_, target, packet});
+        } else {
+            NoteError(state, -sent);
+        }
+        if (state.sent < packetCount_) timers_.push(PacketTimer{now + interval_, target, -1});
+        else if (state.outstanding == 0) Complete(target);
+    }
+
+    // A port unreachable or other ICMP error queued on the socket
+    void NoteError(Reachability& state, int error) {
+        state.lastError = error;
+        if (!icmp_ && (error == ECONNREFUSED || error == ECONNRESET)) state.refused = true;
+    }
+
+    void Receive(int target) {
+        Reachability& state = targets_[target];
+        unsigned char buffer[MaxDatagramBytes];
+        // Bounded, so a peer flooding the socket cannot hold the loop
+        for (int reads = 0; reads < 64; reads++) {
+            const int received = superpanel::ReceiveSome(state.socket, buffer, sizeof(buffer));
+            if (received == -EAGAIN) break;
+            if (received < 0) {
+                NoteError(state, -received);
+                continue;
+            }
+            const auto now = Clock::now();
+            const int packet = Match(state, buffer, static_cast<size_t>(received));
+            if (packet < 0 || !state.pending[packet]) continue;
+            state.pending[packet] = 0;
+            state.outstanding--;
+            const long long rttUs = std::chrono::duration_cast<std::chrono::microseconds>(now - state.sentAt[packet]).count();
+            ReachabilityResult& result = results_[target];
+            result.received++;
+            result.minUs = result.minUs < 0 ? rttUs : std::min(result.minUs, rttUs);
+            result.maxUs = std::max(result.maxUs, rttUs);
+            state.sumUs += rttUs;
+            state.sumSquaresUs += static_cast<double>(rttUs) * static_cast<double>(rttUs);
+        }
+        if (state.sent == packetCount_ && state.outstanding == 0) Complete(target);
+    }
+
+    void RunTimers() {
+        const auto now = Clock::now();
+        while (!timers_.empty() && timers_.top().when <= now) {
+            const PacketTimer timer = timers_.top();
+            timers_.pop();
+            Reachability& state = targets_[timer.target];
+            if (!state.active) continue;
+            if (timer.packet < 0) {
+                Send(timer.target);
+                continue;
+            }
+            if (!state.pending[timer.packet]) continue;
+            state.pending[timer.packet] = 0; // Lost
+            state.outstanding--;
+            if (state.sent == packetCount_ && state.outstanding == 0) Complete(timer.target);
+        }
+    }
+
+    // Every packet has been answered or given up on
+    void Complete(int target) {
+        Reachability& state = targets_[target];
+        ReachabilityResult& result = results_[target];
+        long long status = REACH_STATUS_OK;
+        if (result.received == 0) {
+            if (state.refused) status = REACH_STATUS_REFUSED;
+            else if (ReachStatusForError(state.lastError) == REACH_STATUS_UNREACHABLE) status = REACH_STATUS_UNREACHABLE;
+            else status = REACH_STATUS_NO_REPLY;
+        }
+        Finish(target, status, state.lastError != 0 || status == REACH_STATUS_OK ? state.lastError : ETIMEDOUT);
+    }
+
+    void Finish(int target, long long status, int error) {
+        Reachability& state = targets_[target];
+        ReachabilityResult& result = results_[target];
+        result.status = status;
+        result.error = error;
+        result.sent = state.sent;
+        if (result.received > 0) {
+            const double mean = static_cast<double>(state.sumUs) / static_cast<double>(result.received);
+            result.avgUs = static_cast<long long>(mean);
+            result.mdevUs = static_cast<long long>(std::sqrt(std::max(0.0, state.sumSquaresUs / static_cast<double>(result.received) - mean * mean)));
+        }
+        if (state.socket != InvalidSocket) {
+            loop_.Remove(state.socket);
+            superpanel::CloseSocket(state.socket);
+            state.socket = InvalidSocket;
+        }
+        state.active = false;
+        active_--;
+    }
+
+    static const size_t MaxDatagramBytes = 2048;
+
+    const bool icmp_;
+    const char* const* hosts_;
+    const int* ports_;
+    const char* const* payloads_;
+    const int* payloadLengths_;
+    const int packetCount_;
+    const std::chrono::milliseconds interval_;
+    const std::chrono::milliseconds timeout_;
+    ReachabilityResult* results_;
+
+    EventLoop loop_;
+    AsyncResolver resolver_;
+    std::vector<Reachability> targets_;
+    std::priority_queue<PacketTimer, std::vector<PacketTimer>, std::greater<PacketTimer>> timers_;
+    size_t active_ = 0;
+};
+
+} // namespace
+
+extern "C" {
+
+SUPERPANEL_API int CheckPorts(const char* const* hosts, const int* ports, const int* timeoutsMs, int count, PortCheckResult* results) {
+    if (count <= 0) return 0;
+    if (hosts == NULL || ports == NULL || results == NULL || !superpanel::InitializeSockets()) return -1;
+
+    PortChecker checker(hosts, ports, timeoutsMs, results);
+    if (!checker.Run(count)) return -1;
+    int open = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].status == PORT_STATUS_OPEN) open++;
+    }
+    return open;
+}
+
+SUPERPANEL_API int CheckPings(const char* const* hosts, int count, int packetCount, int intervalMs, int timeoutMs,
+                              ReachabilityResult* results) {
+    if (count <= 0) return 0;
+    if (hosts == NULL || results == NULL || !superpanel::InitializeSockets()) return -1;
+
+    DatagramChecker checker(true, hosts, NULL, NULL, NULL, packetCount, intervalMs, timeoutMs, results);
+    if (!checker.Run(count)) return -1;
+    int replied = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].status == REACH_STATUS_OK) replied++;
+    }
+    return replied;
+}
+
+SUPERPANEL_API int CheckUdpPorts(const char* const* hosts, const int* ports, const char* const* payloads, const int* payloadLengths,
+                                 int count, int packetCount, int intervalMs, int timeoutMs, ReachabilityResult* results) {
+    if (count <= 0) return 0;
+    if (hosts == NULL || ports == NULL || results == NULL || !superpanel::InitializeSockets()) return -1;
+
+    DatagramChecker checker(false, hosts, ports, payloads, payloadLengths, packetCount, intervalMs, timeoutMs, results);
+    if (!checker.Run(count)) return -1;
+    int replied = 0;
+    for (int i = 0; i < count; i++) {
+        if (results[i].status == REACH_STATUS_OK) replied++;
+    }
+    return replied;
+}
+
+} // extern "C"
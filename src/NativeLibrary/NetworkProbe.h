@@ -0,0 +1,77 @@
+#pragma once
+
+#include "SystemMonitor.h"
+
+// Outcome of a TCP port check
+#define PORT_STATUS_CLOSED      0 // Connection refused
+#define PORT_STATUS_OPEN        1
+#define PORT_STATUS_TIMEOUT     2 // No answer within the timeout
+#define PORT_STATUS_UNREACHABLE 3 // Host or network unreachable
+#define PORT_STATUS_ERROR       4 // Invalid address or port, or no socket available
+#define PORT_STATUS_UNRESOLVED  5 // Name does not exist (ENOENT) or DNS timed out (ETIMEDOUT)
+
+struct PortCheckResult {
+    long long status; // PORT_STATUS_*
+    long long rttUs;  // Time to the SYN-ACK (open) or RST (closed); -1 otherwise
+    long long error;  // errno-style code of the failure, 0 if open
+};
+
+// Outcome of an ICMP echo or UDP request/response check
+#define REACH_STATUS_OK          0 // At least one reply
+#define REACH_STATUS_NO_REPLY    1 // Every packet lost
+#define REACH_STATUS_REFUSED     2 // UDP: the host answered with port unreachable
+#define REACH_STATUS_UNREACHABLE 3 // Host or network unreachable
+#define REACH_STATUS_ERROR       4 // Invalid arguments, or ICMP sockets not permitted (EACCES)
+#define REACH_STATUS_UNRESOLVED  5
+
+struct ReachabilityResult {
+    long long status;   // REACH_STATUS_*
+    long long sent;     // Packets sent
+    long long received; // Replies matched to a packet in time
+    // Round trips of the replies, -1 without any; mdev is their standard
+    // deviation, as ping reports it
+    long long minUs;
+    long long avgUs;
+    long long maxUs;
+    long long mdevUs;
+    long long error; // errno-style code of the last failure, 0 if none
+};
+
+extern "C" {
+    // Checks count TCP endpoints at once with non-blocking connects on one
+    // event loop (epoll, or WSAPoll on Windows), so a batch takes about as
+    // long as its slowest check rather than the sum of them. Each check has
+    // its own timeout (timeoutsMs may be NULL for 3 s each), covering name
+    // resolution and the connect. Sockets are closed with an RST, leaving no
+    // TIME_WAIT behind. hosts are IPv4 or IPv6 literals or host names, looked
+    // up through the DnsResolver cache on the same loop; a name's addresses
+    // are tried IPv4 first until one is reachable. Blocks until every check
+    // has finished; returns the number of open ports, or -1 if the event
+    // loop cannot be created.
+    SUPERPANEL_API int CheckPorts(const char* const* hosts, const int* ports, const int* timeoutsMs, int count, PortCheckResult* results);
+
+    // Sends packetCount ICMP echo requests to each host, intervalMs apart
+    // (<= 0 for 200 ms), on one event loop like CheckPorts, and waits up to
+    // timeoutMs (<= 0 for 1 s) for each reply. Uses unprivileged ICMP
+    // datagram sockets, so the process's group must be inside
+    // net.ipv4.ping_group_range; otherwise every host reports
+    // REACH_STATUS_ERROR with EACCES. Windows has no such sockets and
+    // reports EPROTONOSUPPORT. packetCount <= 0 means 4 (at most 100).
+    // Returns the number of hosts that replied, or -1 if the event loop
+    // cannot be created.
+    SUPERPANEL_API int CheckPings(const char* const* hosts, int count, int packetCount, int intervalMs, int timeoutMs,
+                                  ReachabilityResult* results);
+
+    // The same for UDP services: each packet is a request datagram and any
+    // datagram back is its reply. payloadLengths[i] >= 0 sends payloads[i]
+    // as raw bytes, and a reply is credited to the latest request still
+    // waiting, so raw checks want an interval above the round trip. Otherwise
+    // (or with payloadLengths NULL) payloads[i] names a template whose
+    // replies are matched by id: "dns" (an NS query for the root zone, which
+    // any nameserver answers in some form) or "ntp" (a client request);
+    // NULL or "" picks one by port (53, 123), else an empty datagram. A port
+    // unreachable answer makes the check REACH_STATUS_REFUSED unless another
+    // packet got a reply.
+    SUPERPANEL_API int CheckUdpPorts(const char* const* hosts, const int* ports, const char* const* payloads, const int* payloadLengths,
+                                     int count, int packetCount, int intervalMs, int timeoutMs, ReachabilityResult* results);
+}
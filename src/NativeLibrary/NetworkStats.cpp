@@ -0,0 +1,329 @@
+#include "pch.h"
+#include "NetworkStats.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Order of the counters in RawSample and InterfaceStats
+enum Counter { RxBytes, RxPackets, RxErrors, RxDropped, TxBytes, TxPackets, TxErrors, TxDropped, CounterCount };
+
+const auto MinRateInterval = std::chrono::milliseconds(250);
+
+struct RawSample {
+    std::string name;
+    long long index = 0; // Interface index; a new one means the link was recreated
+    int kind = INTERFACE_KIND_VIRTUAL;
+    bool up = false;
+    uint64_t counters[CounterCount] = {};
+};
+
+// Counters can be 32 bits wide even inside 64-bit fields (drivers that keep
+// 32-bit stats, /proc/net/dev on 32-bit kernels). A drop is a 32-bit wrap
+// only from the top quarter of that range to the bottom one; any other drop
+// means the counter was reset (link recreated, driver reloaded) and counts
+// from zero.
+uint64_t CounterDelta(uint64_t previous, uint64_t current) {
+    if (current >= previous) return current - previous;
+    const uint64_t quarter = 1ULL << 30;
+    if (previous <= UINT32_MAX && previous >= UINT32_MAX - quarter && current < quarter) return current + (1ULL << 32) - previous;
+    return current;
+}
+
+#ifdef _WIN32
+
+void CopyName(const wchar_t* alias, std::string& name) {
+    char buffer[256];
+    int length = WideCharToMultiByte(CP_UTF8, 0, alias, -1, buffer, sizeof(buffer), NULL, NULL);
+    name.assign(buffer, length > 0 ? static_cast<size_t>(length - 1) : 0);
+}
+
+bool ReadInterfaces(std::vector<RawSample>& samples) {
+    MIB_IF_TABLE2* table = nullptr;
+    if (GetIfTable2(&table) != NO_ERROR) return false;
+    for (ULONG i = 0; i < table->NumEntries; i++) {
+        const MIB_IF_ROW2& row = table->Table[i];
+        // Filter drivers (QoS, WFP, LightWeight Filter) repeat their adapter's traffic
+        if (row.InterfaceAndOperStatusFlags.FilterInterface) continue;
+        RawSample sample;
+        CopyName(row.Alias, sample.name);
+        sample.index = row.InterfaceIndex;
+        sample.up = row.OperStatus == IfOperStatusUp;
+        if (row.Type == IF_TYPE_SOFTWARE_LOOPBACK) sample.kind = INTERFACE_KIND_LOOPBACK;
+        else if (row.InterfaceAndOperStatusFlags.HardwareInterface) sample.kind = INTERFACE_KIND_PHYSICAL;
+        else if (row.Type == IF_TYPE_BRIDGE) sample.kind = INTERFACE_KIND_BRIDGE;
+        sample.counters[RxBytes] = row.InOctets;
+        sample.counters[RxPackets] = row.InUcastPkts + row.InNUcastPkts;
+        sample.counters[RxErrors] = row.InErrors;
+        sample.counters[RxDropped] = row.InDiscards;
+        sample.counters[TxBytes] = row.OutOctets;
+        sample.counters[TxPackets] = row.OutUcastPkts + row.OutNUcastPkts;
+        sample.counters[TxErrors] = row.OutErrors;
+        sample.counters[TxDropped] = row.OutDiscards;
+        samples.push_back(sample);
+    }
+    FreeMibTable(table);
+    return true;
+}
+
+#else
+
+// IF_OPER_* from RFC 2863; linux/if.h defines them but clashes with net/if.h
+const uint8_t OperStateUnknown = 0;
+const uint8_t OperStateUp = 6;
+
+bool PathExists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// Links without a rtnetlink kind are physical if sysfs shows a device behind them
+int ClassifyLink(const std::string& name, const std::string& linkKind, bool loopback) {
+    if (loopback) return INTERFACE_KIND_LOOPBACK;
+    if (linkKind == "bridge") return INTERFACE_KIND_BRIDGE;
+    if (linkKind == "veth") return INTERFACE_KIND_VETH;
+    if (!linkKind.empty()) return INTERFACE_KIND_VIRTUAL;
+    return PathExists("/sys/class/net/" + name + "/device") ? INTERFACE_KIND_PHYSICAL : INTERFACE_KIND_VIRTUAL;
+}
+
+void ParseLink(const nlmsghdr* header, std::vector<RawSample>& samples) {
+    const auto* info = static_cast<const ifinfomsg*>(NLMSG_DATA(header));
+    RawSample sample;
+    sample.index = info->ifi_index;
+    sample.up = (info->ifi_flags & IFF_RUNNING) != 0;
+    std::string linkKind;
+    bool haveStats64 = false;
+
+    int length = IFLA_PAYLOAD(header);
+    for (const rtattr* attribute = IFLA_RTA(info); RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length)) {
+        const void* data = RTA_DATA(attribute);
+        const size_t size = RTA_PAYLOAD(attribute);
+        switch (attribute->rta_type) {
+        case IFLA_IFNAME:
+            sample.name.assign(static_cast<const char*>(data), strnlen(static_cast<const char*>(data), size));
+            break;
+        case IFLA_OPERSTATE:
+            // Links that do not track carrier report UNKNOWN; IFF_RUNNING covers those
+            if (size >= 1 && *static_cast<const uint8_t*>(data) != OperStateUnknown) sample.up = *static_cast<const uint8_t*>(data) == OperStateUp;
+            break;
+        case IFLA_STATS64:
+            if (size >= sizeof(rtnl_link_stats64)) {
+                rtnl_link_stats64 stats;
+                memcpy(&stats, data, sizeof(stats));
+                const uint64_t values[CounterCount] = {stats.rx_bytes, stats.rx_packets, stats.rx_errors, stats.rx_dropped,
+                                                       stats.tx_bytes, stats.tx_packets, stats.tx_errors, stats.tx_dropped};
+                memcpy(sample.counters, values, sizeof(values));
+                haveStats64 = true;
+            }
+            break;
+        case IFLA_STATS:
+            if (size >= sizeof(rtnl_link_stats) && !haveStats64) {
+                rtnl_link_stats stats;
+                memcpy(&stats, data, sizeof(stats));
+                const uint64_t values[CounterCount] = {stats.rx_bytes, stats.rx_packets, stats.rx_errors, stats.rx_dropped,
+                                                       stats.tx_bytes, stats.tx_packets, stats.tx_errors, stats.tx_dropped};
+                memcpy(sample.counters, values, sizeof(values));
+            }
+            break;
+        case IFLA_LINKINFO: {
+            int nestedLength = static_cast<int>(size);
+            for (const rtattr* nested = static_cast<const rtattr*>(data); RTA_OK(nested, nestedLength); nested = RTA_NEXT(nested, nestedLength)) {
+                if (nested->rta_type != IFLA_INFO_KIND) continue;
+                linkKind.assign(static_cast<const char*>(RTA_DATA(nested)), strnlen(static_cast<const char*>(RTA_DATA(nested)), RTA_PAYLOAD(nested)));
+            }
+            break;
+        }
+        }
+    }
+    if (sample.name.empty()) return;
+    sample.kind = ClassifyLink(sample.name, linkKind, (info->ifi_flags & IFF_LOOPBACK) != 0);
+    samples.push_back(sample);
+}
+
+// One RTM_GETLINK dump returns every link with binary 64-bit counters
+bool ReadNetlink(std::vector<RawSample>& samples) {
+    int socketHandle = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (socketHandle < 0) return false;
+
+    struct {
+        nlmsghdr header;
+        ifinfomsg info;
+    } request = {};
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = RTM_GETLINK;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = 1;
+    request.info.ifi_family = AF_UNSPEC;
+
+    bool done = false, failed = send(socketHandle, &request, sizeof(request), 0) < 0;
+    std::vector<char> buffer(32768);
+    while (!done && !failed) {
+        ssize_t received = recv(socketHandle, buffer.data(), buffer.size(), 0);
+        if (received <= 0) {
+            failed = !(received < 0 && errno == EINTR);
+            continue;
+        }
+        int remaining = static_cast<int>(received);
+        for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer.data()); NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_type == NLMSG_DONE) done = true;
+            else if (header->nlmsg_type == NLMSG_ERROR) failed = true;
+            else if (header->nlmsg_type == RTM_NEWLINK) ParseLink(header, samples);
+        }
+    }
+    close(socketHandle);
+    if (failed) samples.clear();
+    return !failed;
+}
+
+// Fallback where netlink is unavailable (restricted sandboxes)
+bool ReadProcNetDev(std::vector<RawSample>& samples) {
+    FILE* file = fopen("/proc/net/dev", "r");
+    if (file == NULL) return false;
+    char line[512];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (++lineNumber <= 2) continue; // Headers
+        char* colon = strchr(line, ':');
+        if (colon == NULL) continue;
+        *colon = '\0';
+        RawSample sample;
+        const char* name = line + strspn(line, " ");
+        sample.name = name;
+        // rx: bytes packets errs drop fifo frame compressed multicast, then tx
+        uint64_t fields[16] = {};
+        char* cursor = colon + 1;
+        for (uint64_t& field : fields) field = strtoull(cursor, &cursor, 10);
+        const int columns[CounterCount] = {0, 1, 2, 3, 8, 9, 10, 11};
+        for (int i = 0; i < CounterCount; i++) sample.counters[i] = fields[columns[i]];
+
+        sample.index = if_nametoindex(name);
+        char path[128], state[32] = "";
+        snprintf(path, sizeof(path), "/sys/class/net/%s/operstate", name);
+        if (FILE* operstate = fopen(path, "r")) {
+            if (fgets(state, sizeof(state), operstate) == NULL) state[0] = '\0';
+            fclose(operstate);
+        }
+        sample.up = strncmp(state, "up", 2) == 0 || strncmp(state, "unknown", 7) == 0;
+        std::string base = std::string("/sys/class/net/") + name;
+        const bool loopback = sample.name == "lo";
+        sample.kind = PathExists(base + "/bridge")         ? INTERFACE_KIND_BRIDGE
+                      : sample.name.compare(0, 4, "veth") == 0 ? INTERFACE_KIND_VETH
+                                                             : ClassifyLink(sample.name, "", loopback);
+        samples.push_back(sample);
+    }
+    fclose(file);
+    return true;
+}
+
+bool ReadInterfaces(std::vector<RawSample>& samples) {
+    return ReadNetlink(samples) || ReadProcNetDev(samples);
+}
+
+#endif
+
+struct History {
+    long long index = 0;
+    uint64_t last[CounterCount] = {};  // Raw counters at the previous sample
+    uint64_t total[CounterCount] = {}; // Wrap-corrected running totals
+    uint64_t rateBase[CounterCount] = {};
+    Clock::time_point rateTime;
+    double rates[CounterCount] = {};
+    Clock::time_point seen;
+};
+
+std::mutex historyLock;
+std::unordered_map<std::string, History> history;
+
+} // namespace
+
+namespace superpanel {
+
+bool SampleInterfaces(std::vector<InterfaceStats>& interfaces) {
+    std::vector<RawSample> samples;
+    if (!ReadInterfaces(samples)) return false;
+
+    const auto now = Clock::now();
+    std::lock_guard<std::mutex> guard(historyLock);
+    interfaces.clear();
+    for (const RawSample& sample : samples) {
+        auto found = history.find(sample.name);
+        if (found == history.end() || found->second.index != sample.index) {
+            History& fresh = history[sample.name];
+            fresh = History();
+            fresh.index = sample.index;
+            memcpy(fresh.last, sample.counters, sizeof(fresh.last));
+            memcpy(fresh.total, sample.counters, sizeof(fresh.total));
+            memcpy(fresh.rateBase, sample.counters, sizeof(fresh.rateBase));
+            fresh.rateTime = now;
+            found = history.find(sample.name);
+        }
+        History& entry = found->second;
+        entry.seen = now;
+        for (int i = 0; i < CounterCount; i++) {
+            entry.total[i] += CounterDelta(entry.last[i], sample.counters[i]);
+            entry.last[i] = sample.counters[i];
+        }
+        const double elapsed = std::chrono::duration<double>(now - entry.rateTime).count();
+        if (now - entry.rateTime >= MinRateInterval) {
+            for (int i = 0; i < CounterCount; i++) {
+                entry.rates[i] = static_cast<double>(entry.total[i] - entry.rateBase[i]) / elapsed;
+                entry.rateBase[i] = entry.total[i];
+            }
+            entry.rateTime = now;
+        }
+
+        InterfaceStats stats = {};
+        snprintf(stats.name, sizeof(stats.name), "%s", sample.name.c_str());
+        stats.kind = sample.kind;
+        stats.up = sample.up ? 1 : 0;
+        long long* totals[CounterCount] = {&stats.rxBytes, &stats.rxPackets, &stats.rxErrors, &stats.rxDropped,
+                                           &stats.txBytes, &stats.txPackets, &stats.txErrors, &stats.txDropped};
+        double* rates[CounterCount] = {&stats.rxBytesPerSecond, &stats.rxPacketsPerSecond, &stats.rxErrorsPerSecond, &stats.rxDroppedPerSecond,
+                                       &stats.txBytesPerSecond, &stats.txPacketsPerSecond, &stats.txErrorsPerSecond, &stats.txDroppedPerSecond};
+        for (int i = 0; i < CounterCount; i++) {
+            *totals[i] = static_cast<long long>(entry.total[i]);
+            *rates[i] = entry.rates[i];
+        }
+        interfaces.push_back(stats);
+    }
+    // Forget links that are gone (containers come and go)
+    for (auto it = history.begin(); it != history.end();) it = it->second.seen != now ? history.erase(it) : std::next(it);
+    return true;
+}
+
+} // namespace superpanel
+
+extern "C" {
+
+SUPERPANEL_API int GetInterfaceStats(InterfaceStats* stats, int maxCount) {
+    std::vector<InterfaceStats> interfaces;
+    if (!superpanel::SampleInterfaces(interfaces)) return -1;
+    for (size_t i = 0; stats != NULL && i < interfaces.size() && i < static_cast<size_t>(maxCount > 0 ? maxCount : 0); i++) stats[i] = interfaces[i];
+    return static_cast<int>(interfaces.size());
+}
+
+} // extern "C"
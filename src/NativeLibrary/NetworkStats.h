@@ -0,0 +1,40 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include <vector>
+
+// What kind of link an interface is
+#define INTERFACE_KIND_PHYSICAL 0 // Backed by a device (NIC, Wi-Fi, virtio)
+#define INTERFACE_KIND_VIRTUAL  1 // Software link: tun, VLAN, bond, WireGuard...
+#define INTERFACE_KIND_BRIDGE   2
+#define INTERFACE_KIND_VETH     3 // Either end of a veth pair (containers)
+#define INTERFACE_KIND_LOOPBACK 4
+
+struct InterfaceStats {
+    char name[64];
+    long long kind; // INTERFACE_KIND_*
+    long long up;   // 1 if operationally up
+    // Cumulative since the interface appeared, carried across 32-bit wraps
+    long long rxBytes, rxPackets, rxErrors, rxDropped;
+    long long txBytes, txPackets, txErrors, txDropped;
+    // Per second since the previous sample, 0 on the first one
+    double rxBytesPerSecond, rxPacketsPerSecond, rxErrorsPerSecond, rxDroppedPerSecond;
+    double txBytesPerSecond, txPacketsPerSecond, txErrorsPerSecond, txDroppedPerSecond;
+};
+
+extern "C" {
+    // Samples every interface's counters (netlink RTM_GETLINK with 64-bit
+    // stats, falling back to /proc/net/dev; GetIfTable2 on Windows) and fills
+    // up to maxCount entries. Rates cover the time since the previous sample
+    // by any caller; samples less than 250 ms apart return the previous rates
+    // rather than rates over a sliver. Returns the number of interfaces, which
+    // may exceed maxCount, or -1 if the counters cannot be read.
+    SUPERPANEL_API int GetInterfaceStats(InterfaceStats* stats, int maxCount);
+}
+
+namespace superpanel {
+
+// GetInterfaceStats for every interface; false if the counters cannot be read
+bool SampleInterfaces(std::vector<InterfaceStats>& interfaces);
+
+} // namespace superpanel
@@ -0,0 +1,332 @@
+#include "pch.h"
+#include "Sketches.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace superpanel {
+
+namespace {
+
+int LeadingZeros(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<uint32_t>(value >> 32))) return 31 - static_cast<int>(index);
+    _BitScanReverse(&index, static_cast<uint32_t>(value));
+    return 63 - static_cast<int>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<int>(index);
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+const uint8_t SparseFormat = 0;
+const uint8_t DenseFormat = 1;
+
+} // namespace
+
+bool ByteReader::ReadBytes(void* target, size_t length) {
+    if (remaining_ < length) return false;
+    memcpy(target, data_, length);
+    data_ += length;
+    remaining_ -= length;
+    return true;
+}
+
+void HyperLogLog::AddHash(uint64_t hash) {
+    uint32_t index = static_cast<uint32_t>(hash >> (64 - Precision));
+    // The sentinel bit caps the rank at 64 - Precision + 1
+    uint64_t rest = (hash << Precision) | (uint64_t(1) << (Precision - 1));
+    SetRegister(index, static_cast<uint8_t>(LeadingZeros(rest) + 1));
+}
+
+void HyperLogLog::SetRegister(uint32_t index, uint8_t rank) {
+    if (!dense_.empty()) {
+        if (dense_[index] < rank) dense_[index] = rank;
+        return;
+    }
+
+    uint32_t entry = (index << 8) | rank;
+    auto it = std::lower_bound(sparse_.begin(), sparse_.end(), index << 8);
+    if (it != sparse_.end() && (*it >> 8) == index) {
+        if ((*it & 0xFF) < rank) *it = entry;
+        return;
+    }
+    sparse_.insert(it, entry);
+    if (sparse_.size() > SparseLimit) ToDense();
+}
+
+void HyperLogLog::ToDense() {
+    dense_.assign(Registers, 0);
+    for (uint32_t entry : sparse_) dense_[entry >> 8] = static_cast<uint8_t>(entry & 0xFF);
+    sparse_.clear();
+    sparse_.shrink_to_fit();
+}
+
+void HyperLogLog::Merge(const HyperLogLog& other) {
+    if (!other.dense_.empty()) {
+        if (dense_.empty()) ToDense();
+        for (uint32_t i = 0; i < Registers; i++) {
+            if (dense_[i] < other.dense_[i]) dense_[i] = other.dense_[i];
+        }
+        return;
+    }
+    for (uint32_t entry : other.sparse_) SetRegister(entry >> 8, static_cast<uint8_t>(entry & 0xFF));
+}
+
+uint64_t HyperLogLog::Estimate() const {
+    const double m = Registers;
+    if (dense_.empty()) {
+        // Few registers set: linear counting is the accurate estimator here
+        double zeros = m - static_cast<double>(sparse_.size());
+        return static_cast<uint64_t>(std::llround(m * std::log(m / zeros)));
+    }
+
+    double sum = 0;
+    uint32_t zeros = 0;
+    for (uint8_t rank : dense_) {
+        sum += std::ldexp(1.0, -rank);
+        zeros += rank == 0;
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) estimate = m * std::log(m / zeros);
+    return static_cast<uint64_t>(std::llround(estimate));
+}
+
+void HyperLogLog::Serialize(std::string& out) const {
+    ByteWriter writer(out);
+    if (dense_.empty()) {
+        writer.Write(SparseFormat);
+        writer.Write(static_cast<uint32_t>(sparse_.size()));
+        writer.WriteBytes(sparse_.data(), sparse_.size() * sizeof(uint32_t));
+    } else {
+        writer.Write(DenseFormat);
+        writer.WriteBytes(dense_.data(), dense_.size());
+    }
+}
+
+bool HyperLogLog::Deserialize(ByteReader& reader) {
+    uint8_t format;
+    if (!reader.Read(format)) return false;
+    sparse_.clear();
+    dense_.clear();
+
+    if (format == DenseFormat) {
+        dense_.resize(Registers);
+        if (reader.ReadBytes(dense_.data(), dense_.size()) &&
+            std::all_of(dense_.begin(), dense_.end(), [](uint8_t rank) { return rank <= MaxRank; })) {
+            return true;
+        }
+        dense_.clear();
+        return false;
+    }
+    uint32_t count;
+    if (format != SparseFormat || !reader.Read(count) || count > SparseLimit) return false;
+    sparse_.resize(count);
+    if (!reader.ReadBytes(sparse_.data(), count * sizeof(uint32_t))) return false;
+    // Entries index the dense array when it is built: one per register, in
+    // range, in increasing order, with a rank AddHash could have produced
+    for (size_t i = 0; i < sparse_.size(); i++) {
+        const uint32_t index = sparse_[i] >> 8;
+        const uint32_t rank = sparse_[i] & 0xFF;
+        if (index >= Registers || rank == 0 || rank > MaxRank || (i > 0 && index <= (sparse_[i - 1] >> 8))) {
+            sparse_.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void CountMinSketch::Add(std::string_view key, uint64_t count) {
+    // Rows index with h1 + row * h2 (Kirsch and Mitzenmacher)
+    const uint64_t hash = XXH64(key.data(), key.size());
+    const uint32_t h1 = static_cast<uint32_t>(hash);
+    const uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    for (uint32_t row = 0; row < Depth; row++) counts_[row * Width + (h1 + row * h2) % Width] += count;
+}
+
+void CountMinSketch::Merge(const CountMinSketch& other) {
+    for (size_t i = 0; i < counts_.size(); i++) counts_[i] += other.counts_[i];
+}
+
+uint64_t CountMinSketch::Estimate(std::string_view key) const {
+    const uint64_t hash = XXH64(key.data(), key.size());
+    const uint32_t h1 = static_cast<uint32_t>(hash);
+    const uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+    uint64_t estimate = UINT64_MAX;
+    for (uint32_t row = 0; row < Depth; row++) estimate = std::min(estimate, counts_[row * Width + (h1 + row * h2) % Width]);
+    return estimate;
+}
+
+void CountMinSketch::Serialize(std::string& out) const {
+    ByteWriter(out).WriteBytes(counts_.data(), counts_.size() * sizeof(uint64_t));
+}
+
+bool CountMinSketch::Deserialize(ByteReader& reader) {
+    return reader.ReadBytes(counts_.data(), counts_.size() * sizeof(uint64_t));
+}
+
+uint64_t SpaceSaving::MinCount() const {
+    if (exact_ || counters_.size() < capacity_) return 0;
+    uint64_t minimum = UINT64_MAX;
+    for (const auto& entry : counters_) minimum = std::min(minimum, entry.second.count);
+    return minimum;
+}
+
+bool SpaceSaving::AddTo(CountMinSketch& sketch) const {
+    if (countMin_) {
+        sketch.Merge(*countMin_);
+        return true;
+    }
+    if (!exact_) return false;
+    for (const auto& entry : counters_) sketch.Add(entry.first, entry.second.count);
+    return true;
+}
+
+void SpaceSaving::Add(std::string_view key, uint64_t count) {
+    if (countMin_) countMin_->Add(key, count);
+    scratch_.assign(key.data(), key.size());
+    auto it = counters_.find(scratch_);
+    if (it != counters_.end()) {
+        it->second.count += count;
+        return;
+    }
+    if (counters_.size() < capacity_) {
+        counters_.emplace(scratch_, Counter{count, 0});
+        return;
+    }
+
+    if (exact_) {
+        // Last chance to seed the sketch with exact counts
+        CountMinSketch sketch;
+        AddTo(sketch);
+        sketch.Add(key, count);
+        countMin_ = std::move(sketch);
+        exact_ = false;
+    }
+
+    auto victim = counters_.begin();
+    for (auto candidate = counters_.begin(); candidate != counters_.end(); ++candidate) {
+        if (candidate->second.count < victim->second.count) victim = candidate;
+    }
+    uint64_t inherited = victim->second.count;
+    counters_.erase(victim);
+    counters_.emplace(scratch_, Counter{inherited + count, inherited});
+}
+
+void SpaceSaving::Merge(const SpaceSaving& other) {
+    // A key missing from one side may have occurred up to that side's minimum
+    const uint64_t ownMin = MinCount();
+    const uint64_t otherMin = other.MinCount();
+
+    std::unordered_map<std::string, Counter> merged;
+    merged.reserve(counters_.size() + other.counters_.size());
+    for (const auto& entry : counters_) {
+        auto match = other.counters_.find(entry.first);
+        Counter counter = match != other.counters_.end()
+            ? Counter{entry.second.count + match->second.count, entry.second.error + match->second.error}
+            : Counter{entry.second.count + otherMin, entry.second.error + otherMin};
+        merged.emplace(entry.first, counter);
+    }
+    for (const auto& entry : other.counters_) {
+        if (counters_.count(entry.first) != 0) continue;
+        merged.emplace(entry.first, Counter{entry.second.count + ownMin, entry.second.error + ownMin});
+    }
+
+    // The sketches merge if both sides' counts are covered by one
+    std::optional<CountMinSketch> sketch;
+    if (countMin_ || other.countMin_) {
+        sketch.emplace();
+        if (!AddTo(*sketch) || !other.AddTo(*sketch)) sketch.reset();
+    }
+    bool exact = exact_ && other.exact_;
+
+    capacity_ = std::max(capacity_, other.capacity_);
+    if (merged.size() > capacity_) {
+        if (exact) {
+            // Seeded from the merged counts, which are still exact here
+            sketch.emplace();
+            for (const auto& entry : merged) sketch->Add(entry.first, entry.second.count);
+            exact = false;
+        }
+        std::vector<std::pair<std::string, Counter>> ordered(merged.begin(), merged.end());
+        std::nth_element(ordered.begin(), ordered.begin() + static_cast<std::ptrdiff_t>(capacity_), ordered.end(),
+                         [](const auto& a, const auto& b) { return a.second.count > b.second.count; });
+        ordered.resize(capacity_);
+        merged.clear();
+        for (auto& entry : ordered) merged.emplace(std::move(entry.first), entry.second);
+    }
+    counters_.swap(merged);
+    exact_ = exact;
+    countMin_ = std::move(sketch);
+}
+
+std::vector<SpaceSaving::Entry> SpaceSaving::Top(size_t k) const {
+    std::vector<Entry> entries;
+    entries.reserve(counters_.size());
+    for (const auto& entry : counters_) {
+        // Both counts are upper bounds; the lower bound stays count - error
+        const uint64_t lower = entry.second.count - entry.second.error;
+        uint64_t count = entry.second.count;
+        if (countMin_) count = std::max(lower, std::min(count, countMin_->Estimate(entry.first)));
+        entries.push_back(Entry{entry.first, count, count - lower});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    });
+    if (entries.size() > k) entries.resize(k);
+    return entries;
+}
+
+void SpaceSaving::Serialize(std::string& out) const {
+    ByteWriter writer(out);
+    writer.Write(static_cast<uint32_t>(capacity_));
+    writer.Write(static_cast<uint32_t>(counters_.size()));
+    for (const auto& entry : counters_) {
+        writer.Write(static_cast<uint16_t>(entry.first.size()));
+        writer.WriteBytes(entry.first.data(), entry.first.size());
+        writer.Write(entry.second.count);
+        writer.Write(entry.second.error);
+    }
+    writer.Write(static_cast<uint8_t>((exact_ ? 1 : 0) | (countMin_ ? 2 : 0)));
+    if (countMin_) countMin_->Serialize(out);
+}
+
+bool SpaceSaving::Deserialize(ByteReader& reader, bool withCountMin) {
+    uint32_t capacity, count;
+    if (!reader.Read(capacity) || !reader.Read(count) || capacity == 0 || count > capacity) return false;
+    capacity_ = capacity;
+    counters_.clear();
+    exact_ = false;
+    countMin_.reset();
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t length;
+        if (!reader.Read(length)) return false;
+        std::string key(length, '\0');
+        Counter counter;
+        if (!reader.ReadBytes(&key[0], length) || !reader.Read(counter.count) || !reader.Read(counter.error)) return false;
+        if (counter.error > counter.count) return false;
+        counters_.emplace(std::move(key), counter);
+    }
+    if (!withCountMin) return true;
+
+    uint8_t flags;
+    if (!reader.Read(flags) || flags > 3) return false;
+    exact_ = (flags & 1) != 0;
+    if ((flags & 2) != 0) {
+        countMin_.emplace();
+        if (!countMin_->Deserialize(reader)) return false;
+    }
+    return true;
+}
+
+} // namespace superpanel
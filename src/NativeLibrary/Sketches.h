@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace superpanel {
+
+// Appends/reads the little-endian byte format shared by the sketches'
+// Serialize and Deserialize.
+class ByteWriter {
+public:
+    explicit ByteWriter(std::string& out) : out_(out) {}
+    template <typename T>
+    void Write(T value) { out_.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void WriteBytes(const void* data, size_t length) { out_.append(static_cast<const char*>(data), length); }
+
+private:
+    std::string& out_;
+};
+
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t length) : data_(data), remaining_(length) {}
+    template <typename T>
+    bool Read(T& value) { return ReadBytes(&value, sizeof(value)); }
+    bool ReadBytes(void* target, size_t length);
+    size_t Remaining() const { return remaining_; }
+
+private:
+    const char* data_;
+    size_t remaining_;
+};
+
+// Distinct-count estimator (HyperLogLog with 2^12 registers, ~1.6% standard
+// error). Small sets are kept as a sorted list of (register, rank) pairs and
+// only switch to the 4 KB dense array once that list would be larger, so the
+// many near-empty per-minute sketches cost a few bytes each.
+class HyperLogLog {
+public:
+    static const int Precision = 12;
+    static const uint32_t Registers = 1u << Precision;
+
+    void AddHash(uint64_t hash);
+    void Merge(const HyperLogLog& other);
+    uint64_t Estimate() const;
+
+    void Serialize(std::string& out) const;
+    bool Deserialize(ByteReader& reader);
+
+private:
+    static const size_t SparseLimit = Registers / 8;
+    // Leading zeros of the 64 - Precision hash bits left, plus one
+    static const uint8_t MaxRank = 64 - Precision + 1;
+
+    void SetRegister(uint32_t index, uint8_t rank);
+    void ToDense();
+
+    std::vector<uint32_t> sparse_; // (index << 8) | rank, sorted by index
+    std::vector<uint8_t> dense_;   // Empty while sparse
+};
+
+// Count-Min frequency sketch (Cormode and Muthukrishnan). Estimate never
+// undercounts, and overcounts by at most e / Width of the total added with
+// probability 1 - e^-Depth. Sketches merge by adding their counters.
+class CountMinSketch {
+public:
+    static const uint32_t Width = 256;
+    static const uint32_t Depth = 4;
+
+    CountMinSketch() : counts_(Width * Depth, 0) {}
+
+    void Add(std::string_view key, uint64_t count = 1);
+    void Merge(const CountMinSketch& other);
+    uint64_t Estimate(std::string_view key) const;
+
+    void Serialize(std::string& out) const;
+    bool Deserialize(ByteReader& reader);
+
+private:
+    std::vector<uint64_t> counts_; // Row-major, Depth rows of Width
+};
+
+// Space-Saving heavy hitters (Metwally et al.). Tracks at most `capacity`
+// keys; an untracked key evicts the smallest counter and inherits its count
+// as error, so every key with true frequency above total/capacity is present
+// and count - error <= true count <= count. Two summaries merge with the
+// bounds of Agarwal et al., "Mergeable Summaries".
+//
+// Until the first eviction the counts are exact. At that point a Count-Min
+// sketch is seeded from them and fed every later key, and Top reports the
+// smaller of the two upper bounds. Summaries that never fill up carry no
+// sketch.
+class SpaceSaving {
+public:
+    struct Entry {
+        std::string key;
+        uint64_t count;
+        uint64_t error;
+    };
+
+    explicit SpaceSaving(size_t capacity = 64) : capacity_(capacity) {}
+
+    void Add(std::string_view key, uint64_t count = 1);
+    void Merge(const SpaceSaving& other);
+    std::vector<Entry> Top(size_t k) const;
+
+    void Serialize(std::string& out) const;
+    // Summaries serialized before the Count-Min sketch was added have no
+    // exactness flag or sketch; read them with withCountMin false
+    bool Deserialize(ByteReader& reader, bool withCountMin = true);
+
+private:
+    struct Counter {
+        uint64_t count;
+        uint64_t error;
+    };
+
+    // Count an untracked key may have had; 0 while the counts are exact
+    uint64_t MinCount() const;
+    // Adds what this summary counted to sketch; false if that is not known
+    bool AddTo(CountMinSketch& sketch) const;
+
+    size_t capacity_;
+    std::unordered_map<std::string, Counter> counters_;
+    bool exact_ = true; // Nothing evicted or merged away yet
+    std::optional<CountMinSketch> countMin_;
+    std::string scratch_;
+};
+
+} // namespace superpanel
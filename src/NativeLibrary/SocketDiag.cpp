@@ -0,0 +1,403 @@
+#include "pch.h"
+#include "SocketDiag.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <iphlpapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using superpanel::InetSocketEntry;
+
+namespace {
+
+const unsigned char MappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+
+void MapIpv4(const void* ipv4, unsigned char* address) {
+    memcpy(address, MappedPrefix, sizeof(MappedPrefix));
+    memcpy(address + 12, ipv4, 4);
+}
+
+#ifdef _WIN32
+
+int StateFromMib(DWORD state) {
+    switch (state) {
+    case MIB_TCP_STATE_LISTEN: return TCP_STATE_LISTEN;
+    case MIB_TCP_STATE_SYN_SENT: return TCP_STATE_SYN_SENT;
+    case MIB_TCP_STATE_SYN_RCVD: return TCP_STATE_SYN_RECV;
+    case MIB_TCP_STATE_ESTAB: return TCP_STATE_ESTABLISHED;
+    case MIB_TCP_STATE_FIN_WAIT1: return TCP_STATE_FIN_WAIT1;
+    case MIB_TCP_STATE_FIN_WAIT2: return TCP_STATE_FIN_WAIT2;
+    case MIB_TCP_STATE_CLOSE_WAIT: return TCP_STATE_CLOSE_WAIT;
+    case MIB_TCP_STATE_CLOSING: return TCP_STATE_CLOSING;
+    case MIB_TCP_STATE_LAST_ACK: return TCP_STATE_LAST_ACK;
+    case MIB_TCP_STATE_TIME_WAIT: return TCP_STATE_TIME_WAIT;
+    default: return TCP_STATE_CLOSE;
+    }
+}
+
+// The table can grow between the size query and the copy; retry a few times
+bool ReadTable(ULONG family, bool tcp, std::vector<unsigned char>& buffer) {
+    for (int attempt = 0; attempt < 4; attempt++) {
+        DWORD size = static_cast<DWORD>(buffer.size());
+        void* table = buffer.empty() ? NULL : buffer.data();
+        DWORD result = tcp ? GetExtendedTcpTable(table, &size, FALSE, family, TCP_TABLE_OWNER_PID_ALL, 0)
+                           : GetExtendedUdpTable(table, &size, FALSE, family, UDP_TABLE_OWNER_PID, 0);
+        if (result == NO_ERROR) return true;
+        if (result != ERROR_INSUFFICIENT_BUFFER) return false;
+        buffer.resize(size + size / 8);
+    }
+    return false;
+}
+
+// UDP tables carry no peer or state: every socket is listed as unconnected
+int WalkUdpTables(uint32_t stateMask, const std::function<void(const InetSocketEntry&)>& visit) {
+    if ((stateMask & (1u << TCP_STATE_CLOSE)) == 0) return TCP_SOURCE_IPHELPER;
+    std::vector<unsigned char> buffer;
+    if (!ReadTable(AF_INET, false, buffer)) return 0;
+    const auto* table4 = reinterpret_cast<const MIB_UDPTABLE_OWNER_PID*>(buffer.data());
+    for (DWORD i = 0; i < table4->dwNumEntries; i++) {
+        const MIB_UDPROW_OWNER_PID& row = table4->table[i];
+        InetSocketEntry entry = {};
+        entry.state = TCP_STATE_CLOSE;
+        entry.localPort = ntohs(static_cast<u_short>(row.dwLocalPort));
+        MapIpv4(&row.dwLocalAddr, entry.localAddress);
+        entry.ownerPid = row.dwOwningPid;
+        visit(entry);
+    }
+
+    buffer.clear();
+    if (!ReadTable(AF_INET6, false, buffer)) return TCP_SOURCE_IPHELPER;
+    const auto* table6 = reinterpret_cast<const MIB_UDP6TABLE_OWNER_PID*>(buffer.data());
+    for (DWORD i = 0; i < table6->dwNumEntries; i++) {
+        const MIB_UDP6ROW_OWNER_PID& row = table6->table[i];
+        InetSocketEntry entry = {};
+        entry.state = TCP_STATE_CLOSE;
+        entry.ipv6 = true;
+        entry.localPort = ntohs(static_cast<u_short>(row.dwLocalPort));
+        memcpy(entry.localAddress, row.ucLocalAddr, 16);
+        entry.ownerPid = row.dwOwningPid;
+        visit(entry);
+    }
+    return TCP_SOURCE_IPHELPER;
+}
+
+int WalkTcpTables(uint32_t stateMask, const std::function<void(const InetSocketEntry&)>& visit) {
+    std::vector<unsigned char> buffer;
+    if (!ReadTable(AF_INET, true, buffer)) return 0;
+    const auto* table4 = reinterpret_cast<const MIB_TCPTABLE_OWNER_PID*>(buffer.data());
+    for (DWORD i = 0; i < table4->dwNumEntries; i++) {
+        const MIB_TCPROW_OWNER_PID& row = table4->table[i];
+        InetSocketEntry entry = {};
+        entry.state = static_cast<uint8_t>(StateFromMib(row.dwState));
+        if ((stateMask & (1u << entry.state)) == 0) continue;
+        entry.localPort = ntohs(static_cast<u_short>(row.dwLocalPort));
+        entry.remotePort = ntohs(static_cast<u_short>(row.dwRemotePort));
+        MapIpv4(&row.dwLocalAddr, entry.localAddress);
+        MapIpv4(&row.dwRemoteAddr, entry.remoteAddress);
+        entry.ownerPid = row.dwOwningPid;
+        visit(entry);
+    }
+
+    buffer.clear();
+    if (!ReadTable(AF_INET6, true, buffer)) return TCP_SOURCE_IPHELPER; // IPv6 may be disabled
+    const auto* table6 = reinterpret_cast<const MIB_TCP6TABLE_OWNER_PID*>(buffer.data());
+    for (DWORD i = 0; i < table6->dwNumEntries; i++) {
+        const MIB_TCP6ROW_OWNER_PID& row = table6->table[i];
+        InetSocketEntry entry = {};
+        entry.state = static_cast<uint8_t>(StateFromMib(row.dwState));
+        if ((stateMask & (1u << entry.state)) == 0) continue;
+        entry.ipv6 = true;
+        entry.localPort = ntohs(static_cast<u_short>(row.dwLocalPort));
+        entry.remotePort = ntohs(static_cast<u_short>(row.dwRemotePort));
+        memcpy(entry.localAddress, row.ucLocalAddr, 16);
+        memcpy(entry.remoteAddress, row.ucRemoteAddr, 16);
+        entry.ownerPid = row.dwOwningPid;
+        visit(entry);
+    }
+    return TCP_SOURCE_IPHELPER;
+}
+
+#else
+
+// Large enough for the kernel to pack a full dump skb into each recv
+const size_t DiagBufferSize = 64 * 1024;
+
+// Dumps one address family. Messages are read straight out of the receive
+// buffer; nothing is copied or allocated per socket.
+bool DumpFamily(int netlink, uint8_t family, int protocol, uint32_t stateMask, std::vector<char>& buffer, const std::function<void(const InetSocketEntry&)>& visit) {
+    struct {
+        nlmsghdr header;
+        inet_diag_req_v2 request;
+    } message = {};
+    message.header.nlmsg_len = sizeof(message);
+    message.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    message.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    message.header.nlmsg_seq = family;
+    message.request.sdiag_family = family;
+    message.request.sdiag_protocol = static_cast<uint8_t>(protocol);
+    message.request.idiag_states = stateMask;
+
+    if (send(netlink, &message, sizeof(message), 0) < 0) return false;
+    while (true) {
+        ssize_t received = recv(netlink, buffer.data(), buffer.size(), 0);
+        if (received < 0 && errno == EINTR) continue;
+        // A dump always ends in NLMSG_DONE; an empty read would spin forever
+        if (received <= 0) return false;
+        int remaining = static_cast<int>(received);
+        for (const nlmsghdr* header = reinterpret_cast<const nlmsghdr*>(buffer.data()); NLMSG_OK(header, remaining); header = NLMSG_NEXT(header, remaining)) {
+            if (header->nlmsg_type == NLMSG_DONE) return true;
+            if (header->nlmsg_type == NLMSG_ERROR) return false;
+            if (header->nlmsg_len < NLMSG_LENGTH(sizeof(inet_diag_msg))) continue;
+            const auto* socketInfo = static_cast<const inet_diag_msg*>(NLMSG_DATA(header));
+            InetSocketEntry entry = {};
+            entry.state = socketInfo->idiag_state;
+            entry.ipv6 = socketInfo->idiag_family == AF_INET6;
+            entry.localPort = ntohs(socketInfo->id.idiag_sport);
+            entry.remotePort = ntohs(socketInfo->id.idiag_dport);
+            if (entry.ipv6) {
+                memcpy(entry.localAddress, socketInfo->id.idiag_src, 16);
+                memcpy(entry.remoteAddress, socketInfo->id.idiag_dst, 16);
+            } else {
+                MapIpv4(socketInfo->id.idiag_src, entry.localAddress);
+                MapIpv4(socketInfo->id.idiag_dst, entry.remoteAddress);
+            }
+            entry.receiveQueue = socketInfo->idiag_rqueue;
+            entry.sendQueue = socketInfo->idiag_wqueue;
+            entry.uid = socketInfo->idiag_uid;
+            entry.inode = socketInfo->idiag_inode;
+            visit(entry);
+        }
+    }
+}
+
+int WalkSockDiag(int protocol, uint32_t stateMask, const std::function<void(const InetSocketEntry&)>& visit) {
+    int netlink = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+    if (netlink < 0) return 0;
+    std::vector<char> buffer(DiagBufferSize);
+    // The caller falls back to /proc only if nothing was visited yet, or
+    // the sockets seen so far would be counted twice
+    bool visited = false;
+    auto track = [&](const InetSocketEntry& entry) {
+        visited = true;
+        visit(entry);
+    };
+    bool ok = DumpFamily(netlink, AF_INET, protocol, stateMask, buffer, track);
+    // A kernel without IPv6 answers the second dump with an error; keep the IPv4 half
+    if (ok) DumpFamily(netlink, AF_INET6, protocol, stateMask, buffer, track);
+    close(netlink);
+    return ok || visited ? TCP_SOURCE_SOCK_DIAG : 0;
+}
+
+inline unsigned HexDigit(char c) {
+    return c <= '9' ? static_cast<unsigned>(c - '0') : static_cast<unsigned>((c | 0x20) - 'a' + 10);
+}
+
+// Reads count hex digits; false on anything else
+bool ParseHex(const char*& cursor, const char* end, int count, uint32_t& value) {
+    if (end - cursor < count) return false;
+    value = 0;
+    for (int i = 0; i < count; i++, cursor++) {
+        if (!isxdigit(static_cast<unsigned char>(*cursor))) return false;
+        value = value << 4 | HexDigit(*cursor);
+    }
+    return true;
+}
+
+// "0100007F:1F90": the kernel prints each 32-bit word of the address in host
+// order, so copying the parsed words back gives the bytes in network order
+bool ParseEndpoint(const char*& cursor, const char* end, bool ipv6, unsigned char* address, uint16_t& port) {
+    while (cursor < end && *cursor == ' ') cursor++;
+    uint32_t words[4];
+    const int count = ipv6 ? 4 : 1;
+    for (int i = 0; i < count; i++) {
+        if (!ParseHex(cursor, end, 8, words[i])) return false;
+    }
+    if (ipv6) memcpy(address, words, 16);
+    else MapIpv4(&words[0], address);
+    uint32_t value;
+    if (cursor >= end || *cursor++ != ':' || !ParseHex(cursor, end, 4, value)) return false;
+    port = static_cast<uint16_t>(value);
+    return true;
+}
+
+// /proc/net/{tcp,udp} lines: "sl local rem st tx:rx tr:when retrnsmt uid timeout inode ..."
+bool ParseProcLine(const char* cursor, const char* end, bool ipv6, InetSocketEntry& entry) {
+    cursor = static_cast<const char*>(memchr(cursor, ':', static_cast<size_t>(end - cursor)));
+    if (cursor == nullptr) return false;
+    cursor++;
+    entry = InetSocketEntry();
+    entry.ipv6 = ipv6;
+    if (!ParseEndpoint(cursor, end, ipv6, entry.localAddress, entry.localPort)) return false;
+    if (!ParseEndpoint(cursor, end, ipv6, entry.remoteAddress, entry.remotePort)) return false;
+    uint32_t state;
+    if (cursor >= end || *cursor++ != ' ' || !ParseHex(cursor, end, 2, state)) return false;
+    entry.state = static_cast<uint8_t>(state);
+
+    uint32_t sendQueue, receiveQueue;
+    if (cursor >= end || *cursor++ != ' ' || !ParseHex(cursor, end, 8, sendQueue)) return false;
+    if (cursor >= end || *cursor++ != ':' || !ParseHex(cursor, end, 8, receiveQueue)) return false;
+    entry.sendQueue = sendQueue;
+    entry.receiveQueue = receiveQueue;
+
+    // Skip tr:when and retrnsmt; then uid, timeout and inode in decimal
+    uint64_t fields[5] = {};
+    for (uint64_t& field : fields) {
+        while (cursor < end && *cursor == ' ') cursor++;
+        while (cursor < end && *cursor != ' ') field = field * 10 + static_cast<uint64_t>(*cursor++ - '0');
+    }
+    entry.uid = static_cast<uint32_t>(fields[2]);
+    entry.inode = fields[4];
+    return true;
+}
+
+bool WalkProcFile(const char* path, bool ipv6, uint32_t stateMask, const std::function<void(const InetSocketEntry&)>& visit) {
+    int file = open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0) return false;
+    // Read in large chunks, carrying any partial line over to the next one
+    std::vector<char> buffer(256 * 1024);
+    size_t filled = 0;
+    bool header = true;
+    while (true) {
+        ssize_t count = read(file, buffer.data() + filled, buffer.size() - filled);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+        filled += static_cast<size_t>(count);
+        const char* start = buffer.data();
+        const char* end = buffer.data() + filled;
+        while (const char* newline = static_cast<const char*>(memchr(start, '\n', static_cast<size_t>(end - start)))) {
+            InetSocketEntry entry;
+            if (!header && ParseProcLine(start, newline, ipv6, entry) && (stateMask & (1u << entry.state)) != 0) visit(entry);
+            header = false;
+            start = newline + 1;
+        }
+        filled = static_cast<size_t>(end - start);
+        memmove(buffer.data(), start, filled);
+        if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+    }
+    close(file);
+    return true;
+}
+
+int WalkProc(int protocol, uint32_t stateMask, const std::function<void(const InetSocketEntry&)>& visit) {
+    const bool tcp = protocol == SOCKET_PROTOCOL_TCP;
+    if (!WalkProcFile(tcp ? "/proc/net/tcp" : "/proc/net/udp", false, stateMask, visit)) return 0;
+    WalkProcFile(tcp ? "/proc/net/tcp6" : "/proc/net/udp6", true, stateMask, visit);
+    return TCP_SOURCE_PROC;
+}
+
+#endif
+
+struct AddressKey {
+    uint64_t high;
+    uint64_t low;
+    bool operator==(const AddressKey& other) const { return high == other.high && low == other.low; }
+};
+
+struct AddressKeyHash {
+    size_t operator()(const AddressKey& key) const { return std::hash<uint64_t>()(key.high * 0x9E3779B97F4A7C15ULL ^ key.low); }
+};
+
+void FormatAddress(const AddressKey& key, char* text, size_t size) {
+    unsigned char bytes[16];
+    memcpy(bytes, &key.high, 8);
+    memcpy(bytes + 8, &key.low, 8);
+    if (memcmp(bytes, MappedPrefix, sizeof(MappedPrefix)) == 0) inet_ntop(AF_INET, bytes + 12, text, static_cast<socklen_t>(size));
+    else inet_ntop(AF_INET6, bytes, text, static_cast<socklen_t>(size));
+}
+
+} // namespace
+
+namespace superpanel {
+
+int ForEachInetSocket(int protocol, uint32_t stateMask, const std::function<void(const InetSocketEntry&)>& visit) {
+#ifdef _WIN32
+    return protocol == SOCKET_PROTOCOL_TCP ? WalkTcpTables(stateMask, visit) : WalkUdpTables(stateMask, visit);
+#else
+    int source = WalkSockDiag(protocol, stateMask, visit);
+    return source != 0 ? source : WalkProc(protocol, stateMask, visit);
+#endif
+}
+
+} // namespace superpanel
+
+extern "C" {
+
+SUPERPANEL_API int GetTcpCensus(TcpCensus* census, TcpPortCount* ports, int maxPorts, int* portCount, TcpRemoteCount* remotes, int maxRemotes, int* remoteCount) {
+    if (census == NULL) return 0;
+    memset(census, 0, sizeof(*census));
+    if (portCount != NULL) *portCount = 0;
+    if (remoteCount != NULL) *remoteCount = 0;
+
+    const auto started = std::chrono::steady_clock::now();
+    // A flat table beats hashing for ports; only remote addresses need a map
+    std::vector<uint32_t> byPort(65536, 0);
+    std::unordered_map<AddressKey, long long, AddressKeyHash> byRemote;
+    const unsigned char wildcard[16] = {};
+
+    int source = superpanel::ForEachInetSocket(SOCKET_PROTOCOL_TCP, 0xFFFFFFFFu, [&](const InetSocketEntry& entry) {
+        census->total++;
+        if (entry.state < sizeof(census->states) / sizeof(census->states[0])) census->states[entry.state]++;
+        // Dual-stack sockets talking IPv4 show up in the IPv6 table
+        if (entry.ipv6 && memcmp(entry.localAddress, MappedPrefix, sizeof(MappedPrefix)) != 0) census->ipv6++;
+        else census->ipv4++;
+        if (entry.state == TCP_STATE_LISTEN) return;
+        byPort[entry.localPort]++;
+        if (memcmp(entry.remoteAddress, wildcard, 16) == 0) return;
+        AddressKey key;
+        memcpy(&key.high, entry.remoteAddress, 8);
+        memcpy(&key.low, entry.remoteAddress + 8, 8);
+        byRemote[key]++;
+    });
+    if (source == 0) return 0;
+    census->source = source;
+
+    if (ports != NULL && maxPorts > 0) {
+        std::vector<TcpPortCount> ranked;
+        for (size_t port = 0; port < byPort.size(); port++) {
+            if (byPort[port] > 0) ranked.push_back(TcpPortCount{static_cast<long long>(port), byPort[port]});
+        }
+        const size_t keep = std::min(ranked.size(), static_cast<size_t>(maxPorts));
+        std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(keep), ranked.end(),
+                          [](const TcpPortCount& a, const TcpPortCount& b) { return a.count != b.count ? a.count > b.count : a.port < b.port; });
+        std::copy(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(keep), ports);
+        if (portCount != NULL) *portCount = static_cast<int>(keep);
+    }
+
+    if (remotes != NULL && maxRemotes > 0) {
+        std::vector<std::pair<AddressKey, long long>> ranked(byRemote.begin(), byRemote.end());
+        const size_t keep = std::min(ranked.size(), static_cast<size_t>(maxRemotes));
+        std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(keep), ranked.end(),
+                          [](const std::pair<AddressKey, long long>& a, const std::pair<AddressKey, long long>& b) { return a.second > b.second; });
+        for (size_t i = 0; i < keep; i++) {
+            FormatAddress(ranked[i].first, remotes[i].address, sizeof(remotes[i].address));
+            remotes[i].count = ranked[i].second;
+        }
+        if (remoteCount != NULL) *remoteCount = static_cast<int>(keep);
+    }
+
+    census->elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+    return 1;
+}
+
+} // extern "C"
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "SystemMonitor.h"
+#include <cstdint>
+#include <functional>
+
+// Kernel TCP state numbers, which the census indexes its counts by
+#define TCP_STATE_ESTABLISHED 1
+#define TCP_STATE_SYN_SENT    2
+#define TCP_STATE_SYN_RECV    3
+#define TCP_STATE_FIN_WAIT1   4
+#define TCP_STATE_FIN_WAIT2   5
+#define TCP_STATE_TIME_WAIT   6
+#define TCP_STATE_CLOSE       7
+#define TCP_STATE_CLOSE_WAIT  8
+#define TCP_STATE_LAST_ACK    9
+#define TCP_STATE_LISTEN      10
+#define TCP_STATE_CLOSING     11
+
+// Where a socket listing came from
+#define TCP_SOURCE_SOCK_DIAG 1 // Netlink inet_diag dump
+#define TCP_SOURCE_PROC      2 // /proc/net/tcp and tcp6 (udp, udp6)
+#define TCP_SOURCE_IPHELPER  3 // GetExtendedTcpTable / GetExtendedUdpTable (Windows)
+
+// IP protocol numbers
+#define SOCKET_PROTOCOL_TCP 6
+#define SOCKET_PROTOCOL_UDP 17
+
+struct TcpCensus {
+    long long total;
+    long long states[12]; // By TCP_STATE_*; [0] is unused
+    long long ipv4;
+    long long ipv6;
+    long long source;    // TCP_SOURCE_*
+    long long elapsedUs; // Time spent walking the socket table
+};
+
+struct TcpPortCount {
+    long long port;
+    long long count;
+};
+
+struct TcpRemoteCount {
+    char address[48]; // IPv4-mapped IPv6 peers are shown as IPv4
+    long long count;
+};
+
+extern "C" {
+    // Counts every IPv4 and IPv6 TCP socket by state, and ranks connections
+    // (everything but listeners) by local port and by remote address. Reads a
+    // netlink sock_diag dump, parsed in place with no per-socket allocation,
+    // and falls back to /proc/net/tcp{,6} where sock_diag is unavailable.
+    // ports and remotes receive the busiest maxPorts / maxRemotes entries,
+    // busiest first, and *portCount / *remoteCount how many were written
+    // (either array may be NULL). Returns 1 on success, 0 on failure.
+    SUPERPANEL_API int GetTcpCensus(TcpCensus* census, TcpPortCount* ports, int maxPorts, int* portCount, TcpRemoteCount* remotes, int maxRemotes, int* remoteCount);
+}
+
+namespace superpanel {
+
+// One TCP or UDP socket. Addresses are IPv6, with IPv4 as ::ffff:a.b.c.d,
+// and ports are in host order.
+struct InetSocketEntry {
+    uint8_t state; // TCP_STATE_*; unconnected UDP sockets are TCP_STATE_CLOSE
+    bool ipv6;     // Reported by the IPv6 table (dual-stack sockets included)
+    uint16_t localPort;
+    uint16_t remotePort;
+    unsigned char localAddress[16];
+    unsigned char remoteAddress[16];
+    uint32_t receiveQueue; // Listeners: connections waiting to be accepted
+    uint32_t sendQueue;    // Listeners: the backlog (sock_diag only)
+    uint32_t uid;
+    uint64_t inode;    // Socket inode (Linux), matched against /proc/<pid>/fd
+    uint32_t ownerPid; // Owning process where the table reports it (Windows), else 0
+};
+
+// Walks every socket of protocol (SOCKET_PROTOCOL_*) whose state bit
+// (1 << TCP_STATE_*) is in stateMask. Returns the TCP_SOURCE_* used, or 0 if
+// no source could be read.
+int ForEachInetSocket(int protocol, uint32_t stateMask, const std::function<void(const InetSocketEntry&)>& visit);
+
+} // namespace superpanel
@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "SystemMonitor.h"
+#include "NetworkProbe.h"
+#include "NetworkStats.h"
 #include <iostream>
 #include <vector>
 #include <thread>
@@ -25,8 +27,10 @@
 #endif
 
 // Global variables for performance monitoring
+#ifdef _WIN32
 static PDH_HQUERY cpuQuery;
 static PDH_HCOUNTER cpuTotal;
+#endif
 static bool perfCountersInitialized = false;
 
 void InitializePerfCounters() {
@@ -240,68 +244,29 @@ SUPERPANEL_API int ListDirectory(const char* path, char** fileNames, int maxFile
 }
 
 SUPERPANEL_API int CheckPortStatus(const char* host, int port) {
-#ifdef _WIN32
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return 0;
-#endif
-    
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) return 0;
-    
-    struct sockaddr_in address;
-    address.sin_family = AF_INET;
-    address.sin_port = htons(port);
-    
-#ifdef _WIN32
-    address.sin_addr.s_addr = inet_addr(host);
-#else
-    inet_pton(AF_INET, host, &address.sin_addr);
-#endif
-    
-    int result = connect(sock, (struct sockaddr*)&address, sizeof(address));
-    
-#ifdef _WIN32
-    closesocket(sock);
-    WSACleanup();
-#else
-    close(sock);
-#endif
-    
-    return (result == 0) ? 1 : 0;
+    // A single-entry batch: non-blocking with the default timeout, rather
+    // than waiting out the kernel's SYN retries on an unreachable host
+    PortCheckResult result;
+    return CheckPorts(&host, &port, NULL, 1, &result) == 1 ? 1 : 0;
 }
 
 SUPERPANEL_API int GetNetworkStats(long long* bytesReceived, long long* bytesSent) {
-#ifdef _WIN32
-    // Windows implementation using SNMP or WMI would be complex
-    // This is a simplified placeholder
-    *bytesReceived = 0;
-    *bytesSent = 0;
-    return 1;
-#else
-    FILE* file = fopen("/proc/net/dev", "r");
-    if (file == NULL) return 0;
-    
-    char line[256];
+    std::vector<InterfaceStats> interfaces;
+    if (!superpanel::SampleInterfaces(interfaces)) return 0;
+
+    // Physical links carry the host's external traffic; bridges and veths
+    // would count container traffic twice. Hosts without any (containers
+    // themselves) count everything but loopback.
+    bool physical = false;
+    for (const InterfaceStats& link : interfaces) physical |= link.kind == INTERFACE_KIND_PHYSICAL;
     *bytesReceived = 0;
     *bytesSent = 0;
-    
-    // Skip header lines
-    fgets(line, sizeof(line), file);
-    fgets(line, sizeof(line), file);
-    
-    while (fgets(line, sizeof(line), file)) {
-        char interface[32];
-        long long rx_bytes, tx_bytes;
-        if (sscanf(line, "%31[^:]: %lld %*d %*d %*d %*d %*d %*d %*d %lld", interface, &rx_bytes, &tx_bytes) == 3) {
-            if (strcmp(interface, "lo") != 0) { // Skip loopback
-                *bytesReceived += rx_bytes;
-                *bytesSent += tx_bytes;
-            }
-        }
+    for (const InterfaceStats& link : interfaces) {
+        if (physical ? link.kind != INTERFACE_KIND_PHYSICAL : link.kind == INTERFACE_KIND_LOOPBACK) continue;
+        *bytesReceived += link.rxBytes;
+        *bytesSent += link.txBytes;
     }
-    fclose(file);
     return 1;
-#endif
 }
 
 } // extern "C"
\ No newline at end of file
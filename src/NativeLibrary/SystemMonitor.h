@@ -1,10 +1,14 @@
 #pragma once
 
+#ifdef _WIN32
 #ifdef SUPERPANELNATIVELIBRARY_EXPORTS
 #define SUPERPANEL_API __declspec(dllexport)
 #else
 #define SUPERPANEL_API __declspec(dllimport)
 #endif
+#else
+#define SUPERPANEL_API __attribute__((visibility("default")))
+#endif
 
 extern "C" {
     // System monitoring functions
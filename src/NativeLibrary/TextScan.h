@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define SUPERPANEL_SSE2 1
+#ifdef __AVX2__
+#include <immintrin.h>
+#define SUPERPANEL_AVX2 1
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SUPERPANEL_NEON 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace superpanel {
+
+// Vectorised byte scanning shared by the line indexer and the log parsers.
+// Everything works on 64-byte blocks and returns a bitmask with bit i set when
+// block[i] matches, so callers can count (PopCount) or walk (LowestBit) hits
+// without branching per byte.
+
+inline int PopCount(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+    return static_cast<int>(__popcnt(static_cast<uint32_t>(mask)) + __popcnt(static_cast<uint32_t>(mask >> 32)));
+#elif defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(mask));
+#else
+    return __builtin_popcountll(mask);
+#endif
+}
+
+inline int LowestBit(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_IX86)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<uint32_t>(mask))) return static_cast<int>(index);
+    _BitScanForward(&index, static_cast<uint32_t>(mask >> 32));
+    return static_cast<int>(index) + 32;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// Position of the n-th (0-based) set bit
+inline int NthSetBit(uint64_t mask, int n) {
+    while (n-- > 0) mask &= mask - 1;
+    return LowestBit(mask);
+}
+
+inline uint64_t MatchMask64(const char* block, char c) {
+#if defined(SUPERPANEL_AVX2)
+    const __m256i needle = _mm256_set1_epi8(c);
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    uint64_t maskLo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+    uint64_t maskHi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+    return maskLo | (maskHi << 32);
+#elif defined(SUPERPANEL_SSE2)
+    const __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16));
+        uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+        mask |= bits << (i * 16);
+    }
+    return mask;
+#elif defined(SUPERPANEL_NEON)
+    // NEON has no movemask: weight each matching lane by its bit and add
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t needle = vdupq_n_u8(static_cast<uint8_t>(c));
+    const uint8x16_t weight = vld1q_u8(weights);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(block + i * 16)), needle);
+        uint8x16_t bits = vandq_u8(eq, weight);
+        uint64_t lo = vaddv_u8(vget_low_u8(bits));
+        uint64_t hi = vaddv_u8(vget_high_u8(bits));
+        mask |= (lo | (hi << 8)) << (i * 16);
+    }
+    return mask;
+#else
+    uint64_t mask = 0;
+    for (int i = 0; i < 64; i++) {
+        if (block[i] == c) mask |= uint64_t(1) << i;
+    }
+    return mask;
+#endif
+}
+
+// Number of occurrences of c in [data, data + length)
+inline size_t CountByte(const char* data, size_t length, char c) {
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        count += PopCount(MatchMask64(data + i, c));
+    }
+    for (; i < length; i++) {
+        if (data[i] == c) count++;
+    }
+    return count;
+}
+
+// Finds the n-th (0-based) occurrence of c. Returns its offset, or SIZE_MAX
+// and the number of occurrences seen in *found when there are fewer than n+1.
+inline size_t FindNthByte(const char* data, size_t length, char c, size_t n, size_t* found = nullptr) {
+    size_t seen = 0;
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        uint64_t mask = MatchMask64(data + i, c);
+        size_t hits = static_cast<size_t>(PopCount(mask));
+        if (seen + hits > n) return i + NthSetBit(mask, static_cast<int>(n - seen));
+        seen += hits;
+    }
+    for (; i < length; i++) {
+        if (data[i] == c) {
+            if (seen == n) return i;
+            seen++;
+        }
+    }
+    if (found != nullptr) *found = seen;
+    return SIZE_MAX;
+}
+
+} // namespace superpanel
@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+namespace superpanel {
+
+namespace {
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local unsigned currentWorker = 0;
+thread_local unsigned long long stealSeed = 0;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = DefaultThreadCount();
+    workers_.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers_[i]->thread = std::thread(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    WaitIdle();
+    {
+        std::lock_guard<std::mutex> guard(sleepLock_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+}
+
+unsigned ThreadPool::DefaultThreadCount() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 4 : cores;
+}
+
+bool ThreadPool::IsWorkerThread() const {
+    return currentPool == this;
+}
+
+void ThreadPool::Submit(Task task) {
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    if (currentPool == this) {
+        Worker& self = *workers_[currentWorker];
+        std::lock_guard<std::mutex> guard(self.lock);
+        self.tasks.push_back(std::move(task));
+    } else {
+        std::lock_guard<std::mutex> guard(injectedLock_);
+        injected_.push_back(std::move(task));
+    }
+    // Either a worker about to sleep sees the new generation, or we see it
+    // counted in sleeping_ and wake it through the lock.
+    generation_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+        { std::lock_guard<std::mutex> guard(sleepLock_); }
+        wake_.notify_one();
+    }
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock<std::mutex> guard(sleepLock_);
+    idle_.wait(guard, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::TryPopLocal(unsigned index, Task& task) {
+    Worker& self = *workers_[index];
+    std::lock_guard<std::mutex> guard(self.lock);
+    if (self.tasks.empty()) return false;
+    task = std::move(self.tasks.back());
+    self.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::TryPopInjected(Task& task) {
+    std::lock_guard<std::mutex> guard(injectedLock_);
+    if (injected_.empty()) return false;
+    task = std::move(injected_.front());
+    injected_.pop_front();
+    return true;
+}
+
+bool ThreadPool::TrySteal(unsigned thief, Task& task) {
+    const unsigned count = Size();
+    if (count < 2) return false;
+
+    // xorshift start point so thieves don't all hammer worker 0
+    stealSeed ^= stealSeed << 13;
+    stealSeed ^= stealSeed >> 7;
+    stealSeed ^= stealSeed << 17;
+    unsigned start = static_cast<unsigned>(stealSeed % count);
+
+    for (unsigned i = 0; i < count; i++) {
+        unsigned victim = (start + i) % count;
+        if (victim == thief) continue;
+        Worker& other = *workers_[victim];
+        std::lock_guard<std::mutex> guard(other.lock);
+        if (other.tasks.empty()) continue;
+        task = std::move(other.tasks.front());
+        other.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::RunTask(Task& task) {
+    try {
+        task();
+    } catch (...) {
+        // Tasks report their own failures; an escaping exception must not
+        // leave pending_ raised and WaitIdle blocked forever.
+    }
+    task = nullptr;
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> guard(sleepLock_);
+        idle_.notify_all();
+    }
+}
+
+void ThreadPool::WorkerLoop(unsigned index) {
+    currentPool = this;
+    currentWorker = index;
+    stealSeed = 0x9E3779B97F4A7C15ULL ^ (index + 1);
+
+    Task task;
+    while (true) {
+        unsigned long long generation = generation_.load();
+
+        if (TryPopLocal(index, task) || TryPopInjected(task) || TrySteal(index, task)) {
+            RunTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock_);
+        if (stopping_) break;
+        sleeping_.fetch_add(1);
+        wake_.wait(guard, [this, generation] {
+            return stopping_ || generation_.load() != generation;
+        });
+        sleeping_.fetch_sub(1);
+        if (stopping_) break;
+    }
+
+    currentPool = nullptr;
+}
+
+} // namespace superpanel
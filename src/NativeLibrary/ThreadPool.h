@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace superpanel {
+
+// Work-stealing thread pool shared by the parallel file and backup operations.
+// Each worker owns a deque: it pushes and pops its own tasks LIFO (keeping
+// recently discovered work cache-hot and depth-first), while idle workers steal
+// FIFO from the other end. Tasks submitted from outside the pool go through a
+// shared injection queue.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(Task task);
+
+    // Blocks until every submitted task (including tasks spawned by tasks) has
+    // run. Must not be called from a worker thread.
+    void WaitIdle();
+
+    unsigned Size() const { return static_cast<unsigned>(workers_.size()); }
+
+    // True when called from one of this pool's worker threads.
+    bool IsWorkerThread() const;
+
+    static unsigned DefaultThreadCount();
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void WorkerLoop(unsigned index);
+    bool TryPopLocal(unsigned index, Task& task);
+    bool TrySteal(unsigned thief, Task& task);
+    bool TryPopInjected(Task& task);
+    void RunTask(Task& task);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex injectedLock_;
+    std::deque<Task> injected_;
+
+    std::mutex sleepLock_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::atomic<long long> pending_{0};
+    std::atomic<unsigned> sleeping_{0};
+    // Bumped on every submission so a worker that found no work can tell
+    // whether anything arrived between its last scan and going to sleep.
+    std::atomic<unsigned long long> generation_{0};
+    std::atomic<bool> stopping_{false};
+};
+
+} // namespace superpanel
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "TlsClient.h"
+
+#ifdef _WIN32
+#include <wincrypt.h>
+#pragma comment(lib, "libssl.lib")
+#pragma comment(lib, "libcrypto.lib")
+#pragma comment(lib, "crypt32.lib")
+#endif
+
+namespace {
+
+void LoadSystemRoots(SSL_CTX* context) {
+#ifdef _WIN32
+    HCERTSTORE store = CertOpenSystemStoreW(0, L"ROOT");
+    if (store == NULL) return;
+    X509_STORE* roots = SSL_CTX_get_cert_store(context);
+    for (PCCERT_CONTEXT certificate = NULL; (certificate = CertEnumCertificatesInStore(store, certificate)) != NULL;) {
+        const unsigned char* der = certificate->pbCertEncoded;
+        X509* x509 = d2i_X509(NULL, &der, static_cast<long>(certificate->cbCertEncoded));
+        if (x509 == NULL) continue;
+        X509_STORE_add_cert(roots, x509);
+        X509_free(x509);
+    }
+    CertCloseStore(store, 0);
+#else
+    SSL_CTX_set_default_verify_paths(context); // Honours SSL_CERT_FILE / SSL_CERT_DIR
+#endif
+}
+
+} // namespace
+
+namespace superpanel {
+
+SSL_CTX* TlsClientContext() {
+    static SSL_CTX* context = [] {
+        SSL_CTX* created = SSL_CTX_new(TLS_client_method());
+        if (created == NULL) return created;
+        SSL_CTX_set_min_proto_version(created, TLS1_2_VERSION);
+        SSL_CTX_set_verify(created, SSL_VERIFY_PEER, NULL);
+        SSL_CTX_set_mode(created, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+        // Plenty of servers close without close_notify after a close-delimited body
+        SSL_CTX_set_options(created, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+        static const unsigned char alpn[] = "\x08http/1.1";
+        SSL_CTX_set_alpn_protos(created, alpn, sizeof(alpn) - 1);
+        LoadSystemRoots(created);
+        return created;
+    }();
+    return context;
+}
+
+} // namespace superpanel
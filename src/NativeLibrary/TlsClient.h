@@ -0,0 +1,14 @@
+#pragma once
+
+#include <openssl/ssl.h>
+
+namespace superpanel {
+
+// The process-wide client context the network probes share: TLS 1.2 and up,
+// peer verification against the system roots (the Windows ROOT store, which
+// OpenSSL does not read itself), partial writes, and no complaint about
+// servers closing without close_notify. Created on first use and never
+// freed; NULL if OpenSSL cannot create it.
+SSL_CTX* TlsClientContext();
+
+} // namespace superpanel
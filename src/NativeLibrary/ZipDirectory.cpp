@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "ZipDirectory.h"
+#include <cstring>
+
+namespace superpanel {
+
+namespace {
+
+const uint32_t Zip32Max = 0xFFFFFFFFu;
+const uint16_t HostUnix = 3;
+
+uint16_t Get16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t Get32(const unsigned char* p) {
+    return static_cast<uint32_t>(Get16(p)) | (static_cast<uint32_t>(Get16(p + 2)) << 16);
+}
+
+uint64_t Get64(const unsigned char* p) {
+    return static_cast<uint64_t>(Get32(p)) | (static_cast<uint64_t>(Get32(p + 4)) << 32);
+}
+
+time_t DosToTime(uint32_t dosDateTime) {
+    struct tm local;
+    memset(&local, 0, sizeof(local));
+    uint32_t date = dosDateTime >> 16, time = dosDateTime & 0xFFFF;
+    local.tm_year = static_cast<int>((date >> 9) & 0x7F) + 80;
+    local.tm_mon = static_cast<int>((date >> 5) & 0x0F) - 1;
+    local.tm_mday = static_cast<int>(date & 0x1F);
+    local.tm_hour = static_cast<int>(time >> 11);
+    local.tm_min = static_cast<int>((time >> 5) & 0x3F);
+    local.tm_sec = static_cast<int>(time & 0x1F) * 2;
+    local.tm_isdst = -1;
+    return mktime(&local);
+}
+
+// Reads the sizes, offset and time an entry's extra fields override
+void ReadExtraFields(const unsigned char* p, size_t length, ZipEntry& entry) {
+    while (length >= 4) {
+        uint16_t id = Get16(p), size = Get16(p + 2);
+        if (size > length - 4) return;
+        const unsigned char* field = p + 4;
+        if (id == 0x0001) {
+            // ZIP64: only the fields saturated in the fixed record, in this order
+            size_t at = 0;
+            if (entry.size == Zip32Max && at + 8 <= size) entry.size = Get64(field + at), at += 8;
+            if (entry.compressedSize == Zip32Max && at + 8 <= size) entry.compressedSize = Get64(field + at), at += 8;
+            if (entry.headerOffset == Zip32Max && at + 8 <= size) entry.headerOffset = Get64(field + at);
+        } else if (id == 0x5455 && size >= 5 && (field[0] & 1) != 0) {
+            // Extended timestamp: exact UTC mtime instead of the local DOS time
+            entry.modified = static_cast<time_t>(static_cast<int32_t>(Get32(field + 1)));
+        }
+        p += 4 + size;
+        length -= 4 + size;
+    }
+}
+
+} // namespace
+
+bool ReadZipDirectory(const unsigned char* data, uint64_t size, std::vector<ZipEntry>& entries) {
+    if (size < 22) return false;
+    uint64_t end = size - 22;
+    uint64_t limit = end > 0xFFFF ? end - 0xFFFF : 0;
+    uint64_t eocd = UINT64_MAX;
+    for (uint64_t at = end + 1; at-- > limit;) {
+        if (Get32(data + at) == 0x06054b50 && at + 22 + Get16(data + at + 20) <= size) {
+            eocd = at;
+            break;
+        }
+    }
+    if (eocd == UINT64_MAX || Get16(data + eocd + 4) != 0 || Get16(data + eocd + 6) != 0) return false;
+
+    uint64_t count = Get16(data + eocd + 10);
+    uint64_t directorySize = Get32(data + eocd + 12);
+    uint64_t directoryOffset = Get32(data + eocd + 16);
+    if (count == 0xFFFF || directorySize == Zip32Max || directoryOffset == Zip32Max) {
+        if (eocd < 20 || Get32(data + eocd - 20) != 0x07064b50) return false;
+        uint64_t record = Get64(data + eocd - 20 + 8);
+        if (record > eocd - 20 || eocd - 20 - record < 56 || Get32(data + record) != 0x06064b50) return false;
+        if (Get32(data + record + 16) != 0 || Get32(data + record + 20) != 0) return false;
+        count = Get64(data + record + 32);
+        directorySize = Get64(data + record + 40);
+        directoryOffset = Get64(data + record + 48);
+    }
+    if (directoryOffset > size || directorySize > size - directoryOffset || count > directorySize / 46) return false;
+
+    entries.clear();
+    entries.reserve(static_cast<size_t>(count));
+    const unsigned char* p = data + directoryOffset;
+    const unsigned char* directoryEnd = p + directorySize;
+    for (uint64_t i = 0; i < count; i++) {
+        if (directoryEnd - p < 46 || Get32(p) != 0x02014b50) return false;
+        uint16_t nameLength = Get16(p + 28), extraLength = Get16(p + 30), commentLength = Get16(p + 32);
+        if (static_cast<size_t>(directoryEnd - p) < 46u + nameLength + extraLength + commentLength) return false;
+
+        ZipEntry entry;
+        entry.flags = Get16(p + 8);
+        entry.method = Get16(p + 10);
+        entry.modified = DosToTime(Get32(p + 12));
+        entry.crc = Get32(p + 16);
+        entry.compressedSize = Get32(p + 20);
+        entry.size = Get32(p + 24);
+        entry.headerOffset = Get32(p + 42);
+        uint32_t external = Get32(p + 38);
+        if ((Get16(p + 4) >> 8) == HostUnix) entry.mode = (external >> 16) & 07777;
+        entry.name.assign(reinterpret_cast<const char*>(p + 46), nameLength);
+        ReadExtraFields(p + 46 + nameLength, extraLength, entry);
+
+        entry.directory = (!entry.name.empty() && entry.name.back() == '/') || (external & 0x10) != 0;
+        while (!entry.name.empty() && entry.name.back() == '/') entry.name.pop_back();
+        entries.push_back(std::move(entry));
+        p += 46 + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+uint64_t ZipDataOffset(const unsigned char* data, uint64_t size, const ZipEntry& entry) {
+    if (entry.headerOffset > size || size - entry.headerOffset < 30 || Get32(data + entry.headerOffset) != 0x04034b50) return UINT64_MAX;
+    uint64_t offset = entry.headerOffset + 30 + Get16(data + entry.headerOffset + 26) + Get16(data + entry.headerOffset + 28);
+    if (offset > size || entry.compressedSize > size - offset) return UINT64_MAX;
+    return offset;
+}
+
+} // namespace superpanel
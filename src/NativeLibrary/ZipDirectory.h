@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace superpanel {
+
+// Reading side of the ZIP format shared by the backup extractor and the
+// integrity checker. Works on a memory-mapped archive.
+struct ZipEntry {
+    std::string name; // Without the trailing '/' of directories
+    bool directory = false;
+    uint16_t method = 0;
+    uint16_t flags = 0;
+    uint32_t crc = 0;
+    uint64_t compressedSize = 0;
+    uint64_t size = 0;
+    uint64_t headerOffset = 0;
+    uint32_t mode = 0; // POSIX permissions; 0 if the archive was not made on Unix
+    time_t modified = 0;
+};
+
+// Reads the central directory (ZIP64 included). False if data is not a
+// single-disk ZIP archive or the directory runs past its end.
+bool ReadZipDirectory(const unsigned char* data, uint64_t size, std::vector<ZipEntry>& entries);
+
+// Offset of an entry's data, found through its local header (whose name and
+// extra lengths can differ from the central directory's). UINT64_MAX if the
+// header is invalid or the data runs past the end of the archive.
+uint64_t ZipDataOffset(const unsigned char* data, uint64_t size, const ZipEntry& entry);
+
+} // namespace superpanel
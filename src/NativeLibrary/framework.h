@@ -1,5 +1,7 @@
 #pragma once
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 // Windows Header Files
-#include <windows.h>
\ No newline at end of file
+#include <windows.h>
+#endif
\ No newline at end of file
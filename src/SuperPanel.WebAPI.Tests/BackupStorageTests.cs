@@ -0,0 +1,551 @@
+using System.Buffers.Binary;
+using System.Runtime.InteropServices;
+using FluentAssertions;
+using SuperPanel.WebAPI.Services;
+using Xunit;
+
+namespace SuperPanel.WebAPI.Tests;
+
+// Drives the native backup stages on a small tree under a temporary
+// directory: archive and extract, the chunk store with its change journal,
+// encryption, integrity manifests and the shared I/O throttle. Not run in
+// parallel with other classes, whose backups reconfigure the throttle.
+[Collection(nameof(BackupStorageTests))]
+public class BackupStorageTests : IDisposable
+{
+    private const int JobRunning = 0;
+    private const int JobCompleted = 1;
+    private const int JobFailed = 2;
+
+    // Chunk ID, method, raw length and stored length
+    private const int PackRecordHeaderSize = 32 + 1 + 4 + 4;
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ArchiveProgress
+    {
+        public long FilesDone;
+        public long BytesRead;
+        public long BytesWritten;
+        public long ElapsedMs;
+        public long Errors;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ExtractProgress
+    {
+        public long FilesTotal;
+        public long FilesDone;
+        public long BytesTotal;
+        public long BytesWritten;
+        public long ElapsedMs;
+        public long Errors;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct CryptoProgress
+    {
+        public long BytesTotal;
+        public long BytesDone;
+        public long ElapsedMs;
+        public long Cipher;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct VerifyProgress
+    {
+        public long BytesTotal;
+        public long BytesDone;
+        public long RegionsTotal;
+        public long RegionsDamaged;
+        public long ElapsedMs;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ThrottleState
+    {
+        public long MaxBytesPerSecond;
+        public long MinBytesPerSecond;
+        public long BytesPerSecond;
+        public long IoPressure;
+        public long DiskLatencyUs;
+        public long Backoffs;
+        public long BytesGranted;
+        public long ThrottledMs;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct StoreProgress
+    {
+        public long FilesDone;
+        public long BytesTotal;
+        public long BytesRead;
+        public long BytesNew;
+        public long BytesStored;
+        public long ChunksTotal;
+        public long ChunksNew;
+        public long ElapsedMs;
+        public long Errors;
+        public long FilesUnchanged;
+        public long FilesChanged;
+        public long FilesDeleted;
+    }
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr WriteBackupArchiveAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string archivePath,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] sources,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] prefixes,
+        int sourceCount, int compressionLevel, int threadCount, long memoryBudget);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupArchiveProgress(IntPtr handle, out ArchiveProgress progress);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupArchive(IntPtr handle);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr ExtractBackupArchiveAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string archivePath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string targetDir, int threadCount);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupExtractProgress(IntPtr handle, out ExtractProgress progress);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupExtract(IntPtr handle);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr EncryptBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string inputPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string outputPath, byte[] key, int keyLength, int threadCount);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr DecryptBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string inputPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string outputPath, byte[] key, int keyLength, int threadCount);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupCryptoProgress(IntPtr handle, out CryptoProgress progress);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupCrypto(IntPtr handle);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr HashBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string filePath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath, int includeSha256, int threadCount);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr VerifyBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string filePath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath, int threadCount, long bytesPerSecond);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupVerifyProgress(IntPtr handle, out VerifyProgress progress);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupVerifyDamage(IntPtr handle, byte[] buffer, int bufferSize);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupVerify(IntPtr handle);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ConfigureBackupThrottle(long maxBytesPerSecond, long minBytesPerSecond, int pressurePercent, int latencyMs);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GetBackupThrottleState(out ThrottleState state);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr OpenChunkStore([MarshalAs(UnmanagedType.LPUTF8Str)] string rootDir);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CloseChunkStore(IntPtr store);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr IncrementalBackupToChunkStoreAsync(IntPtr store, [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string? parentManifestPath, [MarshalAs(UnmanagedType.LPUTF8Str)] string? journalPath,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] sources,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] prefixes,
+        int sourceCount, int compressionLevel, int threadCount, long memoryBudget);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr RestoreFromChunkStoreAsync(IntPtr store, [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string targetDir, int threadCount);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr VerifyChunkStoreBackupAsync(IntPtr store, [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath, int threadCount);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetChunkStoreProgress(IntPtr job, out StoreProgress progress);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseChunkStoreJob(IntPtr job);
+
+    private readonly string _directory = Path.Combine(Path.GetTempPath(), $"backups_{Guid.NewGuid():N}");
+    private readonly string _source;
+    private readonly List<IntPtr> _stores = new();
+
+    public BackupStorageTests()
+    {
+        _source = Path.Combine(_directory, "source");
+        if (!TestHelpers.NativeLibraryAvailable)
+            return;
+
+        // Incompressible data spanning several chunks and 1 MB blocks, text
+        // that deflates, and a nested file below the chunk size
+        WriteRandomFile(Path.Combine(_source, "random.bin"), 3 << 20, 1);
+        WriteTextFile(Path.Combine(_source, "text.log"), 1 << 20, 2);
+        WriteRandomFile(Path.Combine(_source, "nested", "small.bin"), 200_000, 3);
+    }
+
+    public void Dispose()
+    {
+        foreach (var store in _stores)
+            CloseChunkStore(store);
+        if (Directory.Exists(_directory))
+            Directory.Delete(_directory, true);
+    }
+
+    private static void WriteRandomFile(string path, int length, int seed)
+    {
+        var data = new byte[length];
+        new Random(seed).NextBytes(data);
+        Directory.CreateDirectory(Path.GetDirectoryName(path)!);
+        File.WriteAllBytes(path, data);
+    }
+
+    private static void WriteTextFile(string path, int length, int seed)
+    {
+        var random = new Random(seed);
+        var data = new byte[length];
+        for (int i = 0; i < data.Length; i++)
+            data[i] = (byte)"abcdefgh\n"[random.Next(9)];
+        Directory.CreateDirectory(Path.GetDirectoryName(path)!);
+        File.WriteAllBytes(path, data);
+    }
+
+    private static void FlipByte(string path, long offset)
+    {
+        using var file = new FileStream(path, FileMode.Open, FileAccess.ReadWrite);
+        file.Position = offset;
+        int value = file.ReadByte();
+        file.Position = offset;
+        file.WriteByte((byte)(value ^ 0x55));
+    }
+
+    // Every file under expected, with the same contents, and nothing else
+    private static void ShouldMatchTree(string expected, string actual)
+    {
+        var files = Directory.GetFiles(expected, "*", SearchOption.AllDirectories)
+            .Select(f => Path.GetRelativePath(expected, f))
+            .ToList();
+        Directory.GetFiles(actual, "*", SearchOption.AllDirectories)
+            .Select(f => Path.GetRelativePath(actual, f))
+            .Should().BeEquivalentTo(files);
+        foreach (var file in files)
+            File.ReadAllBytes(Path.Combine(actual, file)).Should().Equal(File.ReadAllBytes(Path.Combine(expected, file)), file);
+    }
+
+    private delegate int ProgressReader<T>(IntPtr handle, out T progress);
+
+    private static async Task<(int State, T Progress)> WaitAsync<T>(IntPtr job, ProgressReader<T> read, Action<IntPtr> release)
+    {
+        job.Should().NotBe(IntPtr.Zero);
+        try
+        {
+            int state;
+            T progress;
+            while ((state = read(job, out progress)) == JobRunning)
+                await Task.Delay(20);
+            return (state, progress);
+        }
+        finally
+        {
+            release(job);
+        }
+    }
+
+    private IntPtr OpenStore()
+    {
+        var store = OpenChunkStore(Path.Combine(_directory, "store"));
+        store.Should().NotBe(IntPtr.Zero);
+        _stores.Add(store);
+        return store;
+    }
+
+    private void CloseStore(IntPtr store)
+    {
+        _stores.Remove(store);
+        CloseChunkStore(store);
+    }
+
+    private Task<(int State, StoreProgress Progress)> BackupAsync(IntPtr store, string manifest, string? parentManifest = null,
+        string? journal = null)
+    {
+        var job = IncrementalBackupToChunkStoreAsync(store, Path.Combine(_directory, manifest),
+            parentManifest == null ? null : Path.Combine(_directory, parentManifest),
+            journal == null ? null : Path.Combine(_directory, journal),
+            new[] { _source }, new[] { "" }, 1, 0, 2, 0);
+        return WaitAsync<StoreProgress>(job, GetChunkStoreProgress, ReleaseChunkStoreJob);
+    }
+
+    private Task<(int State, StoreProgress Progress)> RestoreAsync(IntPtr store, string manifest, string target)
+    {
+        var job = RestoreFromChunkStoreAsync(store, Path.Combine(_directory, manifest), Path.Combine(_directory, target), 2);
+        return WaitAsync<StoreProgress>(job, GetChunkStoreProgress, ReleaseChunkStoreJob);
+    }
+
+    private Task<(int State, StoreProgress Progress)> VerifyStoreAsync(IntPtr store, string manifest)
+    {
+        var job = VerifyChunkStoreBackupAsync(store, Path.Combine(_directory, manifest), 2);
+        return WaitAsync<StoreProgress>(job, GetChunkStoreProgress, ReleaseChunkStoreJob);
+    }
+
+    private string NewestPack()
+    {
+        return Directory.GetFiles(Path.Combine(_directory, "store", "packs"), "pack-*.dat").Max()!;
+    }
+
+    [SkippableFact]
+    public async Task ChunkStore_BackupThenRestore_ShouldRecreateIdenticalTree()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var store = OpenStore();
+
+        // Act
+        var backup = await BackupAsync(store, "full.manifest");
+        var restore = await RestoreAsync(store, "full.manifest", "restored");
+
+        // Assert
+        backup.State.Should().Be(JobCompleted);
+        backup.Progress.Errors.Should().Be(0);
+        backup.Progress.ChunksNew.Should().BeGreaterThan(3);
+        restore.State.Should().Be(JobCompleted);
+        ShouldMatchTree(_source, Path.Combine(_directory, "restored"));
+    }
+
+    [SkippableFact]
+    public async Task ChunkStore_IncrementalBackup_ShouldReadOnlyChangedFilesAndRestoreNewState()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var store = OpenStore();
+        (await BackupAsync(store, "first.manifest", journal: "tree.journal")).State.Should().Be(JobCompleted);
+        WriteTextFile(Path.Combine(_source, "text.log"), 1 << 20, 4);
+
+        // Act
+        var backup = await BackupAsync(store, "second.manifest", "first.manifest", "tree.journal");
+        var restore = await RestoreAsync(store, "second.manifest", "restored");
+
+        // Assert
+        backup.State.Should().Be(JobCompleted);
+        backup.Progress.FilesUnchanged.Should().Be(2);
+        backup.Progress.FilesChanged.Should().Be(1);
+        restore.State.Should().Be(JobCompleted);
+        ShouldMatchTree(_source, Path.Combine(_directory, "restored"));
+    }
+
+    [SkippableFact]
+    public async Task ChunkStore_WithTamperedChunk_ShouldFailVerification()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var store = OpenStore();
+        (await BackupAsync(store, "full.manifest")).State.Should().Be(JobCompleted);
+        CloseStore(store);
+        // Midway through the first record's data
+        var pack = NewestPack();
+        var header = new byte[PackRecordHeaderSize];
+        using (var file = File.OpenRead(pack))
+            file.ReadExactly(header);
+        FlipByte(pack, PackRecordHeaderSize + BinaryPrimitives.ReadUInt32LittleEndian(header.AsSpan(37)) / 2);
+        store = OpenStore();
+
+        // Act
+        var verify = await VerifyStoreAsync(store, "full.manifest");
+
+        // Assert
+        verify.State.Should().Be(JobFailed);
+        verify.Progress.Errors.Should().Be(1);
+    }
+
+    [SkippableFact]
+    public async Task ChunkStore_WithTornPack_ShouldDetectLostChunkAndStoreItAgain()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange: what a crash mid-append leaves, a pack ending in a partial
+        // record and no index covering it
+        var store = OpenStore();
+        (await BackupAsync(store, "full.manifest")).State.Should().Be(JobCompleted);
+        CloseStore(store);
+        File.Delete(Path.Combine(_directory, "store", "index.bin"));
+        var pack = NewestPack();
+        using (var file = new FileStream(pack, FileMode.Open, FileAccess.Write))
+            file.SetLength(file.Length - 100);
+        store = OpenStore();
+
+        // Act
+        var verify = await VerifyStoreAsync(store, "full.manifest");
+        var backup = await BackupAsync(store, "again.manifest");
+        var reverify = await VerifyStoreAsync(store, "again.manifest");
+
+        // Assert
+        verify.State.Should().Be(JobFailed);
+        verify.Progress.Errors.Should().BeGreaterThan(0);
+        backup.State.Should().Be(JobCompleted);
+        backup.Progress.ChunksNew.Should().Be(1);
+        reverify.State.Should().Be(JobCompleted);
+        reverify.Progress.Errors.Should().Be(0);
+    }
+
+    [SkippableFact]
+    public async Task BackupArchive_WriteThenExtract_ShouldRecreateIdenticalTree()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var archive = Path.Combine(_directory, "backup.zip");
+
+        // Act
+        var write = await WaitAsync<ArchiveProgress>(
+            WriteBackupArchiveAsync(archive, new[] { _source }, new[] { "" }, 1, 0, 2, 0),
+            GetBackupArchiveProgress, ReleaseBackupArchive);
+        var extract = await WaitAsync<ExtractProgress>(
+            ExtractBackupArchiveAsync(archive, Path.Combine(_directory, "extracted"), 2),
+            GetBackupExtractProgress, ReleaseBackupExtract);
+
+        // Assert
+        write.State.Should().Be(JobCompleted);
+        write.Progress.Errors.Should().Be(0);
+        extract.State.Should().Be(JobCompleted);
+        extract.Progress.BytesWritten.Should().Be(extract.Progress.BytesTotal);
+        ShouldMatchTree(_source, Path.Combine(_directory, "extracted"));
+    }
+
+    [SkippableFact]
+    public async Task VerifyBackupFile_WithDamagedEntry_ShouldNameIt()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var archive = Path.Combine(_directory, "backup.zip");
+        var sums = archive + ".sums";
+        (await WaitAsync<ArchiveProgress>(
+            WriteBackupArchiveAsync(archive, new[] { Path.Combine(_source, "random.bin") }, new[] { "" }, 1, 0, 2, 0),
+            GetBackupArchiveProgress, ReleaseBackupArchive)).State.Should().Be(JobCompleted);
+        (await WaitAsync<VerifyProgress>(HashBackupFileAsync(archive, sums, 1, 2), GetBackupVerifyProgress, ReleaseBackupVerify))
+            .State.Should().Be(JobCompleted);
+        var intact = await WaitAsync<VerifyProgress>(VerifyBackupFileAsync(archive, sums, 2, 0), GetBackupVerifyProgress, ReleaseBackupVerify);
+        FlipByte(archive, 1000);
+
+        // Act
+        var job = VerifyBackupFileAsync(archive, sums, 2, 0);
+        job.Should().NotBe(IntPtr.Zero);
+        VerifyProgress progress;
+        string damage;
+        try
+        {
+            while (GetBackupVerifyProgress(job, out progress) == JobRunning)
+                await Task.Delay(20);
+            var buffer = new byte[4096];
+            int count = GetBackupVerifyDamage(job, buffer, buffer.Length);
+            count.Should().Be(1);
+            damage = System.Text.Encoding.UTF8.GetString(buffer).TrimEnd('\0');
+        }
+        finally
+        {
+            ReleaseBackupVerify(job);
+        }
+
+        // Assert
+        intact.State.Should().Be(JobCompleted);
+        intact.Progress.RegionsDamaged.Should().Be(0);
+        progress.RegionsDamaged.Should().Be(1);
+        damage.Should().Be("random.bin\n");
+    }
+
+    [SkippableFact]
+    public async Task EncryptBackupFile_ThenDecrypt_ShouldRoundTrip()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var key = Enumerable.Range(0, 32).Select(i => (byte)(i * 7)).ToArray();
+        var input = Path.Combine(_source, "random.bin");
+        var encrypted = Path.Combine(_directory, "random.spae");
+        var decrypted = Path.Combine(_directory, "random.out");
+
+        // Act
+        var encrypt = await WaitAsync<CryptoProgress>(EncryptBackupFileAsync(input, encrypted, key, key.Length, 2),
+            GetBackupCryptoProgress, ReleaseBackupCrypto);
+        var decrypt = await WaitAsync<CryptoProgress>(DecryptBackupFileAsync(encrypted, decrypted, key, key.Length, 2),
+            GetBackupCryptoProgress, ReleaseBackupCrypto);
+
+        // Assert
+        encrypt.State.Should().Be(JobCompleted);
+        decrypt.State.Should().Be(JobCompleted);
+        File.ReadAllBytes(encrypted).AsSpan(0, 1 << 20).SequenceEqual(File.ReadAllBytes(input).AsSpan(0, 1 << 20)).Should().BeFalse();
+        File.ReadAllBytes(decrypted).Should().Equal(File.ReadAllBytes(input));
+    }
+
+    [SkippableFact]
+    public async Task DecryptBackupFile_WithTamperedCiphertext_ShouldFailAndDeleteOutput()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var key = Enumerable.Range(0, 32).Select(i => (byte)(i * 7)).ToArray();
+        var encrypted = Path.Combine(_directory, "random.spae");
+        var decrypted = Path.Combine(_directory, "random.out");
+        (await WaitAsync<CryptoProgress>(EncryptBackupFileAsync(Path.Combine(_source, "random.bin"), encrypted, key, key.Length, 2),
+            GetBackupCryptoProgress, ReleaseBackupCrypto)).State.Should().Be(JobCompleted);
+        // In the second 1 MB chunk
+        FlipByte(encrypted, 1_500_000);
+
+        // Act
+        var decrypt = await WaitAsync<CryptoProgress>(DecryptBackupFileAsync(encrypted, decrypted, key, key.Length, 2),
+            GetBackupCryptoProgress, ReleaseBackupCrypto);
+
+        // Assert
+        decrypt.State.Should().Be(JobFailed);
+        File.Exists(decrypted).Should().BeFalse();
+    }
+
+    [SkippableFact]
+    public async Task BackupThrottle_WithRateLimit_ShouldPaceBackupIo()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange: no congestion signals, so the rate stays at the ceiling
+        const long rate = 4 << 20;
+        var key = new byte[32];
+        var input = Path.Combine(_source, "random.bin");
+        ConfigureBackupThrottle(rate, rate / 4, 0, 0);
+        try
+        {
+            GetBackupThrottleState(out var before);
+
+            // Act
+            var encrypt = await WaitAsync<CryptoProgress>(
+                EncryptBackupFileAsync(input, Path.Combine(_directory, "random.spae"), key, key.Length, 2),
+                GetBackupCryptoProgress, ReleaseBackupCrypto);
+            GetBackupThrottleState(out var after);
+
+            // Assert: 3 MB, less the quarter second an idle bucket banks and
+            // the last block, which goes as soon as its slot starts
+            encrypt.State.Should().Be(JobCompleted);
+            encrypt.Progress.ElapsedMs.Should().BeGreaterThanOrEqualTo(200);
+            after.MaxBytesPerSecond.Should().Be(rate);
+            after.BytesPerSecond.Should().Be(rate);
+            (after.BytesGranted - before.BytesGranted).Should().BeGreaterThanOrEqualTo(new FileInfo(input).Length);
+        }
+        finally
+        {
+            ConfigureBackupThrottle(0, 0, 0, 0);
+        }
+    }
+}
+
+[CollectionDefinition(nameof(BackupStorageTests), DisableParallelization = true)]
+public class BackupStorageTestsCollection
+{
+}
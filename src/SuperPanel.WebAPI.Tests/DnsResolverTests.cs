@@ -0,0 +1,253 @@
+using System.Net;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Text;
+using FluentAssertions;
+using Xunit;
+
+namespace SuperPanel.WebAPI.Tests;
+
+// Drives the native resolver against a name server stub on loopback that
+// answers over UDP and TCP on the same port
+public class DnsResolverTests : IDisposable
+{
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ConfigureDnsResolver([MarshalAs(UnmanagedType.LPUTF8Str)] string? nameservers, int timeoutMs,
+        int minTtlSeconds, int maxTtlSeconds, int negativeTtlSeconds);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int ResolveHost([MarshalAs(UnmanagedType.LPUTF8Str)] string host, int timeoutMs, byte[] buffer, int bufferSize,
+        out int ttlSeconds);
+
+    [DllImport(TestHelpers.NativeLibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void SetDnsHostsFile([MarshalAs(UnmanagedType.LPUTF8Str)] string? path);
+
+    private readonly StubNameServer _server = new();
+    private readonly string _hostsFile = Path.Combine(Path.GetTempPath(), $"hosts_{Guid.NewGuid():N}");
+
+    public DnsResolverTests()
+    {
+        if (TestHelpers.NativeLibraryAvailable)
+            ConfigureDnsResolver($"127.0.0.1:{_server.Port}", 300, 0, 0, 0);
+    }
+
+    public void Dispose()
+    {
+        if (TestHelpers.NativeLibraryAvailable)
+        {
+            ConfigureDnsResolver(null, 0, 0, 0, 0);
+            SetDnsHostsFile(null);
+        }
+        _server.Dispose();
+        if (File.Exists(_hostsFile))
+            File.Delete(_hostsFile);
+    }
+
+    private static (int Count, string[] Addresses, int Ttl) Resolve(string host, int timeoutMs = 3000)
+    {
+        var buffer = new byte[4096];
+        int count = ResolveHost(host, timeoutMs, buffer, buffer.Length, out int ttl);
+        var addresses = Encoding.UTF8.GetString(buffer).TrimEnd('\0').Split('\n', StringSplitOptions.RemoveEmptyEntries);
+        return (count, addresses, ttl);
+    }
+
+    [SkippableFact]
+    public void ResolveHost_WithPlainAnswer_ShouldReturnAddressAndCacheIt()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Act
+        var result = Resolve("plain.example.test");
+
+        // Assert
+        result.Count.Should().Be(1);
+        result.Addresses.Should().Equal("10.1.2.3");
+        result.Ttl.Should().BeGreaterThan(0);
+    }
+
+    [SkippableFact]
+    public void ResolveHost_WithTruncatedAnswer_ShouldRetryOverTcp()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Act
+        var result = Resolve("big.example.test");
+
+        // Assert
+        result.Count.Should().Be(StubNameServer.BigRecordCount);
+        result.Addresses.Should().Contain("10.0.0.1");
+        _server.TcpQueries.Should().BeGreaterThan(0);
+    }
+
+    [SkippableFact]
+    public void ResolveHost_WithLostAaaaAnswer_ShouldReturnIpv4AddressesUncached()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Act
+        var result = Resolve("lossy.example.test", 1000);
+
+        // Assert
+        result.Count.Should().Be(1);
+        result.Addresses.Should().Equal("10.1.2.3");
+        result.Ttl.Should().Be(0);
+    }
+
+    [SkippableFact]
+    public void ResolveHost_WithHostsFileOverride_ShouldResolveWithoutQuerying()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        File.WriteAllText(_hostsFile, "192.0.2.7 custom.example.test # comment\n");
+        SetDnsHostsFile(_hostsFile);
+
+        // Act
+        var result = Resolve("custom.example.test");
+
+        // Assert
+        result.Addresses.Should().Equal("192.0.2.7");
+        _server.UdpQueries.Should().Be(0);
+    }
+
+    // Answers A queries with 10.1.2.3 and AAAA queries with no records.
+    // "big." names get a truncated UDP answer and many records over TCP;
+    // "lossy." names never get an AAAA answer.
+    private sealed class StubNameServer : IDisposable
+    {
+        public const int BigRecordCount = 39;
+
+        private readonly TcpListener _tcp;
+        private readonly UdpClient _udp;
+        private readonly CancellationTokenSource _cancellation = new();
+        private int _udpQueries;
+        private int _tcpQueries;
+
+        public int Port { get; }
+        public int UdpQueries => Volatile.Read(ref _udpQueries);
+        public int TcpQueries => Volatile.Read(ref _tcpQueries);
+
+        public StubNameServer()
+        {
+            _tcp = new TcpListener(IPAddress.Loopback, 0);
+            _tcp.Start();
+            Port = ((IPEndPoint)_tcp.LocalEndpoint).Port;
+            _udp = new UdpClient(new IPEndPoint(IPAddress.Loopback, Port));
+            _ = ServeUdpAsync();
+            _ = ServeTcpAsync();
+        }
+
+        private async Task ServeUdpAsync()
+        {
+            try
+            {
+                while (!_cancellation.IsCancellationRequested)
+                {
+                    var request = await _udp.ReceiveAsync(_cancellation.Token);
+                    Interlocked.Increment(ref _udpQueries);
+                    var (name, type) = ParseQuestion(request.Buffer);
+                    if (name.StartsWith("lossy.") && type == 28)
+                        continue;
+                    bool truncate = name.StartsWith("big.") && type == 1;
+                    var answer = BuildAnswer(request.Buffer, name, type, truncate);
+                    await _udp.SendAsync(answer, request.RemoteEndPoint, _cancellation.Token);
+                }
+            }
+            catch (Exception) when (_cancellation.IsCancellationRequested)
+            {
+            }
+        }
+
+        private async Task ServeTcpAsync()
+        {
+            try
+            {
+                while (!_cancellation.IsCancellationRequested)
+                {
+                    using var client = await _tcp.AcceptTcpClientAsync(_cancellation.Token);
+                    var stream = client.GetStream();
+                    var prefix = new byte[2];
+                    // Queries are pipelined; answer each as it arrives
+                    while (await ReadExactlyAsync(stream, prefix))
+                    {
+                        var query = new byte[prefix[0] << 8 | prefix[1]];
+                        if (!await ReadExactlyAsync(stream, query))
+                            break;
+                        Interlocked.Increment(ref _tcpQueries);
+                        var (name, type) = ParseQuestion(query);
+                        var answer = BuildAnswer(query, name, type, false);
+                        await stream.WriteAsync(new[] { (byte)(answer.Length >> 8), (byte)answer.Length }, _cancellation.Token);
+                        await stream.WriteAsync(answer, _cancellation.Token);
+                    }
+                }
+            }
+            catch (Exception) when (_cancellation.IsCancellationRequested)
+            {
+            }
+        }
+
+        private async Task<bool> ReadExactlyAsync(NetworkStream stream, byte[] buffer)
+        {
+            try
+            {
+                await stream.ReadExactlyAsync(buffer, _cancellation.Token);
+                return true;
+            }
+            catch (EndOfStreamException)
+            {
+                return false;
+            }
+        }
+
+        private static (string Name, int Type) ParseQuestion(byte[] query)
+        {
+            var labels = new List<string>();
+            int position = 12;
+            while (query[position] != 0)
+            {
+                labels.Add(Encoding.ASCII.GetString(query, position + 1, query[position]));
+                position += 1 + query[position];
+            }
+            return (string.Join('.', labels), query[position + 1] << 8 | query[position + 2]);
+        }
+
+        private static byte[] BuildAnswer(byte[] query, string name, int type, bool truncate)
+        {
+            // Header and question from the query, minus its EDNS record
+            int questionEnd = 12;
+            while (query[questionEnd] != 0)
+                questionEnd += 1 + query[questionEnd];
+            questionEnd += 5;
+
+            var answer = new List<byte>(query[..questionEnd]);
+            answer[2] = (byte)(0x81 | (truncate ? 0x02 : 0));
+            answer[3] = 0x80;
+            answer[10] = answer[11] = 0;
+
+            int count = 0;
+            if (type == 1 && !truncate)
+            {
+                var addresses = name.StartsWith("big.")
+                    ? Enumerable.Range(1, BigRecordCount).Select(i => new byte[] { 10, 0, 0, (byte)i })
+                    : new[] { new byte[] { 10, 1, 2, 3 } };
+                foreach (var address in addresses)
+                {
+                    // Name pointer to the question, A, IN, TTL 60, 4 bytes
+                    answer.AddRange(new byte[] { 0xC0, 0x0C, 0, 1, 0, 1, 0, 0, 0, 60, 0, 4 });
+                    answer.AddRange(address);
+                    count++;
+                }
+            }
+            answer[6] = (byte)(count >> 8);
+            answer[7] = (byte)count;
+            return answer.ToArray();
+        }
+
+        public void Dispose()
+        {
+            _cancellation.Cancel();
+            _tcp.Stop();
+            _udp.Dispose();
+        }
+    }
+}
@@ -0,0 +1,225 @@
+using System.Net;
+using System.Net.Sockets;
+using System.Text;
+using FluentAssertions;
+using Microsoft.EntityFrameworkCore;
+using SuperPanel.WebAPI.Data;
+using SuperPanel.WebAPI.Models;
+using SuperPanel.WebAPI.Services;
+using Xunit;
+
+namespace SuperPanel.WebAPI.Tests;
+
+// Health checks against scripted HTTP/1.1 servers on loopback. They run
+// through the native prober where the library is built and the managed
+// fallback elsewhere; connection reuse is only reported by the former.
+public class DomainServiceTests : IDisposable
+{
+    private readonly ApplicationDbContext _context;
+    private readonly DomainService _domainService;
+    private readonly List<LoopbackHttpServer> _servers = new();
+
+    public DomainServiceTests()
+    {
+        var options = new DbContextOptionsBuilder<ApplicationDbContext>()
+            .UseInMemoryDatabase(databaseName: Guid.NewGuid().ToString())
+            .Options;
+
+        _context = new ApplicationDbContext(options);
+        _domainService = new DomainService(_context);
+    }
+
+    public void Dispose()
+    {
+        foreach (var server in _servers)
+            server.Dispose();
+        _context.Dispose();
+    }
+
+    private LoopbackHttpServer StartServer(string? response, bool closeAfterResponse = false)
+    {
+        var server = new LoopbackHttpServer(response, closeAfterResponse);
+        _servers.Add(server);
+        return server;
+    }
+
+    private async Task<DomainHealthCheck> CheckAsync(LoopbackHttpServer server, int timeoutMs = 5000)
+    {
+        var domain = new Domain { Id = 1, Name = $"127.0.0.1:{server.Port}" };
+        var checks = await _domainService.CheckDomainHealthAsync(new[] { domain }, timeoutMs);
+        return checks.Single();
+    }
+
+    [Fact]
+    public async Task CheckDomainHealthAsync_WithContentLength_ShouldReadBodyAndReuseConnection()
+    {
+        // Arrange
+        var server = StartServer("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+
+        // Act
+        var first = await CheckAsync(server);
+        var second = await CheckAsync(server);
+
+        // Assert
+        first.Status.Should().Be(HttpCheckStatus.Ok);
+        first.HttpStatus.Should().Be(200);
+        first.BodyBytes.Should().Be(5);
+        second.Status.Should().Be(HttpCheckStatus.Ok);
+        second.BodyBytes.Should().Be(5);
+        server.Connections.Should().Be(1);
+    }
+
+    [SkippableFact]
+    public async Task CheckDomainHealthAsync_WithNativeProber_ShouldReportConnectionReuse()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var server = StartServer("HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello");
+
+        // Act
+        var first = await CheckAsync(server);
+        var second = await CheckAsync(server);
+
+        // Assert
+        first.ConnectionReused.Should().BeFalse();
+        second.ConnectionReused.Should().BeTrue();
+    }
+
+    [Fact]
+    public async Task CheckDomainHealthAsync_WithChunkedBody_ShouldCountDecodedBytes()
+    {
+        // Arrange
+        var server = StartServer("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\n\r\n");
+
+        // Act
+        var first = await CheckAsync(server);
+        var second = await CheckAsync(server);
+
+        // Assert
+        first.Status.Should().Be(HttpCheckStatus.Ok);
+        first.BodyBytes.Should().Be(11);
+        second.Status.Should().Be(HttpCheckStatus.Ok);
+        server.Connections.Should().Be(1);
+    }
+
+    [Fact]
+    public async Task CheckDomainHealthAsync_WithCloseDelimitedBody_ShouldReadToEndOfStream()
+    {
+        // Arrange
+        var body = new string('x', 3000);
+        var server = StartServer($"HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n{body}", closeAfterResponse: true);
+
+        // Act
+        var first = await CheckAsync(server);
+        var second = await CheckAsync(server);
+
+        // Assert
+        first.Status.Should().Be(HttpCheckStatus.Ok);
+        first.HttpStatus.Should().Be(404);
+        first.BodyBytes.Should().Be(3000);
+        second.Status.Should().Be(HttpCheckStatus.Ok);
+        second.ConnectionReused.Should().BeFalse();
+        server.Connections.Should().Be(2);
+    }
+
+    [Fact]
+    public async Task CheckDomainHealthAsync_WhenServerNeverAnswers_ShouldTimeOut()
+    {
+        // Arrange
+        var server = StartServer(null);
+
+        // Act
+        var check = await CheckAsync(server, 500);
+
+        // Assert
+        check.Status.Should().Be(HttpCheckStatus.Timeout);
+        check.HttpStatus.Should().Be(0);
+    }
+
+    // Answers every request on a connection with one fixed response, or
+    // never answers when the response is null
+    private sealed class LoopbackHttpServer : IDisposable
+    {
+        private readonly TcpListener _listener;
+        private readonly byte[]? _response;
+        private readonly bool _closeAfterResponse;
+        private readonly CancellationTokenSource _cancellation = new();
+        private int _connections;
+
+        public int Port { get; }
+        public int Connections => Volatile.Read(ref _connections);
+
+        public LoopbackHttpServer(string? response, bool closeAfterResponse)
+        {
+            _response = response == null ? null : Encoding.ASCII.GetBytes(response);
+            _closeAfterResponse = closeAfterResponse;
+            _listener = new TcpListener(IPAddress.Loopback, 0);
+            _listener.Start();
+            Port = ((IPEndPoint)_listener.LocalEndpoint).Port;
+            _ = AcceptAsync();
+        }
+
+        private async Task AcceptAsync()
+        {
+            try
+            {
+                while (!_cancellation.IsCancellationRequested)
+                {
+                    var client = await _listener.AcceptTcpClientAsync(_cancellation.Token);
+                    Interlocked.Increment(ref _connections);
+                    _ = ServeAsync(client);
+                }
+            }
+            catch (Exception) when (_cancellation.IsCancellationRequested)
+            {
+            }
+        }
+
+        private async Task ServeAsync(TcpClient client)
+        {
+            using (client)
+            {
+                try
+                {
+                    var stream = client.GetStream();
+                    var buffer = new byte[4096];
+                    var request = new StringBuilder();
+                    while (true)
+                    {
+                        int read = await stream.ReadAsync(buffer, _cancellation.Token);
+                        if (read == 0)
+                            return;
+                        request.Append(Encoding.ASCII.GetString(buffer, 0, read));
+                        int end = request.ToString().IndexOf("\r\n\r\n", StringComparison.Ordinal);
+                        if (end < 0)
+                            continue;
+                        request.Remove(0, end + 4);
+
+                        if (_response == null)
+                        {
+                            await Task.Delay(Timeout.Infinite, _cancellation.Token);
+                            return;
+                        }
+                        await stream.WriteAsync(_response, _cancellation.Token);
+                        if (_closeAfterResponse)
+                            return;
+                    }
+                }
+                catch (Exception) when (_cancellation.IsCancellationRequested)
+                {
+                }
+                catch (IOException)
+                {
+                    // The prober dropped the connection
+                }
+            }
+        }
+
+        public void Dispose()
+        {
+            _cancellation.Cancel();
+            _listener.Stop();
+        }
+    }
+}
@@ -0,0 +1,284 @@
+using System.Buffers.Binary;
+using FluentAssertions;
+using Microsoft.Extensions.Configuration;
+using Microsoft.Extensions.Logging;
+using Moq;
+using SuperPanel.WebAPI.Hubs;
+using SuperPanel.WebAPI.Models;
+using SuperPanel.WebAPI.Services;
+using Xunit;
+
+namespace SuperPanel.WebAPI.Tests;
+
+// History kept in a store under a temporary directory. Round trips and step
+// aggregates also hold for the in-memory fallback; reopening, tail repair,
+// expiry and the rollup tiers need the native store.
+public class MetricsHistoryServiceTests : IDisposable
+{
+    private const int BlockSize = 4096;
+    private const int BlockHeaderSize = 64;
+
+    private static readonly DateTime Start = new(2026, 1, 5, 0, 0, 0, DateTimeKind.Utc);
+
+    private readonly string _directory = Path.Combine(Path.GetTempPath(), $"metrics_{Guid.NewGuid():N}");
+    private readonly List<MetricsHistoryService> _services = new();
+
+    public void Dispose()
+    {
+        foreach (var service in _services)
+            service.Dispose();
+        if (Directory.Exists(_directory))
+            Directory.Delete(_directory, true);
+    }
+
+    private MetricsHistoryService CreateService(int retentionDays = 7)
+    {
+        var configuration = new ConfigurationBuilder()
+            .AddInMemoryCollection(new Dictionary<string, string?>
+            {
+                ["MetricsHistory:Path"] = _directory,
+                ["MetricsHistory:RetentionDays"] = retentionDays.ToString()
+            })
+            .Build();
+        var service = new MetricsHistoryService(new Mock<ILogger<MetricsHistoryService>>().Object, configuration);
+        _services.Add(service);
+        return service;
+    }
+
+    private static void Record(MetricsHistoryService service, DateTime timestamp, double cpu)
+    {
+        service.Record(1, new ServerMetrics { CpuUsage = cpu, MemoryUsage = cpu / 2, Timestamp = timestamp });
+    }
+
+    // Irregular whole-second intervals and values the XOR encoding handles
+    // differently: repeats, tiny and large magnitudes, negative zero
+    private static List<(DateTime Timestamp, double Value)> IrregularSamples(DateTime from, int count)
+    {
+        var random = new Random(49);
+        var samples = new List<(DateTime, double)>();
+        var timestamp = from;
+        for (int i = 0; i < count; i++)
+        {
+            timestamp = timestamp.AddSeconds(1 + i % 7);
+            var value = (i % 5) switch
+            {
+                0 => random.NextDouble() * 100,
+                1 => 1e-9 * i,
+                2 => 123456789.125,
+                3 => i % 2 == 0 ? -0.0 : -42.5,
+                _ => random.Next(0, 100)
+            };
+            samples.Add((timestamp, value));
+        }
+        return samples;
+    }
+
+    [Fact]
+    public void GetHistory_AtSecondSteps_ShouldReturnRecordedValuesExactly()
+    {
+        // Arrange
+        var service = CreateService();
+        var samples = IrregularSamples(Start, 500);
+        foreach (var (timestamp, value) in samples)
+            Record(service, timestamp, value);
+        Record(service, samples[^1].Timestamp.AddSeconds(1), double.NaN);
+
+        // Act
+        var history = service.GetHistory(1, "cpu", Start, samples[^1].Timestamp.AddSeconds(2), TimeSpan.FromSeconds(1));
+
+        // Assert
+        history.Resolution.Should().Be("raw");
+        history.Points.Should().HaveCount(samples.Count);
+        for (int i = 0; i < samples.Count; i++)
+        {
+            history.Points[i].Timestamp.Should().Be(samples[i].Timestamp);
+            // Last rather than the average, which a sum would turn -0.0 into 0.0 for
+            BitConverter.DoubleToInt64Bits(history.Points[i].Last).Should().Be(BitConverter.DoubleToInt64Bits(samples[i].Value));
+            history.Points[i].Count.Should().Be(1);
+        }
+    }
+
+    [SkippableFact]
+    public void GetHistory_AfterReopen_ShouldKeepRecordedHistory()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var samples = IrregularSamples(Start, 2000);
+        var first = CreateService();
+        foreach (var (timestamp, value) in samples.Take(1500))
+            Record(first, timestamp, value);
+        first.Dispose();
+
+        // Act
+        var second = CreateService();
+        foreach (var (timestamp, value) in samples.Skip(1500))
+            Record(second, timestamp, value);
+        var history = second.GetHistory(1, "cpu", Start, samples[^1].Timestamp.AddSeconds(1), TimeSpan.FromSeconds(1));
+
+        // Assert
+        history.Points.Select(p => p.Timestamp).Should().Equal(samples.Select(s => s.Timestamp));
+        history.Points.Select(p => p.Last).Should().Equal(samples.Select(s => s.Value));
+    }
+
+    [SkippableFact]
+    public void GetHistory_AfterCrashDamagedTail_ShouldRepairAndKeepAppending()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var samples = IrregularSamples(Start, 2000);
+        var first = CreateService();
+        foreach (var (timestamp, value) in samples.Take(1500))
+            Record(first, timestamp, value);
+        first.Dispose();
+        // What a crash mid-append leaves: counts ahead of the recorded bit
+        // length and stray bits past it
+        DamageBlockTails(Path.Combine(_directory, "samples.dat"));
+
+        // Act
+        var second = CreateService();
+        foreach (var (timestamp, value) in samples.Skip(1500))
+            Record(second, timestamp, value);
+        var history = second.GetHistory(1, "cpu", Start, samples[^1].Timestamp.AddSeconds(1), TimeSpan.FromSeconds(1));
+
+        // Assert
+        history.Points.Select(p => p.Timestamp).Should().Equal(samples.Select(s => s.Timestamp));
+        history.Points.Select(p => p.Last).Should().Equal(samples.Select(s => s.Value));
+    }
+
+    [SkippableFact]
+    public void GetHistory_PastRawRetention_ShouldFallBackToRollups()
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange: noisy enough to fill blocks, so expiry has to reclaim some
+        var service = CreateService(retentionDays: 1);
+        var random = new Random(49);
+        for (var timestamp = Start; timestamp < Start.AddDays(3); timestamp = timestamp.AddSeconds(10))
+        {
+            service.Record(1, new ServerMetrics
+            {
+                CpuUsage = random.NextDouble() * 100,
+                MemoryUsage = random.NextDouble() * 100,
+                DiskUsage = random.NextDouble() * 100,
+                NetworkIn = random.NextInt64(0, 1_000_000_000),
+                NetworkOut = random.NextInt64(0, 1_000_000_000),
+                ActiveConnections = random.Next(0, 500),
+                Timestamp = timestamp
+            });
+        }
+
+        // Act
+        var raw = service.GetHistory(1, "cpu", Start, Start.AddHours(1), TimeSpan.FromSeconds(1));
+        var minutes = service.GetHistory(1, "cpu", Start, Start.AddHours(1), TimeSpan.FromMinutes(1));
+        var recent = service.GetHistory(1, "cpu", Start.AddDays(3).AddHours(-1), Start.AddDays(3), TimeSpan.FromSeconds(1));
+
+        // Assert
+        raw.Points.Should().BeEmpty();
+        minutes.Resolution.Should().Be("1m");
+        minutes.Points.Should().HaveCount(60);
+        minutes.Points.Should().OnlyContain(p => p.Count == 6);
+        recent.Points.Should().HaveCount(360);
+    }
+
+    [Theory]
+    [InlineData(60)]
+    [InlineData(300)]
+    [InlineData(3600)]
+    [InlineData(90)]
+    public void GetHistory_AtCoarseSteps_ShouldAggregateEachStep(int stepSeconds)
+    {
+        // Arrange
+        var service = CreateService();
+        var samples = Enumerable.Range(0, 1440)
+            .Select(i => (Timestamp: Start.AddSeconds(i * 5), Value: (double)(i % 50)))
+            .ToList();
+        foreach (var (timestamp, value) in samples)
+            Record(service, timestamp, value);
+        var expected = samples
+            .GroupBy(s => (long)(s.Timestamp - Start).TotalSeconds / stepSeconds)
+            .Select(g => new
+            {
+                Timestamp = Start.AddSeconds(g.Key * stepSeconds),
+                Count = (long)g.Count(),
+                Min = g.Min(s => s.Value),
+                Max = g.Max(s => s.Value),
+                Value = g.Average(s => s.Value),
+                Last = g.Last().Value
+            })
+            .ToList();
+
+        // Act
+        var history = service.GetHistory(1, "cpu", Start, Start.AddHours(2), TimeSpan.FromSeconds(stepSeconds));
+
+        // Assert
+        history.Points.Should().HaveCount(expected.Count);
+        for (int i = 0; i < expected.Count; i++)
+        {
+            history.Points[i].Timestamp.Should().Be(expected[i].Timestamp);
+            history.Points[i].Count.Should().Be(expected[i].Count);
+            history.Points[i].Min.Should().Be(expected[i].Min);
+            history.Points[i].Max.Should().Be(expected[i].Max);
+            history.Points[i].Value.Should().BeApproximately(expected[i].Value, 1e-9);
+            history.Points[i].Last.Should().Be(expected[i].Last);
+        }
+    }
+
+    [SkippableTheory]
+    [InlineData(60, "1m")]
+    [InlineData(300, "5m")]
+    [InlineData(3600, "1h")]
+    [InlineData(90, "raw")]
+    public void GetHistory_AtCoarseSteps_ShouldReadFromMatchingRollupTier(int stepSeconds, string resolution)
+    {
+        Skip.IfNot(TestHelpers.NativeLibraryAvailable, TestHelpers.NativeLibraryMissing);
+
+        // Arrange
+        var service = CreateService();
+        for (int i = 0; i < 1440; i++)
+            Record(service, Start.AddSeconds(i * 5), i % 50);
+
+        // Act
+        var history = service.GetHistory(1, "cpu", Start, Start.AddHours(2), TimeSpan.FromSeconds(stepSeconds));
+
+        // Assert
+        history.Resolution.Should().Be(resolution);
+    }
+
+    [Fact]
+    public void GetHistory_ForUnrecordedServer_ShouldReturnNoPoints()
+    {
+        // Arrange
+        var service = CreateService();
+        Record(service, Start, 1);
+
+        // Act
+        var history = service.GetHistory(2, "cpu", Start, Start.AddHours(1), TimeSpan.FromMinutes(1));
+
+        // Assert
+        history.Points.Should().BeEmpty();
+    }
+
+    // Block header: seriesId, count, bitLength and tier as little-endian
+    // uint32s; block 0 is the file header
+    private static void DamageBlockTails(string path)
+    {
+        using var file = new FileStream(path, FileMode.Open, FileAccess.ReadWrite);
+        var block = new byte[BlockSize];
+        for (long offset = BlockSize; offset + BlockSize <= file.Length; offset += BlockSize)
+        {
+            file.Position = offset;
+            file.ReadExactly(block);
+            var count = BinaryPrimitives.ReadUInt32LittleEndian(block.AsSpan(4));
+            if (count == 0)
+                continue;
+
+            var used = (int)((BinaryPrimitives.ReadUInt32LittleEndian(block.AsSpan(8)) + 7) / 8);
+            BinaryPrimitives.WriteUInt32LittleEndian(block.AsSpan(4), count + 3);
+            block.AsSpan(BlockHeaderSize + used).Fill(0xFF);
+            file.Position = offset;
+            file.Write(block);
+        }
+    }
+}
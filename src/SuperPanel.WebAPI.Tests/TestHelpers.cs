@@ -1,4 +1,5 @@
 using System;
+using System.Runtime.InteropServices;
 
 namespace SuperPanel.WebAPI.Tests
 {
@@ -19,5 +20,13 @@ namespace SuperPanel.WebAPI.Tests
             var guid = Guid.NewGuid().ToString("N").Substring(0, 12);
             return $"ip-{guid}";
         }
+
+        // Tests of native code are skipped where the library is not built for
+        // this platform
+        public const string NativeLibraryName = "SuperPanel.NativeLibrary";
+        public const string NativeLibraryMissing = "SuperPanel.NativeLibrary is not built for this platform";
+
+        public static bool NativeLibraryAvailable { get; } =
+            NativeLibrary.TryLoad(NativeLibraryName, typeof(SuperPanel.WebAPI.Services.BackupService).Assembly, null, out _);
     }
 }
\ No newline at end of file
@@ -181,6 +181,33 @@ public class BackupsController : ControllerBase
         }
     }
 
+    /// <summary>
+    /// Verify a backup against its integrity manifest in the background; the
+    /// outcome is written to the backup's logs
+    /// </summary>
+    [HttpPost("{id}/verify")]
+    public async Task<IActionResult> VerifyBackup(int id)
+    {
+        try
+        {
+            await _backupService.VerifyBackupAsync(id);
+            return Accepted(new { message = "Backup verification started" });
+        }
+        catch (ArgumentException ex)
+        {
+            return NotFound(new { message = ex.Message });
+        }
+        catch (InvalidOperationException ex)
+        {
+            return BadRequest(new { message = ex.Message });
+        }
+        catch (Exception ex)
+        {
+            _logger.LogError(ex, "Error verifying backup {Id}", id);
+            return StatusCode(500, new { message = "Error verifying backup", error = ex.Message });
+        }
+    }
+
     /// <summary>
     /// Download a backup file
     /// </summary>
@@ -199,10 +226,27 @@ public class BackupsController : ControllerBase
             if (!System.IO.File.Exists(backup.FilePath))
                 return NotFound(new { message = "Backup file not found" });
 
-            var fileBytes = await System.IO.File.ReadAllBytesAsync(backup.FilePath);
-            var fileName = $"{backup.Name}_{backup.CreatedAt:yyyyMMdd_HHmmss}{Path.GetExtension(backup.FilePath)}";
+            var baseName = $"{backup.Name}_{backup.CreatedAt:yyyyMMdd_HHmmss}";
 
-            return File(fileBytes, "application/octet-stream", fileName);
+            // A deduplicated backup is only a manifest of chunk hashes; rebuild
+            // the archive from the chunk store and stream it from a temporary
+            // file that is removed once the response is done
+            if (backup.FilePath.EndsWith(".manifest", StringComparison.Ordinal))
+            {
+                var archivePath = await _backupService.ExportBackupArchiveAsync(backup);
+                var stream = new FileStream(archivePath, FileMode.Open, FileAccess.Read, FileShare.Read | FileShare.Delete, 64 * 1024,
+                    FileOptions.Asynchronous | FileOptions.SequentialScan | FileOptions.DeleteOnClose);
+                return File(stream, "application/zip", baseName + ".zip", enableRangeProcessing: true);
+            }
+
+            var fileName = baseName + Path.GetExtension(backup.FilePath);
+
+            var fileStream = MappedFileWindow.OpenReadStream(backup.FilePath);
+            return File(fileStream, "application/octet-stream", fileName, enableRangeProcessing: true);
+        }
+        catch (InvalidOperationException ex)
+        {
+            return BadRequest(new { message = ex.Message });
         }
         catch (Exception ex)
         {
@@ -15,17 +15,23 @@ public class DashboardController : ControllerBase
     private readonly IDomainService _domainService;
     private readonly IDatabaseService _databaseService;
     private readonly ISystemMonitoringService _systemMonitoring;
+    private readonly IAccessLogAnalyticsService _accessLogAnalytics;
+    private readonly IBackendLatencyService _backendLatency;
 
     public DashboardController(
         IServerService serverService,
         IDomainService domainService,
         IDatabaseService databaseService,
-        ISystemMonitoringService systemMonitoring)
+        ISystemMonitoringService systemMonitoring,
+        IAccessLogAnalyticsService accessLogAnalytics,
+        IBackendLatencyService backendLatency)
     {
         _serverService = serverService;
         _domainService = domainService;
         _databaseService = databaseService;
         _systemMonitoring = systemMonitoring;
+        _accessLogAnalytics = accessLogAnalytics;
+        _backendLatency = backendLatency;
     }
 
     private int GetCurrentUserId()
@@ -79,6 +85,63 @@ public class DashboardController : ControllerBase
         return Ok(stats);
     }
 
+    /// <summary>
+    /// Get per-domain traffic statistics parsed from the web server access logs
+    /// </summary>
+    [HttpGet("traffic")]
+    public async Task<ActionResult<TrafficStats>> GetTraffic()
+    {
+        var traffic = _accessLogAnalytics.GetTrafficStats();
+
+        // Non-admins only see their own domains
+        if (!IsAdministrator())
+        {
+            var currentUserId = GetCurrentUserId();
+            var domains = await _domainService.GetAllDomainsAsync();
+            var owned = domains
+                .Where(d => d.UserId == currentUserId)
+                .Select(d => d.Name.ToLowerInvariant())
+                .ToHashSet();
+            traffic.Domains = traffic.Domains.Where(d => owned.Contains(d.Domain)).ToList();
+        }
+
+        return Ok(traffic);
+    }
+
+    /// <summary>
+    /// Get unique visitors and the top clients and paths over a rolling window of the access logs
+    /// </summary>
+    [HttpGet("traffic/window")]
+    public async Task<ActionResult<TrafficWindow>> GetTrafficWindow([FromQuery] string? domain, [FromQuery] int minutes = 15, [FromQuery] int top = 10)
+    {
+        // Non-admins must name one of their own domains
+        if (!IsAdministrator())
+        {
+            if (string.IsNullOrEmpty(domain))
+            {
+                return BadRequest("A domain is required");
+            }
+            var currentUserId = GetCurrentUserId();
+            var domains = await _domainService.GetAllDomainsAsync();
+            if (!domains.Any(d => d.UserId == currentUserId && string.Equals(d.Name, domain, StringComparison.OrdinalIgnoreCase)))
+            {
+                return Forbid();
+            }
+        }
+
+        return Ok(_accessLogAnalytics.GetTrafficWindow(domain, minutes, top));
+    }
+
+    /// <summary>
+    /// Get connect and request latency percentiles of the configured database and cache backends
+    /// </summary>
+    [HttpGet("backend-latency")]
+    [Authorize(Roles = "Administrator")]
+    public ActionResult<List<BackendLatency>> GetBackendLatency([FromQuery] int windows = 15)
+    {
+        return Ok(_backendLatency.GetBackendLatency(windows));
+    }
+
     private async Task<SystemInfo> GetSystemInfo()
     {
         try
@@ -107,6 +170,8 @@ public class DashboardController : ControllerBase
                     MemoryUsageMB = p.MemoryMB,
                     ProcessId = p.Id
                 }).ToList() ?? new List<ProcessInfo>(),
+                NetworkInBytesPerSecond = systemInfo.NetworkInBytesPerSecond,
+                NetworkOutBytesPerSecond = systemInfo.NetworkOutBytesPerSecond,
                 LastUpdated = systemInfo.LastUpdated
             };
         }
@@ -160,6 +225,8 @@ public class SystemInfo
     public double AvailableMemoryMB { get; set; }
     public List<DriveInfo> Drives { get; set; } = new List<DriveInfo>();
     public List<ProcessInfo> TopProcesses { get; set; } = new List<ProcessInfo>();
+    public double NetworkInBytesPerSecond { get; set; }
+    public double NetworkOutBytesPerSecond { get; set; }
     public DateTime LastUpdated { get; set; }
 }
 
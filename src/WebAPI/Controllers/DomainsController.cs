@@ -151,6 +151,70 @@ public class DomainsController : ControllerBase
         return NoContent();
     }
 
+    // Health check endpoints
+
+    /// <summary>
+    /// Check every domain the user can see over HTTP(S) at once
+    /// </summary>
+    [HttpPost("health-check")]
+    public async Task<ActionResult<List<DomainHealthCheck>>> CheckDomainsHealth([FromQuery] int timeoutMs = 10000)
+    {
+        var currentUserId = GetCurrentUserId();
+        var domains = await _domainService.GetAllDomainsAsync();
+
+        // Filter domains by user ownership unless user is admin
+        if (!IsAdministrator())
+        {
+            domains = domains.Where(d => d.UserId == currentUserId).ToList();
+        }
+
+        var checks = await _domainService.CheckDomainHealthAsync(domains, timeoutMs);
+        return Ok(checks);
+    }
+
+    /// <summary>
+    /// Check one domain over HTTP(S) now (with ownership validation)
+    /// </summary>
+    [HttpGet("{id}/health")]
+    public async Task<ActionResult<DomainHealthCheck>> CheckDomainHealth(int id, [FromQuery] int timeoutMs = 10000)
+    {
+        var currentUserId = GetCurrentUserId();
+        var domain = await _domainService.GetDomainByIdAsync(id);
+
+        if (domain == null)
+            return NotFound();
+
+        // Check ownership unless user is admin
+        if (!IsAdministrator() && domain.UserId != currentUserId)
+            return Forbid();
+
+        var checks = await _domainService.CheckDomainHealthAsync(new[] { domain }, timeoutMs);
+        return Ok(checks[0]);
+    }
+
+    /// <summary>
+    /// Get the latency histogram of a domain's health checks (with ownership validation)
+    /// </summary>
+    [HttpGet("{id}/latency")]
+    public async Task<ActionResult<DomainLatencyHistogram>> GetDomainLatency(int id)
+    {
+        var currentUserId = GetCurrentUserId();
+        var domain = await _domainService.GetDomainByIdAsync(id);
+
+        if (domain == null)
+            return NotFound();
+
+        // Check ownership unless user is admin
+        if (!IsAdministrator() && domain.UserId != currentUserId)
+            return Forbid();
+
+        var histogram = _domainService.GetDomainLatency(domain.Name);
+        if (histogram == null)
+            return NotFound();
+
+        return Ok(histogram);
+    }
+
     // DNS Record endpoints
 
     /// <summary>
@@ -50,6 +50,32 @@ public class FilesController : ControllerBase
         return Ok(new { content });
     }
 
+    /// <summary>
+    /// Read a range of lines (for viewing large files)
+    /// </summary>
+    [HttpGet("lines")]
+    public async Task<ActionResult<FileLinesResult>> ReadFileLines([FromQuery] string filePath, [FromQuery] long start = 0, [FromQuery] int count = 100)
+    {
+        var result = await _fileService.ReadFileLinesAsync(filePath, start, count);
+        if (result == null)
+            return NotFound();
+
+        return Ok(result);
+    }
+
+    /// <summary>
+    /// Download file (supports HTTP range requests)
+    /// </summary>
+    [HttpGet("download")]
+    public async Task<IActionResult> DownloadFile([FromQuery] string filePath)
+    {
+        var stream = await _fileService.OpenReadStreamAsync(filePath);
+        if (stream == null)
+            return NotFound();
+
+        return File(stream, "application/octet-stream", Path.GetFileName(filePath), enableRangeProcessing: true);
+    }
+
     /// <summary>
     /// Write file content
     /// </summary>
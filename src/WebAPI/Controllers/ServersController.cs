@@ -13,11 +13,13 @@ public class ServersController : ControllerBase
 {
     private readonly IServerService _serverService;
     private readonly ISystemMonitoringService _systemMonitoring;
+    private readonly IMetricsHistoryService _metricsHistory;
 
-    public ServersController(IServerService serverService, ISystemMonitoringService systemMonitoring)
+    public ServersController(IServerService serverService, ISystemMonitoringService systemMonitoring, IMetricsHistoryService metricsHistory)
     {
         _serverService = serverService;
         _systemMonitoring = systemMonitoring;
+        _metricsHistory = metricsHistory;
     }
 
     private int GetCurrentUserId()
@@ -72,6 +74,57 @@ public class ServersController : ControllerBase
         return Ok(server);
     }
 
+    /// <summary>
+    /// Get a server's history of one metric (default: the last hour) as min/max/avg/last per
+    /// step. The step defaults to the range split into maxPoints; coarse steps read rollups.
+    /// </summary>
+    [HttpGet("{id}/metrics/history")]
+    public async Task<ActionResult<MetricHistory>> GetMetricHistory(int id, [FromQuery] string metric = "cpu",
+        [FromQuery] DateTime? from = null, [FromQuery] DateTime? to = null, [FromQuery] int maxPoints = 500,
+        [FromQuery] double? stepSeconds = null)
+    {
+        var currentUserId = GetCurrentUserId();
+        var server = await _serverService.GetServerByIdAsync(id);
+
+        if (server == null)
+            return NotFound();
+
+        if (!IsAdministrator() && server.UserId != currentUserId)
+            return Forbid();
+
+        if (!_metricsHistory.MetricNames.Contains(metric, StringComparer.OrdinalIgnoreCase))
+            return BadRequest($"Unknown metric; expected one of {string.Join(", ", _metricsHistory.MetricNames)}");
+
+        var end = (to ?? DateTime.UtcNow).ToUniversalTime();
+        var start = (from ?? end.AddHours(-1)).ToUniversalTime();
+        if (start >= end)
+            return BadRequest("from must be before to");
+
+        var points = Math.Clamp(maxPoints, 1, 100000);
+        var step = stepSeconds > 0
+            ? TimeSpan.FromSeconds(Math.Clamp(stepSeconds.Value, 0.001, TimeSpan.FromDays(366).TotalSeconds))
+            : DefaultHistoryStep(end - start, points);
+        if ((end - start).Ticks / step.Ticks > 100000)
+            return BadRequest("At most 100000 steps can be returned");
+
+        var history = _metricsHistory.GetHistory(id, metric, start, end, step);
+        return Ok(history);
+    }
+
+    // The range split into at most points steps, rounded up to a whole
+    // number of the widest rollup tier (1h, 5m, 1m) that fits, so the
+    // history is read from rollups that line up with the steps
+    private static TimeSpan DefaultHistoryStep(TimeSpan range, int points)
+    {
+        var ticks = Math.Max(TimeSpan.TicksPerMillisecond, (range.Ticks + points - 1) / points);
+        foreach (var width in new[] { TimeSpan.TicksPerHour, 5 * TimeSpan.TicksPerMinute, TimeSpan.TicksPerMinute })
+        {
+            if (ticks >= width)
+                return TimeSpan.FromTicks((ticks + width - 1) / width * width);
+        }
+        return TimeSpan.FromTicks(ticks);
+    }
+
     /// <summary>
     /// Create a new server (assigned to current user)
     /// </summary>
@@ -155,4 +208,70 @@ public class ServersController : ControllerBase
         var systemInfo = await _systemMonitoring.GetSystemInfoAsync();
         return Ok(systemInfo);
     }
+
+    /// <summary>
+    /// Count this host's TCP sockets by state, local port and remote address
+    /// </summary>
+    [HttpGet("system-info/connections")]
+    public async Task<ActionResult<TcpConnectionCensus>> GetConnections([FromQuery] int top = 10)
+    {
+        var census = await _systemMonitoring.GetTcpCensusAsync(Math.Clamp(top, 0, 100));
+        return Ok(census);
+    }
+
+    /// <summary>
+    /// List this host's listening TCP and UDP sockets with their owning processes
+    /// </summary>
+    [HttpGet("system-info/listeners")]
+    public async Task<ActionResult<List<ListeningSocketInfo>>> GetListeners()
+    {
+        var listeners = await _systemMonitoring.GetListeningSocketsAsync();
+        return Ok(listeners);
+    }
+
+    /// <summary>
+    /// Get this host's kernel TCP/IP counters: retransmits, listen-queue overflows, timeouts
+    /// </summary>
+    [HttpGet("system-info/network-stack")]
+    public async Task<ActionResult<NetworkStackStats>> GetNetworkStack()
+    {
+        var stats = await _systemMonitoring.GetNetworkStackStatsAsync();
+        return Ok(stats);
+    }
+
+    /// <summary>
+    /// Check whether TCP ports accept connections and report the connect times
+    /// </summary>
+    [HttpPost("port-check")]
+    [Authorize(Roles = "Administrator")]
+    public async Task<ActionResult<List<PortCheckResult>>> CheckPorts([FromBody] List<PortCheckTarget> targets)
+    {
+        if (targets.Count == 0 || targets.Count > 1000)
+        {
+            return BadRequest("Between 1 and 1000 targets are required");
+        }
+        if (targets.Any(t => string.IsNullOrWhiteSpace(t.Host) || t.Port < 1 || t.Port > 65535 || t.TimeoutMs < 1 || t.TimeoutMs > 30000))
+        {
+            return BadRequest("Each target needs a host, a port between 1 and 65535 and a timeout of at most 30000 ms");
+        }
+
+        var results = await _systemMonitoring.CheckPortsAsync(targets);
+        return Ok(results);
+    }
+
+    /// <summary>
+    /// Ping hosts or send UDP requests (DNS, NTP or a raw payload) and report round trips and loss
+    /// </summary>
+    [HttpPost("reachability")]
+    [Authorize(Roles = "Administrator")]
+    public async Task<ActionResult<List<ReachabilityResult>>> CheckReachability([FromBody] ReachabilityCheckRequest request)
+    {
+        if (request.Targets.Count == 0 || request.Targets.Count > 1000)
+        {
+            return BadRequest("Between 1 and 1000 targets are required");
+        }
+
+        var results = await _systemMonitoring.CheckReachabilityAsync(request);
+        return Ok(results);
+    }
 }
\ No newline at end of file
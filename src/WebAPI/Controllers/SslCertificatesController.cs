@@ -4,6 +4,8 @@ using Microsoft.EntityFrameworkCore;
 using SuperPanel.WebAPI.Data;
 using SuperPanel.WebAPI.Models;
 using SuperPanel.WebAPI.Services;
+using System.Net;
+using System.Net.NetworkInformation;
 using System.Security.Claims;
 
 namespace SuperPanel.WebAPI.Controllers;
@@ -37,6 +39,18 @@ public class SslCertificatesController : ControllerBase
         return User.IsInRole("Administrator");
     }
 
+    // Loopback or an address of one of this server's interfaces
+    private static bool IsLocalAddress(string? address)
+    {
+        if (!IPAddress.TryParse(address, out var parsed))
+            return false;
+        if (IPAddress.IsLoopback(parsed))
+            return true;
+        return NetworkInterface.GetAllNetworkInterfaces()
+            .SelectMany(n => n.GetIPProperties().UnicastAddresses)
+            .Any(u => u.Address.Equals(parsed));
+    }
+
     // GET: api/ssl-certificates
     [HttpGet]
     public async Task<ActionResult<IEnumerable<SslCertificate>>> GetSslCertificates()
@@ -100,6 +114,38 @@ public class SslCertificatesController : ControllerBase
         return Ok(certificates);
     }
 
+    // GET: api/ssl-certificates/scan/files
+    [HttpGet("scan/files")]
+    [Authorize(Roles = "Administrator")]
+    public async Task<ActionResult<IEnumerable<CertificateScanResult>>> ScanCertificateFiles([FromQuery] string[]? directories = null)
+    {
+        var results = await _sslService.ScanCertificateFilesAsync(directories is { Length: > 0 } ? directories : null);
+        return Ok(results);
+    }
+
+    // POST: api/ssl-certificates/scan/endpoints
+    [HttpPost("scan/endpoints")]
+    public async Task<ActionResult<IEnumerable<CertificateScanResult>>> ScanCertificateEndpoints([FromBody] EndpointScanRequest request)
+    {
+        var currentUserId = GetCurrentUserId();
+        var query = _context.Domains.AsQueryable();
+        if (!IsAdministrator())
+        {
+            // Only administrators may point the scanner at other hosts or
+            // ports; everyone else checks what this server itself serves
+            if (!IsLocalAddress(request.Address) || request.Port != 443)
+                return Forbid();
+            query = query.Where(d => d.UserId == currentUserId);
+        }
+        query = request.DomainIds is { Count: > 0 }
+            ? query.Where(d => request.DomainIds.Contains(d.Id))
+            : query.Where(d => d.SslEnabled);
+
+        var domains = await query.OrderBy(d => d.Name).ToListAsync();
+        var results = await _sslService.ScanDomainEndpointsAsync(domains, request.Address, request.Port, request.TimeoutMs);
+        return Ok(results);
+    }
+
     // POST: api/ssl-certificates/request
     [HttpPost("request")]
     public async Task<ActionResult<SslCertificate>> RequestCertificate([FromBody] CertificateRequest request)
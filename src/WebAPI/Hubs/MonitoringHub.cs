@@ -1,10 +1,14 @@
 using Microsoft.AspNetCore.SignalR;
 using Microsoft.AspNetCore.Authorization;
+using Microsoft.EntityFrameworkCore;
+using System.Security.Claims;
 using System.Threading.Tasks;
 using System.Collections.Generic;
 using System.Linq;
 using System;
+using SuperPanel.WebAPI.Data;
 using SuperPanel.WebAPI.Models;
+using SuperPanel.WebAPI.Services;
 
 namespace SuperPanel.WebAPI.Hubs
 {
@@ -13,6 +17,14 @@ namespace SuperPanel.WebAPI.Hubs
     {
         private static readonly Dictionary<string, ServerMetrics> _serverMetrics = new();
         private static readonly object _lock = new();
+        private readonly ILogTailService _logTailService;
+        private readonly IDbContextFactory<ApplicationDbContext> _dbContextFactory;
+
+        public MonitoringHub(ILogTailService logTailService, IDbContextFactory<ApplicationDbContext> dbContextFactory)
+        {
+            _logTailService = logTailService;
+            _dbContextFactory = dbContextFactory;
+        }
 
         public override async Task OnConnectedAsync()
         {
@@ -25,6 +37,7 @@ namespace SuperPanel.WebAPI.Hubs
         {
             var userId = Context.User?.Identity?.Name ?? "Anonymous";
             await Groups.RemoveFromGroupAsync(Context.ConnectionId, $"user_{userId}");
+            _logTailService.UnsubscribeAll(Context.ConnectionId);
             await base.OnDisconnectedAsync(exception);
         }
 
@@ -52,6 +65,46 @@ namespace SuperPanel.WebAPI.Hubs
             await Groups.RemoveFromGroupAsync(Context.ConnectionId, $"server_{serverId}");
         }
 
+        [Authorize(Roles = "Administrator")]
+        public async Task SubscribeToLog(string path)
+        {
+            if (!_logTailService.Subscribe(Context.ConnectionId, path))
+            {
+                throw new HubException("Log tailing is not available for this path");
+            }
+            await Groups.AddToGroupAsync(Context.ConnectionId, LogTailService.GroupName(System.IO.Path.GetFullPath(path)));
+        }
+
+        public async Task UnsubscribeFromLog(string path)
+        {
+            _logTailService.Unsubscribe(Context.ConnectionId, path);
+            await Groups.RemoveFromGroupAsync(Context.ConnectionId, LogTailService.GroupName(System.IO.Path.GetFullPath(path)));
+        }
+
+        // Only the backup's creator and administrators may follow its progress
+        public async Task SubscribeToBackupProgress(int backupId)
+        {
+            if (Context.User?.IsInRole("Administrator") != true)
+            {
+                await using var context = await _dbContextFactory.CreateDbContextAsync();
+                var ownerId = await context.Backups
+                    .Where(b => b.Id == backupId)
+                    .Select(b => (int?)b.CreatedByUserId)
+                    .FirstOrDefaultAsync();
+                var userIdClaim = Context.User?.FindFirst(ClaimTypes.NameIdentifier);
+                if (ownerId == null || userIdClaim == null || !int.TryParse(userIdClaim.Value, out var userId) || userId != ownerId)
+                {
+                    throw new HubException("Backup not found");
+                }
+            }
+            await Groups.AddToGroupAsync(Context.ConnectionId, $"backup_{backupId}");
+        }
+
+        public async Task UnsubscribeFromBackupProgress(int backupId)
+        {
+            await Groups.RemoveFromGroupAsync(Context.ConnectionId, $"backup_{backupId}");
+        }
+
         // Method to broadcast metrics updates (called by background service)
         public static async Task BroadcastServerMetrics(IHubContext<MonitoringHub> hubContext, int serverId, ServerMetrics metrics)
         {
@@ -63,6 +116,12 @@ namespace SuperPanel.WebAPI.Hubs
             await hubContext.Clients.Group($"server_{serverId}").SendAsync("ReceiveServerMetrics", serverId, metrics);
         }
 
+        // Sent about twice a second while a restore extracts its backup
+        public static async Task BroadcastRestoreProgress(IHubContext<MonitoringHub> hubContext, RestoreProgress progress)
+        {
+            await hubContext.Clients.Group($"backup_{progress.BackupId}").SendAsync("ReceiveRestoreProgress", progress);
+        }
+
         // Method to broadcast alerts
         public static async Task BroadcastAlert(IHubContext<MonitoringHub> hubContext, ServerAlert alert)
         {
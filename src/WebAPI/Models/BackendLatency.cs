@@ -0,0 +1,51 @@
+namespace SuperPanel.WebAPI.Models;
+
+// A database or cache endpoint probed continuously, from BackendLatency:Targets
+public class BackendLatencyTarget
+{
+    public string Name { get; set; } = string.Empty;
+    public string Host { get; set; } = string.Empty;
+    public int Port { get; set; }
+    public int IntervalMs { get; set; } = 1000;
+    public int TimeoutMs { get; set; } = 3000;
+    // Sent once connected, e.g. "PING\r\n" for Redis
+    public string? Request { get; set; }
+    // The response must start with exactly this, e.g. "+PONG\r\n"
+    public string? Expect { get; set; }
+}
+
+public class LatencyPercentiles
+{
+    public long Count { get; set; }
+    public double MinMs { get; set; }
+    public double MeanMs { get; set; }
+    public double P50Ms { get; set; }
+    public double P90Ms { get; set; }
+    public double P99Ms { get; set; }
+    public double P999Ms { get; set; }
+    public double MaxMs { get; set; }
+}
+
+public class BackendLatencyWindow
+{
+    public DateTime Start { get; set; }
+    public double DurationSeconds { get; set; }
+    public long Probes { get; set; }
+    public long Failures { get; set; }
+    public long Timeouts { get; set; }
+    public int LastError { get; set; }
+    public LatencyPercentiles? Connect { get; set; }
+    // Request to response, for targets with a request or expected response
+    public LatencyPercentiles? Exchange { get; set; }
+}
+
+public class BackendLatency
+{
+    public string Name { get; set; } = string.Empty;
+    public string Host { get; set; } = string.Empty;
+    public int Port { get; set; }
+    public int IntervalMs { get; set; }
+    public BackendLatencyWindow? Totals { get; set; }
+    // Newest first; the first is still open
+    public List<BackendLatencyWindow> Windows { get; set; } = new();
+}
@@ -67,4 +67,60 @@ public enum SubdomainStatus
     Active = 1,
     Inactive = 2,
     Suspended = 3
+}
+
+public class DomainHealthCheck
+{
+    public int DomainId { get; set; }
+    public string Domain { get; set; } = string.Empty;
+    public string Url { get; set; } = string.Empty;
+    public HttpCheckStatus Status { get; set; }
+    public int HttpStatus { get; set; } // 0 without a response
+    // Phase timings; null for phases not reached or not measured. A reused
+    // connection skips DNS, connect and TLS (0).
+    public double? DnsMs { get; set; }
+    public double? ConnectMs { get; set; }
+    public double? TlsMs { get; set; }
+    public double? TtfbMs { get; set; }
+    public double? TotalMs { get; set; }
+    public long BodyBytes { get; set; }
+    public bool ConnectionReused { get; set; }
+    public int Error { get; set; }
+    public int CertificateError { get; set; } // X509_V_ERR_* when the certificate was rejected
+    public DateTime CheckedAt { get; set; } = DateTime.UtcNow;
+}
+
+public enum HttpCheckStatus
+{
+    Ok = 0,
+    InvalidUrl = 1,
+    Unresolved = 2,
+    ConnectFailed = 3,
+    TlsFailed = 4,
+    Timeout = 5,
+    BadResponse = 6
+}
+
+public class DomainLatencyHistogram
+{
+    public string Domain { get; set; } = string.Empty;
+    public long Checks { get; set; }
+    public long Failures { get; set; }
+    public List<LatencyBucket> Buckets { get; set; } = new();
+    // Over successful checks
+    public double? AverageDnsMs { get; set; }
+    public double? AverageConnectMs { get; set; }
+    public double? AverageTlsMs { get; set; }
+    public double? AverageTtfbMs { get; set; }
+    public double? AverageTotalMs { get; set; }
+    // Upper bounds of the buckets holding each percentile
+    public long? P50Ms { get; set; }
+    public long? P95Ms { get; set; }
+    public long? P99Ms { get; set; }
+}
+
+public class LatencyBucket
+{
+    public long? UpperBoundMs { get; set; } // Null for the open-ended last bucket
+    public long Count { get; set; }
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+namespace SuperPanel.WebAPI.Models;
+
+// One step of a metric's history: the samples from Timestamp up to the next step
+public class MetricPoint
+{
+    public DateTime Timestamp { get; set; }
+    // Average over the step
+    public double Value { get; set; }
+    public double Min { get; set; }
+    public double Max { get; set; }
+    public double Last { get; set; }
+    public long Count { get; set; }
+}
+
+public class MetricHistory
+{
+    public int ServerId { get; set; }
+    // cpu, memory, disk, networkIn, networkOut or connections
+    public string Metric { get; set; } = string.Empty;
+    public DateTime From { get; set; }
+    public DateTime To { get; set; }
+    public double StepSeconds { get; set; }
+    // What the steps were computed from: raw, 1m, 5m or 1h rollups
+    public string Resolution { get; set; } = "raw";
+    // Oldest first; steps without samples are left out
+    public List<MetricPoint> Points { get; set; } = new();
+}
@@ -68,4 +68,66 @@ public enum SslCertificateType
     LetsEncrypt = 1,
     Custom = 2,
     SelfSigned = 3
+}
+
+public class CertificateScanResult
+{
+    public string Source { get; set; } = string.Empty; // File path, or the server name of an endpoint
+    public CertificateScanStatus Status { get; set; }
+    public string? Subject { get; set; }
+    public string? Issuer { get; set; }
+    public List<string> Names { get; set; } = new(); // Subject alternative names
+    public int NameCount { get; set; } // Names in the certificate, if more than were listed
+    public string? Fingerprint { get; set; } // SHA-256, hex
+    public DateTime? NotBefore { get; set; }
+    public DateTime? NotAfter { get; set; }
+    public int? DaysRemaining { get; set; }
+    public int ChainLength { get; set; }
+    public int KeyBits { get; set; }
+    public bool IsCa { get; set; } // A chain or root file rather than a server certificate
+    public List<string> Issues { get; set; } = new(); // CertificateIssues names
+    public int VerifyError { get; set; } // X509_V_ERR_* when the chain did not verify
+    public string? Protocol { get; set; } // Endpoints only
+    public double? ConnectMs { get; set; }
+    public double? HandshakeMs { get; set; }
+    public int Error { get; set; }
+    // The tracked certificate this file or domain belongs to, if any
+    public int? CertificateId { get; set; }
+    public DateTime? TrackedExpiresAt { get; set; }
+}
+
+public enum CertificateScanStatus
+{
+    Ok = 0,
+    Unreadable = 1,
+    Unresolved = 2,
+    ConnectFailed = 3,
+    TlsFailed = 4,
+    Timeout = 5
+}
+
+[Flags]
+public enum CertificateIssues
+{
+    None = 0,
+    Expired = 0x001,
+    NotYetValid = 0x002,
+    SelfSigned = 0x004,
+    Untrusted = 0x008,
+    IncompleteChain = 0x010,
+    ChainOrder = 0x020,
+    ChainExpired = 0x040,
+    NameMismatch = 0x080,
+    WeakKey = 0x100,
+    WeakSignature = 0x200
+}
+
+// Non-administrators may only scan port 443 on loopback or this server's
+// own addresses
+public class EndpointScanRequest
+{
+    public List<int>? DomainIds { get; set; } // Null for every domain with SSL enabled
+    public string? Address { get; set; } = "127.0.0.1"; // Where to connect; null resolves each name
+    public int Port { get; set; } = 443;
+    public int TimeoutMs { get; set; } = 5000;
 }
\ No newline at end of file
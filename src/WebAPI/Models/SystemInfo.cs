@@ -10,6 +10,11 @@ public class SystemInfo
     public double CpuUsagePercent { get; set; }
     public List<DriveInfo> Drives { get; set; } = new();
     public List<ProcessInfo> TopProcesses { get; set; } = new();
+    public List<NetworkInterfaceStats> NetworkInterfaces { get; set; } = new();
+    public double NetworkInBytesPerSecond { get; set; }  // Physical links, or all but loopback if there are none
+    public double NetworkOutBytesPerSecond { get; set; }
+    public long ActiveTcpConnections { get; set; } // Established
+    public NetworkStackStats? NetworkStack { get; set; }
     public DateTime LastUpdated { get; set; } = DateTime.UtcNow;
 }
 
@@ -30,6 +35,202 @@ public class ProcessInfo
     public long MemoryMB { get; set; }
 }
 
+public class NetworkInterfaceStats
+{
+    public string Name { get; set; } = string.Empty;
+    public NetworkInterfaceKind Kind { get; set; }
+    public bool IsUp { get; set; }
+    public long BytesReceived { get; set; }
+    public long BytesSent { get; set; }
+    public long PacketsReceived { get; set; }
+    public long PacketsSent { get; set; }
+    public long ReceiveErrors { get; set; }
+    public long SendErrors { get; set; }
+    public long ReceiveDropped { get; set; }
+    public long SendDropped { get; set; }
+    // Since the previous sample
+    public double ReceiveBytesPerSecond { get; set; }
+    public double SendBytesPerSecond { get; set; }
+    public double ReceivePacketsPerSecond { get; set; }
+    public double SendPacketsPerSecond { get; set; }
+    public double ReceiveErrorsPerSecond { get; set; }
+    public double SendErrorsPerSecond { get; set; }
+    public double ReceiveDroppedPerSecond { get; set; }
+    public double SendDroppedPerSecond { get; set; }
+}
+
+// Kernel TCP/IP counters. Nullable counters are not reported on every platform.
+public class NetworkStackStats
+{
+    // Cumulative since boot
+    public long TcpActiveOpens { get; set; }
+    public long TcpPassiveOpens { get; set; }
+    public long TcpAttemptFails { get; set; }
+    public long TcpEstablishedResets { get; set; }
+    public long TcpSegmentsReceived { get; set; }
+    public long TcpSegmentsSent { get; set; }
+    public long TcpSegmentsRetransmitted { get; set; }
+    public long TcpReceiveErrors { get; set; }
+    public long TcpResetsSent { get; set; }
+    public long? ListenOverflows { get; set; } // Accept queue full
+    public long? ListenDrops { get; set; }
+    public long? TcpTimeouts { get; set; }
+    public long? TcpSynRetransmits { get; set; }
+    public long? TcpAbortsOnTimeout { get; set; }
+    public long? TcpAbortsOnMemory { get; set; }
+    public long? TcpBacklogDrops { get; set; }
+    public long? SyncookiesSent { get; set; }
+    public long? TcpRequestQueueFullDrops { get; set; }
+    public long UdpDatagramsReceived { get; set; }
+    public long UdpDatagramsSent { get; set; }
+    public long UdpNoPorts { get; set; }
+    public long UdpReceiveErrors { get; set; }
+    public long? UdpReceiveBufferErrors { get; set; }
+    public long? UdpSendBufferErrors { get; set; }
+    // Current
+    public long TcpCurrentEstablished { get; set; }
+    public long? TcpSocketsInUse { get; set; }
+    public long? TcpOrphans { get; set; }
+    public long? TcpTimeWait { get; set; }
+    public long? TcpMemoryPages { get; set; }
+    public long? UdpSocketsInUse { get; set; }
+    public long? SocketsUsed { get; set; }
+    // Since the previous sample
+    public double TcpSegmentsReceivedPerSecond { get; set; }
+    public double TcpSegmentsSentPerSecond { get; set; }
+    public double TcpRetransmitsPerSecond { get; set; }
+    public double TcpAttemptFailsPerSecond { get; set; }
+    public double TcpEstablishedResetsPerSecond { get; set; }
+    public double TcpReceiveErrorsPerSecond { get; set; }
+    public double TcpResetsSentPerSecond { get; set; }
+    public double ListenOverflowsPerSecond { get; set; }
+    public double ListenDropsPerSecond { get; set; }
+    public double TcpTimeoutsPerSecond { get; set; }
+    public double TcpSynRetransmitsPerSecond { get; set; }
+    public double UdpReceiveErrorsPerSecond { get; set; }
+    public double UdpReceiveBufferErrorsPerSecond { get; set; }
+    public double RetransmitPercent { get; set; } // Share of segments sent that were retransmissions
+}
+
+public enum NetworkInterfaceKind
+{
+    Physical = 0,
+    Virtual = 1,
+    Bridge = 2,
+    Veth = 3,
+    Loopback = 4
+}
+
+public class TcpConnectionCensus
+{
+    public long Total { get; set; }
+    public Dictionary<string, long> States { get; set; } = new(); // "Established", "TimeWait", ... for states present
+    public long Ipv4 { get; set; }
+    public long Ipv6 { get; set; }
+    public string Source { get; set; } = string.Empty; // sock_diag, proc, iphelper or managed
+    public double ElapsedMs { get; set; }
+    public List<TcpPortConnections> TopLocalPorts { get; set; } = new();
+    public List<TcpRemoteConnections> TopRemoteAddresses { get; set; } = new();
+}
+
+public class TcpPortConnections
+{
+    public int Port { get; set; }
+    public long Connections { get; set; }
+}
+
+public class TcpRemoteConnections
+{
+    public string Address { get; set; } = string.Empty;
+    public long Connections { get; set; }
+}
+
+public class ListeningSocketInfo
+{
+    public string Address { get; set; } = string.Empty;
+    public int Port { get; set; }
+    public string Protocol { get; set; } = "tcp"; // tcp or udp
+    public int? Pid { get; set; } // Null where the owner is unknown or not visible to the panel
+    public string? ProcessName { get; set; }
+    public int Processes { get; set; } // Processes sharing the socket, e.g. prefork workers
+    public long? Uid { get; set; }
+    public long AcceptQueue { get; set; }
+    public long Backlog { get; set; }
+    public bool IsLoopback { get; set; }
+    public bool? IsExpected { get; set; } // Null unless Monitoring:ExpectedListeningPorts is configured
+}
+
+public class PortCheckTarget
+{
+    public string Host { get; set; } = string.Empty;
+    public int Port { get; set; }
+    public int TimeoutMs { get; set; } = 3000;
+}
+
+public class PortCheckResult
+{
+    public string Host { get; set; } = string.Empty;
+    public int Port { get; set; }
+    public PortStatus Status { get; set; }
+    public double? RoundTripMs { get; set; } // Connect time for open and closed ports
+    public int Error { get; set; }
+}
+
+public enum PortStatus
+{
+    Closed = 0,
+    Open = 1,
+    Timeout = 2,
+    Unreachable = 3,
+    Error = 4,
+    Unresolved = 5
+}
+
+public class ReachabilityTarget
+{
+    public string Host { get; set; } = string.Empty;
+    public string Protocol { get; set; } = "icmp"; // icmp or udp
+    public int Port { get; set; } // UDP only
+    // UDP: "dns" or "ntp" for a built-in request matched by id, null to pick one by port
+    public string? Template { get; set; }
+    // UDP: raw request text instead of a template; replies are matched to the latest request
+    public string? Payload { get; set; }
+}
+
+public class ReachabilityCheckRequest
+{
+    public List<ReachabilityTarget> Targets { get; set; } = new();
+    public int Packets { get; set; } = 4;
+    public int IntervalMs { get; set; } = 200;
+    public int TimeoutMs { get; set; } = 1000; // Per reply
+}
+
+public class ReachabilityResult
+{
+    public string Host { get; set; } = string.Empty;
+    public string Protocol { get; set; } = "icmp";
+    public int Port { get; set; }
+    public ReachabilityStatus Status { get; set; }
+    public int Sent { get; set; }
+    public int Received { get; set; }
+    public double LossPercent { get; set; }
+    public double? MinMs { get; set; }
+    public double? AvgMs { get; set; }
+    public double? MaxMs { get; set; }
+    public double? MdevMs { get; set; } // Standard deviation of the round trips, as ping reports it
+    public int Error { get; set; }
+}
+
+public enum ReachabilityStatus
+{
+    Ok = 0,
+    NoReply = 1,
+    Refused = 2, // UDP port unreachable
+    Unreachable = 3,
+    Error = 4,
+    Unresolved = 5
+}
+
 public class FileSystemItem
 {
     public string Name { get; set; } = string.Empty;
@@ -38,4 +239,13 @@ public class FileSystemItem
     public long SizeBytes { get; set; }
     public DateTime LastModified { get; set; }
     public string Permissions { get; set; } = string.Empty;
+}
+
+public class FileLinesResult
+{
+    public long StartLine { get; set; }
+    public List<string> Lines { get; set; } = new List<string>();
+    // Lines counted so far; a lower bound until TotalLinesExact is set
+    public long TotalLines { get; set; }
+    public bool TotalLinesExact { get; set; }
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+namespace SuperPanel.WebAPI.Models;
+
+public class DomainTrafficStats
+{
+    public string Domain { get; set; } = string.Empty;
+    public long Requests { get; set; }
+    // Rate and latency percentiles cover the last 15 minutes only
+    public long RecentRequests { get; set; }
+    public double RequestsPerMinute { get; set; }
+    public long Status1xx { get; set; }
+    public long Status2xx { get; set; }
+    public long Status3xx { get; set; }
+    public long Status4xx { get; set; }
+    public long Status5xx { get; set; }
+    public long BytesSent { get; set; }
+    public DateTime? FirstRequest { get; set; }
+    public DateTime? LastRequest { get; set; }
+    public double LatencyP50Ms { get; set; }
+    public double LatencyP95Ms { get; set; }
+    public double LatencyP99Ms { get; set; }
+}
+
+public class TrafficStats
+{
+    public List<DomainTrafficStats> Domains { get; set; } = new();
+    public long MalformedLines { get; set; }
+    public DateTime? LastAnalyzed { get; set; }
+}
+
+public class TrafficTopEntry
+{
+    public string Key { get; set; } = string.Empty;
+    public long Count { get; set; }
+    // The true count lies between Count - Error and Count
+    public long Error { get; set; }
+}
+
+public class TrafficWindow
+{
+    public string? Domain { get; set; }
+    public int WindowMinutes { get; set; }
+    public long UniqueVisitors { get; set; }
+    public List<TrafficTopEntry> TopClients { get; set; } = new();
+    public List<TrafficTopEntry> TopPaths { get; set; } = new();
+}
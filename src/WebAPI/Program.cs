@@ -48,6 +48,13 @@ builder.Services.AddScoped<IAlertService, AlertService>();
 builder.Services.AddScoped<ISslCertificateService, SslCertificateService>();
 builder.Services.AddScoped<IEmailService, EmailService>();
 builder.Services.AddScoped<IDnsService, DnsService>();
+builder.Services.AddSingleton<LogTailService>();
+builder.Services.AddSingleton<ILogTailService>(sp => sp.GetRequiredService<LogTailService>());
+builder.Services.AddSingleton<AccessLogAnalyticsService>();
+builder.Services.AddSingleton<IAccessLogAnalyticsService>(sp => sp.GetRequiredService<AccessLogAnalyticsService>());
+builder.Services.AddSingleton<BackendLatencyService>();
+builder.Services.AddSingleton<IBackendLatencyService>(sp => sp.GetRequiredService<BackendLatencyService>());
+builder.Services.AddSingleton<IMetricsHistoryService, MetricsHistoryService>();
 
 // Add HttpClient for notifications
 builder.Services.AddHttpClient();
@@ -59,6 +66,9 @@ builder.Services.AddSignalR();
 if (!builder.Environment.IsEnvironment("Testing"))
 {
     builder.Services.AddHostedService<ServerMonitoringService>();
+    builder.Services.AddHostedService(sp => sp.GetRequiredService<LogTailService>());
+    builder.Services.AddHostedService(sp => sp.GetRequiredService<AccessLogAnalyticsService>());
+    builder.Services.AddHostedService(sp => sp.GetRequiredService<BackendLatencyService>());
 }
 
 builder.Services.AddControllers()
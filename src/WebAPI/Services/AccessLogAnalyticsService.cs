@@ -0,0 +1,387 @@
+using System.Runtime.InteropServices;
+using SuperPanel.WebAPI.Models;
+
+namespace SuperPanel.WebAPI.Services;
+
+public interface IAccessLogAnalyticsService
+{
+    /// <summary>
+    /// Per-domain traffic totals from the configured access logs, busiest domain first.
+    /// </summary>
+    TrafficStats GetTrafficStats();
+
+    /// <summary>
+    /// Estimated unique visitors and the busiest clients and paths over the last
+    /// windowMinutes of log time (up to a day) for one domain, or all domains when null.
+    /// </summary>
+    TrafficWindow GetTrafficWindow(string? domain, int windowMinutes, int top);
+}
+
+/// <summary>
+/// Periodically folds new access-log lines into native per-domain counters. Each
+/// run only parses what was appended since the previous one; offsets and totals
+/// are persisted to AccessLogs:StatePath so restarts resume instead of re-reading.
+/// </summary>
+public sealed class AccessLogAnalyticsService : BackgroundService, IAccessLogAnalyticsService
+{
+    [StructLayout(LayoutKind.Sequential)]
+    private unsafe struct AccessLogDomainStats
+    {
+        public fixed byte Domain[128];
+        public long Requests;
+        public long Status1xx;
+        public long Status2xx;
+        public long Status3xx;
+        public long Status4xx;
+        public long Status5xx;
+        public long BytesSent;
+        public long FirstTimestamp;
+        public long LastTimestamp;
+        public long LatencySamples;
+        public double LatencyP50Ms;
+        public double LatencyP95Ms;
+        public double LatencyP99Ms;
+        public long RecentRequests;
+        public long RecentMinutes;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private unsafe struct NativeTrafficTopEntry
+    {
+        public fixed byte Key[128];
+        public long Count;
+        public long Error;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr CreateLogAnalytics([MarshalAs(UnmanagedType.LPUTF8Str)] string format);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void DestroyLogAnalytics(IntPtr analytics);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern long AnalyzeAccessLog(IntPtr analytics, [MarshalAs(UnmanagedType.LPUTF8Str)] string path, [MarshalAs(UnmanagedType.LPUTF8Str)] string defaultDomain, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe int GetAccessLogStats(IntPtr analytics, AccessLogDomainStats* stats, int maxCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern long GetMalformedLogLines(IntPtr analytics);
+
+    [DllImport(NativeLibraryLoader.LibraryName, EntryPoint = "GetTrafficWindow", CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe long GetNativeTrafficWindow(IntPtr analytics, [MarshalAs(UnmanagedType.LPUTF8Str)] string? domain, int windowMinutes,
+        NativeTrafficTopEntry* topClients, ref int clientCount, NativeTrafficTopEntry* topPaths, ref int pathCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int SaveLogAnalyticsState(IntPtr analytics, [MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int LoadLogAnalyticsState(IntPtr analytics, [MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+    private const int MaxWindowMinutes = 24 * 60;
+    private const int MaxTopEntries = 64;
+    private static readonly string[] DomainSuffixes = { ".access.log", "-access.log", "_access.log", ".log" };
+
+    private readonly ILogger<AccessLogAnalyticsService> _logger;
+    private readonly string _format;
+    private readonly string[] _files;
+    private readonly string? _statePath;
+    private readonly TimeSpan _interval;
+
+    private readonly object _lock = new();
+    // Held for each native parse, which runs outside _lock; Dispose takes it
+    // before destroying the native object
+    private readonly object _analyzeLock = new();
+    private IntPtr _analytics;
+    private bool _disposed;
+    private DateTime? _lastAnalyzed;
+
+    public AccessLogAnalyticsService(ILogger<AccessLogAnalyticsService> logger, IConfiguration configuration)
+    {
+        _logger = logger;
+        _format = configuration["AccessLogs:Format"] ?? "combined";
+        _files = configuration.GetSection("AccessLogs:Files").Get<string[]>() ?? Array.Empty<string>();
+        _statePath = configuration["AccessLogs:StatePath"];
+        _interval = TimeSpan.FromSeconds(configuration.GetValue("AccessLogs:IntervalSeconds", 60));
+    }
+
+    public TrafficStats GetTrafficStats()
+    {
+        var result = new TrafficStats();
+        lock (_lock)
+        {
+            if (_analytics == IntPtr.Zero)
+            {
+                return result;
+            }
+
+            result.LastAnalyzed = _lastAnalyzed;
+            result.MalformedLines = GetMalformedLogLines(_analytics);
+            unsafe
+            {
+                int count = GetAccessLogStats(_analytics, null, 0);
+                if (count <= 0)
+                {
+                    return result;
+                }
+
+                var stats = new AccessLogDomainStats[count];
+                fixed (AccessLogDomainStats* ptr = stats)
+                {
+                    count = Math.Min(count, GetAccessLogStats(_analytics, ptr, stats.Length));
+                }
+
+                for (int i = 0; i < count; i++)
+                {
+                    result.Domains.Add(ToDomainTrafficStats(ref stats[i]));
+                }
+            }
+        }
+        return result;
+    }
+
+    public TrafficWindow GetTrafficWindow(string? domain, int windowMinutes, int top)
+    {
+        windowMinutes = Math.Clamp(windowMinutes, 1, MaxWindowMinutes);
+        top = Math.Clamp(top, 1, MaxTopEntries);
+        var result = new TrafficWindow { Domain = domain, WindowMinutes = windowMinutes };
+
+        lock (_lock)
+        {
+            if (_analytics == IntPtr.Zero)
+            {
+                return result;
+            }
+
+            unsafe
+            {
+                var clients = stackalloc NativeTrafficTopEntry[top];
+                var paths = stackalloc NativeTrafficTopEntry[top];
+                int clientCount = top;
+                int pathCount = top;
+                var visitors = GetNativeTrafficWindow(_analytics, domain?.ToLowerInvariant(), windowMinutes, clients, ref clientCount, paths, ref pathCount);
+                result.UniqueVisitors = Math.Max(0, visitors);
+                for (int i = 0; i < clientCount; i++)
+                {
+                    result.TopClients.Add(ToTopEntry(ref clients[i]));
+                }
+                for (int i = 0; i < pathCount; i++)
+                {
+                    result.TopPaths.Add(ToTopEntry(ref paths[i]));
+                }
+            }
+        }
+        return result;
+    }
+
+    protected override async Task ExecuteAsync(CancellationToken stoppingToken)
+    {
+        if (!NativeLibraryLoader.IsAvailable || _files.Length == 0)
+        {
+            return;
+        }
+
+        lock (_lock)
+        {
+            if (_disposed)
+            {
+                return;
+            }
+            _analytics = CreateLogAnalytics(_format);
+            if (_analytics == IntPtr.Zero)
+            {
+                _logger.LogError("Unsupported access log format: {Format}", _format);
+                return;
+            }
+            if (!string.IsNullOrEmpty(_statePath) && File.Exists(_statePath) && LoadLogAnalyticsState(_analytics, _statePath) == 0)
+            {
+                _logger.LogWarning("Could not load access log state from {StatePath}; starting over", _statePath);
+            }
+        }
+
+        _logger.LogInformation("Access Log Analytics Service started");
+
+        while (!stoppingToken.IsCancellationRequested)
+        {
+            try
+            {
+                // Parsing is CPU-bound native work; keep it off the request threads
+                await Task.Run(AnalyzeNewLines, stoppingToken);
+                await Task.Delay(_interval, stoppingToken);
+            }
+            catch (OperationCanceledException) when (stoppingToken.IsCancellationRequested)
+            {
+                break;
+            }
+            catch (Exception ex)
+            {
+                _logger.LogError(ex, "Error in access log analytics service");
+                await Task.Delay(TimeSpan.FromSeconds(30), stoppingToken);
+            }
+        }
+    }
+
+    public override void Dispose()
+    {
+        IntPtr analytics;
+        lock (_lock)
+        {
+            _disposed = true;
+            analytics = _analytics;
+            _analytics = IntPtr.Zero;
+        }
+
+        if (analytics != IntPtr.Zero)
+        {
+            // Waits for a parse still running on the pool to finish its file
+            lock (_analyzeLock)
+            {
+                DestroyLogAnalytics(analytics);
+            }
+        }
+        base.Dispose();
+    }
+
+    private void AnalyzeNewLines()
+    {
+        // Parse outside _lock: the native object serialises its own calls, and
+        // dashboard reads only wait for the native lock between files
+        lock (_analyzeLock)
+        {
+            long lines = 0;
+            foreach (var path in ExpandFiles())
+            {
+                var analytics = CurrentAnalytics();
+                if (analytics == IntPtr.Zero)
+                {
+                    return;
+                }
+
+                var parsed = AnalyzeAccessLog(analytics, path, DefaultDomainFor(path), 0);
+                if (parsed < 0)
+                {
+                    _logger.LogWarning("Could not read access log {Path}", path);
+                    continue;
+                }
+                lines += parsed;
+            }
+
+            lock (_lock)
+            {
+                _lastAnalyzed = DateTime.UtcNow;
+            }
+
+            var current = CurrentAnalytics();
+            if (lines > 0 && current != IntPtr.Zero && !string.IsNullOrEmpty(_statePath))
+            {
+                Directory.CreateDirectory(Path.GetDirectoryName(_statePath)!);
+                if (SaveLogAnalyticsState(current, _statePath) == 0)
+                {
+                    _logger.LogWarning("Could not save access log state to {StatePath}", _statePath);
+                }
+            }
+        }
+    }
+
+    // Zero once Dispose has started
+    private IntPtr CurrentAnalytics()
+    {
+        lock (_lock)
+        {
+            return _analytics;
+        }
+    }
+
+    // Entries may use a wildcard in the file name, e.g. /var/log/nginx/*.access.log
+    private IEnumerable<string> ExpandFiles()
+    {
+        foreach (var entry in _files)
+        {
+            var directory = Path.GetDirectoryName(entry);
+            var pattern = Path.GetFileName(entry);
+            if (string.IsNullOrEmpty(directory) || !Directory.Exists(directory))
+            {
+                continue;
+            }
+
+            if (pattern.Contains('*') || pattern.Contains('?'))
+            {
+                foreach (var file in Directory.EnumerateFiles(directory, pattern))
+                {
+                    yield return file;
+                }
+            }
+            else if (File.Exists(entry))
+            {
+                yield return entry;
+            }
+        }
+    }
+
+    // Per-vhost logs (example.com.access.log) are attributed to the vhost when
+    // the log format has no $host field
+    private static string DefaultDomainFor(string path)
+    {
+        var name = Path.GetFileName(path);
+        foreach (var suffix in DomainSuffixes)
+        {
+            if (name.EndsWith(suffix, StringComparison.OrdinalIgnoreCase))
+            {
+                return name[..^suffix.Length];
+            }
+        }
+        return name;
+    }
+
+    private static unsafe TrafficTopEntry ToTopEntry(ref NativeTrafficTopEntry native)
+    {
+        fixed (byte* key = native.Key)
+        {
+            return new TrafficTopEntry
+            {
+                Key = Marshal.PtrToStringUTF8((IntPtr)key) ?? string.Empty,
+                Count = native.Count,
+                Error = native.Error
+            };
+        }
+    }
+
+    private static unsafe DomainTrafficStats ToDomainTrafficStats(ref AccessLogDomainStats native)
+    {
+        string domain;
+        fixed (byte* name = native.Domain)
+        {
+            domain = Marshal.PtrToStringUTF8((IntPtr)name) ?? string.Empty;
+        }
+
+        var stats = new DomainTrafficStats
+        {
+            Domain = domain,
+            Requests = native.Requests,
+            Status1xx = native.Status1xx,
+            Status2xx = native.Status2xx,
+            Status3xx = native.Status3xx,
+            Status4xx = native.Status4xx,
+            Status5xx = native.Status5xx,
+            BytesSent = native.BytesSent,
+            LatencyP50Ms = native.LatencyP50Ms,
+            LatencyP95Ms = native.LatencyP95Ms,
+            LatencyP99Ms = native.LatencyP99Ms,
+            RecentRequests = native.RecentRequests
+        };
+
+        // Rate over the recent window only, so it reflects current traffic
+        if (native.RecentMinutes > 0)
+        {
+            stats.RequestsPerMinute = (double)native.RecentRequests / native.RecentMinutes;
+        }
+
+        if (native.FirstTimestamp >= 0 && native.LastTimestamp >= native.FirstTimestamp)
+        {
+            stats.FirstRequest = DateTimeOffset.FromUnixTimeSeconds(native.FirstTimestamp).UtcDateTime;
+            stats.LastRequest = DateTimeOffset.FromUnixTimeSeconds(native.LastTimestamp).UtcDateTime;
+        }
+
+        return stats;
+    }
+}
@@ -0,0 +1,204 @@
+using System.Runtime.InteropServices;
+using System.Text;
+using SuperPanel.WebAPI.Models;
+
+namespace SuperPanel.WebAPI.Services;
+
+public interface IBackendLatencyService
+{
+    /// <summary>
+    /// Connect and request latency percentiles of every configured backend, with the
+    /// last windowCount windows (the open one first) and the totals since startup.
+    /// </summary>
+    List<BackendLatency> GetBackendLatency(int windowCount);
+}
+
+/// <summary>
+/// Probes the database and cache endpoints in BackendLatency:Targets for as long as
+/// the panel runs. The native prober connects to each on its own thread at a fixed
+/// rate and keeps HDR-style histograms per window, so reading them is a copy.
+/// </summary>
+public sealed class BackendLatencyService : BackgroundService, IBackendLatencyService
+{
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeLatencySummary
+    {
+        public long Count;
+        public long MinUs;
+        public long MaxUs;
+        public long MeanUs;
+        public long P50Us;
+        public long P90Us;
+        public long P99Us;
+        public long P999Us;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeLatencyWindow
+    {
+        public long StartMs;
+        public long DurationMs;
+        public long Probes;
+        public long Failures;
+        public long Timeouts;
+        public long LastError;
+        public NativeLatencySummary Connect;
+        public NativeLatencySummary Exchange;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr CreateLatencyProber(int windowMs, int windowsKept);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void DestroyLatencyProber(IntPtr prober);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int AddLatencyTarget(IntPtr prober, [MarshalAs(UnmanagedType.LPUTF8Str)] string host, int port, int intervalMs, int timeoutMs,
+        byte[]? request, int requestLength, byte[]? expect, int expectLength);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetLatencyWindows(IntPtr prober, int targetId, [Out] NativeLatencyWindow[] windows, int maxCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetLatencyTotals(IntPtr prober, int targetId, out NativeLatencyWindow totals);
+
+    private readonly ILogger<BackendLatencyService> _logger;
+    private readonly BackendLatencyTarget[] _targets;
+    private readonly int _windowSeconds;
+    private readonly int _windowsKept;
+
+    private readonly object _lock = new();
+    private readonly List<(BackendLatencyTarget Target, int Id)> _probed = new();
+    private IntPtr _prober;
+
+    public BackendLatencyService(ILogger<BackendLatencyService> logger, IConfiguration configuration)
+    {
+        _logger = logger;
+        _targets = configuration.GetSection("BackendLatency:Targets").Get<BackendLatencyTarget[]>() ?? Array.Empty<BackendLatencyTarget>();
+        _windowSeconds = configuration.GetValue("BackendLatency:WindowSeconds", 60);
+        _windowsKept = configuration.GetValue("BackendLatency:WindowsKept", 60);
+    }
+
+    public List<BackendLatency> GetBackendLatency(int windowCount)
+    {
+        windowCount = Math.Clamp(windowCount, 1, Math.Max(1, _windowsKept + 1));
+        var result = new List<BackendLatency>();
+        lock (_lock)
+        {
+            var windows = new NativeLatencyWindow[windowCount];
+            foreach (var (target, id) in _probed)
+            {
+                var latency = new BackendLatency
+                {
+                    Name = target.Name,
+                    Host = target.Host,
+                    Port = target.Port,
+                    IntervalMs = target.IntervalMs
+                };
+                if (GetLatencyTotals(_prober, id, out var totals) != 0)
+                {
+                    latency.Totals = ToWindow(totals);
+                }
+                int count = GetLatencyWindows(_prober, id, windows, windows.Length);
+                for (int i = 0; i < count; i++)
+                {
+                    latency.Windows.Add(ToWindow(windows[i]));
+                }
+                result.Add(latency);
+            }
+        }
+        return result;
+    }
+
+    protected override async Task ExecuteAsync(CancellationToken stoppingToken)
+    {
+        if (!NativeLibraryLoader.IsAvailable || _targets.Length == 0)
+        {
+            return;
+        }
+
+        lock (_lock)
+        {
+            _prober = CreateLatencyProber(_windowSeconds * 1000, _windowsKept);
+            if (_prober == IntPtr.Zero)
+            {
+                _logger.LogError("Could not start the backend latency prober");
+                return;
+            }
+
+            foreach (var target in _targets)
+            {
+                var request = string.IsNullOrEmpty(target.Request) ? null : Encoding.UTF8.GetBytes(target.Request);
+                var expect = string.IsNullOrEmpty(target.Expect) ? null : Encoding.UTF8.GetBytes(target.Expect);
+                var id = AddLatencyTarget(_prober, target.Host, target.Port, target.IntervalMs, target.TimeoutMs,
+                    request, request?.Length ?? 0, expect, expect?.Length ?? 0);
+                if (id < 0)
+                {
+                    _logger.LogWarning("Could not probe backend {Name} at {Host}:{Port}", target.Name, target.Host, target.Port);
+                    continue;
+                }
+                _probed.Add((target, id));
+            }
+        }
+
+        _logger.LogInformation("Backend Latency Service started with {Count} targets", _probed.Count);
+
+        try
+        {
+            // The prober runs on its own thread; nothing to do until shutdown
+            await Task.Delay(Timeout.Infinite, stoppingToken);
+        }
+        catch (OperationCanceledException) when (stoppingToken.IsCancellationRequested)
+        {
+        }
+    }
+
+    public override void Dispose()
+    {
+        lock (_lock)
+        {
+            if (_prober != IntPtr.Zero)
+            {
+                DestroyLatencyProber(_prober);
+                _prober = IntPtr.Zero;
+                _probed.Clear();
+            }
+        }
+        base.Dispose();
+    }
+
+    private static BackendLatencyWindow ToWindow(in NativeLatencyWindow native)
+    {
+        return new BackendLatencyWindow
+        {
+            Start = DateTimeOffset.FromUnixTimeMilliseconds(native.StartMs).UtcDateTime,
+            DurationSeconds = native.DurationMs / 1000.0,
+            Probes = native.Probes,
+            Failures = native.Failures,
+            Timeouts = native.Timeouts,
+            LastError = (int)native.LastError,
+            Connect = ToPercentiles(native.Connect),
+            Exchange = ToPercentiles(native.Exchange)
+        };
+    }
+
+    private static LatencyPercentiles? ToPercentiles(in NativeLatencySummary native)
+    {
+        if (native.Count == 0)
+        {
+            return null;
+        }
+
+        return new LatencyPercentiles
+        {
+            Count = native.Count,
+            MinMs = native.MinUs / 1000.0,
+            MeanMs = native.MeanUs / 1000.0,
+            P50Ms = native.P50Us / 1000.0,
+            P90Ms = native.P90Us / 1000.0,
+            P99Ms = native.P99Us / 1000.0,
+            P999Ms = native.P999Us / 1000.0,
+            MaxMs = native.MaxUs / 1000.0
+        };
+    }
+}
@@ -1,10 +1,14 @@
+using System.Collections.Concurrent;
 using System.Diagnostics;
 using System.IO.Compression;
+using System.Runtime.InteropServices;
 using System.Security.Cryptography;
 using System.Text;
+using Microsoft.AspNetCore.SignalR;
 using Microsoft.EntityFrameworkCore;
 using Microsoft.Extensions.Hosting;
 using SuperPanel.WebAPI.Data;
+using SuperPanel.WebAPI.Hubs;
 using SuperPanel.WebAPI.Models;
 
 namespace SuperPanel.WebAPI.Services;
@@ -15,18 +19,206 @@ public class BackupService : IBackupService
     private readonly ILogger<BackupService> _logger;
     private readonly IConfiguration _configuration;
     private readonly IHostEnvironment _environment;
+    private readonly IHubContext<MonitoringHub>? _hubContext;
     private readonly string _backupPath;
 
+    // Streaming parallel-deflate archive writer from the native library
+    private const int BackupJobRunning = 0;
+    private const int BackupJobCompleted = 1;
+    private const int BackupJobCancelled = 3;
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct BackupArchiveProgress
+    {
+        public long FilesDone;
+        public long BytesRead;
+        public long BytesWritten;
+        public long ElapsedMs;
+        public long Errors;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr WriteBackupArchiveAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string archivePath,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] sources,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] prefixes,
+        int sourceCount, int compressionLevel, int threadCount, long memoryBudget);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupArchiveProgress(IntPtr handle, out BackupArchiveProgress progress);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupArchive(IntPtr handle);
+
+    // Lists the archive directory each streamed source was stored under
+    private const string SourceLayoutFile = ".superpanel-sources";
+
+    // Parallel archive extractor from the native library
+    [StructLayout(LayoutKind.Sequential)]
+    private struct BackupExtractProgress
+    {
+        public long FilesTotal;
+        public long FilesDone;
+        public long BytesTotal;
+        public long BytesWritten;
+        public long ElapsedMs;
+        public long Errors;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr ExtractBackupArchiveAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string archivePath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string targetDir, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupExtractProgress(IntPtr handle, out BackupExtractProgress progress);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupExtract(IntPtr handle);
+
+    // Parallel AEAD encryption stage from the native library
+    private static readonly byte[] EncryptedBackupMagic = "SPAE"u8.ToArray();
+    private const int BackupCipherAesGcm = 1;
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct BackupCryptoProgress
+    {
+        public long BytesTotal;
+        public long BytesDone;
+        public long ElapsedMs;
+        public long Cipher;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr EncryptBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string inputPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string outputPath, byte[] key, int keyLength, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr DecryptBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string inputPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string outputPath, byte[] key, int keyLength, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupCryptoProgress(IntPtr handle, out BackupCryptoProgress progress);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupCrypto(IntPtr handle);
+
+    // Integrity manifests and rate-limited verification from the native library
+    private const string SumsExtension = ".sums";
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct BackupVerifyProgress
+    {
+        public long BytesTotal;
+        public long BytesDone;
+        public long RegionsTotal;
+        public long RegionsDamaged;
+        public long ElapsedMs;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr HashBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string filePath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath, int includeSha256, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr VerifyBackupFileAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string filePath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath, int threadCount, long bytesPerSecond);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupVerifyProgress(IntPtr handle, out BackupVerifyProgress progress);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetBackupVerifyDamage(IntPtr handle, byte[] buffer, int bufferSize);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseBackupVerify(IntPtr handle);
+
+    // Adaptive I/O throttle shared by the native backup, restore and verify jobs
+    [StructLayout(LayoutKind.Sequential)]
+    private struct BackupThrottleState
+    {
+        public long MaxBytesPerSecond;
+        public long MinBytesPerSecond;
+        public long BytesPerSecond;
+        public long IoPressure;
+        public long DiskLatencyUs;
+        public long Backoffs;
+        public long BytesGranted;
+        public long ThrottledMs;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ConfigureBackupThrottle(long maxBytesPerSecond, long minBytesPerSecond, int pressurePercent, int latencyMs);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void GetBackupThrottleState(out BackupThrottleState state);
+
+    // Deduplicating chunk store from the native library
+    private const string ManifestExtension = ".manifest";
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct ChunkStoreProgress
+    {
+        public long FilesDone;
+        public long BytesTotal;
+        public long BytesRead;
+        public long BytesNew;
+        public long BytesStored;
+        public long ChunksTotal;
+        public long ChunksNew;
+        public long ElapsedMs;
+        public long Errors;
+        public long FilesUnchanged;
+        public long FilesChanged;
+        public long FilesDeleted;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr OpenChunkStore([MarshalAs(UnmanagedType.LPUTF8Str)] string rootDir);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CloseChunkStore(IntPtr store);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr IncrementalBackupToChunkStoreAsync(IntPtr store, [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string? parentManifestPath, [MarshalAs(UnmanagedType.LPUTF8Str)] string journalPath,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] sources,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] prefixes,
+        int sourceCount, int compressionLevel, int threadCount, long memoryBudget);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr RestoreFromChunkStoreAsync(IntPtr store, [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath,
+        [MarshalAs(UnmanagedType.LPUTF8Str)] string targetDir, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr VerifyChunkStoreBackupAsync(IntPtr store, [MarshalAs(UnmanagedType.LPUTF8Str)] string manifestPath, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetChunkStoreProgress(IntPtr job, out ChunkStoreProgress progress);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseChunkStoreJob(IntPtr job);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern long PruneChunkStore(IntPtr store,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] manifestPaths, int manifestCount);
+
+    // The store can only be open once at a time; BackupService is scoped, so
+    // concurrent backups share this lock
+    private static readonly SemaphoreSlim _chunkStoreLock = new(1, 1);
+    // Backups with a verification in progress
+    private static readonly ConcurrentDictionary<int, byte> _verifying = new();
+
     public BackupService(
         IDbContextFactory<ApplicationDbContext> dbContextFactory,
         ILogger<BackupService> logger,
         IConfiguration configuration,
-        IHostEnvironment environment)
+        IHostEnvironment environment,
+        IHubContext<MonitoringHub>? hubContext = null)
     {
         _dbContextFactory = dbContextFactory;
         _logger = logger;
         _configuration = configuration;
         _environment = environment;
+        _hubContext = hubContext;
         
         _backupPath = _environment.IsEnvironment("Testing") 
             ? Path.Combine("/tmp/", "SuperPanel", "backups")
@@ -104,21 +296,28 @@ public class BackupService : IBackupService
         if (backup == null)
             return false;
 
-        // Delete the physical file if it exists
-        if (File.Exists(backup.FilePath))
+        // Delete the physical file (and its integrity manifest) if it exists
+        foreach (var path in new[] { backup.FilePath, backup.FilePath + SumsExtension })
         {
+            if (!File.Exists(path))
+                continue;
             try
             {
-                File.Delete(backup.FilePath);
+                File.Delete(path);
             }
             catch (Exception ex)
             {
-                _logger.LogWarning($"Failed to delete backup file {backup.FilePath}: {ex.Message}");
+                _logger.LogWarning($"Failed to delete backup file {path}: {ex.Message}");
             }
         }
 
         context.Backups.Remove(backup);
         await context.SaveChangesAsync();
+
+        if (backup.FilePath.EndsWith(ManifestExtension, StringComparison.Ordinal) && NativeLibraryLoader.IsAvailable)
+        {
+            await PruneChunkStoreAsync(context);
+        }
         return true;
     }
 
@@ -174,6 +373,35 @@ public class BackupService : IBackupService
         }
     }
 
+    public async Task VerifyBackupAsync(int backupId)
+    {
+        var backup = await GetBackupAsync(backupId);
+        if (backup == null)
+            throw new ArgumentException("Backup not found");
+
+        if (backup.Status != BackupStatus.Completed)
+            throw new InvalidOperationException("Backup is not in completed state");
+
+        if (!NativeLibraryLoader.IsAvailable || !File.Exists(backup.FilePath + SumsExtension))
+            throw new InvalidOperationException("Backup has no integrity manifest");
+
+        if (!_verifying.TryAdd(backupId, 0))
+            throw new InvalidOperationException("Backup verification is already running");
+
+        // Verification is throttled and can take a while; results go to the backup logs
+        _ = Task.Run(async () =>
+        {
+            try
+            {
+                await ExecuteVerifyAsync(backup);
+            }
+            finally
+            {
+                _verifying.TryRemove(backupId, out _);
+            }
+        });
+    }
+
     private async Task ExecuteBackupAsync(int backupId)
     {
         // Use a fresh DbContext for background execution to avoid concurrent usage of a single DbContext
@@ -194,6 +422,7 @@ public class BackupService : IBackupService
             context.Dispose();
 
             await LogBackupAsync(backupId, "Info", "Starting backup process");
+            var throttleStart = StartThrottledJob();
 
             // Use system temp directory for both testing and production to ensure write permissions
             string tempBasePath = Path.GetTempPath();
@@ -204,6 +433,10 @@ public class BackupService : IBackupService
             Directory.CreateDirectory(tempPath);
             string finalPath = GenerateBackupFilePath(backup);
 
+            // With the native writer, source trees are read straight into the
+            // archive instead of being copied into tempPath first
+            var streamedSources = backup.IsCompressed && NativeLibraryLoader.IsAvailable ? new List<string>() : null;
+
             // Execute backup based on type
             switch (backup.Type)
             {
@@ -211,13 +444,13 @@ public class BackupService : IBackupService
                     await BackupDatabaseAsync(backup, tempPath);
                     break;
                 case BackupType.Files:
-                    await BackupFilesAsync(backup, tempPath);
+                    await BackupFilesAsync(backup, tempPath, streamedSources);
                     break;
                 case BackupType.FullServer:
                     await BackupFullServerAsync(backup, tempPath);
                     break;
                 case BackupType.Website:
-                    await BackupWebsiteAsync(backup, tempPath);
+                    await BackupWebsiteAsync(backup, tempPath, streamedSources);
                     break;
                 case BackupType.Email:
                     await BackupEmailAsync(backup, tempPath);
@@ -226,6 +459,9 @@ public class BackupService : IBackupService
                     throw new NotSupportedException($"Backup type {backup.Type} is not supported");
             }
 
+            long incompleteFiles = 0;
+            long? logicalSize = null;
+
             // Compress if requested
             if (backup.IsCompressed)
             {
@@ -236,9 +472,37 @@ public class BackupService : IBackupService
                 var tempDirInfo = new DirectoryInfo(tempPath);
                 tempDirInfo.Attributes &= ~FileAttributes.ReadOnly; // Remove read-only if set
 
-                ZipFile.CreateFromDirectory(tempPath, compressedPath);
+                if (streamedSources != null && UseChunkStore(backup))
+                {
+                    // Only the manifest is kept per backup; the data lives in the
+                    // shared chunk store. It goes straight to its final place and
+                    // is recorded before the store is unlocked, so a concurrent
+                    // prune never sees its chunks as unreferenced.
+                    finalPath = Path.ChangeExtension(finalPath, ManifestExtension);
+                    compressedPath = finalPath;
+                    Directory.CreateDirectory(Path.GetDirectoryName(finalPath)!);
+                    streamedSources.Insert(0, tempPath);
+                    (incompleteFiles, logicalSize) = await WriteChunkStoreBackupAsync(backup, streamedSources, SourcePrefixes(streamedSources), finalPath);
+                }
+                else if (streamedSources != null)
+                {
+                    streamedSources.Insert(0, tempPath);
+                    incompleteFiles = await WriteNativeArchiveAsync(backupId, streamedSources, SourcePrefixes(streamedSources), compressedPath);
+                }
+                else
+                {
+                    ZipFile.CreateFromDirectory(tempPath, compressedPath);
+                }
                 Directory.Delete(tempPath, true);
                 tempPath = compressedPath;
+
+                // Unreadable files and files that shrank mid-read are stored
+                // zero-filled, so such a backup is not a faithful copy
+                if (incompleteFiles > 0 && !_configuration.GetValue("BackupSettings:AllowIncompleteBackups", false))
+                {
+                    File.Delete(compressedPath);
+                    throw new IOException($"{incompleteFiles} files could not be read completely while archiving");
+                }
             }
 
             // Encrypt if requested
@@ -246,45 +510,56 @@ public class BackupService : IBackupService
             {
                 await LogBackupAsync(backupId, "Info", "Encrypting backup");
                 string encryptedPath = tempPath + ".enc";
-                await EncryptFileAsync(tempPath, encryptedPath);
+                await EncryptFileAsync(backupId, tempPath, encryptedPath);
                 File.Delete(tempPath);
                 tempPath = encryptedPath;
             }
 
-            // Move to final location
-            Directory.CreateDirectory(Path.GetDirectoryName(finalPath)!);
-            // Ensure final path doesn't exist (cleanup from previous test runs)
-            if (File.Exists(finalPath))
-            {
-                File.Delete(finalPath);
-            }
-            else if (Directory.Exists(finalPath))
+            // Move to final location (chunk store manifests are already there)
+            if (tempPath != finalPath)
             {
-                Directory.Delete(finalPath, true);
-            }
-            if (File.Exists(tempPath))
-            {
-                File.Move(tempPath, finalPath);
+                Directory.CreateDirectory(Path.GetDirectoryName(finalPath)!);
+                // Ensure final path doesn't exist (cleanup from previous test runs)
+                if (File.Exists(finalPath))
+                {
+                    File.Delete(finalPath);
+                }
+                else if (Directory.Exists(finalPath))
+                {
+                    Directory.Delete(finalPath, true);
+                }
+                if (File.Exists(tempPath))
+                {
+                    File.Move(tempPath, finalPath);
+                }
+                else if (Directory.Exists(tempPath))
+                {
+                    CopyDirectory(tempPath, finalPath);
+                    Directory.Delete(tempPath, true);
+                }
             }
-            else if (Directory.Exists(tempPath))
+            if (File.Exists(finalPath) && NativeLibraryLoader.IsAvailable)
             {
-                CopyDirectory(tempPath, finalPath);
-                Directory.Delete(tempPath, true);
+                await WriteIntegrityManifestAsync(backupId, finalPath);
             }
 
-            var fileInfo = new FileInfo(finalPath);
+            // A manifest is tiny; report the size of the data it describes
+            long size = logicalSize ?? new FileInfo(finalPath).Length;
             var finalContext = await _dbContextFactory.CreateDbContextAsync();
             var backupToUpdate = await finalContext.Backups.FindAsync(backupId);
             if (backupToUpdate != null)
             {
                 backupToUpdate.FilePath = finalPath;
-                backupToUpdate.FileSizeInBytes = fileInfo.Length;
+                backupToUpdate.FileSizeInBytes = size;
                 backupToUpdate.Status = BackupStatus.Completed;
                 backupToUpdate.CompletedAt = DateTime.UtcNow;
+                if (incompleteFiles > 0)
+                    backupToUpdate.ErrorMessage = $"Incomplete: {incompleteFiles} files could not be read completely";
                 await finalContext.SaveChangesAsync();
             }
             finalContext.Dispose();
-            await LogBackupAsync(backupId, "Info", $"Backup completed successfully. Size: {fileInfo.Length} bytes");
+            await LogThrottleStateAsync(backupId, throttleStart);
+            await LogBackupAsync(backupId, "Info", $"Backup completed successfully. Size: {size} bytes");
         }
         catch (Exception ex)
         {
@@ -305,6 +580,7 @@ public class BackupService : IBackupService
     private async Task<RestoreResult> ExecuteRestoreAsync(Backup backup, RestoreRequest request)
     {
         await LogBackupAsync(backup.Id, "Info", "Starting restore process");
+        var throttleStart = StartThrottledJob();
 
         string extractPath = Path.Combine(Path.GetTempPath(), Guid.NewGuid().ToString());
         long bytesRestored = 0;
@@ -337,21 +613,34 @@ public class BackupService : IBackupService
             {
                 await LogBackupAsync(backup.Id, "Info", "Decrypting backup");
                 string decryptedPath = Path.Combine(extractPath, "decrypted");
-                await DecryptFileAsync(backup.FilePath, decryptedPath);
+                await DecryptFileAsync(backup.Id, backup.FilePath, decryptedPath);
                 // Replace the encrypted file path with decrypted path for further processing
                 backup.FilePath = decryptedPath;
             }
 
             // Decompress if needed
-            if (backup.IsCompressed && File.Exists(backup.FilePath))
+            if (backup.FilePath.EndsWith(ManifestExtension, StringComparison.Ordinal) && File.Exists(backup.FilePath))
+            {
+                await LogBackupAsync(backup.Id, "Info", "Restoring from chunk store");
+                await RestoreChunkStoreBackupAsync(backup.Id, backup.FilePath, extractPath);
+            }
+            else if (backup.IsCompressed && File.Exists(backup.FilePath))
             {
                 await LogBackupAsync(backup.Id, "Info", "Decompressing backup");
-                ZipFile.ExtractToDirectory(backup.FilePath, extractPath);
+                if (NativeLibraryLoader.IsAvailable)
+                {
+                    await ExtractNativeArchiveAsync(backup.Id, backup.FilePath, extractPath);
+                }
+                else
+                {
+                    ZipFile.ExtractToDirectory(backup.FilePath, extractPath);
+                }
             }
             else if (Directory.Exists(backup.FilePath))
             {
                 CopyDirectory(backup.FilePath, extractPath);
             }
+            MergeSourceLayout(extractPath);
 
             // Execute restore based on type
             switch (backup.Type)
@@ -375,6 +664,7 @@ public class BackupService : IBackupService
                     throw new NotSupportedException($"Restore type {backup.Type} is not supported");
             }
 
+            await LogThrottleStateAsync(backup.Id, throttleStart);
             await LogBackupAsync(backup.Id, "Info", "Restore completed successfully");
             return new RestoreResult
             {
@@ -431,7 +721,7 @@ public class BackupService : IBackupService
         await File.WriteAllTextAsync(backupFile, sql.ToString());
     }
 
-    private async Task BackupFilesAsync(Backup backup, string outputPath)
+    private async Task BackupFilesAsync(Backup backup, string outputPath, List<string>? streamedSources)
     {
         if (string.IsNullOrEmpty(backup.BackupPath))
             throw new InvalidOperationException("Backup path is required for file backup");
@@ -440,7 +730,10 @@ public class BackupService : IBackupService
 
         if (Directory.Exists(backup.BackupPath))
         {
-            CopyDirectory(backup.BackupPath, outputPath);
+            if (streamedSources != null)
+                streamedSources.Add(backup.BackupPath);
+            else
+                CopyDirectory(backup.BackupPath, outputPath);
         }
         else
         {
@@ -480,7 +773,7 @@ public class BackupService : IBackupService
         }
     }
 
-    private async Task BackupWebsiteAsync(Backup backup, string outputPath)
+    private async Task BackupWebsiteAsync(Backup backup, string outputPath, List<string>? streamedSources)
     {
         if (!backup.DomainId.HasValue)
             throw new InvalidOperationException("Domain ID is required for website backup");
@@ -496,7 +789,10 @@ public class BackupService : IBackupService
         string websitePath = $"/var/www/{domain.Name}";
         if (Directory.Exists(websitePath))
         {
-            CopyDirectory(websitePath, outputPath);
+            if (streamedSources != null)
+                streamedSources.Add(websitePath);
+            else
+                CopyDirectory(websitePath, outputPath);
         }
     }
 
@@ -524,6 +820,153 @@ public class BackupService : IBackupService
         await File.WriteAllTextAsync(Path.Combine(outputPath, "email_backup.txt"), emailData.ToString());
     }
 
+    // Checksums the stored backup so it can be verified later without a
+    // restore. A backup without a manifest is still usable, so failures here
+    // are only logged.
+    private async Task WriteIntegrityManifestAsync(int backupId, string backupFile)
+    {
+        string sumsPath = backupFile + SumsExtension;
+        bool sha256 = _configuration.GetValue("BackupSettings:IntegritySha256", false);
+        var job = HashBackupFileAsync(backupFile, sumsPath, sha256 ? 1 : 0, _configuration.GetValue("BackupSettings:ThreadCount", 0));
+        try
+        {
+            var (progress, _) = await RunVerifyJobAsync(job, backupFile);
+            double seconds = Math.Max(progress.ElapsedMs, 1) / 1000.0;
+            await LogBackupAsync(backupId, "Info",
+                $"Checksummed {progress.RegionsTotal} regions ({progress.BytesTotal} bytes) at {progress.BytesTotal / (1024.0 * 1024.0) / seconds:F1} MB/s",
+                $"Manifest: {sumsPath}; SHA-256: {(sha256 ? "yes" : "no")}");
+        }
+        catch (Exception ex)
+        {
+            await LogBackupAsync(backupId, "Warning", $"Could not write integrity manifest: {ex.Message}");
+        }
+    }
+
+    // Applies the configured I/O limit (BackupSettings:IoBytesPerSecondMB, 0 for
+    // none) and returns the throttle state to measure the job's waits from
+    private BackupThrottleState? StartThrottledJob()
+    {
+        if (!NativeLibraryLoader.IsAvailable)
+            return null;
+
+        ConfigureBackupThrottle(
+            _configuration.GetValue("BackupSettings:IoBytesPerSecondMB", 0L) * 1024 * 1024,
+            _configuration.GetValue("BackupSettings:IoMinimumBytesPerSecondMB", 8L) * 1024 * 1024,
+            _configuration.GetValue("BackupSettings:IoPressurePercent", 20),
+            _configuration.GetValue("BackupSettings:DiskLatencyMs", 50));
+        GetBackupThrottleState(out var state);
+        return state;
+    }
+
+    private async Task LogThrottleStateAsync(int backupId, BackupThrottleState? start)
+    {
+        if (start == null)
+            return;
+
+        GetBackupThrottleState(out var state);
+        if (state.MaxBytesPerSecond <= 0)
+            return;
+
+        // The counters are shared with any concurrent jobs
+        long waitedMs = state.ThrottledMs - start.Value.ThrottledMs;
+        long backoffs = state.Backoffs - start.Value.Backoffs;
+        string pressure = state.IoPressure >= 0 ? $"{state.IoPressure / 100.0:F2}%" : "unavailable";
+        string latency = state.DiskLatencyUs >= 0 ? $"{state.DiskLatencyUs / 1000.0:F1} ms" : "unavailable";
+        await LogBackupAsync(backupId, backoffs > 0 ? "Warning" : "Info",
+            $"I/O throttle: waited {waitedMs} ms, backed off {backoffs} times, now {state.BytesPerSecond / (1024.0 * 1024.0):F1} of {state.MaxBytesPerSecond / (1024.0 * 1024.0):F0} MB/s",
+            $"I/O pressure: {pressure}; disk latency: {latency}");
+    }
+
+    private async Task ExecuteVerifyAsync(Backup backup)
+    {
+        long bytesPerSecond = _configuration.GetValue("BackupSettings:VerifyBytesPerSecondMB", 50L) * 1024 * 1024;
+        int threadCount = _configuration.GetValue("BackupSettings:ThreadCount", 0);
+        try
+        {
+            await LogBackupAsync(backup.Id, "Info", "Verifying backup integrity");
+            StartThrottledJob();
+            var job = VerifyBackupFileAsync(backup.FilePath, backup.FilePath + SumsExtension, threadCount, bytesPerSecond);
+            var (progress, damaged) = await RunVerifyJobAsync(job, backup.FilePath);
+            if (progress.RegionsDamaged > 0)
+            {
+                if (damaged.Count < progress.RegionsDamaged)
+                    damaged.Add($"... and {progress.RegionsDamaged - damaged.Count} more");
+                await LogBackupAsync(backup.Id, "Error",
+                    $"Backup verification failed: {progress.RegionsDamaged} of {progress.RegionsTotal} regions damaged",
+                    string.Join(Environment.NewLine, damaged));
+                return;
+            }
+
+            // The checksums of a deduplicated backup only cover its manifest;
+            // the data it describes is checked chunk by chunk in the store
+            if (backup.FilePath.EndsWith(ManifestExtension, StringComparison.Ordinal))
+            {
+                var chunks = default(ChunkStoreProgress);
+                try
+                {
+                    chunks = await RunChunkStoreJobAsync(store => VerifyChunkStoreBackupAsync(store, backup.FilePath, threadCount),
+                        current =>
+                        {
+                            chunks = current;
+                            return Task.CompletedTask;
+                        });
+                }
+                catch (IOException) when (chunks.Errors > 0)
+                {
+                    await LogBackupAsync(backup.Id, "Error",
+                        $"Backup verification failed: {chunks.Errors} chunks missing or corrupt in the chunk store");
+                    return;
+                }
+                await LogBackupAsync(backup.Id, "Info",
+                    $"Backup verified: manifest and {chunks.ChunksTotal} chunks ({chunks.BytesTotal} bytes) intact",
+                    $"Elapsed: {progress.ElapsedMs + chunks.ElapsedMs} ms");
+                return;
+            }
+
+            await LogBackupAsync(backup.Id, "Info",
+                $"Backup verified: {progress.RegionsTotal} regions ({progress.BytesTotal} bytes) intact",
+                $"Elapsed: {progress.ElapsedMs} ms");
+        }
+        catch (Exception ex)
+        {
+            await LogBackupAsync(backup.Id, "Error", $"Backup verification failed: {ex.Message}");
+        }
+    }
+
+    private async Task<(BackupVerifyProgress Progress, List<string> Damaged)> RunVerifyJobAsync(IntPtr job, string backupFile)
+    {
+        if (job == IntPtr.Zero)
+            throw new IOException($"Could not open backup file or its integrity manifest: {backupFile}");
+
+        try
+        {
+            BackupVerifyProgress progress;
+            int state;
+            while ((state = GetBackupVerifyProgress(job, out progress)) == BackupJobRunning)
+            {
+                await Task.Delay(500);
+            }
+
+            if (state != BackupJobCompleted)
+                throw new IOException(state == BackupJobCancelled ? "Backup verification was cancelled" : $"Could not read backup file: {backupFile}");
+
+            var damaged = new List<string>();
+            if (progress.RegionsDamaged > 0)
+            {
+                var buffer = new byte[64 * 1024];
+                int count = GetBackupVerifyDamage(job, buffer, buffer.Length);
+                int length = count > 0 ? Array.LastIndexOf(buffer, (byte)'\n') : -1;
+                if (length > 0)
+                    damaged.AddRange(Encoding.UTF8.GetString(buffer, 0, length).Split('\n'));
+            }
+            return (progress, damaged);
+        }
+        finally
+        {
+            ReleaseBackupVerify(job);
+        }
+    }
+
     private async Task<long> RestoreDatabaseAsync(Backup backup, string extractPath, RestoreRequest request)
     {
         // Database restore logic
@@ -602,6 +1045,363 @@ public class BackupService : IBackupService
         return Path.Combine(_backupPath, $"{backup.Type}_{backup.Id}_{timestamp}{extension}");
     }
 
+    // sources[0] is the staging directory, stored at the archive root. Every
+    // other source gets its own top-level directory, so the same relative path
+    // in two sources cannot produce duplicate entries; the layout file written
+    // to the staging directory lets restores merge them back to the root.
+    private static string[] SourcePrefixes(List<string> sources)
+    {
+        var prefixes = new string[sources.Count];
+        prefixes[0] = string.Empty;
+        var layout = new StringBuilder();
+        for (int i = 1; i < sources.Count; i++)
+        {
+            prefixes[i] = $"source{i}";
+            layout.Append(prefixes[i]).Append('\t').Append(sources[i]).Append('\n');
+        }
+        if (sources.Count > 1)
+            File.WriteAllText(Path.Combine(sources[0], SourceLayoutFile), layout.ToString());
+        return prefixes;
+    }
+
+    // Moves the per-source directories of an extracted backup back to its
+    // root, so restores see the source trees' contents as before. Archives
+    // without a layout file already have everything at the root.
+    private static void MergeSourceLayout(string extractPath)
+    {
+        string layoutPath = Path.Combine(extractPath, SourceLayoutFile);
+        if (!File.Exists(layoutPath))
+            return;
+
+        foreach (var line in File.ReadAllLines(layoutPath))
+        {
+            string prefix = line.Split('\t')[0];
+            string sourceDir = Path.Combine(extractPath, prefix);
+            if (prefix.Length == 0 || prefix.Contains('/') || prefix.Contains("..") || !Directory.Exists(sourceDir))
+                continue;
+            MoveDirectoryContents(sourceDir, extractPath);
+            Directory.Delete(sourceDir, true);
+        }
+        File.Delete(layoutPath);
+    }
+
+    // Later sources win where two contain the same path
+    private static void MoveDirectoryContents(string sourceDir, string destinationDir)
+    {
+        foreach (var file in Directory.GetFiles(sourceDir))
+        {
+            File.Move(file, Path.Combine(destinationDir, Path.GetFileName(file)), overwrite: true);
+        }
+        foreach (var subDir in Directory.GetDirectories(sourceDir))
+        {
+            string target = Path.Combine(destinationDir, Path.GetFileName(subDir));
+            if (Directory.Exists(target))
+                MoveDirectoryContents(subDir, target);
+            else
+                Directory.Move(subDir, target);
+        }
+    }
+
+    // Returns the number of files that could not be read completely
+    private async Task<long> WriteNativeArchiveAsync(int backupId, List<string> sources, string[] prefixes, string archivePath)
+    {
+        int compressionLevel = _configuration.GetValue("BackupSettings:CompressionLevel", 6);
+        int threadCount = _configuration.GetValue("BackupSettings:ThreadCount", 0);
+        long memoryBudget = _configuration.GetValue("BackupSettings:MemoryBudgetMB", 256L) * 1024 * 1024;
+
+        var job = WriteBackupArchiveAsync(archivePath, sources.ToArray(), prefixes, sources.Count, compressionLevel, threadCount, memoryBudget);
+        if (job == IntPtr.Zero)
+            throw new IOException($"Could not create backup archive: {archivePath}");
+
+        try
+        {
+            BackupArchiveProgress progress;
+            int state;
+            while ((state = GetBackupArchiveProgress(job, out progress)) == BackupJobRunning)
+            {
+                await Task.Delay(500);
+            }
+
+            if (state != BackupJobCompleted)
+                throw new IOException(state == BackupJobCancelled ? "Backup archive was cancelled" : $"Could not write backup archive: {archivePath}");
+
+            double seconds = Math.Max(progress.ElapsedMs, 1) / 1000.0;
+            double throughput = progress.BytesRead / (1024.0 * 1024.0) / seconds;
+            double ratio = progress.BytesWritten > 0 ? (double)progress.BytesRead / progress.BytesWritten : 0;
+            await LogBackupAsync(backupId, "Info",
+                $"Compressed {progress.FilesDone} files ({progress.BytesRead} bytes) at {throughput:F1} MB/s, ratio {ratio:F2}",
+                $"Archive size: {progress.BytesWritten} bytes; elapsed: {progress.ElapsedMs} ms");
+            if (progress.Errors > 0)
+            {
+                await LogBackupAsync(backupId, "Error", $"{progress.Errors} files could not be read completely while archiving");
+            }
+            return progress.Errors;
+        }
+        finally
+        {
+            ReleaseBackupArchive(job);
+        }
+    }
+
+    private async Task ExtractNativeArchiveAsync(int backupId, string archivePath, string extractPath)
+    {
+        int threadCount = _configuration.GetValue("BackupSettings:ThreadCount", 0);
+        var job = ExtractBackupArchiveAsync(archivePath, extractPath, threadCount);
+        if (job == IntPtr.Zero)
+            throw new IOException($"Could not open backup archive: {archivePath}");
+
+        try
+        {
+            BackupExtractProgress progress;
+            int state;
+            while ((state = GetBackupExtractProgress(job, out progress)) == BackupJobRunning)
+            {
+                await ReportRestoreProgressAsync(backupId, progress.FilesDone, progress.FilesTotal, progress.BytesWritten, progress.BytesTotal, progress.ElapsedMs);
+                await Task.Delay(500);
+            }
+            await ReportRestoreProgressAsync(backupId, progress.FilesDone, progress.FilesTotal, progress.BytesWritten, progress.BytesTotal, progress.ElapsedMs);
+
+            if (state != BackupJobCompleted)
+                throw new IOException(state == BackupJobCancelled
+                    ? "Archive extraction was cancelled"
+                    : $"Could not extract backup archive ({progress.Errors} entries failed CRC or could not be written)");
+
+            double seconds = Math.Max(progress.ElapsedMs, 1) / 1000.0;
+            double throughput = progress.BytesWritten / (1024.0 * 1024.0) / seconds;
+            await LogBackupAsync(backupId, "Info",
+                $"Extracted {progress.FilesDone} files ({progress.BytesWritten} bytes) at {throughput:F1} MB/s",
+                $"Elapsed: {progress.ElapsedMs} ms");
+            if (progress.Errors > 0)
+            {
+                await LogBackupAsync(backupId, "Warning", $"{progress.Errors} archive entries were skipped (unsafe or duplicate names)");
+            }
+        }
+        finally
+        {
+            ReleaseBackupExtract(job);
+        }
+    }
+
+    // Pushes restore progress to MonitoringHub subscribers of this backup
+    private async Task ReportRestoreProgressAsync(int backupId, long filesDone, long filesTotal, long bytesDone, long bytesTotal, long elapsedMs)
+    {
+        if (_hubContext == null)
+            return;
+
+        double? bytesPerSecond = elapsedMs > 0 ? bytesDone * 1000.0 / elapsedMs : null;
+        var progress = new RestoreProgress
+        {
+            BackupId = backupId,
+            FilesDone = filesDone,
+            FilesTotal = filesTotal,
+            BytesDone = bytesDone,
+            BytesTotal = bytesTotal,
+            ElapsedMs = elapsedMs,
+            BytesPerSecond = bytesPerSecond,
+            EtaSeconds = bytesPerSecond > 0 && bytesTotal >= bytesDone ? (bytesTotal - bytesDone) / bytesPerSecond : null
+        };
+        try
+        {
+            await MonitoringHub.BroadcastRestoreProgress(_hubContext, progress);
+        }
+        catch (Exception ex)
+        {
+            _logger.LogDebug(ex, "Failed to send restore progress for backup {BackupId}", backupId);
+        }
+    }
+
+    // Deduplication applies to compressed, unencrypted backups; chunks are
+    // shared between backups and stored unencrypted
+    private bool UseChunkStore(Backup backup) =>
+        !backup.IsEncrypted && _configuration.GetValue("BackupSettings:Deduplicate", false);
+
+    private string ChunkStorePath => _configuration["BackupSettings:ChunkStorePath"] ?? Path.Combine(_backupPath, "chunks");
+
+    // Each backup of the same source tree after the first is incremental:
+    // files unchanged since the previous backup (per the tree's journal) are
+    // taken from its manifest without being read
+    // Returns the number of files that could not be read completely and the
+    // total size of the files in the manifest
+    private async Task<(long Errors, long LogicalBytes)> WriteChunkStoreBackupAsync(Backup backup, List<string> sources, string[] prefixes, string manifestPath)
+    {
+        int backupId = backup.Id;
+        string treeKey = Convert.ToHexString(SHA256.HashData(Encoding.UTF8.GetBytes(backup.BackupPath ?? string.Empty)))[..16];
+        string journalPath = Path.Combine(ChunkStorePath, "journals", $"{backup.Type}_{backup.DomainId}_{backup.DatabaseId}_{treeKey}.journal");
+        Directory.CreateDirectory(Path.GetDirectoryName(journalPath)!);
+
+        string? parentManifest;
+        await using (var context = await _dbContextFactory.CreateDbContextAsync())
+        {
+            parentManifest = (await context.Backups
+                    .Where(b => b.Id != backupId && b.Type == backup.Type && b.DomainId == backup.DomainId && b.DatabaseId == backup.DatabaseId &&
+                                b.BackupPath == backup.BackupPath && b.Status == BackupStatus.Completed && b.FilePath.EndsWith(ManifestExtension))
+                    .OrderByDescending(b => b.CompletedAt)
+                    .Select(b => b.FilePath)
+                    .ToListAsync())
+                .FirstOrDefault(File.Exists);
+        }
+
+        int compressionLevel = _configuration.GetValue("BackupSettings:CompressionLevel", 6);
+        int threadCount = _configuration.GetValue("BackupSettings:ThreadCount", 0);
+        long memoryBudget = _configuration.GetValue("BackupSettings:MemoryBudgetMB", 256L) * 1024 * 1024;
+
+        var progress = await RunChunkStoreJobAsync(store =>
+                IncrementalBackupToChunkStoreAsync(store, manifestPath, parentManifest, journalPath, sources.ToArray(), prefixes, sources.Count,
+                    compressionLevel, threadCount, memoryBudget),
+            onCompleted: () => RecordBackupFilePathAsync(backupId, manifestPath));
+
+        double seconds = Math.Max(progress.ElapsedMs, 1) / 1000.0;
+        double throughput = progress.BytesRead / (1024.0 * 1024.0) / seconds;
+        double dedupRatio = progress.BytesStored > 0 ? (double)progress.BytesRead / progress.BytesStored : 0;
+        await LogBackupAsync(backupId, "Info",
+            $"Deduplicated {progress.FilesDone} files ({progress.BytesRead} bytes) at {throughput:F1} MB/s; {progress.BytesStored} bytes stored, ratio {dedupRatio:F2}",
+            $"Chunks: {progress.ChunksTotal} total, {progress.ChunksNew} new ({progress.BytesNew} bytes before compression); elapsed: {progress.ElapsedMs} ms");
+        if (parentManifest != null)
+        {
+            await LogBackupAsync(backupId, "Info",
+                $"Incremental: {progress.FilesUnchanged} files unchanged, {progress.FilesChanged} new or modified, {progress.FilesDeleted} deleted");
+        }
+        if (progress.Errors > 0)
+        {
+            await LogBackupAsync(backupId, "Error", $"{progress.Errors} files could not be read completely while archiving");
+        }
+        return (progress.Errors, progress.BytesTotal);
+    }
+
+    private async Task RecordBackupFilePathAsync(int backupId, string filePath)
+    {
+        await using var context = await _dbContextFactory.CreateDbContextAsync();
+        var backup = await context.Backups.FindAsync(backupId);
+        if (backup == null)
+            return;
+        backup.FilePath = filePath;
+        await context.SaveChangesAsync();
+    }
+
+    public async Task<string> ExportBackupArchiveAsync(Backup backup)
+    {
+        if (!backup.FilePath.EndsWith(ManifestExtension, StringComparison.Ordinal))
+            throw new InvalidOperationException("Only deduplicated backups need to be exported");
+        if (!NativeLibraryLoader.IsAvailable)
+            throw new InvalidOperationException("Deduplicated backups can only be downloaded when the native library is available");
+
+        int threadCount = _configuration.GetValue("BackupSettings:ThreadCount", 0);
+        string workPath = Path.Combine(Path.GetTempPath(), "SuperPanel", Guid.NewGuid().ToString());
+        string archivePath = workPath + ".zip";
+        try
+        {
+            await RunChunkStoreJobAsync(store => RestoreFromChunkStoreAsync(store, backup.FilePath, workPath, threadCount));
+            MergeSourceLayout(workPath);
+            await WriteNativeArchiveAsync(backup.Id, new List<string> { workPath }, new[] { string.Empty }, archivePath);
+            return archivePath;
+        }
+        catch
+        {
+            if (File.Exists(archivePath))
+                File.Delete(archivePath);
+            throw;
+        }
+        finally
+        {
+            if (Directory.Exists(workPath))
+                Directory.Delete(workPath, true);
+        }
+    }
+
+    private async Task RestoreChunkStoreBackupAsync(int backupId, string manifestPath, string extractPath)
+    {
+        int threadCount = _configuration.GetValue("BackupSettings:ThreadCount", 0);
+        var progress = await RunChunkStoreJobAsync(store => RestoreFromChunkStoreAsync(store, manifestPath, extractPath, threadCount),
+            p => ReportRestoreProgressAsync(backupId, p.FilesDone, 0, p.BytesRead, p.BytesTotal, p.ElapsedMs));
+        await LogBackupAsync(backupId, "Info", $"Restored {progress.FilesDone} files ({progress.BytesRead} bytes) from chunk store");
+    }
+
+    // onCompleted runs after a successful job while the store is still locked
+    private async Task<ChunkStoreProgress> RunChunkStoreJobAsync(Func<IntPtr, IntPtr> start, Func<ChunkStoreProgress, Task>? onProgress = null,
+        Func<Task>? onCompleted = null)
+    {
+        await _chunkStoreLock.WaitAsync();
+        var store = IntPtr.Zero;
+        var job = IntPtr.Zero;
+        try
+        {
+            store = OpenChunkStore(ChunkStorePath);
+            if (store == IntPtr.Zero)
+                throw new IOException($"Could not open chunk store: {ChunkStorePath}");
+
+            job = start(store);
+            if (job == IntPtr.Zero)
+                throw new IOException("Could not start chunk store job");
+
+            ChunkStoreProgress progress;
+            int state;
+            while ((state = GetChunkStoreProgress(job, out progress)) == BackupJobRunning)
+            {
+                if (onProgress != null)
+                    await onProgress(progress);
+                await Task.Delay(500);
+            }
+            if (onProgress != null)
+                await onProgress(progress);
+
+            if (state != BackupJobCompleted)
+                throw new IOException(state == BackupJobCancelled
+                    ? "Chunk store job was cancelled"
+                    : $"Chunk store job failed ({progress.Errors} errors)");
+            if (onCompleted != null)
+                await onCompleted();
+            return progress;
+        }
+        finally
+        {
+            if (job != IntPtr.Zero)
+                ReleaseChunkStoreJob(job);
+            if (store != IntPtr.Zero)
+                CloseChunkStore(store);
+            _chunkStoreLock.Release();
+        }
+    }
+
+    // Frees chunks that no remaining backup references. The manifest list is
+    // read under the store lock: backups record their manifest before
+    // releasing it, so every manifest written so far is in the list.
+    private async Task PruneChunkStoreAsync(ApplicationDbContext context)
+    {
+        await _chunkStoreLock.WaitAsync();
+        try
+        {
+            var manifests = (await context.Backups
+                    .Where(b => b.FilePath.EndsWith(ManifestExtension))
+                    .Select(b => b.FilePath)
+                    .ToListAsync())
+                .Where(File.Exists)
+                .ToArray();
+
+            var store = OpenChunkStore(ChunkStorePath);
+            if (store == IntPtr.Zero)
+            {
+                _logger.LogWarning("Could not open chunk store {Path} for pruning", ChunkStorePath);
+                return;
+            }
+            try
+            {
+                long freed = await Task.Run(() => PruneChunkStore(store, manifests, manifests.Length));
+                if (freed < 0)
+                    _logger.LogWarning("Chunk store prune skipped: a manifest could not be read");
+                else
+                    _logger.LogInformation("Chunk store prune freed {Bytes} bytes", freed);
+            }
+            finally
+            {
+                CloseChunkStore(store);
+            }
+        }
+        finally
+        {
+            _chunkStoreLock.Release();
+        }
+    }
+
     private void CopyDirectory(string sourceDir, string destinationDir)
     {
         Directory.CreateDirectory(destinationDir);
@@ -619,8 +1419,21 @@ public class BackupService : IBackupService
         }
     }
 
-    private async Task EncryptFileAsync(string inputFile, string outputFile)
+    // Backups are encrypted natively in the SPAE format (parallel AES-GCM or
+    // ChaCha20-Poly1305); without the native library they fall back to the
+    // managed AES-CBC format, which restores still read
+    private async Task EncryptFileAsync(int backupId, string inputFile, string outputFile)
     {
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            var progress = await RunCryptoJobAsync(EncryptBackupFileAsync(inputFile, outputFile, BackupEncryptionKey(), 32,
+                _configuration.GetValue("BackupSettings:ThreadCount", 0)), inputFile, null);
+            double seconds = Math.Max(progress.ElapsedMs, 1) / 1000.0;
+            await LogBackupAsync(backupId, "Info",
+                $"Encrypted {progress.BytesTotal} bytes with {(progress.Cipher == BackupCipherAesGcm ? "AES-256-GCM" : "ChaCha20-Poly1305")} at {progress.BytesTotal / (1024.0 * 1024.0) / seconds:F1} MB/s");
+            return;
+        }
+
         // Get encryption key from configuration or generate one
         string encryptionKey = _configuration["BackupSettings:EncryptionKey"] ?? "SuperPanelBackupKey2024!";
         
@@ -648,8 +1461,25 @@ public class BackupService : IBackupService
         }
     }
 
-    private async Task DecryptFileAsync(string inputFile, string outputFile)
+    private async Task DecryptFileAsync(int backupId, string inputFile, string outputFile)
     {
+        var magic = new byte[EncryptedBackupMagic.Length];
+        await using (var probe = File.OpenRead(inputFile))
+        {
+            await probe.ReadAtLeastAsync(magic, magic.Length, throwOnEndOfStream: false);
+        }
+        Directory.CreateDirectory(Path.GetDirectoryName(outputFile)!);
+        if (magic.AsSpan().SequenceEqual(EncryptedBackupMagic))
+        {
+            if (!NativeLibraryLoader.IsAvailable)
+                throw new InvalidOperationException("This backup was encrypted by the native library, which is not available");
+
+            await RunCryptoJobAsync(DecryptBackupFileAsync(inputFile, outputFile, BackupEncryptionKey(), 32,
+                    _configuration.GetValue("BackupSettings:ThreadCount", 0)), inputFile,
+                p => ReportRestoreProgressAsync(backupId, 0, 0, p.BytesDone, p.BytesTotal, p.ElapsedMs));
+            return;
+        }
+
         // Get encryption key from configuration
         string encryptionKey = _configuration["BackupSettings:EncryptionKey"] ?? "SuperPanelBackupKey2024!";
         
@@ -676,6 +1506,39 @@ public class BackupService : IBackupService
             }
         }
     }
+
+    // The native format derives a fresh key per file from this one, so any
+    // passphrase length works
+    private byte[] BackupEncryptionKey() =>
+        SHA256.HashData(Encoding.UTF8.GetBytes(_configuration["BackupSettings:EncryptionKey"] ?? "SuperPanelBackupKey2024!"));
+
+    private async Task<BackupCryptoProgress> RunCryptoJobAsync(IntPtr job, string inputFile, Func<BackupCryptoProgress, Task>? onProgress)
+    {
+        if (job == IntPtr.Zero)
+            throw new IOException($"Could not open backup file: {inputFile}");
+
+        try
+        {
+            BackupCryptoProgress progress;
+            int state;
+            while ((state = GetBackupCryptoProgress(job, out progress)) == BackupJobRunning)
+            {
+                if (onProgress != null)
+                    await onProgress(progress);
+                await Task.Delay(500);
+            }
+
+            if (state != BackupJobCompleted)
+                throw new CryptographicException(state == BackupJobCancelled
+                    ? "Backup encryption was cancelled"
+                    : "Backup could not be encrypted or decrypted (wrong key or corrupted file)");
+            return progress;
+        }
+        finally
+        {
+            ReleaseBackupCrypto(job);
+        }
+    }
 }
 
 public class BackupRequest
@@ -703,4 +1566,16 @@ public class RestoreResult
     public bool Success { get; set; }
     public string Message { get; set; } = string.Empty;
     public long BytesRestored { get; set; }
+}
+
+public class RestoreProgress
+{
+    public int BackupId { get; set; }
+    public long FilesDone { get; set; }
+    public long FilesTotal { get; set; } // 0 when not known up front
+    public long BytesDone { get; set; }
+    public long BytesTotal { get; set; }
+    public long ElapsedMs { get; set; }
+    public double? BytesPerSecond { get; set; }
+    public double? EtaSeconds { get; set; }
 }
\ No newline at end of file
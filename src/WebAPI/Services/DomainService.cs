@@ -1,3 +1,6 @@
+using System.Collections.Concurrent;
+using System.Diagnostics;
+using System.Runtime.InteropServices;
 using Microsoft.EntityFrameworkCore;
 using SuperPanel.WebAPI.Data;
 using SuperPanel.WebAPI.Models;
@@ -12,12 +15,63 @@ public interface IDomainService
     Task<Domain?> UpdateDomainAsync(int id, Domain domain);
     Task<bool> DeleteDomainAsync(int id);
     Task<List<Domain>> GetDomainsByServerIdAsync(int serverId);
+    Task<List<DomainHealthCheck>> CheckDomainHealthAsync(IReadOnlyList<Domain> domains, int timeoutMs = 10000);
+    DomainLatencyHistogram? GetDomainLatency(string domainName);
 }
 
 public class DomainService : IDomainService
 {
     private readonly ApplicationDbContext _context;
 
+    // Native HTTP(S) checks on one event loop, with kept-alive connections
+    // shared across checks of the same domain
+    private const int LatencyBucketCount = 16;
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeHttpCheckResult
+    {
+        public long Status;
+        public long HttpStatus;
+        public long DnsUs, ConnectUs, TlsUs, TtfbUs, TotalUs;
+        public long BodyBytes;
+        public long Reused;
+        public long Error;
+        public long CertificateError;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeHttpLatencyHistogram
+    {
+        public long Checks;
+        public long Failures;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = LatencyBucketCount)]
+        public long[] Buckets;
+        public long DnsUsSum, ConnectUsSum, TlsUsSum, TtfbUsSum, TotalUsSum;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int CheckHttp([MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] urls,
+        int[] timeoutsMs, int count, [Out] NativeHttpCheckResult[] results);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetHttpLatencyHistogram([MarshalAs(UnmanagedType.LPUTF8Str)] string host,
+        ref NativeHttpLatencyHistogram histogram, [Out] long[] boundsMs);
+
+    // Same buckets as the native histograms, for the managed fallback
+    private static readonly long[] LatencyBoundsMs = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000, 60000 };
+    private static readonly ConcurrentDictionary<string, NativeHttpLatencyHistogram> ManagedHistograms = new(StringComparer.OrdinalIgnoreCase);
+    private const int MaxManagedHistograms = 10000;
+
+    private static readonly HttpClient HealthCheckClient = new(new SocketsHttpHandler
+    {
+        PooledConnectionIdleTimeout = TimeSpan.FromSeconds(30),
+        AllowAutoRedirect = false,
+        UseCookies = false
+    })
+    {
+        Timeout = Timeout.InfiniteTimeSpan
+    };
+
     public DomainService(ApplicationDbContext context)
     {
         _context = context;
@@ -82,4 +136,170 @@ public class DomainService : IDomainService
             .Include(d => d.Subdomains)
             .ToListAsync();
     }
+
+    public async Task<List<DomainHealthCheck>> CheckDomainHealthAsync(IReadOnlyList<Domain> domains, int timeoutMs = 10000)
+    {
+        if (domains.Count == 0)
+            return new List<DomainHealthCheck>();
+
+        var urls = domains.Select(d => $"{(d.SslEnabled ? "https" : "http")}://{d.Name}/").ToArray();
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            // Blocks until the slowest check finishes, so keep it off the request thread
+            var results = await Task.Run(() =>
+            {
+                var native = new NativeHttpCheckResult[urls.Length];
+                int answered = CheckHttp(urls, Enumerable.Repeat(timeoutMs, urls.Length).ToArray(), urls.Length, native);
+                return answered < 0 ? null : native;
+            });
+            if (results != null)
+            {
+                return domains.Select((d, i) => new DomainHealthCheck
+                {
+                    DomainId = d.Id,
+                    Domain = d.Name,
+                    Url = urls[i],
+                    Status = (HttpCheckStatus)results[i].Status,
+                    HttpStatus = (int)results[i].HttpStatus,
+                    DnsMs = ToMilliseconds(results[i].DnsUs),
+                    ConnectMs = ToMilliseconds(results[i].ConnectUs),
+                    TlsMs = ToMilliseconds(results[i].TlsUs),
+                    TtfbMs = ToMilliseconds(results[i].TtfbUs),
+                    TotalMs = ToMilliseconds(results[i].TotalUs),
+                    BodyBytes = results[i].BodyBytes,
+                    ConnectionReused = results[i].Reused != 0,
+                    Error = (int)results[i].Error,
+                    CertificateError = (int)results[i].CertificateError
+                }).ToList();
+            }
+        }
+
+        var checks = await Task.WhenAll(domains.Select((d, i) => CheckDomainManagedAsync(d, urls[i], timeoutMs)));
+        foreach (var check in checks)
+            RecordManagedLatency(check);
+        return checks.ToList();
+    }
+
+    public DomainLatencyHistogram? GetDomainLatency(string domainName)
+    {
+        NativeHttpLatencyHistogram histogram;
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            histogram = new NativeHttpLatencyHistogram { Buckets = new long[LatencyBucketCount] };
+            if (GetHttpLatencyHistogram(domainName, ref histogram, new long[LatencyBucketCount - 1]) == 0)
+                return null;
+        }
+        else if (!ManagedHistograms.TryGetValue(domainName, out histogram))
+        {
+            return null;
+        }
+
+        long successes = histogram.Checks - histogram.Failures;
+        double? Average(long sumUs) => successes > 0 ? sumUs / 1000.0 / successes : null;
+        bool phasesMeasured = NativeLibraryLoader.IsAvailable; // The managed fallback only times TTFB and the total
+        long? Percentile(double fraction)
+        {
+            if (successes == 0)
+                return null;
+            long seen = 0;
+            for (int i = 0; i < LatencyBoundsMs.Length; i++)
+            {
+                seen += histogram.Buckets[i];
+                if (seen >= fraction * successes)
+                    return LatencyBoundsMs[i];
+            }
+            return null; // In the open-ended bucket
+        }
+
+        return new DomainLatencyHistogram
+        {
+            Domain = domainName,
+            Checks = histogram.Checks,
+            Failures = histogram.Failures,
+            Buckets = histogram.Buckets.Select((count, i) => new LatencyBucket
+            {
+                UpperBoundMs = i < LatencyBoundsMs.Length ? LatencyBoundsMs[i] : null,
+                Count = count
+            }).ToList(),
+            AverageDnsMs = phasesMeasured ? Average(histogram.DnsUsSum) : null,
+            AverageConnectMs = phasesMeasured ? Average(histogram.ConnectUsSum) : null,
+            AverageTlsMs = phasesMeasured ? Average(histogram.TlsUsSum) : null,
+            AverageTtfbMs = Average(histogram.TtfbUsSum),
+            AverageTotalMs = Average(histogram.TotalUsSum),
+            P50Ms = Percentile(0.50),
+            P95Ms = Percentile(0.95),
+            P99Ms = Percentile(0.99)
+        };
+    }
+
+    private static double? ToMilliseconds(long microseconds) => microseconds >= 0 ? microseconds / 1000.0 : null;
+
+    // HttpClient pools connections but does not expose the DNS, connect and
+    // TLS phases, so only time to first byte and the total are reported
+    private static async Task<DomainHealthCheck> CheckDomainManagedAsync(Domain domain, string url, int timeoutMs)
+    {
+        var check = new DomainHealthCheck { DomainId = domain.Id, Domain = domain.Name, Url = url };
+        using var timeout = new CancellationTokenSource(timeoutMs > 0 ? timeoutMs : 10000);
+        var stopwatch = Stopwatch.StartNew();
+        try
+        {
+            using var response = await HealthCheckClient.GetAsync(url, HttpCompletionOption.ResponseHeadersRead, timeout.Token);
+            check.TtfbMs = stopwatch.Elapsed.TotalMilliseconds;
+            check.HttpStatus = (int)response.StatusCode;
+            await using var body = await response.Content.ReadAsStreamAsync(timeout.Token);
+            var buffer = new byte[16384];
+            int read;
+            while (check.BodyBytes < 1024 * 1024 && (read = await body.ReadAsync(buffer, timeout.Token)) > 0)
+                check.BodyBytes += read;
+            check.TotalMs = stopwatch.Elapsed.TotalMilliseconds;
+            check.Status = HttpCheckStatus.Ok;
+        }
+        catch (OperationCanceledException)
+        {
+            check.Status = HttpCheckStatus.Timeout;
+        }
+        catch (HttpRequestException ex)
+        {
+            check.Status = ex.InnerException switch
+            {
+                System.Security.Authentication.AuthenticationException => HttpCheckStatus.TlsFailed,
+                System.Net.Sockets.SocketException socket when socket.SocketErrorCode is System.Net.Sockets.SocketError.HostNotFound
+                    or System.Net.Sockets.SocketError.TryAgain or System.Net.Sockets.SocketError.NoData => HttpCheckStatus.Unresolved,
+                System.Net.Sockets.SocketException => HttpCheckStatus.ConnectFailed,
+                _ => HttpCheckStatus.BadResponse
+            };
+            if (ex.InnerException is System.Net.Sockets.SocketException socketError)
+                check.Error = socketError.ErrorCode;
+        }
+        catch (Exception ex) when (ex is InvalidOperationException or UriFormatException)
+        {
+            check.Status = HttpCheckStatus.InvalidUrl;
+        }
+        return check;
+    }
+
+    private static void RecordManagedLatency(DomainHealthCheck check)
+    {
+        if (!ManagedHistograms.ContainsKey(check.Domain) && ManagedHistograms.Count >= MaxManagedHistograms)
+            return;
+        ManagedHistograms.AddOrUpdate(check.Domain,
+            _ => Add(new NativeHttpLatencyHistogram { Buckets = new long[LatencyBucketCount] }),
+            (_, existing) => Add(existing with { Buckets = (long[])existing.Buckets.Clone() }));
+
+        NativeHttpLatencyHistogram Add(NativeHttpLatencyHistogram histogram)
+        {
+            histogram.Checks++;
+            if (check.Status != HttpCheckStatus.Ok || check.TotalMs == null)
+            {
+                histogram.Failures++;
+                return histogram;
+            }
+            double totalMs = check.TotalMs.Value;
+            int bucket = Array.FindIndex(LatencyBoundsMs, bound => totalMs <= bound);
+            histogram.Buckets[bucket < 0 ? LatencyBucketCount - 1 : bucket]++;
+            histogram.TtfbUsSum += (long)((check.TtfbMs ?? 0) * 1000);
+            histogram.TotalUsSum += (long)(check.TotalMs.Value * 1000);
+            return histogram;
+        }
+    }
 }
\ No newline at end of file
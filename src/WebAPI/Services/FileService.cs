@@ -1,3 +1,7 @@
+using System.Buffers;
+using System.Collections.Concurrent;
+using System.Runtime.InteropServices;
+using System.Text;
 using SuperPanel.WebAPI.Models;
 
 namespace SuperPanel.WebAPI.Services;
@@ -6,6 +10,8 @@ public interface IFileService
 {
     Task<List<FileSystemItem>> GetDirectoryContentsAsync(string path);
     Task<string> ReadFileAsync(string filePath);
+    Task<Stream?> OpenReadStreamAsync(string filePath);
+    Task<FileLinesResult?> ReadFileLinesAsync(string filePath, long startLine, int lineCount);
     Task<bool> WriteFileAsync(string filePath, string content);
     Task<bool> DeleteFileAsync(string filePath);
     Task<bool> CreateDirectoryAsync(string path);
@@ -18,10 +24,71 @@ public interface IFileService
 public class FileService : IFileService
 {
     private readonly string _rootPath;
+    private readonly string _trashPath;
+    private static int _trashPurged;
+
+    // Parallel tree removal from the native library
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr RemoveTreeAsync([MarshalAs(UnmanagedType.LPUTF8Str)] string path, [MarshalAs(UnmanagedType.LPUTF8Str)] string? trashDir, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetRemoveTreeProgress(IntPtr handle, out long entriesRemoved, out long errorCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseRemoveTree(IntPtr handle);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int PurgeTrashDirectory([MarshalAs(UnmanagedType.LPUTF8Str)] string trashDir);
+
+    private const int RemoveTreeFailed = 2;
+
+    // Memory-mapped large-file viewer from the native library
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr OpenFileView([MarshalAs(UnmanagedType.LPUTF8Str)] string path);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CloseFileView(IntPtr handle);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern long GetFileViewLineCount(IntPtr handle, out int exact);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe int ReadFileViewLines(IntPtr handle, long firstLine, int maxLines, byte* buffer, int bufferSize, out int bytesWritten);
+
+    private const int MaxLinesPerRead = 10000;
+    private const int LineBufferSize = 1024 * 1024;
+    private const int MaxOpenFileViews = 32;
+    private static readonly TimeSpan FileViewIdleTimeout = TimeSpan.FromMinutes(5);
+    // Open views keep their line index, so paging through a file only scans new data
+    private static readonly ConcurrentDictionary<string, FileViewEntry> _fileViews = new();
+
+    private sealed class FileViewEntry
+    {
+        public IntPtr Handle;
+        public DateTime LastUsed = DateTime.UtcNow;
+        public bool Evicted;
+    }
 
     public FileService(IConfiguration configuration)
     {
         _rootPath = configuration["FileService:RootPath"] ?? "/var/www";
+        // Deleted trees are renamed here and removed in the background, so it
+        // must be on the same filesystem as the root path.
+        _trashPath = configuration["FileService:TrashPath"]
+            ?? Path.Combine(Path.GetDirectoryName(Path.GetFullPath(_rootPath)) ?? _rootPath, ".superpanel-trash");
+
+        // Finish deletions interrupted by a previous shutdown (once per process)
+        if (NativeLibraryLoader.IsAvailable && Interlocked.Exchange(ref _trashPurged, 1) == 0)
+        {
+            try
+            {
+                PurgeTrashDirectory(_trashPath);
+            }
+            catch
+            {
+                // Leftovers are retried on the next start
+            }
+        }
     }
 
     public async Task<List<FileSystemItem>> GetDirectoryContentsAsync(string path)
@@ -90,6 +157,157 @@ public class FileService : IFileService
         }
     }
 
+    public Task<Stream?> OpenReadStreamAsync(string filePath)
+    {
+        var fullPath = GetSafePath(filePath);
+        if (!File.Exists(fullPath))
+            return Task.FromResult<Stream?>(null);
+
+        try
+        {
+            // A truncation by another process fails this request with an
+            // IOException; the mapping is guarded against faulting the process
+            return Task.FromResult<Stream?>(MappedFileWindow.OpenReadStream(fullPath));
+        }
+        catch
+        {
+            return Task.FromResult<Stream?>(null);
+        }
+    }
+
+    public async Task<FileLinesResult?> ReadFileLinesAsync(string filePath, long startLine, int lineCount)
+    {
+        var fullPath = GetSafePath(filePath);
+        if (!File.Exists(fullPath))
+            return null;
+
+        startLine = Math.Max(0, startLine);
+        lineCount = Math.Clamp(lineCount, 1, MaxLinesPerRead);
+
+        return await Task.Run(() =>
+        {
+            try
+            {
+                if (NativeLibraryLoader.IsAvailable)
+                {
+                    var result = ReadFileLinesNative(fullPath, startLine, lineCount);
+                    if (result != null)
+                        return result;
+                }
+
+                // Managed fallback: streams the file, so cost grows with startLine
+                var lines = new List<string>();
+                long lineNumber = 0;
+                foreach (var line in File.ReadLines(fullPath))
+                {
+                    if (lineNumber >= startLine && lines.Count < lineCount)
+                        lines.Add(line);
+                    lineNumber++;
+                }
+                return new FileLinesResult { StartLine = startLine, Lines = lines, TotalLines = lineNumber, TotalLinesExact = true };
+            }
+            catch
+            {
+                return null;
+            }
+        });
+    }
+
+    private static FileLinesResult? ReadFileLinesNative(string fullPath, long startLine, int lineCount)
+    {
+        EvictFileViews();
+
+        while (true)
+        {
+            var entry = _fileViews.GetOrAdd(fullPath, _ => new FileViewEntry());
+            lock (entry)
+            {
+                // Evicted between lookup and lock; take the replacement entry
+                if (entry.Evicted)
+                    continue;
+                return ReadFileViewEntry(entry, fullPath, startLine, lineCount);
+            }
+        }
+    }
+
+    private static unsafe FileLinesResult? ReadFileViewEntry(FileViewEntry entry, string fullPath, long startLine, int lineCount)
+    {
+        if (entry.Handle == IntPtr.Zero)
+        {
+            entry.Handle = OpenFileView(fullPath);
+            if (entry.Handle == IntPtr.Zero)
+                return null;
+        }
+        entry.LastUsed = DateTime.UtcNow;
+
+        var buffer = ArrayPool<byte>.Shared.Rent(LineBufferSize);
+        try
+        {
+            int read;
+            int bytesWritten;
+            fixed (byte* data = buffer)
+            {
+                read = ReadFileViewLines(entry.Handle, startLine, lineCount, data, buffer.Length, out bytesWritten);
+            }
+            if (read < 0)
+                return null;
+
+            var lines = new List<string>(read);
+            var text = buffer.AsSpan(0, bytesWritten);
+            while (!text.IsEmpty)
+            {
+                var end = text.IndexOf((byte)'\n');
+                lines.Add(Encoding.UTF8.GetString(text[..end]).TrimEnd('\r'));
+                text = text[(end + 1)..];
+            }
+
+            var totalLines = GetFileViewLineCount(entry.Handle, out var exact);
+            return new FileLinesResult
+            {
+                StartLine = startLine,
+                Lines = lines,
+                TotalLines = totalLines,
+                TotalLinesExact = exact != 0
+            };
+        }
+        finally
+        {
+            ArrayPool<byte>.Shared.Return(buffer);
+        }
+    }
+
+    // Closes views idle past the timeout and, beyond MaxOpenFileViews, the least
+    // recently used ones, dropping them from the cache entirely.
+    private static void EvictFileViews()
+    {
+        var cutoff = DateTime.UtcNow - FileViewIdleTimeout;
+        var entries = _fileViews.ToArray();
+        var excess = entries.Length - MaxOpenFileViews;
+        if (excess > 0)
+            entries = entries.OrderBy(pair => pair.Value.LastUsed).ToArray();
+
+        foreach (var pair in entries)
+        {
+            var entry = pair.Value;
+            if (excess <= 0 && entry.LastUsed >= cutoff)
+                continue;
+
+            lock (entry)
+            {
+                if (entry.Evicted || (excess <= 0 && entry.LastUsed >= cutoff))
+                    continue;
+                entry.Evicted = true;
+                if (entry.Handle != IntPtr.Zero)
+                {
+                    CloseFileView(entry.Handle);
+                    entry.Handle = IntPtr.Zero;
+                }
+            }
+            _fileViews.TryRemove(pair);
+            excess--;
+        }
+    }
+
     public async Task<bool> WriteFileAsync(string filePath, string content)
     {
         var fullPath = GetSafePath(filePath);
@@ -143,6 +361,20 @@ public class FileService : IFileService
         {
             if (Directory.Exists(fullPath))
             {
+                if (NativeLibraryLoader.IsAvailable)
+                {
+                    // Returns once the tree has been moved to the trash; the
+                    // native job deletes it in the background. If it could not
+                    // be moved it has already been deleted in place.
+                    var job = RemoveTreeAsync(fullPath, _trashPath, 0);
+                    if (job != IntPtr.Zero)
+                    {
+                        var state = GetRemoveTreeProgress(job, out _, out _);
+                        ReleaseRemoveTree(job);
+                        return state != RemoveTreeFailed;
+                    }
+                }
+
                 Directory.Delete(fullPath, true);
                 return true;
             }
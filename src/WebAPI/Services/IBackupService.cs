@@ -11,4 +11,8 @@ public interface IBackupService
     Task<IEnumerable<Backup>> GetBackupsAsync(int? serverId = null, int? databaseId = null, int? domainId = null);
     Task<bool> DeleteBackupAsync(int id);
     Task<RestoreResult> RestoreBackupAsync(int backupId, RestoreRequest request);
+    Task VerifyBackupAsync(int backupId);
+    // Rebuilds a deduplicated backup as a temporary zip archive for download;
+    // the caller deletes the returned file
+    Task<string> ExportBackupArchiveAsync(Backup backup);
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+using SuperPanel.WebAPI.Models;
+
 namespace SuperPanel.WebAPI.Services;
 
 public interface ISslCertificateService
@@ -5,4 +7,6 @@ public interface ISslCertificateService
     Task<bool> RequestCertificateAsync(int certificateId);
     Task<bool> RenewCertificateAsync(int certificateId);
     Task<bool> ValidateCertificateAsync(int certificateId);
+    Task<List<CertificateScanResult>> ScanCertificateFilesAsync(IReadOnlyList<string>? directories = null);
+    Task<List<CertificateScanResult>> ScanDomainEndpointsAsync(IReadOnlyList<Domain> domains, string? address, int port = 443, int timeoutMs = 5000);
 }
\ No newline at end of file
@@ -0,0 +1,269 @@
+using System.Buffers;
+using System.Buffers.Binary;
+using System.Runtime.InteropServices;
+using System.Text;
+using Microsoft.AspNetCore.SignalR;
+using SuperPanel.WebAPI.Hubs;
+
+namespace SuperPanel.WebAPI.Services;
+
+public interface ILogTailService
+{
+    /// <summary>
+    /// Starts streaming new lines of a log file to a SignalR connection. Returns false
+    /// when the path is outside the configured log directories or tailing is unavailable.
+    /// </summary>
+    bool Subscribe(string connectionId, string path);
+    void Unsubscribe(string connectionId, string path);
+    void UnsubscribeAll(string connectionId);
+}
+
+/// <summary>
+/// Follows subscribed log files through the native inotify follower and pushes
+/// appended lines to the "log_{path}" SignalR group. The follower queues batches
+/// in a native ring buffer which this service drains on a short interval, so a
+/// slow hub never blocks the follower thread.
+/// </summary>
+public sealed class LogTailService : BackgroundService, ILogTailService
+{
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr CreateLogFollower(IntPtr callback, IntPtr context, int ringBufferBytes);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void DestroyLogFollower(IntPtr follower);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int AddFollowedFile(IntPtr follower, [MarshalAs(UnmanagedType.LPUTF8Str)] string path, int fromEnd);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int RemoveFollowedFile(IntPtr follower, int fileId);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern unsafe int ReadLogBatches(IntPtr follower, byte* buffer, int bufferSize, out long droppedBatches);
+
+    private const int RingBufferBytes = 4 * 1024 * 1024;
+    // Large enough for the biggest batch the follower emits (a 1 MiB partial line plus one read)
+    private const int ReadBufferBytes = 2 * 1024 * 1024;
+    private static readonly TimeSpan DrainInterval = TimeSpan.FromMilliseconds(250);
+
+    private readonly ILogger<LogTailService> _logger;
+    private readonly IHubContext<MonitoringHub> _hubContext;
+    private readonly string[] _allowedDirectories;
+
+    private readonly object _lock = new();
+    private readonly Dictionary<string, FollowedLog> _logsByPath = new();
+    private readonly Dictionary<int, FollowedLog> _logsById = new();
+    private readonly Dictionary<string, HashSet<string>> _pathsByConnection = new();
+    private IntPtr _follower;
+
+    private sealed class FollowedLog
+    {
+        public required string Path { get; init; }
+        public required int FileId { get; init; }
+        public HashSet<string> Connections { get; } = new();
+    }
+
+    public LogTailService(ILogger<LogTailService> logger, IHubContext<MonitoringHub> hubContext, IConfiguration configuration)
+    {
+        _logger = logger;
+        _hubContext = hubContext;
+        _allowedDirectories = (configuration.GetSection("LogTail:AllowedDirectories").Get<string[]>() ?? Array.Empty<string>())
+            .Select(d => Path.TrimEndingDirectorySeparator(Path.GetFullPath(d)) + Path.DirectorySeparatorChar)
+            .ToArray();
+    }
+
+    public static string GroupName(string path) => $"log_{path}";
+
+    public bool Subscribe(string connectionId, string path)
+    {
+        var fullPath = Path.GetFullPath(path);
+        if (!IsAllowed(fullPath) || !NativeLibraryLoader.IsAvailable)
+        {
+            return false;
+        }
+
+        lock (_lock)
+        {
+            if (_follower == IntPtr.Zero)
+            {
+                _follower = CreateLogFollower(IntPtr.Zero, IntPtr.Zero, RingBufferBytes);
+                if (_follower == IntPtr.Zero)
+                {
+                    return false;
+                }
+            }
+
+            if (!_logsByPath.TryGetValue(fullPath, out var log))
+            {
+                var fileId = AddFollowedFile(_follower, fullPath, 1);
+                if (fileId < 0)
+                {
+                    return false;
+                }
+                log = new FollowedLog { Path = fullPath, FileId = fileId };
+                _logsByPath[fullPath] = log;
+                _logsById[fileId] = log;
+            }
+
+            log.Connections.Add(connectionId);
+            if (!_pathsByConnection.TryGetValue(connectionId, out var paths))
+            {
+                paths = new HashSet<string>();
+                _pathsByConnection[connectionId] = paths;
+            }
+            paths.Add(fullPath);
+        }
+
+        return true;
+    }
+
+    public void Unsubscribe(string connectionId, string path)
+    {
+        var fullPath = Path.GetFullPath(path);
+        lock (_lock)
+        {
+            if (_pathsByConnection.TryGetValue(connectionId, out var paths))
+            {
+                paths.Remove(fullPath);
+                if (paths.Count == 0)
+                {
+                    _pathsByConnection.Remove(connectionId);
+                }
+            }
+            Release(connectionId, fullPath);
+        }
+    }
+
+    public void UnsubscribeAll(string connectionId)
+    {
+        lock (_lock)
+        {
+            if (!_pathsByConnection.Remove(connectionId, out var paths))
+            {
+                return;
+            }
+            foreach (var path in paths)
+            {
+                Release(connectionId, path);
+            }
+        }
+    }
+
+    protected override async Task ExecuteAsync(CancellationToken stoppingToken)
+    {
+        _logger.LogInformation("Log Tail Service started");
+
+        var buffer = ArrayPool<byte>.Shared.Rent(ReadBufferBytes);
+        try
+        {
+            while (!stoppingToken.IsCancellationRequested)
+            {
+                try
+                {
+                    await DrainAsync(buffer);
+                    await Task.Delay(DrainInterval, stoppingToken);
+                }
+                catch (OperationCanceledException) when (stoppingToken.IsCancellationRequested)
+                {
+                    break;
+                }
+                catch (Exception ex)
+                {
+                    _logger.LogError(ex, "Error in log tail service");
+                    await Task.Delay(TimeSpan.FromSeconds(5), stoppingToken);
+                }
+            }
+        }
+        finally
+        {
+            ArrayPool<byte>.Shared.Return(buffer);
+        }
+    }
+
+    public override void Dispose()
+    {
+        lock (_lock)
+        {
+            if (_follower != IntPtr.Zero)
+            {
+                DestroyLogFollower(_follower);
+                _follower = IntPtr.Zero;
+            }
+        }
+        base.Dispose();
+    }
+
+    private bool IsAllowed(string fullPath)
+    {
+        return _allowedDirectories.Any(d => fullPath.StartsWith(d, StringComparison.Ordinal));
+    }
+
+    // Caller holds _lock
+    private void Release(string connectionId, string path)
+    {
+        if (!_logsByPath.TryGetValue(path, out var log) || !log.Connections.Remove(connectionId) || log.Connections.Count > 0)
+        {
+            return;
+        }
+
+        RemoveFollowedFile(_follower, log.FileId);
+        _logsByPath.Remove(path);
+        _logsById.Remove(log.FileId);
+    }
+
+    private async Task DrainAsync(byte[] buffer)
+    {
+        while (true)
+        {
+            int length;
+            long dropped;
+            var batches = new List<(string Path, string[] Lines)>();
+
+            lock (_lock)
+            {
+                if (_follower == IntPtr.Zero)
+                {
+                    return;
+                }
+
+                unsafe
+                {
+                    fixed (byte* ptr = buffer)
+                    {
+                        length = ReadLogBatches(_follower, ptr, buffer.Length, out dropped);
+                    }
+                }
+
+                // Records are [int32 fileId][int32 length][bytes]
+                for (int pos = 0; pos + 8 <= length;)
+                {
+                    int fileId = BinaryPrimitives.ReadInt32LittleEndian(buffer.AsSpan(pos));
+                    int count = BinaryPrimitives.ReadInt32LittleEndian(buffer.AsSpan(pos + 4));
+                    // Batches for files removed since they were queued are skipped
+                    if (_logsById.TryGetValue(fileId, out var log))
+                    {
+                        var text = Encoding.UTF8.GetString(buffer, pos + 8, count);
+                        batches.Add((log.Path, text.Split('\n', StringSplitOptions.RemoveEmptyEntries)));
+                    }
+                    pos += 8 + count;
+                }
+            }
+
+            if (dropped > 0)
+            {
+                _logger.LogWarning("Log tail buffer overflowed; {Dropped} batches were dropped", dropped);
+            }
+
+            foreach (var (path, lines) in batches)
+            {
+                await _hubContext.Clients.Group(GroupName(path)).SendAsync("ReceiveLogLines", path, lines);
+            }
+
+            // A nearly full read means more is queued
+            if (length < buffer.Length / 2)
+            {
+                return;
+            }
+        }
+    }
+}
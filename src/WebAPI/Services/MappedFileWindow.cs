@@ -0,0 +1,153 @@
+using System.Buffers;
+using System.Runtime.InteropServices;
+
+namespace SuperPanel.WebAPI.Services;
+
+/// <summary>
+/// Read-only memory-mapped view of a file range, exposed as Span/Memory so large
+/// downloads and range requests are served straight from the page cache instead
+/// of being copied into managed buffers. If another process truncates the file,
+/// reads past its new end see zeros rather than faulting the process, and
+/// <see cref="Truncated"/> turns true.
+/// </summary>
+public sealed unsafe class MappedFileWindow : MemoryManager<byte>
+{
+    private IntPtr _handle;
+    private readonly byte* _data;
+    private readonly int _length;
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr MapFileRange([MarshalAs(UnmanagedType.LPUTF8Str)] string path, long offset, long length, out IntPtr data, out long dataLength);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void UnmapFileRange(IntPtr handle);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int MappedRangeTruncated(IntPtr handle);
+
+    private MappedFileWindow(IntPtr handle, IntPtr data, long length)
+    {
+        _handle = handle;
+        _data = (byte*)data;
+        _length = (int)length;
+    }
+
+    public int Length => _length;
+
+    /// <summary>
+    /// True once a read of the window found the file truncated under it; what
+    /// was read from the span since mapping it must then be discarded.
+    /// </summary>
+    public bool Truncated => _handle != IntPtr.Zero && MappedRangeTruncated(_handle) != 0;
+
+    /// <summary>
+    /// Maps up to <paramref name="length"/> bytes starting at <paramref name="offset"/>
+    /// (to end of file when length is 0). Span-based windows are limited to 2 GB;
+    /// use <see cref="OpenReadStream"/> for whole-file access.
+    /// </summary>
+    public static MappedFileWindow? TryOpen(string path, long offset, int length)
+    {
+        if (!NativeLibraryLoader.IsAvailable)
+            return null;
+
+        var handle = MapFileRange(path, offset, length, out var data, out var dataLength);
+        if (handle == IntPtr.Zero)
+            return null;
+
+        if (dataLength > int.MaxValue)
+        {
+            UnmapFileRange(handle);
+            return null;
+        }
+
+        return new MappedFileWindow(handle, data, dataLength);
+    }
+
+    /// <summary>
+    /// Opens a seekable read stream over the whole file. Uses a mapping when the
+    /// native library is available, otherwise a sequential-scan FileStream.
+    /// </summary>
+    public static Stream OpenReadStream(string path)
+    {
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            var handle = MapFileRange(path, 0, 0, out var data, out var dataLength);
+            if (handle != IntPtr.Zero)
+            {
+                if (dataLength > 0)
+                    return new MappedStream(handle, (byte*)data, dataLength);
+                UnmapFileRange(handle);
+            }
+        }
+
+        return new FileStream(path, FileMode.Open, FileAccess.Read, FileShare.ReadWrite, 64 * 1024,
+            FileOptions.Asynchronous | FileOptions.SequentialScan);
+    }
+
+    public override Span<byte> GetSpan()
+    {
+        ObjectDisposedException.ThrowIf(_handle == IntPtr.Zero, this);
+        return new Span<byte>(_data, _length);
+    }
+
+    public override MemoryHandle Pin(int elementIndex = 0)
+    {
+        ObjectDisposedException.ThrowIf(_handle == IntPtr.Zero, this);
+        return new MemoryHandle(_data + elementIndex);
+    }
+
+    public override void Unpin()
+    {
+        // Mapped memory never moves
+    }
+
+    protected override void Dispose(bool disposing)
+    {
+        if (_handle != IntPtr.Zero)
+        {
+            UnmapFileRange(_handle);
+            _handle = IntPtr.Zero;
+        }
+    }
+
+    private sealed class MappedStream : UnmanagedMemoryStream
+    {
+        private IntPtr _handle;
+
+        public MappedStream(IntPtr handle, byte* data, long length)
+            : base(data, length, length, FileAccess.Read)
+        {
+            _handle = handle;
+        }
+
+        public override int Read(byte[] buffer, int offset, int count) => Checked(base.Read(buffer, offset, count));
+
+        public override int Read(Span<byte> buffer) => Checked(base.Read(buffer));
+
+        public override int ReadByte() => Checked(base.ReadByte());
+
+        public override Task<int> ReadAsync(byte[] buffer, int offset, int count, CancellationToken cancellationToken) =>
+            Task.FromResult(Read(buffer, offset, count));
+
+        public override ValueTask<int> ReadAsync(Memory<byte> buffer, CancellationToken cancellationToken = default) =>
+            new(Read(buffer.Span));
+
+        // Zeros read after a truncation must not reach the client as file content
+        private int Checked(int read)
+        {
+            if (_handle != IntPtr.Zero && MappedRangeTruncated(_handle) != 0)
+                throw new IOException("The file was truncated while it was being read");
+            return read;
+        }
+
+        protected override void Dispose(bool disposing)
+        {
+            base.Dispose(disposing);
+            if (_handle != IntPtr.Zero)
+            {
+                UnmapFileRange(_handle);
+                _handle = IntPtr.Zero;
+            }
+        }
+    }
+}
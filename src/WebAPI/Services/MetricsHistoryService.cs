@@ -0,0 +1,270 @@
+using System.Runtime.InteropServices;
+using SuperPanel.WebAPI.Hubs;
+using SuperPanel.WebAPI.Models;
+
+namespace SuperPanel.WebAPI.Services;
+
+public interface IMetricsHistoryService
+{
+    /// <summary>
+    /// Names accepted by GetHistory, one per ServerMetrics field.
+    /// </summary>
+    IReadOnlyCollection<string> MetricNames { get; }
+
+    /// <summary>
+    /// Appends one collection of a server's metrics to its history.
+    /// </summary>
+    void Record(int serverId, ServerMetrics metrics);
+
+    /// <summary>
+    /// A server's values of one metric from from to to, aggregated over steps of the
+    /// given length. Long ranges at coarse steps are read from the 1m, 5m or 1h
+    /// rollups rather than the raw samples.
+    /// </summary>
+    MetricHistory GetHistory(int serverId, string metric, DateTime from, DateTime to, TimeSpan step);
+}
+
+/// <summary>
+/// Keeps the metrics broadcast by ServerMonitoringService in the native time-series
+/// store at MetricsHistory:Path, one Gorilla-compressed series per server and metric.
+/// The store also maintains 1m, 5m and 1h rollups on ingest; raw samples are kept
+/// for MetricsHistory:RetentionDays and each rollup tier for its own retention.
+/// Without the native library the last day is kept in memory instead.
+/// </summary>
+public sealed class MetricsHistoryService : IMetricsHistoryService, IDisposable
+{
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeMetricRollup
+    {
+        public long StartMs;
+        public long Count;
+        public double Min;
+        public double Max;
+        public double Avg;
+        public double Last;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr OpenMetricStore([MarshalAs(UnmanagedType.LPUTF8Str)] string directory, long[] retentionMs);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void CloseMetricStore(IntPtr store);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetMetricSeriesId(IntPtr store, [MarshalAs(UnmanagedType.LPUTF8Str)] string name, int create);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int AppendMetricSamples(IntPtr store, int seriesId, long[] timestamps, double[] values, int count);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int QueryMetricRollups(IntPtr store, int seriesId, long fromMs, long toMs, long stepMs,
+        [Out] NativeMetricRollup[] rollups, int maxCount, out int tier);
+
+    private static readonly Dictionary<string, Func<ServerMetrics, double>> Metrics = new(StringComparer.OrdinalIgnoreCase)
+    {
+        ["cpu"] = m => m.CpuUsage,
+        ["memory"] = m => m.MemoryUsage,
+        ["disk"] = m => m.DiskUsage,
+        ["networkIn"] = m => m.NetworkIn,
+        ["networkOut"] = m => m.NetworkOut,
+        ["connections"] = m => m.ActiveConnections
+    };
+
+    // Indexed by the native METRIC_TIER_* constants
+    private static readonly string[] Resolutions = { "raw", "1m", "5m", "1h" };
+
+    private static readonly TimeSpan ManagedRetention = TimeSpan.FromDays(1);
+
+    private readonly ILogger<MetricsHistoryService> _logger;
+    private readonly string _path;
+    private readonly long[] _retentionMs;
+
+    private readonly object _lock = new();
+    private readonly Dictionary<string, int> _seriesIds = new();
+    private readonly Dictionary<string, List<MetricPoint>> _managed = new();
+    private IntPtr _store;
+    private bool _opened;
+
+    public MetricsHistoryService(ILogger<MetricsHistoryService> logger, IConfiguration configuration)
+    {
+        _logger = logger;
+        _path = configuration.GetValue("MetricsHistory:Path", "/var/lib/superpanel/metrics")!;
+        _retentionMs = new[]
+        {
+            RetentionMs(configuration.GetValue("MetricsHistory:RetentionDays", 7)),
+            RetentionMs(configuration.GetValue("MetricsHistory:MinuteRetentionDays", 30)),
+            RetentionMs(configuration.GetValue("MetricsHistory:FiveMinuteRetentionDays", 180)),
+            RetentionMs(configuration.GetValue("MetricsHistory:HourRetentionDays", 730))
+        };
+    }
+
+    public IReadOnlyCollection<string> MetricNames => Metrics.Keys;
+
+    public void Record(int serverId, ServerMetrics metrics)
+    {
+        var timestamp = new DateTimeOffset(DateTime.SpecifyKind(metrics.Timestamp, DateTimeKind.Utc)).ToUnixTimeMilliseconds();
+        lock (_lock)
+        {
+            var store = Store();
+            foreach (var (metric, read) in Metrics)
+            {
+                var name = SeriesName(serverId, metric);
+                var value = read(metrics);
+                if (store == IntPtr.Zero)
+                {
+                    RecordManaged(name, metrics.Timestamp, value);
+                    continue;
+                }
+
+                var id = SeriesId(store, name, true);
+                if (id >= 0)
+                {
+                    AppendMetricSamples(store, id, new[] { timestamp }, new[] { value }, 1);
+                }
+            }
+        }
+    }
+
+    public MetricHistory GetHistory(int serverId, string metric, DateTime from, DateTime to, TimeSpan step)
+    {
+        var key = Metrics.Keys.First(k => string.Equals(k, metric, StringComparison.OrdinalIgnoreCase));
+        var stepMs = Math.Max(1, (long)step.TotalMilliseconds);
+        var history = new MetricHistory { ServerId = serverId, Metric = key, From = from, To = to, StepSeconds = stepMs / 1000.0 };
+        var name = SeriesName(serverId, key);
+        lock (_lock)
+        {
+            var store = Store();
+            if (store == IntPtr.Zero)
+            {
+                if (_managed.TryGetValue(name, out var points))
+                {
+                    history.Points = AggregateManaged(points, ToUnixMs(from), ToUnixMs(to), stepMs);
+                }
+                return history;
+            }
+
+            var id = SeriesId(store, name, false);
+            if (id < 0)
+            {
+                return history;
+            }
+
+            // Steps between the one holding from and to, plus one for alignment
+            var fromMs = ToUnixMs(from);
+            var toMs = ToUnixMs(to);
+            var capacity = (int)Math.Min((toMs - fromMs) / stepMs + 2, 1_000_000);
+            var rollups = new NativeMetricRollup[capacity];
+            int count = QueryMetricRollups(store, id, fromMs, toMs, stepMs, rollups, rollups.Length, out var tier);
+            history.Resolution = Resolutions[Math.Clamp(tier, 0, Resolutions.Length - 1)];
+            for (int i = 0; i < count; i++)
+            {
+                history.Points.Add(new MetricPoint
+                {
+                    Timestamp = DateTimeOffset.FromUnixTimeMilliseconds(rollups[i].StartMs).UtcDateTime,
+                    Value = rollups[i].Avg,
+                    Min = rollups[i].Min,
+                    Max = rollups[i].Max,
+                    Last = rollups[i].Last,
+                    Count = rollups[i].Count
+                });
+            }
+        }
+        return history;
+    }
+
+    public void Dispose()
+    {
+        lock (_lock)
+        {
+            if (_store != IntPtr.Zero)
+            {
+                CloseMetricStore(_store);
+                _store = IntPtr.Zero;
+            }
+        }
+    }
+
+    private static string SeriesName(int serverId, string metric) => $"server/{serverId}/{metric}";
+
+    private static long ToUnixMs(DateTime time) =>
+        new DateTimeOffset(DateTime.SpecifyKind(time, DateTimeKind.Utc)).ToUnixTimeMilliseconds();
+
+    // 0 keeps a tier forever
+    private static long RetentionMs(int days) => (long)TimeSpan.FromDays(Math.Max(days, 0)).TotalMilliseconds;
+
+    // Opened on first use; IntPtr.Zero when history falls back to memory
+    private IntPtr Store()
+    {
+        if (!_opened)
+        {
+            _opened = true;
+            if (NativeLibraryLoader.IsAvailable)
+            {
+                _store = OpenMetricStore(_path, _retentionMs);
+                if (_store == IntPtr.Zero)
+                {
+                    _logger.LogWarning("Could not open the metrics history at {Path}; keeping the last day in memory", _path);
+                }
+            }
+        }
+        return _store;
+    }
+
+    private int SeriesId(IntPtr store, string name, bool create)
+    {
+        if (_seriesIds.TryGetValue(name, out var id))
+        {
+            return id;
+        }
+
+        id = GetMetricSeriesId(store, name, create ? 1 : 0);
+        if (id >= 0)
+        {
+            _seriesIds[name] = id;
+        }
+        return id;
+    }
+
+    private void RecordManaged(string name, DateTime timestamp, double value)
+    {
+        if (!_managed.TryGetValue(name, out var points))
+        {
+            points = new List<MetricPoint>();
+            _managed[name] = points;
+        }
+
+        if (points.Count > 0 && timestamp < points[^1].Timestamp)
+        {
+            return;
+        }
+        points.Add(new MetricPoint { Timestamp = timestamp, Value = value });
+
+        var cutoff = timestamp - ManagedRetention;
+        int expired = 0;
+        while (expired < points.Count && points[expired].Timestamp < cutoff)
+        {
+            expired++;
+        }
+        points.RemoveRange(0, expired);
+    }
+
+    // Steps aligned to multiples of stepMs, like the native rollup query
+    private static List<MetricPoint> AggregateManaged(List<MetricPoint> points, long fromMs, long toMs, long stepMs)
+    {
+        var alignedFrom = fromMs - ((fromMs % stepMs) + stepMs) % stepMs;
+        return points
+            .Select(p => (Ms: ToUnixMs(p.Timestamp), p.Value))
+            .Where(p => p.Ms >= alignedFrom && p.Ms < toMs && !double.IsNaN(p.Value))
+            .GroupBy(p => p.Ms - ((p.Ms % stepMs) + stepMs) % stepMs)
+            .Select(g => new MetricPoint
+            {
+                Timestamp = DateTimeOffset.FromUnixTimeMilliseconds(g.Key).UtcDateTime,
+                Value = g.Average(p => p.Value),
+                Min = g.Min(p => p.Value),
+                Max = g.Max(p => p.Value),
+                Last = g.Last().Value,
+                Count = g.Count()
+            })
+            .ToList();
+    }
+}
@@ -0,0 +1,16 @@
+using System.Runtime.InteropServices;
+
+namespace SuperPanel.WebAPI.Services;
+
+/// <summary>
+/// Locates SuperPanel.NativeLibrary (SuperPanel.NativeLibrary.dll on Windows,
+/// libSuperPanel.NativeLibrary.so on Linux). Services use the native exports when
+/// it is present and fall back to their managed implementations otherwise.
+/// </summary>
+internal static class NativeLibraryLoader
+{
+    public const string LibraryName = "SuperPanel.NativeLibrary";
+
+    public static bool IsAvailable { get; } =
+        NativeLibrary.TryLoad(LibraryName, typeof(NativeLibraryLoader).Assembly, null, out _);
+}
@@ -19,16 +19,19 @@ namespace SuperPanel.WebAPI.Services
         private readonly ILogger<ServerMonitoringService> _logger;
         private readonly IHubContext<MonitoringHub> _hubContext;
         private readonly IServiceProvider _serviceProvider;
+        private readonly IMetricsHistoryService _metricsHistory;
         private readonly TimeSpan _monitoringInterval = TimeSpan.FromSeconds(5);
 
         public ServerMonitoringService(
             ILogger<ServerMonitoringService> logger,
             IHubContext<MonitoringHub> hubContext,
-            IServiceProvider serviceProvider)
+            IServiceProvider serviceProvider,
+            IMetricsHistoryService metricsHistory)
         {
             _logger = logger;
             _hubContext = hubContext;
             _serviceProvider = serviceProvider;
+            _metricsHistory = metricsHistory;
         }
 
         protected override async Task ExecuteAsync(CancellationToken stoppingToken)
@@ -66,6 +69,7 @@ namespace SuperPanel.WebAPI.Services
             {
                 var metrics = GenerateMockMetrics(server.Id);
                 await MonitoringHub.BroadcastServerMetrics(_hubContext, server.Id, metrics);
+                _metricsHistory.Record(server.Id, metrics);
 
                 // Check for alerts
                 await CheckForAlerts(server.Id, server.Name, metrics);
@@ -1,5 +1,9 @@
 using System.Diagnostics;
 using System.Net.Http;
+using System.Net.Security;
+using System.Net.Sockets;
+using System.Runtime.InteropServices;
+using System.Security.Cryptography.X509Certificates;
 using System.Text;
 using System.Text.Json;
 using Microsoft.EntityFrameworkCore;
@@ -15,6 +19,53 @@ public class SslCertificateService : ISslCertificateService
     private readonly IConfiguration _configuration;
     private readonly HttpClient _httpClient;
 
+    private static readonly string[] DefaultScanDirectories = { "/etc/letsencrypt/live", "/etc/nginx/ssl", "/etc/apache2/ssl" };
+    private static readonly string[] CertificateExtensions = { ".pem", ".crt", ".cer", ".der", ".cert" };
+    private const int MaxManagedHandshakes = 64;
+
+    // Native certificate file and TLS endpoint scanner
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeCertificateInfo
+    {
+        public long Status;
+        public long Issues;
+        public long VerifyError;
+        public long NotBefore, NotAfter;
+        public long NameCount;
+        public long ChainLength;
+        public long KeyBits;
+        public long Ca;
+        public long ConnectUs, HandshakeUs;
+        public long Error;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 512)]
+        public byte[] Source;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 256)]
+        public byte[] Subject;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 256)]
+        public byte[] Issuer;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 1024)]
+        public byte[] Names;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 65)]
+        public byte[] Fingerprint;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)]
+        public byte[] Protocol;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern IntPtr ScanCertificateFiles([MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] directories,
+        int directoryCount, int threadCount);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetCertificateScanResults(IntPtr scan, int first, int maxCount, [Out] NativeCertificateInfo[]? results);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern void ReleaseCertificateScan(IntPtr scan);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int ScanTlsEndpoints([MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] serverNames,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string?[]? addresses,
+        int[]? ports, int[]? timeoutsMs, int count, [Out] NativeCertificateInfo[] results);
+
     public SslCertificateService(
         ApplicationDbContext context,
         ILogger<SslCertificateService> logger,
@@ -285,4 +336,318 @@ public class SslCertificateService : ISslCertificateService
             _logger.LogError(ex, "Failed to renew certificate {CertificateId}", certificateId);
         }
     }
+
+    public async Task<List<CertificateScanResult>> ScanCertificateFilesAsync(IReadOnlyList<string>? directories = null)
+    {
+        var roots = (directories ?? _configuration.GetSection("SslSettings:ScanDirectories").Get<string[]>() ?? DefaultScanDirectories)
+            .Where(Directory.Exists)
+            .ToArray();
+        if (roots.Length == 0)
+            return new List<CertificateScanResult>();
+
+        List<CertificateScanResult>? results = null;
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            results = await Task.Run(() =>
+            {
+                IntPtr scan = ScanCertificateFiles(roots, roots.Length, 0);
+                if (scan == IntPtr.Zero)
+                    return null;
+                try
+                {
+                    int total = GetCertificateScanResults(scan, 0, 0, null);
+                    var native = new NativeCertificateInfo[total];
+                    GetCertificateScanResults(scan, 0, total, native);
+                    return native.Select(ToScanResult).ToList();
+                }
+                finally
+                {
+                    ReleaseCertificateScan(scan);
+                }
+            });
+        }
+        results ??= await Task.Run(() => ScanCertificateFilesManaged(roots));
+
+        // Tie files back to the certificates tracked in the database
+        var tracked = await _context.SslCertificates.AsNoTracking().ToListAsync();
+        foreach (var result in results)
+        {
+            var certificate = tracked.FirstOrDefault(c => PathsEqual(c.CertificatePath, result.Source) || PathsEqual(c.ChainPath, result.Source));
+            if (certificate == null)
+                continue;
+            result.CertificateId = certificate.Id;
+            result.TrackedExpiresAt = certificate.ExpiresAt;
+        }
+        return results;
+    }
+
+    public async Task<List<CertificateScanResult>> ScanDomainEndpointsAsync(IReadOnlyList<Domain> domains, string? address, int port = 443, int timeoutMs = 5000)
+    {
+        if (domains.Count == 0)
+            return new List<CertificateScanResult>();
+
+        var names = domains.Select(d => d.Name).ToArray();
+        List<CertificateScanResult>? results = null;
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            // Blocks until the slowest handshake finishes, so keep it off the request thread
+            results = await Task.Run(() =>
+            {
+                var native = new NativeCertificateInfo[names.Length];
+                int completed = ScanTlsEndpoints(names, names.Select(_ => address).ToArray(), Enumerable.Repeat(port, names.Length).ToArray(),
+                    Enumerable.Repeat(timeoutMs, names.Length).ToArray(), names.Length, native);
+                return completed < 0 ? null : native.Select(ToScanResult).ToList();
+            });
+        }
+        if (results == null)
+        {
+            using var limiter = new SemaphoreSlim(MaxManagedHandshakes);
+            results = (await Task.WhenAll(names.Select(n => ScanEndpointManagedAsync(n, address, port, timeoutMs, limiter)))).ToList();
+        }
+
+        var domainIds = domains.Select(d => d.Id).ToList();
+        var tracked = await _context.SslCertificates.AsNoTracking()
+            .Where(c => c.Status == SslCertificateStatus.Active && c.DomainId.HasValue && domainIds.Contains(c.DomainId.Value))
+            .ToListAsync();
+        for (int i = 0; i < results.Count; i++)
+        {
+            var certificate = tracked.Where(c => c.DomainId == domains[i].Id).OrderByDescending(c => c.ExpiresAt).FirstOrDefault();
+            if (certificate == null)
+                continue;
+            results[i].CertificateId = certificate.Id;
+            results[i].TrackedExpiresAt = certificate.ExpiresAt;
+        }
+        return results;
+    }
+
+    private static CertificateScanResult ToScanResult(NativeCertificateInfo info)
+    {
+        static string Text(byte[] bytes) => Encoding.UTF8.GetString(bytes, 0, Math.Max(0, Array.IndexOf(bytes, (byte)0)));
+
+        var result = new CertificateScanResult
+        {
+            Source = Text(info.Source),
+            Status = (CertificateScanStatus)info.Status,
+            Error = (int)info.Error,
+            ConnectMs = info.ConnectUs >= 0 ? info.ConnectUs / 1000.0 : null,
+            HandshakeMs = info.HandshakeUs >= 0 ? info.HandshakeUs / 1000.0 : null
+        };
+        if (result.Status != CertificateScanStatus.Ok)
+            return result;
+
+        var names = Text(info.Names);
+        result.Subject = Text(info.Subject);
+        result.Issuer = Text(info.Issuer);
+        result.Names = names.Length > 0 ? names.Split(',').ToList() : new List<string>();
+        result.NameCount = (int)info.NameCount;
+        result.Fingerprint = Text(info.Fingerprint);
+        result.NotBefore = DateTimeOffset.FromUnixTimeSeconds(info.NotBefore).UtcDateTime;
+        result.NotAfter = DateTimeOffset.FromUnixTimeSeconds(info.NotAfter).UtcDateTime;
+        result.DaysRemaining = (int)Math.Floor((result.NotAfter.Value - DateTime.UtcNow).TotalDays);
+        result.ChainLength = (int)info.ChainLength;
+        result.KeyBits = (int)info.KeyBits;
+        result.IsCa = info.Ca != 0;
+        result.Issues = IssueNames((CertificateIssues)info.Issues);
+        result.VerifyError = (int)info.VerifyError;
+        var protocol = Text(info.Protocol);
+        result.Protocol = protocol.Length > 0 ? protocol : null;
+        return result;
+    }
+
+    private static List<string> IssueNames(CertificateIssues issues)
+    {
+        return Enum.GetValues<CertificateIssues>()
+            .Where(issue => issue != CertificateIssues.None && issues.HasFlag(issue))
+            .Select(issue => issue.ToString())
+            .ToList();
+    }
+
+    private static bool PathsEqual(string? tracked, string scanned)
+    {
+        if (string.IsNullOrEmpty(tracked))
+            return false;
+        var comparison = OperatingSystem.IsWindows() ? StringComparison.OrdinalIgnoreCase : StringComparison.Ordinal;
+        return string.Equals(Path.GetFullPath(tracked), Path.GetFullPath(scanned), comparison);
+    }
+
+    // .NET's X509Chain stands in for the native verification; chains are not
+    // completed from sibling files, and the handshake timings are not split
+    private static List<CertificateScanResult> ScanCertificateFilesManaged(string[] roots)
+    {
+        var files = roots.SelectMany(root => Directory.EnumerateFiles(root, "*", new EnumerationOptions
+            {
+                RecurseSubdirectories = true,
+                IgnoreInaccessible = true,
+                AttributesToSkip = 0 // Follow file links; directory links are skipped below
+            }))
+            .Where(f => CertificateExtensions.Contains(Path.GetExtension(f).ToLowerInvariant()))
+            .Where(f => !IsInsideLinkedDirectory(f, roots))
+            .OrderBy(f => f, StringComparer.Ordinal)
+            .ToList();
+
+        var results = new CertificateScanResult?[files.Count];
+        Parallel.For(0, files.Count, i => results[i] = ScanCertificateFileManaged(files[i]));
+        return results.OfType<CertificateScanResult>().ToList();
+    }
+
+    private static bool IsInsideLinkedDirectory(string file, string[] roots)
+    {
+        for (var directory = new DirectoryInfo(Path.GetDirectoryName(file)!); directory != null; directory = directory.Parent)
+        {
+            if (roots.Any(root => PathsEqual(root, directory.FullName)))
+                return false;
+            if (directory.LinkTarget != null)
+                return true;
+        }
+        return false;
+    }
+
+    private static CertificateScanResult? ScanCertificateFileManaged(string path)
+    {
+        var result = new CertificateScanResult { Source = path };
+        var chain = new X509Certificate2Collection();
+        try
+        {
+            var text = File.ReadAllText(path);
+            if (text.Contains("-----BEGIN "))
+            {
+                if (!text.Contains("-----BEGIN CERTIFICATE-----"))
+                    return null; // A key, not a certificate
+                chain.ImportFromPem(text);
+            }
+            else
+            {
+                chain.Add(new X509Certificate2(File.ReadAllBytes(path)));
+            }
+        }
+        catch (Exception ex) when (ex is IOException or UnauthorizedAccessException or System.Security.Cryptography.CryptographicException)
+        {
+            result.Status = CertificateScanStatus.Unreadable;
+            return result;
+        }
+        if (chain.Count == 0)
+        {
+            result.Status = CertificateScanStatus.Unreadable;
+            return result;
+        }
+
+        Describe(result, chain[0], chain.Skip(1).ToList());
+        return result;
+    }
+
+    private static async Task<CertificateScanResult> ScanEndpointManagedAsync(string name, string? address, int port, int timeoutMs, SemaphoreSlim limiter)
+    {
+        var result = new CertificateScanResult { Source = name };
+        await limiter.WaitAsync();
+        try
+        {
+            using var timeout = new CancellationTokenSource(timeoutMs > 0 ? timeoutMs : 5000);
+            using var client = new TcpClient();
+            var stopwatch = Stopwatch.StartNew();
+            await client.ConnectAsync(string.IsNullOrEmpty(address) ? name : address, port, timeout.Token);
+            result.ConnectMs = stopwatch.Elapsed.TotalMilliseconds;
+
+            X509Certificate2? leaf = null;
+            List<X509Certificate2> presented = new();
+            SslPolicyErrors errors = SslPolicyErrors.None;
+            using var stream = new SslStream(client.GetStream(), false, (_, certificate, chain, policyErrors) =>
+            {
+                leaf = certificate != null ? new X509Certificate2(certificate) : null;
+                presented = chain?.ChainElements.Skip(1).Select(e => new X509Certificate2(e.Certificate)).ToList() ?? new();
+                errors = policyErrors;
+                return true; // Report, don't refuse
+            });
+            stopwatch.Restart();
+            await stream.AuthenticateAsClientAsync(new SslClientAuthenticationOptions { TargetHost = name }, timeout.Token);
+            result.HandshakeMs = stopwatch.Elapsed.TotalMilliseconds;
+            result.Protocol = stream.SslProtocol.ToString();
+            if (leaf == null)
+            {
+                result.Status = CertificateScanStatus.TlsFailed;
+                return result;
+            }
+
+            Describe(result, leaf, presented);
+            if ((errors & SslPolicyErrors.RemoteCertificateNameMismatch) != 0)
+                result.Issues.Add(nameof(CertificateIssues.NameMismatch));
+        }
+        catch (OperationCanceledException)
+        {
+            result.Status = CertificateScanStatus.Timeout;
+        }
+        catch (SocketException ex)
+        {
+            result.Error = ex.ErrorCode;
+            result.Status = ex.SocketErrorCode is SocketError.HostNotFound or SocketError.TryAgain or SocketError.NoData
+                ? CertificateScanStatus.Unresolved
+                : CertificateScanStatus.ConnectFailed;
+        }
+        catch (Exception ex) when (ex is IOException or System.Security.Authentication.AuthenticationException)
+        {
+            result.Status = CertificateScanStatus.TlsFailed;
+        }
+        finally
+        {
+            limiter.Release();
+        }
+        return result;
+    }
+
+    private static void Describe(CertificateScanResult result, X509Certificate2 leaf, List<X509Certificate2> rest)
+    {
+        var issues = CertificateIssues.None;
+        var now = DateTime.UtcNow;
+        result.Subject = leaf.Subject;
+        result.Issuer = leaf.Issuer;
+        var alternativeNames = leaf.Extensions.OfType<X509SubjectAlternativeNameExtension>().FirstOrDefault();
+        if (alternativeNames != null)
+        {
+            result.Names = alternativeNames.EnumerateDnsNames()
+                .Concat(alternativeNames.EnumerateIPAddresses().Select(a => a.ToString()))
+                .ToList();
+        }
+        result.NameCount = result.Names.Count;
+        result.Fingerprint = leaf.GetCertHashString(System.Security.Cryptography.HashAlgorithmName.SHA256).ToLowerInvariant();
+        result.NotBefore = leaf.NotBefore.ToUniversalTime();
+        result.NotAfter = leaf.NotAfter.ToUniversalTime();
+        result.DaysRemaining = (int)Math.Floor((result.NotAfter.Value - now).TotalDays);
+        result.ChainLength = rest.Count + 1;
+        result.IsCa = leaf.Extensions.OfType<X509BasicConstraintsExtension>().Any(e => e.CertificateAuthority);
+        result.KeyBits = leaf.PublicKey.GetRSAPublicKey()?.KeySize ?? leaf.PublicKey.GetECDsaPublicKey()?.KeySize ?? 0;
+
+        if (result.NotAfter < now)
+            issues |= CertificateIssues.Expired;
+        if (result.NotBefore > now)
+            issues |= CertificateIssues.NotYetValid;
+        if (leaf.SubjectName.RawData.AsSpan().SequenceEqual(leaf.IssuerName.RawData))
+            issues |= CertificateIssues.SelfSigned;
+        if (leaf.PublicKey.GetRSAPublicKey() != null && result.KeyBits < 2048)
+            issues |= CertificateIssues.WeakKey;
+        if (rest.Any(c => c.NotAfter.ToUniversalTime() < now))
+            issues |= CertificateIssues.ChainExpired;
+        var all = rest.Prepend(leaf).ToList();
+        for (int i = 0; i + 1 < all.Count; i++)
+        {
+            if (!all[i].IssuerName.RawData.AsSpan().SequenceEqual(all[i + 1].SubjectName.RawData))
+                issues |= CertificateIssues.ChainOrder;
+        }
+        if (all.Where(c => !c.SubjectName.RawData.AsSpan().SequenceEqual(c.IssuerName.RawData))
+            .Any(c => c.SignatureAlgorithm.FriendlyName?.Contains("sha1", StringComparison.OrdinalIgnoreCase) == true
+                   || c.SignatureAlgorithm.FriendlyName?.Contains("md5", StringComparison.OrdinalIgnoreCase) == true))
+            issues |= CertificateIssues.WeakSignature;
+
+        using var chain = new X509Chain();
+        chain.ChainPolicy.RevocationMode = X509RevocationMode.NoCheck;
+        chain.ChainPolicy.VerificationFlags = X509VerificationFlags.IgnoreNotTimeValid;
+        chain.ChainPolicy.DisableCertificateDownloads = true; // Only what the file or server provides
+        chain.ChainPolicy.ExtraStore.AddRange(rest.ToArray());
+        if (!chain.Build(leaf))
+        {
+            issues |= CertificateIssues.Untrusted;
+            if (chain.ChainStatus.Any(s => s.Status == X509ChainStatusFlags.PartialChain))
+                issues |= CertificateIssues.IncompleteChain;
+        }
+
+        result.Issues = IssueNames(issues);
+    }
 }
\ No newline at end of file
@@ -11,6 +11,12 @@ public interface ISystemMonitoringService
     Task<long> GetAvailableMemoryAsync();
     Task<long> GetTotalMemoryAsync();
     Task<List<Models.DriveInfo>> GetDriveInfoAsync();
+    Task<List<NetworkInterfaceStats>> GetNetworkInterfacesAsync();
+    Task<TcpConnectionCensus> GetTcpCensusAsync(int top = 10);
+    Task<NetworkStackStats> GetNetworkStackStatsAsync();
+    Task<List<ListeningSocketInfo>> GetListeningSocketsAsync();
+    Task<List<PortCheckResult>> CheckPortsAsync(IReadOnlyList<PortCheckTarget> targets);
+    Task<List<ReachabilityResult>> CheckReachabilityAsync(ReachabilityCheckRequest request);
 }
 
 public class SystemMonitoringService : ISystemMonitoringService
@@ -28,8 +34,166 @@ public class SystemMonitoringService : ISystemMonitoringService
     [DllImport("SuperPanel.NativeLibrary.dll", CallingConvention = CallingConvention.Cdecl)]
     private static extern long GetTotalMemory();
 
+    // Batch TCP port checks on one native event loop
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativePortCheckResult
+    {
+        public long Status;
+        public long RttUs;
+        public long Error;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int CheckPorts([MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] hosts,
+        int[] ports, int[] timeoutsMs, int count, [Out] NativePortCheckResult[] results);
+
+    // Batch ICMP echo and UDP request/response checks on the same event loop
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeReachabilityResult
+    {
+        public long Status;
+        public long Sent;
+        public long Received;
+        public long MinUs, AvgUs, MaxUs, MdevUs;
+        public long Error;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int CheckPings([MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] hosts,
+        int count, int packetCount, int intervalMs, int timeoutMs, [Out] NativeReachabilityResult[] results);
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int CheckUdpPorts([MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string[] hosts, int[] ports,
+        [MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))] string?[] payloads, int[] payloadLengths,
+        int count, int packetCount, int intervalMs, int timeoutMs, [Out] NativeReachabilityResult[] results);
+
+    // Per-interface counters and rates
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeInterfaceStats
+    {
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 64)]
+        public byte[] Name;
+        public long Kind;
+        public long Up;
+        public long RxBytes, RxPackets, RxErrors, RxDropped;
+        public long TxBytes, TxPackets, TxErrors, TxDropped;
+        public double RxBytesPerSecond, RxPacketsPerSecond, RxErrorsPerSecond, RxDroppedPerSecond;
+        public double TxBytesPerSecond, TxPacketsPerSecond, TxErrorsPerSecond, TxDroppedPerSecond;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetInterfaceStats([Out] NativeInterfaceStats[] stats, int maxCount);
+
+    // Kernel TCP/IP counters (/proc/net/snmp, netstat, sockstat)
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeNetStackStats
+    {
+        public long TcpActiveOpens, TcpPassiveOpens, TcpAttemptFails, TcpEstabResets;
+        public long TcpInSegs, TcpOutSegs, TcpRetransSegs, TcpInErrs, TcpOutRsts;
+        public long ListenOverflows, ListenDrops, TcpTimeouts, TcpSynRetrans;
+        public long TcpAbortOnTimeout, TcpAbortOnMemory, TcpBacklogDrop, SyncookiesSent, TcpReqQFullDrop;
+        public long UdpInDatagrams, UdpOutDatagrams, UdpNoPorts, UdpInErrors, UdpRcvbufErrors, UdpSndbufErrors;
+        public long TcpCurrEstab, TcpInUse, TcpOrphans, TcpTimeWait, TcpMemoryPages, UdpInUse, SocketsUsed;
+        public double TcpInSegsPerSecond, TcpOutSegsPerSecond, TcpRetransSegsPerSecond;
+        public double TcpAttemptFailsPerSecond, TcpEstabResetsPerSecond, TcpInErrsPerSecond, TcpOutRstsPerSecond;
+        public double ListenOverflowsPerSecond, ListenDropsPerSecond, TcpTimeoutsPerSecond, TcpSynRetransPerSecond;
+        public double UdpInErrorsPerSecond, UdpRcvbufErrorsPerSecond;
+        public double RetransmitPercent;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetNetStackStats(out NativeNetStackStats stats);
+
+    // TCP socket census by state, local port and remote address
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeTcpCensus
+    {
+        public long Total;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 12)]
+        public long[] States;
+        public long Ipv4;
+        public long Ipv6;
+        public long Source;
+        public long ElapsedUs;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeTcpPortCount
+    {
+        public long Port;
+        public long Count;
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeTcpRemoteCount
+    {
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 48)]
+        public byte[] Address;
+        public long Count;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetTcpCensus(out NativeTcpCensus census, [Out] NativeTcpPortCount[] ports, int maxPorts, out int portCount,
+        [Out] NativeTcpRemoteCount[] remotes, int maxRemotes, out int remoteCount);
+
+    // Listening sockets and the processes that own them
+    [StructLayout(LayoutKind.Sequential)]
+    private struct NativeListeningSocket
+    {
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 48)]
+        public byte[] Address;
+        public long Port;
+        public long Protocol;
+        public long Pid;
+        public long Processes;
+        [MarshalAs(UnmanagedType.ByValArray, SizeConst = 64)]
+        public byte[] Process;
+        public long Uid;
+        public long AcceptQueue;
+        public long Backlog;
+    }
+
+    [DllImport(NativeLibraryLoader.LibraryName, CallingConvention = CallingConvention.Cdecl)]
+    private static extern int GetListeningSockets([Out] NativeListeningSocket[]? sockets, int maxCount);
+
+    // Indexed by the kernel's TCP state numbers, as the census reports them
+    private static readonly string[] TcpStateNames =
+    {
+        "Unknown", "Established", "SynSent", "SynReceived", "FinWait1", "FinWait2", "TimeWait",
+        "Closed", "CloseWait", "LastAck", "Listen", "Closing"
+    };
+
+    // Previous managed samples, for rates where the native library is missing
+    private static readonly Dictionary<string, (DateTime Time, NetworkInterfaceStats Stats)> PreviousInterfaceSamples = new();
+
+    // Previous managed sample, for rates where the native library is missing
+    private static (DateTime Time, NetworkStackStats Stats)? PreviousNetworkStackSample;
+    private static readonly object NetworkStackSampleLock = new();
+
+    // Unexpected listeners already logged, so each is reported once
+    private static readonly HashSet<(string Protocol, int Port)> ReportedListeners = new();
+
+    private readonly ILogger<SystemMonitoringService> _logger;
+    private readonly HashSet<int>? _expectedListeningPorts;
+
+    public SystemMonitoringService(ILogger<SystemMonitoringService> logger, IConfiguration configuration)
+    {
+        _logger = logger;
+        var expected = configuration.GetSection("Monitoring:ExpectedListeningPorts").Get<int[]>();
+        _expectedListeningPorts = expected is { Length: > 0 } ? expected.ToHashSet() : null;
+    }
+
     public async Task<SystemInfo> GetSystemInfoAsync()
     {
+        var interfaces = await GetNetworkInterfacesAsync();
+        // Bridges and veths repeat container traffic that also crosses a physical link
+        var external = interfaces.Any(i => i.Kind == NetworkInterfaceKind.Physical)
+            ? interfaces.Where(i => i.Kind == NetworkInterfaceKind.Physical).ToList()
+            : interfaces.Where(i => i.Kind != NetworkInterfaceKind.Loopback).ToList();
+
+        var census = await GetTcpCensusAsync(0);
+        var networkStack = await GetNetworkStackStatsAsync();
+
         var systemInfo = new SystemInfo
         {
             ServerName = Environment.MachineName,
@@ -40,6 +204,11 @@ public class SystemMonitoringService : ISystemMonitoringService
             AvailableMemoryMB = await GetAvailableMemoryAsync(),
             Drives = await GetDriveInfoAsync(),
             TopProcesses = await GetTopProcessesAsync(),
+            NetworkInterfaces = interfaces,
+            NetworkInBytesPerSecond = external.Sum(i => i.ReceiveBytesPerSecond),
+            NetworkOutBytesPerSecond = external.Sum(i => i.SendBytesPerSecond),
+            ActiveTcpConnections = census.States.GetValueOrDefault("Established"),
+            NetworkStack = networkStack,
             LastUpdated = DateTime.UtcNow
         };
 
@@ -166,4 +335,633 @@ public class SystemMonitoringService : ISystemMonitoringService
             return drives;
         });
     }
-}
\ No newline at end of file
+
+    public async Task<List<NetworkInterfaceStats>> GetNetworkInterfacesAsync()
+    {
+        return await Task.Run(() =>
+        {
+            if (NativeLibraryLoader.IsAvailable)
+            {
+                var native = new NativeInterfaceStats[64];
+                int count = GetInterfaceStats(native, native.Length);
+                if (count >= 0)
+                {
+                    return native.Take(Math.Min(count, native.Length)).Select(n => new NetworkInterfaceStats
+                    {
+                        Name = System.Text.Encoding.UTF8.GetString(n.Name, 0, Math.Max(0, Array.IndexOf(n.Name, (byte)0))),
+                        Kind = (NetworkInterfaceKind)n.Kind,
+                        IsUp = n.Up != 0,
+                        BytesReceived = n.RxBytes,
+                        BytesSent = n.TxBytes,
+                        PacketsReceived = n.RxPackets,
+                        PacketsSent = n.TxPackets,
+                        ReceiveErrors = n.RxErrors,
+                        SendErrors = n.TxErrors,
+                        ReceiveDropped = n.RxDropped,
+                        SendDropped = n.TxDropped,
+                        ReceiveBytesPerSecond = n.RxBytesPerSecond,
+                        SendBytesPerSecond = n.TxBytesPerSecond,
+                        ReceivePacketsPerSecond = n.RxPacketsPerSecond,
+                        SendPacketsPerSecond = n.TxPacketsPerSecond,
+                        ReceiveErrorsPerSecond = n.RxErrorsPerSecond,
+                        SendErrorsPerSecond = n.TxErrorsPerSecond,
+                        ReceiveDroppedPerSecond = n.RxDroppedPerSecond,
+                        SendDroppedPerSecond = n.TxDroppedPerSecond
+                    }).ToList();
+                }
+            }
+
+            return GetNetworkInterfacesManaged();
+        });
+    }
+
+    private static List<NetworkInterfaceStats> GetNetworkInterfacesManaged()
+    {
+        var now = DateTime.UtcNow;
+        var result = new List<NetworkInterfaceStats>();
+        foreach (var nic in System.Net.NetworkInformation.NetworkInterface.GetAllNetworkInterfaces())
+        {
+            var ip = nic.GetIPStatistics();
+            var stats = new NetworkInterfaceStats
+            {
+                Name = nic.Name,
+                Kind = nic.NetworkInterfaceType switch
+                {
+                    System.Net.NetworkInformation.NetworkInterfaceType.Loopback => NetworkInterfaceKind.Loopback,
+                    System.Net.NetworkInformation.NetworkInterfaceType.Ethernet or
+                    System.Net.NetworkInformation.NetworkInterfaceType.GigabitEthernet or
+                    System.Net.NetworkInformation.NetworkInterfaceType.Wireless80211 => NetworkInterfaceKind.Physical,
+                    _ => NetworkInterfaceKind.Virtual
+                },
+                IsUp = nic.OperationalStatus == System.Net.NetworkInformation.OperationalStatus.Up,
+                BytesReceived = ip.BytesReceived,
+                BytesSent = ip.BytesSent,
+                PacketsReceived = ip.UnicastPacketsReceived + ip.NonUnicastPacketsReceived,
+                PacketsSent = ip.UnicastPacketsSent + ip.NonUnicastPacketsSent,
+                ReceiveErrors = ip.IncomingPacketsWithErrors,
+                SendErrors = ip.OutgoingPacketsWithErrors,
+                ReceiveDropped = ip.IncomingPacketsDiscarded,
+                SendDropped = ip.OutgoingPacketsDiscarded
+            };
+
+            lock (PreviousInterfaceSamples)
+            {
+                if (PreviousInterfaceSamples.TryGetValue(stats.Name, out var previous))
+                {
+                    var seconds = (now - previous.Time).TotalSeconds;
+                    // A counter that went backwards was reset; skip the rate this once
+                    if (seconds > 0 && stats.BytesReceived >= previous.Stats.BytesReceived && stats.BytesSent >= previous.Stats.BytesSent)
+                    {
+                        stats.ReceiveBytesPerSecond = (stats.BytesReceived - previous.Stats.BytesReceived) / seconds;
+                        stats.SendBytesPerSecond = (stats.BytesSent - previous.Stats.BytesSent) / seconds;
+                        stats.ReceivePacketsPerSecond = (stats.PacketsReceived - previous.Stats.PacketsReceived) / seconds;
+                        stats.SendPacketsPerSecond = (stats.PacketsSent - previous.Stats.PacketsSent) / seconds;
+                        stats.ReceiveErrorsPerSecond = (stats.ReceiveErrors - previous.Stats.ReceiveErrors) / seconds;
+                        stats.SendErrorsPerSecond = (stats.SendErrors - previous.Stats.SendErrors) / seconds;
+                        stats.ReceiveDroppedPerSecond = (stats.ReceiveDropped - previous.Stats.ReceiveDropped) / seconds;
+                        stats.SendDroppedPerSecond = (stats.SendDropped - previous.Stats.SendDropped) / seconds;
+                    }
+                }
+                PreviousInterfaceSamples[stats.Name] = (now, stats);
+            }
+            result.Add(stats);
+        }
+        return result;
+    }
+
+    public async Task<TcpConnectionCensus> GetTcpCensusAsync(int top = 10)
+    {
+        return await Task.Run(() =>
+        {
+            if (NativeLibraryLoader.IsAvailable)
+            {
+                var ports = new NativeTcpPortCount[Math.Max(top, 0)];
+                var remotes = new NativeTcpRemoteCount[Math.Max(top, 0)];
+                if (GetTcpCensus(out var native, ports, ports.Length, out int portCount, remotes, remotes.Length, out int remoteCount) == 1)
+                {
+                    var census = new TcpConnectionCensus
+                    {
+                        Total = native.Total,
+                        Ipv4 = native.Ipv4,
+                        Ipv6 = native.Ipv6,
+                        Source = native.Source switch { 1 => "sock_diag", 2 => "proc", 3 => "iphelper", _ => "unknown" },
+                        ElapsedMs = native.ElapsedUs / 1000.0,
+                        TopLocalPorts = ports.Take(portCount).Select(p => new TcpPortConnections { Port = (int)p.Port, Connections = p.Count }).ToList(),
+                        TopRemoteAddresses = remotes.Take(remoteCount).Select(r => new TcpRemoteConnections
+                        {
+                            Address = System.Text.Encoding.ASCII.GetString(r.Address, 0, Math.Max(0, Array.IndexOf(r.Address, (byte)0))),
+                            Connections = r.Count
+                        }).ToList()
+                    };
+                    for (int state = 1; state < TcpStateNames.Length; state++)
+                    {
+                        if (native.States[state] > 0)
+                            census.States[TcpStateNames[state]] = native.States[state];
+                    }
+                    return census;
+                }
+            }
+
+            return GetTcpCensusManaged(top);
+        });
+    }
+
+    private static TcpConnectionCensus GetTcpCensusManaged(int top)
+    {
+        var stopwatch = System.Diagnostics.Stopwatch.StartNew();
+        var properties = System.Net.NetworkInformation.IPGlobalProperties.GetIPGlobalProperties();
+        var connections = properties.GetActiveTcpConnections();
+        var listeners = properties.GetActiveTcpListeners();
+
+        static bool IsIpv4(System.Net.IPAddress address) =>
+            address.AddressFamily == System.Net.Sockets.AddressFamily.InterNetwork || address.IsIPv4MappedToIPv6;
+
+        var census = new TcpConnectionCensus
+        {
+            Total = connections.Length + listeners.Length,
+            Ipv4 = connections.Count(c => IsIpv4(c.LocalEndPoint.Address)) + listeners.Count(l => IsIpv4(l.Address)),
+            Source = "managed",
+            TopLocalPorts = connections.GroupBy(c => c.LocalEndPoint.Port)
+                .Select(g => new TcpPortConnections { Port = g.Key, Connections = g.Count() })
+                .OrderByDescending(p => p.Connections).Take(top).ToList(),
+            TopRemoteAddresses = connections
+                .GroupBy(c => c.RemoteEndPoint.Address.IsIPv4MappedToIPv6 ? c.RemoteEndPoint.Address.MapToIPv4() : c.RemoteEndPoint.Address)
+                .Select(g => new TcpRemoteConnections { Address = g.Key.ToString(), Connections = g.Count() })
+                .OrderByDescending(r => r.Connections).Take(top).ToList()
+        };
+        census.Ipv6 = census.Total - census.Ipv4;
+        foreach (var group in connections.GroupBy(c => c.State))
+            census.States[group.Key.ToString()] = group.Count();
+        if (listeners.Length > 0)
+            census.States["Listen"] = listeners.Length;
+        census.ElapsedMs = stopwatch.Elapsed.TotalMilliseconds;
+        return census;
+    }
+
+    public async Task<NetworkStackStats> GetNetworkStackStatsAsync()
+    {
+        return await Task.Run(() =>
+        {
+            if (NativeLibraryLoader.IsAvailable && GetNetStackStats(out var native) == 1)
+            {
+                static long? Reported(long value) => value >= 0 ? value : null;
+
+                return new NetworkStackStats
+                {
+                    TcpActiveOpens = native.TcpActiveOpens,
+                    TcpPassiveOpens = native.TcpPassiveOpens,
+                    TcpAttemptFails = native.TcpAttemptFails,
+                    TcpEstablishedResets = native.TcpEstabResets,
+                    TcpSegmentsReceived = native.TcpInSegs,
+                    TcpSegmentsSent = native.TcpOutSegs,
+                    TcpSegmentsRetransmitted = native.TcpRetransSegs,
+                    TcpReceiveErrors = native.TcpInErrs,
+                    TcpResetsSent = native.TcpOutRsts,
+                    ListenOverflows = Reported(native.ListenOverflows),
+                    ListenDrops = Reported(native.ListenDrops),
+                    TcpTimeouts = Reported(native.TcpTimeouts),
+                    TcpSynRetransmits = Reported(native.TcpSynRetrans),
+                    TcpAbortsOnTimeout = Reported(native.TcpAbortOnTimeout),
+                    TcpAbortsOnMemory = Reported(native.TcpAbortOnMemory),
+                    TcpBacklogDrops = Reported(native.TcpBacklogDrop),
+                    SyncookiesSent = Reported(native.SyncookiesSent),
+                    TcpRequestQueueFullDrops = Reported(native.TcpReqQFullDrop),
+                    UdpDatagramsReceived = native.UdpInDatagrams,
+                    UdpDatagramsSent = native.UdpOutDatagrams,
+                    UdpNoPorts = native.UdpNoPorts,
+                    UdpReceiveErrors = native.UdpInErrors,
+                    UdpReceiveBufferErrors = Reported(native.UdpRcvbufErrors),
+                    UdpSendBufferErrors = Reported(native.UdpSndbufErrors),
+                    TcpCurrentEstablished = native.TcpCurrEstab,
+                    TcpSocketsInUse = Reported(native.TcpInUse),
+                    TcpOrphans = Reported(native.TcpOrphans),
+                    TcpTimeWait = Reported(native.TcpTimeWait),
+                    TcpMemoryPages = Reported(native.TcpMemoryPages),
+                    UdpSocketsInUse = Reported(native.UdpInUse),
+                    SocketsUsed = Reported(native.SocketsUsed),
+                    TcpSegmentsReceivedPerSecond = native.TcpInSegsPerSecond,
+                    TcpSegmentsSentPerSecond = native.TcpOutSegsPerSecond,
+                    TcpRetransmitsPerSecond = native.TcpRetransSegsPerSecond,
+                    TcpAttemptFailsPerSecond = native.TcpAttemptFailsPerSecond,
+                    TcpEstablishedResetsPerSecond = native.TcpEstabResetsPerSecond,
+                    TcpReceiveErrorsPerSecond = native.TcpInErrsPerSecond,
+                    TcpResetsSentPerSecond = native.TcpOutRstsPerSecond,
+                    ListenOverflowsPerSecond = native.ListenOverflowsPerSecond,
+                    ListenDropsPerSecond = native.ListenDropsPerSecond,
+                    TcpTimeoutsPerSecond = native.TcpTimeoutsPerSecond,
+                    TcpSynRetransmitsPerSecond = native.TcpSynRetransPerSecond,
+                    UdpReceiveErrorsPerSecond = native.UdpInErrorsPerSecond,
+                    UdpReceiveBufferErrorsPerSecond = native.UdpRcvbufErrorsPerSecond,
+                    RetransmitPercent = native.RetransmitPercent
+                };
+            }
+
+            return GetNetworkStackStatsManaged();
+        });
+    }
+
+    // The RFC 1213 counters .NET exposes; no listen-queue or timeout counters
+    private static NetworkStackStats GetNetworkStackStatsManaged()
+    {
+        var properties = System.Net.NetworkInformation.IPGlobalProperties.GetIPGlobalProperties();
+        var tcp = properties.GetTcpIPv4Statistics();
+        var udp = properties.GetUdpIPv4Statistics();
+        var stats = new NetworkStackStats
+        {
+            TcpActiveOpens = tcp.ConnectionsInitiated,
+            TcpPassiveOpens = tcp.ConnectionsAccepted,
+            TcpAttemptFails = tcp.FailedConnectionAttempts,
+            TcpEstablishedResets = tcp.ResetConnections,
+            TcpSegmentsReceived = tcp.SegmentsReceived,
+            TcpSegmentsSent = tcp.SegmentsSent,
+            TcpSegmentsRetransmitted = tcp.SegmentsResent,
+            TcpReceiveErrors = tcp.ErrorsReceived,
+            TcpResetsSent = tcp.ResetsSent,
+            TcpCurrentEstablished = tcp.CurrentConnections,
+            UdpDatagramsReceived = udp.DatagramsReceived,
+            UdpDatagramsSent = udp.DatagramsSent,
+            UdpNoPorts = udp.IncomingDatagramsDiscarded,
+            UdpReceiveErrors = udp.IncomingDatagramsWithErrors
+        };
+        if (IsWindows)
+        {
+            // Linux reports one set of counters for both families; Windows splits them
+            var tcp6 = properties.GetTcpIPv6Statistics();
+            var udp6 = properties.GetUdpIPv6Statistics();
+            stats.TcpActiveOpens += tcp6.ConnectionsInitiated;
+            stats.TcpPassiveOpens += tcp6.ConnectionsAccepted;
+            stats.TcpAttemptFails += tcp6.FailedConnectionAttempts;
+            stats.TcpEstablishedResets += tcp6.ResetConnections;
+            stats.TcpSegmentsReceived += tcp6.SegmentsReceived;
+            stats.TcpSegmentsSent += tcp6.SegmentsSent;
+            stats.TcpSegmentsRetransmitted += tcp6.SegmentsResent;
+            stats.TcpReceiveErrors += tcp6.ErrorsReceived;
+            stats.TcpResetsSent += tcp6.ResetsSent;
+            stats.TcpCurrentEstablished += tcp6.CurrentConnections;
+            stats.UdpDatagramsReceived += udp6.DatagramsReceived;
+            stats.UdpDatagramsSent += udp6.DatagramsSent;
+            stats.UdpNoPorts += udp6.IncomingDatagramsDiscarded;
+            stats.UdpReceiveErrors += udp6.IncomingDatagramsWithErrors;
+        }
+
+        var now = DateTime.UtcNow;
+        lock (NetworkStackSampleLock)
+        {
+            if (PreviousNetworkStackSample is { } previous && (now - previous.Time).TotalMilliseconds >= 250)
+            {
+                double seconds = (now - previous.Time).TotalSeconds;
+                double Rate(long current, long before) => current >= before ? (current - before) / seconds : 0;
+                stats.TcpSegmentsReceivedPerSecond = Rate(stats.TcpSegmentsReceived, previous.Stats.TcpSegmentsReceived);
+                stats.TcpSegmentsSentPerSecond = Rate(stats.TcpSegmentsSent, previous.Stats.TcpSegmentsSent);
+                stats.TcpRetransmitsPerSecond = Rate(stats.TcpSegmentsRetransmitted, previous.Stats.TcpSegmentsRetransmitted);
+                stats.TcpAttemptFailsPerSecond = Rate(stats.TcpAttemptFails, previous.Stats.TcpAttemptFails);
+                stats.TcpEstablishedResetsPerSecond = Rate(stats.TcpEstablishedResets, previous.Stats.TcpEstablishedResets);
+                stats.TcpReceiveErrorsPerSecond = Rate(stats.TcpReceiveErrors, previous.Stats.TcpReceiveErrors);
+                stats.TcpResetsSentPerSecond = Rate(stats.TcpResetsSent, previous.Stats.TcpResetsSent);
+                stats.UdpReceiveErrorsPerSecond = Rate(stats.UdpReceiveErrors, previous.Stats.UdpReceiveErrors);
+                stats.RetransmitPercent = stats.TcpSegmentsSentPerSecond > 0
+                    ? 100.0 * stats.TcpRetransmitsPerSecond / stats.TcpSegmentsSentPerSecond
+                    : 0;
+                PreviousNetworkStackSample = (now, stats);
+            }
+            else if (PreviousNetworkStackSample == null)
+            {
+                PreviousNetworkStackSample = (now, stats);
+            }
+        }
+        return stats;
+    }
+
+    public async Task<List<ListeningSocketInfo>> GetListeningSocketsAsync()
+    {
+        var sockets = await Task.Run(() =>
+        {
+            if (NativeLibraryLoader.IsAvailable)
+            {
+                // Size from a first call; retry if listeners appeared in between
+                int count = GetListeningSockets(null, 0);
+                while (count >= 0)
+                {
+                    var native = new NativeListeningSocket[count + 16];
+                    int total = GetListeningSockets(native, native.Length);
+                    if (total > native.Length)
+                    {
+                        count = total;
+                        continue;
+                    }
+                    if (total >= 0)
+                        return native.Take(total).Select(ToListeningSocketInfo).ToList();
+                    break;
+                }
+            }
+
+            return GetListeningSocketsManaged();
+        });
+
+        if (_expectedListeningPorts != null)
+        {
+            foreach (var socket in sockets)
+            {
+                socket.IsExpected = socket.IsLoopback || _expectedListeningPorts.Contains(socket.Port);
+                if (socket.IsExpected == false)
+                {
+                    bool first;
+                    lock (ReportedListeners)
+                        first = ReportedListeners.Add((socket.Protocol, socket.Port));
+                    if (first)
+                        _logger.LogWarning("Unexpected {Protocol} listener on {Address}:{Port} ({Process}, pid {Pid})",
+                            socket.Protocol, socket.Address, socket.Port, socket.ProcessName ?? "unknown", socket.Pid);
+                }
+            }
+        }
+        return sockets;
+    }
+
+    private static ListeningSocketInfo ToListeningSocketInfo(NativeListeningSocket native)
+    {
+        static string Text(byte[] bytes) => System.Text.Encoding.UTF8.GetString(bytes, 0, Math.Max(0, Array.IndexOf(bytes, (byte)0)));
+
+        string address = Text(native.Address);
+        return new ListeningSocketInfo
+        {
+            Address = address,
+            Port = (int)native.Port,
+            Protocol = native.Protocol == 17 ? "udp" : "tcp",
+            Pid = native.Pid >= 0 ? (int)native.Pid : null,
+            ProcessName = native.Pid >= 0 && native.Process[0] != 0 ? Text(native.Process) : null,
+            Processes = (int)native.Processes,
+            Uid = IsWindows ? null : native.Uid,
+            AcceptQueue = native.AcceptQueue,
+            Backlog = native.Backlog,
+            IsLoopback = System.Net.IPAddress.TryParse(address, out var parsed) && System.Net.IPAddress.IsLoopback(parsed)
+        };
+    }
+
+    // Without the native library the sockets are listed but not their owners
+    private static List<ListeningSocketInfo> GetListeningSocketsManaged()
+    {
+        var properties = System.Net.NetworkInformation.IPGlobalProperties.GetIPGlobalProperties();
+        static ListeningSocketInfo ToInfo(System.Net.IPEndPoint endPoint, string protocol) => new()
+        {
+            Address = (endPoint.Address.IsIPv4MappedToIPv6 ? endPoint.Address.MapToIPv4() : endPoint.Address).ToString(),
+            Port = endPoint.Port,
+            Protocol = protocol,
+            IsLoopback = System.Net.IPAddress.IsLoopback(endPoint.Address)
+        };
+
+        return properties.GetActiveTcpListeners().Select(e => ToInfo(e, "tcp"))
+            .Concat(properties.GetActiveUdpListeners().Select(e => ToInfo(e, "udp")))
+            .OrderBy(s => s.Protocol).ThenBy(s => s.Port)
+            .ToList();
+    }
+
+    public async Task<List<PortCheckResult>> CheckPortsAsync(IReadOnlyList<PortCheckTarget> targets)
+    {
+        if (targets.Count == 0)
+            return new List<PortCheckResult>();
+
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            // Blocks for up to the longest timeout, so keep it off the request thread
+            var results = await Task.Run(() =>
+            {
+                var native = new NativePortCheckResult[targets.Count];
+                int open = CheckPorts(targets.Select(t => t.Host).ToArray(), targets.Select(t => t.Port).ToArray(),
+                    targets.Select(t => t.TimeoutMs).ToArray(), targets.Count, native);
+                return open < 0 ? null : native;
+            });
+            if (results != null)
+            {
+                return targets.Select((t, i) => new PortCheckResult
+                {
+                    Host = t.Host,
+                    Port = t.Port,
+                    Status = (PortStatus)results[i].Status,
+                    RoundTripMs = results[i].RttUs >= 0 ? results[i].RttUs / 1000.0 : null,
+                    Error = (int)results[i].Error
+                }).ToList();
+            }
+        }
+
+        return (await Task.WhenAll(targets.Select(CheckPortManagedAsync))).ToList();
+    }
+
+    private static async Task<PortCheckResult> CheckPortManagedAsync(PortCheckTarget target)
+    {
+        var result = new PortCheckResult { Host = target.Host, Port = target.Port };
+        using var client = new System.Net.Sockets.TcpClient();
+        using var timeout = new CancellationTokenSource(target.TimeoutMs > 0 ? target.TimeoutMs : 3000);
+        var stopwatch = System.Diagnostics.Stopwatch.StartNew();
+        try
+        {
+            await client.ConnectAsync(target.Host, target.Port, timeout.Token);
+            result.Status = PortStatus.Open;
+            result.RoundTripMs = stopwatch.Elapsed.TotalMilliseconds;
+        }
+        catch (OperationCanceledException)
+        {
+            result.Status = PortStatus.Timeout;
+        }
+        catch (System.Net.Sockets.SocketException ex)
+        {
+            result.Error = ex.ErrorCode;
+            result.Status = ex.SocketErrorCode switch
+            {
+                System.Net.Sockets.SocketError.ConnectionRefused => PortStatus.Closed,
+                System.Net.Sockets.SocketError.HostUnreachable or System.Net.Sockets.SocketError.NetworkUnreachable => PortStatus.Unreachable,
+                System.Net.Sockets.SocketError.TimedOut => PortStatus.Timeout,
+                System.Net.Sockets.SocketError.HostNotFound or System.Net.Sockets.SocketError.TryAgain or System.Net.Sockets.SocketError.NoData => PortStatus.Unresolved,
+                _ => PortStatus.Error
+            };
+            if (result.Status == PortStatus.Closed)
+                result.RoundTripMs = stopwatch.Elapsed.TotalMilliseconds;
+        }
+        catch (ArgumentException)
+        {
+            result.Status = PortStatus.Error;
+        }
+        return result;
+    }
+
+    public async Task<List<ReachabilityResult>> CheckReachabilityAsync(ReachabilityCheckRequest request)
+    {
+        var targets = request.Targets;
+        if (targets.Count == 0)
+            return new List<ReachabilityResult>();
+
+        int packets = Math.Clamp(request.Packets, 1, 100);
+        var results = targets.Select(t => new ReachabilityResult
+        {
+            Host = t.Host,
+            Protocol = IsUdp(t) ? "udp" : "icmp",
+            Port = IsUdp(t) ? t.Port : 0
+        }).ToList();
+        var pings = Enumerable.Range(0, targets.Count).Where(i => !IsUdp(targets[i])).ToArray();
+        var udp = Enumerable.Range(0, targets.Count).Where(i => IsUdp(targets[i])).ToArray();
+
+        if (NativeLibraryLoader.IsAvailable)
+        {
+            // Both batches block for the whole run, so keep them off the request thread and overlap them
+            var pingTask = Task.Run(() =>
+            {
+                if (pings.Length == 0)
+                    return Array.Empty<NativeReachabilityResult>();
+                var native = new NativeReachabilityResult[pings.Length];
+                return CheckPings(pings.Select(i => targets[i].Host).ToArray(), pings.Length, packets, request.IntervalMs, request.TimeoutMs, native) < 0
+                    ? null : native;
+            });
+            var udpTask = Task.Run(() =>
+            {
+                if (udp.Length == 0)
+                    return Array.Empty<NativeReachabilityResult>();
+                var native = new NativeReachabilityResult[udp.Length];
+                // A payload goes as raw bytes (its UTF-8 length); otherwise the template name, length -1
+                var payloads = udp.Select(i => targets[i].Payload ?? targets[i].Template).ToArray();
+                var lengths = udp.Select(i => targets[i].Payload != null ? System.Text.Encoding.UTF8.GetByteCount(targets[i].Payload!) : -1).ToArray();
+                return CheckUdpPorts(udp.Select(i => targets[i].Host).ToArray(), udp.Select(i => targets[i].Port).ToArray(), payloads, lengths,
+                    udp.Length, packets, request.IntervalMs, request.TimeoutMs, native) < 0 ? null : native;
+            });
+            var pingResults = await pingTask;
+            var udpResults = await udpTask;
+            if (pingResults != null && udpResults != null)
+            {
+                for (int i = 0; i < pings.Length; i++)
+                    Fill(results[pings[i]], pingResults[i]);
+                for (int i = 0; i < udp.Length; i++)
+                    Fill(results[udp[i]], udpResults[i]);
+                return results;
+            }
+        }
+
+        await Task.WhenAll(targets.Select((t, i) => CheckReachabilityManagedAsync(t, results[i], packets, request.IntervalMs, request.TimeoutMs)));
+        return results;
+    }
+
+    private static bool IsUdp(ReachabilityTarget target) => string.Equals(target.Protocol, "udp", StringComparison.OrdinalIgnoreCase);
+
+    private static void Fill(ReachabilityResult result, NativeReachabilityResult native)
+    {
+        result.Status = (ReachabilityStatus)native.Status;
+        result.Sent = (int)native.Sent;
+        result.Received = (int)native.Received;
+        result.LossPercent = native.Sent > 0 ? 100.0 * (native.Sent - native.Received) / native.Sent : 0;
+        result.MinMs = native.MinUs >= 0 ? native.MinUs / 1000.0 : null;
+        result.AvgMs = native.AvgUs >= 0 ? native.AvgUs / 1000.0 : null;
+        result.MaxMs = native.MaxUs >= 0 ? native.MaxUs / 1000.0 : null;
+        result.MdevMs = native.MdevUs >= 0 ? native.MdevUs / 1000.0 : null;
+        result.Error = (int)native.Error;
+    }
+
+    // One packet at a time; replies are not matched by id as the native checks do
+    private static async Task CheckReachabilityManagedAsync(ReachabilityTarget target, ReachabilityResult result, int packets, int intervalMs, int timeoutMs)
+    {
+        var interval = TimeSpan.FromMilliseconds(intervalMs > 0 ? intervalMs : 200);
+        timeoutMs = timeoutMs > 0 ? timeoutMs : 1000;
+        var roundTrips = new List<double>();
+        bool refused = false;
+        try
+        {
+            if (!IsUdp(target))
+            {
+                using var ping = new System.Net.NetworkInformation.Ping();
+                for (int i = 0; i < packets; i++)
+                {
+                    if (i > 0)
+                        await Task.Delay(interval);
+                    var reply = await ping.SendPingAsync(target.Host, timeoutMs);
+                    result.Sent++;
+                    if (reply.Status == System.Net.NetworkInformation.IPStatus.Success)
+                        roundTrips.Add(reply.RoundtripTime);
+                    else if (reply.Status is System.Net.NetworkInformation.IPStatus.DestinationHostUnreachable
+                             or System.Net.NetworkInformation.IPStatus.DestinationNetworkUnreachable)
+                        result.Status = ReachabilityStatus.Unreachable;
+                }
+            }
+            else
+            {
+                if (target.Port <= 0 || target.Port > 65535)
+                {
+                    result.Status = ReachabilityStatus.Error;
+                    return;
+                }
+                using var client = new System.Net.Sockets.UdpClient();
+                client.Connect(target.Host, target.Port);
+                var payload = UdpRequest(target);
+                for (int i = 0; i < packets; i++)
+                {
+                    if (i > 0)
+                        await Task.Delay(interval);
+                    var stopwatch = System.Diagnostics.Stopwatch.StartNew();
+                    result.Sent++;
+                    try
+                    {
+                        await client.SendAsync(payload, payload.Length);
+                        using var timeout = new CancellationTokenSource(timeoutMs);
+                        await client.ReceiveAsync(timeout.Token);
+                        roundTrips.Add(stopwatch.Elapsed.TotalMilliseconds);
+                    }
+                    catch (OperationCanceledException)
+                    {
+                    }
+                    catch (System.Net.Sockets.SocketException ex) when (ex.SocketErrorCode is System.Net.Sockets.SocketError.ConnectionRefused
+                                                                         or System.Net.Sockets.SocketError.ConnectionReset)
+                    {
+                        refused = true;
+                        result.Error = ex.ErrorCode;
+                    }
+                }
+            }
+        }
+        catch (System.Net.Sockets.SocketException ex)
+        {
+            result.Error = ex.ErrorCode;
+            result.Status = ex.SocketErrorCode is System.Net.Sockets.SocketError.HostNotFound or System.Net.Sockets.SocketError.TryAgain
+                or System.Net.Sockets.SocketError.NoData ? ReachabilityStatus.Unresolved : ReachabilityStatus.Error;
+            return;
+        }
+        catch (System.Net.NetworkInformation.PingException)
+        {
+            result.Status = ReachabilityStatus.Error;
+            return;
+        }
+
+        result.Received = roundTrips.Count;
+        result.LossPercent = result.Sent > 0 ? 100.0 * (result.Sent - result.Received) / result.Sent : 0;
+        if (roundTrips.Count > 0)
+        {
+            var mean = roundTrips.Average();
+            result.Status = ReachabilityStatus.Ok;
+            result.MinMs = roundTrips.Min();
+            result.AvgMs = mean;
+            result.MaxMs = roundTrips.Max();
+            result.MdevMs = Math.Sqrt(Math.Max(0, roundTrips.Average(r => r * r) - mean * mean));
+        }
+        else if (refused)
+        {
+            result.Status = ReachabilityStatus.Refused;
+        }
+        else if (result.Status != ReachabilityStatus.Unreachable)
+        {
+            result.Status = ReachabilityStatus.NoReply;
+        }
+    }
+
+    // The native templates' requests, without their per-packet ids
+    private static byte[] UdpRequest(ReachabilityTarget target)
+    {
+        if (target.Payload != null)
+            return System.Text.Encoding.UTF8.GetBytes(target.Payload);
+        var template = target.Template ?? (target.Port == 53 ? "dns" : target.Port == 123 ? "ntp" : null);
+        switch (template)
+        {
+            case "dns":
+                return new byte[] { 0x12, 0x34, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 1 };
+            case "ntp":
+                var ntp = new byte[48];
+                ntp[0] = 0x23;
+                return ntp;
+            default:
+                return Array.Empty<byte>();
+        }
+    }
+}
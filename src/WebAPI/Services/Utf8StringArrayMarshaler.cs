@@ -0,0 +1,52 @@
+using System.Runtime.InteropServices;
+
+namespace SuperPanel.WebAPI.Services;
+
+/// <summary>
+/// Passes a string array to native code as a <c>const char* const*</c> of
+/// NUL-terminated UTF-8 strings (null elements as NULL). The built-in
+/// marshaller only converts array elements to ANSI or UTF-16, so native
+/// exports that take string arrays declare the parameter with
+/// <c>[MarshalAs(UnmanagedType.CustomMarshaler, MarshalTypeRef = typeof(Utf8StringArrayMarshaler))]</c>.
+/// The strings are freed when the call returns; exports copy what they keep.
+/// </summary>
+public sealed class Utf8StringArrayMarshaler : ICustomMarshaler
+{
+    private static readonly Utf8StringArrayMarshaler Instance = new();
+
+    public static ICustomMarshaler GetInstance(string cookie) => Instance;
+
+    public IntPtr MarshalManagedToNative(object managedObj)
+    {
+        if (managedObj is not string?[] strings)
+            return IntPtr.Zero;
+
+        // The element count goes in a slot ahead of the array so the strings
+        // can be found again to free them
+        var block = Marshal.AllocCoTaskMem((strings.Length + 1) * IntPtr.Size);
+        Marshal.WriteIntPtr(block, strings.Length);
+        for (int i = 0; i < strings.Length; i++)
+            Marshal.WriteIntPtr(block, (i + 1) * IntPtr.Size, Marshal.StringToCoTaskMemUTF8(strings[i]));
+        return block + IntPtr.Size;
+    }
+
+    public void CleanUpNativeData(IntPtr pNativeData)
+    {
+        if (pNativeData == IntPtr.Zero)
+            return;
+
+        var block = pNativeData - IntPtr.Size;
+        int count = (int)Marshal.ReadIntPtr(block);
+        for (int i = 0; i < count; i++)
+            Marshal.FreeCoTaskMem(Marshal.ReadIntPtr(pNativeData, i * IntPtr.Size));
+        Marshal.FreeCoTaskMem(block);
+    }
+
+    public object MarshalNativeToManaged(IntPtr pNativeData) => throw new NotSupportedException();
+
+    public void CleanUpManagedData(object managedObj)
+    {
+    }
+
+    public int GetNativeDataSize() => -1;
+}
@@ -50,7 +50,7 @@ import {
   AlertHistory,
   AlertComment
 } from "../types/alerts";
-import { DashboardStats } from "../types/dashboard";
+import { DashboardStats, TrafficStats, TrafficWindow } from "../types/dashboard";
 import { DnsRecord, DnsZone, DnsPropagationStatus, DnsRecordType, DnsRecordStatus } from "../types/domains";
 
 // Types
@@ -150,6 +150,13 @@ export interface FileSystemItem {
   permissions: string;
 }
 
+export interface FileLinesResult {
+  startLine: number;
+  lines: string[];
+  totalLines: number;
+  totalLinesExact: boolean;
+}
+
 export interface Database {
   id: number;
   name: string;
@@ -356,6 +363,24 @@ export const fileApi = {
     apiClient.get(`/api/files/info?path=${encodeURIComponent(path)}`),
   readFile: (filePath: string): Promise<{ content: string }> =>
     apiClient.get(`/api/files/content?filePath=${encodeURIComponent(filePath)}`),
+  readLines: (filePath: string, start: number = 0, count: number = 100): Promise<FileLinesResult> =>
+    apiClient.get(`/api/files/lines?filePath=${encodeURIComponent(filePath)}&start=${start}&count=${count}`),
+  download: async (filePath: string): Promise<Blob> => {
+    const response = await fetch(`${API_BASE_URL}/api/files/download?filePath=${encodeURIComponent(filePath)}`, {
+      method: "GET",
+      headers: {
+        "Authorization": `Bearer ${getAuthToken()}`,
+      },
+      credentials: "same-origin",
+      mode: "cors",
+    });
+
+    if (!response.ok) {
+      throw new Error(`Download failed: ${response.status}`);
+    }
+
+    return response.blob();
+  },
   writeFile: (filePath: string, content: string): Promise<void> =>
     apiClient.post("/api/files/content", { filePath, content }),
   deleteFile: (filePath: string): Promise<void> =>
@@ -402,6 +427,13 @@ export const dashboardApi = {
       throw error;
     }
   },
+  getTraffic: (): Promise<TrafficStats> => apiClient.get("/api/dashboard/traffic"),
+  getTrafficWindow: (domain?: string, minutes = 15, top = 10): Promise<TrafficWindow> =>
+    apiClient.get(`/api/dashboard/traffic/window?${new URLSearchParams({
+      ...(domain ? { domain } : {}),
+      minutes: String(minutes),
+      top: String(top),
+    })}`),
 };
 
 // User API functions
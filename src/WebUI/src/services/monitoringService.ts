@@ -1,5 +1,6 @@
 import { HubConnection, HubConnectionBuilder, LogLevel } from '@microsoft/signalr';
 import { ServerMetrics, ServerAlert } from '../types/monitoring';
+import { RestoreProgress } from '../types/backup';
 
 class MonitoringService {
   private connection: HubConnection | null = null;
@@ -7,6 +8,8 @@ class MonitoringService {
   // Callbacks for handling real-time updates
   private onMetricsUpdate?: (serverId: number, metrics: ServerMetrics) => void;
   private onAlertReceived?: (alert: ServerAlert) => void;
+  private onLogLines?: (path: string, lines: string[]) => void;
+  private onRestoreProgress?: (progress: RestoreProgress) => void;
   private onConnectionStatusChange?: (connected: boolean) => void;
 
   constructor() {
@@ -45,6 +48,14 @@ class MonitoringService {
       this.onAlertReceived?.(alert);
     });
 
+    this.connection.on('ReceiveLogLines', (path: string, lines: string[]) => {
+      this.onLogLines?.(path, lines);
+    });
+
+    this.connection.on('ReceiveRestoreProgress', (progress: RestoreProgress) => {
+      this.onRestoreProgress?.(progress);
+    });
+
     this.connection.onclose(() => {
       console.log('SignalR connection closed');
       this.onConnectionStatusChange?.(false);
@@ -118,6 +129,60 @@ class MonitoringService {
     }
   }
 
+  async subscribeToLog(path: string): Promise<void> {
+    if (!this.connection) {
+      throw new Error('Connection not initialized');
+    }
+
+    try {
+      await this.connection.invoke('SubscribeToLog', path);
+      console.log(`Subscribed to log ${path}`);
+    } catch (error) {
+      console.error(`Failed to subscribe to log ${path}:`, error);
+      throw error;
+    }
+  }
+
+  async unsubscribeFromLog(path: string): Promise<void> {
+    if (!this.connection) {
+      throw new Error('Connection not initialized');
+    }
+
+    try {
+      await this.connection.invoke('UnsubscribeFromLog', path);
+      console.log(`Unsubscribed from log ${path}`);
+    } catch (error) {
+      console.error(`Failed to unsubscribe from log ${path}:`, error);
+      throw error;
+    }
+  }
+
+  async subscribeToBackupProgress(backupId: number): Promise<void> {
+    if (!this.connection) {
+      throw new Error('Connection not initialized');
+    }
+
+    try {
+      await this.connection.invoke('SubscribeToBackupProgress', backupId);
+    } catch (error) {
+      console.error(`Failed to subscribe to backup ${backupId} progress:`, error);
+      throw error;
+    }
+  }
+
+  async unsubscribeFromBackupProgress(backupId: number): Promise<void> {
+    if (!this.connection) {
+      throw new Error('Connection not initialized');
+    }
+
+    try {
+      await this.connection.invoke('UnsubscribeFromBackupProgress', backupId);
+    } catch (error) {
+      console.error(`Failed to unsubscribe from backup ${backupId} progress:`, error);
+      throw error;
+    }
+  }
+
   // Set callback functions
   setOnMetricsUpdate(callback: (serverId: number, metrics: ServerMetrics) => void) {
     this.onMetricsUpdate = callback;
@@ -127,6 +192,14 @@ class MonitoringService {
     this.onAlertReceived = callback;
   }
 
+  setOnLogLines(callback: (path: string, lines: string[]) => void) {
+    this.onLogLines = callback;
+  }
+
+  setOnRestoreProgress(callback: (progress: RestoreProgress) => void) {
+    this.onRestoreProgress = callback;
+  }
+
   setOnConnectionStatusChange(callback: (connected: boolean) => void) {
     this.onConnectionStatusChange = callback;
   }
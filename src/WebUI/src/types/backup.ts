@@ -94,6 +94,17 @@ export interface RestoreResult {
   bytesRestored: number;
 }
 
+export interface RestoreProgress {
+  backupId: number;
+  filesDone: number;
+  filesTotal: number; // 0 when not known up front
+  bytesDone: number;
+  bytesTotal: number;
+  elapsedMs: number;
+  bytesPerSecond?: number;
+  etaSeconds?: number;
+}
+
 export interface BackupStats {
   totalBackups: number;
   successfulBackups: number;
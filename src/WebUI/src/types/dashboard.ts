@@ -34,4 +34,42 @@ export interface ProcessInfo {
   cpuUsagePercent: number;
   memoryUsageMB: number;
   processId: number;
-}
\ No newline at end of file
+}
+
+export interface DomainTrafficStats {
+  domain: string;
+  requests: number;
+  recentRequests: number;
+  requestsPerMinute: number;
+  status1xx: number;
+  status2xx: number;
+  status3xx: number;
+  status4xx: number;
+  status5xx: number;
+  bytesSent: number;
+  firstRequest?: string;
+  lastRequest?: string;
+  latencyP50Ms: number;
+  latencyP95Ms: number;
+  latencyP99Ms: number;
+}
+
+export interface TrafficStats {
+  domains: DomainTrafficStats[];
+  malformedLines: number;
+  lastAnalyzed?: string;
+}
+
+export interface TrafficTopEntry {
+  key: string;
+  count: number;
+  error: number;
+}
+
+export interface TrafficWindow {
+  domain?: string;
+  windowMinutes: number;
+  uniqueVisitors: number;
+  topClients: TrafficTopEntry[];
+  topPaths: TrafficTopEntry[];
+}